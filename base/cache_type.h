@@ -21,7 +21,8 @@ enum CacheType {
 enum BackendType {
   CACHE_BACKEND_DEFAULT,
   CACHE_BACKEND_BLOCKFILE,  // The |BackendImpl|.
-  CACHE_BACKEND_SIMPLE  // The |SimpleBackendImpl|.
+  CACHE_BACKEND_SIMPLE,  // The |SimpleBackendImpl|.
+  CACHE_BACKEND_BLOCKFILE_SHARDED  // The |ShardedBackendImpl|.
 };
 
 }  // namespace disk_cache
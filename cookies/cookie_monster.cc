@@ -161,6 +161,20 @@ bool CookieSorter(CanonicalCookie* cc1, CanonicalCookie* cc2) {
   return cc1->Path().length() > cc2->Path().length();
 }
 
+// Returns the CookieMap key for |domain|. See CookieMonster::GetKey(); this is
+// split out so that CookieMonster::ConcurrentReader can use it on any thread.
+std::string GetKeyForDomain(const std::string& domain) {
+  std::string effective_domain(
+      registry_controlled_domains::GetDomainAndRegistry(
+          domain, registry_controlled_domains::INCLUDE_PRIVATE_REGISTRIES));
+  if (effective_domain.empty())
+    effective_domain = domain;
+
+  if (!effective_domain.empty() && effective_domain[0] == '.')
+    return effective_domain.substr(1);
+  return effective_domain;
+}
+
 bool LRACookieSorter(const CookieMonster::CookieMap::iterator& it1,
                      const CookieMonster::CookieMap::iterator& it2) {
   if (it1->second->LastAccessDate() != it2->second->LastAccessDate())
@@ -344,7 +358,9 @@ CookieMonster::CookieMonster(PersistentCookieStore* store,
 CookieMonster::CookieMonster(PersistentCookieStore* store,
                              CookieMonsterDelegate* delegate,
                              base::TimeDelta last_access_threshold)
-    : initialized_(false),
+    : cookie_line_cache_size_(0),
+      republish_pending_(false),
+      initialized_(false),
       started_fetching_all_cookies_(false),
       finished_fetching_all_cookies_(false),
       fetch_strategy_(kUnknownFetch),
@@ -361,6 +377,10 @@ CookieMonster::CookieMonster(PersistentCookieStore* store,
       kDefaultCookieableSchemes + kDefaultCookieableSchemesCount);
 }
 
+CookieMonster::CachedCookieLine::CachedCookieLine() {}
+
+CookieMonster::CachedCookieLine::~CachedCookieLine() {}
+
 // Task classes for queueing the coming request.
 
 class CookieMonster::CookieMonsterTask
@@ -915,6 +935,19 @@ void CookieMonster::GetCookieListWithOptionsAsync(
   DoCookieTaskForURL(task, url);
 }
 
+bool CookieMonster::GetCookieListWithOptionsIfAvailable(
+    const GURL& url,
+    const CookieOptions& options,
+    CookieList* cookie_list) {
+  DCHECK(thread_checker_.CalledOnValidThread());
+
+  // Snapshots only exist for keys that have been loaded and read, so a hit
+  // never jumps ahead of a queued task. Taking the reader here also starts
+  // publishing snapshots for the readers handed to other threads.
+  return GetConcurrentReader()->GetCookieListWithOptions(url, options,
+                                                          cookie_list);
+}
+
 void CookieMonster::GetAllCookiesAsync(const GetCookieListCallback& callback) {
   scoped_refptr<GetAllCookiesTask> task = new GetAllCookiesTask(this, callback);
 
@@ -1015,6 +1048,22 @@ CookieMonster::AddCallbackForCookie(const GURL& gurl,
       base::Bind(&RunAsync, base::ThreadTaskRunnerHandle::Get(), callback));
 }
 
+scoped_refptr<CookieMonster::ConcurrentReader>
+CookieMonster::GetConcurrentReader() {
+  DCHECK(thread_checker_.CalledOnValidThread());
+
+  if (!concurrent_reader_) {
+    concurrent_reader_ = new ConcurrentReader(
+        weak_ptr_factory_.GetWeakPtr(), base::ThreadTaskRunnerHandle::Get(),
+        cookieable_schemes_, last_access_threshold_);
+    // Results cached before now never published a snapshot, and a hit on
+    // them would not publish one either.
+    cookie_line_cache_.clear();
+    cookie_line_cache_size_ = 0;
+  }
+  return concurrent_reader_;
+}
+
 bool CookieMonster::IsEphemeral() {
   return store_.get() == nullptr;
 }
@@ -1022,6 +1071,11 @@ bool CookieMonster::IsEphemeral() {
 CookieMonster::~CookieMonster() {
   DCHECK(thread_checker_.CalledOnValidThread());
 
+  // Readers on other threads may outlive the CookieMonster; make them fall
+  // back to the (now failing) asynchronous path.
+  if (concurrent_reader_)
+    concurrent_reader_->WithdrawAll();
+
   // TODO(mmenke): Does it really make sense to run |delegate_| and
   // CookieChanged callbacks when the CookieStore is destroyed?
   for (CookieMap::iterator cookie_it = cookies_.begin();
@@ -1120,9 +1174,8 @@ CookieList CookieMonster::GetCookieListWithOptions(
   if (!HasCookieableScheme(url))
     return cookies;
 
-  std::vector<CanonicalCookie*> cookie_ptrs;
-  FindCookiesForHostAndDomain(url, options, &cookie_ptrs);
-  std::sort(cookie_ptrs.begin(), cookie_ptrs.end(), CookieSorter);
+  const std::vector<CanonicalCookie*>& cookie_ptrs =
+      FindCachedCookieLine(url, options).cookies;
 
   cookies.reserve(cookie_ptrs.size());
   for (std::vector<CanonicalCookie*>::const_iterator it = cookie_ptrs.begin();
@@ -1196,11 +1249,8 @@ std::string CookieMonster::GetCookiesWithOptions(const GURL& url,
   if (!HasCookieableScheme(url))
     return std::string();
 
-  std::vector<CanonicalCookie*> cookies;
-  FindCookiesForHostAndDomain(url, options, &cookies);
-  std::sort(cookies.begin(), cookies.end(), CookieSorter);
-
-  std::string cookie_line = BuildCookieLine(cookies);
+  const std::string& cookie_line =
+      FindCachedCookieLine(url, options).cookie_line;
 
   VLOG(kVlogGetCookies) << "GetCookies() result: " << cookie_line;
 
@@ -1573,16 +1623,20 @@ void CookieMonster::FindCookiesForHostAndDomain(
 
   // Can just dispatch to FindCookiesForKey
   const std::string key(GetKey(url.host()));
-  FindCookiesForKey(key, url, options, current_time, cookies);
+  FindCookiesForKey(key, url, options, current_time, cookies, nullptr);
 }
 
 void CookieMonster::FindCookiesForKey(const std::string& key,
                                       const GURL& url,
                                       const CookieOptions& options,
                                       const Time& current,
-                                      std::vector<CanonicalCookie*>* cookies) {
+                                      std::vector<CanonicalCookie*>* cookies,
+                                      Time* earliest_expiry) {
   DCHECK(thread_checker_.CalledOnValidThread());
 
+  if (earliest_expiry)
+    *earliest_expiry = Time();
+
   for (CookieMapItPair its = cookies_.equal_range(key);
        its.first != its.second;) {
     CookieMap::iterator curit = its.first;
@@ -1595,6 +1649,11 @@ void CookieMonster::FindCookiesForKey(const std::string& key,
       continue;
     }
 
+    if (earliest_expiry && cc->IsPersistent() &&
+        (earliest_expiry->is_null() || cc->ExpiryDate() < *earliest_expiry)) {
+      *earliest_expiry = cc->ExpiryDate();
+    }
+
     // Filter out cookies that should not be included for a request to the
     // given |url|. HTTP only cookies are filtered depending on the passed
     // cookie |options|.
@@ -1610,6 +1669,149 @@ void CookieMonster::FindCookiesForKey(const std::string& key,
   }
 }
 
+const CookieMonster::CachedCookieLine& CookieMonster::FindCachedCookieLine(
+    const GURL& url,
+    const CookieOptions& options) {
+  DCHECK(thread_checker_.CalledOnValidThread());
+
+  const Time current_time(CurrentTime());
+  RecordPeriodicStats(current_time);
+
+  const std::string key(GetKey(url.host()));
+  const std::string request_key(GetCookieLineCacheKey(url, options));
+
+  CookieLineCache::iterator lines_it = cookie_line_cache_.find(key);
+  if (lines_it != cookie_line_cache_.end()) {
+    CookieLinesForKey::iterator line_it = lines_it->second.find(request_key);
+    if (line_it != lines_it->second.end()) {
+      CachedCookieLine& line = line_it->second;
+      // No cookie under |key| has changed since |line| was built, so the only
+      // way it can be stale is if one of them has since expired.
+      if (line.earliest_expiry.is_null() ||
+          current_time < line.earliest_expiry) {
+        if (options.update_access_time()) {
+          for (CanonicalCookie* cc : line.cookies)
+            InternalUpdateCookieAccessTime(cc, current_time);
+        }
+        return line;
+      }
+      // Deleting the expired cookies below drops the whole entry for |key|.
+    }
+  }
+
+  CachedCookieLine line;
+  FindCookiesForKey(key, url, options, current_time, &line.cookies,
+                    &line.earliest_expiry);
+  std::sort(line.cookies.begin(), line.cookies.end(), CookieSorter);
+  line.cookie_line = BuildCookieLine(line.cookies);
+
+  // Reads only run once the cookies for |key| have been loaded, so this is
+  // the point at which a snapshot of them can first be published. Any later
+  // change to them goes through InvalidateCachesForKey().
+  if (concurrent_reader_ && !concurrent_reader_->HasSnapshot(key))
+    PublishSnapshot(key);
+
+  if (cookie_line_cache_size_ >= kMaxCachedCookieLines) {
+    cookie_line_cache_.clear();
+    cookie_line_cache_size_ = 0;
+  }
+
+  CookieLinesForKey& lines = cookie_line_cache_[key];
+  std::pair<CookieLinesForKey::iterator, bool> inserted =
+      lines.insert(std::make_pair(request_key, CachedCookieLine()));
+  if (inserted.second)
+    ++cookie_line_cache_size_;
+  CachedCookieLine& cached_line = inserted.first->second;
+  cached_line.cookies.swap(line.cookies);
+  cached_line.cookie_line.swap(line.cookie_line);
+  cached_line.earliest_expiry = line.earliest_expiry;
+  return cached_line;
+}
+
+// static
+std::string CookieMonster::GetCookieLineCacheKey(const GURL& url,
+                                                 const CookieOptions& options) {
+  // Host and path are the only parts of |url| that cookie matching looks at
+  // besides whether the scheme is cryptographic; see
+  // CanonicalCookie::IncludeForRequestURL().
+  return base::StringPrintf(
+      "%d%d%d%s%s", url.SchemeIsCryptographic() ? 1 : 0,
+      options.exclude_httponly() ? 1 : 0,
+      static_cast<int>(options.same_site_cookie_mode()), url.host().c_str(),
+      url.path().c_str());
+}
+
+void CookieMonster::InvalidateCachesForKey(const std::string& key) {
+  DCHECK(thread_checker_.CalledOnValidThread());
+
+  CookieLineCache::iterator it = cookie_line_cache_.find(key);
+  if (it != cookie_line_cache_.end()) {
+    DCHECK_GE(cookie_line_cache_size_, it->second.size());
+    cookie_line_cache_size_ -= it->second.size();
+    cookie_line_cache_.erase(it);
+  }
+
+  if (!concurrent_reader_ || !concurrent_reader_->Withdraw(key))
+    return;
+
+  ScheduleRepublish(key);
+}
+
+void CookieMonster::ScheduleRepublish(const std::string& key) {
+  DCHECK(thread_checker_.CalledOnValidThread());
+
+  // Batch republishing, so that a garbage collection pass deleting many
+  // cookies under one key copies its cookies only once.
+  keys_to_republish_.insert(key);
+  if (republish_pending_)
+    return;
+  republish_pending_ = true;
+  base::ThreadTaskRunnerHandle::Get()->PostTask(
+      FROM_HERE, base::Bind(&CookieMonster::RepublishSnapshots,
+                            weak_ptr_factory_.GetWeakPtr()));
+}
+
+void CookieMonster::PublishSnapshot(const std::string& key) {
+  DCHECK(thread_checker_.CalledOnValidThread());
+  DCHECK(concurrent_reader_);
+
+  const Time current(Time::Now());
+  std::vector<CanonicalCookie*> cookie_ptrs;
+  Time earliest_expiry;
+  for (CookieMapItPair its = cookies_.equal_range(key);
+       its.first != its.second; ++its.first) {
+    CanonicalCookie* cc = its.first->second;
+    // Expired cookies are deleted the next time the key is read on this
+    // thread; leave them out rather than deleting them from here.
+    if (cc->IsExpired(current))
+      continue;
+    if (cc->IsPersistent() &&
+        (earliest_expiry.is_null() || cc->ExpiryDate() < earliest_expiry)) {
+      earliest_expiry = cc->ExpiryDate();
+    }
+    cookie_ptrs.push_back(cc);
+  }
+  std::sort(cookie_ptrs.begin(), cookie_ptrs.end(), CookieSorter);
+
+  std::vector<CanonicalCookie> cookies;
+  cookies.reserve(cookie_ptrs.size());
+  for (CanonicalCookie* cc : cookie_ptrs)
+    cookies.push_back(*cc);
+
+  concurrent_reader_->Publish(
+      key, new ConcurrentReader::KeySnapshot(&cookies, earliest_expiry));
+}
+
+void CookieMonster::RepublishSnapshots() {
+  DCHECK(thread_checker_.CalledOnValidThread());
+
+  republish_pending_ = false;
+  std::set<std::string> keys;
+  keys.swap(keys_to_republish_);
+  for (const std::string& key : keys)
+    PublishSnapshot(key);
+}
+
 bool CookieMonster::DeleteAnyEquivalentCookie(const std::string& key,
                                               const CanonicalCookie& ecc,
                                               bool skip_httponly,
@@ -1690,6 +1892,7 @@ CookieMonster::CookieMap::iterator CookieMonster::InternalInsertCookie(
     store_->AddCookie(*cc);
   CookieMap::iterator inserted =
       cookies_.insert(CookieMap::value_type(key, cc));
+  InvalidateCachesForKey(key);
   if (delegate_.get()) {
     delegate_->OnCookieChanged(*cc, false,
                                CookieMonsterDelegate::CHANGE_COOKIE_EXPLICIT);
@@ -1834,6 +2037,13 @@ void CookieMonster::InternalUpdateCookieAccessTime(CanonicalCookie* cc,
   cc->SetLastAccessDate(current);
   if ((cc->IsPersistent() || persist_session_cookies_) && store_.get())
     store_->UpdateCookieAccessTime(*cc);
+
+  // The published snapshot still carries the old access time, so concurrent
+  // readers would keep asking for an update until it is replaced. The
+  // snapshot stays readable meanwhile; only the access time is behind.
+  const std::string key(GetKey(cc->Domain()));
+  if (concurrent_reader_ && concurrent_reader_->HasSnapshot(key))
+    ScheduleRepublish(key);
 }
 
 // InternalDeleteCookies must not invalidate iterators other than the one being
@@ -1868,6 +2078,7 @@ void CookieMonster::InternalDeleteCookie(CookieMap::iterator it,
       delegate_->OnCookieChanged(*cc, true, mapping.cause);
   }
   RunCookieChangedCallbacks(*cc, true);
+  InvalidateCachesForKey(it->first);
   cookies_.erase(it);
   delete cc;
 }
@@ -2157,15 +2368,7 @@ size_t CookieMonster::GarbageCollectLeastRecentlyAccessed(
 std::string CookieMonster::GetKey(const std::string& domain) const {
   DCHECK(thread_checker_.CalledOnValidThread());
 
-  std::string effective_domain(
-      registry_controlled_domains::GetDomainAndRegistry(
-          domain, registry_controlled_domains::INCLUDE_PRIVATE_REGISTRIES));
-  if (effective_domain.empty())
-    effective_domain = domain;
-
-  if (!effective_domain.empty() && effective_domain[0] == '.')
-    return effective_domain.substr(1);
-  return effective_domain;
+  return GetKeyForDomain(domain);
 }
 
 bool CookieMonster::HasCookieableScheme(const GURL& url) {
@@ -2400,4 +2603,166 @@ void CookieMonster::RunCookieChangedCallbacks(const CanonicalCookie& cookie,
   }
 }
 
+CookieMonster::ConcurrentReader::KeySnapshot::KeySnapshot(
+    std::vector<CanonicalCookie>* cookies,
+    base::Time earliest_expiry)
+    : earliest_expiry_(earliest_expiry), access_time_update_claimed_(0) {
+  cookies_.swap(*cookies);
+}
+
+CookieMonster::ConcurrentReader::KeySnapshot::~KeySnapshot() {}
+
+bool CookieMonster::ConcurrentReader::KeySnapshot::ClaimAccessTimeUpdate()
+    const {
+  return base::subtle::NoBarrier_CompareAndSwap(&access_time_update_claimed_,
+                                                0, 1) == 0;
+}
+
+CookieMonster::ConcurrentReader::Shard::Shard() {}
+
+CookieMonster::ConcurrentReader::Shard::~Shard() {}
+
+CookieMonster::ConcurrentReader::ConcurrentReader(
+    const base::WeakPtr<CookieMonster>& cookie_monster,
+    const scoped_refptr<base::SingleThreadTaskRunner>& task_runner,
+    const std::vector<std::string>& cookieable_schemes,
+    base::TimeDelta last_access_threshold)
+    : cookie_monster_(cookie_monster),
+      task_runner_(task_runner),
+      cookieable_schemes_(cookieable_schemes),
+      last_access_threshold_(last_access_threshold) {}
+
+CookieMonster::ConcurrentReader::~ConcurrentReader() {}
+
+bool CookieMonster::ConcurrentReader::GetCookiesWithOptions(
+    const GURL& url,
+    const CookieOptions& options,
+    std::string* cookie_line) {
+  scoped_refptr<const KeySnapshot> snapshot;
+  std::vector<const CanonicalCookie*> included;
+  if (!FindCookies(url, options, &snapshot, &included))
+    return false;
+
+  // |snapshot->cookies()| is already in CookieSorter order.
+  *cookie_line = BuildCookieLine(included);
+  return true;
+}
+
+bool CookieMonster::ConcurrentReader::GetCookieListWithOptions(
+    const GURL& url,
+    const CookieOptions& options,
+    CookieList* cookie_list) {
+  scoped_refptr<const KeySnapshot> snapshot;
+  std::vector<const CanonicalCookie*> included;
+  if (!FindCookies(url, options, &snapshot, &included))
+    return false;
+
+  cookie_list->clear();
+  cookie_list->reserve(included.size());
+  for (const CanonicalCookie* cc : included)
+    cookie_list->push_back(*cc);
+  return true;
+}
+
+bool CookieMonster::ConcurrentReader::FindCookies(
+    const GURL& url,
+    const CookieOptions& options,
+    scoped_refptr<const KeySnapshot>* snapshot,
+    std::vector<const CanonicalCookie*>* included) {
+  bool cookieable = false;
+  for (const std::string& scheme : cookieable_schemes_) {
+    if (url.SchemeIs(scheme.c_str())) {
+      cookieable = true;
+      break;
+    }
+  }
+  if (!cookieable)
+    return true;
+
+  const std::string key(GetKeyForDomain(url.host()));
+  {
+    Shard* shard = GetShard(key);
+    base::AutoLock auto_lock(shard->lock);
+    SnapshotMap::const_iterator it = shard->snapshots.find(key);
+    if (it == shard->snapshots.end())
+      return false;
+    *snapshot = it->second;
+  }
+
+  // Deleting expired cookies is a write, so leave it to the CookieMonster.
+  const Time current(Time::Now());
+  if (!(*snapshot)->earliest_expiry().is_null() &&
+      current >= (*snapshot)->earliest_expiry()) {
+    return false;
+  }
+
+  bool access_time_stale = false;
+  for (const CanonicalCookie& cc : (*snapshot)->cookies()) {
+    if (!cc.IncludeForRequestURL(url, options))
+      continue;
+    if ((current - cc.LastAccessDate()) >= last_access_threshold_)
+      access_time_stale = true;
+    included->push_back(&cc);
+  }
+
+  if (access_time_stale && options.update_access_time() &&
+      (*snapshot)->ClaimAccessTimeUpdate()) {
+    task_runner_->PostTask(
+        FROM_HERE,
+        base::Bind(&CookieMonster::GetCookiesWithOptionsAsync, cookie_monster_,
+                   url, options, GetCookiesCallback()));
+  }
+  return true;
+}
+
+void CookieMonster::ConcurrentReader::Publish(
+    const std::string& key,
+    const scoped_refptr<const KeySnapshot>& snapshot) {
+  DCHECK(task_runner_->BelongsToCurrentThread());
+
+  Shard* shard = GetShard(key);
+  base::AutoLock auto_lock(shard->lock);
+  shard->snapshots[key] = snapshot;
+}
+
+bool CookieMonster::ConcurrentReader::Withdraw(const std::string& key) {
+  DCHECK(task_runner_->BelongsToCurrentThread());
+
+  scoped_refptr<const KeySnapshot> withdrawn;
+  Shard* shard = GetShard(key);
+  {
+    base::AutoLock auto_lock(shard->lock);
+    SnapshotMap::iterator it = shard->snapshots.find(key);
+    if (it == shard->snapshots.end())
+      return false;
+    // Release the last reference, if any, outside the lock.
+    withdrawn.swap(it->second);
+    shard->snapshots.erase(it);
+  }
+  return true;
+}
+
+bool CookieMonster::ConcurrentReader::HasSnapshot(const std::string& key) {
+  DCHECK(task_runner_->BelongsToCurrentThread());
+
+  Shard* shard = GetShard(key);
+  base::AutoLock auto_lock(shard->lock);
+  return shard->snapshots.find(key) != shard->snapshots.end();
+}
+
+void CookieMonster::ConcurrentReader::WithdrawAll() {
+  DCHECK(task_runner_->BelongsToCurrentThread());
+
+  for (Shard& shard : shards_) {
+    SnapshotMap withdrawn;
+    base::AutoLock auto_lock(shard.lock);
+    withdrawn.swap(shard.snapshots);
+  }
+}
+
+CookieMonster::ConcurrentReader::Shard*
+CookieMonster::ConcurrentReader::GetShard(const std::string& key) {
+  return &shards_[std::hash<std::string>()(key) % kNumShards];
+}
+
 }  // namespace net
@@ -16,15 +16,18 @@
 #include <queue>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "base/atomicops.h"
 #include "base/callback_forward.h"
 #include "base/gtest_prod_util.h"
 #include "base/macros.h"
 #include "base/memory/linked_ptr.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/weak_ptr.h"
+#include "base/synchronization/lock.h"
 #include "base/threading/thread_checker.h"
 #include "base/time/time.h"
 #include "net/base/net_export.h"
@@ -35,6 +38,7 @@
 
 namespace base {
 class HistogramBase;
+class SingleThreadTaskRunner;
 }  // namespace base
 
 namespace net {
@@ -60,6 +64,7 @@ class CookieMonsterDelegate;
 //  - Verify that our domain enforcement and non-dotted handling is correct
 class NET_EXPORT CookieMonster : public CookieStore {
  public:
+  class ConcurrentReader;
   class PersistentCookieStore;
 
   // Terminology:
@@ -171,6 +176,9 @@ class NET_EXPORT CookieMonster : public CookieStore {
       const GURL& url,
       const CookieOptions& options,
       const GetCookieListCallback& callback) override;
+  bool GetCookieListWithOptionsIfAvailable(const GURL& url,
+                                           const CookieOptions& options,
+                                           CookieList* cookie_list) override;
   void GetAllCookiesAsync(const GetCookieListCallback& callback) override;
   void DeleteCookieAsync(const GURL& url,
                          const std::string& cookie_name,
@@ -214,6 +222,12 @@ class NET_EXPORT CookieMonster : public CookieStore {
 
   bool IsEphemeral() override;
 
+  // Returns the reader through which GetCookiesWithOptions() can be served on
+  // other threads; see ConcurrentReader. Snapshots are only published once
+  // this has been called, so CookieMonsters that are only used from their own
+  // thread pay nothing for them.
+  scoped_refptr<ConcurrentReader> GetConcurrentReader();
+
  private:
   // For queueing the cookie monster calls.
   class CookieMonsterTask;
@@ -381,6 +395,31 @@ class NET_EXPORT CookieMonster : public CookieStore {
   // Record statistics every kRecordStatisticsIntervalSeconds of uptime.
   static const int kRecordStatisticsIntervalSeconds = 10 * 60;
 
+  // Upper bound on the number of entries in |cookie_line_cache_|, summed over
+  // all keys. When it is reached the whole cache is dropped.
+  static const size_t kMaxCachedCookieLines = 1000;
+
+  // The result of FindCookiesForKey() for one request, already sorted with
+  // CookieSorter. Cached per CookieMap key so that any insertion or deletion
+  // of a cookie under that key drops every result that may have observed it.
+  struct CachedCookieLine {
+    CachedCookieLine();
+    ~CachedCookieLine();
+
+    std::vector<CanonicalCookie*> cookies;
+    std::string cookie_line;
+    // Earliest expiry of any cookie under the key when the entry was built.
+    // Null if none of them expire. Once reached, FindCookiesForKey() would
+    // start deleting cookies, so the entry must be recomputed.
+    base::Time earliest_expiry;
+  };
+
+  // Maps from a string identifying the request (see GetCookieLineCacheKey())
+  // to its cached result.
+  typedef std::unordered_map<std::string, CachedCookieLine> CookieLinesForKey;
+  // Maps from a CookieMap key to the cached results for requests under it.
+  typedef std::unordered_map<std::string, CookieLinesForKey> CookieLineCache;
+
   // The following are synchronous calls to which the asynchronous methods
   // delegate either immediately (if the store is loaded) or through a deferred
   // task (if the store is not yet loaded).
@@ -480,11 +519,44 @@ class NET_EXPORT CookieMonster : public CookieStore {
                                    const CookieOptions& options,
                                    std::vector<CanonicalCookie*>* cookies);
 
+  // |earliest_expiry|, if non-NULL, is set to the earliest expiry date of the
+  // cookies left under |key| after expired ones have been deleted, or to a
+  // null time if none of them expire.
   void FindCookiesForKey(const std::string& key,
                          const GURL& url,
                          const CookieOptions& options,
                          const base::Time& current,
-                         std::vector<CanonicalCookie*>* cookies);
+                         std::vector<CanonicalCookie*>* cookies,
+                         base::Time* earliest_expiry);
+
+  // Returns the sorted cookies and cookie line for |url| and |options|,
+  // reusing the result of a previous identical request when no cookie under
+  // the same key has changed or expired since. The returned entry is owned by
+  // |cookie_line_cache_| and is only valid until the next mutation of
+  // |cookies_|.
+  const CachedCookieLine& FindCachedCookieLine(const GURL& url,
+                                               const CookieOptions& options);
+
+  // Returns the string identifying a request for |url| with |options| among
+  // the other cached requests under the same CookieMap key. It covers exactly
+  // the inputs of CanonicalCookie::IncludeForRequestURL().
+  static std::string GetCookieLineCacheKey(const GURL& url,
+                                           const CookieOptions& options);
+
+  // Drops all cached results for CookieMap key |key|, and withdraws its
+  // snapshot from |concurrent_reader_| until RepublishSnapshots() runs.
+  void InvalidateCachesForKey(const std::string& key);
+
+  // Publishes the current cookies under CookieMap key |key| to
+  // |concurrent_reader_|.
+  void PublishSnapshot(const std::string& key);
+
+  // Adds |key| to |keys_to_republish_|, and posts RepublishSnapshots() if it
+  // is not pending already.
+  void ScheduleRepublish(const std::string& key);
+
+  // Publishes new snapshots for the keys in |keys_to_republish_|.
+  void RepublishSnapshots();
 
   // Delete any cookies that are equivalent to |ecc| (same path, domain, etc).
   // If |skip_httponly| is true, httponly cookies will not be deleted.  The
@@ -642,6 +714,20 @@ class NET_EXPORT CookieMonster : public CookieStore {
 
   CookieMap cookies_;
 
+  // Results of recent GetCookiesWithOptions() and GetCookieListWithOptions()
+  // calls, grouped by CookieMap key. Entries for a key are dropped by
+  // InternalInsertCookie() and InternalDeleteCookie().
+  CookieLineCache cookie_line_cache_;
+  size_t cookie_line_cache_size_;
+
+  // Null until GetConcurrentReader() is first called.
+  scoped_refptr<ConcurrentReader> concurrent_reader_;
+
+  // Keys whose snapshot was withdrawn by a mutation, and whether a task to
+  // republish them has been posted.
+  std::set<std::string> keys_to_republish_;
+  bool republish_pending_;
+
   // Indicates whether the cookie store has been initialized.
   bool initialized_;
 
@@ -753,6 +839,118 @@ class NET_EXPORT CookieMonsterDelegate
   virtual ~CookieMonsterDelegate() {}
 };
 
+// Serves GetCookiesWithOptions() for a CookieMonster on any thread, without
+// posting to the thread the CookieMonster lives on.
+//
+// Once a key (eTLD+1) has been loaded and read on the CookieMonster's thread,
+// the CookieMonster publishes an immutable snapshot of the cookies under it.
+// Any insertion or deletion under the key withdraws the snapshot before the
+// mutating call returns, and a fresh one is published from a posted task.
+// Writes therefore stay serialized on the CookieMonster's thread, and a read
+// never observes a snapshot older than the last completed write.
+//
+// Snapshots are sharded by key, and each shard's lock is only held long
+// enough to take a reference to the snapshot; matching and building the
+// cookie line happen outside it.
+class NET_EXPORT CookieMonster::ConcurrentReader
+    : public base::RefCountedThreadSafe<ConcurrentReader> {
+ public:
+  // May be called on any thread. Returns true and sets |cookie_line| if the
+  // request could be answered from a snapshot. Returns false if there is no
+  // snapshot for the key of |url| or if a cookie in it has since expired; the
+  // caller must then use CookieMonster::GetCookiesWithOptionsAsync().
+  //
+  // Access times are not updated in place. If |options| asks for them and
+  // one of the returned cookies is due for an update, the read is replayed on
+  // the CookieMonster's thread with a null callback.
+  bool GetCookiesWithOptions(const GURL& url,
+                             const CookieOptions& options,
+                             std::string* cookie_line);
+
+  // Same as GetCookiesWithOptions(), but returns the cookies themselves.
+  bool GetCookieListWithOptions(const GURL& url,
+                                const CookieOptions& options,
+                                CookieList* cookie_list);
+
+ private:
+  friend class base::RefCountedThreadSafe<ConcurrentReader>;
+  friend class CookieMonster;
+
+  // The unexpired cookies under one key, sorted with CookieSorter.
+  class KeySnapshot : public base::RefCountedThreadSafe<KeySnapshot> {
+   public:
+    KeySnapshot(std::vector<CanonicalCookie>* cookies,
+                base::Time earliest_expiry);
+
+    const std::vector<CanonicalCookie>& cookies() const { return cookies_; }
+    // Null if none of the cookies expire.
+    base::Time earliest_expiry() const { return earliest_expiry_; }
+
+    // Returns true only for the first caller, which is the one to ask the
+    // CookieMonster to update the access times of these cookies. Until the
+    // snapshot is replaced, later readers find the same stale access times.
+    bool ClaimAccessTimeUpdate() const;
+
+   private:
+    friend class base::RefCountedThreadSafe<KeySnapshot>;
+    ~KeySnapshot();
+
+    std::vector<CanonicalCookie> cookies_;
+    const base::Time earliest_expiry_;
+    mutable base::subtle::Atomic32 access_time_update_claimed_;
+
+    DISALLOW_COPY_AND_ASSIGN(KeySnapshot);
+  };
+
+  typedef std::unordered_map<std::string, scoped_refptr<const KeySnapshot>>
+      SnapshotMap;
+
+  struct Shard {
+    Shard();
+    ~Shard();
+
+    base::Lock lock;
+    SnapshotMap snapshots;
+  };
+
+  static const size_t kNumShards = 16;
+
+  ConcurrentReader(
+      const base::WeakPtr<CookieMonster>& cookie_monster,
+      const scoped_refptr<base::SingleThreadTaskRunner>& task_runner,
+      const std::vector<std::string>& cookieable_schemes,
+      base::TimeDelta last_access_threshold);
+  ~ConcurrentReader();
+
+  // The following are only called on the CookieMonster's thread.
+  void Publish(const std::string& key,
+               const scoped_refptr<const KeySnapshot>& snapshot);
+  // Returns true if a snapshot for |key| was published.
+  bool Withdraw(const std::string& key);
+  bool HasSnapshot(const std::string& key);
+  void WithdrawAll();
+
+  // Shared by the two getters above. On success, |included| points into
+  // |*snapshot|, which holds them alive.
+  bool FindCookies(const GURL& url,
+                   const CookieOptions& options,
+                   scoped_refptr<const KeySnapshot>* snapshot,
+                   std::vector<const CanonicalCookie*>* included);
+
+  Shard* GetShard(const std::string& key);
+
+  const base::WeakPtr<CookieMonster> cookie_monster_;
+  const scoped_refptr<base::SingleThreadTaskRunner> task_runner_;
+  // Copied from the CookieMonster, which does not allow changing them once
+  // it is in use.
+  const std::vector<std::string> cookieable_schemes_;
+  const base::TimeDelta last_access_threshold_;
+
+  Shard shards_[kNumShards];
+
+  DISALLOW_COPY_AND_ASSIGN(ConcurrentReader);
+};
+
 typedef base::RefCountedThreadSafe<CookieMonster::PersistentCookieStore>
     RefcountedPersistentCookieStore;
 
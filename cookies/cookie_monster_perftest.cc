@@ -280,6 +280,49 @@ TEST_F(CookieMonsterTest, TestDomainLine) {
   timer2.Done();
 }
 
+// Queries a host whose eTLD+1 carries as many cookies as domain garbage
+// collection allows, the case where rebuilding the cookie line for every
+// request is most expensive.
+TEST_F(CookieMonsterTest, TestQueryHostWithManyCookies) {
+  std::unique_ptr<CookieMonster> cm(new CookieMonster(nullptr, nullptr));
+  SetCookieCallback setCookieCallback;
+  GetCookiesCallback getCookiesCallback;
+  const size_t kCookiesPerHost = CookieMonster::kDomainMaxCookies;
+
+  for (size_t i = 0; i < kCookiesPerHost; ++i) {
+    const std::string cookie = base::StringPrintf(
+        "a%03d=b; domain=many.izzle; path=/%s", static_cast<int>(i),
+        i % 2 ? "" : "dir");
+    setCookieCallback.SetCookie(cm.get(), GURL("https://www.many.izzle/dir/"),
+                                cookie);
+  }
+
+  GURL root_gurl("https://www.many.izzle/");
+  GURL dir_gurl("https://www.many.izzle/dir/page");
+  EXPECT_EQ(static_cast<int>(kCookiesPerHost / 2),
+            CountInString(getCookiesCallback.GetCookies(cm.get(), root_gurl),
+                          '='));
+  EXPECT_EQ(static_cast<int>(kCookiesPerHost),
+            CountInString(getCookiesCallback.GetCookies(cm.get(), dir_gurl),
+                          '='));
+
+  base::PerfTimeLogger timer("Cookie_monster_query_host_with_many_cookies");
+  for (int i = 0; i < kNumCookies; i++)
+    getCookiesCallback.GetCookies(cm.get(), i % 2 ? root_gurl : dir_gurl);
+  timer.Done();
+
+  // Interleave a write to the same eTLD+1 with every query, so that every
+  // query has to rebuild its cookie line.
+  base::PerfTimeLogger timer2(
+      "Cookie_monster_query_host_with_many_cookies_after_set");
+  for (int i = 0; i < kNumCookies; i++) {
+    setCookieCallback.SetCookie(cm.get(), root_gurl,
+                                "a000=c; domain=many.izzle; path=/dir");
+    getCookiesCallback.GetCookies(cm.get(), dir_gurl);
+  }
+  timer2.Done();
+}
+
 TEST_F(CookieMonsterTest, TestImport) {
   scoped_refptr<MockPersistentCookieStore> store(new MockPersistentCookieStore);
   std::vector<CanonicalCookie*> initial_cookies;
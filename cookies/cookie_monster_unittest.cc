@@ -13,8 +13,10 @@
 #include "base/location.h"
 #include "base/memory/ptr_util.h"
 #include "base/memory/ref_counted.h"
+#include "base/message_loop/message_loop.h"
 #include "base/metrics/histogram.h"
 #include "base/metrics/histogram_samples.h"
+#include "base/pending_task.h"
 #include "base/run_loop.h"
 #include "base/single_thread_task_runner.h"
 #include "base/strings/string_number_conversions.h"
@@ -1756,6 +1758,179 @@ TEST_F(CookieMonsterTest, CookieSorting) {
   EXPECT_EQ("A1", cookies[5].Value());
 }
 
+// Repeated reads of the same URL are served from the cookie line cache; check
+// that every change to the cookies under its eTLD+1 is still observed.
+TEST_F(CookieMonsterTest, CachedCookieLineInvalidation) {
+  std::unique_ptr<CookieMonster> cm(new CookieMonster(nullptr, nullptr));
+  GURL url_foo(http_www_google_.AppendPath("foo"));
+  GURL url_other_host(http_www_google_.Format("http://other.%D/"));
+
+  EXPECT_TRUE(SetCookie(cm.get(), http_www_google_.url(), "A=1"));
+  EXPECT_EQ("A=1", GetCookies(cm.get(), http_www_google_.url()));
+  EXPECT_EQ("A=1", GetCookies(cm.get(), http_www_google_.url()));
+
+  // A cookie set from another host under the same eTLD+1.
+  EXPECT_TRUE(SetCookie(cm.get(), url_other_host,
+                        http_www_google_.Format("B=2; domain=.%D")));
+  EXPECT_EQ("A=1; B=2", GetCookies(cm.get(), http_www_google_.url()));
+
+  // Requests differing only in path or scheme are cached separately.
+  EXPECT_TRUE(SetCookie(cm.get(), url_foo, "C=3; path=/foo"));
+  EXPECT_TRUE(SetCookie(cm.get(), https_www_google_.url(), "D=4; secure"));
+  EXPECT_EQ("A=1; B=2", GetCookies(cm.get(), http_www_google_.url()));
+  EXPECT_EQ("C=3; A=1; B=2", GetCookies(cm.get(), url_foo));
+  EXPECT_EQ("A=1; B=2; D=4", GetCookies(cm.get(), https_www_google_.url()));
+
+  // Overwriting and deleting are both observed.
+  EXPECT_TRUE(SetCookie(cm.get(), http_www_google_.url(), "A=5"));
+  EXPECT_EQ("C=3; B=2; A=5", GetCookies(cm.get(), url_foo));
+  DeleteCookie(cm.get(), url_other_host, "B");
+  EXPECT_EQ("C=3; A=5", GetCookies(cm.get(), url_foo));
+  EXPECT_EQ("A=5", GetCookies(cm.get(), http_www_google_.url()));
+  EXPECT_EQ(3, DeleteAll(cm.get()));
+  EXPECT_EQ("", GetCookies(cm.get(), url_foo));
+}
+
+TEST_F(CookieMonsterTest, ConcurrentReaderSnapshots) {
+  std::unique_ptr<CookieMonster> cm(new CookieMonster(nullptr, nullptr));
+  scoped_refptr<CookieMonster::ConcurrentReader> reader =
+      cm->GetConcurrentReader();
+  CookieOptions options;
+  std::string cookie_line;
+
+  EXPECT_TRUE(SetCookie(cm.get(), http_www_google_.url(), "A=1"));
+  // Nothing is published for a key until it has been read on the
+  // CookieMonster's thread.
+  EXPECT_FALSE(reader->GetCookiesWithOptions(http_www_google_.url(), options,
+                                             &cookie_line));
+  EXPECT_EQ("A=1", GetCookies(cm.get(), http_www_google_.url()));
+  EXPECT_TRUE(reader->GetCookiesWithOptions(http_www_google_.url(), options,
+                                            &cookie_line));
+  EXPECT_EQ("A=1", cookie_line);
+
+  // A write withdraws the snapshot before it completes, and the new one is
+  // published asynchronously.
+  EXPECT_TRUE(SetCookie(cm.get(), http_www_google_.url(), "B=2"));
+  EXPECT_FALSE(reader->GetCookiesWithOptions(http_www_google_.url(), options,
+                                             &cookie_line));
+  base::RunLoop().RunUntilIdle();
+  EXPECT_TRUE(reader->GetCookiesWithOptions(http_www_google_.url(), options,
+                                            &cookie_line));
+  EXPECT_EQ("A=1; B=2", cookie_line);
+
+  // Reads from another thread see the same snapshot.
+  base::Thread other_thread("ConcurrentReaderSnapshots");
+  ASSERT_TRUE(other_thread.Start());
+  cookie_line.clear();
+  other_thread.task_runner()->PostTask(
+      FROM_HERE,
+      base::Bind(base::IgnoreResult(
+                     &CookieMonster::ConcurrentReader::GetCookiesWithOptions),
+                 reader, http_www_google_.url(), options, &cookie_line));
+  other_thread.Stop();
+  EXPECT_EQ("A=1; B=2", cookie_line);
+
+  // Non-cookieable schemes are answered without a snapshot.
+  EXPECT_TRUE(reader->GetCookiesWithOptions(GURL("ftp://ftp.google.izzle/"),
+                                            options, &cookie_line));
+  EXPECT_EQ("", cookie_line);
+
+  // Once the CookieMonster is gone, readers must fall back.
+  cm.reset();
+  EXPECT_FALSE(reader->GetCookiesWithOptions(http_www_google_.url(), options,
+                                             &cookie_line));
+}
+
+// Counts the tasks run by the current MessageLoop while it is alive.
+class TaskCounter : public base::MessageLoop::TaskObserver {
+ public:
+  TaskCounter() : count_(0) {
+    base::MessageLoop::current()->AddTaskObserver(this);
+  }
+  ~TaskCounter() override {
+    base::MessageLoop::current()->RemoveTaskObserver(this);
+  }
+
+  int count() const { return count_; }
+
+  // base::MessageLoop::TaskObserver:
+  void WillProcessTask(const base::PendingTask& pending_task) override {
+    count_++;
+  }
+  void DidProcessTask(const base::PendingTask& pending_task) override {}
+
+ private:
+  int count_;
+
+  DISALLOW_COPY_AND_ASSIGN(TaskCounter);
+};
+
+TEST_F(CookieMonsterTest, ConcurrentReaderAccessTime) {
+  std::unique_ptr<CookieMonster> cm(
+      new CookieMonster(nullptr, nullptr, kLastAccessThreshold));
+  scoped_refptr<CookieMonster::ConcurrentReader> reader =
+      cm->GetConcurrentReader();
+  CookieOptions options;
+  std::string cookie_line;
+
+  EXPECT_TRUE(SetCookie(cm.get(), http_www_google_.url(), "A=B"));
+  EXPECT_EQ("A=B", GetCookies(cm.get(), http_www_google_.url()));
+  const Time last_access_date(GetFirstCookieAccessDate(cm.get()));
+
+  // Once the threshold has passed, any number of reads of the snapshot ask
+  // for a single access time update.
+  base::PlatformThread::Sleep(kAccessDelay);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_TRUE(reader->GetCookiesWithOptions(http_www_google_.url(), options,
+                                              &cookie_line));
+    EXPECT_EQ("A=B", cookie_line);
+  }
+  {
+    TaskCounter counter;
+    base::RunLoop().RunUntilIdle();
+    // The update, and the publication of a snapshot with the new access time.
+    EXPECT_EQ(2, counter.count());
+  }
+  EXPECT_NE(last_access_date, GetFirstCookieAccessDate(cm.get()));
+
+  // The new snapshot is within the threshold again.
+  for (int i = 0; i < 3; i++) {
+    EXPECT_TRUE(reader->GetCookiesWithOptions(http_www_google_.url(), options,
+                                              &cookie_line));
+    EXPECT_EQ("A=B", cookie_line);
+  }
+  {
+    TaskCounter counter;
+    base::RunLoop().RunUntilIdle();
+    EXPECT_EQ(0, counter.count());
+  }
+}
+
+TEST_F(CookieMonsterTest, GetCookieListWithOptionsIfAvailable) {
+  std::unique_ptr<CookieMonster> cm(new CookieMonster(nullptr, nullptr));
+  CookieOptions options;
+  CookieList cookie_list;
+
+  EXPECT_TRUE(SetCookie(cm.get(), http_www_google_.url(), "A=B"));
+  // Nothing has been read since the reader was created, so there is no
+  // snapshot to answer from yet.
+  EXPECT_FALSE(cm->GetCookieListWithOptionsIfAvailable(http_www_google_.url(),
+                                                       options, &cookie_list));
+  EXPECT_TRUE(cookie_list.empty());
+
+  EXPECT_EQ("A=B", GetCookies(cm.get(), http_www_google_.url()));
+  EXPECT_TRUE(cm->GetCookieListWithOptionsIfAvailable(http_www_google_.url(),
+                                                      options, &cookie_list));
+  ASSERT_EQ(1u, cookie_list.size());
+  EXPECT_EQ("A", cookie_list[0].Name());
+  EXPECT_EQ("B", cookie_list[0].Value());
+
+  // Non-cookieable schemes are answered with nothing.
+  EXPECT_TRUE(cm->GetCookieListWithOptionsIfAvailable(
+      GURL("foo://www.google.izzle"), options, &cookie_list));
+  EXPECT_TRUE(cookie_list.empty());
+}
+
 TEST_F(CookieMonsterTest, DeleteCookieByName) {
   std::unique_ptr<CookieMonster> cm(new CookieMonster(nullptr, nullptr));
 
@@ -10,12 +10,21 @@
 
 namespace net {
 
-CookieStore::~CookieStore() {}
+namespace {
 
-std::string CookieStore::BuildCookieLine(
-    const std::vector<CanonicalCookie>& cookies) {
+const CanonicalCookie& AsCookie(const CanonicalCookie& cookie) {
+  return cookie;
+}
+
+const CanonicalCookie& AsCookie(const CanonicalCookie* cookie) {
+  return *cookie;
+}
+
+template <typename Iterator>
+std::string BuildCookieLineFromRange(Iterator first, Iterator last) {
   std::string cookie_line;
-  for (const auto& cookie : cookies) {
+  for (; first != last; ++first) {
+    const CanonicalCookie& cookie = AsCookie(*first);
     if (!cookie_line.empty())
       cookie_line += "; ";
     // In Mozilla, if you set a cookie like "AAA", it will have an empty token
@@ -28,26 +37,36 @@ std::string CookieStore::BuildCookieLine(
   return cookie_line;
 }
 
+}  // namespace
+
+CookieStore::~CookieStore() {}
+
+std::string CookieStore::BuildCookieLine(
+    const std::vector<CanonicalCookie>& cookies) {
+  return BuildCookieLineFromRange(cookies.begin(), cookies.end());
+}
+
 std::string CookieStore::BuildCookieLine(
     const std::vector<CanonicalCookie*>& cookies) {
-  std::string cookie_line;
-  for (auto* cookie : cookies) {
-    if (!cookie_line.empty())
-      cookie_line += "; ";
-    // In Mozilla, if you set a cookie like "AAA", it will have an empty token
-    // and a value of "AAA". When it sends the cookie back, it will send "AAA",
-    // so we need to avoid sending "=AAA" for a blank token value.
-    if (!cookie->Name().empty())
-      cookie_line += cookie->Name() + "=";
-    cookie_line += cookie->Value();
-  }
-  return cookie_line;
+  return BuildCookieLineFromRange(cookies.begin(), cookies.end());
+}
+
+std::string CookieStore::BuildCookieLine(
+    const std::vector<const CanonicalCookie*>& cookies) {
+  return BuildCookieLineFromRange(cookies.begin(), cookies.end());
 }
 
 void CookieStore::DeleteAllAsync(const DeleteCallback& callback) {
   DeleteAllCreatedBetweenAsync(base::Time(), base::Time::Max(), callback);
 }
 
+bool CookieStore::GetCookieListWithOptionsIfAvailable(
+    const GURL& url,
+    const CookieOptions& options,
+    CookieList* cookie_list) {
+  return false;
+}
+
 void CookieStore::SetForceKeepSessionState() {
   // By default, do nothing.
 }
@@ -56,6 +56,8 @@ class NET_EXPORT CookieStore {
       const std::vector<CanonicalCookie>& cookies);
   static std::string BuildCookieLine(
       const std::vector<CanonicalCookie*>& cookies);
+  static std::string BuildCookieLine(
+      const std::vector<const CanonicalCookie*>& cookies);
 
   // Sets the cookies specified by |cookie_list| returned from |url|
   // with options |options| in effect.  Expects a cookie line, like
@@ -123,6 +125,15 @@ class NET_EXPORT CookieStore {
       const CookieOptions& options,
       const GetCookieListCallback& callback) = 0;
 
+  // Like GetCookieListWithOptionsAsync(), but only answers if the store can do
+  // so without queueing the request. Returns true and fills |cookie_list| if
+  // it did; returns false, leaving |cookie_list| untouched, if the caller has
+  // to use GetCookieListWithOptionsAsync() instead. The default implementation
+  // always returns false.
+  virtual bool GetCookieListWithOptionsIfAvailable(const GURL& url,
+                                                   const CookieOptions& options,
+                                                   CookieList* cookie_list);
+
   // Returns all cookies associated with |url|, including http-only, and
   // same-site cookies. The returned cookies are ordered by longest path, then
   // by earliest creation date, and are not marked as having been accessed.
@@ -22,6 +22,7 @@
 #include "net/base/net_errors.h"
 #include "net/base/test_completion_callback.h"
 #include "net/disk_cache/blockfile/backend_impl.h"
+#include "net/disk_cache/blockfile/disk_format.h"
 #include "net/disk_cache/blockfile/entry_impl.h"
 #include "net/disk_cache/blockfile/experiments.h"
 #include "net/disk_cache/blockfile/histogram_macros.h"
@@ -974,6 +975,92 @@ TEST_F(DiskCacheBackendTest, NewEvictionTrim) {
   entry->Close();
 }
 
+// Tests that the index table can grow while the cache is in use.
+TEST_F(DiskCacheBackendTest, GrowIndex) {
+  InitCache();
+  const int kTableLen = 64 * 1024;
+
+  disk_cache::Entry* entry;
+  for (int i = 0; i < 200; i++) {
+    ASSERT_THAT(CreateEntry(base::StringPrintf("Key %d", i), &entry), IsOk());
+    entry->Close();
+  }
+
+  // Split half of the buckets: the entries are now found on either half of
+  // the table, depending on how far the growth went.
+  RunTaskForTest(base::Bind(&disk_cache::BackendImpl::GrowIndexForTest,
+                            base::Unretained(cache_impl_), kTableLen / 2));
+  int64_t index_size;
+  ASSERT_TRUE(base::GetFileSize(cache_path_.AppendASCII("index"), &index_size));
+  EXPECT_EQ(static_cast<int64_t>(sizeof(disk_cache::IndexHeader) +
+                                 2 * kTableLen * sizeof(disk_cache::CacheAddr)),
+            index_size);
+
+  // Code that knows nothing of the growth refuses the file meanwhile.
+  disk_cache::IndexHeader header;
+  ASSERT_EQ(static_cast<int>(sizeof(header)),
+            base::ReadFile(cache_path_.AppendASCII("index"),
+                           reinterpret_cast<char*>(&header), sizeof(header)));
+  EXPECT_TRUE(header.version & disk_cache::kIndexGrowingVersion);
+
+  for (int i = 0; i < 200; i++) {
+    ASSERT_THAT(OpenEntry(base::StringPrintf("Key %d", i), &entry), IsOk());
+    entry->Close();
+  }
+  for (int i = 200; i < 300; i++) {
+    ASSERT_THAT(CreateEntry(base::StringPrintf("Key %d", i), &entry), IsOk());
+    entry->Close();
+  }
+  for (int i = 0; i < 10; i++)
+    ASSERT_THAT(DoomEntry(base::StringPrintf("Key %d", i)), IsOk());
+
+  // Finish the growth.
+  RunTaskForTest(base::Bind(&disk_cache::BackendImpl::GrowIndexForTest,
+                            base::Unretained(cache_impl_), kTableLen));
+  EXPECT_EQ(290, cache_->GetEntryCount());
+  for (int i = 0; i < 10; i++)
+    EXPECT_NE(net::OK, OpenEntry(base::StringPrintf("Key %d", i), &entry));
+  ASSERT_EQ(static_cast<int>(sizeof(header)),
+            base::ReadFile(cache_path_.AppendASCII("index"),
+                           reinterpret_cast<char*>(&header), sizeof(header)));
+  EXPECT_EQ(disk_cache::kCurrentVersion, header.version);
+
+  // The bigger table is used when the cache is opened again.
+  SimulateCrash();
+  for (int i = 10; i < 300; i++) {
+    ASSERT_THAT(OpenEntry(base::StringPrintf("Key %d", i), &entry), IsOk());
+    entry->Close();
+  }
+}
+
+// Tests that a growth of the index table resumes after a restart.
+TEST_F(DiskCacheBackendTest, GrowIndexRestart) {
+  InitCache();
+  const int kTableLen = 64 * 1024;
+
+  disk_cache::Entry* entry;
+  for (int i = 0; i < 200; i++) {
+    ASSERT_THAT(CreateEntry(base::StringPrintf("Key %d", i), &entry), IsOk());
+    entry->Close();
+  }
+  RunTaskForTest(base::Bind(&disk_cache::BackendImpl::GrowIndexForTest,
+                            base::Unretained(cache_impl_), kTableLen / 3));
+  SimulateCrash();
+
+  // The rest of the buckets are split in the background, while the cache
+  // serves requests.
+  for (int i = 0; i < 200; i++) {
+    ASSERT_THAT(OpenEntry(base::StringPrintf("Key %d", i), &entry), IsOk());
+    entry->Close();
+  }
+  for (int i = 200; i < 250; i++) {
+    ASSERT_THAT(CreateEntry(base::StringPrintf("Key %d", i), &entry), IsOk());
+    entry->Close();
+  }
+  FlushQueueForTest();
+  EXPECT_EQ(250, cache_->GetEntryCount());
+}
+
 // Before looking for invalid entries, let's check a valid entry.
 void DiskCacheBackendTest::BackendValidEntry() {
   InitCache();
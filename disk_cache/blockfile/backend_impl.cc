@@ -4,8 +4,12 @@
 
 #include "net/disk_cache/blockfile/backend_impl.h"
 
+#include <string.h>
+
 #include <limits>
+#include <set>
 #include <utility>
+#include <vector>
 
 #include "base/bind.h"
 #include "base/bind_helpers.h"
@@ -13,6 +17,7 @@
 #include "base/files/file_path.h"
 #include "base/files/file_util.h"
 #include "base/hash.h"
+#include "base/lazy_instance.h"
 #include "base/location.h"
 #include "base/metrics/field_trial.h"
 #include "base/metrics/histogram.h"
@@ -56,6 +61,14 @@ const int kBaseTableLen = 64 * 1024;
 // Avoid trimming the cache for the first 5 minutes (10 timer ticks).
 const int kTrimDelay = 10;
 
+// The index table doubles when its load factor goes over 75%, up to the size
+// of the biggest table DesiredIndexTableLen() creates.
+const int kMaxIndexLoad = 75;
+const int kMaxTableLen = kBaseTableLen * 16;
+
+// Number of buckets split by each task while the index table grows.
+const int kIndexGrowthStep = 256;
+
 int DesiredIndexTableLen(int32_t storage_size) {
   if (storage_size <= k64kEntriesStore)
     return kBaseTableLen;
@@ -103,6 +116,25 @@ bool InitExperiment(disk_cache::IndexHeader* header, bool cache_created) {
   return true;
 }
 
+// The maximum total memory for the memory buffers of all the backends. The
+// shards of a cache initialize it from different threads.
+struct BuffersSizeLimit {
+  BuffersSizeLimit() {
+    const int kMaxBuffersSize = 30 * 1024 * 1024;
+
+    // We want to use up to 2% of the computer's memory.
+    int64_t total_memory = base::SysInfo::AmountOfPhysicalMemory() * 2 / 100;
+    if (total_memory > kMaxBuffersSize || total_memory <= 0)
+      total_memory = kMaxBuffersSize;
+    size = static_cast<int>(total_memory);
+  }
+
+  int size;
+};
+
+base::LazyInstance<BuffersSizeLimit>::Leaky g_max_buffers_size =
+    LAZY_INSTANCE_INITIALIZER;
+
 // A callback to perform final cleanup on the background thread.
 void FinalCleanupCallback(disk_cache::BackendImpl* backend) {
   backend->CleanupCache();
@@ -123,6 +155,7 @@ BackendImpl::BackendImpl(
       block_files_(path),
       mask_(0),
       max_size_(0),
+      shard_count_(1),
       up_ticks_(0),
       cache_type_(net::DISK_CACHE),
       uma_report_(0),
@@ -150,6 +183,7 @@ BackendImpl::BackendImpl(
       block_files_(path),
       mask_(mask),
       max_size_(0),
+      shard_count_(1),
       up_ticks_(0),
       cache_type_(net::DISK_CACHE),
       uma_report_(0),
@@ -292,6 +326,13 @@ int BackendImpl::SyncInit() {
     ReportError(ERR_NO_ERROR);
   }
 
+  if (!disabled_ && IsIndexGrowing()) {
+    // The bucket being split when the cache was closed may be half split, so
+    // it goes first, before any lookup.
+    SplitIndexBuckets(1);
+    PostGrowIndexStep();
+  }
+
   FlushIndex();
 
   if (!disabled_ && should_create_timer) {
@@ -528,7 +569,7 @@ EntryImpl* BackendImpl::CreateEntryImpl(const std::string& key) {
   Trace("Create hash 0x%x", hash);
 
   scoped_refptr<EntryImpl> parent;
-  Addr entry_address(data_->table[hash & mask_]);
+  Addr entry_address(data_->table[GetBucket(hash)]);
   if (entry_address.is_initialized()) {
     // We have an entry already. It could be the one we are looking for, or just
     // a hash conflict.
@@ -541,7 +582,7 @@ EntryImpl* BackendImpl::CreateEntryImpl(const std::string& key) {
     DCHECK(!error);
     if (parent_entry) {
       parent.swap(&parent_entry);
-    } else if (data_->table[hash & mask_]) {
+    } else if (data_->table[GetBucket(hash)]) {
       // We should have corrected the problem.
       NOTREACHED();
       return NULL;
@@ -603,7 +644,7 @@ EntryImpl* BackendImpl::CreateEntryImpl(const std::string& key) {
   if (parent.get()) {
     parent->SetNextAddress(entry_address);
   } else {
-    data_->table[hash & mask_] = entry_address.value();
+    data_->table[GetBucket(hash)] = entry_address.value();
   }
 
   // Link this entry through the lists.
@@ -712,6 +753,11 @@ void BackendImpl::SetType(net::CacheType type) {
   cache_type_ = type;
 }
 
+void BackendImpl::SetShardCount(int shard_count) {
+  DCHECK_GT(shard_count, 0);
+  shard_count_ = shard_count;
+}
+
 base::FilePath BackendImpl::GetFileName(Addr address) const {
   if (!address.is_separate_file() || !address.is_initialized()) {
     NOTREACHED();
@@ -798,10 +844,10 @@ void BackendImpl::RecoveredEntry(CacheRankingsBlock* rankings) {
   cache_entry->Release();
 
   // Anything on the table means that this entry is there.
-  if (data_->table[hash & mask_])
+  if (data_->table[GetBucket(hash)])
     return;
 
-  data_->table[hash & mask_] = address.value();
+  data_->table[GetBucket(hash)] = address.value();
   FlushIndex();
 }
 
@@ -829,7 +875,7 @@ void BackendImpl::InternalDoomEntry(EntryImpl* entry) {
     parent_entry->SetNextAddress(Addr(child));
     parent_entry->Release();
   } else if (!error) {
-    data_->table[hash & mask_] = child;
+    data_->table[GetBucket(hash)] = child;
   }
 
   FlushIndex();
@@ -853,7 +899,7 @@ CacheAddr BackendImpl::GetNextAddr(Addr address) {
 
 void BackendImpl::NotLinked(EntryImpl* entry) {
   Addr entry_addr = entry->entry()->address();
-  uint32_t i = entry->GetHash() & mask_;
+  uint32_t i = GetBucket(entry->GetHash());
   Addr address(data_->table[i]);
   if (!address.is_initialized())
     return;
@@ -1114,6 +1160,9 @@ void BackendImpl::OnStatsTimer() {
   // Save stats to disk at 5 min intervals.
   if (time % 10 == 0)
     StoreStats();
+
+  if (ShouldGrowIndex() && StartIndexGrowth())
+    PostGrowIndexStep();
 }
 
 void BackendImpl::IncrementIoCount() {
@@ -1168,6 +1217,12 @@ void BackendImpl::TrimDeletedListForTest(bool empty) {
   eviction_.TrimDeletedList(empty);
 }
 
+void BackendImpl::GrowIndexForTest(int buckets) {
+  if (!IsIndexGrowing() && !StartIndexGrowth())
+    return;
+  SplitIndexBuckets(buckets);
+}
+
 base::RepeatingTimer* BackendImpl::GetTimerForTest() {
   return timer_.get();
 }
@@ -1412,15 +1467,19 @@ void BackendImpl::AdjustMaxCacheSize(int table_len) {
     return;
   }
 
+  // The other shards are assumed to be as large as this one.
   if (table_len)
-    available += data_->header.num_bytes;
+    available += static_cast<int64_t>(data_->header.num_bytes) * shard_count_;
 
-  max_size_ = PreferredCacheSize(available);
+  max_size_ = PreferredCacheSize(available) / shard_count_;
 
   if (!table_len)
     return;
 
-  // If we already have a table, adjust the size to it.
+  // If we already have a table that cannot grow, adjust the size to it.
+  if (!mask_ || mask_ == static_cast<uint32_t>(table_len - 1))
+    return;
+
   int current_max_size = MaxStorageSizeForTable(table_len);
   if (max_size_ > current_max_size)
     max_size_= current_max_size;
@@ -1612,7 +1671,7 @@ EntryImpl* BackendImpl::MatchEntry(const std::string& key,
                                    bool find_parent,
                                    Addr entry_addr,
                                    bool* match_error) {
-  Addr address(data_->table[hash & mask_]);
+  Addr address(data_->table[GetBucket(hash)]);
   scoped_refptr<EntryImpl> cache_entry, parent_entry;
   EntryImpl* tmp = NULL;
   bool found = false;
@@ -1652,7 +1711,7 @@ EntryImpl* BackendImpl::MatchEntry(const std::string& key,
         parent_entry->SetNextAddress(child);
         parent_entry = NULL;
       } else {
-        data_->table[hash & mask_] = child.value();
+        data_->table[GetBucket(hash)] = child.value();
       }
 
       Trace("MatchEntry dirty %d 0x%x 0x%x", find_parent, entry_addr.value(),
@@ -1668,12 +1727,12 @@ EntryImpl* BackendImpl::MatchEntry(const std::string& key,
       }
 
       // Restart the search.
-      address.set_value(data_->table[hash & mask_]);
+      address.set_value(data_->table[GetBucket(hash)]);
       visited.clear();
       continue;
     }
 
-    DCHECK_EQ(hash & mask_, cache_entry->entry()->Data()->hash & mask_);
+    DCHECK_EQ(GetBucket(hash), GetBucket(cache_entry->entry()->Data()->hash));
     if (cache_entry->IsSameEntry(key, hash)) {
       if (!cache_entry->Update())
         cache_entry = NULL;
@@ -1988,6 +2047,11 @@ bool BackendImpl::CheckIndex() {
     return false;
   }
 
+  // The mark of a growing table is put back once the growth is validated.
+  const bool growth_marked =
+      (data_->header.version & kIndexGrowingVersion) != 0;
+  data_->header.version &= ~kIndexGrowingVersion;
+
   if (new_eviction_) {
     // We support versions 2.0 and 2.1, upgrading 2.0 to 2.1.
     if (kIndexMagic != data_->header.magic ||
@@ -2037,15 +2101,192 @@ bool BackendImpl::CheckIndex() {
   if (!mask_)
     mask_ = data_->header.table_len - 1;
 
+  if (data_->header.resize_table_len &&
+      data_->header.resize_table_len == data_->header.table_len) {
+    // The growth of the table was completed, but not recorded.
+    data_->header.resize_table_len = 0;
+    data_->header.resize_split = 0;
+  }
+
+  if (IsIndexGrowing() &&
+      (!growth_marked ||
+       data_->header.resize_table_len != data_->header.table_len * 2 ||
+       data_->header.resize_split < 0 ||
+       data_->header.resize_split >= data_->header.table_len ||
+       current_size < GetIndexSize(data_->header.resize_table_len) ||
+       mask_ != static_cast<uint32_t>(data_->header.table_len - 1))) {
+    LOG(ERROR) << "Invalid index growth";
+    return false;
+  }
+  if (IsIndexGrowing())
+    data_->header.version |= kIndexGrowingVersion;
+
   // Load the table into memory.
   return index_->Preload();
 }
 
+uint32_t BackendImpl::GetBucket(uint32_t hash) const {
+  uint32_t bucket = hash & mask_;
+  // The buckets already split use one more bit of the hash.
+  if (IsIndexGrowing() &&
+      bucket < static_cast<uint32_t>(data_->header.resize_split)) {
+    bucket = hash & (mask_ * 2 + 1);
+  }
+  return bucket;
+}
+
+bool BackendImpl::IsIndexGrowing() const {
+  return data_->header.resize_table_len != 0;
+}
+
+bool BackendImpl::ShouldGrowIndex() const {
+  // A table limited by the user, or by the file when read only, stays put.
+  if (disabled_ || read_only_ || IsIndexGrowing() ||
+      mask_ != static_cast<uint32_t>(data_->header.table_len - 1) ||
+      data_->header.table_len >= kMaxTableLen) {
+    return false;
+  }
+  return static_cast<int64_t>(data_->header.num_entries) * 100 >
+         static_cast<int64_t>(data_->header.table_len) * kMaxIndexLoad;
+}
+
+bool BackendImpl::StartIndexGrowth() {
+  DCHECK(!IsIndexGrowing());
+  int table_len = data_->header.table_len;
+  int new_table_len = table_len * 2;
+
+  // The new half of the table must be in the file before the new mapping is
+  // created. The old mapping goes away once the new one is in place.
+  index_->Flush();
+  if (!index_->SetLength(GetIndexSize(new_table_len))) {
+    LOG(ERROR) << "Unable to grow the index file";
+    return false;
+  }
+  scoped_refptr<MappedFile> index(new MappedFile());
+  Index* data = static_cast<Index*>(
+      index->Init(path_.AppendASCII(kIndexName), 0));
+  if (!data || index->GetLength() < GetIndexSize(new_table_len)) {
+    LOG(ERROR) << "Unable to map the grown index file";
+    return false;
+  }
+  index_ = index;
+  data_ = data;
+  rankings_.OnIndexChanged();
+  eviction_.OnIndexChanged();
+
+  memset(&data_->table[table_len], 0, table_len * sizeof(data_->table[0]));
+  // The mark goes first, so that the file is never seen as growing without it.
+  data_->header.version |= kIndexGrowingVersion;
+  data_->header.resize_split = 0;
+  data_->header.resize_table_len = new_table_len;
+  FlushIndex();
+  Trace("Index growth to %d", new_table_len);
+  return true;
+}
+
+void BackendImpl::SplitIndexBuckets(int count) {
+  DCHECK(IsIndexGrowing());
+  for (; count > 0 && !disabled_; count--) {
+    SplitIndexBucket(data_->header.resize_split);
+    // Only a bucket that is completely split is accounted for, so that the
+    // split of a bucket interrupted by a crash is performed again.
+    data_->header.resize_split++;
+    if (data_->header.resize_split == data_->header.table_len) {
+      data_->header.table_len = data_->header.resize_table_len;
+      data_->header.resize_split = 0;
+      data_->header.resize_table_len = 0;
+      data_->header.version &= ~kIndexGrowingVersion;
+      mask_ = data_->header.table_len - 1;
+      eviction_.OnIndexChanged();
+      Trace("Index growth done");
+      break;
+    }
+  }
+  FlushIndex();
+}
+
+void BackendImpl::SplitIndexBucket(uint32_t bucket) {
+  const uint32_t new_mask = mask_ * 2 + 1;
+  const uint32_t new_bucket = bucket + mask_ + 1;
+
+  // The chain of the new bucket is empty, unless this split was interrupted,
+  // in which case both chains are split again.
+  std::vector<scoped_refptr<EntryImpl>> entries;
+  std::vector<scoped_refptr<EntryImpl>> invalid_entries;
+  std::set<CacheAddr> visited;
+  for (uint32_t source : {bucket, new_bucket}) {
+    Addr address(data_->table[source]);
+    while (address.is_initialized() &&
+           visited.insert(address.value()).second) {
+      EntryImpl* tmp;
+      if (NewEntry(address, &tmp)) {
+        // The rest of the chain is lost, as it would be on MatchEntry().
+        Trace("NewEntry failed on SplitIndexBucket 0x%x", address.value());
+        break;
+      }
+      scoped_refptr<EntryImpl> cache_entry;
+      cache_entry.swap(&tmp);
+      address.set_value(cache_entry->GetNextAddress());
+      if (cache_entry->dirty())
+        invalid_entries.push_back(cache_entry);
+      else
+        entries.push_back(cache_entry);
+    }
+  }
+
+  // Each bucket first points to its first entry, and then every entry is
+  // linked to the next one of the same bucket, in order. At any point, all the
+  // entries remain reachable from one of the two buckets.
+  EntryImpl* last[2] = {nullptr, nullptr};
+  CacheAddr heads[2] = {0, 0};
+  for (const auto& cache_entry : entries) {
+    int target = (cache_entry->GetHash() & new_mask) == bucket ? 0 : 1;
+    if (!heads[target])
+      heads[target] = cache_entry->entry()->address().value();
+  }
+  data_->table[bucket] = heads[0];
+  data_->table[new_bucket] = heads[1];
+
+  for (const auto& cache_entry : entries) {
+    int target = (cache_entry->GetHash() & new_mask) == bucket ? 0 : 1;
+    Addr address = cache_entry->entry()->address();
+    if (last[target] && last[target]->GetNextAddress() != address.value())
+      last[target]->SetNextAddress(address);
+    last[target] = cache_entry.get();
+  }
+  for (EntryImpl* cache_entry : last) {
+    if (cache_entry && cache_entry->GetNextAddress())
+      cache_entry->SetNextAddress(Addr());
+  }
+
+  // As on MatchEntry(), invalid entries are destroyed once they are unlinked.
+  for (const auto& cache_entry : invalid_entries)
+    DestroyInvalidEntry(cache_entry.get());
+}
+
+void BackendImpl::GrowIndexStep() {
+  if (disabled_ || !IsIndexGrowing())
+    return;
+
+  SplitIndexBuckets(kIndexGrowthStep);
+  if (IsIndexGrowing())
+    PostGrowIndexStep();
+}
+
+void BackendImpl::PostGrowIndexStep() {
+  base::ThreadTaskRunnerHandle::Get()->PostTask(
+      FROM_HERE, base::Bind(&BackendImpl::GrowIndexStep, GetWeakPtr()));
+}
+
 int BackendImpl::CheckAllEntries() {
   int num_dirty = 0;
   int num_entries = 0;
   DCHECK(mask_ < std::numeric_limits<uint32_t>::max());
-  for (unsigned int i = 0; i <= mask_; i++) {
+  // The new half of a growing table is used up to the split point.
+  unsigned int num_buckets = mask_ + 1;
+  if (IsIndexGrowing())
+    num_buckets += data_->header.resize_split;
+  for (unsigned int i = 0; i < num_buckets; i++) {
     Addr address(data_->table[i]);
     if (!address.is_initialized())
       continue;
@@ -2066,7 +2307,7 @@ int BackendImpl::CheckAllEntries() {
       else
         return ERR_INVALID_ENTRY;
 
-      DCHECK_EQ(i, cache_entry->entry()->Data()->hash & mask_);
+      DCHECK_EQ(i, GetBucket(cache_entry->entry()->Data()->hash));
       address.set_value(cache_entry->GetNextAddress());
       if (!address.is_initialized())
         break;
@@ -2100,21 +2341,7 @@ bool BackendImpl::CheckEntry(EntryImpl* cache_entry) {
 }
 
 int BackendImpl::MaxBuffersSize() {
-  static int64_t total_memory = base::SysInfo::AmountOfPhysicalMemory();
-  static bool done = false;
-
-  if (!done) {
-    const int kMaxBuffersSize = 30 * 1024 * 1024;
-
-    // We want to use up to 2% of the computer's memory.
-    total_memory = total_memory * 2 / 100;
-    if (total_memory > kMaxBuffersSize || total_memory <= 0)
-      total_memory = kMaxBuffersSize;
-
-    done = true;
-  }
-
-  return static_cast<int>(total_memory);
+  return g_max_buffers_size.Get().size / shard_count_;
 }
 
 }  // namespace disk_cache
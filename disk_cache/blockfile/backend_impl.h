@@ -94,6 +94,10 @@ class NET_EXPORT_PRIVATE BackendImpl : public Backend {
   // Sets the cache type for this backend.
   void SetType(net::CacheType type);
 
+  // Makes this backend one of the |shard_count| shards of a cache, so that it
+  // takes its share of the default size and of the memory for buffers.
+  void SetShardCount(int shard_count);
+
   // Returns the full name for an external storage file.
   base::FilePath GetFileName(Addr address) const;
 
@@ -253,6 +257,11 @@ class NET_EXPORT_PRIVATE BackendImpl : public Backend {
   // entries. This method should be called directly on the cache thread.
   void TrimDeletedListForTest(bool empty);
 
+  // Splits |buckets| buckets of the index table, starting to double the table
+  // first if it is not growing already. This method should be called directly
+  // on the cache thread.
+  void GrowIndexForTest(int buckets);
+
   // Only intended for testing
   base::RepeatingTimer* GetTimerForTest();
 
@@ -363,6 +372,33 @@ class NET_EXPORT_PRIVATE BackendImpl : public Backend {
   // Performs basic checks on the index file. Returns false on failure.
   bool CheckIndex();
 
+  // Returns the bucket of the index table for a given |hash|.
+  uint32_t GetBucket(uint32_t hash) const;
+
+  // Returns true while the index table is doubling, and so both the old and
+  // the new bucket of a hash have to be considered.
+  bool IsIndexGrowing() const;
+
+  // Returns true if the index table is loaded enough to double it.
+  bool ShouldGrowIndex() const;
+
+  // Extends the index file and maps it again, with room for a table of twice
+  // the current size. Returns false on failure.
+  bool StartIndexGrowth();
+
+  // Splits up to |count| buckets of the table, and completes the growth of the
+  // table after the last one.
+  void SplitIndexBuckets(int count);
+
+  // Moves the entries of |bucket| that belong to the new half of the table to
+  // their new bucket.
+  void SplitIndexBucket(uint32_t bucket);
+
+  // Splits some buckets, posting a task for the next ones. This is how the
+  // table grows without delaying the operations of the cache for long.
+  void GrowIndexStep();
+  void PostGrowIndexStep();
+
   // Part of the self test. Returns the number or dirty entries, or an error.
   int CheckAllEntries();
 
@@ -388,6 +424,7 @@ class NET_EXPORT_PRIVATE BackendImpl : public Backend {
   int entry_count_;  // Number of entries accessed lately.
   int byte_count_;  // Number of bytes read/written lately.
   int buffer_bytes_;  // Total size of the temporary entries' buffers.
+  int shard_count_;  // Number of backends sharing the cache (and memory).
   int up_ticks_;  // The number of timer ticks received (OnStatsTimer).
   net::CacheType cache_type_;
   int uma_report_;  // Controls transmission of UMA data.
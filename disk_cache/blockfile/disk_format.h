@@ -14,6 +14,14 @@
 // a CacheAddr value. Linking for a given hash bucket is handled internally
 // by the cache entry.
 //
+// When the table gets too loaded, it doubles in place with linear hashing: the
+// buckets of the old table are split one at a time, moving some entries to the
+// matching bucket of the new half, and the header keeps track of how many of
+// them are split, so that the growth resumes after a restart or a crash. While
+// the table grows, the version of the file carries kIndexGrowingVersion, so
+// that code that knows nothing of the growth refuses the file, instead of
+// looking for the entries of the split buckets in the wrong place.
+//
 // The last element of the cache is the block-file. A block file is a file
 // designed to store blocks of data of a given size. For more details see
 // disk_cache/disk_format_base.h
@@ -57,6 +65,7 @@ namespace disk_cache {
 const int kIndexTablesize = 0x10000;
 const uint32_t kIndexMagic = 0xC103CAC3;
 const uint32_t kCurrentVersion = 0x20000;  // Version 2.0.
+const uint32_t kIndexGrowingVersion = 0x1000000;  // Added while growing.
 
 struct LruData {
   int32_t pad1[2];
@@ -82,10 +91,13 @@ struct NET_EXPORT_PRIVATE IndexHeader {
   int32_t this_id;           // Id for all entries being changed (dirty flag).
   CacheAddr   stats;         // Storage for usage data.
   int32_t table_len;         // Actual size of the table (0 == kIndexTablesize).
+                             // See resize_table_len while the table grows.
   int32_t crash;             // Signals a previous crash.
   int32_t experiment;        // Id of an ongoing test.
   uint64_t create_time;      // Creation time for this set of files.
-  int32_t pad[52];
+  int32_t resize_table_len;  // Size of the table being grown into, or 0.
+  int32_t resize_split;      // Buckets of table_len already split in two.
+  int32_t pad[50];
   LruData     lru;           // Eviction control data.
 };
 
@@ -104,6 +104,13 @@ void Eviction::Init(BackendImpl* backend) {
   test_mode_ = false;
 }
 
+void Eviction::OnIndexChanged() {
+  if (!init_)
+    return;
+  header_ = &backend_->data_->header;
+  index_size_ = backend_->mask_ + 1;
+}
+
 void Eviction::Stop() {
   // It is possible for the backend initialization to fail, in which case this
   // object was never initialized... and there is nothing to do.
@@ -25,6 +25,9 @@ class Eviction {
   void Init(BackendImpl* backend);
   void Stop();
 
+  // Reloads the data of the index, after it is mapped again or grows.
+  void OnIndexChanged();
+
   // Deletes entries from the cache until the current size is below the limit.
   // If empty is true, the whole cache will be trimmed, regardless of being in
   // use.
@@ -111,6 +111,9 @@ class Rankings {
   // Restores original state, leaving the object ready for initialization.
   void Reset();
 
+  // Reloads the control data after the index file is mapped again.
+  void OnIndexChanged();
+
   // Inserts a given entry at the head of the queue.
   void Insert(CacheRankingsBlock* node, bool modified, List list);
 
@@ -0,0 +1,319 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/blockfile/sharded_backend_impl.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+#include "base/bind.h"
+#include "base/hash.h"
+#include "base/logging.h"
+#include "base/memory/ref_counted.h"
+#include "base/message_loop/message_loop.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/thread.h"
+#include "net/base/net_errors.h"
+#include "net/disk_cache/blockfile/backend_impl.h"
+
+namespace {
+
+int InitShard(disk_cache::BackendImpl* shard,
+              const net::CompletionCallback& callback) {
+  return shard->Init(callback);
+}
+
+int DoomAllEntriesOfShard(disk_cache::BackendImpl* shard,
+                          const net::CompletionCallback& callback) {
+  return shard->DoomAllEntries(callback);
+}
+
+int DoomEntriesBetweenOfShard(base::Time initial_time,
+                              base::Time end_time,
+                              disk_cache::BackendImpl* shard,
+                              const net::CompletionCallback& callback) {
+  return shard->DoomEntriesBetween(initial_time, end_time, callback);
+}
+
+int DoomEntriesSinceOfShard(base::Time initial_time,
+                            disk_cache::BackendImpl* shard,
+                            const net::CompletionCallback& callback) {
+  return shard->DoomEntriesSince(initial_time, callback);
+}
+
+int CalculateSizeOfShard(disk_cache::BackendImpl* shard,
+                         const net::CompletionCallback& callback) {
+  return shard->CalculateSizeOfAllEntries(callback);
+}
+
+}  // namespace
+
+namespace disk_cache {
+
+// Merges the results of an operation on all the shards: the first error, or
+// else the sum of the results (the shards only ever return sizes or OK).
+class ShardedBackendImpl::ResultCollector
+    : public base::RefCounted<ResultCollector> {
+ public:
+  explicit ResultCollector(const CompletionCallback& callback)
+      : callback_(callback), pending_(1), result_(net::OK) {}
+
+  // Returns the callback for one more shard.
+  CompletionCallback AddShard() {
+    ++pending_;
+    return base::Bind(&ResultCollector::OnShardComplete, this);
+  }
+
+  void OnShardComplete(int result) {
+    if (result_ >= 0) {
+      if (result < 0) {
+        result_ = result;
+      } else {
+        result_ = std::min<int64_t>(result_ + result,
+                                    std::numeric_limits<int32_t>::max());
+      }
+    }
+    if (!--pending_)
+      callback_.Run(static_cast<int>(result_));
+  }
+
+  // Called once all the shards are started. Returns the result if all of
+  // them are done already, and net::ERR_IO_PENDING otherwise.
+  int Finish() {
+    if (--pending_)
+      return net::ERR_IO_PENDING;
+    return static_cast<int>(result_);
+  }
+
+ private:
+  friend class base::RefCounted<ResultCollector>;
+  ~ResultCollector() {}
+
+  CompletionCallback callback_;
+  int pending_;
+  int64_t result_;
+
+  DISALLOW_COPY_AND_ASSIGN(ResultCollector);
+};
+
+class ShardedBackendImpl::IteratorImpl : public Backend::Iterator {
+ public:
+  explicit IteratorImpl(base::WeakPtr<ShardedBackendImpl> backend)
+      : backend_(backend), shard_index_(0), weak_factory_(this) {}
+
+  ~IteratorImpl() override {}
+
+  int OpenNextEntry(Entry** next_entry,
+                    const CompletionCallback& callback) override {
+    while (backend_ && shard_index_ < backend_->shards_.size()) {
+      if (!shard_iterator_)
+        shard_iterator_ = backend_->shards_[shard_index_]->CreateIterator();
+      int rv = shard_iterator_->OpenNextEntry(
+          next_entry, base::Bind(&IteratorImpl::OnOpenNextEntryComplete,
+                                 weak_factory_.GetWeakPtr(), next_entry,
+                                 callback));
+      // A shard returns net::ERR_FAILED once it has no more entries.
+      if (rv != net::ERR_FAILED)
+        return rv;
+      NextShard();
+    }
+    return net::ERR_FAILED;
+  }
+
+ private:
+  void NextShard() {
+    shard_iterator_.reset();
+    ++shard_index_;
+  }
+
+  void OnOpenNextEntryComplete(Entry** next_entry,
+                               const CompletionCallback& callback,
+                               int result) {
+    if (result == net::ERR_FAILED) {
+      NextShard();
+      result = OpenNextEntry(next_entry, callback);
+      if (result == net::ERR_IO_PENDING)
+        return;
+    }
+    callback.Run(result);
+  }
+
+  const base::WeakPtr<ShardedBackendImpl> backend_;
+  size_t shard_index_;
+  std::unique_ptr<Backend::Iterator> shard_iterator_;
+  base::WeakPtrFactory<IteratorImpl> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(IteratorImpl);
+};
+
+ShardedBackendImpl::ShardedBackendImpl(const base::FilePath& path,
+                                       int shard_count,
+                                       net::NetLog* net_log)
+    : path_(path),
+      shard_count_(shard_count),
+      cache_type_(net::DISK_CACHE),
+      max_size_(0),
+      flags_(0),
+      net_log_(net_log),
+      weak_factory_(this) {
+  DCHECK_GT(shard_count_, 0);
+}
+
+ShardedBackendImpl::~ShardedBackendImpl() {
+  // Each shard waits for the work left on its thread.
+  shards_.clear();
+  threads_.clear();
+}
+
+bool ShardedBackendImpl::SetMaxSize(int max_bytes) {
+  if (max_bytes < 0)
+    return false;
+  max_size_ = max_bytes;
+  return true;
+}
+
+void ShardedBackendImpl::SetType(net::CacheType type) {
+  DCHECK_NE(net::MEMORY_CACHE, type);
+  cache_type_ = type;
+}
+
+void ShardedBackendImpl::SetFlags(uint32_t flags) {
+  flags_ |= flags;
+}
+
+int ShardedBackendImpl::Init(const CompletionCallback& callback) {
+  DCHECK(shards_.empty());
+  for (int i = 0; i < shard_count_; ++i) {
+    std::unique_ptr<base::Thread> thread(
+        new base::Thread(base::StringPrintf("CacheThread%d", i)));
+    if (!thread->StartWithOptions(
+            base::Thread::Options(base::MessageLoop::TYPE_IO, 0))) {
+      return net::ERR_FAILED;
+    }
+
+    std::unique_ptr<BackendImpl> shard(new BackendImpl(
+        GetShardPath(path_, i), thread->task_runner(), net_log_));
+    // Zero, the default size, is split by the shards themselves.
+    shard->SetMaxSize(max_size_ / shard_count_);
+    shard->SetType(cache_type_);
+    shard->SetFlags(flags_);
+    shard->SetShardCount(shard_count_);
+    threads_.push_back(std::move(thread));
+    shards_.push_back(std::move(shard));
+  }
+  return RunOnAllShards(base::Bind(&InitShard), callback);
+}
+
+// static
+int ShardedBackendImpl::GetShardIndex(const std::string& key,
+                                      int shard_count) {
+  // The high bits of the hash pick the shard, leaving the low bits, which
+  // address the index table of the shard, evenly spread.
+  return static_cast<int>(
+      (static_cast<uint64_t>(base::Hash(key)) * shard_count) >> 32);
+}
+
+// static
+base::FilePath ShardedBackendImpl::GetShardPath(const base::FilePath& path,
+                                                int index) {
+  return path.AppendASCII(base::StringPrintf("shard_%d", index));
+}
+
+BackendImpl* ShardedBackendImpl::GetShardForTesting(int index) const {
+  return shards_[index].get();
+}
+
+net::CacheType ShardedBackendImpl::GetCacheType() const {
+  return cache_type_;
+}
+
+int32_t ShardedBackendImpl::GetEntryCount() const {
+  int32_t count = 0;
+  for (const auto& shard : shards_)
+    count += shard->GetEntryCount();
+  return count;
+}
+
+int ShardedBackendImpl::OpenEntry(const std::string& key,
+                                  Entry** entry,
+                                  const CompletionCallback& callback) {
+  return GetShard(key)->OpenEntry(key, entry, callback);
+}
+
+int ShardedBackendImpl::CreateEntry(const std::string& key,
+                                    Entry** entry,
+                                    const CompletionCallback& callback) {
+  return GetShard(key)->CreateEntry(key, entry, callback);
+}
+
+int ShardedBackendImpl::DoomEntry(const std::string& key,
+                                  const CompletionCallback& callback) {
+  return GetShard(key)->DoomEntry(key, callback);
+}
+
+int ShardedBackendImpl::DoomAllEntries(const CompletionCallback& callback) {
+  return RunOnAllShards(base::Bind(&DoomAllEntriesOfShard), callback);
+}
+
+int ShardedBackendImpl::DoomEntriesBetween(
+    base::Time initial_time,
+    base::Time end_time,
+    const CompletionCallback& callback) {
+  return RunOnAllShards(
+      base::Bind(&DoomEntriesBetweenOfShard, initial_time, end_time),
+      callback);
+}
+
+int ShardedBackendImpl::DoomEntriesSince(base::Time initial_time,
+                                         const CompletionCallback& callback) {
+  return RunOnAllShards(base::Bind(&DoomEntriesSinceOfShard, initial_time),
+                        callback);
+}
+
+int ShardedBackendImpl::CalculateSizeOfAllEntries(
+    const CompletionCallback& callback) {
+  return RunOnAllShards(base::Bind(&CalculateSizeOfShard), callback);
+}
+
+std::unique_ptr<Backend::Iterator> ShardedBackendImpl::CreateIterator() {
+  return std::unique_ptr<Backend::Iterator>(
+      new IteratorImpl(weak_factory_.GetWeakPtr()));
+}
+
+void ShardedBackendImpl::GetStats(base::StringPairs* stats) {
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    base::StringPairs shard_stats;
+    shards_[i]->GetStats(&shard_stats);
+    for (const auto& item : shard_stats) {
+      stats->push_back(std::make_pair(
+          base::StringPrintf("Shard %d %s", static_cast<int>(i),
+                             item.first.c_str()),
+          item.second));
+    }
+  }
+}
+
+void ShardedBackendImpl::OnExternalCacheHit(const std::string& key) {
+  GetShard(key)->OnExternalCacheHit(key);
+}
+
+BackendImpl* ShardedBackendImpl::GetShard(const std::string& key) const {
+  DCHECK_EQ(static_cast<size_t>(shard_count_), shards_.size());
+  return shards_[GetShardIndex(key, shard_count_)].get();
+}
+
+int ShardedBackendImpl::RunOnAllShards(const ShardOperation& operation,
+                                       const CompletionCallback& callback) {
+  scoped_refptr<ResultCollector> collector(new ResultCollector(callback));
+  for (const auto& shard : shards_) {
+    CompletionCallback shard_callback = collector->AddShard();
+    int rv = operation.Run(shard.get(), shard_callback);
+    if (rv != net::ERR_IO_PENDING)
+      shard_callback.Run(rv);
+  }
+  return collector->Finish();
+}
+
+}  // namespace disk_cache
@@ -0,0 +1,127 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// See net/disk_cache/disk_cache.h for the public interface of the cache.
+
+#ifndef NET_DISK_CACHE_BLOCKFILE_SHARDED_BACKEND_IMPL_H_
+#define NET_DISK_CACHE_BLOCKFILE_SHARDED_BACKEND_IMPL_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/callback_forward.h"
+#include "base/files/file_path.h"
+#include "base/macros.h"
+#include "base/memory/weak_ptr.h"
+#include "net/base/cache_type.h"
+#include "net/base/net_export.h"
+#include "net/disk_cache/disk_cache.h"
+
+namespace base {
+class Thread;
+}  // namespace base
+
+namespace net {
+class NetLog;
+}  // namespace net
+
+namespace disk_cache {
+
+class BackendImpl;
+
+// A blockfile cache split by key into shards. Each shard is a BackendImpl with
+// a directory of its own, and so its own index, rankings and block files, and
+// it is served by a cache thread of its own: operations on entries of
+// different shards run in parallel, where a single BackendImpl serializes all
+// of them on one thread.
+//
+// A shard holds the keys whose hash falls in its range of hash values, and an
+// equal share of the maximum size of the cache. Eviction is per shard.
+class NET_EXPORT_PRIVATE ShardedBackendImpl : public Backend {
+ public:
+  // The number of shards of the caches created by CreateCacheBackend().
+  static const int kDefaultShardCount = 4;
+
+  ShardedBackendImpl(const base::FilePath& path,
+                     int shard_count,
+                     net::NetLog* net_log);
+  ~ShardedBackendImpl() override;
+
+  // These apply to all the shards, and must be called before Init().
+  bool SetMaxSize(int max_bytes);
+  void SetType(net::CacheType type);
+  void SetFlags(uint32_t flags);
+
+  // Starts the cache threads and initializes the shards.
+  int Init(const CompletionCallback& callback);
+
+  // Returns the shard that stores the entry for |key|.
+  static int GetShardIndex(const std::string& key, int shard_count);
+
+  // Returns the directory of the shard |index| of a cache at |path|.
+  static base::FilePath GetShardPath(const base::FilePath& path, int index);
+
+  int shard_count() const { return shard_count_; }
+  BackendImpl* GetShardForTesting(int index) const;
+
+  // Backend implementation.
+  net::CacheType GetCacheType() const override;
+  int32_t GetEntryCount() const override;
+  int OpenEntry(const std::string& key,
+                Entry** entry,
+                const CompletionCallback& callback) override;
+  int CreateEntry(const std::string& key,
+                  Entry** entry,
+                  const CompletionCallback& callback) override;
+  int DoomEntry(const std::string& key,
+                const CompletionCallback& callback) override;
+  int DoomAllEntries(const CompletionCallback& callback) override;
+  int DoomEntriesBetween(base::Time initial_time,
+                         base::Time end_time,
+                         const CompletionCallback& callback) override;
+  int DoomEntriesSince(base::Time initial_time,
+                       const CompletionCallback& callback) override;
+  int CalculateSizeOfAllEntries(const CompletionCallback& callback) override;
+  // The iterator goes through the shards one after the other, with the same
+  // guarantees as the one of BackendImpl.
+  std::unique_ptr<Iterator> CreateIterator() override;
+  void GetStats(base::StringPairs* stats) override;
+  void OnExternalCacheHit(const std::string& key) override;
+
+ private:
+  class IteratorImpl;
+  class ResultCollector;
+
+  typedef base::Callback<int(BackendImpl*, const CompletionCallback&)>
+      ShardOperation;
+
+  BackendImpl* GetShard(const std::string& key) const;
+
+  // Runs |operation| on every shard. The result is the first error, or else
+  // the sum of the results of the shards.
+  int RunOnAllShards(const ShardOperation& operation,
+                     const CompletionCallback& callback);
+
+  const base::FilePath path_;
+  const int shard_count_;
+  net::CacheType cache_type_;
+  int max_size_;
+  uint32_t flags_;
+  net::NetLog* net_log_;
+
+  // The shards post their work to the threads, so they go away first.
+  std::vector<std::unique_ptr<base::Thread>> threads_;
+  std::vector<std::unique_ptr<BackendImpl>> shards_;
+
+  base::WeakPtrFactory<ShardedBackendImpl> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(ShardedBackendImpl);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_BLOCKFILE_SHARDED_BACKEND_IMPL_H_
@@ -0,0 +1,180 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/blockfile/sharded_backend_impl.h"
+
+#include <memory>
+#include <set>
+#include <string>
+
+#include "base/files/file_util.h"
+#include "base/message_loop/message_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/threading/thread.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/base/test_completion_callback.h"
+#include "net/disk_cache/blockfile/backend_impl.h"
+#include "net/disk_cache/disk_cache.h"
+#include "net/disk_cache/disk_cache_test_base.h"
+#include "net/disk_cache/disk_cache_test_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace disk_cache {
+
+namespace {
+
+const int kShardCount = 4;
+const int kEntryCount = 40;
+const int kDataSize = 1000;
+
+std::string GetKey(int i) {
+  return base::StringPrintf("the key %d", i);
+}
+
+}  // namespace
+
+TEST(ShardedBackendImplTest, GetShardIndex) {
+  int counts[kShardCount] = {};
+  for (int i = 0; i < 1000; ++i) {
+    int index = ShardedBackendImpl::GetShardIndex(GetKey(i), kShardCount);
+    ASSERT_LE(0, index);
+    ASSERT_GT(kShardCount, index);
+    counts[index]++;
+    EXPECT_EQ(0, ShardedBackendImpl::GetShardIndex(GetKey(i), 1));
+  }
+  for (int count : counts)
+    EXPECT_LT(150, count);
+}
+
+TEST_F(DiskCacheTest, ShardedBackend_Basics) {
+  ASSERT_TRUE(CleanupCacheDir());
+  std::unique_ptr<ShardedBackendImpl> cache(
+      new ShardedBackendImpl(cache_path_, kShardCount, nullptr));
+  // Waits for all the work of the shards on destruction.
+  cache->SetFlags(kNoRandom);
+  net::TestCompletionCallback cb;
+  ASSERT_EQ(net::OK, cb.GetResult(cache->Init(cb.callback())));
+  for (int i = 0; i < kShardCount; ++i) {
+    EXPECT_TRUE(base::DirectoryExists(
+        ShardedBackendImpl::GetShardPath(cache_path_, i)));
+  }
+
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kDataSize));
+  CacheTestFillBuffer(buffer->data(), kDataSize, false);
+  int shard_entries[kShardCount] = {};
+  for (int i = 0; i < kEntryCount; ++i) {
+    Entry* entry = nullptr;
+    ASSERT_EQ(net::OK,
+              cb.GetResult(cache->CreateEntry(GetKey(i), &entry,
+                                              cb.callback())));
+    EXPECT_EQ(kDataSize, cb.GetResult(entry->WriteData(
+                             1, 0, buffer.get(), kDataSize, cb.callback(),
+                             false)));
+    entry->Close();
+    shard_entries[ShardedBackendImpl::GetShardIndex(GetKey(i), kShardCount)]++;
+  }
+  EXPECT_EQ(kEntryCount, cache->GetEntryCount());
+  for (int i = 0; i < kShardCount; ++i)
+    EXPECT_EQ(shard_entries[i], cache->GetShardForTesting(i)->GetEntryCount());
+  EXPECT_LE(kEntryCount * kDataSize,
+            cb.GetResult(cache->CalculateSizeOfAllEntries(cb.callback())));
+
+  for (int i = 0; i < kEntryCount; ++i) {
+    Entry* entry = nullptr;
+    ASSERT_EQ(net::OK,
+              cb.GetResult(cache->OpenEntry(GetKey(i), &entry, cb.callback())));
+    EXPECT_EQ(kDataSize, entry->GetDataSize(1));
+    entry->Close();
+  }
+
+  // The entry goes away from its shard, and only from there.
+  ASSERT_EQ(net::OK, cb.GetResult(cache->DoomEntry(GetKey(0), cb.callback())));
+  EXPECT_EQ(kEntryCount - 1, cache->GetEntryCount());
+  Entry* entry = nullptr;
+  EXPECT_NE(net::OK,
+            cb.GetResult(cache->OpenEntry(GetKey(0), &entry, cb.callback())));
+
+  // The iterator finds the entries of all the shards.
+  std::set<std::string> keys;
+  std::unique_ptr<Backend::Iterator> iter = cache->CreateIterator();
+  while (cb.GetResult(iter->OpenNextEntry(&entry, cb.callback())) == net::OK) {
+    EXPECT_TRUE(keys.insert(entry->GetKey()).second);
+    entry->Close();
+  }
+  iter.reset();
+  EXPECT_EQ(static_cast<size_t>(kEntryCount - 1), keys.size());
+
+  ASSERT_EQ(net::OK, cb.GetResult(cache->DoomAllEntries(cb.callback())));
+  EXPECT_EQ(0, cache->GetEntryCount());
+  cache.reset();
+
+  // The entries stay in their shards when the cache is opened again.
+  cache.reset(new ShardedBackendImpl(cache_path_, kShardCount, nullptr));
+  cache->SetFlags(kNoRandom);
+  ASSERT_EQ(net::OK, cb.GetResult(cache->Init(cb.callback())));
+  ASSERT_EQ(net::OK,
+            cb.GetResult(cache->CreateEntry(GetKey(1), &entry, cb.callback())));
+  entry->Close();
+  cache.reset(new ShardedBackendImpl(cache_path_, kShardCount, nullptr));
+  cache->SetFlags(kNoRandom);
+  ASSERT_EQ(net::OK, cb.GetResult(cache->Init(cb.callback())));
+  ASSERT_EQ(net::OK,
+            cb.GetResult(cache->OpenEntry(GetKey(1), &entry, cb.callback())));
+  entry->Close();
+  EXPECT_EQ(1, cache->GetEntryCount());
+}
+
+// The sharded backend is created through CreateCacheBackend() on request.
+TEST_F(DiskCacheTest, ShardedBackend_CreateCacheBackend) {
+  ASSERT_TRUE(CleanupCacheDir());
+  base::Thread cache_thread("CacheThread");
+  ASSERT_TRUE(cache_thread.StartWithOptions(
+      base::Thread::Options(base::MessageLoop::TYPE_IO, 0)));
+
+  std::unique_ptr<Backend> cache;
+  net::TestCompletionCallback cb;
+  int rv = CreateCacheBackend(
+      net::DISK_CACHE, net::CACHE_BACKEND_BLOCKFILE_SHARDED, cache_path_, 0,
+      false, cache_thread.task_runner(), nullptr, &cache, cb.callback());
+  ASSERT_EQ(net::OK, cb.GetResult(rv));
+  ASSERT_TRUE(cache);
+  for (int i = 0; i < ShardedBackendImpl::kDefaultShardCount; ++i) {
+    EXPECT_TRUE(base::DirectoryExists(
+        ShardedBackendImpl::GetShardPath(cache_path_, i)));
+  }
+
+  Entry* entry = nullptr;
+  ASSERT_EQ(net::OK,
+            cb.GetResult(cache->CreateEntry(GetKey(0), &entry, cb.callback())));
+  entry->Close();
+  ASSERT_EQ(net::OK,
+            cb.GetResult(cache->OpenEntry(GetKey(0), &entry, cb.callback())));
+  entry->Close();
+  EXPECT_EQ(1, cache->GetEntryCount());
+}
+
+TEST_F(DiskCacheTest, ShardedBackend_MaxSize) {
+  ASSERT_TRUE(CleanupCacheDir());
+  const int kMaxSize = 4 * 1024 * 1024;
+  ShardedBackendImpl cache(cache_path_, kShardCount, nullptr);
+  cache.SetFlags(kNoRandom);
+  ASSERT_TRUE(cache.SetMaxSize(kMaxSize));
+  net::TestCompletionCallback cb;
+  ASSERT_EQ(net::OK, cb.GetResult(cache.Init(cb.callback())));
+
+  base::StringPairs stats;
+  cache.GetStats(&stats);
+  int shards_with_size = 0;
+  for (const auto& item : stats) {
+    if (item.first.find("Max size") != std::string::npos) {
+      EXPECT_EQ(base::IntToString(kMaxSize / kShardCount), item.second);
+      shards_with_size++;
+    }
+  }
+  EXPECT_EQ(kShardCount, shards_with_size);
+}
+
+}  // namespace disk_cache
@@ -10,8 +10,10 @@
 #include "base/single_thread_task_runner.h"
 #include "base/strings/stringprintf.h"
 #include "net/base/cache_type.h"
+#include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/disk_cache/blockfile/backend_impl.h"
+#include "net/disk_cache/blockfile/sharded_backend_impl.h"
 #include "net/disk_cache/cache_util.h"
 #include "net/disk_cache/disk_cache.h"
 #include "net/disk_cache/memory/mem_backend_impl.h"
@@ -113,6 +115,23 @@ int CacheCreator::Run() {
 #if defined(OS_ANDROID)
   return net::ERR_FAILED;
 #else
+  if (backend_type_ == net::CACHE_BACKEND_BLOCKFILE_SHARDED) {
+    // The shards live in subdirectories of |path_|, and each runs on a cache
+    // thread of its own instead of |thread_|.
+    disk_cache::ShardedBackendImpl* sharded_cache =
+        new disk_cache::ShardedBackendImpl(
+            path_, disk_cache::ShardedBackendImpl::kDefaultShardCount,
+            net_log_);
+    created_cache_.reset(sharded_cache);
+    sharded_cache->SetMaxSize(max_bytes_);
+    sharded_cache->SetType(type_);
+    sharded_cache->SetFlags(flags_);
+    int rv = sharded_cache->Init(
+        base::Bind(&CacheCreator::OnIOComplete, base::Unretained(this)));
+    DCHECK_EQ(net::ERR_IO_PENDING, rv);
+    return rv;
+  }
+
   disk_cache::BackendImpl* new_cache =
       new disk_cache::BackendImpl(path_, thread_, net_log_);
   created_cache_.reset(new_cache);
@@ -190,4 +209,16 @@ int CreateCacheBackend(
   return creator->Run();
 }
 
+int Entry::ReadSharedData(int index,
+                          int offset,
+                          int buf_len,
+                          scoped_refptr<IOBuffer>* buf,
+                          const CompletionCallback& callback) {
+  if (buf_len < 0)
+    return net::ERR_INVALID_ARGUMENT;
+
+  *buf = new IOBuffer(buf_len);
+  return ReadData(index, offset, buf->get(), buf_len, callback);
+}
+
 }  // namespace disk_cache
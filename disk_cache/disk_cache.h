@@ -202,6 +202,17 @@ class NET_EXPORT Entry {
   virtual int ReadData(int index, int offset, IOBuffer* buf, int buf_len,
                        const CompletionCallback& callback) = 0;
 
+  // Behaves like ReadData() except that the entry may hand out a buffer that
+  // already holds the data instead of copying it into one of the caller: on
+  // success, |buf| is set to a buffer that starts with the data read. The
+  // caller must not write to |buf|. The default implementation allocates a
+  // new buffer of |buf_len| bytes and reads into it.
+  virtual int ReadSharedData(int index,
+                             int offset,
+                             int buf_len,
+                             scoped_refptr<IOBuffer>* buf,
+                             const CompletionCallback& callback);
+
   // Copies data from the given buffer of length |buf_len| into the cache.
   // Returns the number of bytes written or a network error code. If this
   // function returns ERR_IO_PENDING, the completion callback will be called
@@ -2,30 +2,47 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "base/bind.h"
 #include "base/bind_helpers.h"
+#include "base/files/file.h"
 #include "base/files/file_enumerator.h"
 #include "base/files/file_path.h"
+#include "base/files/scoped_temp_dir.h"
 #include "base/hash.h"
+#include "base/logging.h"
 #include "base/process/process_metrics.h"
+#include "base/rand_util.h"
 #include "base/run_loop.h"
 #include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
 #include "base/test/perf_time_logger.h"
 #include "base/test/test_file_util.h"
 #include "base/threading/thread.h"
+#include "base/threading/thread_task_runner_handle.h"
 #include "net/base/cache_type.h"
 #include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/base/test_completion_callback.h"
 #include "net/disk_cache/blockfile/backend_impl.h"
 #include "net/disk_cache/blockfile/block_files.h"
+#include "net/disk_cache/blockfile/sharded_backend_impl.h"
 #include "net/disk_cache/disk_cache.h"
 #include "net/disk_cache/disk_cache_test_base.h"
 #include "net/disk_cache/disk_cache_test_util.h"
+#include "net/disk_cache/memory/mem_stream.h"
 #include "net/disk_cache/simple/simple_backend_impl.h"
+#include "net/disk_cache/simple/simple_checksum.h"
+#include "net/disk_cache/simple/simple_file_batch.h"
+#include "net/disk_cache/simple/simple_index.h"
+#include "net/disk_cache/simple/simple_index_file.h"
+#include "net/disk_cache/simple/simple_util.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "testing/platform_test.h"
 
@@ -54,7 +71,8 @@ struct TestEntry {
 
 class DiskCachePerfTest : public DiskCacheTestWithCache {
  public:
-  DiskCachePerfTest() : saved_fd_limit_(MaybeGetMaxFds()) {
+  DiskCachePerfTest()
+      : body_size_(256 * 1024 - 1), saved_fd_limit_(MaybeGetMaxFds()) {
     if (saved_fd_limit_ < kFdLimitForCacheTests)
       MaybeSetFdLimit(kFdLimitForCacheTests);
   }
@@ -73,16 +91,26 @@ class DiskCachePerfTest : public DiskCacheTestWithCache {
   // Helper methods for constructing tests.
   bool TimeWrite();
   bool TimeRead(WhatToRead what_to_read, const char* timer_message);
+  void TimeHits(const char* name);
   void ResetAndEvictSystemDiskCache();
 
+  // Returns the number of files in the cache directory, recursively.
+  int CountCacheFiles();
+
   // Complete perf tests.
   void CacheBackendPerformance();
+  void SimpleCacheSmallEntryPerformance(int max_packed_entry_size);
+  void SimpleCacheTraceReplay(
+      disk_cache::SimpleIndex::AdmissionPolicy admission_policy,
+      const char* timer_message);
 
   const size_t kFdLimitForCacheTests = 8192;
 
   const int kNumEntries = 1000;
   const int kHeadersSize = 800;
-  const int kBodySize = 256 * 1024 - 1;
+
+  // Entries get up to |body_size_| bytes of data in stream 1.
+  int body_size_;
 
   std::vector<TestEntry> entries_;
 
@@ -91,7 +119,7 @@ class DiskCachePerfTest : public DiskCacheTestWithCache {
 };
 
 // Creates num_entries on the cache, and writes kHeaderSize bytes of metadata
-// and up to kBodySize of data to each entry.
+// and up to |body_size_| of data to each entry.
 bool DiskCachePerfTest::TimeWrite() {
   // TODO(gavinp): This test would be significantly more realistic if it didn't
   // do single reads and writes. Perhaps entries should be written 64kb at a
@@ -99,10 +127,10 @@ bool DiskCachePerfTest::TimeWrite() {
   // simultaneously; some number of entries in flight at a time would be a
   // likely better testing load.
   scoped_refptr<net::IOBuffer> buffer1(new net::IOBuffer(kHeadersSize));
-  scoped_refptr<net::IOBuffer> buffer2(new net::IOBuffer(kBodySize));
+  scoped_refptr<net::IOBuffer> buffer2(new net::IOBuffer(body_size_));
 
   CacheTestFillBuffer(buffer1->data(), kHeadersSize, false);
-  CacheTestFillBuffer(buffer2->data(), kBodySize, false);
+  CacheTestFillBuffer(buffer2->data(), body_size_, false);
 
   int expected = 0;
 
@@ -114,7 +142,7 @@ bool DiskCachePerfTest::TimeWrite() {
   for (int i = 0; i < kNumEntries; i++) {
     TestEntry entry;
     entry.key = GenerateKey(true);
-    entry.data_len = rand() % kBodySize;
+    entry.data_len = rand() % body_size_;
     entries_.push_back(entry);
 
     disk_cache::Entry* cache_entry;
@@ -150,10 +178,10 @@ bool DiskCachePerfTest::TimeWrite() {
 bool DiskCachePerfTest::TimeRead(WhatToRead what_to_read,
                                  const char* timer_message) {
   scoped_refptr<net::IOBuffer> buffer1(new net::IOBuffer(kHeadersSize));
-  scoped_refptr<net::IOBuffer> buffer2(new net::IOBuffer(kBodySize));
+  scoped_refptr<net::IOBuffer> buffer2(new net::IOBuffer(body_size_));
 
   CacheTestFillBuffer(buffer1->data(), kHeadersSize, false);
-  CacheTestFillBuffer(buffer2->data(), kBodySize, false);
+  CacheTestFillBuffer(buffer2->data(), body_size_, false);
 
   int expected = 0;
 
@@ -195,6 +223,31 @@ bool DiskCachePerfTest::TimeRead(WhatToRead what_to_read,
   return (expected == helper.callbacks_called());
 }
 
+// Opens each entry listed on |entries_| and reads its data and metadata, one
+// entry at a time, and reports the average latency of such a hit.
+void DiskCachePerfTest::TimeHits(const char* name) {
+  scoped_refptr<net::IOBuffer> buffer1(new net::IOBuffer(kHeadersSize));
+  scoped_refptr<net::IOBuffer> buffer2(new net::IOBuffer(body_size_));
+
+  const base::TimeTicks start = base::TimeTicks::Now();
+  for (const TestEntry& entry : entries_) {
+    disk_cache::Entry* cache_entry;
+    net::TestCompletionCallback cb;
+    int rv = cache_->OpenEntry(entry.key, &cache_entry, cb.callback());
+    ASSERT_EQ(net::OK, cb.GetResult(rv));
+    rv = cache_entry->ReadData(0, 0, buffer1.get(), kHeadersSize,
+                               cb.callback());
+    EXPECT_EQ(kHeadersSize, cb.GetResult(rv));
+    rv = cache_entry->ReadData(1, 0, buffer2.get(), entry.data_len,
+                               cb.callback());
+    EXPECT_EQ(entry.data_len, cb.GetResult(rv));
+    cache_entry->Close();
+  }
+  const base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+  LOG(INFO) << name << ": " << elapsed.InMicrosecondsF() / entries_.size()
+            << " us per hit";
+}
+
 TEST_F(DiskCachePerfTest, BlockfileHashes) {
   int seed = static_cast<int>(Time::Now().ToInternalValue());
   srand(seed);
@@ -259,6 +312,29 @@ void DiskCachePerfTest::CacheBackendPerformance() {
   base::RunLoop().RunUntilIdle();
 }
 
+int DiskCachePerfTest::CountCacheFiles() {
+  int file_count = 0;
+  base::FileEnumerator enumerator(cache_path_, true /* recursive */,
+                                  base::FileEnumerator::FILES);
+  for (base::FilePath file_path = enumerator.Next(); !file_path.empty();
+       file_path = enumerator.Next()) {
+    ++file_count;
+  }
+  return file_count;
+}
+
+// Small entries make up most of a typical cache. With packing, they share
+// segment files instead of each having files of their own.
+void DiskCachePerfTest::SimpleCacheSmallEntryPerformance(
+    int max_packed_entry_size) {
+  SetSimpleCacheMode();
+  SetSimpleCacheMaxPackedEntrySize(max_packed_entry_size);
+  body_size_ = 2 * 1024;
+  CacheBackendPerformance();
+  LOG(INFO) << "Simple cache files for " << kNumEntries
+            << " small entries: " << CountCacheFiles();
+}
+
 TEST_F(DiskCachePerfTest, CacheBackendPerformance) {
   CacheBackendPerformance();
 }
@@ -268,6 +344,427 @@ TEST_F(DiskCachePerfTest, SimpleCacheBackendPerformance) {
   CacheBackendPerformance();
 }
 
+TEST_F(DiskCachePerfTest, SimpleCacheSmallEntryPerformance) {
+  SimpleCacheSmallEntryPerformance(0);
+}
+
+TEST_F(DiskCachePerfTest, SimpleCachePackedSmallEntryPerformance) {
+  SimpleCacheSmallEntryPerformance(4 * 1024);
+}
+
+// Replays a synthetic trace on a cache holding a tenth of the data, and reports
+// the hit ratios of |admission_policy|. The popular keys follow a Zipf
+// distribution, and one request in four is for a key requested only once.
+void DiskCachePerfTest::SimpleCacheTraceReplay(
+    disk_cache::SimpleIndex::AdmissionPolicy admission_policy,
+    const char* timer_message) {
+  const int kKeyCount = 5000;
+  const int kRequestCount = 20000;
+  const int kMaxEntrySize = 16 * 1024;
+  SetSimpleCacheMode();
+  SetSimpleCacheAdmissionPolicy(admission_policy);
+  SetMaxSize(kKeyCount * kMaxEntrySize / 20);
+  InitCache();
+
+  std::vector<double> cumulative_weights(kKeyCount);
+  double total_weight = 0;
+  for (int i = 0; i < kKeyCount; ++i) {
+    total_weight += 1.0 / std::pow(i + 1, 0.8);
+    cumulative_weights[i] = total_weight;
+  }
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kMaxEntrySize));
+  CacheTestFillBuffer(buffer->data(), kMaxEntrySize, false);
+
+  // Every policy replays the same trace.
+  srand(1);
+  int hits = 0;
+  int64_t bytes = 0;
+  int64_t hit_bytes = 0;
+  base::PerfTimeLogger timer(timer_message);
+  for (int i = 0; i < kRequestCount; ++i) {
+    std::string key;
+    if (i % 4 == 3) {
+      key = base::StringPrintf("once%d", i);
+    } else {
+      const double weight = total_weight * rand() / RAND_MAX;
+      const int index = std::lower_bound(cumulative_weights.begin(),
+                                         cumulative_weights.end(), weight) -
+                        cumulative_weights.begin();
+      key = base::StringPrintf("key%d", std::min(index, kKeyCount - 1));
+    }
+    const int size = 1 + base::Hash(key) % kMaxEntrySize;
+    bytes += size;
+
+    disk_cache::Entry* entry;
+    net::TestCompletionCallback open_cb;
+    if (net::OK ==
+        open_cb.GetResult(cache_->OpenEntry(key, &entry, open_cb.callback()))) {
+      ++hits;
+      hit_bytes += size;
+      entry->Close();
+      continue;
+    }
+    net::TestCompletionCallback create_cb;
+    ASSERT_EQ(net::OK, create_cb.GetResult(cache_->CreateEntry(
+                           key, &entry, create_cb.callback())));
+    net::TestCompletionCallback write_cb;
+    EXPECT_EQ(size, write_cb.GetResult(entry->WriteData(
+                        1, 0, buffer.get(), size, write_cb.callback(), false)));
+    entry->Close();
+  }
+  timer.Done();
+
+  disk_cache::SimpleBackendImpl::FlushWorkerPoolForTesting();
+  base::RunLoop().RunUntilIdle();
+  LOG(INFO) << timer_message << ": hit ratio " << 100.0 * hits / kRequestCount
+            << "%, byte hit ratio " << 100.0 * hit_bytes / bytes << "%";
+}
+
+TEST_F(DiskCachePerfTest, SimpleCacheTraceReplay) {
+  SimpleCacheTraceReplay(disk_cache::SimpleIndex::ADMISSION_POLICY_ALL,
+                         "Replay trace on simple cache");
+}
+
+TEST_F(DiskCachePerfTest, SimpleCacheTinyLFUTraceReplay) {
+  SimpleCacheTraceReplay(disk_cache::SimpleIndex::ADMISSION_POLICY_TINY_LFU,
+                         "Replay trace on simple cache with TinyLFU");
+}
+
+// The simple cache serves no request until its index is loaded. The index file
+// is used in place, so loading it does not read every entry.
+TEST_F(DiskCachePerfTest, SimpleCacheIndexLoadPerformance) {
+  ASSERT_TRUE(CleanupCacheDir());
+  const size_t kIndexEntryCount = 5000000;
+  const size_t kLookupCount = 1000000;
+
+  disk_cache::SimpleIndex::EntrySet entries;
+  entries.reserve(kIndexEntryCount);
+  std::vector<uint64_t> entry_hashes;
+  entry_hashes.reserve(kLookupCount);
+  const base::Time now = base::Time::Now();
+  while (entries.size() < kIndexEntryCount) {
+    const uint64_t entry_hash = base::RandUint64();
+    if (entry_hashes.size() < kLookupCount)
+      entry_hashes.push_back(entry_hash);
+    disk_cache::SimpleIndex::InsertInEntrySet(
+        entry_hash, disk_cache::EntryMetadata(now, 4096), &entries);
+  }
+
+  disk_cache::SimpleIndexFile index_file(
+      base::ThreadTaskRunnerHandle::Get(), base::ThreadTaskRunnerHandle::Get(),
+      net::DISK_CACHE, cache_path_);
+  net::TestClosure closure;
+  base::PerfTimeLogger write_timer("Write simple cache index of 5M entries");
+  index_file.WriteToDisk(disk_cache::SimpleIndex::INDEX_WRITE_REASON_SHUTDOWN,
+                         entries, entries.total_entry_size(),
+                         base::TimeTicks::Now(), false, closure.closure());
+  closure.WaitForResult();
+  write_timer.Done();
+  entries.clear();
+
+  ASSERT_TRUE(base::EvictFileFromSystemCache(
+      cache_path_.AppendASCII("index-dir").AppendASCII("the-real-index")));
+  base::Time cache_mtime;
+  ASSERT_TRUE(disk_cache::simple_util::GetMTime(cache_path_, &cache_mtime));
+  disk_cache::SimpleIndexLoadResult load_result;
+  base::PerfTimeLogger load_timer(
+      "Load simple cache index of 5M entries (cold)");
+  index_file.LoadIndexEntries(cache_mtime, closure.closure(), &load_result);
+  closure.WaitForResult();
+  load_timer.Done();
+  ASSERT_TRUE(load_result.did_load);
+  EXPECT_EQ(disk_cache::SimpleIndex::INITIALIZE_METHOD_LOADED,
+            load_result.init_method);
+  EXPECT_EQ(kIndexEntryCount, load_result.entries.size());
+
+  base::PerfTimeLogger lookup_timer(
+      "Look up 1M entries of the loaded index (cold)");
+  size_t found_count = 0;
+  for (uint64_t entry_hash : entry_hashes)
+    found_count += load_result.entries.count(entry_hash);
+  lookup_timer.Done();
+  EXPECT_EQ(entry_hashes.size(), found_count);
+}
+
+void MeasureChecksumThroughput(disk_cache::SimpleChecksumType type,
+                               const std::string& data,
+                               const char* name) {
+  const int kIterations = 2000;
+  uint32_t crc = 0;
+  const base::TimeTicks start = base::TimeTicks::Now();
+  for (int i = 0; i < kIterations; ++i)
+    crc = disk_cache::SimpleChecksum(type, crc, data.data(), data.size());
+  const base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+  LOG(INFO) << name << ": "
+            << kIterations * data.size() / elapsed.InSecondsF() / 1e9
+            << " GB/s (crc " << crc << ")";
+}
+
+// Every byte read from or written to a simple cache stream is checksummed.
+TEST_F(DiskCachePerfTest, SimpleCacheChecksumThroughput) {
+  std::string data(256 * 1024, 0);
+  for (size_t i = 0; i < data.size(); ++i)
+    data[i] = static_cast<char>(rand());
+
+  MeasureChecksumThroughput(disk_cache::SIMPLE_CHECKSUM_CRC32, data,
+                            "zlib CRC-32 (entry format 5)");
+  disk_cache::SetCrc32cHardwareEnabledForTesting(false);
+  MeasureChecksumThroughput(disk_cache::SIMPLE_CHECKSUM_CRC32C, data,
+                            "Portable CRC-32C");
+  disk_cache::SetCrc32cHardwareEnabledForTesting(true);
+  if (disk_cache::IsCrc32cHardwareAvailable()) {
+    MeasureChecksumThroughput(disk_cache::SIMPLE_CHECKSUM_CRC32C, data,
+                              "SSE4.2 CRC-32C");
+  }
+}
+
+// Runs batches shaped like the ones of SimpleSynchronousEntry::Close(): the
+// stream 0 data, the key hash and the EOF records of an entry, written at
+// once. Reports the latency of a batch and the operations per second.
+void MeasureFileBatchPerformance(base::File* file,
+                                 bool io_ring_enabled,
+                                 const char* name) {
+  const int kBatches = 20000;
+  const int kEntrySpacing = 4096;
+  const int kWriteSizes[] = {800, 32, 24, 24};
+  char data[800];
+  CacheTestFillBuffer(data, sizeof(data), false);
+  disk_cache::SimpleFileBatch::SetIORingEnabled(io_ring_enabled);
+  int operations = 0;
+  const base::TimeTicks start = base::TimeTicks::Now();
+  for (int i = 0; i < kBatches; ++i) {
+    // Cycles through a hundred entries, so that the file stays small.
+    int64_t offset = static_cast<int64_t>(i % 100) * kEntrySpacing;
+    disk_cache::SimpleFileBatch batch;
+    for (int size : kWriteSizes) {
+      batch.AddWrite(file, offset, data, size);
+      offset += size;
+    }
+    EXPECT_TRUE(batch.Run());
+    operations += batch.size();
+  }
+  const base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+  disk_cache::SimpleFileBatch::SetIORingEnabled(true);
+  LOG(INFO) << name << ": " << elapsed.InMicrosecondsF() / kBatches
+            << " us per batch, " << operations / elapsed.InSecondsF()
+            << " writes/s";
+}
+
+TEST_F(DiskCachePerfTest, SimpleCacheFileBatchPerformance) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::File file(temp_dir.path().AppendASCII("batch"),
+                  base::File::FLAG_CREATE | base::File::FLAG_WRITE);
+  ASSERT_TRUE(file.IsValid());
+  MeasureFileBatchPerformance(&file, false, "Close batches, one at a time");
+  if (!disk_cache::SimpleFileBatch::IsIORingAvailable()) {
+    LOG(INFO) << "io_uring is not available";
+    return;
+  }
+  MeasureFileBatchPerformance(&file, true, "Close batches, io_uring");
+
+  // The same through the whole cache, where Close() runs on the worker pool.
+  SetSimpleCacheMode();
+  body_size_ = 2 * 1024;
+  InitCache();
+  LOG(INFO) << "Entries closed one write at a time:";
+  disk_cache::SimpleFileBatch::SetIORingEnabled(false);
+  EXPECT_TRUE(TimeWrite());
+  disk_cache::SimpleBackendImpl::FlushWorkerPoolForTesting();
+  base::RunLoop().RunUntilIdle();
+  LOG(INFO) << "Entries closed through io_uring:";
+  disk_cache::SimpleFileBatch::SetIORingEnabled(true);
+  EXPECT_TRUE(TimeWrite());
+  disk_cache::SimpleBackendImpl::FlushWorkerPoolForTesting();
+  base::RunLoop().RunUntilIdle();
+}
+
+// Times cache hits, whose open reads the head and the trailer of file 0
+// through a SimpleFileBatch, one read at a time and through io_uring.
+TEST_F(DiskCachePerfTest, SimpleCacheHitLatency) {
+  SetSimpleCacheMode();
+  InitCache();
+  EXPECT_TRUE(TimeWrite());
+  disk_cache::SimpleBackendImpl::FlushWorkerPoolForTesting();
+  base::RunLoop().RunUntilIdle();
+  // Brings the files into the page cache, so that both runs find them there.
+  EXPECT_TRUE(TimeRead(WhatToRead::HEADERS_AND_BODY,
+                       "Read disk cache entries (warm up)"));
+
+  disk_cache::SimpleFileBatch::SetIORingEnabled(false);
+  TimeHits("Simple cache hits, one read at a time");
+  disk_cache::SimpleFileBatch::SetIORingEnabled(true);
+  if (!disk_cache::SimpleFileBatch::IsIORingAvailable()) {
+    LOG(INFO) << "io_uring is not available";
+    return;
+  }
+  TimeHits("Simple cache hits, io_uring");
+}
+
+// Counts the completions of operations issued all at once.
+class OperationCounter {
+ public:
+  OperationCounter() : pending_(0), failed_(0) {}
+
+  net::CompletionCallback callback() {
+    return base::Bind(&OperationCounter::OnComplete, base::Unretained(this));
+  }
+
+  // Accounts for |rv|, returned by an operation issued with callback().
+  void Issued(int rv) {
+    if (rv == net::ERR_IO_PENDING)
+      pending_++;
+    else
+      Count(rv);
+  }
+
+  // Runs the message loop until all the operations are done, and returns the
+  // number of them that failed.
+  int Wait() {
+    if (pending_) {
+      run_loop_.reset(new base::RunLoop());
+      run_loop_->Run();
+    }
+    int failed = failed_;
+    failed_ = 0;
+    return failed;
+  }
+
+ private:
+  void Count(int rv) {
+    if (rv < 0)
+      failed_++;
+  }
+
+  void OnComplete(int rv) {
+    Count(rv);
+    if (!--pending_ && run_loop_)
+      run_loop_->Quit();
+  }
+
+  int pending_;
+  int failed_;
+  std::unique_ptr<base::RunLoop> run_loop_;
+};
+
+// Creates, writes, opens and reads entries with all the operations of each
+// step in flight at once, so that the shards work in parallel.
+void ShardedBackendPerformance(const base::FilePath& path, int shard_count) {
+  const int kEntryCount = 4000;
+  const int kDataSize = 8 * 1024;
+
+  disk_cache::ShardedBackendImpl cache(path, shard_count, nullptr);
+  ASSERT_TRUE(cache.SetMaxSize(200 * 1024 * 1024));
+  cache.SetFlags(disk_cache::kNoLoadProtection);
+  net::TestCompletionCallback cb;
+  ASSERT_EQ(net::OK, cb.GetResult(cache.Init(cb.callback())));
+
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kDataSize));
+  CacheTestFillBuffer(buffer->data(), kDataSize, false);
+  std::vector<disk_cache::Entry*> entries(kEntryCount, nullptr);
+  OperationCounter counter;
+
+  base::PerfTimeLogger timer(
+      base::StringPrintf("Create, write, open and read %d entries, %d shards",
+                         kEntryCount, shard_count)
+          .c_str());
+  for (int i = 0; i < kEntryCount; ++i) {
+    counter.Issued(cache.CreateEntry(base::StringPrintf("key %d", i),
+                                     &entries[i], counter.callback()));
+  }
+  ASSERT_EQ(0, counter.Wait());
+  for (disk_cache::Entry* entry : entries) {
+    counter.Issued(entry->WriteData(1, 0, buffer.get(), kDataSize,
+                                    counter.callback(), false));
+  }
+  ASSERT_EQ(0, counter.Wait());
+  for (disk_cache::Entry* entry : entries)
+    entry->Close();
+
+  for (int i = 0; i < kEntryCount; ++i) {
+    counter.Issued(cache.OpenEntry(base::StringPrintf("key %d", i),
+                                   &entries[i], counter.callback()));
+  }
+  ASSERT_EQ(0, counter.Wait());
+  for (disk_cache::Entry* entry : entries) {
+    counter.Issued(
+        entry->ReadData(1, 0, buffer.get(), kDataSize, counter.callback()));
+  }
+  ASSERT_EQ(0, counter.Wait());
+  for (disk_cache::Entry* entry : entries)
+    entry->Close();
+  timer.Done();
+}
+
+// Each shard of a blockfile cache has a thread of its own.
+TEST_F(DiskCachePerfTest, ShardedBlockfileScaling) {
+  ASSERT_TRUE(CleanupCacheDir());
+  for (int shard_count : {1, 2, 4, 8}) {
+    ShardedBackendPerformance(
+        cache_path_.AppendASCII(base::StringPrintf("sharded_%d", shard_count)),
+        shard_count);
+  }
+}
+
+// Appends network sized pieces to the streams of a memory cache, then reads
+// them back by copying them to a buffer, and by sharing the chunks that hold
+// them.
+TEST_F(DiskCachePerfTest, MemoryCacheStreamThroughput) {
+  const int kEntryCount = 200;
+  const int kStreamSize = 256 * 1024;
+  const int kWriteSize = 1460;
+  const int kReadSize = 32 * 1024;
+  SetMemoryOnlyMode();
+  SetMaxSize(kEntryCount * kStreamSize * 2);
+  InitCache();
+
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kReadSize));
+  CacheTestFillBuffer(buffer->data(), kReadSize, false);
+
+  base::PerfTimeLogger write_timer("Append to memory cache streams");
+  for (int i = 0; i < kEntryCount; ++i) {
+    disk_cache::Entry* entry;
+    ASSERT_EQ(net::OK, CreateEntry(base::StringPrintf("key %d", i), &entry));
+    for (int offset = 0; offset < kStreamSize; offset += kWriteSize) {
+      const int len = std::min(kWriteSize, kStreamSize - offset);
+      ASSERT_EQ(len, WriteData(entry, 1, offset, buffer.get(), len, false));
+    }
+    entry->Close();
+  }
+  write_timer.Done();
+
+  base::PerfTimeLogger copy_timer("Read memory cache streams into a buffer");
+  for (int i = 0; i < kEntryCount; ++i) {
+    disk_cache::Entry* entry;
+    ASSERT_EQ(net::OK, OpenEntry(base::StringPrintf("key %d", i), &entry));
+    for (int offset = 0; offset < kStreamSize; offset += kReadSize)
+      ASSERT_EQ(kReadSize, ReadData(entry, 1, offset, buffer.get(), kReadSize));
+    entry->Close();
+  }
+  copy_timer.Done();
+
+  base::PerfTimeLogger shared_timer("Read memory cache streams as chunks");
+  int64_t bytes_read = 0;
+  for (int i = 0; i < kEntryCount; ++i) {
+    disk_cache::Entry* entry;
+    ASSERT_EQ(net::OK, OpenEntry(base::StringPrintf("key %d", i), &entry));
+    scoped_refptr<net::IOBuffer> chunk;
+    for (int offset = 0; offset < kStreamSize;
+         offset += disk_cache::kMemChunkSize) {
+      bytes_read += entry->ReadSharedData(1, offset, disk_cache::kMemChunkSize,
+                                          &chunk, net::CompletionCallback());
+    }
+    entry->Close();
+  }
+  shared_timer.Done();
+  EXPECT_EQ(static_cast<int64_t>(kEntryCount) * kStreamSize, bytes_read);
+
+  base::StringPairs stats;
+  cache_->GetStats(&stats);
+  for (const auto& stat : stats)
+    LOG(INFO) << "Memory cache " << stat.first << ": " << stat.second;
+}
+
 int BlockSize() {
   // We can use form 1 to 4 blocks.
   return (rand() & 0x3) + 1;
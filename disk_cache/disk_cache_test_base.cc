@@ -82,6 +82,9 @@ DiskCacheTestWithCache::DiskCacheTestWithCache()
       memory_only_(false),
       simple_cache_mode_(false),
       simple_cache_wait_for_index_(true),
+      simple_cache_max_packed_entry_size_(0),
+      simple_cache_admission_policy_(
+          disk_cache::SimpleIndex::ADMISSION_POLICY_ALL),
       force_creation_(false),
       new_eviction_(false),
       first_cleanup_(true),
@@ -321,6 +324,8 @@ void DiskCacheTestWithCache::CreateBackend(uint32_t flags,
     std::unique_ptr<disk_cache::SimpleBackendImpl> simple_backend(
         new disk_cache::SimpleBackendImpl(cache_path_, size_, type_, runner,
                                           NULL));
+    simple_backend->SetMaxPackedEntrySize(simple_cache_max_packed_entry_size_);
+    simple_backend->SetAdmissionPolicy(simple_cache_admission_policy_);
     int rv = simple_backend->Init(cb.callback());
     ASSERT_THAT(cb.GetResult(rv), IsOk());
     simple_cache_impl_ = simple_backend.get();
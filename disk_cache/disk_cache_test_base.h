@@ -15,6 +15,7 @@
 #include "base/threading/thread.h"
 #include "net/base/cache_type.h"
 #include "net/disk_cache/disk_cache.h"
+#include "net/disk_cache/simple/simple_index.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "testing/platform_test.h"
 
@@ -107,6 +108,15 @@ class DiskCacheTestWithCache : public DiskCacheTest {
     simple_cache_wait_for_index_ = false;
   }
 
+  void SetSimpleCacheMaxPackedEntrySize(int size) {
+    simple_cache_max_packed_entry_size_ = size;
+  }
+
+  void SetSimpleCacheAdmissionPolicy(
+      disk_cache::SimpleIndex::AdmissionPolicy admission_policy) {
+    simple_cache_admission_policy_ = admission_policy;
+  }
+
   void DisableFirstCleanup() {
     first_cleanup_ = false;
   }
@@ -176,6 +186,8 @@ class DiskCacheTestWithCache : public DiskCacheTest {
   bool memory_only_;
   bool simple_cache_mode_;
   bool simple_cache_wait_for_index_;
+  int simple_cache_max_packed_entry_size_;
+  disk_cache::SimpleIndex::AdmissionPolicy simple_cache_admission_policy_;
   bool force_creation_;
   bool new_eviction_;
   bool first_cleanup_;
@@ -13,6 +13,7 @@
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/string_util.h"
 #include "base/threading/platform_thread.h"
+#include "build/build_config.h"
 #include "net/base/completion_callback.h"
 #include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
@@ -22,6 +23,7 @@
 #include "net/disk_cache/disk_cache_test_base.h"
 #include "net/disk_cache/disk_cache_test_util.h"
 #include "net/disk_cache/memory/mem_entry_impl.h"
+#include "net/disk_cache/memory/mem_stream.h"
 #include "net/disk_cache/simple/simple_backend_impl.h"
 #include "net/disk_cache/simple/simple_entry_format.h"
 #include "net/disk_cache/simple/simple_entry_impl.h"
@@ -1332,6 +1334,116 @@ TEST_F(DiskCacheEntryTest, MemoryOnlyReuseInternalEntry) {
   ReuseEntry(10 * 1024, 0);
 }
 
+// Tests that the memory cache accounts for the chunks that store the data of
+// an entry, and reports the size of the data itself.
+TEST_F(DiskCacheEntryTest, MemoryOnlyChunkAccounting) {
+  SetMemoryOnlyMode();
+  InitCache();
+
+  std::string key("the first key");
+  disk_cache::Entry* entry;
+  ASSERT_THAT(CreateEntry(key, &entry), IsOk());
+  disk_cache::MemEntryImpl* mem_entry =
+      static_cast<disk_cache::MemEntryImpl*>(entry);
+  const int kKeySize = static_cast<int>(key.size());
+  EXPECT_EQ(kKeySize, mem_entry->GetStorageSize());
+
+  const int kSize = 100;
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kSize));
+  CacheTestFillBuffer(buffer->data(), kSize, false);
+  EXPECT_EQ(kSize, WriteData(entry, 0, 0, buffer.get(), kSize, false));
+  EXPECT_EQ(kKeySize + disk_cache::kMinMemChunkSize,
+            mem_entry->GetStorageSize());
+  EXPECT_EQ(kKeySize + kSize, mem_entry->GetContentSize());
+
+  // A small stream moves to the next size class as it grows.
+  EXPECT_EQ(kSize, WriteData(entry, 0, 3 * kSize, buffer.get(), kSize, false));
+  EXPECT_EQ(kKeySize + 2 * disk_cache::kMinMemChunkSize,
+            mem_entry->GetStorageSize());
+  EXPECT_EQ(kKeySize + 4 * kSize, mem_entry->GetContentSize());
+  scoped_refptr<net::IOBuffer> read_buffer(new net::IOBuffer(kSize));
+  EXPECT_EQ(kSize, ReadData(entry, 0, 0, read_buffer.get(), kSize));
+  EXPECT_EQ(0, memcmp(read_buffer->data(), buffer->data(), kSize));
+
+  // A write past the end of the first chunk makes it whole, and takes one
+  // more.
+  EXPECT_EQ(kSize, WriteData(entry, 0, disk_cache::kMemChunkSize, buffer.get(),
+                             kSize, false));
+  EXPECT_EQ(kKeySize + 2 * disk_cache::kMemChunkSize,
+            mem_entry->GetStorageSize());
+  EXPECT_EQ(kKeySize + disk_cache::kMemChunkSize + kSize,
+            mem_entry->GetContentSize());
+  EXPECT_EQ(kKeySize + disk_cache::kMemChunkSize + kSize,
+            CalculateSizeOfAllEntries());
+  EXPECT_EQ(kSize, ReadData(entry, 0, 3 * kSize, read_buffer.get(), kSize));
+  EXPECT_EQ(0, memcmp(read_buffer->data(), buffer->data(), kSize));
+
+  // Truncating to a small size gives the chunks back.
+  EXPECT_EQ(kSize, WriteData(entry, 0, 0, buffer.get(), kSize, true));
+  EXPECT_EQ(kKeySize + disk_cache::kMinMemChunkSize,
+            mem_entry->GetStorageSize());
+  EXPECT_EQ(kSize, ReadData(entry, 0, 0, read_buffer.get(), kSize));
+  EXPECT_EQ(0, memcmp(read_buffer->data(), buffer->data(), kSize));
+
+  EXPECT_EQ(0, WriteData(entry, 0, 0, buffer.get(), 0, true));
+  EXPECT_EQ(kKeySize, mem_entry->GetStorageSize());
+  EXPECT_EQ(kKeySize, CalculateSizeOfAllEntries());
+  entry->Close();
+}
+
+// Tests that whole chunks of a memory entry can be read without a copy, and
+// that the data read stays the same when the entry is modified afterwards.
+TEST_F(DiskCacheEntryTest, MemoryOnlyReadSharedData) {
+  SetMemoryOnlyMode();
+  InitCache();
+
+  disk_cache::Entry* entry;
+  ASSERT_THAT(CreateEntry("the first key", &entry), IsOk());
+
+  const int kChunkSize = disk_cache::kMemChunkSize;
+  const int kSize = 2 * kChunkSize + 100;
+  scoped_refptr<net::IOBuffer> buffer1(new net::IOBuffer(kSize));
+  scoped_refptr<net::IOBuffer> buffer2(new net::IOBuffer(kSize));
+  CacheTestFillBuffer(buffer1->data(), kSize, false);
+  CacheTestFillBuffer(buffer2->data(), kSize, false);
+  EXPECT_EQ(kSize, WriteData(entry, 1, 0, buffer1.get(), kSize, false));
+
+  net::TestCompletionCallback cb;
+  scoped_refptr<net::IOBuffer> chunk1;
+  scoped_refptr<net::IOBuffer> chunk2;
+  scoped_refptr<net::IOBuffer> chunk3;
+  EXPECT_EQ(kChunkSize, entry->ReadSharedData(1, 0, kChunkSize, &chunk1,
+                                              cb.callback()));
+  EXPECT_EQ(0, memcmp(chunk1->data(), buffer1->data(), kChunkSize));
+
+  // Reading up to the end of the stream is served by the last chunk.
+  EXPECT_EQ(100, entry->ReadSharedData(1, 2 * kChunkSize, kChunkSize, &chunk2,
+                                       cb.callback()));
+  EXPECT_EQ(0, memcmp(chunk2->data(), buffer1->data() + 2 * kChunkSize, 100));
+
+  // Reads that do not fit a single chunk are copied.
+  EXPECT_EQ(100, entry->ReadSharedData(1, 10, 100, &chunk3, cb.callback()));
+  EXPECT_NE(chunk1.get(), chunk3.get());
+  EXPECT_EQ(0, memcmp(chunk3->data(), buffer1->data() + 10, 100));
+  EXPECT_EQ(2 * kChunkSize, entry->ReadSharedData(1, 0, 2 * kChunkSize,
+                                                  &chunk3, cb.callback()));
+  EXPECT_EQ(0, memcmp(chunk3->data(), buffer1->data(), 2 * kChunkSize));
+  EXPECT_EQ(0, entry->ReadSharedData(1, 3 * kChunkSize, kChunkSize, &chunk3,
+                                     cb.callback()));
+
+  // The entry gets a copy of the chunk shared with the reader.
+  EXPECT_EQ(kSize, WriteData(entry, 1, 0, buffer2.get(), kSize, true));
+  EXPECT_EQ(0, memcmp(chunk1->data(), buffer1->data(), kChunkSize));
+  scoped_refptr<net::IOBuffer> buffer3(new net::IOBuffer(kSize));
+  EXPECT_EQ(kSize, ReadData(entry, 1, 0, buffer3.get(), kSize));
+  EXPECT_EQ(0, memcmp(buffer3->data(), buffer2->data(), kSize));
+
+  // And the chunk outlives the entry.
+  entry->Doom();
+  entry->Close();
+  EXPECT_EQ(0, memcmp(chunk1->data(), buffer1->data(), kChunkSize));
+}
+
 // Reading somewhere that was not written should return zeros.
 void DiskCacheEntryTest::InvalidData(int stream_index) {
   std::string key("the first key");
@@ -2745,6 +2857,94 @@ TEST_F(DiskCacheEntryTest, SimpleCacheNoEOF) {
   DisableIntegrityCheck();
 }
 
+#if defined(OS_POSIX)
+// Tests that opening a small entry reads its streams 0 and 1 in full, so that
+// they are read without further I/O.
+TEST_F(DiskCacheEntryTest, SimpleCacheSmallEntryReadWithOpen) {
+  SetSimpleCacheMode();
+  InitCache();
+
+  const std::string key("the first key");
+  const int kHeadersSize = 300;
+  const int kDataSize = 5000;
+  scoped_refptr<net::IOBuffer> headers(new net::IOBuffer(kHeadersSize));
+  scoped_refptr<net::IOBuffer> data(new net::IOBuffer(kDataSize));
+  CacheTestFillBuffer(headers->data(), kHeadersSize, false);
+  CacheTestFillBuffer(data->data(), kDataSize, false);
+
+  disk_cache::Entry* entry = NULL;
+  ASSERT_THAT(CreateEntry(key, &entry), IsOk());
+  EXPECT_EQ(kHeadersSize,
+            WriteData(entry, 0, 0, headers.get(), kHeadersSize, false));
+  EXPECT_EQ(kDataSize, WriteData(entry, 1, 0, data.get(), kDataSize, false));
+  entry->Close();
+
+  // Force the entry to flush to disk, so subsequent platform file operations
+  // succeed.
+  ASSERT_THAT(OpenEntry(key, &entry), IsOk());
+  entry->Close();
+
+  ASSERT_THAT(OpenEntry(key, &entry), IsOk());
+  ScopedEntryPtr entry_closer(entry);
+
+  // The entry file is gone from under the open entry.
+  const base::FilePath entry_path = cache_path_.AppendASCII(
+      disk_cache::simple_util::GetFilenameFromKeyAndFileIndex(key, 0));
+  EXPECT_TRUE(TruncatePath(entry_path, 0));
+
+  scoped_refptr<net::IOBuffer> read_buffer(new net::IOBuffer(kDataSize));
+  EXPECT_EQ(kHeadersSize,
+            ReadData(entry, 0, 0, read_buffer.get(), kHeadersSize));
+  EXPECT_EQ(0, memcmp(headers->data(), read_buffer->data(), kHeadersSize));
+  EXPECT_EQ(kDataSize, ReadData(entry, 1, 0, read_buffer.get(), kDataSize));
+  EXPECT_EQ(0, memcmp(data->data(), read_buffer->data(), kDataSize));
+  EXPECT_EQ(100, ReadData(entry, 1, 4000, read_buffer.get(), 100));
+  EXPECT_EQ(0, memcmp(data->data() + 4000, read_buffer->data(), 100));
+  DisableIntegrityCheck();
+}
+#endif  // defined(OS_POSIX)
+
+// Tests the reads of an entry too large to be read whole when opened, within
+// and across the ranges of its file read then.
+TEST_F(DiskCacheEntryTest, SimpleCacheLargeEntryReadWithOpen) {
+  SetSimpleCacheMode();
+  InitCache();
+
+  const std::string key("the first key");
+  const int kHeadersSize = 300;
+  const int kDataSize = 100 * 1024;
+  scoped_refptr<net::IOBuffer> headers(new net::IOBuffer(kHeadersSize));
+  scoped_refptr<net::IOBuffer> data(new net::IOBuffer(kDataSize));
+  CacheTestFillBuffer(headers->data(), kHeadersSize, false);
+  CacheTestFillBuffer(data->data(), kDataSize, false);
+
+  disk_cache::Entry* entry = NULL;
+  ASSERT_THAT(CreateEntry(key, &entry), IsOk());
+  EXPECT_EQ(kHeadersSize,
+            WriteData(entry, 0, 0, headers.get(), kHeadersSize, false));
+  EXPECT_EQ(kDataSize, WriteData(entry, 1, 0, data.get(), kDataSize, false));
+  entry->Close();
+
+  ASSERT_THAT(OpenEntry(key, &entry), IsOk());
+  scoped_refptr<net::IOBuffer> read_buffer(new net::IOBuffer(kDataSize));
+  EXPECT_EQ(kHeadersSize,
+            ReadData(entry, 0, 0, read_buffer.get(), kHeadersSize));
+  EXPECT_EQ(0, memcmp(headers->data(), read_buffer->data(), kHeadersSize));
+  EXPECT_EQ(1000, ReadData(entry, 1, 0, read_buffer.get(), 1000));
+  EXPECT_EQ(0, memcmp(data->data(), read_buffer->data(), 1000));
+  EXPECT_EQ(kDataSize - 1000,
+            ReadData(entry, 1, 1000, read_buffer.get(), kDataSize));
+  EXPECT_EQ(0,
+            memcmp(data->data() + 1000, read_buffer->data(), kDataSize - 1000));
+  entry->Close();
+
+  // A single read of the whole stream checks its crc.
+  ASSERT_THAT(OpenEntry(key, &entry), IsOk());
+  EXPECT_EQ(kDataSize, ReadData(entry, 1, 0, read_buffer.get(), kDataSize));
+  EXPECT_EQ(0, memcmp(data->data(), read_buffer->data(), kDataSize));
+  entry->Close();
+}
+
 TEST_F(DiskCacheEntryTest, SimpleCacheNonOptimisticOperationsBasic) {
   // Test sequence:
   // Create, Write, Read, Close.
@@ -3967,6 +4167,43 @@ TEST_F(DiskCacheEntryTest, SimpleCacheOmittedThirdStream5) {
   EXPECT_FALSE(SimpleCacheThirdStreamFileExists(key));
 }
 
+// Tests that the first read of the third stream, which reads the header of its
+// file along with the data, fails if the header is corrupt.
+TEST_F(DiskCacheEntryTest, SimpleCacheThirdStreamBadHeader) {
+  // This test runs as APP_CACHE to make operations more synchronous.
+  SetCacheType(net::APP_CACHE);
+  SetSimpleCacheMode();
+  InitCache();
+
+  const int kSize = 16;
+  const char key[] = "key";
+  scoped_refptr<net::IOBuffer> buffer1(new net::IOBuffer(kSize));
+  scoped_refptr<net::IOBuffer> buffer2(new net::IOBuffer(kSize));
+  CacheTestFillBuffer(buffer1->data(), kSize, false);
+
+  disk_cache::Entry* entry;
+  ASSERT_THAT(CreateEntry(key, &entry), IsOk());
+  EXPECT_EQ(kSize, WriteData(entry, 2, 0, buffer1.get(), kSize, true));
+  entry->Close();
+
+  base::RunLoop().RunUntilIdle();
+  disk_cache::SimpleBackendImpl::FlushWorkerPoolForTesting();
+  base::RunLoop().RunUntilIdle();
+
+  // Corrupt the magic number of the file of the third stream.
+  base::File entry_file1(
+      cache_path_.AppendASCII(
+          disk_cache::simple_util::GetFilenameFromKeyAndFileIndex(key, 1)),
+      base::File::FLAG_WRITE | base::File::FLAG_OPEN);
+  ASSERT_TRUE(entry_file1.IsValid());
+  EXPECT_EQ(1, entry_file1.Write(0, "X", 1));
+  entry_file1.Close();
+
+  ASSERT_THAT(OpenEntry(key, &entry), IsOk());
+  EXPECT_EQ(net::ERR_FAILED, ReadData(entry, 2, 0, buffer2.get(), kSize));
+  entry->Close();
+}
+
 // There could be a race between Doom and an optimistic write.
 TEST_F(DiskCacheEntryTest, SimpleCacheDoomOptimisticWritesRace) {
   // Test sequence:
@@ -4274,3 +4511,86 @@ TEST_F(DiskCacheEntryTest, SimpleCacheReadCorruptKeySHA256) {
       disk_cache::simple_util::CorruptKeySHA256FromEntry(key, cache_path_));
   EXPECT_NE(net::OK, OpenEntry(key, &entry));
 }
+
+// Small entries are packed in the segment store, and get no files of their
+// own.
+TEST_F(DiskCacheEntryTest, SimpleCachePackedEntry) {
+  // This test runs as APP_CACHE to make operations more synchronous.
+  SetCacheType(net::APP_CACHE);
+  SetSimpleCacheMode();
+  SetSimpleCacheMaxPackedEntrySize(4096);
+  InitCache();
+
+  const int kSize = 200;
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kSize));
+  CacheTestFillBuffer(buffer->data(), kSize, false);
+  const char key[] = "packed key";
+  disk_cache::Entry* entry;
+  ASSERT_THAT(CreateEntry(key, &entry), IsOk());
+  for (int i = 0; i < disk_cache::kSimpleEntryStreamCount; ++i)
+    EXPECT_EQ(kSize, WriteData(entry, i, 0, buffer.get(), kSize, false));
+  entry->Close();
+  base::RunLoop().RunUntilIdle();
+  disk_cache::SimpleBackendImpl::FlushWorkerPoolForTesting();
+  base::RunLoop().RunUntilIdle();
+
+  EXPECT_FALSE(base::PathExists(cache_path_.AppendASCII(
+      disk_cache::simple_util::GetFilenameFromKeyAndFileIndex(key, 0))));
+  EXPECT_FALSE(SimpleCacheThirdStreamFileExists(key));
+
+  // The entry survives a restart of the backend.
+  cache_.reset();
+  disk_cache::SimpleBackendImpl::FlushWorkerPoolForTesting();
+  DisableFirstCleanup();
+  InitCache();
+
+  ASSERT_THAT(OpenEntry(key, &entry), IsOk());
+  scoped_refptr<net::IOBuffer> read_buffer(new net::IOBuffer(kSize));
+  for (int i = 0; i < disk_cache::kSimpleEntryStreamCount; ++i) {
+    EXPECT_EQ(kSize, entry->GetDataSize(i));
+    EXPECT_EQ(kSize, ReadData(entry, i, 0, read_buffer.get(), kSize));
+    EXPECT_EQ(0, memcmp(buffer->data(), read_buffer->data(), kSize));
+  }
+  entry->Close();
+
+  SyncDoomEntry(key);
+  EXPECT_NE(net::OK, OpenEntry(key, &entry));
+}
+
+// An entry that outgrows the packing threshold moves to files of its own.
+TEST_F(DiskCacheEntryTest, SimpleCachePackedEntryOutgrown) {
+  SetCacheType(net::APP_CACHE);
+  SetSimpleCacheMode();
+  SetSimpleCacheMaxPackedEntrySize(4096);
+  InitCache();
+
+  const int kSmallSize = 100;
+  const int kLargeSize = 20000;
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kLargeSize));
+  CacheTestFillBuffer(buffer->data(), kLargeSize, false);
+  const char key[] = "outgrown key";
+  disk_cache::Entry* entry;
+  ASSERT_THAT(CreateEntry(key, &entry), IsOk());
+  EXPECT_EQ(kSmallSize, WriteData(entry, 1, 0, buffer.get(), kSmallSize,
+                                  false));
+  entry->Close();
+  base::RunLoop().RunUntilIdle();
+  disk_cache::SimpleBackendImpl::FlushWorkerPoolForTesting();
+  base::RunLoop().RunUntilIdle();
+
+  ASSERT_THAT(OpenEntry(key, &entry), IsOk());
+  EXPECT_EQ(kLargeSize, WriteData(entry, 1, 0, buffer.get(), kLargeSize,
+                                  false));
+  entry->Close();
+  base::RunLoop().RunUntilIdle();
+  disk_cache::SimpleBackendImpl::FlushWorkerPoolForTesting();
+  base::RunLoop().RunUntilIdle();
+
+  EXPECT_TRUE(base::PathExists(cache_path_.AppendASCII(
+      disk_cache::simple_util::GetFilenameFromKeyAndFileIndex(key, 0))));
+  ASSERT_THAT(OpenEntry(key, &entry), IsOk());
+  ScopedEntryPtr entry_closer(entry);
+  scoped_refptr<net::IOBuffer> read_buffer(new net::IOBuffer(kLargeSize));
+  EXPECT_EQ(kLargeSize, ReadData(entry, 1, 0, read_buffer.get(), kLargeSize));
+  EXPECT_EQ(0, memcmp(buffer->data(), read_buffer->data(), kLargeSize));
+}
@@ -9,6 +9,7 @@
 #include <utility>
 
 #include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/sys_info.h"
 #include "net/base/net_errors.h"
 #include "net/disk_cache/cache_util.h"
@@ -38,14 +39,18 @@ bool CheckLRUListOrder(const base::LinkedList<MemEntryImpl>& lru_list) {
 }  // namespace
 
 MemBackendImpl::MemBackendImpl(net::NetLog* net_log)
-    : max_size_(0), current_size_(0), net_log_(net_log), weak_factory_(this) {
-}
+    : max_size_(0),
+      current_size_(0),
+      content_size_(0),
+      net_log_(net_log),
+      weak_factory_(this) {}
 
 MemBackendImpl::~MemBackendImpl() {
   DCHECK(CheckLRUListOrder(lru_list_));
   while (!entries_.empty())
     entries_.begin()->second->Doom();
   DCHECK(!current_size_);
+  DCHECK(!content_size_);
 }
 
 // static
@@ -67,7 +72,7 @@ bool MemBackendImpl::Init() {
   int64_t total_memory = base::SysInfo::AmountOfPhysicalMemory();
 
   if (total_memory <= 0) {
-    max_size_ = kDefaultInMemoryCacheSize;
+    SetMaxSize(kDefaultInMemoryCacheSize);
     return true;
   }
 
@@ -75,9 +80,9 @@ bool MemBackendImpl::Init() {
   // reached on system with more than 2.5 GB of RAM.
   total_memory = total_memory * 2 / 100;
   if (total_memory > kDefaultInMemoryCacheSize * 5)
-    max_size_ = kDefaultInMemoryCacheSize * 5;
+    SetMaxSize(kDefaultInMemoryCacheSize * 5);
   else
-    max_size_ = static_cast<int32_t>(total_memory);
+    SetMaxSize(static_cast<int32_t>(total_memory));
 
   return true;
 }
@@ -93,6 +98,10 @@ bool MemBackendImpl::SetMaxSize(int max_bytes) {
     return true;
 
   max_size_ = max_bytes;
+
+  // The pool keeps enough chunks to refill what an eviction releases.
+  chunk_pool_.set_max_pooled_bytes(
+      std::min(max_size_ / 10, kDefaultEvictionSize));
   return true;
 }
 
@@ -119,8 +128,9 @@ void MemBackendImpl::OnEntryDoomed(MemEntryImpl* entry) {
   entry->RemoveFromList();
 }
 
-void MemBackendImpl::ModifyStorageSize(int32_t delta) {
+void MemBackendImpl::ModifyStorageSize(int32_t delta, int32_t content_delta) {
   current_size_ += delta;
+  content_size_ += content_delta;
   if (delta > 0)
     EvictIfNeeded();
 }
@@ -202,7 +212,7 @@ int MemBackendImpl::DoomEntriesSince(Time initial_time,
 
 int MemBackendImpl::CalculateSizeOfAllEntries(
     const CompletionCallback& callback) {
-  return current_size_;
+  return content_size_;
 }
 
 class MemBackendImpl::MemIterator final : public Backend::Iterator {
@@ -247,6 +257,18 @@ std::unique_ptr<Backend::Iterator> MemBackendImpl::CreateIterator() {
       new MemIterator(weak_factory_.GetWeakPtr()));
 }
 
+void MemBackendImpl::GetStats(base::StringPairs* stats) {
+  stats->push_back(std::make_pair("Max size", base::IntToString(max_size_)));
+  stats->push_back(
+      std::make_pair("Storage size", base::IntToString(current_size_)));
+  stats->push_back(
+      std::make_pair("Content size", base::IntToString(content_size_)));
+  stats->push_back(std::make_pair(
+      "Chunks in use", base::IntToString(chunk_pool_.chunks_in_use())));
+  stats->push_back(std::make_pair(
+      "Pooled chunks", base::IntToString(chunk_pool_.pooled_chunks())));
+}
+
 void MemBackendImpl::OnExternalCacheHit(const std::string& key) {
   EntryMap::iterator it = entries_.find(key);
   if (it != entries_.end())
@@ -20,6 +20,7 @@
 #include "base/time/time.h"
 #include "net/disk_cache/disk_cache.h"
 #include "net/disk_cache/memory/mem_entry_impl.h"
+#include "net/disk_cache/memory/mem_stream.h"
 
 namespace net {
 class NetLog;
@@ -68,9 +69,14 @@ class NET_EXPORT_PRIVATE MemBackendImpl final : public Backend {
   // |lru_list_|.
   void OnEntryDoomed(MemEntryImpl* entry);
 
-  // Adjust the current size of this backend by |delta|. This is used to
-  // determine if eviction is neccessary and when eviction is finished.
-  void ModifyStorageSize(int32_t delta);
+  // Adjust the current size of this backend by |delta|, the change of the
+  // storage size of an entry. This is used to determine if eviction is
+  // neccessary and when eviction is finished. |content_delta| is the change of
+  // the size of the key and data of the entry.
+  void ModifyStorageSize(int32_t delta, int32_t content_delta);
+
+  // The pool of the chunks that store the data of the entries.
+  MemChunkPool* chunk_pool() { return &chunk_pool_; }
 
   // Backend interface.
   net::CacheType GetCacheType() const override;
@@ -91,7 +97,7 @@ class NET_EXPORT_PRIVATE MemBackendImpl final : public Backend {
                        const CompletionCallback& callback) override;
   int CalculateSizeOfAllEntries(const CompletionCallback& callback) override;
   std::unique_ptr<Iterator> CreateIterator() override;
-  void GetStats(base::StringPairs* stats) override {}
+  void GetStats(base::StringPairs* stats) override;
   void OnExternalCacheHit(const std::string& key) override;
 
  private:
@@ -110,7 +116,10 @@ class NET_EXPORT_PRIVATE MemBackendImpl final : public Backend {
   base::LinkedList<MemEntryImpl> lru_list_;
 
   int32_t max_size_;      // Maximum data size for this instance.
-  int32_t current_size_;
+  int32_t current_size_;  // Storage size of all the entries.
+  int32_t content_size_;  // Size of the keys and data of all the entries.
+
+  MemChunkPool chunk_pool_;
 
   net::NetLog* net_log_;
 
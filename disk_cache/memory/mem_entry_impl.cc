@@ -14,6 +14,7 @@
 #include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/disk_cache/memory/mem_backend_impl.h"
+#include "net/disk_cache/memory/mem_stream.h"
 #include "net/disk_cache/net_log_parameters.h"
 
 using base::Time;
@@ -79,7 +80,7 @@ MemEntryImpl::MemEntryImpl(MemBackendImpl* backend,
                    nullptr,  // parent
                    net_log) {
   Open();
-  backend_->ModifyStorageSize(GetStorageSize());
+  backend_->ModifyStorageSize(GetStorageSize(), GetContentSize());
 }
 
 MemEntryImpl::MemEntryImpl(MemBackendImpl* backend,
@@ -112,10 +113,17 @@ bool MemEntryImpl::InUse() const {
 int MemEntryImpl::GetStorageSize() const {
   int storage_size = static_cast<int32_t>(key_.size());
   for (const auto& i : data_)
-    storage_size += i.size();
+    storage_size += i->storage_size();
   return storage_size;
 }
 
+int MemEntryImpl::GetContentSize() const {
+  int content_size = static_cast<int32_t>(key_.size());
+  for (const auto& i : data_)
+    content_size += i->size();
+  return content_size;
+}
+
 void MemEntryImpl::UpdateStateOnUse(EntryModified modified_enum) {
   if (!doomed_)
     backend_->OnEntryUpdated(this);
@@ -160,7 +168,7 @@ Time MemEntryImpl::GetLastModified() const {
 int32_t MemEntryImpl::GetDataSize(int index) const {
   if (index < 0 || index >= kNumStreams)
     return 0;
-  return data_[index].size();
+  return data_[index]->size();
 }
 
 int MemEntryImpl::ReadData(int index, int offset, IOBuffer* buf, int buf_len,
@@ -181,6 +189,45 @@ int MemEntryImpl::ReadData(int index, int offset, IOBuffer* buf, int buf_len,
   return result;
 }
 
+int MemEntryImpl::ReadSharedData(int index,
+                                 int offset,
+                                 int buf_len,
+                                 scoped_refptr<IOBuffer>* buf,
+                                 const CompletionCallback& callback) {
+  DCHECK_EQ(PARENT_ENTRY, type());
+
+  // The chunk holding the data can be handed out as is when |offset| starts
+  // it and |buf_len| does not reach past it, or past the end of the stream.
+  // Later writes to the entry copy the chunk before changing it.
+  if (index < 0 || index >= kNumStreams || offset < 0 ||
+      offset % kMemChunkSize || buf_len <= 0 ||
+      offset >= data_[index]->size()) {
+    return Entry::ReadSharedData(index, offset, buf_len, buf, callback);
+  }
+
+  int len;
+  scoped_refptr<IOBuffer> chunk = data_[index]->GetChunk(offset, &len);
+  if (buf_len > len && offset + len < data_[index]->size())
+    return Entry::ReadSharedData(index, offset, buf_len, buf, callback);
+
+  if (net_log_.IsCapturing()) {
+    net_log_.BeginEvent(
+        net::NetLog::TYPE_ENTRY_READ_DATA,
+        CreateNetLogReadWriteDataCallback(index, offset, buf_len, false));
+  }
+
+  UpdateStateOnUse(ENTRY_WAS_NOT_MODIFIED);
+  *buf = std::move(chunk);
+  int result = std::min(buf_len, len);
+
+  if (net_log_.IsCapturing()) {
+    net_log_.EndEvent(
+        net::NetLog::TYPE_ENTRY_READ_DATA,
+        CreateNetLogReadWriteCompleteCallback(result));
+  }
+  return result;
+}
+
 int MemEntryImpl::WriteData(int index, int offset, IOBuffer* buf, int buf_len,
                             const CompletionCallback& callback, bool truncate) {
   if (net_log_.IsCapturing()) {
@@ -272,6 +319,8 @@ MemEntryImpl::MemEntryImpl(MemBackendImpl* backend,
       last_used_(last_modified_),
       backend_(backend),
       doomed_(false) {
+  for (auto& stream : data_)
+    stream.reset(new MemStream(backend_->chunk_pool()));
   backend_->OnEntryInserted(this);
   net_log_ =
       net::BoundNetLog::Make(net_log, net::NetLog::SOURCE_MEMORY_CACHE_ENTRY);
@@ -280,7 +329,7 @@ MemEntryImpl::MemEntryImpl(MemBackendImpl* backend,
 }
 
 MemEntryImpl::~MemEntryImpl() {
-  backend_->ModifyStorageSize(-GetStorageSize());
+  backend_->ModifyStorageSize(-GetStorageSize(), -GetContentSize());
 
   if (type() == PARENT_ENTRY) {
     if (children_) {
@@ -307,7 +356,7 @@ int MemEntryImpl::InternalReadData(int index, int offset, IOBuffer* buf,
   if (index < 0 || index >= kNumStreams || buf_len < 0)
     return net::ERR_INVALID_ARGUMENT;
 
-  int entry_size = data_[index].size();
+  int entry_size = data_[index]->size();
   if (offset >= entry_size || offset < 0 || !buf_len)
     return 0;
 
@@ -315,8 +364,7 @@ int MemEntryImpl::InternalReadData(int index, int offset, IOBuffer* buf,
     buf_len = entry_size - offset;
 
   UpdateStateOnUse(ENTRY_WAS_NOT_MODIFIED);
-  std::copy(data_[index].begin() + offset,
-            data_[index].begin() + offset + buf_len, buf->data());
+  data_[index]->Read(offset, buf->data(), buf_len);
   return buf_len;
 }
 
@@ -338,25 +386,26 @@ int MemEntryImpl::InternalWriteData(int index, int offset, IOBuffer* buf,
     return net::ERR_FAILED;
   }
 
-  int old_data_size = data_[index].size();
-  if (truncate || old_data_size < offset + buf_len) {
-    data_[index].resize(offset + buf_len);
+  MemStream* stream = data_[index].get();
+  int old_data_size = stream->size();
+  int old_storage_size = stream->storage_size();
 
-    // Zero fill any hole.
-    if (old_data_size < offset) {
-      std::fill(data_[index].begin() + old_data_size,
-                data_[index].begin() + offset, 0);
-    }
+  // Zero fill any hole, or drop the data past |offset| when truncating: the
+  // write then goes at the end of the stream.
+  if (old_data_size < offset ||
+      (truncate && old_data_size > offset + buf_len)) {
+    stream->SetSize(offset);
+  }
+  if (buf_len)
+    stream->Write(offset, buf->data(), buf_len);
 
-    backend_->ModifyStorageSize(data_[index].size() - old_data_size);
+  if (stream->size() != old_data_size ||
+      stream->storage_size() != old_storage_size) {
+    backend_->ModifyStorageSize(stream->storage_size() - old_storage_size,
+                                stream->size() - old_data_size);
   }
 
   UpdateStateOnUse(ENTRY_WAS_MODIFIED);
-
-  if (!buf_len)
-    return 0;
-
-  std::copy(buf->data(), buf->data() + buf_len, data_[index].begin() + offset);
   return buf_len;
 }
 
@@ -10,11 +10,11 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
-#include <vector>
 
 #include "base/containers/linked_list.h"
 #include "base/gtest_prod_util.h"
 #include "base/macros.h"
+#include "base/memory/ref_counted.h"
 #include "base/time/time.h"
 #include "net/disk_cache/disk_cache.h"
 #include "net/log/net_log.h"
@@ -22,6 +22,7 @@
 namespace disk_cache {
 
 class MemBackendImpl;
+class MemStream;
 
 // This class implements the Entry interface for the memory-only cache. An
 // object of this class represents a single entry on the cache. We use two types
@@ -49,6 +50,10 @@ class MemBackendImpl;
 // region, and the unfilled region (if there is one) is always before the filled
 // region. The book keeping for filled region in a sparse entry is done by using
 // the variable |child_first_pos_|.
+//
+// The data of each stream is kept in chunks taken from the chunk pool of the
+// backend (see MemStream). Reads of whole chunks can share them with the caller
+// instead of copying them.
 
 class NET_EXPORT_PRIVATE MemEntryImpl final
     : public Entry,
@@ -85,9 +90,13 @@ class NET_EXPORT_PRIVATE MemEntryImpl final
   int child_id() const { return child_id_; }
   base::Time last_used() const { return last_used_; }
 
-  // The in-memory size of this entry to use for the purposes of eviction.
+  // The in-memory size of this entry to use for the purposes of eviction: the
+  // size of the key and of the chunks that store the data.
   int GetStorageSize() const;
 
+  // The size of the key and of the data of this entry.
+  int GetContentSize() const;
+
   // Update an entry's position in the backend LRU list and set |last_used_|. If
   // the entry was modified, also update |last_modified_|.
   void UpdateStateOnUse(EntryModified modified_enum);
@@ -104,6 +113,11 @@ class NET_EXPORT_PRIVATE MemEntryImpl final
                IOBuffer* buf,
                int buf_len,
                const CompletionCallback& callback) override;
+  int ReadSharedData(int index,
+                     int offset,
+                     int buf_len,
+                     scoped_refptr<IOBuffer>* buf,
+                     const CompletionCallback& callback) override;
   int WriteData(int index,
                 int offset,
                 IOBuffer* buf,
@@ -164,7 +178,7 @@ class NET_EXPORT_PRIVATE MemEntryImpl final
   int FindNextChild(int64_t offset, int len, MemEntryImpl** child);
 
   std::string key_;
-  std::vector<char> data_[kNumStreams];  // User data.
+  std::unique_ptr<MemStream> data_[kNumStreams];  // User data.
   int ref_count_;
 
   int child_id_;              // The ID of a child entry.
@@ -0,0 +1,197 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/memory/mem_stream.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "base/logging.h"
+#include "net/base/io_buffer.h"
+
+namespace disk_cache {
+
+namespace {
+
+// Number of chunks needed to store |size| bytes.
+size_t ChunksForSize(int size) {
+  return (size + kMemChunkSize - 1) / kMemChunkSize;
+}
+
+// Size of the chunk of a stream of |size| bytes that fits in a single chunk.
+int SmallChunkSize(int size) {
+  DCHECK_LE(size, kMemChunkSize);
+  int chunk_size = kMinMemChunkSize;
+  while (chunk_size < size)
+    chunk_size *= 2;
+  return chunk_size;
+}
+
+}  // namespace
+
+MemChunkPool::MemChunkPool() : max_pooled_chunks_(0), chunks_in_use_(0) {}
+
+MemChunkPool::~MemChunkPool() {
+  DCHECK(!chunks_in_use_);
+}
+
+void MemChunkPool::set_max_pooled_bytes(int max_pooled_bytes) {
+  DCHECK_GE(max_pooled_bytes, 0);
+  max_pooled_chunks_ = max_pooled_bytes / kMemChunkSize;
+  if (free_chunks_.size() > max_pooled_chunks_)
+    free_chunks_.resize(max_pooled_chunks_);
+}
+
+scoped_refptr<net::IOBuffer> MemChunkPool::GetChunk() {
+  chunks_in_use_++;
+  if (free_chunks_.empty())
+    return new net::IOBuffer(kMemChunkSize);
+
+  scoped_refptr<net::IOBuffer> chunk = std::move(free_chunks_.back());
+  free_chunks_.pop_back();
+  return chunk;
+}
+
+void MemChunkPool::ReleaseChunk(scoped_refptr<net::IOBuffer> chunk) {
+  DCHECK(chunk);
+  DCHECK_GT(chunks_in_use_, 0);
+  chunks_in_use_--;
+  if (chunk->HasOneRef() && free_chunks_.size() < max_pooled_chunks_)
+    free_chunks_.push_back(std::move(chunk));
+}
+
+MemStream::MemStream(MemChunkPool* pool)
+    : pool_(pool), size_(0), first_chunk_size_(0) {}
+
+MemStream::~MemStream() {
+  SetSize(0);
+}
+
+void MemStream::Read(int offset, char* buf, int len) const {
+  DCHECK_GE(offset, 0);
+  DCHECK_GE(len, 0);
+  DCHECK_LE(offset + len, size_);
+  while (len) {
+    const int chunk_offset = offset % kMemChunkSize;
+    const int bytes = std::min(len, kMemChunkSize - chunk_offset);
+    memcpy(buf, chunks_[offset / kMemChunkSize]->data() + chunk_offset, bytes);
+    buf += bytes;
+    offset += bytes;
+    len -= bytes;
+  }
+}
+
+void MemStream::Write(int offset, const char* buf, int len) {
+  DCHECK_GE(offset, 0);
+  DCHECK_GE(len, 0);
+  if (offset > size_)
+    SetSize(offset);
+
+  Reserve(offset + len);
+  size_ = std::max(size_, offset + len);
+
+  while (len) {
+    const int chunk_offset = offset % kMemChunkSize;
+    const int bytes = std::min(len, kMemChunkSize - chunk_offset);
+    memcpy(GetWritableChunk(offset / kMemChunkSize) + chunk_offset, buf, bytes);
+    buf += bytes;
+    offset += bytes;
+    len -= bytes;
+  }
+}
+
+void MemStream::SetSize(int size) {
+  DCHECK_GE(size, 0);
+  if (size <= size_) {
+    const size_t needed_chunks = ChunksForSize(size);
+    while (chunks_.size() > needed_chunks) {
+      ReleaseChunk(std::move(chunks_.back()),
+                   chunks_.size() == 1 ? first_chunk_size_ : kMemChunkSize);
+      chunks_.pop_back();
+    }
+    size_ = size;
+    if (chunks_.empty())
+      first_chunk_size_ = 0;
+    else if (chunks_.size() == 1 && SmallChunkSize(size) < first_chunk_size_)
+      ResizeFirstChunk(SmallChunkSize(size));
+    return;
+  }
+
+  // The bytes past the end of the stream are undefined, so they are cleared
+  // as the stream grows over them.
+  Reserve(size);
+  while (size_ < size) {
+    const int chunk_offset = size_ % kMemChunkSize;
+    const int bytes = std::min(size - size_, kMemChunkSize - chunk_offset);
+    memset(GetWritableChunk(size_ / kMemChunkSize) + chunk_offset, 0, bytes);
+    size_ += bytes;
+  }
+}
+
+scoped_refptr<net::IOBuffer> MemStream::GetChunk(int offset, int* len) const {
+  DCHECK_EQ(0, offset % kMemChunkSize);
+  DCHECK_GE(offset, 0);
+  DCHECK_LT(offset, size_);
+  *len = std::min(size_ - offset, kMemChunkSize);
+  return chunks_[offset / kMemChunkSize];
+}
+
+void MemStream::Reserve(int size) {
+  const size_t needed_chunks = ChunksForSize(size);
+  if (needed_chunks <= 1 && chunks_.size() <= 1) {
+    if (size && SmallChunkSize(size) > first_chunk_size_)
+      ResizeFirstChunk(SmallChunkSize(size));
+    return;
+  }
+
+  // A stream of several chunks only has whole ones.
+  if (first_chunk_size_ < kMemChunkSize)
+    ResizeFirstChunk(kMemChunkSize);
+  while (chunks_.size() < needed_chunks)
+    chunks_.push_back(pool_->GetChunk());
+}
+
+void MemStream::ResizeFirstChunk(int chunk_size) {
+  DCHECK_LE(chunks_.size(), 1u);
+  DCHECK_LE(size_, chunk_size);
+  scoped_refptr<net::IOBuffer> chunk = NewChunk(chunk_size);
+  if (chunks_.empty()) {
+    chunks_.push_back(std::move(chunk));
+  } else {
+    memcpy(chunk->data(), chunks_[0]->data(), size_);
+    ReleaseChunk(std::move(chunks_[0]), first_chunk_size_);
+    chunks_[0] = std::move(chunk);
+  }
+  first_chunk_size_ = chunk_size;
+}
+
+scoped_refptr<net::IOBuffer> MemStream::NewChunk(int chunk_size) {
+  if (chunk_size == kMemChunkSize)
+    return pool_->GetChunk();
+  return new net::IOBuffer(chunk_size);
+}
+
+void MemStream::ReleaseChunk(scoped_refptr<net::IOBuffer> chunk,
+                             int chunk_size) {
+  // The small chunks of the streams are not pooled.
+  if (chunk_size == kMemChunkSize)
+    pool_->ReleaseChunk(std::move(chunk));
+}
+
+char* MemStream::GetWritableChunk(size_t index) {
+  DCHECK_LT(index, chunks_.size());
+  if (!chunks_[index]->HasOneRef()) {
+    // A reader holds this chunk.
+    const int chunk_size = index ? kMemChunkSize : first_chunk_size_;
+    scoped_refptr<net::IOBuffer> copy = NewChunk(chunk_size);
+    memcpy(copy->data(), chunks_[index]->data(), chunk_size);
+    ReleaseChunk(std::move(chunks_[index]), chunk_size);
+    chunks_[index] = std::move(copy);
+  }
+  return chunks_[index]->data();
+}
+
+}  // namespace disk_cache
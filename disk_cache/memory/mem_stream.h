@@ -0,0 +1,129 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_DISK_CACHE_MEMORY_MEM_STREAM_H_
+#define NET_DISK_CACHE_MEMORY_MEM_STREAM_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "net/base/net_export.h"
+
+namespace net {
+class IOBuffer;
+}  // namespace net
+
+namespace disk_cache {
+
+// The data of the memory cache is stored in chunks of this size. A sparse child
+// entry holds up to one chunk.
+const int kMemChunkSize = 4 * 1024;
+
+// A stream that fits in one chunk gets a smaller one, of the smallest power of
+// two from this size up that holds its data.
+const int kMinMemChunkSize = 256;
+
+// Keeps the chunks released by the entries of a MemBackendImpl, so that they
+// can be used again without going back to the heap, up to a maximum number of
+// bytes.
+class NET_EXPORT_PRIVATE MemChunkPool {
+ public:
+  MemChunkPool();
+  ~MemChunkPool();
+
+  void set_max_pooled_bytes(int max_pooled_bytes);
+
+  // Returns a chunk of kMemChunkSize bytes. Its contents are undefined.
+  scoped_refptr<net::IOBuffer> GetChunk();
+
+  // Returns |chunk| to the pool. A chunk still shared with a reader goes away
+  // with the last reference to it.
+  void ReleaseChunk(scoped_refptr<net::IOBuffer> chunk);
+
+  // Chunks handed out and not released yet.
+  int chunks_in_use() const { return chunks_in_use_; }
+  int pooled_chunks() const { return static_cast<int>(free_chunks_.size()); }
+
+ private:
+  std::vector<scoped_refptr<net::IOBuffer>> free_chunks_;
+  size_t max_pooled_chunks_;
+  int chunks_in_use_;
+
+  DISALLOW_COPY_AND_ASSIGN(MemChunkPool);
+};
+
+// A stream of a MemEntryImpl, stored as a list of chunks from a MemChunkPool.
+// Growing a stream only adds chunks, so the data already written is never
+// copied again, except for the few KB of a small stream: most streams, such as
+// the headers of an HTTP response, are much smaller than kMemChunkSize, so a
+// stream that fits in one chunk keeps it in a buffer of its size class instead,
+// which is replaced by a bigger one as the stream grows.
+//
+// A chunk can be shared with a reader (see GetChunk()). Before such a chunk is
+// modified, the stream replaces it with a copy, so the reader keeps seeing the
+// data as it was.
+class NET_EXPORT_PRIVATE MemStream {
+ public:
+  explicit MemStream(MemChunkPool* pool);
+  ~MemStream();
+
+  int size() const { return size_; }
+
+  // Returns the memory used by the chunks of this stream.
+  int storage_size() const {
+    if (chunks_.empty())
+      return 0;
+    return static_cast<int>(chunks_.size() - 1) * kMemChunkSize +
+           first_chunk_size_;
+  }
+
+  // Copies |len| bytes at |offset| to |buf|. The range must be within the
+  // stream.
+  void Read(int offset, char* buf, int len) const;
+
+  // Copies |len| bytes of |buf| to |offset|, growing the stream as needed. A
+  // hole between the end of the stream and |offset| is filled with zeros.
+  void Write(int offset, const char* buf, int len);
+
+  // Truncates the stream, or grows it with zeros, to |size| bytes.
+  void SetSize(int size);
+
+  // Returns the chunk that starts at |offset|, which must be a multiple of
+  // kMemChunkSize within the stream, and stores in |len| the number of bytes of
+  // the stream in that chunk. The chunk of a small stream may be smaller than
+  // kMemChunkSize.
+  scoped_refptr<net::IOBuffer> GetChunk(int offset, int* len) const;
+
+ private:
+  // Makes room for a stream of |size| bytes. The bytes past size_ are
+  // undefined.
+  void Reserve(int size);
+
+  // Replaces the first chunk, the only one of the stream, by a chunk of
+  // |chunk_size| bytes holding the same data.
+  void ResizeFirstChunk(int chunk_size);
+
+  // Returns a chunk of |chunk_size| bytes, or gives one back.
+  scoped_refptr<net::IOBuffer> NewChunk(int chunk_size);
+  void ReleaseChunk(scoped_refptr<net::IOBuffer> chunk, int chunk_size);
+
+  // Returns the chunk |index| ready to be modified.
+  char* GetWritableChunk(size_t index);
+
+  MemChunkPool* pool_;
+  std::vector<scoped_refptr<net::IOBuffer>> chunks_;
+  int size_;
+  // The size of the first chunk, which is kMemChunkSize unless it is the only
+  // chunk of the stream.
+  int first_chunk_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(MemStream);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_MEMORY_MEM_STREAM_H_
@@ -36,6 +36,7 @@
 #include "net/disk_cache/simple/simple_histogram_macros.h"
 #include "net/disk_cache/simple/simple_index.h"
 #include "net/disk_cache/simple/simple_index_file.h"
+#include "net/disk_cache/simple/simple_segment_store.h"
 #include "net/disk_cache/simple/simple_synchronous_entry.h"
 #include "net/disk_cache/simple/simple_util.h"
 #include "net/disk_cache/simple/simple_version_upgrade.h"
@@ -237,6 +238,8 @@ SimpleBackendImpl::SimpleBackendImpl(
       cache_type_(cache_type),
       cache_thread_(cache_thread),
       orig_max_size_(max_bytes),
+      max_packed_entry_size_(0),
+      admission_policy_(SimpleIndex::ADMISSION_POLICY_ALL),
       entry_operations_mode_(cache_type == net::DISK_CACHE ?
                                  SimpleEntryImpl::OPTIMISTIC_OPERATIONS :
                                  SimpleEntryImpl::NON_OPTIMISTIC_OPERATIONS),
@@ -248,13 +251,30 @@ SimpleBackendImpl::~SimpleBackendImpl() {
   index_->WriteToDisk(SimpleIndex::INDEX_WRITE_REASON_SHUTDOWN);
 }
 
+void SimpleBackendImpl::SetMaxPackedEntrySize(int max_packed_entry_size) {
+  DCHECK(!index_);
+  DCHECK_GE(max_packed_entry_size, 0);
+  max_packed_entry_size_ = max_packed_entry_size;
+}
+
+void SimpleBackendImpl::SetAdmissionPolicy(
+    SimpleIndex::AdmissionPolicy admission_policy) {
+  DCHECK(!index_);
+  admission_policy_ = admission_policy;
+}
+
 int SimpleBackendImpl::Init(const CompletionCallback& completion_callback) {
   worker_pool_ = g_sequenced_worker_pool.Get().GetTaskRunner();
+  // The store always exists, so that packed entries stay readable once
+  // packing is turned off.
+  segment_store_ = new SimpleSegmentStore(
+      cache_type_, path_, max_packed_entry_size_, worker_pool_);
 
   index_.reset(new SimpleIndex(
       base::ThreadTaskRunnerHandle::Get(), this, cache_type_,
       base::WrapUnique(new SimpleIndexFile(cache_thread_, worker_pool_.get(),
                                            cache_type_, path_))));
+  index_->SetAdmissionPolicy(admission_policy_);
   index_->ExecuteWhenReady(
       base::Bind(&RecordIndexLoad, cache_type_, base::TimeTicks::Now()));
 
@@ -355,7 +375,8 @@ void SimpleBackendImpl::DoomEntries(std::vector<uint64_t>* entry_hashes,
                              FROM_HERE,
                              base::Bind(&SimpleSynchronousEntry::DoomEntrySet,
                                         mass_doom_entry_hashes_ptr,
-                                        path_),
+                                        path_,
+                                        base::RetainedRef(segment_store_)),
                              base::Bind(&SimpleBackendImpl::DoomEntriesComplete,
                                         AsWeakPtr(),
                                         base::Passed(&mass_doom_entry_hashes),
@@ -24,6 +24,7 @@
 #include "net/base/cache_type.h"
 #include "net/disk_cache/disk_cache.h"
 #include "net/disk_cache/simple/simple_entry_impl.h"
+#include "net/disk_cache/simple/simple_index.h"
 #include "net/disk_cache/simple/simple_index_delegate.h"
 
 namespace base {
@@ -46,7 +47,7 @@ namespace disk_cache {
 // otherwise stated.
 
 class SimpleEntryImpl;
-class SimpleIndex;
+class SimpleSegmentStore;
 
 class NET_EXPORT_PRIVATE SimpleBackendImpl : public Backend,
     public SimpleIndexDelegate,
@@ -66,6 +67,17 @@ class NET_EXPORT_PRIVATE SimpleBackendImpl : public Backend,
 
   base::TaskRunner* worker_pool() { return worker_pool_.get(); }
 
+  SimpleSegmentStore* segment_store() { return segment_store_.get(); }
+
+  // Packs the entries of at most |max_packed_entry_size| bytes into shared
+  // segment files; see SimpleSegmentStore. Disabled by default. Must be
+  // called before Init().
+  void SetMaxPackedEntrySize(int max_packed_entry_size);
+
+  // Sets the policy deciding which new entries the index keeps when evicting;
+  // see SimpleIndex::AdmissionPolicy. Must be called before Init().
+  void SetAdmissionPolicy(SimpleIndex::AdmissionPolicy admission_policy);
+
   int Init(const CompletionCallback& completion_callback);
 
   // Sets the maximum size for the total amount of data stored by this instance.
@@ -200,8 +212,11 @@ class NET_EXPORT_PRIVATE SimpleBackendImpl : public Backend,
   std::unique_ptr<SimpleIndex> index_;
   const scoped_refptr<base::SingleThreadTaskRunner> cache_thread_;
   scoped_refptr<base::TaskRunner> worker_pool_;
+  scoped_refptr<SimpleSegmentStore> segment_store_;
 
   int orig_max_size_;
+  int max_packed_entry_size_;
+  SimpleIndex::AdmissionPolicy admission_policy_;
   const SimpleEntryImpl::OperationsMode entry_operations_mode_;
 
   EntryMap active_entries_;
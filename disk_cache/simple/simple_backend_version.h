@@ -18,11 +18,15 @@ namespace disk_cache {
 //     |kSimpleVersion - 1| then the whole cache directory will be cleared.
 //   * Dropping cache data on disk or some of its parts can be a valid way to
 //     Upgrade.
-const uint32_t kSimpleVersion = 7;
+const uint32_t kSimpleVersion = 8;
 
 // The version of the entry file(s) as written to disk. Must be updated iff the
 // entry format changes with the overall backend version update.
-const uint32_t kSimpleEntryVersionOnDisk = 5;
+const uint32_t kSimpleEntryVersionOnDisk = 6;
+
+// The oldest version of the entry files that is still read. Version 5 entries
+// checksum their streams with zlib CRC-32, and version 6 entries with CRC-32C.
+const uint32_t kSimpleEntryMinVersionOnDisk = 5;
 
 }  // namespace disk_cache
 
@@ -0,0 +1,274 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/simple/simple_checksum.h"
+
+#include <string.h>
+
+#include "base/atomicops.h"
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/sys_byteorder.h"
+#include "build/build_config.h"
+#include "third_party/zlib/zlib.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#include "base/cpu.h"
+#if defined(COMPILER_MSVC)
+#include <intrin.h>
+#define TARGET_SSE42
+#else
+#include <nmmintrin.h>
+#define TARGET_SSE42 __attribute__((target("sse4.2")))
+#endif
+#endif
+
+namespace disk_cache {
+
+namespace {
+
+// The CRC-32C (Castagnoli) polynomial, bit-reflected.
+const uint32_t kCrc32cPolynomial = 0x82f63b78;
+
+// Long buffers are checksummed as three interleaved stripes of 2^12 bytes,
+// which the CPU computes in parallel.
+const int kStripeSizeLog2 = 12;
+const size_t kStripeSize = 1 << kStripeSizeLog2;
+
+// Lengths of up to 2^kMaxLengthLog2 - 1 bytes can be combined.
+const int kMaxLengthLog2 = 63;
+
+base::subtle::Atomic32 g_crc32c_hardware_enabled = 1;
+
+// Appending zero bytes to data is a linear operator on its CRC register,
+// represented as a 32x32 matrix over GF(2), one column per word.
+uint32_t Gf2MatrixTimes(const uint32_t* matrix, uint32_t vector) {
+  uint32_t sum = 0;
+  for (; vector; vector >>= 1, ++matrix) {
+    if (vector & 1)
+      sum ^= *matrix;
+  }
+  return sum;
+}
+
+void Gf2MatrixMultiply(uint32_t* product,
+                       const uint32_t* left,
+                       const uint32_t* right) {
+  for (int n = 0; n < 32; ++n)
+    product[n] = Gf2MatrixTimes(left, right[n]);
+}
+
+struct Crc32cState {
+  Crc32cState() {
+    // |tables[k][i]| is the CRC of byte |i| followed by |k| zero bytes.
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t crc = i;
+      for (int bit = 0; bit < 8; ++bit)
+        crc = (crc >> 1) ^ ((crc & 1) ? kCrc32cPolynomial : 0);
+      tables[0][i] = crc;
+    }
+    for (int k = 1; k < 8; ++k) {
+      for (int i = 0; i < 256; ++i) {
+        tables[k][i] =
+            (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xff];
+      }
+    }
+    // Squaring the operator appending one zero bit thrice yields the one
+    // appending a zero byte.
+    uint32_t one_bit[32];
+    one_bit[0] = kCrc32cPolynomial;
+    for (int n = 1; n < 32; ++n)
+      one_bit[n] = 1U << (n - 1);
+    uint32_t two_bits[32];
+    uint32_t four_bits[32];
+    Gf2MatrixMultiply(two_bits, one_bit, one_bit);
+    Gf2MatrixMultiply(four_bits, two_bits, two_bits);
+    Gf2MatrixMultiply(zero_bytes[0], four_bits, four_bits);
+    for (int k = 1; k < kMaxLengthLog2; ++k)
+      Gf2MatrixMultiply(zero_bytes[k], zero_bytes[k - 1], zero_bytes[k - 1]);
+#if defined(ARCH_CPU_X86_FAMILY)
+    has_sse42 = base::CPU().has_sse42();
+#else
+    has_sse42 = false;
+#endif
+  }
+
+  uint32_t tables[8][256];
+  // |zero_bytes[k]| appends 2^k zero bytes.
+  uint32_t zero_bytes[kMaxLengthLog2][32];
+  bool has_sse42;
+};
+
+base::LazyInstance<Crc32cState>::Leaky g_crc32c_state =
+    LAZY_INSTANCE_INITIALIZER;
+
+uint32_t LoadLE32(const char* data) {
+  uint32_t value;
+  memcpy(&value, data, sizeof(value));
+  return base::ByteSwapToLE32(value);
+}
+
+// Slicing-by-8: eight table lookups for every eight bytes. Copies the data to
+// |dest| unless it is null.
+uint32_t Crc32cPortable(uint32_t crc,
+                        char* dest,
+                        const char* data,
+                        size_t length) {
+  const uint32_t(*tables)[256] = g_crc32c_state.Get().tables;
+  crc = ~crc;
+  while (length >= 8) {
+    if (dest) {
+      memcpy(dest, data, 8);
+      dest += 8;
+    }
+    const uint32_t low = crc ^ LoadLE32(data);
+    const uint32_t high = LoadLE32(data + 4);
+    crc = tables[7][low & 0xff] ^ tables[6][(low >> 8) & 0xff] ^
+          tables[5][(low >> 16) & 0xff] ^ tables[4][low >> 24] ^
+          tables[3][high & 0xff] ^ tables[2][(high >> 8) & 0xff] ^
+          tables[1][(high >> 16) & 0xff] ^ tables[0][high >> 24];
+    data += 8;
+    length -= 8;
+  }
+  for (; length > 0; --length) {
+    if (dest)
+      *dest++ = *data;
+    crc = (crc >> 8) ^ tables[0][(crc ^ static_cast<uint8_t>(*data++)) & 0xff];
+  }
+  return ~crc;
+}
+
+#if defined(ARCH_CPU_X86_FAMILY)
+TARGET_SSE42 uint32_t Crc32cSSE42(uint32_t crc,
+                                  char* dest,
+                                  const char* data,
+                                  size_t length) {
+  crc = ~crc;
+#if defined(ARCH_CPU_X86_64)
+  const Crc32cState& state = g_crc32c_state.Get();
+  uint64_t crc64 = crc;
+  while (length >= 3 * kStripeSize) {
+    uint64_t crc1 = 0;
+    uint64_t crc2 = 0;
+    for (size_t i = 0; i < kStripeSize; i += 8) {
+      uint64_t word0;
+      uint64_t word1;
+      uint64_t word2;
+      memcpy(&word0, data + i, sizeof(word0));
+      memcpy(&word1, data + kStripeSize + i, sizeof(word1));
+      memcpy(&word2, data + 2 * kStripeSize + i, sizeof(word2));
+      if (dest) {
+        memcpy(dest + i, &word0, sizeof(word0));
+        memcpy(dest + kStripeSize + i, &word1, sizeof(word1));
+        memcpy(dest + 2 * kStripeSize + i, &word2, sizeof(word2));
+      }
+      crc64 = _mm_crc32_u64(crc64, word0);
+      crc1 = _mm_crc32_u64(crc1, word1);
+      crc2 = _mm_crc32_u64(crc2, word2);
+    }
+    crc64 = Gf2MatrixTimes(state.zero_bytes[kStripeSizeLog2 + 1],
+                           static_cast<uint32_t>(crc64)) ^
+            Gf2MatrixTimes(state.zero_bytes[kStripeSizeLog2],
+                           static_cast<uint32_t>(crc1)) ^
+            static_cast<uint32_t>(crc2);
+    data += 3 * kStripeSize;
+    if (dest)
+      dest += 3 * kStripeSize;
+    length -= 3 * kStripeSize;
+  }
+  while (length >= 8) {
+    uint64_t word;
+    memcpy(&word, data, sizeof(word));
+    if (dest) {
+      memcpy(dest, &word, sizeof(word));
+      dest += sizeof(word);
+    }
+    crc64 = _mm_crc32_u64(crc64, word);
+    data += sizeof(word);
+    length -= sizeof(word);
+  }
+  crc = static_cast<uint32_t>(crc64);
+#else
+  while (length >= 4) {
+    uint32_t word;
+    memcpy(&word, data, sizeof(word));
+    if (dest) {
+      memcpy(dest, &word, sizeof(word));
+      dest += sizeof(word);
+    }
+    crc = _mm_crc32_u32(crc, word);
+    data += sizeof(word);
+    length -= sizeof(word);
+  }
+#endif
+  for (; length > 0; --length) {
+    const uint8_t byte = static_cast<uint8_t>(*data++);
+    if (dest)
+      *dest++ = static_cast<char>(byte);
+    crc = _mm_crc32_u8(crc, byte);
+  }
+  return ~crc;
+}
+#endif  // defined(ARCH_CPU_X86_FAMILY)
+
+uint32_t Crc32c(uint32_t crc, char* dest, const char* data, size_t length) {
+#if defined(ARCH_CPU_X86_FAMILY)
+  if (IsCrc32cHardwareAvailable())
+    return Crc32cSSE42(crc, dest, data, length);
+#endif
+  return Crc32cPortable(crc, dest, data, length);
+}
+
+uint32_t Crc32cCombine(uint32_t crc1, uint32_t crc2, int64_t length2) {
+  const Crc32cState& state = g_crc32c_state.Get();
+  for (int k = 0; length2 > 0; ++k, length2 >>= 1) {
+    if (length2 & 1)
+      crc1 = Gf2MatrixTimes(state.zero_bytes[k], crc1);
+  }
+  return crc1 ^ crc2;
+}
+
+}  // namespace
+
+uint32_t SimpleChecksum(SimpleChecksumType type,
+                        uint32_t crc,
+                        const char* data,
+                        size_t length) {
+  if (type == SIMPLE_CHECKSUM_CRC32C)
+    return Crc32c(crc, nullptr, data, length);
+  DCHECK_EQ(SIMPLE_CHECKSUM_CRC32, type);
+  return crc32(crc, reinterpret_cast<const Bytef*>(data), length);
+}
+
+uint32_t SimpleChecksumCopy(SimpleChecksumType type,
+                            uint32_t crc,
+                            char* dest,
+                            const char* data,
+                            size_t length) {
+  if (type == SIMPLE_CHECKSUM_CRC32C)
+    return Crc32c(crc, dest, data, length);
+  memcpy(dest, data, length);
+  return SimpleChecksum(type, crc, dest, length);
+}
+
+uint32_t SimpleChecksumCombine(SimpleChecksumType type,
+                               uint32_t crc1,
+                               uint32_t crc2,
+                               int64_t length2) {
+  if (type == SIMPLE_CHECKSUM_CRC32C)
+    return Crc32cCombine(crc1, crc2, length2);
+  DCHECK_EQ(SIMPLE_CHECKSUM_CRC32, type);
+  return crc32_combine(crc1, crc2, length2);
+}
+
+bool IsCrc32cHardwareAvailable() {
+  return base::subtle::NoBarrier_Load(&g_crc32c_hardware_enabled) &&
+         g_crc32c_state.Get().has_sse42;
+}
+
+void SetCrc32cHardwareEnabledForTesting(bool enabled) {
+  base::subtle::NoBarrier_Store(&g_crc32c_hardware_enabled, enabled ? 1 : 0);
+}
+
+}  // namespace disk_cache
@@ -0,0 +1,50 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_DISK_CACHE_SIMPLE_SIMPLE_CHECKSUM_H_
+#define NET_DISK_CACHE_SIMPLE_SIMPLE_CHECKSUM_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "net/base/net_export.h"
+
+namespace disk_cache {
+
+// The checksums of the streams of an entry. Entries written by version 5 of
+// the entry format use the zlib CRC-32; later entries use CRC-32C, which most
+// CPUs compute in hardware. In both, the checksum of no data is 0.
+enum SimpleChecksumType {
+  SIMPLE_CHECKSUM_CRC32,
+  SIMPLE_CHECKSUM_CRC32C,
+};
+
+// Extends the checksum |crc| of some data by the |length| bytes at |data|.
+NET_EXPORT_PRIVATE uint32_t SimpleChecksum(SimpleChecksumType type,
+                                           uint32_t crc,
+                                           const char* data,
+                                           size_t length);
+
+// Same as SimpleChecksum(), also copying the data to |dest| in the same pass.
+NET_EXPORT_PRIVATE uint32_t SimpleChecksumCopy(SimpleChecksumType type,
+                                               uint32_t crc,
+                                               char* dest,
+                                               const char* data,
+                                               size_t length);
+
+// Returns the checksum of data of checksum |crc1|, followed by |length2|
+// bytes of checksum |crc2|.
+NET_EXPORT_PRIVATE uint32_t SimpleChecksumCombine(SimpleChecksumType type,
+                                                  uint32_t crc1,
+                                                  uint32_t crc2,
+                                                  int64_t length2);
+
+// CRC-32C is computed with SSE4.2 when the CPU has it. Tests disable it to
+// exercise the portable implementation.
+NET_EXPORT_PRIVATE bool IsCrc32cHardwareAvailable();
+NET_EXPORT_PRIVATE void SetCrc32cHardwareEnabledForTesting(bool enabled);
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_SIMPLE_SIMPLE_CHECKSUM_H_
@@ -0,0 +1,103 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/simple/simple_checksum.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace disk_cache {
+
+namespace {
+
+const SimpleChecksumType kChecksumTypes[] = {SIMPLE_CHECKSUM_CRC32,
+                                             SIMPLE_CHECKSUM_CRC32C};
+
+// Long enough to exercise the interleaved hardware path, with an odd tail.
+std::string MakeData(size_t size) {
+  std::string data(size, 0);
+  for (size_t i = 0; i < size; ++i)
+    data[i] = static_cast<char>((i * 7919) >> 3);
+  return data;
+}
+
+class SimpleChecksumTest : public testing::Test {
+ protected:
+  void TearDown() override { SetCrc32cHardwareEnabledForTesting(true); }
+};
+
+TEST_F(SimpleChecksumTest, KnownValues) {
+  const std::string check = "123456789";
+  const std::string zeros(32, 0);
+  for (bool hardware : {true, false}) {
+    SetCrc32cHardwareEnabledForTesting(hardware);
+    EXPECT_EQ(0u, SimpleChecksum(SIMPLE_CHECKSUM_CRC32C, 0, nullptr, 0));
+    EXPECT_EQ(0xe3069283u, SimpleChecksum(SIMPLE_CHECKSUM_CRC32C, 0,
+                                          check.data(), check.size()));
+    // From RFC 3720, section B.4.
+    EXPECT_EQ(0x8a9136aau, SimpleChecksum(SIMPLE_CHECKSUM_CRC32C, 0,
+                                          zeros.data(), zeros.size()));
+  }
+  EXPECT_EQ(0u, SimpleChecksum(SIMPLE_CHECKSUM_CRC32, 0, nullptr, 0));
+  EXPECT_EQ(0xcbf43926u, SimpleChecksum(SIMPLE_CHECKSUM_CRC32, 0, check.data(),
+                                        check.size()));
+}
+
+TEST_F(SimpleChecksumTest, HardwareMatchesPortable) {
+  if (!IsCrc32cHardwareAvailable())
+    return;
+  const std::string data = MakeData(5 * 4096 + 16);
+  for (size_t size : {1u, 7u, 8u, 100u, 3u * 4096u, 3u * 4096u + 9u,
+                      5u * 4096u + 13u}) {
+    // Unaligned data too.
+    for (size_t offset : {0u, 1u, 3u}) {
+      SetCrc32cHardwareEnabledForTesting(true);
+      const uint32_t hardware = SimpleChecksum(
+          SIMPLE_CHECKSUM_CRC32C, 0x1234, data.data() + offset, size);
+      SetCrc32cHardwareEnabledForTesting(false);
+      const uint32_t portable = SimpleChecksum(
+          SIMPLE_CHECKSUM_CRC32C, 0x1234, data.data() + offset, size);
+      EXPECT_EQ(portable, hardware) << size << " " << offset;
+    }
+  }
+}
+
+TEST_F(SimpleChecksumTest, Copy) {
+  const std::string data = MakeData(3 * 4096 + 100);
+  for (bool hardware : {true, false}) {
+    SetCrc32cHardwareEnabledForTesting(hardware);
+    for (SimpleChecksumType type : kChecksumTypes) {
+      std::string copy(data.size(), 'x');
+      EXPECT_EQ(SimpleChecksum(type, 0, data.data(), data.size()),
+                SimpleChecksumCopy(type, 0, &copy[0], data.data(),
+                                   data.size()));
+      EXPECT_EQ(data, copy);
+    }
+  }
+}
+
+TEST_F(SimpleChecksumTest, Combine) {
+  const std::string data = MakeData(20000);
+  for (SimpleChecksumType type : kChecksumTypes) {
+    const uint32_t whole = SimpleChecksum(type, 0, data.data(), data.size());
+    for (size_t split : {0u, 1u, 4096u, 12345u, 20000u}) {
+      const uint32_t first = SimpleChecksum(type, 0, data.data(), split);
+      const uint32_t second =
+          SimpleChecksum(type, 0, data.data() + split, data.size() - split);
+      EXPECT_EQ(whole, SimpleChecksumCombine(type, first, second,
+                                             data.size() - split));
+      // Extending a checksum is the same as combining with the rest.
+      EXPECT_EQ(whole, SimpleChecksum(type, first, data.data() + split,
+                                      data.size() - split));
+    }
+  }
+}
+
+}  // namespace
+
+}  // namespace disk_cache
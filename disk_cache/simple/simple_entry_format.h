@@ -56,6 +56,9 @@ struct NET_EXPORT_PRIVATE SimpleFileEOF {
   enum Flags {
     FLAG_HAS_CRC32 = (1U << 0),
     FLAG_HAS_KEY_SHA256 = (1U << 1),  // Preceding the record if present.
+    // |data_crc32| is a CRC-32C rather than a zlib CRC-32. Written by entry
+    // format version 6 and later; the flag of stream 0 applies to the entry.
+    FLAG_CRC32C = (1U << 2),
   };
 
   SimpleFileEOF();
@@ -29,7 +29,6 @@
 #include "net/disk_cache/simple/simple_net_log_parameters.h"
 #include "net/disk_cache/simple/simple_synchronous_entry.h"
 #include "net/disk_cache/simple/simple_util.h"
-#include "third_party/zlib/zlib.h"
 
 namespace disk_cache {
 namespace {
@@ -173,6 +172,7 @@ SimpleEntryImpl::SimpleEntryImpl(net::CacheType cache_type,
     : backend_(backend->AsWeakPtr()),
       cache_type_(cache_type),
       worker_pool_(backend->worker_pool()),
+      segment_store_(backend->segment_store()),
       path_(path),
       entry_hash_(entry_hash),
       use_optimistic_operations_(operations_mode == OPTIMISTIC_OPERATIONS),
@@ -565,6 +565,7 @@ void SimpleEntryImpl::MakeUninitialized() {
   std::memset(crc32s_, 0, sizeof(crc32s_));
   std::memset(have_written_, 0, sizeof(have_written_));
   std::memset(data_size_, 0, sizeof(data_size_));
+  checksum_type_ = SIMPLE_CHECKSUM_CRC32C;
   for (size_t i = 0; i < arraysize(crc_check_state_); ++i) {
     crc_check_state_[i] = CRC_CHECK_NEVER_READ_AT_ALL;
   }
@@ -697,8 +698,9 @@ void SimpleEntryImpl::OpenEntryInternal(bool have_index,
       new SimpleEntryCreationResults(SimpleEntryStat(
           last_used_, last_modified_, data_size_, sparse_data_size_)));
   Closure task =
-      base::Bind(&SimpleSynchronousEntry::OpenEntry, cache_type_, path_, key_,
-                 entry_hash_, have_index, results.get());
+      base::Bind(&SimpleSynchronousEntry::OpenEntry, cache_type_, path_,
+                 base::RetainedRef(segment_store_), key_, entry_hash_,
+                 have_index, results.get());
   Closure reply =
       base::Bind(&SimpleEntryImpl::CreationOperationComplete, this, callback,
                  start_time, base::Passed(&results), out_entry,
@@ -741,6 +743,7 @@ void SimpleEntryImpl::CreateEntryInternal(bool have_index,
   Closure task = base::Bind(&SimpleSynchronousEntry::CreateEntry,
                             cache_type_,
                             path_,
+                            base::RetainedRef(segment_store_),
                             key_,
                             entry_hash_,
                             have_index,
@@ -769,7 +772,7 @@ void SimpleEntryImpl::CloseInternal() {
     for (int i = 0; i < kSimpleEntryStreamCount; ++i) {
       if (have_written_[i]) {
         if (GetDataSize(i) == crc32s_end_offset_[i]) {
-          int32_t crc = GetDataSize(i) == 0 ? crc32(0, Z_NULL, 0) : crc32s_[i];
+          int32_t crc = GetDataSize(i) == 0 ? 0 : crc32s_[i];
           crc32s_to_write->push_back(CRCRecord(i, true, crc));
         } else {
           crc32s_to_write->push_back(CRCRecord(i, false, 0));
@@ -785,7 +788,8 @@ void SimpleEntryImpl::CloseInternal() {
         &SimpleSynchronousEntry::Close, base::Unretained(synchronous_entry_),
         SimpleEntryStat(last_used_, last_modified_, data_size_,
                         sparse_data_size_),
-        base::Passed(&crc32s_to_write), base::RetainedRef(stream_0_data_));
+        base::Passed(&crc32s_to_write), base::RetainedRef(stream_0_data_),
+        doomed_);
     Closure reply = base::Bind(&SimpleEntryImpl::CloseOperationComplete, this);
     synchronous_entry_ = NULL;
     worker_pool_->PostTaskAndReply(FROM_HERE, task, reply);
@@ -848,7 +852,19 @@ void SimpleEntryImpl::ReadDataInternal(int stream_index,
 
   // Since stream 0 data is kept in memory, it is read immediately.
   if (stream_index == 0) {
-    int ret_value = ReadStream0Data(buf, offset, buf_len);
+    int ret_value = ReadFromBuffer(stream_0_data_.get(), offset, buf_len, buf);
+    if (!callback.is_null()) {
+      base::ThreadTaskRunnerHandle::Get()->PostTask(
+          FROM_HERE, base::Bind(callback, ret_value));
+    }
+    return;
+  }
+
+  // So is stream 1 of small entries, as read when opening them.
+  if (stream_index == 1 && stream_1_data_.get()) {
+    if (!doomed_ && backend_.get())
+      backend_->index()->UseIfExists(entry_hash_);
+    int ret_value = ReadFromBuffer(stream_1_data_.get(), offset, buf_len, buf);
     if (!callback.is_null()) {
       base::ThreadTaskRunnerHandle::Get()->PostTask(
           FROM_HERE, base::Bind(callback, ret_value));
@@ -938,6 +954,8 @@ void SimpleEntryImpl::WriteDataInternal(int stream_index,
   if (!doomed_ && backend_.get())
     backend_->index()->UseIfExists(entry_hash_);
 
+  if (stream_index == 1)
+    stream_1_data_ = NULL;
   AdvanceCrc(buf, offset, buf_len, stream_index);
 
   // |entry_stat| needs to be initialized before modifying |data_size_|.
@@ -1088,7 +1106,7 @@ void SimpleEntryImpl::DoomEntryInternal(const CompletionCallback& callback) {
     PostTaskAndReplyWithResult(
         worker_pool_.get(), FROM_HERE,
         base::Bind(&SimpleSynchronousEntry::TruncateEntryFiles, path_,
-                   entry_hash_),
+                   base::RetainedRef(segment_store_), entry_hash_),
         base::Bind(&SimpleEntryImpl::DoomOperationComplete, this, callback,
                    // Return to STATE_FAILURE after dooming, since no operation
                    // can succeed on the truncated entry files.
@@ -1099,7 +1117,8 @@ void SimpleEntryImpl::DoomEntryInternal(const CompletionCallback& callback) {
   PostTaskAndReplyWithResult(
       worker_pool_.get(),
       FROM_HERE,
-      base::Bind(&SimpleSynchronousEntry::DoomEntry, path_, entry_hash_),
+      base::Bind(&SimpleSynchronousEntry::DoomEntry, path_,
+                 base::RetainedRef(segment_store_), entry_hash_),
       base::Bind(
           &SimpleEntryImpl::DoomOperationComplete, this, callback, state_));
   state_ = STATE_IO_PENDING;
@@ -1141,6 +1160,14 @@ void SimpleEntryImpl::CreationOperationComplete(
     crc32s_[0] = in_results->stream_0_crc32;
     crc32s_end_offset_[0] = in_results->entry_stat.data_size(0);
   }
+  if (in_results->stream_1_data.get()) {
+    stream_1_data_ = in_results->stream_1_data;
+    // As for stream 0, the crc was checked in SimpleSynchronousEntry.
+    crc_check_state_[1] = CRC_CHECK_DONE;
+    crc32s_[1] = in_results->stream_1_crc32;
+    crc32s_end_offset_[1] = in_results->entry_stat.data_size(1);
+  }
+  checksum_type_ = in_results->checksum_type;
   // If this entry was opened by hash, key_ could still be empty. If so, update
   // it with the key read from the synchronous entry.
   if (key_.empty()) {
@@ -1203,9 +1230,9 @@ void SimpleEntryImpl::ReadOperationComplete(
   }
 
   if (*result > 0 && crc32s_end_offset_[stream_index] == offset) {
-    uint32_t current_crc =
-        offset == 0 ? crc32(0, Z_NULL, 0) : crc32s_[stream_index];
-    crc32s_[stream_index] = crc32_combine(current_crc, *read_crc32, *result);
+    uint32_t current_crc = offset == 0 ? 0 : crc32s_[stream_index];
+    crc32s_[stream_index] = SimpleChecksumCombine(checksum_type_, current_crc,
+                                                  *read_crc32, *result);
     crc32s_end_offset_[stream_index] += *result;
     if (!have_written_[stream_index] &&
         GetDataSize(stream_index) == crc32s_end_offset_[stream_index]) {
@@ -1477,14 +1504,15 @@ void SimpleEntryImpl::RecordWriteDependencyType(
                    type, WRITE_DEPENDENCY_TYPE_MAX);
 }
 
-int SimpleEntryImpl::ReadStream0Data(net::IOBuffer* buf,
-                                     int offset,
-                                     int buf_len) {
+int SimpleEntryImpl::ReadFromBuffer(net::GrowableIOBuffer* in_buf,
+                                    int offset,
+                                    int buf_len,
+                                    net::IOBuffer* out_buf) {
   if (buf_len < 0) {
     RecordReadResult(cache_type_, READ_RESULT_SYNC_READ_FAILURE);
     return 0;
   }
-  memcpy(buf->data(), stream_0_data_->data() + offset, buf_len);
+  memcpy(out_buf->data(), in_buf->data() + offset, buf_len);
   UpdateDataFromEntryStat(
       SimpleEntryStat(base::Time::Now(), last_modified_, data_size_,
                       sparse_data_size_));
@@ -1506,7 +1534,10 @@ int SimpleEntryImpl::SetStream0Data(net::IOBuffer* buf,
   if (offset == 0 && truncate) {
     RecordHeaderSizeChange(cache_type_, data_size, buf_len);
     stream_0_data_->SetCapacity(buf_len);
-    memcpy(stream_0_data_->data(), buf->data(), buf_len);
+    // The checksum is computed as the headers are copied.
+    crc32s_[0] = SimpleChecksumCopy(checksum_type_, 0, stream_0_data_->data(),
+                                    buf->data(), buf_len);
+    crc32s_end_offset_[0] = buf_len;
     data_size_[0] = buf_len;
   } else {
     RecordUnexpectedStream0Write(cache_type_);
@@ -1521,9 +1552,9 @@ int SimpleEntryImpl::SetStream0Data(net::IOBuffer* buf,
     if (buf)
       memcpy(stream_0_data_->data() + offset, buf->data(), buf_len);
     data_size_[0] = buffer_size;
+    AdvanceCrc(buf, offset, buf_len, 0);
   }
   base::Time modification_time = base::Time::Now();
-  AdvanceCrc(buf, offset, buf_len, 0);
   UpdateDataFromEntryStat(
       SimpleEntryStat(modification_time, modification_time, data_size_,
                       sparse_data_size_));
@@ -1541,11 +1572,10 @@ void SimpleEntryImpl::AdvanceCrc(net::IOBuffer* buffer,
   // the crc of the data. When we write to an entry and close without having
   // done a sequential write, we don't check the CRC on read.
   if (offset == 0 || crc32s_end_offset_[stream_index] == offset) {
-    uint32_t initial_crc =
-        (offset != 0) ? crc32s_[stream_index] : crc32(0, Z_NULL, 0);
+    uint32_t initial_crc = (offset != 0) ? crc32s_[stream_index] : 0;
     if (length > 0) {
-      crc32s_[stream_index] = crc32(
-          initial_crc, reinterpret_cast<const Bytef*>(buffer->data()), length);
+      crc32s_[stream_index] = SimpleChecksum(checksum_type_, initial_crc,
+                                             buffer->data(), length);
     }
     crc32s_end_offset_[stream_index] = offset + length;
   } else if (offset < crc32s_end_offset_[stream_index]) {
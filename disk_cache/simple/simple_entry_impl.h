@@ -17,6 +17,7 @@
 #include "net/base/cache_type.h"
 #include "net/base/net_export.h"
 #include "net/disk_cache/disk_cache.h"
+#include "net/disk_cache/simple/simple_checksum.h"
 #include "net/disk_cache/simple/simple_entry_format.h"
 #include "net/disk_cache/simple/simple_entry_operation.h"
 #include "net/log/net_log.h"
@@ -33,6 +34,7 @@ class IOBuffer;
 namespace disk_cache {
 
 class SimpleBackendImpl;
+class SimpleSegmentStore;
 class SimpleSynchronousEntry;
 class SimpleEntryStat;
 struct SimpleEntryCreationResults;
@@ -291,8 +293,11 @@ class NET_EXPORT_PRIVATE SimpleEntryImpl : public Entry,
   void RecordReadIsParallelizable(const SimpleEntryOperation& operation) const;
   void RecordWriteDependencyType(const SimpleEntryOperation& operation) const;
 
-  // Reads from the stream 0 data kept in memory.
-  int ReadStream0Data(net::IOBuffer* buf, int offset, int buf_len);
+  // Reads from the stream data kept in memory in |in_buf|.
+  int ReadFromBuffer(net::GrowableIOBuffer* in_buf,
+                     int offset,
+                     int buf_len,
+                     net::IOBuffer* out_buf);
 
   // Copies data from |buf| to the internal in-memory buffer for stream 0. If
   // |truncate| is set to true, the target buffer will be truncated at |offset|
@@ -317,6 +322,7 @@ class NET_EXPORT_PRIVATE SimpleEntryImpl : public Entry,
   const base::WeakPtr<SimpleBackendImpl> backend_;
   const net::CacheType cache_type_;
   const scoped_refptr<base::TaskRunner> worker_pool_;
+  const scoped_refptr<SimpleSegmentStore> segment_store_;
   const base::FilePath path_;
   const uint64_t entry_hash_;
   const bool use_optimistic_operations_;
@@ -350,6 +356,9 @@ class NET_EXPORT_PRIVATE SimpleEntryImpl : public Entry,
   int32_t crc32s_end_offset_[kSimpleEntryStreamCount];
   uint32_t crc32s_[kSimpleEntryStreamCount];
 
+  // The checksum the entry's files were written with, as read when opening.
+  SimpleChecksumType checksum_type_;
+
   // If |have_written_[index]| is true, we have written to the file that
   // contains stream |index|.
   bool have_written_[kSimpleEntryStreamCount];
@@ -382,6 +391,11 @@ class NET_EXPORT_PRIVATE SimpleEntryImpl : public Entry,
   // used to write HTTP headers, the memory consumption of keeping it in memory
   // is acceptable.
   scoped_refptr<net::GrowableIOBuffer> stream_0_data_;
+
+  // Stream 1 of a small entry is read along with stream 0 when opening it, so
+  // that reading the entry takes no further I/O. Dropped when stream 1 is
+  // written.
+  scoped_refptr<net::GrowableIOBuffer> stream_1_data_;
 };
 
 }  // namespace disk_cache
@@ -0,0 +1,421 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/simple/simple_file_batch.h"
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+#include "base/atomicops.h"
+#include "base/files/file.h"
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "base/threading/thread_local.h"
+#include "build/build_config.h"
+
+// io_uring needs the headers of Linux 5.1 or later.
+#if defined(OS_LINUX) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#if defined(__NR_io_uring_setup)
+#define SIMPLE_FILE_BATCH_USE_IO_URING
+#endif
+#endif  // __has_include(<linux/io_uring.h>)
+#endif  // defined(OS_LINUX) && defined(__has_include)
+
+namespace disk_cache {
+
+namespace {
+
+base::subtle::Atomic32 g_io_ring_enabled = 1;
+
+#if defined(SIMPLE_FILE_BATCH_USE_IO_URING)
+
+// The number of operations submitted at once. Batches of the simple cache hold
+// a handful of operations.
+const unsigned kRingEntries = 16;
+
+uint32_t AcquireLoad(const uint32_t* value) {
+  return static_cast<uint32_t>(base::subtle::Acquire_Load(
+      reinterpret_cast<volatile const base::subtle::Atomic32*>(value)));
+}
+
+void ReleaseStore(uint32_t* value, uint32_t new_value) {
+  base::subtle::Release_Store(
+      reinterpret_cast<volatile base::subtle::Atomic32*>(value),
+      static_cast<base::subtle::Atomic32>(new_value));
+}
+
+// An io_uring instance, used by a single thread.
+class IORing {
+ public:
+  // Returns null if the kernel does not support io_uring.
+  static IORing* Create() {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = syscall(__NR_io_uring_setup, kRingEntries, &params);
+    if (fd < 0)
+      return nullptr;
+    IORing* ring = new IORing(fd);
+    if (!ring->Map(params)) {
+      delete ring;
+      return nullptr;
+    }
+    return ring;
+  }
+
+  ~IORing() {
+    if (sqes_ != MAP_FAILED)
+      munmap(sqes_, sqes_size_);
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_)
+      munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_ != MAP_FAILED)
+      munmap(sq_ring_, sq_ring_size_);
+    close(fd_);
+  }
+
+  bool broken() const { return broken_; }
+
+  // Submits the |count| reads or writes of |iovs| at |offsets| in |fds|, and
+  // waits for the ones the kernel accepted. Sets |results| of the operations
+  // that completed to the bytes transferred or to a negative errno, and leaves
+  // the others untouched. Returns false if not all of them completed.
+  bool SubmitAndWait(const int* fds,
+                     const bool* is_write,
+                     const iovec* iovs,
+                     const int64_t* offsets,
+                     int* results,
+                     size_t count) {
+    DCHECK_LE(count, sq_entries_);
+    uint32_t tail = *sq_tail_;
+    for (size_t i = 0; i < count; ++i) {
+      const uint32_t index = tail & *sq_mask_;
+      io_uring_sqe* sqe = &sqes_[index];
+      memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = is_write[i] ? IORING_OP_WRITEV : IORING_OP_READV;
+      sqe->fd = fds[i];
+      sqe->off = offsets[i];
+      sqe->addr = reinterpret_cast<uintptr_t>(&iovs[i]);
+      sqe->len = 1;
+      sqe->user_data = i;
+      sq_array_[index] = index;
+      ++tail;
+    }
+    ReleaseStore(sq_tail_, tail);
+
+    // Once a submission fails, the operations already submitted are still
+    // waited for, since they use |iovs| and the buffers behind them.
+    size_t submitted = 0;
+    size_t completed = 0;
+    bool submit_failed = false;
+    while (completed < submitted || (!submit_failed && submitted < count)) {
+      const size_t to_submit = submit_failed ? 0 : count - submitted;
+      // The kernel only waits if it accepted all of |to_submit|.
+      const size_t to_wait = submitted + to_submit - completed;
+      int rv = syscall(__NR_io_uring_enter, fd_, to_submit, to_wait,
+                       IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (rv >= 0) {
+        submitted += rv;
+        if (static_cast<size_t>(rv) < to_submit)
+          submit_failed = true;
+      } else if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        if (!to_submit) {
+          // The operations in flight cannot be waited for, so the ring cannot
+          // be reused.
+          broken_ = true;
+          return false;
+        }
+        submit_failed = true;
+      } else if (to_submit && errno != EINTR) {
+        // The kernel is short of resources; EBUSY means the completion queue
+        // is full. Reap the completions, then submit no more.
+        submit_failed = true;
+      }
+
+      uint32_t head = *cq_head_;
+      while (head != AcquireLoad(cq_tail_)) {
+        const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+        DCHECK_LT(cqe.user_data, count);
+        results[cqe.user_data] = cqe.res;
+        ++head;
+        ++completed;
+      }
+      ReleaseStore(cq_head_, head);
+    }
+
+    if (submit_failed) {
+      // Takes back the entries the kernel did not consume, so that they are
+      // not submitted along with the next batch.
+      ReleaseStore(sq_tail_, AcquireLoad(sq_head_));
+    }
+    return completed == count;
+  }
+
+  size_t max_batch_size() const { return sq_entries_; }
+
+ private:
+  explicit IORing(int fd)
+      : fd_(fd),
+        sq_ring_(MAP_FAILED),
+        cq_ring_(MAP_FAILED),
+        sqes_(static_cast<io_uring_sqe*>(MAP_FAILED)),
+        broken_(false) {}
+
+  bool Map(const io_uring_params& params) {
+    sq_entries_ = params.sq_entries;
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+    cq_ring_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+#if defined(IORING_FEAT_SINGLE_MMAP)
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+#else
+    // Headers older than Linux 5.4 have neither the flag nor the features
+    // field. Two mappings work with any kernel.
+    const bool single_mmap = false;
+#endif
+    if (single_mmap)
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED)
+      return false;
+    if (single_mmap) {
+      cq_ring_ = sq_ring_;
+    } else {
+      cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+      if (cq_ring_ == MAP_FAILED)
+        return false;
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(
+        mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED)
+      return false;
+
+    char* sq = static_cast<char*>(sq_ring_);
+    sq_head_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<uint32_t*>(sq + params.sq_off.array);
+    char* cq = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<uint32_t*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  const int fd_;
+  size_t sq_entries_;
+  void* sq_ring_;
+  size_t sq_ring_size_;
+  void* cq_ring_;
+  size_t cq_ring_size_;
+  io_uring_sqe* sqes_;
+  size_t sqes_size_;
+
+  uint32_t* sq_head_;
+  uint32_t* sq_tail_;
+  uint32_t* sq_mask_;
+  uint32_t* sq_array_;
+  uint32_t* cq_head_;
+  uint32_t* cq_tail_;
+  uint32_t* cq_mask_;
+  io_uring_cqe* cqes_;
+
+  bool broken_;
+
+  DISALLOW_COPY_AND_ASSIGN(IORing);
+};
+
+// The ring of each worker thread. The worker threads of the simple cache live
+// until shutdown, so the rings are leaked along with them.
+struct ThreadRing {
+  ThreadRing() : ring(nullptr), create_failed(false) {}
+
+  IORing* ring;
+  bool create_failed;
+};
+
+base::LazyInstance<base::ThreadLocalPointer<ThreadRing>>::Leaky g_thread_ring =
+    LAZY_INSTANCE_INITIALIZER;
+
+// Returns the ring of the calling thread, or null if io_uring is unavailable.
+IORing* GetThreadRing() {
+  ThreadRing* thread_ring = g_thread_ring.Get().Get();
+  if (!thread_ring) {
+    thread_ring = new ThreadRing();
+    g_thread_ring.Get().Set(thread_ring);
+  }
+  if (!thread_ring->ring && !thread_ring->create_failed) {
+    thread_ring->ring = IORing::Create();
+    thread_ring->create_failed = !thread_ring->ring;
+  }
+  if (thread_ring->ring && thread_ring->ring->broken()) {
+    // Its operations may still complete, so the ring is leaked.
+    thread_ring->ring = nullptr;
+    thread_ring->create_failed = true;
+  }
+  return thread_ring->ring;
+}
+
+#endif  // defined(SIMPLE_FILE_BATCH_USE_IO_URING)
+
+}  // namespace
+
+SimpleFileBatch::Operation::Operation(Type type,
+                                      base::File* file,
+                                      int64_t offset,
+                                      char* data,
+                                      int size)
+    : type(type),
+      file(file),
+      offset(offset),
+      data(data),
+      size(size),
+      transferred(0),
+      result(-1),
+      done(false) {}
+
+SimpleFileBatch::SimpleFileBatch() {}
+
+SimpleFileBatch::~SimpleFileBatch() {}
+
+// static
+void SimpleFileBatch::SetIORingEnabled(bool enabled) {
+  base::subtle::NoBarrier_Store(&g_io_ring_enabled, enabled ? 1 : 0);
+}
+
+// static
+bool SimpleFileBatch::IsIORingAvailable() {
+  if (!base::subtle::NoBarrier_Load(&g_io_ring_enabled))
+    return false;
+#if defined(SIMPLE_FILE_BATCH_USE_IO_URING)
+  return GetThreadRing() != nullptr;
+#else
+  return false;
+#endif
+}
+
+size_t SimpleFileBatch::AddRead(base::File* file,
+                                int64_t offset,
+                                char* data,
+                                int size) {
+  operations_.push_back(Operation(Operation::READ, file, offset, data, size));
+  return operations_.size() - 1;
+}
+
+size_t SimpleFileBatch::AddWrite(base::File* file,
+                                 int64_t offset,
+                                 const char* data,
+                                 int size) {
+  // The data is only read from; Operation holds both reads and writes.
+  operations_.push_back(Operation(Operation::WRITE, file, offset,
+                                  const_cast<char*>(data), size));
+  return operations_.size() - 1;
+}
+
+bool SimpleFileBatch::Run() {
+  // A single operation gains nothing from the ring.
+  if (operations_.size() >= 2)
+    RunWithIORing();
+  bool success = true;
+  for (Operation& operation : operations_) {
+    if (!operation.done) {
+      const int64_t offset = operation.offset + operation.transferred;
+      char* data = operation.data + operation.transferred;
+      const int size = operation.size - operation.transferred;
+      const int rv = operation.type == Operation::READ
+                         ? operation.file->Read(offset, data, size)
+                         : operation.file->Write(offset, data, size);
+      // Like base::File, reports the bytes transferred before an error.
+      if (rv >= 0)
+        operation.result = operation.transferred + rv;
+      else
+        operation.result = operation.transferred ? operation.transferred : -1;
+      operation.done = true;
+    }
+    if (operation.result != operation.size)
+      success = false;
+  }
+  return success;
+}
+
+void SimpleFileBatch::RunWithIORing() {
+#if defined(SIMPLE_FILE_BATCH_USE_IO_URING)
+  if (!IsIORingAvailable())
+    return;
+  IORing* ring = GetThreadRing();
+  const size_t max_batch_size = ring->max_batch_size();
+  std::vector<int> fds(operations_.size());
+  std::unique_ptr<bool[]> is_write(new bool[operations_.size()]);
+  std::vector<iovec> iovs(operations_.size());
+  std::vector<int64_t> offsets(operations_.size());
+  std::vector<int> results(operations_.size());
+  // No completion carries this value, so it marks the operations not run.
+  const int kNotRun = std::numeric_limits<int>::min();
+
+  // The operations with bytes left to transfer.
+  std::vector<size_t> pending(operations_.size());
+  for (size_t i = 0; i < operations_.size(); ++i)
+    pending[i] = i;
+  while (!pending.empty()) {
+    for (size_t i = 0; i < pending.size(); ++i) {
+      const Operation& operation = operations_[pending[i]];
+      fds[i] = operation.file->GetPlatformFile();
+      is_write[i] = operation.type == Operation::WRITE;
+      iovs[i].iov_base = operation.data + operation.transferred;
+      iovs[i].iov_len = operation.size - operation.transferred;
+      offsets[i] = operation.offset + operation.transferred;
+      results[i] = kNotRun;
+    }
+    bool ring_failed = false;
+    for (size_t start = 0; start < pending.size(); start += max_batch_size) {
+      const size_t count = std::min(max_batch_size, pending.size() - start);
+      if (!ring->SubmitAndWait(&fds[start], &is_write[start], &iovs[start],
+                               &offsets[start], &results[start], count)) {
+        ring_failed = true;
+        break;
+      }
+    }
+
+    std::vector<size_t> short_transfers;
+    for (size_t i = 0; i < pending.size(); ++i) {
+      if (results[i] == kNotRun)
+        continue;
+      Operation& operation = operations_[pending[i]];
+      if (results[i] > 0) {
+        operation.transferred += results[i];
+        if (operation.transferred < operation.size) {
+          short_transfers.push_back(pending[i]);
+          continue;
+        }
+      }
+      // All the bytes were transferred, the end of the file was reached, or
+      // the operation failed.
+      if (results[i] < 0 && !operation.transferred)
+        operation.result = -1;
+      else
+        operation.result = operation.transferred;
+      operation.done = true;
+    }
+    // The operations left, short ones included, resume synchronously.
+    if (ring_failed)
+      return;
+    pending.swap(short_transfers);
+  }
+#endif
+}
+
+}  // namespace disk_cache
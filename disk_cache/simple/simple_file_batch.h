@@ -0,0 +1,95 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_DISK_CACHE_SIMPLE_SIMPLE_FILE_BATCH_H_
+#define NET_DISK_CACHE_SIMPLE_SIMPLE_FILE_BATCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "base/macros.h"
+#include "net/base/net_export.h"
+
+namespace base {
+class File;
+}
+
+namespace disk_cache {
+
+// A batch of positioned reads and writes on the files of an entry, none of
+// which depends on another. On Linux the batch is submitted to the kernel
+// through io_uring, so that it costs one system call instead of one per
+// operation. Elsewhere, or when io_uring is not available, the operations run
+// one at a time through base::File.
+//
+// The operations may complete in any order, so writes must not overlap each
+// other or any read of the same batch.
+class NET_EXPORT_PRIVATE SimpleFileBatch {
+ public:
+  SimpleFileBatch();
+  ~SimpleFileBatch();
+
+  // Process-wide switch for the io_uring path, enabled by default. Used to
+  // compare both paths, and as a kill switch.
+  static void SetIORingEnabled(bool enabled);
+
+  // Returns true if batches run through io_uring on the calling thread.
+  static bool IsIORingAvailable();
+
+  // Adds a read of |size| bytes at |offset| in |file| into |data|. Returns
+  // the index of the operation.
+  size_t AddRead(base::File* file, int64_t offset, char* data, int size);
+
+  // Adds a write of |size| bytes of |data| at |offset| in |file|. Returns the
+  // index of the operation.
+  size_t AddWrite(base::File* file, int64_t offset, const char* data, int size);
+
+  // Runs all the operations added so far. Returns true if each of them
+  // transferred all of its bytes.
+  bool Run();
+
+  // The number of bytes transferred by operation |index|, or -1 on error.
+  int result(size_t index) const { return operations_[index].result; }
+
+  size_t size() const { return operations_.size(); }
+
+ private:
+  struct Operation {
+    enum Type { READ, WRITE };
+
+    Operation(Type type,
+              base::File* file,
+              int64_t offset,
+              char* data,
+              int size);
+
+    Type type;
+    base::File* file;
+    int64_t offset;
+    char* data;
+    int size;
+    // The bytes at the start of |data| already transferred through io_uring,
+    // which are not transferred again.
+    int transferred;
+    int result;
+    bool done;
+  };
+
+  // Runs the operations through the io_uring of the calling thread, and marks
+  // the ones that completed as done. An operation that transfers fewer bytes
+  // than asked is submitted again for the bytes left, until it completes, hits
+  // the end of the file or fails. If io_uring is not available, or fails part
+  // way through, the bytes left must be transferred synchronously.
+  void RunWithIORing();
+
+  std::vector<Operation> operations_;
+
+  DISALLOW_COPY_AND_ASSIGN(SimpleFileBatch);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_SIMPLE_SIMPLE_FILE_BATCH_H_
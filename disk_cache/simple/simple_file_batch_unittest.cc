@@ -0,0 +1,98 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/simple/simple_file_batch.h"
+
+#include <string>
+
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/files/scoped_temp_dir.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace disk_cache {
+
+namespace {
+
+const int kNumChunks = 40;
+const int kChunkSpacing = 200;
+
+class SimpleFileBatchTest : public testing::TestWithParam<bool> {
+ protected:
+  void SetUp() override {
+    SimpleFileBatch::SetIORingEnabled(GetParam());
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    file_.Initialize(temp_dir_.path().AppendASCII("batch"),
+                     base::File::FLAG_CREATE | base::File::FLAG_READ |
+                         base::File::FLAG_WRITE);
+    ASSERT_TRUE(file_.IsValid());
+  }
+
+  void TearDown() override { SimpleFileBatch::SetIORingEnabled(true); }
+
+  base::ScopedTempDir temp_dir_;
+  base::File file_;
+};
+
+TEST_P(SimpleFileBatchTest, WriteThenRead) {
+  // More operations than fit in one submission.
+  std::string chunks[kNumChunks];
+  SimpleFileBatch write_batch;
+  for (int i = 0; i < kNumChunks; ++i) {
+    chunks[i] = std::string(100 + i, 'a' + i % 26);
+    EXPECT_EQ(static_cast<size_t>(i),
+              write_batch.AddWrite(&file_, i * kChunkSpacing, chunks[i].data(),
+                                   chunks[i].size()));
+  }
+  EXPECT_TRUE(write_batch.Run());
+  for (int i = 0; i < kNumChunks; ++i)
+    EXPECT_EQ(100 + i, write_batch.result(i));
+
+  char buffers[kNumChunks][kChunkSpacing];
+  SimpleFileBatch read_batch;
+  for (int i = 0; i < kNumChunks; ++i)
+    read_batch.AddRead(&file_, i * kChunkSpacing, buffers[i], 100 + i);
+  EXPECT_TRUE(read_batch.Run());
+  for (int i = 0; i < kNumChunks; ++i) {
+    ASSERT_EQ(100 + i, read_batch.result(i));
+    EXPECT_EQ(chunks[i], std::string(buffers[i], 100 + i));
+  }
+}
+
+TEST_P(SimpleFileBatchTest, ShortRead) {
+  const std::string data("data");
+  SimpleFileBatch write_batch;
+  write_batch.AddWrite(&file_, 0, data.data(), data.size());
+  EXPECT_TRUE(write_batch.Run());
+
+  char buffer[16];
+  char past_end[16];
+  SimpleFileBatch read_batch;
+  read_batch.AddRead(&file_, 0, buffer, data.size());
+  read_batch.AddRead(&file_, 2, past_end, sizeof(past_end));
+  EXPECT_FALSE(read_batch.Run());
+  EXPECT_EQ(static_cast<int>(data.size()), read_batch.result(0));
+  EXPECT_EQ(2, read_batch.result(1));
+}
+
+TEST_P(SimpleFileBatchTest, FailedWriteDoesNotStopOthers) {
+  const std::string data("data");
+  base::File read_only(temp_dir_.path().AppendASCII("batch"),
+                       base::File::FLAG_OPEN | base::File::FLAG_READ);
+  ASSERT_TRUE(read_only.IsValid());
+  SimpleFileBatch batch;
+  batch.AddWrite(&file_, 0, data.data(), data.size());
+  batch.AddWrite(&read_only, 100, data.data(), data.size());
+  batch.AddWrite(&file_, 200, data.data(), data.size());
+  EXPECT_FALSE(batch.Run());
+  EXPECT_EQ(static_cast<int>(data.size()), batch.result(0));
+  EXPECT_EQ(-1, batch.result(1));
+  EXPECT_EQ(static_cast<int>(data.size()), batch.result(2));
+}
+
+INSTANTIATE_TEST_CASE_P(IORing, SimpleFileBatchTest, testing::Bool());
+
+}  // namespace
+
+}  // namespace disk_cache
@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <limits>
 #include <string>
+#include <unordered_set>
 #include <utility>
 
 #include "base/bind.h"
@@ -14,6 +15,7 @@
 #include "base/files/file_enumerator.h"
 #include "base/files/file_util.h"
 #include "base/logging.h"
+#include "base/macros.h"
 #include "base/message_loop/message_loop.h"
 #include "base/metrics/field_trial.h"
 #include "base/numerics/safe_conversions.h"
@@ -49,30 +51,24 @@ const uint32_t kEvictionMarginDivisor = 20;
 
 const uint32_t kBytesInKb = 1024;
 
-// Utility class used for timestamp comparisons in entry metadata while sorting.
-class CompareHashesForTimestamp {
-  typedef disk_cache::SimpleIndex SimpleIndex;
-  typedef disk_cache::SimpleIndex::EntrySet EntrySet;
- public:
-  explicit CompareHashesForTimestamp(const EntrySet& set);
+// The eviction buckets are rebuilt once they hold more than twice as many
+// hashes as there are entries, plus this slack.
+const size_t kEvictionBucketSlack = 1024;
 
-  bool operator()(uint64_t hash1, uint64_t hash2);
+// The number of entries created since the previous eviction that compete for
+// admission. Older ones are admitted without competing.
+const size_t kMaxAdmissionCandidates = 64;
 
- private:
-  const EntrySet& entry_set_;
-};
-
-CompareHashesForTimestamp::CompareHashesForTimestamp(const EntrySet& set)
-  : entry_set_(set) {
-}
+// The frequency sketch has at least this many counters per row, and halves
+// its counters every |kSketchResetMultiplier| times as many increments.
+const size_t kMinSketchWidth = 1024;
+const size_t kSketchResetMultiplier = 10;
+const uint8_t kMaxSketchCount = 15;
 
-bool CompareHashesForTimestamp::operator()(uint64_t hash1, uint64_t hash2) {
-  EntrySet::const_iterator it1 = entry_set_.find(hash1);
-  DCHECK(it1 != entry_set_.end());
-  EntrySet::const_iterator it2 = entry_set_.find(hash2);
-  DCHECK(it2 != entry_set_.end());
-  return it1->second.GetLastUsedTime() < it2->second.GetLastUsedTime();
-}
+const uint64_t kSketchSeeds[] = {
+    UINT64_C(0xc3a5c85c97cb3127), UINT64_C(0xb492b66fbe98f273),
+    UINT64_C(0x9ae16a3b2f90404f), UINT64_C(0xcbf29ce484222325),
+};
 
 }  // namespace
 
@@ -140,6 +136,341 @@ bool EntryMetadata::Deserialize(base::PickleIterator* it) {
   return true;
 }
 
+namespace {
+
+class HeapStorage : public SimpleIndexTable::Storage {
+ public:
+  explicit HeapStorage(size_t slot_count)
+      : slots_(new SimpleIndexTable::Slot[slot_count]) {}
+  ~HeapStorage() override {}
+
+  SimpleIndexTable::Slot* slots() override { return slots_.get(); }
+
+ private:
+  std::unique_ptr<SimpleIndexTable::Slot[]> slots_;
+
+  DISALLOW_COPY_AND_ASSIGN(HeapStorage);
+};
+
+}  // namespace
+
+// static
+const size_t SimpleIndexTable::kPageSize;
+// static
+const size_t SimpleIndexTable::kSlotsPerPage;
+// static
+const size_t SimpleIndexTable::kMinCapacity;
+
+SimpleIndexTable::SimpleIndexTable() {
+  Allocate(kMinCapacity);
+}
+
+SimpleIndexTable::SimpleIndexTable(const SimpleIndexTable& other) {
+  Allocate(other.capacity_);
+  std::copy(other.slots_, other.slots_ + other.GetSlotCount(), slots_);
+  size_ = other.size_;
+  zero_key_present_ = other.zero_key_present_;
+  total_entry_size_ = other.total_entry_size_;
+}
+
+SimpleIndexTable::~SimpleIndexTable() {}
+
+SimpleIndexTable& SimpleIndexTable::operator=(const SimpleIndexTable& other) {
+  if (this != &other) {
+    SimpleIndexTable copy(other);
+    swap(copy);
+  }
+  return *this;
+}
+
+// static
+std::unique_ptr<SimpleIndexTable::Storage> SimpleIndexTable::CreateHeapStorage(
+    size_t slot_count) {
+  return std::unique_ptr<Storage>(new HeapStorage(slot_count));
+}
+
+SimpleIndexTable::iterator SimpleIndexTable::begin() {
+  iterator it(slots_, 0, capacity_, zero_key_present_);
+  it.SkipEmptySlots();
+  return it;
+}
+
+SimpleIndexTable::iterator SimpleIndexTable::end() {
+  return iterator(slots_, capacity_ + 1, capacity_, zero_key_present_);
+}
+
+SimpleIndexTable::const_iterator SimpleIndexTable::begin() const {
+  const_iterator it(slots_, 0, capacity_, zero_key_present_);
+  it.SkipEmptySlots();
+  return it;
+}
+
+SimpleIndexTable::const_iterator SimpleIndexTable::end() const {
+  return const_iterator(slots_, capacity_ + 1, capacity_, zero_key_present_);
+}
+
+SimpleIndexTable::iterator SimpleIndexTable::find(uint64_t entry_hash) {
+  if (entry_hash == 0) {
+    return zero_key_present_
+               ? iterator(slots_, capacity_, capacity_, zero_key_present_)
+               : end();
+  }
+  const size_t index = FindSlot(entry_hash);
+  if (index == capacity_ || slots_[index].first != entry_hash)
+    return end();
+  return iterator(slots_, index, capacity_, zero_key_present_);
+}
+
+SimpleIndexTable::const_iterator SimpleIndexTable::find(
+    uint64_t entry_hash) const {
+  return const_cast<SimpleIndexTable*>(this)->find(entry_hash);
+}
+
+size_t SimpleIndexTable::count(uint64_t entry_hash) const {
+  return find(entry_hash) != end() ? 1 : 0;
+}
+
+std::pair<SimpleIndexTable::iterator, bool> SimpleIndexTable::insert(
+    const value_type& value) {
+  const uint64_t entry_hash = value.first;
+  size_t index;
+  if (entry_hash == 0) {
+    index = capacity_;
+    if (zero_key_present_)
+      return std::make_pair(find(entry_hash), false);
+    zero_key_present_ = true;
+  } else {
+    index = FindSlot(entry_hash);
+    if (index != capacity_ && slots_[index].first == entry_hash)
+      return std::make_pair(find(entry_hash), false);
+    if (index == capacity_ || size_ + 1 > GetMaxEntryCount(capacity_)) {
+      Rehash(capacity_ * 2);
+      index = FindSlot(entry_hash);
+    }
+  }
+  slots_[index] = Slot(entry_hash, value.second);
+  MarkDirty(index);
+  ++size_;
+  total_entry_size_ += value.second.GetEntrySize();
+  return std::make_pair(iterator(slots_, index, capacity_, zero_key_present_),
+                        true);
+}
+
+void SimpleIndexTable::erase(iterator it) {
+  DCHECK(it != end());
+  size_t hole = it.index_;
+  total_entry_size_ -= slots_[hole].second.GetEntrySize();
+  --size_;
+  if (hole == capacity_) {
+    zero_key_present_ = false;
+  } else {
+    // Shifts back the entries following the erased one in its cluster, so that
+    // no probe sequence crosses the hole.
+    const size_t mask = capacity_ - 1;
+    size_t index = (hole + 1) & mask;
+    for (size_t probes = 0; probes < capacity_ && slots_[index].first != 0;
+         ++probes, index = (index + 1) & mask) {
+      const size_t bucket = GetBucket(slots_[index].first, capacity_);
+      if (((index - bucket) & mask) >= ((index - hole) & mask)) {
+        slots_[hole] = slots_[index];
+        MarkDirty(hole);
+        hole = index;
+      }
+    }
+  }
+  slots_[hole] = Slot();
+  MarkDirty(hole);
+}
+
+size_t SimpleIndexTable::erase(uint64_t entry_hash) {
+  iterator it = find(entry_hash);
+  if (it == end())
+    return 0;
+  erase(it);
+  return 1;
+}
+
+void SimpleIndexTable::reserve(size_t entry_count) {
+  size_t capacity = capacity_;
+  while (GetMaxEntryCount(capacity) < entry_count)
+    capacity *= 2;
+  if (capacity != capacity_)
+    Rehash(capacity);
+}
+
+void SimpleIndexTable::clear() {
+  Allocate(kMinCapacity);
+}
+
+void SimpleIndexTable::swap(SimpleIndexTable& other) {
+  std::swap(storage_, other.storage_);
+  std::swap(slots_, other.slots_);
+  std::swap(capacity_, other.capacity_);
+  std::swap(size_, other.size_);
+  std::swap(zero_key_present_, other.zero_key_present_);
+  std::swap(total_entry_size_, other.total_entry_size_);
+  dirty_pages_.swap(other.dirty_pages_);
+  std::swap(disk_image_id_, other.disk_image_id_);
+}
+
+void SimpleIndexTable::Update(iterator it, const EntryMetadata& metadata) {
+  DCHECK(it != end());
+  DCHECK_GE(total_entry_size_, it->second.GetEntrySize());
+  total_entry_size_ -= it->second.GetEntrySize();
+  total_entry_size_ += metadata.GetEntrySize();
+  it->second = metadata;
+  MarkDirty(it.index_);
+}
+
+size_t SimpleIndexTable::GetPageCount() const {
+  return (GetSlotCount() + kSlotsPerPage - 1) / kSlotsPerPage;
+}
+
+bool SimpleIndexTable::Adopt(std::unique_ptr<Storage> storage,
+                             size_t capacity,
+                             bool zero_key_present,
+                             size_t entry_count,
+                             uint64_t total_entry_size) {
+  if (capacity < kMinCapacity || (capacity & (capacity - 1)) != 0 ||
+      entry_count > GetMaxEntryCount(capacity) + (zero_key_present ? 1 : 0) ||
+      (zero_key_present && entry_count == 0)) {
+    return false;
+  }
+  storage_ = std::move(storage);
+  slots_ = storage_->slots();
+  capacity_ = capacity;
+  size_ = entry_count;
+  zero_key_present_ = zero_key_present;
+  total_entry_size_ = total_entry_size;
+  dirty_pages_.assign(GetPageCount(), false);
+  disk_image_id_ = 0;
+  return true;
+}
+
+void SimpleIndexTable::TakeDirtyPages(std::vector<size_t>* out_pages) const {
+  for (size_t page = 0; page < dirty_pages_.size(); ++page) {
+    if (dirty_pages_[page]) {
+      out_pages->push_back(page);
+      dirty_pages_[page] = false;
+    }
+  }
+}
+
+// static
+size_t SimpleIndexTable::GetBucket(uint64_t entry_hash, size_t capacity) {
+  // Entry hashes are uniform, but hashes chosen by tests are not; mix them.
+  const uint64_t mixed = entry_hash * UINT64_C(0x9e3779b97f4a7c15);
+  return static_cast<size_t>(mixed ^ (mixed >> 32)) & (capacity - 1);
+}
+
+// static
+size_t SimpleIndexTable::GetMaxEntryCount(size_t capacity) {
+  // Linear probing degrades quickly past a load factor of 3/4.
+  return capacity - capacity / 4;
+}
+
+void SimpleIndexTable::Allocate(size_t capacity) {
+  DCHECK_GE(capacity, kMinCapacity);
+  DCHECK_EQ(0u, capacity & (capacity - 1));
+  storage_ = CreateHeapStorage(capacity + 1);
+  slots_ = storage_->slots();
+  capacity_ = capacity;
+  size_ = 0;
+  zero_key_present_ = false;
+  total_entry_size_ = 0;
+  dirty_pages_.assign(GetPageCount(), false);
+  disk_image_id_ = 0;
+}
+
+void SimpleIndexTable::Rehash(size_t capacity) {
+  std::unique_ptr<Storage> old_storage = std::move(storage_);
+  const Slot* old_slots = slots_;
+  const size_t old_capacity = capacity_;
+  const bool old_zero_key_present = zero_key_present_;
+
+  Allocate(capacity);
+  // The slots are counted again rather than trusted, since an adopted table
+  // may come from a damaged file. Duplicated entries are dropped.
+  for (size_t i = 0; i < old_capacity; ++i) {
+    const uint64_t entry_hash = old_slots[i].first;
+    if (entry_hash == 0)
+      continue;
+    const size_t index = FindSlot(entry_hash);
+    if (index == capacity_ || slots_[index].first == entry_hash)
+      continue;
+    slots_[index] = old_slots[i];
+    ++size_;
+    total_entry_size_ += old_slots[i].second.GetEntrySize();
+  }
+  if (old_zero_key_present) {
+    slots_[capacity_] = old_slots[old_capacity];
+    zero_key_present_ = true;
+    ++size_;
+    total_entry_size_ += old_slots[old_capacity].second.GetEntrySize();
+  }
+}
+
+size_t SimpleIndexTable::FindSlot(uint64_t entry_hash) const {
+  DCHECK_NE(0u, entry_hash);
+  const size_t mask = capacity_ - 1;
+  size_t index = GetBucket(entry_hash, capacity_);
+  for (size_t probes = 0; probes < capacity_; ++probes) {
+    const uint64_t slot_hash = slots_[index].first;
+    if (slot_hash == entry_hash || slot_hash == 0)
+      return index;
+    index = (index + 1) & mask;
+  }
+  return capacity_;
+}
+
+SimpleFrequencySketch::SimpleFrequencySketch()
+    : width_(0), increment_count_(0) {
+  EnsureCapacity(0);
+}
+
+SimpleFrequencySketch::~SimpleFrequencySketch() {}
+
+void SimpleFrequencySketch::EnsureCapacity(size_t entry_count) {
+  size_t width = kMinSketchWidth;
+  while (width < entry_count)
+    width *= 2;
+  if (width <= width_)
+    return;
+  width_ = width;
+  counters_.assign(kDepth * width_, 0);
+  increment_count_ = 0;
+}
+
+void SimpleFrequencySketch::Increment(uint64_t entry_hash) {
+  for (int row = 0; row < kDepth; ++row) {
+    uint8_t& counter = counters_[GetCounterIndex(entry_hash, row)];
+    if (counter < kMaxSketchCount)
+      ++counter;
+  }
+  if (++increment_count_ < kSketchResetMultiplier * width_)
+    return;
+  for (uint8_t& counter : counters_)
+    counter /= 2;
+  increment_count_ /= 2;
+}
+
+int SimpleFrequencySketch::Estimate(uint64_t entry_hash) const {
+  int estimate = kMaxSketchCount;
+  for (int row = 0; row < kDepth; ++row) {
+    estimate = std::min<int>(estimate,
+                             counters_[GetCounterIndex(entry_hash, row)]);
+  }
+  return estimate;
+}
+
+size_t SimpleFrequencySketch::GetCounterIndex(uint64_t entry_hash,
+                                              int row) const {
+  static_assert(arraysize(kSketchSeeds) == kDepth, "one seed per row");
+  uint64_t mixed = (entry_hash ^ kSketchSeeds[row]) * kSketchSeeds[row];
+  mixed ^= mixed >> 32;
+  return row * width_ + (mixed & (width_ - 1));
+}
+
 SimpleIndex::SimpleIndex(
     const scoped_refptr<base::SingleThreadTaskRunner>& io_thread,
     SimpleIndexDelegate* delegate,
@@ -152,6 +483,9 @@ SimpleIndex::SimpleIndex(
       high_watermark_(0),
       low_watermark_(0),
       eviction_in_progress_(false),
+      eviction_bucket_hash_count_(0),
+      eviction_buckets_built_(false),
+      admission_policy_(ADMISSION_POLICY_ALL),
       initialized_(false),
       init_method_(INITIALIZE_METHOD_MAX),
       index_file_(std::move(index_file)),
@@ -201,6 +535,18 @@ void SimpleIndex::SetMaxSize(uint64_t max_bytes) {
   }
 }
 
+void SimpleIndex::SetAdmissionPolicy(AdmissionPolicy admission_policy) {
+  DCHECK(io_thread_checker_.CalledOnValidThread());
+  admission_policy_ = admission_policy;
+  admission_candidates_.clear();
+  if (admission_policy_ == ADMISSION_POLICY_TINY_LFU) {
+    if (!frequency_sketch_)
+      frequency_sketch_.reset(new SimpleFrequencySketch());
+  } else {
+    frequency_sketch_.reset();
+  }
+}
+
 int SimpleIndex::ExecuteWhenReady(const net::CompletionCallback& task) {
   DCHECK(io_thread_checker_.CalledOnValidThread());
   if (initialized_)
@@ -254,8 +600,17 @@ void SimpleIndex::Insert(uint64_t entry_hash) {
   // Upon insert we don't know yet the size of the entry.
   // It will be updated later when the SimpleEntryImpl finishes opening or
   // creating the new entry, and then UpdateEntrySize will be called.
-  InsertInEntrySet(
-      entry_hash, EntryMetadata(base::Time::Now(), 0), &entries_set_);
+  const EntryMetadata entry_metadata(base::Time::Now(), 0);
+  InsertInEntrySet(entry_hash, entry_metadata, &entries_set_);
+  AddToEvictionBuckets(entry_hash, entry_metadata);
+  if (frequency_sketch_) {
+    frequency_sketch_->Increment(entry_hash);
+    if (initialized_) {
+      admission_candidates_.push_back(entry_hash);
+      if (admission_candidates_.size() > kMaxAdmissionCandidates)
+        admission_candidates_.pop_front();
+    }
+  }
   if (!initialized_)
     removed_entries_.erase(entry_hash);
   PostponeWritingToDisk();
@@ -288,7 +643,13 @@ bool SimpleIndex::UseIfExists(uint64_t entry_hash) {
   if (it == entries_set_.end())
     // If not initialized, always return true, forcing it to go to the disk.
     return !initialized_;
-  it->second.SetLastUsedTime(base::Time::Now());
+  EntryMetadata metadata = it->second;
+  metadata.SetLastUsedTime(base::Time::Now());
+  if (GetEvictionBucket(metadata) != GetEvictionBucket(it->second))
+    AddToEvictionBuckets(entry_hash, metadata);
+  entries_set_.Update(it, metadata);
+  if (frequency_sketch_)
+    frequency_sketch_->Increment(entry_hash);
   PostponeWritingToDisk();
   return true;
 }
@@ -297,7 +658,6 @@ void SimpleIndex::StartEvictionIfNeeded() {
   DCHECK(io_thread_checker_.CalledOnValidThread());
   if (eviction_in_progress_ || cache_size_ <= high_watermark_)
     return;
-  // Take all live key hashes from the index and sort them by time.
   eviction_in_progress_ = true;
   eviction_start_time_ = base::TimeTicks::Now();
   SIMPLE_CACHE_UMA(
@@ -306,28 +666,13 @@ void SimpleIndex::StartEvictionIfNeeded() {
   SIMPLE_CACHE_UMA(
       MEMORY_KB, "Eviction.MaxCacheSizeOnStart2", cache_type_,
       static_cast<base::HistogramBase::Sample>(max_size_ / kBytesInKb));
-  std::vector<uint64_t> entry_hashes;
-  entry_hashes.reserve(entries_set_.size());
-  for (EntrySet::const_iterator it = entries_set_.begin(),
-       end = entries_set_.end(); it != end; ++it) {
-    entry_hashes.push_back(it->first);
-  }
-  std::sort(entry_hashes.begin(), entry_hashes.end(),
-            CompareHashesForTimestamp(entries_set_));
 
   // Remove as many entries from the index to get below |low_watermark_|.
-  std::vector<uint64_t>::iterator it = entry_hashes.begin();
-  uint64_t evicted_so_far_size = 0;
-  while (evicted_so_far_size < cache_size_ - low_watermark_) {
-    DCHECK(it != entry_hashes.end());
-    EntrySet::iterator found_meta = entries_set_.find(*it);
-    DCHECK(found_meta != entries_set_.end());
-    evicted_so_far_size += found_meta->second.GetEntrySize();
-    ++it;
-  }
-
-  // Take out the rest of hashes from the eviction list.
-  entry_hashes.erase(it, entry_hashes.end());
+  std::vector<uint64_t> entry_hashes;
+  uint64_t evicted_so_far_size =
+      TakeLeastRecentlyUsed(cache_size_ - low_watermark_, &entry_hashes);
+  if (admission_policy_ == ADMISSION_POLICY_TINY_LFU)
+    ApplyAdmissionPolicy(&entry_hashes, &evicted_so_far_size);
   SIMPLE_CACHE_UMA(COUNTS,
                    "Eviction.EntryCount", cache_type_, entry_hashes.size());
   SIMPLE_CACHE_UMA(TIMES,
@@ -368,6 +713,114 @@ void SimpleIndex::EvictionDone(int result) {
       static_cast<base::HistogramBase::Sample>(cache_size_ / kBytesInKb));
 }
 
+// static
+uint32_t SimpleIndex::GetEvictionBucket(const EntryMetadata& entry_metadata) {
+  // Entries used within the same hour share a bucket.
+  const int64_t hours =
+      (entry_metadata.GetLastUsedTime() - base::Time::UnixEpoch()).InHours();
+  return static_cast<uint32_t>(std::max<int64_t>(hours, 0));
+}
+
+void SimpleIndex::AddToEvictionBuckets(uint64_t entry_hash,
+                                       const EntryMetadata& entry_metadata) {
+  if (!eviction_buckets_built_)
+    return;
+  eviction_buckets_[GetEvictionBucket(entry_metadata)].push_back(entry_hash);
+  ++eviction_bucket_hash_count_;
+}
+
+void SimpleIndex::RebuildEvictionBuckets() {
+  eviction_buckets_.clear();
+  for (EntrySet::const_iterator it = entries_set_.begin(),
+       end = entries_set_.end(); it != end; ++it) {
+    eviction_buckets_[GetEvictionBucket(it->second)].push_back(it->first);
+  }
+  eviction_bucket_hash_count_ = entries_set_.size();
+  eviction_buckets_built_ = true;
+}
+
+uint64_t SimpleIndex::TakeLeastRecentlyUsed(
+    uint64_t size,
+    std::vector<uint64_t>* out_entry_hashes) {
+  if (!eviction_buckets_built_ ||
+      eviction_bucket_hash_count_ >
+          2 * entries_set_.size() + kEvictionBucketSlack) {
+    RebuildEvictionBuckets();
+  }
+
+  uint64_t taken_size = 0;
+  while (taken_size < size && !eviction_buckets_.empty()) {
+    const uint32_t bucket = eviction_buckets_.begin()->first;
+    std::vector<uint64_t> bucket_hashes;
+    bucket_hashes.swap(eviction_buckets_.begin()->second);
+    eviction_buckets_.erase(eviction_buckets_.begin());
+    eviction_bucket_hash_count_ -= bucket_hashes.size();
+
+    // Skips the stale hashes, and orders the rest by exact last used time so
+    // that the entries kept from the last bucket are the most recently used.
+    std::vector<std::pair<base::Time, uint64_t>> entries;
+    entries.reserve(bucket_hashes.size());
+    for (uint64_t entry_hash : bucket_hashes) {
+      EntrySet::const_iterator it = entries_set_.find(entry_hash);
+      if (it == entries_set_.end() || GetEvictionBucket(it->second) != bucket)
+        continue;
+      entries.push_back(
+          std::make_pair(it->second.GetLastUsedTime(), entry_hash));
+    }
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+    size_t i = 0;
+    for (; i < entries.size() && taken_size < size; ++i) {
+      out_entry_hashes->push_back(entries[i].second);
+      taken_size += entries_set_.find(entries[i].second)->second.GetEntrySize();
+    }
+    if (i < entries.size()) {
+      std::vector<uint64_t>& remaining = eviction_buckets_[bucket];
+      for (; i < entries.size(); ++i)
+        remaining.push_back(entries[i].second);
+      eviction_bucket_hash_count_ += remaining.size();
+    }
+  }
+  return taken_size;
+}
+
+void SimpleIndex::ApplyAdmissionPolicy(std::vector<uint64_t>* entry_hashes,
+                                       uint64_t* evicted_size) {
+  DCHECK(frequency_sketch_);
+  frequency_sketch_->EnsureCapacity(entries_set_.size());
+  std::unordered_set<uint64_t> doomed_hashes(entry_hashes->begin(),
+                                             entry_hashes->end());
+  int rejected_count = 0;
+  size_t next_victim = 0;
+  for (uint64_t candidate : admission_candidates_) {
+    if (next_victim == entry_hashes->size())
+      break;
+    EntrySet::const_iterator candidate_it = entries_set_.find(candidate);
+    if (candidate_it == entries_set_.end() || doomed_hashes.count(candidate))
+      continue;
+    const uint64_t victim = (*entry_hashes)[next_victim++];
+    if (frequency_sketch_->Estimate(candidate) >
+        frequency_sketch_->Estimate(victim)) {
+      continue;
+    }
+    // The candidate is not admitted: it is evicted in place of the victim,
+    // which goes back to its bucket.
+    EntrySet::const_iterator victim_it = entries_set_.find(victim);
+    DCHECK(victim_it != entries_set_.end());
+    *evicted_size = *evicted_size - victim_it->second.GetEntrySize() +
+                    candidate_it->second.GetEntrySize();
+    (*entry_hashes)[next_victim - 1] = candidate;
+    doomed_hashes.erase(victim);
+    doomed_hashes.insert(candidate);
+    AddToEvictionBuckets(victim, victim_it->second);
+    ++rejected_count;
+  }
+  admission_candidates_.clear();
+  SIMPLE_CACHE_UMA(COUNTS, "Eviction.EntriesNotAdmitted", cache_type_,
+                   rejected_count);
+}
+
 // static
 void SimpleIndex::InsertInEntrySet(
     uint64_t entry_hash,
@@ -394,7 +847,9 @@ void SimpleIndex::UpdateEntryIteratorSize(EntrySet::iterator* it,
   DCHECK_GE(cache_size_, (*it)->second.GetEntrySize());
   cache_size_ -= (*it)->second.GetEntrySize();
   cache_size_ += entry_size;
-  (*it)->second.SetEntrySize(entry_size);
+  EntryMetadata metadata = (*it)->second;
+  metadata.SetEntrySize(entry_size);
+  entries_set_.Update(*it, metadata);
 }
 
 void SimpleIndex::MergeInitializingSet(
@@ -418,17 +873,18 @@ void SimpleIndex::MergeInitializingSet(
         index_file_entries->insert(EntrySet::value_type(entry_hash,
                                                         EntryMetadata()));
     EntrySet::iterator& possibly_inserted_entry = insert_result.first;
-    possibly_inserted_entry->second = it->second;
+    index_file_entries->Update(possibly_inserted_entry, it->second);
   }
 
-  uint64_t merged_cache_size = 0;
-  for (EntrySet::iterator it = index_file_entries->begin();
-       it != index_file_entries->end(); ++it) {
-    merged_cache_size += it->second.GetEntrySize();
-  }
+  // The table keeps the total size, so that a mapped index is not read in
+  // full here.
+  const uint64_t merged_cache_size = index_file_entries->total_entry_size();
 
   entries_set_.swap(*index_file_entries);
   cache_size_ = merged_cache_size;
+  eviction_buckets_.clear();
+  eviction_bucket_hash_count_ = 0;
+  eviction_buckets_built_ = false;
   initialized_ = true;
   init_method_ = load_result->init_method;
 
@@ -7,15 +7,18 @@
 
 #include <stdint.h>
 
+#include <deque>
 #include <list>
+#include <map>
 #include <memory>
-#include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "base/callback.h"
 #include "base/files/file_path.h"
 #include "base/gtest_prod_util.h"
+#include "base/macros.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/weak_ptr.h"
 #include "base/single_thread_task_runner.h"
@@ -75,6 +78,228 @@ class NET_EXPORT_PRIVATE EntryMetadata {
 };
 static_assert(sizeof(EntryMetadata) == 8, "incorrect metadata size");
 
+// An open addressing hash table of the entries of the index, keyed by entry
+// hash, with linear probing. The slots are fixed width records, so that the
+// table is written to disk as is, and used in place from a mapping of the
+// index file; see SimpleIndexFile for the file format. Empty slots have a zero
+// hash, and the entry of hash zero, if any, lives in an extra slot past the
+// others.
+//
+// The table tracks the pages of slots modified since they were last written to
+// disk, so that the index file is updated incrementally. The metadata of an
+// entry must only be modified through Update(), which also keeps the total
+// size of the entries.
+class NET_EXPORT_PRIVATE SimpleIndexTable {
+ public:
+  struct Slot {
+    Slot() : first(0) {}
+    Slot(uint64_t entry_hash, const EntryMetadata& metadata)
+        : first(entry_hash), second(metadata) {}
+
+    // Named after the members of std::pair, so that iterators of the table
+    // are used like those of a map.
+    uint64_t first;
+    EntryMetadata second;
+  };
+
+  // The memory holding the slots of a table.
+  class Storage {
+   public:
+    virtual ~Storage() {}
+    virtual Slot* slots() = 0;
+  };
+
+  template <typename SlotType>
+  class IteratorImpl {
+   public:
+    IteratorImpl()
+        : slots_(nullptr), index_(0), capacity_(0), zero_key_present_(false) {}
+    // Converts an iterator to a const_iterator.
+    template <typename OtherSlotType>
+    IteratorImpl(const IteratorImpl<OtherSlotType>& other)
+        : slots_(other.slots_),
+          index_(other.index_),
+          capacity_(other.capacity_),
+          zero_key_present_(other.zero_key_present_) {}
+
+    SlotType& operator*() const { return slots_[index_]; }
+    SlotType* operator->() const { return &slots_[index_]; }
+
+    IteratorImpl& operator++() {
+      ++index_;
+      SkipEmptySlots();
+      return *this;
+    }
+
+    bool operator==(const IteratorImpl& other) const {
+      return slots_ == other.slots_ && index_ == other.index_;
+    }
+    bool operator!=(const IteratorImpl& other) const {
+      return !(*this == other);
+    }
+
+   private:
+    friend class SimpleIndexTable;
+    template <typename OtherSlotType>
+    friend class IteratorImpl;
+
+    IteratorImpl(SlotType* slots,
+                 size_t index,
+                 size_t capacity,
+                 bool zero_key_present)
+        : slots_(slots),
+          index_(index),
+          capacity_(capacity),
+          zero_key_present_(zero_key_present) {}
+
+    void SkipEmptySlots() {
+      while (index_ < capacity_ && slots_[index_].first == 0)
+        ++index_;
+      if (index_ == capacity_ && !zero_key_present_)
+        ++index_;
+    }
+
+    SlotType* slots_;
+    size_t index_;
+    size_t capacity_;
+    bool zero_key_present_;
+  };
+
+  using key_type = uint64_t;
+  using value_type = std::pair<uint64_t, EntryMetadata>;
+  using iterator = IteratorImpl<Slot>;
+  using const_iterator = IteratorImpl<const Slot>;
+
+  // Slots are written to disk by pages of this size.
+  static const size_t kPageSize = 4096;
+  static const size_t kSlotsPerPage = kPageSize / sizeof(Slot);
+  static const size_t kMinCapacity = 16;
+
+  SimpleIndexTable();
+  SimpleIndexTable(const SimpleIndexTable& other);
+  ~SimpleIndexTable();
+
+  SimpleIndexTable& operator=(const SimpleIndexTable& other);
+
+  static std::unique_ptr<Storage> CreateHeapStorage(size_t slot_count);
+
+  iterator begin();
+  iterator end();
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  iterator find(uint64_t entry_hash);
+  const_iterator find(uint64_t entry_hash) const;
+  size_t count(uint64_t entry_hash) const;
+
+  // Like std::unordered_map::insert(), does nothing if the entry exists.
+  std::pair<iterator, bool> insert(const value_type& value);
+
+  void erase(iterator it);
+  size_t erase(uint64_t entry_hash);
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // Grows the table to hold |entry_count| entries without further growth.
+  void reserve(size_t entry_count);
+
+  void clear();
+  void swap(SimpleIndexTable& other);
+
+  // Replaces the metadata of the entry at |it|.
+  void Update(iterator it, const EntryMetadata& metadata);
+
+  // The sum of the sizes of the entries.
+  uint64_t total_entry_size() const { return total_entry_size_; }
+
+  // The layout of the table: |capacity| slots, followed by the slot of the
+  // entry of hash zero.
+  size_t capacity() const { return capacity_; }
+  bool zero_key_present() const { return zero_key_present_; }
+  size_t GetSlotCount() const { return capacity_ + 1; }
+  size_t GetPageCount() const;
+  const Slot* slots() const { return slots_; }
+
+  // Takes over the slots of a table laid out as above in |storage|, as
+  // written to disk. Only the layout is validated, since the slots are not
+  // read until used. Returns false, leaving the table unchanged, if the
+  // layout is invalid.
+  bool Adopt(std::unique_ptr<Storage> storage,
+             size_t capacity,
+             bool zero_key_present,
+             size_t entry_count,
+             uint64_t total_entry_size);
+
+  // Identifies the index file whose slots match this table, but for the dirty
+  // pages; zero if there is none. Growing or copying the table resets it. The
+  // disk image is tracked even through a const table, since writing the table
+  // to disk does not change its contents.
+  uint64_t disk_image_id() const { return disk_image_id_; }
+  void set_disk_image_id(uint64_t disk_image_id) const {
+    disk_image_id_ = disk_image_id;
+  }
+
+  // Appends the indices of the pages modified since the previous call to
+  // |out_pages|, and marks them clean.
+  void TakeDirtyPages(std::vector<size_t>* out_pages) const;
+
+ private:
+  static size_t GetBucket(uint64_t entry_hash, size_t capacity);
+  static size_t GetMaxEntryCount(size_t capacity);
+
+  // Replaces the slots with |capacity| empty ones.
+  void Allocate(size_t capacity);
+
+  // Moves the entries to a table of |capacity| slots.
+  void Rehash(size_t capacity);
+
+  // Returns the slot of |entry_hash|, or the empty slot ending its probe
+  // sequence, or |capacity_| if the table is full.
+  size_t FindSlot(uint64_t entry_hash) const;
+
+  void MarkDirty(size_t slot_index) {
+    dirty_pages_[slot_index / kSlotsPerPage] = true;
+  }
+
+  std::unique_ptr<Storage> storage_;
+  Slot* slots_;
+  size_t capacity_;
+  size_t size_;
+  bool zero_key_present_;
+  uint64_t total_entry_size_;
+
+  mutable std::vector<bool> dirty_pages_;
+  mutable uint64_t disk_image_id_;
+};
+static_assert(sizeof(SimpleIndexTable::Slot) == 16, "incorrect slot size");
+
+// Estimates how often entries were used recently, in a fixed amount of memory:
+// a count-min sketch of small saturating counters, which are all halved
+// periodically so that old uses fade. Used by the TinyLFU admission policy.
+class NET_EXPORT_PRIVATE SimpleFrequencySketch {
+ public:
+  SimpleFrequencySketch();
+  ~SimpleFrequencySketch();
+
+  // Sizes the sketch for |entry_count| entries. Growing it forgets the counts.
+  void EnsureCapacity(size_t entry_count);
+
+  void Increment(uint64_t entry_hash);
+  int Estimate(uint64_t entry_hash) const;
+
+ private:
+  static const int kDepth = 4;
+
+  size_t GetCounterIndex(uint64_t entry_hash, int row) const;
+
+  std::vector<uint8_t> counters_;
+  size_t width_;
+  size_t increment_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(SimpleFrequencySketch);
+};
+
 // This class is not Thread-safe.
 class NET_EXPORT_PRIVATE SimpleIndex
     : public base::SupportsWeakPtr<SimpleIndex> {
@@ -95,6 +320,15 @@ class NET_EXPORT_PRIVATE SimpleIndex
     INDEX_WRITE_REASON_MAX = 4,
   };
 
+  enum AdmissionPolicy {
+    // Entries are kept until evicted in least recently used order.
+    ADMISSION_POLICY_ALL = 0,
+    // Each entry created since the previous eviction competes with the least
+    // recently used entry it would displace, and is evicted instead unless it
+    // is estimated to be used more often (TinyLFU).
+    ADMISSION_POLICY_TINY_LFU = 1,
+  };
+
   typedef std::vector<uint64_t> HashList;
 
   SimpleIndex(const scoped_refptr<base::SingleThreadTaskRunner>& io_thread,
@@ -109,6 +343,8 @@ class NET_EXPORT_PRIVATE SimpleIndex
   void SetMaxSize(uint64_t max_bytes);
   uint64_t max_size() const { return max_size_; }
 
+  void SetAdmissionPolicy(AdmissionPolicy admission_policy);
+
   void Insert(uint64_t entry_hash);
   void Remove(uint64_t entry_hash);
 
@@ -126,7 +362,7 @@ class NET_EXPORT_PRIVATE SimpleIndex
   // entry.
   bool UpdateEntrySize(uint64_t entry_hash, int64_t entry_size);
 
-  using EntrySet = std::unordered_map<uint64_t, EntryMetadata>;
+  using EntrySet = SimpleIndexTable;
 
   static void InsertInEntrySet(uint64_t entry_hash,
                                const EntryMetadata& entry_metadata,
@@ -164,9 +400,32 @@ class NET_EXPORT_PRIVATE SimpleIndex
   FRIEND_TEST_ALL_PREFIXES(SimpleIndexTest, DiskWriteExecuted);
   FRIEND_TEST_ALL_PREFIXES(SimpleIndexTest, DiskWritePostponed);
 
+  // Entry hashes by coarse last used time, oldest first.
+  using EvictionBucketMap = std::map<uint32_t, std::vector<uint64_t>>;
+
   void StartEvictionIfNeeded();
   void EvictionDone(int result);
 
+  static uint32_t GetEvictionBucket(const EntryMetadata& entry_metadata);
+
+  // Files |entry_hash| under the bucket of |entry_metadata|, once the buckets
+  // are in use.
+  void AddToEvictionBuckets(uint64_t entry_hash,
+                            const EntryMetadata& entry_metadata);
+  void RebuildEvictionBuckets();
+
+  // Moves the least recently used entries, adding up to at least |size| bytes,
+  // out of the eviction buckets and into |out_entry_hashes|, oldest first.
+  // Returns their total size, which is less than |size| if the buckets run
+  // out first.
+  uint64_t TakeLeastRecentlyUsed(uint64_t size,
+                                 std::vector<uint64_t>* out_entry_hashes);
+
+  // Lets the entries created since the previous eviction compete with the
+  // entries to evict in |entry_hashes|, of |evicted_size| bytes in total.
+  void ApplyAdmissionPolicy(std::vector<uint64_t>* entry_hashes,
+                            uint64_t* evicted_size);
+
   void PostponeWritingToDisk();
 
   void UpdateEntryIteratorSize(EntrySet::iterator* it, int64_t entry_size);
@@ -194,6 +453,19 @@ class NET_EXPORT_PRIVATE SimpleIndex
   bool eviction_in_progress_;
   base::TimeTicks eviction_start_time_;
 
+  // The eviction buckets are built on the first eviction, then kept up to
+  // date as entries are created and used. Hashes are not taken out of their
+  // bucket when their entry is removed or used again; such stale hashes are
+  // skipped when evicting, and dropped when the buckets are rebuilt.
+  EvictionBucketMap eviction_buckets_;
+  size_t eviction_bucket_hash_count_;
+  bool eviction_buckets_built_;
+
+  AdmissionPolicy admission_policy_;
+  std::unique_ptr<SimpleFrequencySketch> frequency_sketch_;
+  // The entries created since the previous eviction, most recent last.
+  std::deque<uint64_t> admission_candidates_;
+
   // This stores all the entry_hash of entries that are removed during
   // initialization.
   std::unordered_set<uint64_t> removed_entries_;
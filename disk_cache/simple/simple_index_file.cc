@@ -4,6 +4,10 @@
 
 #include "net/disk_cache/simple/simple_index_file.h"
 
+#include <stddef.h>
+#include <string.h>
+
+#include <algorithm>
 #include <utility>
 #include <vector>
 
@@ -14,6 +18,7 @@
 #include "base/logging.h"
 #include "base/numerics/safe_conversions.h"
 #include "base/pickle.h"
+#include "base/rand_util.h"
 #include "base/single_thread_task_runner.h"
 #include "base/task_runner_util.h"
 #include "base/threading/thread_restrictions.h"
@@ -21,6 +26,7 @@
 #include "net/disk_cache/simple/simple_entry_format.h"
 #include "net/disk_cache/simple/simple_histogram_macros.h"
 #include "net/disk_cache/simple/simple_index.h"
+#include "net/disk_cache/simple/simple_segment_store.h"
 #include "net/disk_cache/simple/simple_synchronous_entry.h"
 #include "net/disk_cache/simple/simple_util.h"
 #include "third_party/zlib/zlib.h"
@@ -102,22 +108,44 @@ void UmaRecordStaleIndexQuality(int missed_entry_count,
                    STALE_INDEX_MAX);
 }
 
-bool WritePickleFile(base::Pickle* pickle, const base::FilePath& file_name) {
-  File file(
-      file_name,
-      File::FLAG_CREATE_ALWAYS | File::FLAG_WRITE | File::FLAG_SHARE_DELETE);
-  if (!file.IsValid())
-    return false;
-
-  int bytes_written =
-      file.Write(0, static_cast<const char*>(pickle->data()), pickle->size());
-  if (bytes_written != base::checked_cast<int>(pickle->size())) {
-    simple_util::SimpleCacheDeleteFile(file_name);
-    return false;
+// The slots of large tables are written by chunks of this many.
+const size_t kSlotsPerWrite = 256 * 1024;
+
+bool WriteSlots(File* file,
+                int64_t offset,
+                const SimpleIndexTable::Slot* slots,
+                size_t slot_count) {
+  for (size_t written = 0; written < slot_count; written += kSlotsPerWrite) {
+    const int size = static_cast<int>(
+        std::min(kSlotsPerWrite, slot_count - written) *
+        sizeof(SimpleIndexTable::Slot));
+    if (file->Write(offset + written * sizeof(SimpleIndexTable::Slot),
+                    reinterpret_cast<const char*>(slots + written),
+                    size) != size) {
+      return false;
+    }
   }
   return true;
 }
 
+bool WriteHeader(File* file, const void* header, size_t header_size) {
+  return file->Write(0, static_cast<const char*>(header), header_size) ==
+         static_cast<int>(header_size);
+}
+
+// The offset in the index file of the page of slots |page|.
+int64_t GetPageOffset(size_t page) {
+  return static_cast<int64_t>(page + 1) * SimpleIndexTable::kPageSize;
+}
+
+uint64_t CreateDiskImageId() {
+  uint64_t disk_image_id;
+  do {
+    disk_image_id = base::RandUint64();
+  } while (disk_image_id == 0);
+  return disk_image_id;
+}
+
 // Called for each cache directory traversal iteration.
 void ProcessEntryFile(SimpleIndex::EntrySet* entries,
                       const base::FilePath& file_path) {
@@ -161,7 +189,24 @@ void ProcessEntryFile(SimpleIndex::EntrySet* entries,
         entries);
   } else {
     // Summing up the total size of the entry through all the *_[0-1] files
-    it->second.SetEntrySize(it->second.GetEntrySize() + file_size);
+    EntryMetadata metadata = it->second;
+    metadata.SetEntrySize(metadata.GetEntrySize() + file_size);
+    entries->Update(it, metadata);
+  }
+}
+
+// Adds the entries packed in the segment store, which have no files of their
+// own in the cache directory.
+void ProcessPackedEntries(SimpleIndex::EntrySet* entries,
+                          const base::FilePath& cache_directory) {
+  std::vector<SimpleSegmentStore::EntryInfo> packed_entries;
+  SimpleSegmentStore::GetEntries(cache_directory, &packed_entries);
+  for (const SimpleSegmentStore::EntryInfo& info : packed_entries) {
+    if (entries->count(info.entry_hash))
+      continue;
+    SimpleIndex::InsertInEntrySet(
+        info.entry_hash, EntryMetadata(info.last_modified, info.size),
+        entries);
   }
 }
 
@@ -182,6 +227,12 @@ void SimpleIndexLoadResult::Reset() {
   entries.clear();
 }
 
+SimpleIndexFile::IndexImage::IndexImage() {
+  memset(&header, 0, sizeof(header));
+}
+
+SimpleIndexFile::IndexImage::~IndexImage() {}
+
 // static
 const char SimpleIndexFile::kIndexFileName[] = "the-real-index";
 // static
@@ -246,7 +297,7 @@ void SimpleIndexFile::SyncWriteToDisk(net::CacheType cache_type,
                                       const base::FilePath& cache_directory,
                                       const base::FilePath& index_filename,
                                       const base::FilePath& temp_index_filename,
-                                      std::unique_ptr<base::Pickle> pickle,
+                                      std::unique_ptr<IndexImage> image,
                                       const base::TimeTicks& start_time,
                                       bool app_on_background) {
   DCHECK_EQ(index_filename.DirName().value(),
@@ -268,11 +319,22 @@ void SimpleIndexFile::SyncWriteToDisk(net::CacheType cache_type,
     LOG(ERROR) << "Could obtain information about cache age";
     return;
   }
-  SerializeFinalData(cache_dir_mtime, pickle.get());
-  if (!WritePickleFile(pickle.get(), temp_index_filename)) {
+  image->header.cache_last_modified = cache_dir_mtime.ToInternalValue();
+  image->header.clean = 1;
+  image->header.crc = CalculateHeaderCRC(image->header);
+  File file(temp_index_filename,
+            File::FLAG_CREATE_ALWAYS | File::FLAG_WRITE |
+                File::FLAG_SHARE_DELETE);
+  if (!file.IsValid() ||
+      !WriteHeader(&file, &image->header, sizeof(image->header)) ||
+      !WriteSlots(&file, GetPageOffset(0), image->slots.data(),
+                  image->slots.size())) {
     LOG(ERROR) << "Failed to write the temporary index file";
+    file.Close();
+    simple_util::SimpleCacheDeleteFile(temp_index_filename);
     return;
   }
+  file.Close();
 
   // Atomically rename the temporary index file to become the real one.
   // TODO(gavinp): DCHECK when not shutting down, since that is very strange.
@@ -281,6 +343,69 @@ void SimpleIndexFile::SyncWriteToDisk(net::CacheType cache_type,
   if (!base::ReplaceFile(temp_index_filename, index_filename, NULL))
     return;
 
+  RecordWriteTime(cache_type, start_time, app_on_background);
+}
+
+// static
+bool SimpleIndexFile::SyncUpdateOnDisk(net::CacheType cache_type,
+                                       const base::FilePath& cache_directory,
+                                       const base::FilePath& index_filename,
+                                       std::unique_ptr<IndexImage> image,
+                                       const base::TimeTicks& start_time,
+                                       bool app_on_background) {
+  File file(index_filename,
+            File::FLAG_OPEN | File::FLAG_READ | File::FLAG_WRITE |
+                File::FLAG_SHARE_DELETE);
+  if (!file.IsValid())
+    return false;
+  FlatIndexHeader header;
+  if (file.Read(0, reinterpret_cast<char*>(&header), sizeof(header)) !=
+          static_cast<int>(sizeof(header)) ||
+      !CheckFlatIndexHeader(header) || !header.clean ||
+      header.image_id != image->header.image_id ||
+      header.capacity != image->header.capacity) {
+    // The file holds another table; the table is written in full next time.
+    return false;
+  }
+  base::Time cache_dir_mtime;
+  if (!simple_util::GetMTime(cache_directory, &cache_dir_mtime)) {
+    LOG(ERROR) << "Could obtain information about cache age";
+    return false;
+  }
+
+  // The file is marked dirty until all the pages are written.
+  header.clean = 0;
+  header.crc = CalculateHeaderCRC(header);
+  bool succeeded = WriteHeader(&file, &header, sizeof(header));
+  const size_t slot_count = image->header.capacity + 1;
+  const SimpleIndexTable::Slot* slots = image->slots.data();
+  for (size_t i = 0; succeeded && i < image->pages.size(); ++i) {
+    const size_t page = image->pages[i];
+    const size_t first_slot = page * SimpleIndexTable::kSlotsPerPage;
+    const size_t page_slot_count =
+        std::min(SimpleIndexTable::kSlotsPerPage, slot_count - first_slot);
+    succeeded = WriteSlots(&file, GetPageOffset(page), slots, page_slot_count);
+    slots += page_slot_count;
+  }
+  image->header.cache_last_modified = cache_dir_mtime.ToInternalValue();
+  image->header.clean = 1;
+  image->header.crc = CalculateHeaderCRC(image->header);
+  if (!succeeded ||
+      !WriteHeader(&file, &image->header, sizeof(image->header))) {
+    LOG(ERROR) << "Failed to update the index file";
+    file.Close();
+    simple_util::SimpleCacheDeleteFile(index_filename);
+    return false;
+  }
+
+  RecordWriteTime(cache_type, start_time, app_on_background);
+  return true;
+}
+
+// static
+void SimpleIndexFile::RecordWriteTime(net::CacheType cache_type,
+                                      const base::TimeTicks& start_time,
+                                      bool app_on_background) {
   if (app_on_background) {
     SIMPLE_CACHE_UMA(TIMES,
                      "IndexWriteToDiskTime.Background", cache_type,
@@ -292,17 +417,36 @@ void SimpleIndexFile::SyncWriteToDisk(net::CacheType cache_type,
   }
 }
 
+// static
+uint32_t SimpleIndexFile::CalculateHeaderCRC(const FlatIndexHeader& header) {
+  return crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(&header),
+               offsetof(FlatIndexHeader, crc));
+}
+
+// static
+bool SimpleIndexFile::CheckFlatIndexHeader(const FlatIndexHeader& header) {
+  return header.magic_number == kSimpleFlatIndexMagicNumber &&
+         (header.version == 7 || header.version == kSimpleVersion) &&
+         header.reason <
+             static_cast<uint32_t>(SimpleIndex::INDEX_WRITE_REASON_MAX) &&
+         header.entry_count <= kMaxEntriesInIndex &&
+         header.capacity <= 2 * kMaxEntriesInIndex &&
+         header.crc == CalculateHeaderCRC(header);
+}
+
 bool SimpleIndexFile::IndexMetadata::CheckIndexMetadata() {
   if (entry_count_ > kMaxEntriesInIndex ||
       magic_number_ != kSimpleIndexMagicNumber) {
     return false;
   }
 
-  static_assert(kSimpleVersion == 7, "index metadata reader out of date");
-  // No |reason_| is saved in the version 6 file format.
+  static_assert(kSimpleVersion == 8, "index metadata reader out of date");
+  // No |reason_| is saved in the version 6 file format. Version 8 only changed
+  // the entry files.
   if (version_ == 6)
     return reason_ == SimpleIndex::INDEX_WRITE_REASON_MAX;
-  return version_ == 7 && reason_ < SimpleIndex::INDEX_WRITE_REASON_MAX;
+  return (version_ == 7 || version_ == 8) &&
+         reason_ < SimpleIndex::INDEX_WRITE_REASON_MAX;
 }
 
 SimpleIndexFile::SimpleIndexFile(
@@ -317,7 +461,11 @@ SimpleIndexFile::SimpleIndexFile(
       index_file_(cache_directory_.AppendASCII(kIndexDirectory)
                       .AppendASCII(kIndexFileName)),
       temp_index_file_(cache_directory_.AppendASCII(kIndexDirectory)
-                           .AppendASCII(kTempIndexFileName)) {
+                           .AppendASCII(kTempIndexFileName)),
+      stale_disk_image_id_(0),
+      weak_ptr_factory_(this) {
+  static_assert(sizeof(FlatIndexHeader) <= SimpleIndexTable::kPageSize,
+                "index file header too large");
 }
 
 SimpleIndexFile::~SimpleIndexFile() {}
@@ -339,18 +487,64 @@ void SimpleIndexFile::WriteToDisk(SimpleIndex::IndexWriteToDiskReason reason,
                                   bool app_on_background,
                                   const base::Closure& callback) {
   UmaRecordIndexWriteReason(reason, cache_type_);
-  IndexMetadata index_metadata(reason, entry_set.size(), cache_size);
-  std::unique_ptr<base::Pickle> pickle = Serialize(index_metadata, entry_set);
+  std::unique_ptr<IndexImage> image(new IndexImage());
+  FlatIndexHeader* header = &image->header;
+  header->magic_number = kSimpleFlatIndexMagicNumber;
+  header->version = kSimpleVersion;
+  header->reason = reason;
+  header->entry_count = entry_set.size();
+  // The table keeps the size loaded back with it, which is |cache_size|.
+  header->cache_size = entry_set.total_entry_size();
+  header->capacity = entry_set.capacity();
+  header->zero_key_present = entry_set.zero_key_present();
+
+  const uint64_t disk_image_id = entry_set.disk_image_id();
+  if (disk_image_id != 0 && disk_image_id != stale_disk_image_id_) {
+    header->image_id = disk_image_id;
+    entry_set.TakeDirtyPages(&image->pages);
+    const size_t slot_count = entry_set.GetSlotCount();
+    for (size_t page : image->pages) {
+      const size_t first_slot = page * SimpleIndexTable::kSlotsPerPage;
+      const size_t last_slot =
+          std::min(slot_count, first_slot + SimpleIndexTable::kSlotsPerPage);
+      image->slots.insert(image->slots.end(), entry_set.slots() + first_slot,
+                          entry_set.slots() + last_slot);
+    }
+    base::PostTaskAndReplyWithResult(
+        cache_thread_.get(), FROM_HERE,
+        base::Bind(&SimpleIndexFile::SyncUpdateOnDisk, cache_type_,
+                   cache_directory_, index_file_, base::Passed(&image), start,
+                   app_on_background),
+        base::Bind(&SimpleIndexFile::UpdateOnDiskDone,
+                   weak_ptr_factory_.GetWeakPtr(), disk_image_id, callback));
+    return;
+  }
+
+  header->image_id = CreateDiskImageId();
+  std::vector<size_t> dirty_pages;
+  entry_set.TakeDirtyPages(&dirty_pages);
+  image->slots.assign(entry_set.slots(),
+                      entry_set.slots() + entry_set.GetSlotCount());
+  entry_set.set_disk_image_id(header->image_id);
   base::Closure task =
       base::Bind(&SimpleIndexFile::SyncWriteToDisk,
                  cache_type_, cache_directory_, index_file_, temp_index_file_,
-                 base::Passed(&pickle), start, app_on_background);
+                 base::Passed(&image), start, app_on_background);
   if (callback.is_null())
     cache_thread_->PostTask(FROM_HERE, task);
   else
     cache_thread_->PostTaskAndReply(FROM_HERE, task, callback);
 }
 
+void SimpleIndexFile::UpdateOnDiskDone(uint64_t disk_image_id,
+                                       const base::Closure& callback,
+                                       bool succeeded) {
+  if (!succeeded)
+    stale_disk_image_id_ = disk_image_id;
+  if (!callback.is_null())
+    callback.Run();
+}
+
 // static
 void SimpleIndexFile::SyncLoadIndexEntries(
     net::CacheType cache_type,
@@ -433,6 +627,19 @@ void SimpleIndexFile::SyncLoadFromDisk(const base::FilePath& index_filename,
   if (!file.IsValid())
     return;
 
+  uint64_t magic_number;
+  if (file.Read(0, reinterpret_cast<char*>(&magic_number),
+                sizeof(magic_number)) ==
+          static_cast<int>(sizeof(magic_number)) &&
+      magic_number == kSimpleFlatIndexMagicNumber) {
+    LoadFlatIndex(&file, file.GetLength(), out_last_cache_seen_by_index,
+                  out_result);
+    if (!out_result->did_load)
+      simple_util::SimpleCacheDeleteFile(index_filename);
+    return;
+  }
+
+  // An index written by an older version.
   base::MemoryMappedFile index_file_map;
   if (!index_file_map.Initialize(std::move(file))) {
     simple_util::SimpleCacheDeleteFile(index_filename);
@@ -449,6 +656,48 @@ void SimpleIndexFile::SyncLoadFromDisk(const base::FilePath& index_filename,
     simple_util::SimpleCacheDeleteFile(index_filename);
 }
 
+// static
+void SimpleIndexFile::LoadFlatIndex(File* file,
+                                    int64_t file_length,
+                                    base::Time* out_last_cache_seen_by_index,
+                                    SimpleIndexLoadResult* out_result) {
+  FlatIndexHeader header;
+  if (file->Read(0, reinterpret_cast<char*>(&header), sizeof(header)) !=
+          static_cast<int>(sizeof(header)) ||
+      !CheckFlatIndexHeader(header)) {
+    LOG(WARNING) << "Invalid header in Simple Index file.";
+    return;
+  }
+  if (!header.clean) {
+    LOG(WARNING) << "Interrupted write of Simple Index file.";
+    return;
+  }
+  const int64_t expected_length = GetPageOffset(0) +
+      static_cast<int64_t>(header.capacity + 1) *
+          sizeof(SimpleIndexTable::Slot);
+  if (file_length != expected_length) {
+    LOG(WARNING) << "Truncated Simple Index file.";
+    return;
+  }
+
+  std::unique_ptr<SimpleIndexTable::Storage> storage =
+      MapIndexTable(file, file_length);
+  if (!storage ||
+      !out_result->entries.Adopt(std::move(storage), header.capacity,
+                                 header.zero_key_present != 0,
+                                 header.entry_count, header.cache_size)) {
+    return;
+  }
+  out_result->entries.set_disk_image_id(header.image_id);
+
+  DCHECK(out_last_cache_seen_by_index);
+  *out_last_cache_seen_by_index =
+      base::Time::FromInternalValue(header.cache_last_modified);
+  out_result->index_write_reason =
+      static_cast<SimpleIndex::IndexWriteToDiskReason>(header.reason);
+  out_result->did_load = true;
+}
+
 // static
 std::unique_ptr<base::Pickle> SimpleIndexFile::Serialize(
     const SimpleIndexFile::IndexMetadata& index_metadata,
@@ -543,6 +792,7 @@ void SimpleIndexFile::SyncRestoreFromDisk(
     LOG(ERROR) << "Could not reconstruct index from disk";
     return;
   }
+  ProcessPackedEntries(entries, cache_directory);
   out_result->did_load = true;
   // When we restore from disk we write the merged index file to disk right
   // away, this might save us from having to restore again next time.
@@ -15,12 +15,14 @@
 #include "base/gtest_prod_util.h"
 #include "base/logging.h"
 #include "base/macros.h"
+#include "base/memory/weak_ptr.h"
 #include "base/pickle.h"
 #include "net/base/cache_type.h"
 #include "net/base/net_export.h"
 #include "net/disk_cache/simple/simple_index.h"
 
 namespace base {
+class File;
 class SingleThreadTaskRunner;
 class TaskRunner;
 }
@@ -28,6 +30,7 @@ class TaskRunner;
 namespace disk_cache {
 
 const uint64_t kSimpleIndexMagicNumber = UINT64_C(0x656e74657220796f);
+const uint64_t kSimpleFlatIndexMagicNumber = UINT64_C(0x78646e6974616c66);
 
 struct NET_EXPORT_PRIVATE SimpleIndexLoadResult {
   SimpleIndexLoadResult();
@@ -41,11 +44,18 @@ struct NET_EXPORT_PRIVATE SimpleIndexLoadResult {
   bool flush_required;
 };
 
-// Simple Index File format is a pickle of IndexMetadata and EntryMetadata
-// objects. The file format is as follows: one instance of |IndexMetadata|
-// followed by |EntryMetadata| repeated |entry_count| times. To learn more about
-// the format see |SimpleIndexFile::Serialize()| and
-// |SimpleIndexFile::LoadFromDisk()|.
+// Simple Index File format is the image of a SimpleIndexTable: a
+// |FlatIndexHeader|, padded to SimpleIndexTable::kPageSize, followed by the
+// slots of the table. The slots are used in place from a private mapping of
+// the file where possible, so loading the index does not read every entry.
+// Writes of a table loaded from or written to the file only rewrite the pages
+// of slots modified since, and mark the header while doing so, so that an
+// interrupted write is detected on load.
+//
+// Index files written by older versions are a pickle of IndexMetadata and
+// EntryMetadata objects: one instance of |IndexMetadata| followed by
+// |EntryMetadata| repeated |entry_count| times. They are still loaded, see
+// |SimpleIndexFile::Serialize()| and |SimpleIndexFile::Deserialize()|.
 //
 // The non-static methods must run on the IO thread. All the real
 // work is done in the static methods, which are run on the cache thread
@@ -107,6 +117,36 @@ class NET_EXPORT_PRIVATE SimpleIndexFile {
   // Used for cache directory traversal.
   typedef base::Callback<void (const base::FilePath&)> EntryFileCallback;
 
+  // The header of an index file in the flat format.
+  struct FlatIndexHeader {
+    uint64_t magic_number;
+    uint32_t version;
+    uint32_t reason;
+    // Identifies the table written, see SimpleIndexTable::disk_image_id().
+    uint64_t image_id;
+    uint64_t entry_count;
+    uint64_t cache_size;
+    int64_t cache_last_modified;
+    uint64_t capacity;
+    uint32_t zero_key_present;
+    // Zero while pages of slots are being rewritten.
+    uint32_t clean;
+    // Of the preceding fields.
+    uint32_t crc;
+    uint32_t padding;
+  };
+
+  // What is written to disk: the header, and either all the slots of the
+  // table, or only the pages of slots listed in |pages|.
+  struct IndexImage {
+    IndexImage();
+    ~IndexImage();
+
+    FlatIndexHeader header;
+    std::vector<size_t> pages;
+    std::vector<SimpleIndexTable::Slot> slots;
+  };
+
   // When loading the entries from disk, add this many extra hash buckets to
   // prevent reallocation on the IO thread when merging in new live entries.
   static const int kExtraSizeForMerge = 512;
@@ -123,9 +163,25 @@ class NET_EXPORT_PRIVATE SimpleIndexFile {
                                base::Time* out_last_cache_seen_by_index,
                                SimpleIndexLoadResult* out_result);
 
+  // Loads the table of the flat index file |file| of |file_length| bytes.
+  static void LoadFlatIndex(base::File* file,
+                            int64_t file_length,
+                            base::Time* out_last_cache_seen_by_index,
+                            SimpleIndexLoadResult* out_result);
+
+  static uint32_t CalculateHeaderCRC(const FlatIndexHeader& header);
+  static bool CheckFlatIndexHeader(const FlatIndexHeader& header);
+
+  // Implemented either in simple_index_file_posix.cc or
+  // simple_index_file_win.cc. Returns the storage of the slots of the flat
+  // index file |file| of |file_length| bytes: a private writable mapping where
+  // available, and a copy otherwise. Returns null on error.
+  static std::unique_ptr<SimpleIndexTable::Storage> MapIndexTable(
+      base::File* file,
+      int64_t file_length);
+
   // Returns a scoped_ptr for a newly allocated base::Pickle containing the
-  // serialized
-  // data to be written to a file. Note: the pickle is not in a consistent state
+  // serialized data of an index file in the format of older versions. Note: the pickle is not in a consistent state
   // immediately after calling this menthod, one needs to call
   // SerializeFinalData to make it ready to write to a file.
   static std::unique_ptr<base::Pickle> Serialize(
@@ -159,10 +215,29 @@ class NET_EXPORT_PRIVATE SimpleIndexFile {
                               const base::FilePath& cache_directory,
                               const base::FilePath& index_filename,
                               const base::FilePath& temp_index_filename,
-                              std::unique_ptr<base::Pickle> pickle,
+                              std::unique_ptr<IndexImage> image,
+                              const base::TimeTicks& start_time,
+                              bool app_on_background);
+
+  // Rewrites the pages of |image| in the index file, which must hold the
+  // disk image of the same table. Returns false, deleting the index file if
+  // it was modified, on failure.
+  static bool SyncUpdateOnDisk(net::CacheType cache_type,
+                               const base::FilePath& cache_directory,
+                               const base::FilePath& index_filename,
+                               std::unique_ptr<IndexImage> image,
+                               const base::TimeTicks& start_time,
+                               bool app_on_background);
+
+  static void RecordWriteTime(net::CacheType cache_type,
                               const base::TimeTicks& start_time,
                               bool app_on_background);
 
+  // Called on the IO thread once the index file was updated.
+  void UpdateOnDiskDone(uint64_t disk_image_id,
+                        const base::Closure& callback,
+                        bool succeeded);
+
   // Scan the index directory for entries, returning an EntrySet of all entries
   // found.
   static void SyncRestoreFromDisk(const base::FilePath& cache_directory,
@@ -187,6 +262,11 @@ class NET_EXPORT_PRIVATE SimpleIndexFile {
   const base::FilePath index_file_;
   const base::FilePath temp_index_file_;
 
+  // The disk image that failed to be updated, to be written in full instead.
+  uint64_t stale_disk_image_id_;
+
+  base::WeakPtrFactory<SimpleIndexFile> weak_ptr_factory_;
+
   static const char kIndexDirectory[];
   static const char kIndexFileName[];
   static const char kTempIndexFileName[];
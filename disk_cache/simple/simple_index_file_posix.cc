@@ -5,6 +5,7 @@
 #include "net/disk_cache/simple/simple_index_file.h"
 
 #include <dirent.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
@@ -12,7 +13,9 @@
 #include <memory>
 #include <string>
 
+#include "base/files/file.h"
 #include "base/logging.h"
+#include "base/macros.h"
 
 namespace disk_cache {
 namespace {
@@ -23,6 +26,26 @@ struct DirCloser {
 
 typedef std::unique_ptr<DIR, DirCloser> ScopedDir;
 
+// The slots of an index file mapped privately: pages written to are copied,
+// and the file is left alone.
+class MappedStorage : public SimpleIndexTable::Storage {
+ public:
+  MappedStorage(void* address, size_t length)
+      : address_(address), length_(length) {}
+  ~MappedStorage() override { munmap(address_, length_); }
+
+  SimpleIndexTable::Slot* slots() override {
+    return reinterpret_cast<SimpleIndexTable::Slot*>(
+        static_cast<char*>(address_) + SimpleIndexTable::kPageSize);
+  }
+
+ private:
+  void* const address_;
+  const size_t length_;
+
+  DISALLOW_COPY_AND_ASSIGN(MappedStorage);
+};
+
 }  // namespace
 
 // static
@@ -49,4 +72,18 @@ bool SimpleIndexFile::TraverseCacheDirectory(
   return false;
 }
 
+// static
+std::unique_ptr<SimpleIndexTable::Storage> SimpleIndexFile::MapIndexTable(
+    base::File* file,
+    int64_t file_length) {
+  void* address = mmap(nullptr, file_length, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE, file->GetPlatformFile(), 0);
+  if (address == MAP_FAILED) {
+    PLOG(ERROR) << "mmap";
+    return nullptr;
+  }
+  return std::unique_ptr<SimpleIndexTable::Storage>(
+      new MappedStorage(address, file_length));
+}
+
 }  // namespace disk_cache
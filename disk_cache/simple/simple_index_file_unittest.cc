@@ -124,10 +124,13 @@ TEST(IndexMetadataTest, ReadV6Format) {
 // as public, for use in tests.
 class WrappedSimpleIndexFile : public SimpleIndexFile {
  public:
+  using SimpleIndexFile::CalculateHeaderCRC;
   using SimpleIndexFile::Deserialize;
+  using SimpleIndexFile::FlatIndexHeader;
   using SimpleIndexFile::LegacyIsIndexFileStale;
   using SimpleIndexFile::Serialize;
   using SimpleIndexFile::SerializeFinalData;
+  using SimpleIndexFile::SyncLoadFromDisk;
 
   explicit WrappedSimpleIndexFile(const base::FilePath& index_file_directory)
       : SimpleIndexFile(base::ThreadTaskRunnerHandle::Get(),
@@ -298,6 +301,151 @@ TEST_F(SimpleIndexFileTest, LoadCorruptIndex) {
   EXPECT_TRUE(load_index_result.flush_required);
 }
 
+TEST_F(SimpleIndexFileTest, WriteIncrementally) {
+  base::ScopedTempDir cache_dir;
+  ASSERT_TRUE(cache_dir.CreateUniqueTempDir());
+  WrappedSimpleIndexFile simple_index_file(cache_dir.path());
+  const base::FilePath& index_path = simple_index_file.GetIndexFilePath();
+
+  SimpleIndex::EntrySet entries;
+  for (uint64_t hash = 1; hash <= 1000; ++hash)
+    SimpleIndex::InsertInEntrySet(hash, EntryMetadata(Time(), hash), &entries);
+  net::TestClosure closure;
+  simple_index_file.WriteToDisk(SimpleIndex::INDEX_WRITE_REASON_SHUTDOWN,
+                                entries, 0, base::TimeTicks(), false,
+                                closure.closure());
+  closure.WaitForResult();
+  const uint64_t disk_image_id = entries.disk_image_id();
+  EXPECT_NE(0U, disk_image_id);
+
+  // Later writes of the table only rewrite its dirty pages.
+  entries.Update(entries.find(500), EntryMetadata(Time(), 5000));
+  entries.erase(UINT64_C(1));
+  SimpleIndex::InsertInEntrySet(0, EntryMetadata(Time(), 7), &entries);
+  simple_index_file.WriteToDisk(SimpleIndex::INDEX_WRITE_REASON_IDLE,
+                                entries, 0, base::TimeTicks(), false,
+                                closure.closure());
+  closure.WaitForResult();
+  EXPECT_EQ(disk_image_id, entries.disk_image_id());
+
+  base::Time when_index_last_saw_cache;
+  SimpleIndexLoadResult load_result;
+  WrappedSimpleIndexFile::SyncLoadFromDisk(
+      index_path, &when_index_last_saw_cache, &load_result);
+  ASSERT_TRUE(load_result.did_load);
+  const SimpleIndex::EntrySet& loaded_entries = load_result.entries;
+  EXPECT_EQ(disk_image_id, loaded_entries.disk_image_id());
+  EXPECT_EQ(SimpleIndex::INDEX_WRITE_REASON_IDLE,
+            load_result.index_write_reason);
+  EXPECT_EQ(entries.size(), loaded_entries.size());
+  EXPECT_EQ(entries.total_entry_size(), loaded_entries.total_entry_size());
+  EXPECT_EQ(0U, loaded_entries.count(1));
+  EXPECT_EQ(5000U, loaded_entries.find(500)->second.GetEntrySize());
+  EXPECT_EQ(7U, loaded_entries.find(0)->second.GetEntrySize());
+  for (uint64_t hash = 2; hash <= 1000; ++hash)
+    EXPECT_EQ(1U, loaded_entries.count(hash));
+}
+
+// Tests that a table whose index file went away is written in full again.
+TEST_F(SimpleIndexFileTest, RewritesMissingIndexFile) {
+  base::ScopedTempDir cache_dir;
+  ASSERT_TRUE(cache_dir.CreateUniqueTempDir());
+  WrappedSimpleIndexFile simple_index_file(cache_dir.path());
+  const base::FilePath& index_path = simple_index_file.GetIndexFilePath();
+
+  SimpleIndex::EntrySet entries;
+  SimpleIndex::InsertInEntrySet(11, EntryMetadata(Time(), 11), &entries);
+  net::TestClosure closure;
+  simple_index_file.WriteToDisk(SimpleIndex::INDEX_WRITE_REASON_SHUTDOWN,
+                                entries, 0, base::TimeTicks(), false,
+                                closure.closure());
+  closure.WaitForResult();
+  const uint64_t disk_image_id = entries.disk_image_id();
+
+  ASSERT_TRUE(base::DeleteFile(index_path, false));
+  simple_index_file.WriteToDisk(SimpleIndex::INDEX_WRITE_REASON_SHUTDOWN,
+                                entries, 0, base::TimeTicks(), false,
+                                closure.closure());
+  closure.WaitForResult();
+  EXPECT_FALSE(base::PathExists(index_path));
+
+  simple_index_file.WriteToDisk(SimpleIndex::INDEX_WRITE_REASON_SHUTDOWN,
+                                entries, 0, base::TimeTicks(), false,
+                                closure.closure());
+  closure.WaitForResult();
+  EXPECT_TRUE(base::PathExists(index_path));
+  EXPECT_NE(disk_image_id, entries.disk_image_id());
+}
+
+// Tests that an index file left behind by an interrupted write is not loaded.
+TEST_F(SimpleIndexFileTest, LoadInterruptedWrite) {
+  base::ScopedTempDir cache_dir;
+  ASSERT_TRUE(cache_dir.CreateUniqueTempDir());
+  WrappedSimpleIndexFile simple_index_file(cache_dir.path());
+  const base::FilePath& index_path = simple_index_file.GetIndexFilePath();
+
+  SimpleIndex::EntrySet entries;
+  SimpleIndex::InsertInEntrySet(11, EntryMetadata(Time(), 11), &entries);
+  net::TestClosure closure;
+  simple_index_file.WriteToDisk(SimpleIndex::INDEX_WRITE_REASON_SHUTDOWN,
+                                entries, 0, base::TimeTicks(), false,
+                                closure.closure());
+  closure.WaitForResult();
+
+  base::File file(index_path, base::File::FLAG_OPEN | base::File::FLAG_READ |
+                                  base::File::FLAG_WRITE);
+  ASSERT_TRUE(file.IsValid());
+  WrappedSimpleIndexFile::FlatIndexHeader header;
+  char* header_data = reinterpret_cast<char*>(&header);
+  ASSERT_EQ(static_cast<int>(sizeof(header)),
+            file.Read(0, header_data, sizeof(header)));
+  header.clean = 0;
+  header.crc = WrappedSimpleIndexFile::CalculateHeaderCRC(header);
+  ASSERT_EQ(static_cast<int>(sizeof(header)),
+            file.Write(0, header_data, sizeof(header)));
+  file.Close();
+
+  base::Time when_index_last_saw_cache;
+  SimpleIndexLoadResult load_result;
+  WrappedSimpleIndexFile::SyncLoadFromDisk(
+      index_path, &when_index_last_saw_cache, &load_result);
+  EXPECT_FALSE(load_result.did_load);
+  EXPECT_FALSE(base::PathExists(index_path));
+}
+
+// Tests that index files in the pickle format of older versions still load.
+TEST_F(SimpleIndexFileTest, LoadPickledIndex) {
+  base::ScopedTempDir cache_dir;
+  ASSERT_TRUE(cache_dir.CreateUniqueTempDir());
+  WrappedSimpleIndexFile simple_index_file(cache_dir.path());
+  ASSERT_TRUE(simple_index_file.CreateIndexFileDirectory());
+  const base::FilePath& index_path = simple_index_file.GetIndexFilePath();
+
+  SimpleIndex::EntrySet entries;
+  SimpleIndex::InsertInEntrySet(11, EntryMetadata(Time(), 11), &entries);
+  SimpleIndex::InsertInEntrySet(22, EntryMetadata(Time(), 22), &entries);
+  SimpleIndexFile::IndexMetadata index_metadata(
+      SimpleIndex::INDEX_WRITE_REASON_SHUTDOWN, entries.size(), 33);
+  std::unique_ptr<base::Pickle> pickle =
+      WrappedSimpleIndexFile::Serialize(index_metadata, entries);
+  const base::Time now = base::Time::Now();
+  ASSERT_TRUE(WrappedSimpleIndexFile::SerializeFinalData(now, pickle.get()));
+  ASSERT_EQ(static_cast<int>(pickle->size()),
+            base::WriteFile(index_path, static_cast<const char*>(pickle->data()),
+                            pickle->size()));
+
+  base::Time when_index_last_saw_cache;
+  SimpleIndexLoadResult load_result;
+  WrappedSimpleIndexFile::SyncLoadFromDisk(
+      index_path, &when_index_last_saw_cache, &load_result);
+  ASSERT_TRUE(load_result.did_load);
+  EXPECT_EQ(now, when_index_last_saw_cache);
+  EXPECT_EQ(2U, load_result.entries.size());
+  EXPECT_EQ(33U, load_result.entries.total_entry_size());
+  // The first write of a pickled index is a full one.
+  EXPECT_EQ(0U, load_result.entries.disk_image_id());
+}
+
 // Tests that after an upgrade the backend has the index file put in place.
 TEST_F(SimpleIndexFileTest, SimpleCacheUpgrade) {
   base::ScopedTempDir cache_dir;
@@ -358,15 +506,11 @@ TEST_F(SimpleIndexFileTest, SimpleCacheUpgrade) {
   EXPECT_TRUE(base::PathExists(index_file_path));
 
   // Verify that the version of the index file is correct.
-  std::string contents;
-  EXPECT_TRUE(base::ReadFileToString(index_file_path, &contents));
   base::Time when_index_last_saw_cache;
-  SimpleIndexLoadResult deserialize_result;
-  WrappedSimpleIndexFile::Deserialize(contents.data(),
-                                      contents.size(),
-                                      &when_index_last_saw_cache,
-                                      &deserialize_result);
-  EXPECT_TRUE(deserialize_result.did_load);
+  SimpleIndexLoadResult load_result;
+  WrappedSimpleIndexFile::SyncLoadFromDisk(
+      index_file_path, &when_index_last_saw_cache, &load_result);
+  EXPECT_TRUE(load_result.did_load);
 }
 
 TEST_F(SimpleIndexFileTest, OverwritesStaleTempFile) {
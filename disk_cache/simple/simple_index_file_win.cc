@@ -4,8 +4,11 @@
 
 #include "net/disk_cache/simple/simple_index_file.h"
 
+#include <limits>
+#include <memory>
 #include <string>
 
+#include "base/files/file.h"
 #include "base/files/file_enumerator.h"
 #include "base/files/file_path.h"
 
@@ -30,4 +33,24 @@ bool SimpleIndexFile::TraverseCacheDirectory(
   return true;
 }
 
+// static
+std::unique_ptr<SimpleIndexTable::Storage> SimpleIndexFile::MapIndexTable(
+    base::File* file,
+    int64_t file_length) {
+  // The slots are read in, as the mapping of a file would keep it from being
+  // replaced.
+  const int64_t size = file_length - SimpleIndexTable::kPageSize;
+  if (size > std::numeric_limits<int>::max())
+    return nullptr;
+  std::unique_ptr<SimpleIndexTable::Storage> storage =
+      SimpleIndexTable::CreateHeapStorage(
+          size / sizeof(SimpleIndexTable::Slot));
+  if (file->Read(SimpleIndexTable::kPageSize,
+                 reinterpret_cast<char*>(storage->slots()),
+                 static_cast<int>(size)) != size) {
+    return nullptr;
+  }
+  return storage;
+}
+
 }  // namespace disk_cache
@@ -8,6 +8,7 @@
 #include <functional>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "base/files/scoped_temp_dir.h"
 #include "base/hash.h"
@@ -19,6 +20,7 @@
 #include "base/threading/platform_thread.h"
 #include "base/time/time.h"
 #include "net/base/cache_type.h"
+#include "net/base/net_errors.h"
 #include "net/disk_cache/simple/simple_index_delegate.h"
 #include "net/disk_cache/simple/simple_index_file.h"
 #include "net/disk_cache/simple/simple_test_util.h"
@@ -128,6 +130,7 @@ class SimpleIndexTest  : public testing::Test, public SimpleIndexDelegate {
       index_->Remove(entry_hash);
     last_doom_entry_hashes_ = *entry_hashes;
     ++doom_entries_calls_;
+    callback.Run(net::OK);
   }
 
   // Redirect to allow single "friend" declaration in base class.
@@ -216,6 +219,127 @@ TEST_F(EntryMetadataTest, Serialize) {
   CheckEntryMetadataValues(new_entry_metadata);
 }
 
+TEST(SimpleIndexTableTest, InsertFindErase) {
+  SimpleIndexTable table;
+  // Many more entries than the initial capacity, including the zero hash.
+  const uint64_t kEntryCount = 1000;
+  for (uint64_t i = 0; i < kEntryCount; ++i) {
+    EXPECT_TRUE(
+        table.insert(std::make_pair(i, EntryMetadata(kTestLastUsedTime, i)))
+            .second);
+  }
+  EXPECT_FALSE(
+      table.insert(std::make_pair(UINT64_C(7), EntryMetadata())).second);
+  EXPECT_EQ(kEntryCount, table.size());
+  EXPECT_EQ(kEntryCount * (kEntryCount - 1) / 2, table.total_entry_size());
+
+  // Erasing shifts back the following entries, which stay reachable.
+  for (uint64_t i = 0; i < kEntryCount; i += 2)
+    EXPECT_EQ(1U, table.erase(i));
+  EXPECT_EQ(0U, table.erase(UINT64_C(0)));
+  for (uint64_t i = 0; i < kEntryCount; ++i) {
+    SimpleIndexTable::iterator it = table.find(i);
+    if (i % 2 == 0) {
+      EXPECT_TRUE(it == table.end());
+    } else {
+      ASSERT_TRUE(it != table.end());
+      EXPECT_EQ(i, it->second.GetEntrySize());
+    }
+  }
+
+  size_t entry_count = 0;
+  uint64_t total_entry_size = 0;
+  for (const auto& entry : table) {
+    EXPECT_EQ(1U, entry.first % 2);
+    ++entry_count;
+    total_entry_size += entry.second.GetEntrySize();
+  }
+  EXPECT_EQ(kEntryCount / 2, entry_count);
+  EXPECT_EQ(total_entry_size, table.total_entry_size());
+
+  table.Update(table.find(1), EntryMetadata(kTestLastUsedTime, 1001));
+  EXPECT_EQ(total_entry_size + 1000, table.total_entry_size());
+
+  table.clear();
+  EXPECT_TRUE(table.empty());
+  EXPECT_TRUE(table.begin() == table.end());
+  EXPECT_EQ(0U, table.total_entry_size());
+}
+
+TEST(SimpleIndexTableTest, DirtyPages) {
+  SimpleIndexTable table;
+  table.reserve(SimpleIndexTable::kSlotsPerPage * 4);
+  std::vector<size_t> pages;
+  table.TakeDirtyPages(&pages);
+  EXPECT_TRUE(pages.empty());
+
+  table.insert(std::make_pair(UINT64_C(1), EntryMetadata()));
+  table.TakeDirtyPages(&pages);
+  ASSERT_EQ(1U, pages.size());
+  pages.clear();
+  table.TakeDirtyPages(&pages);
+  EXPECT_TRUE(pages.empty());
+
+  // The slot of the zero hash is on the last page.
+  table.insert(std::make_pair(UINT64_C(0), EntryMetadata()));
+  table.TakeDirtyPages(&pages);
+  EXPECT_EQ(std::vector<size_t>(1, table.GetPageCount() - 1), pages);
+
+  pages.clear();
+  table.Update(table.find(1), EntryMetadata(kTestLastUsedTime, 10));
+  table.TakeDirtyPages(&pages);
+  EXPECT_EQ(1U, pages.size());
+}
+
+TEST(SimpleIndexTableTest, AdoptAndCopy) {
+  SimpleIndexTable table;
+  for (uint64_t i = 1; i <= 20; ++i)
+    table.insert(std::make_pair(i, EntryMetadata(kTestLastUsedTime, i)));
+  table.set_disk_image_id(1);
+
+  std::unique_ptr<SimpleIndexTable::Storage> storage =
+      SimpleIndexTable::CreateHeapStorage(table.GetSlotCount());
+  std::copy(table.slots(), table.slots() + table.GetSlotCount(),
+            storage->slots());
+  SimpleIndexTable adopted;
+  EXPECT_FALSE(adopted.Adopt(std::move(storage), table.capacity() - 1,
+                             false, table.size(), table.total_entry_size()));
+
+  storage = SimpleIndexTable::CreateHeapStorage(table.GetSlotCount());
+  std::copy(table.slots(), table.slots() + table.GetSlotCount(),
+            storage->slots());
+  ASSERT_TRUE(adopted.Adopt(std::move(storage), table.capacity(), false,
+                            table.size(), table.total_entry_size()));
+  EXPECT_EQ(table.size(), adopted.size());
+  for (uint64_t i = 1; i <= 20; ++i)
+    EXPECT_EQ(i, adopted.find(i)->second.GetEntrySize());
+
+  // Copies are not the disk image of their original.
+  SimpleIndexTable copy(table);
+  EXPECT_EQ(0U, copy.disk_image_id());
+  EXPECT_EQ(table.size(), copy.size());
+  EXPECT_EQ(table.total_entry_size(), copy.total_entry_size());
+}
+
+TEST(SimpleFrequencySketchTest, EstimateAndAge) {
+  SimpleFrequencySketch sketch;
+  for (int i = 0; i < 5; ++i)
+    sketch.Increment(1);
+  EXPECT_EQ(5, sketch.Estimate(1));
+  EXPECT_EQ(0, sketch.Estimate(2));
+
+  // Counters saturate, and are halved once the sketch has seen ten increments
+  // per counter.
+  for (int i = 0; i < 1024 * 10 - 5; ++i)
+    sketch.Increment(2);
+  EXPECT_EQ(2, sketch.Estimate(1));
+  EXPECT_EQ(7, sketch.Estimate(2));
+
+  // Growing the sketch forgets the counts.
+  sketch.EnsureCapacity(4096);
+  EXPECT_EQ(0, sketch.Estimate(2));
+}
+
 TEST_F(SimpleIndexTest, IndexSizeCorrectOnMerge) {
   index()->SetMaxSize(100);
   index()->Insert(hashes_.at<2>());
@@ -567,6 +691,62 @@ TEST_F(SimpleIndexTest, BasicEviction) {
   ASSERT_EQ(2u, last_doom_entry_hashes().size());
 }
 
+// Entries are evicted in last used order across the eviction buckets, also
+// when they were used again after the buckets were built.
+TEST_F(SimpleIndexTest, EvictionAcrossBuckets) {
+  base::Time now(base::Time::Now());
+  index()->SetMaxSize(1000);
+  InsertIntoIndexFileReturn(hashes_.at<1>(),
+                            now - base::TimeDelta::FromDays(3), 300u);
+  InsertIntoIndexFileReturn(hashes_.at<2>(),
+                            now - base::TimeDelta::FromDays(1), 300u);
+  InsertIntoIndexFileReturn(hashes_.at<3>(),
+                            now - base::TimeDelta::FromDays(2), 300u);
+  ReturnIndexFile();
+
+  index()->Insert(hashes_.at<4>());
+  index()->UpdateEntrySize(hashes_.at<4>(), 100u);
+  EXPECT_EQ(1, doom_entries_calls());
+  ASSERT_EQ(1u, last_doom_entry_hashes().size());
+  EXPECT_EQ(hashes_.at<1>(), last_doom_entry_hashes()[0]);
+
+  // Using the entry moves it to the newest bucket.
+  EXPECT_TRUE(index()->UseIfExists(hashes_.at<3>()));
+  index()->Insert(hashes_.at<5>());
+  index()->UpdateEntrySize(hashes_.at<5>(), 300u);
+  EXPECT_EQ(2, doom_entries_calls());
+  ASSERT_EQ(1u, last_doom_entry_hashes().size());
+  EXPECT_EQ(hashes_.at<2>(), last_doom_entry_hashes()[0]);
+  EXPECT_TRUE(index()->Has(hashes_.at<3>()));
+  EXPECT_TRUE(index()->Has(hashes_.at<4>()));
+  EXPECT_TRUE(index()->Has(hashes_.at<5>()));
+}
+
+// With TinyLFU, a new entry used less often than the least recently used
+// entry is evicted in its place.
+TEST_F(SimpleIndexTest, TinyLFUAdmission) {
+  index()->SetMaxSize(1000);
+  index()->SetAdmissionPolicy(SimpleIndex::ADMISSION_POLICY_TINY_LFU);
+  ReturnIndexFile();
+
+  index()->Insert(hashes_.at<1>());
+  index()->UpdateEntrySize(hashes_.at<1>(), 475u);
+  EXPECT_TRUE(index()->UseIfExists(hashes_.at<1>()));
+  EXPECT_TRUE(index()->UseIfExists(hashes_.at<1>()));
+  WaitForTimeChange();
+  index()->Insert(hashes_.at<2>());
+  index()->UpdateEntrySize(hashes_.at<2>(), 475u);
+  WaitForTimeChange();
+  index()->Insert(hashes_.at<3>());
+  index()->UpdateEntrySize(hashes_.at<3>(), 475u);
+
+  EXPECT_EQ(1, doom_entries_calls());
+  ASSERT_EQ(2u, last_doom_entry_hashes().size());
+  EXPECT_TRUE(index()->Has(hashes_.at<1>()));
+  EXPECT_FALSE(index()->Has(hashes_.at<2>()));
+  EXPECT_FALSE(index()->Has(hashes_.at<3>()));
+}
+
 // Confirm all the operations queue a disk write at some point in the
 // future.
 TEST_F(SimpleIndexTest, DiskWriteQueued) {
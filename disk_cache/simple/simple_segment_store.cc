@@ -0,0 +1,621 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/simple/simple_segment_store.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+#include "base/bind.h"
+#include "base/files/file_enumerator.h"
+#include "base/files/file_util.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/task_runner.h"
+#include "net/disk_cache/simple/simple_histogram_macros.h"
+#include "third_party/zlib/zlib.h"
+
+namespace disk_cache {
+
+namespace {
+
+const uint64_t kJournalMagicNumber = UINT64_C(0x8b1fe5d9a3c2d10f);
+const uint32_t kJournalVersion = 1;
+const uint32_t kJournalRecordMagicNumber = 0x5e65a7c1;
+
+// Marks a removal in the journal.
+const uint32_t kRemovedSegment = std::numeric_limits<uint32_t>::max();
+
+const char kJournalFileName[] = "journal";
+const char kTempJournalFileName[] = "journal-new";
+const char kSegmentFilePrefix[] = "segment_";
+
+// The journal is rewritten once it holds more than twice as many records as
+// there are packed entries, plus this slack.
+const size_t kJournalCompactionSlack = 1024;
+
+struct JournalHeader {
+  uint64_t magic_number;
+  uint32_t version;
+  uint32_t unused_must_be_zero;
+};
+
+struct JournalRecord {
+  uint32_t magic_number;
+  uint32_t segment;
+  uint64_t entry_hash;
+  int64_t last_modified;
+  uint32_t offset;
+  uint32_t file_size[kSimpleEntryFileCount];
+  uint32_t data_crc32;
+};
+
+}  // namespace
+
+const char SimpleSegmentStore::kSegmentDirectoryName[] = "segments";
+
+const int64_t SimpleSegmentStore::kSegmentSize = 4 * 1024 * 1024;
+
+SimpleSegmentStore::PackedEntry::PackedEntry() {}
+
+SimpleSegmentStore::PackedEntry::~PackedEntry() {}
+
+int64_t SimpleSegmentStore::PackedEntry::GetSize() const {
+  int64_t size = 0;
+  for (const std::string& file : files)
+    size += file.size();
+  return size;
+}
+
+uint32_t SimpleSegmentStore::Locator::GetSize() const {
+  uint32_t size = 0;
+  for (uint32_t file_size_i : file_size)
+    size += file_size_i;
+  return size;
+}
+
+SimpleSegmentStore::Segment::Segment()
+    : size(0), live_bytes(0), pending_writes(0) {}
+
+SimpleSegmentStore::Segment::~Segment() {}
+
+SimpleSegmentStore::SimpleSegmentStore(
+    net::CacheType cache_type,
+    const base::FilePath& cache_path,
+    int max_packed_entry_size,
+    const scoped_refptr<base::TaskRunner>& compaction_runner)
+    : cache_type_(cache_type),
+      path_(cache_path.AppendASCII(kSegmentDirectoryName)),
+      max_packed_entry_size_(max_packed_entry_size),
+      compaction_runner_(compaction_runner),
+      loaded_(false),
+      load_failed_(false),
+      active_segment_(0),
+      journal_size_(0),
+      journal_record_count_(0),
+      compaction_pending_(false) {}
+
+SimpleSegmentStore::~SimpleSegmentStore() {}
+
+// static
+void SimpleSegmentStore::GetEntries(const base::FilePath& cache_path,
+                                    std::vector<EntryInfo>* out_entries) {
+  base::File journal(cache_path.AppendASCII(kSegmentDirectoryName)
+                         .AppendASCII(kJournalFileName),
+                     base::File::FLAG_OPEN | base::File::FLAG_READ |
+                         base::File::FLAG_SHARE_DELETE);
+  if (!journal.IsValid())
+    return;
+  LocatorMap locators;
+  if (ReadJournal(&journal, &locators) < 0)
+    return;
+  for (const auto& it : locators) {
+    EntryInfo info;
+    info.entry_hash = it.first;
+    info.last_modified = base::Time::FromInternalValue(it.second.last_modified);
+    info.size = it.second.GetSize();
+    out_entries->push_back(info);
+  }
+}
+
+bool SimpleSegmentStore::Contains(uint64_t entry_hash) {
+  base::AutoLock lock(lock_);
+  if (!EnsureLoadedLocked())
+    return false;
+  return locators_.count(entry_hash) != 0;
+}
+
+bool SimpleSegmentStore::Load(uint64_t entry_hash, PackedEntry* out_entry) {
+  Locator locator;
+  scoped_refptr<Segment> segment;
+  {
+    base::AutoLock lock(lock_);
+    if (!EnsureLoadedLocked())
+      return false;
+    LocatorMap::const_iterator it = locators_.find(entry_hash);
+    if (it == locators_.end())
+      return false;
+    locator = it->second;
+    segment = segments_[locator.segment];
+  }
+  // The image stays readable even if the entry is replaced or its segment is
+  // compacted meanwhile; the load then returns the image it started with.
+  const uint32_t size = locator.GetSize();
+  std::unique_ptr<char[]> data(new char[size]);
+  if (segment->file.Read(locator.offset, data.get(), size) !=
+      static_cast<int>(size)) {
+    return false;
+  }
+  if (crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(data.get()),
+            size) != locator.data_crc32) {
+    DLOG(WARNING) << "Packed entry had bad crc.";
+    return false;
+  }
+  out_entry->last_modified =
+      base::Time::FromInternalValue(locator.last_modified);
+  uint32_t offset = 0;
+  for (int i = 0; i < kSimpleEntryFileCount; ++i) {
+    out_entry->files[i].assign(data.get() + offset, locator.file_size[i]);
+    offset += locator.file_size[i];
+  }
+  return true;
+}
+
+bool SimpleSegmentStore::Store(uint64_t entry_hash, const PackedEntry& entry) {
+  {
+    base::AutoLock lock(lock_);
+    if (!EnsureLoadedLocked() || !journal_.IsValid())
+      return false;
+  }
+  std::string data;
+  data.reserve(entry.GetSize());
+  uint32_t file_size[kSimpleEntryFileCount];
+  for (int i = 0; i < kSimpleEntryFileCount; ++i) {
+    data.append(entry.files[i]);
+    file_size[i] = entry.files[i].size();
+  }
+  if (Append(entry_hash, data.data(), data.size(), file_size,
+             entry.last_modified.ToInternalValue(), nullptr)) {
+    return true;
+  }
+  // Do not let a failed store leave the previous image behind.
+  base::AutoLock lock(lock_);
+  LocatorMap::iterator it = locators_.find(entry_hash);
+  if (it != locators_.end()) {
+    Locator removed = it->second;
+    removed.segment = kRemovedSegment;
+    ReleaseLocked(it->second);
+    locators_.erase(it);
+    AppendJournalRecordLocked(entry_hash, removed);
+  }
+  return false;
+}
+
+bool SimpleSegmentStore::Remove(uint64_t entry_hash) {
+  base::AutoLock lock(lock_);
+  if (!EnsureLoadedLocked())
+    return true;
+  LocatorMap::iterator it = locators_.find(entry_hash);
+  if (it == locators_.end())
+    return true;
+  Locator removed = it->second;
+  removed.segment = kRemovedSegment;
+  ReleaseLocked(it->second);
+  locators_.erase(it);
+  const bool result = AppendJournalRecordLocked(entry_hash, removed);
+  MaybeScheduleCompactionLocked();
+  return result;
+}
+
+void SimpleSegmentStore::Compact() {
+  {
+    base::AutoLock lock(lock_);
+    // Keeps the appends of the compaction from scheduling another one.
+    compaction_pending_ = true;
+  }
+  while (CompactOnce()) {}
+  base::AutoLock lock(lock_);
+  compaction_pending_ = false;
+}
+
+size_t SimpleSegmentStore::GetEntryCountForTesting() {
+  base::AutoLock lock(lock_);
+  EnsureLoadedLocked();
+  return locators_.size();
+}
+
+size_t SimpleSegmentStore::GetSegmentCountForTesting() {
+  base::AutoLock lock(lock_);
+  EnsureLoadedLocked();
+  return segments_.size();
+}
+
+// static
+int64_t SimpleSegmentStore::ReadJournal(base::File* journal,
+                                        LocatorMap* locators) {
+  const int64_t length = journal->GetLength();
+  if (length < static_cast<int64_t>(sizeof(JournalHeader)) ||
+      length > std::numeric_limits<int>::max()) {
+    return -1;
+  }
+  std::unique_ptr<char[]> data(new char[length]);
+  if (journal->Read(0, data.get(), static_cast<int>(length)) != length)
+    return -1;
+
+  JournalHeader header;
+  memcpy(&header, data.get(), sizeof(header));
+  if (header.magic_number != kJournalMagicNumber ||
+      header.version != kJournalVersion) {
+    return -1;
+  }
+
+  int64_t offset = sizeof(header);
+  for (; offset + static_cast<int64_t>(sizeof(JournalRecord)) <= length;
+       offset += sizeof(JournalRecord)) {
+    JournalRecord record;
+    memcpy(&record, data.get() + offset, sizeof(record));
+    // A torn record ends the journal.
+    if (record.magic_number != kJournalRecordMagicNumber)
+      break;
+    if (record.segment == kRemovedSegment) {
+      locators->erase(record.entry_hash);
+      continue;
+    }
+    Locator& locator = (*locators)[record.entry_hash];
+    locator.segment = record.segment;
+    locator.offset = record.offset;
+    memcpy(locator.file_size, record.file_size, sizeof(locator.file_size));
+    locator.data_crc32 = record.data_crc32;
+    locator.last_modified = record.last_modified;
+  }
+  return offset;
+}
+
+base::FilePath SimpleSegmentStore::GetSegmentPath(uint32_t segment) const {
+  return path_.AppendASCII(kSegmentFilePrefix + base::UintToString(segment));
+}
+
+base::FilePath SimpleSegmentStore::GetJournalPath() const {
+  return path_.AppendASCII(kJournalFileName);
+}
+
+bool SimpleSegmentStore::EnsureLoadedLocked() {
+  lock_.AssertAcquired();
+  if (loaded_)
+    return !load_failed_;
+  loaded_ = true;
+
+  // Without packing, a cache that never had a store does not get one, which
+  // would touch the cache directory and force an index restore.
+  if (max_packed_entry_size_ == 0 && !base::PathExists(GetJournalPath()))
+    return true;
+
+  if (!base::CreateDirectory(path_)) {
+    load_failed_ = true;
+    return false;
+  }
+  journal_.Initialize(GetJournalPath(), base::File::FLAG_OPEN |
+                                            base::File::FLAG_READ |
+                                            base::File::FLAG_WRITE |
+                                            base::File::FLAG_SHARE_DELETE);
+  if (!journal_.IsValid()) {
+    load_failed_ = !ResetLocked();
+    return !load_failed_;
+  }
+  journal_size_ = ReadJournal(&journal_, &locators_);
+  if (journal_size_ < 0 || !journal_.SetLength(journal_size_)) {
+    load_failed_ = !ResetLocked();
+    return !load_failed_;
+  }
+  journal_record_count_ =
+      (journal_size_ - sizeof(JournalHeader)) / sizeof(JournalRecord);
+
+  base::FileEnumerator enumerator(
+      path_, false /* recursive */, base::FileEnumerator::FILES,
+      FILE_PATH_LITERAL("segment_*"));
+  for (base::FilePath path = enumerator.Next(); !path.empty();
+       path = enumerator.Next()) {
+    const std::string name = path.BaseName().MaybeAsASCII();
+    unsigned segment_index;
+    if (!base::StringToUint(name.substr(strlen(kSegmentFilePrefix)),
+                            &segment_index)) {
+      continue;
+    }
+    scoped_refptr<Segment> segment(new Segment());
+    segment->file.Initialize(path, base::File::FLAG_OPEN |
+                                       base::File::FLAG_READ |
+                                       base::File::FLAG_WRITE |
+                                       base::File::FLAG_SHARE_DELETE);
+    if (!segment->file.IsValid())
+      continue;
+    segment->size = segment->file.GetLength();
+    active_segment_ = std::max<uint32_t>(active_segment_, segment_index);
+    segments_[segment_index] = std::move(segment);
+  }
+
+  // Drop the entries whose images did not make it to their segment.
+  for (LocatorMap::iterator it = locators_.begin(); it != locators_.end();) {
+    auto segment = segments_.find(it->second.segment);
+    if (segment == segments_.end() ||
+        it->second.offset + it->second.GetSize() > segment->second->size) {
+      it = locators_.erase(it);
+      continue;
+    }
+    segment->second->live_bytes += it->second.GetSize();
+    ++it;
+  }
+
+  SIMPLE_CACHE_UMA(COUNTS, "PackedEntryCount", cache_type_, locators_.size());
+  SIMPLE_CACHE_UMA(COUNTS_100, "SegmentCount", cache_type_, segments_.size());
+  MaybeScheduleCompactionLocked();
+  return true;
+}
+
+bool SimpleSegmentStore::ResetLocked() {
+  lock_.AssertAcquired();
+  locators_.clear();
+  segments_.clear();
+  journal_.Close();
+  active_segment_ = 0;
+  if (!base::DeleteFile(path_, true /* recursive */) ||
+      !base::CreateDirectory(path_)) {
+    return false;
+  }
+  journal_.Initialize(GetJournalPath(), base::File::FLAG_CREATE_ALWAYS |
+                                            base::File::FLAG_READ |
+                                            base::File::FLAG_WRITE |
+                                            base::File::FLAG_SHARE_DELETE);
+  if (!journal_.IsValid())
+    return false;
+  JournalHeader header;
+  header.magic_number = kJournalMagicNumber;
+  header.version = kJournalVersion;
+  header.unused_must_be_zero = 0;
+  if (journal_.Write(0, reinterpret_cast<const char*>(&header),
+                     sizeof(header)) != sizeof(header)) {
+    return false;
+  }
+  journal_size_ = sizeof(header);
+  journal_record_count_ = 0;
+  return true;
+}
+
+bool SimpleSegmentStore::Append(
+    uint64_t entry_hash,
+    const char* data,
+    uint32_t size,
+    const uint32_t file_size[kSimpleEntryFileCount],
+    int64_t last_modified,
+    const Locator* replaced) {
+  Locator locator;
+  memcpy(locator.file_size, file_size, sizeof(locator.file_size));
+  locator.data_crc32 =
+      crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(data), size);
+  locator.last_modified = last_modified;
+  scoped_refptr<Segment> segment;
+  {
+    base::AutoLock lock(lock_);
+    segment = GetActiveSegmentLocked();
+    if (!segment)
+      return false;
+    locator.segment = active_segment_;
+    locator.offset = segment->size;
+    // The range is reserved for the image, which is garbage until the journal
+    // points at it.
+    segment->size += size;
+    ++segment->pending_writes;
+  }
+  const bool written =
+      segment->file.Write(locator.offset, data, size) == static_cast<int>(size);
+
+  base::AutoLock lock(lock_);
+  --segment->pending_writes;
+  if (!written)
+    return false;
+  LocatorMap::iterator it = locators_.find(entry_hash);
+  if (replaced &&
+      (it == locators_.end() || it->second.segment != replaced->segment ||
+       it->second.offset != replaced->offset)) {
+    // The entry was replaced or removed while its image was being copied.
+    return true;
+  }
+  if (!AppendJournalRecordLocked(entry_hash, locator))
+    return false;
+
+  segment->live_bytes += size;
+  if (it != locators_.end()) {
+    ReleaseLocked(it->second);
+    it->second = locator;
+  } else {
+    locators_.insert(std::make_pair(entry_hash, locator));
+  }
+  MaybeScheduleCompactionLocked();
+  return true;
+}
+
+bool SimpleSegmentStore::AppendJournalRecordLocked(uint64_t entry_hash,
+                                                   const Locator& locator) {
+  lock_.AssertAcquired();
+  JournalRecord record;
+  record.magic_number = kJournalRecordMagicNumber;
+  record.segment = locator.segment;
+  record.entry_hash = entry_hash;
+  record.last_modified = locator.last_modified;
+  record.offset = locator.offset;
+  memcpy(record.file_size, locator.file_size, sizeof(record.file_size));
+  record.data_crc32 = locator.data_crc32;
+  if (journal_.Write(journal_size_, reinterpret_cast<const char*>(&record),
+                     sizeof(record)) != sizeof(record)) {
+    // Leave no torn record behind for later appends to follow.
+    journal_.SetLength(journal_size_);
+    return false;
+  }
+  journal_size_ += sizeof(record);
+  ++journal_record_count_;
+  return true;
+}
+
+SimpleSegmentStore::Segment* SimpleSegmentStore::GetActiveSegmentLocked() {
+  lock_.AssertAcquired();
+  auto it = segments_.find(active_segment_);
+  if (it != segments_.end() && it->second->size < kSegmentSize)
+    return it->second.get();
+  if (it != segments_.end())
+    ++active_segment_;
+
+  scoped_refptr<Segment> segment(new Segment());
+  segment->file.Initialize(GetSegmentPath(active_segment_),
+                           base::File::FLAG_CREATE_ALWAYS |
+                               base::File::FLAG_READ |
+                               base::File::FLAG_WRITE |
+                               base::File::FLAG_SHARE_DELETE);
+  if (!segment->file.IsValid())
+    return nullptr;
+  Segment* active = segment.get();
+  segments_[active_segment_] = std::move(segment);
+  return active;
+}
+
+void SimpleSegmentStore::ReleaseLocked(const Locator& locator) {
+  lock_.AssertAcquired();
+  auto it = segments_.find(locator.segment);
+  DCHECK(it != segments_.end());
+  it->second->live_bytes -= locator.GetSize();
+  DCHECK_GE(it->second->live_bytes, 0);
+}
+
+bool SimpleSegmentStore::SegmentNeedsCompactionLocked(
+    uint32_t segment_index) const {
+  lock_.AssertAcquired();
+  if (segment_index == active_segment_)
+    return false;
+  const Segment& segment = *segments_.find(segment_index)->second;
+  return !segment.pending_writes && segment.live_bytes * 2 <= segment.size;
+}
+
+bool SimpleSegmentStore::JournalNeedsCompactionLocked() const {
+  lock_.AssertAcquired();
+  return journal_record_count_ >
+         2 * locators_.size() + kJournalCompactionSlack;
+}
+
+bool SimpleSegmentStore::CompactOnce() {
+  uint32_t segment_index = 0;
+  {
+    base::AutoLock lock(lock_);
+    if (!loaded_ || load_failed_)
+      return false;
+    auto it = segments_.begin();
+    while (it != segments_.end() && !SegmentNeedsCompactionLocked(it->first))
+      ++it;
+    if (it == segments_.end())
+      return JournalNeedsCompactionLocked() && RewriteJournalLocked();
+    segment_index = it->first;
+  }
+  return CompactSegment(segment_index);
+}
+
+bool SimpleSegmentStore::CompactSegment(uint32_t segment_index) {
+  scoped_refptr<Segment> segment;
+  std::vector<std::pair<uint64_t, Locator>> live_entries;
+  {
+    base::AutoLock lock(lock_);
+    DCHECK_NE(active_segment_, segment_index);
+    auto segment_it = segments_.find(segment_index);
+    // Another Compact() may have got there first.
+    if (segment_it == segments_.end())
+      return true;
+    segment = segment_it->second;
+    for (const auto& it : locators_) {
+      if (it.second.segment == segment_index)
+        live_entries.push_back(it);
+    }
+  }
+
+  // New images never go to a sealed segment, so the entries can only leave it
+  // while it is copied.
+  for (const auto& it : live_entries) {
+    const Locator& locator = it.second;
+    const uint32_t size = locator.GetSize();
+    std::unique_ptr<char[]> data(new char[size]);
+    if (segment->file.Read(locator.offset, data.get(), size) !=
+        static_cast<int>(size)) {
+      return false;
+    }
+    // The image was checked against its CRC when stored, and is copied as is.
+    if (!Append(it.first, data.get(), size, locator.file_size,
+                locator.last_modified, &locator)) {
+      return false;
+    }
+  }
+
+  base::AutoLock lock(lock_);
+  DCHECK_EQ(0, segment->live_bytes);
+  SIMPLE_CACHE_UMA(COUNTS_10000, "SegmentCompactionEntries", cache_type_,
+                   live_entries.size());
+  segments_.erase(segment_index);
+  base::DeleteFile(GetSegmentPath(segment_index), false /* recursive */);
+  return true;
+}
+
+bool SimpleSegmentStore::RewriteJournalLocked() {
+  lock_.AssertAcquired();
+  const base::FilePath temp_path = path_.AppendASCII(kTempJournalFileName);
+  base::File journal(temp_path, base::File::FLAG_CREATE_ALWAYS |
+                                    base::File::FLAG_READ |
+                                    base::File::FLAG_WRITE |
+                                    base::File::FLAG_SHARE_DELETE);
+  if (!journal.IsValid())
+    return false;
+
+  std::string data;
+  data.reserve(sizeof(JournalHeader) +
+               locators_.size() * sizeof(JournalRecord));
+  JournalHeader header;
+  header.magic_number = kJournalMagicNumber;
+  header.version = kJournalVersion;
+  header.unused_must_be_zero = 0;
+  data.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  for (const auto& it : locators_) {
+    JournalRecord record;
+    record.magic_number = kJournalRecordMagicNumber;
+    record.segment = it.second.segment;
+    record.entry_hash = it.first;
+    record.last_modified = it.second.last_modified;
+    record.offset = it.second.offset;
+    memcpy(record.file_size, it.second.file_size, sizeof(record.file_size));
+    record.data_crc32 = it.second.data_crc32;
+    data.append(reinterpret_cast<const char*>(&record), sizeof(record));
+  }
+  if (journal.Write(0, data.data(), data.size()) !=
+          static_cast<int>(data.size()) ||
+      !base::ReplaceFile(temp_path, GetJournalPath(), nullptr)) {
+    base::DeleteFile(temp_path, false /* recursive */);
+    return false;
+  }
+  journal_ = std::move(journal);
+  journal_size_ = data.size();
+  journal_record_count_ = locators_.size();
+  return true;
+}
+
+void SimpleSegmentStore::MaybeScheduleCompactionLocked() {
+  lock_.AssertAcquired();
+  if (compaction_pending_ || !compaction_runner_)
+    return;
+  bool compaction_due = JournalNeedsCompactionLocked();
+  for (const auto& it : segments_)
+    compaction_due |= SegmentNeedsCompactionLocked(it.first);
+  if (!compaction_due)
+    return;
+  compaction_pending_ = true;
+  compaction_runner_->PostTask(
+      FROM_HERE, base::Bind(&SimpleSegmentStore::Compact, this));
+}
+
+}  // namespace disk_cache
@@ -0,0 +1,207 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_DISK_CACHE_SIMPLE_SIMPLE_SEGMENT_STORE_H_
+#define NET_DISK_CACHE_SIMPLE_SIMPLE_SEGMENT_STORE_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/files/file.h"
+#include "base/files/file_path.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/lock.h"
+#include "base/time/time.h"
+#include "net/base/cache_type.h"
+#include "net/base/net_export.h"
+#include "net/disk_cache/simple/simple_entry_format.h"
+
+namespace base {
+class TaskRunner;
+}
+
+namespace disk_cache {
+
+// Stores the files of small entries of the simple cache inside shared segment
+// files, so that such entries cost no inode of their own. The store lives in
+// the |kSegmentDirectoryName| subdirectory of the cache, and consists of:
+//   - segment files, to which the images of the entry files are appended.
+//   - a journal, to which a fixed size record is appended for each store and
+//     removal of an entry. Replaying the journal on load yields the location
+//     of every packed entry, without reading the segments.
+//
+// A stored entry replaces any previous image of the same entry. Sealed
+// segments whose live data drops below half their size are compacted in the
+// background, by copying their live entries to the active segment.
+//
+// The store is used from the worker pool, and is thread safe. Images are never
+// modified once written, so they are read and written without holding the
+// lock, which only guards the locators, the journal and the segment sizes.
+class NET_EXPORT_PRIVATE SimpleSegmentStore
+    : public base::RefCountedThreadSafe<SimpleSegmentStore> {
+ public:
+  // The images of the files of an entry. An empty image is an omitted file.
+  struct NET_EXPORT_PRIVATE PackedEntry {
+    PackedEntry();
+    ~PackedEntry();
+
+    int64_t GetSize() const;
+
+    base::Time last_modified;
+    std::string files[kSimpleEntryFileCount];
+  };
+
+  struct EntryInfo {
+    uint64_t entry_hash;
+    base::Time last_modified;
+    int64_t size;
+  };
+
+  static const char kSegmentDirectoryName[];
+
+  // Segments are sealed once they reach this size.
+  static const int64_t kSegmentSize;
+
+  // Entries whose files add up to at most |max_packed_entry_size| bytes are
+  // packed; zero disables packing of new entries, while the entries already
+  // packed remain readable. Compactions are posted to |compaction_runner|.
+  SimpleSegmentStore(net::CacheType cache_type,
+                     const base::FilePath& cache_path,
+                     int max_packed_entry_size,
+                     const scoped_refptr<base::TaskRunner>& compaction_runner);
+
+  // Appends the packed entries of the store at |cache_path| to |out_entries|,
+  // without loading the store. Used to restore the index.
+  static void GetEntries(const base::FilePath& cache_path,
+                         std::vector<EntryInfo>* out_entries);
+
+  int max_packed_entry_size() const { return max_packed_entry_size_; }
+
+  bool Contains(uint64_t entry_hash);
+
+  // Reads the packed images of |entry_hash|. Returns false if the entry is not
+  // packed, or could not be read.
+  bool Load(uint64_t entry_hash, PackedEntry* out_entry);
+
+  // Packs |entry| under |entry_hash|, replacing any previous image. On failure
+  // any previous image is removed as well.
+  bool Store(uint64_t entry_hash, const PackedEntry& entry);
+
+  // Removes the image of |entry_hash|, if any. Returns false on I/O error.
+  bool Remove(uint64_t entry_hash);
+
+  // Runs the pending compactions. Called on the compaction task runner, and
+  // directly by tests.
+  void Compact();
+
+  size_t GetEntryCountForTesting();
+  size_t GetSegmentCountForTesting();
+
+ private:
+  friend class base::RefCountedThreadSafe<SimpleSegmentStore>;
+
+  // Where an image is packed.
+  struct Locator {
+    uint32_t segment;
+    uint32_t offset;
+    uint32_t file_size[kSimpleEntryFileCount];
+    uint32_t data_crc32;
+    int64_t last_modified;
+
+    uint32_t GetSize() const;
+  };
+
+  // A segment is shared with the reads and writes running outside |lock_|,
+  // so that it outlives their removal from |segments_|.
+  struct Segment : public base::RefCountedThreadSafe<Segment> {
+    Segment();
+
+    base::File file;
+    int64_t size;
+    int64_t live_bytes;
+    // Images being written outside |lock_|. The segment is not compacted
+    // until they are committed.
+    int pending_writes;
+
+   private:
+    friend class base::RefCountedThreadSafe<Segment>;
+    ~Segment();
+  };
+
+  using LocatorMap = std::unordered_map<uint64_t, Locator>;
+
+  ~SimpleSegmentStore();
+
+  // Replays the journal in |journal| into |locators|. Returns the offset just
+  // past the last complete record, or -1 if the journal header is invalid.
+  static int64_t ReadJournal(base::File* journal, LocatorMap* locators);
+
+  base::FilePath GetSegmentPath(uint32_t segment) const;
+  base::FilePath GetJournalPath() const;
+
+  // Loads the journal and opens the segments, on first use. Returns false if
+  // the store cannot be used.
+  bool EnsureLoadedLocked();
+
+  // Deletes every file of the store and starts an empty journal.
+  bool ResetLocked();
+
+  // Appends the payload |data| of |size| bytes for |entry_hash| to the active
+  // segment and the journal, updating |locators_|. The payload is written
+  // without holding |lock_|. If |replaced| is not null, the new image only
+  // takes the place of an entry still at |replaced|; otherwise it is dropped.
+  // Returns false on I/O error.
+  bool Append(uint64_t entry_hash,
+              const char* data,
+              uint32_t size,
+              const uint32_t file_size[kSimpleEntryFileCount],
+              int64_t last_modified,
+              const Locator* replaced);
+  bool AppendJournalRecordLocked(uint64_t entry_hash, const Locator& locator);
+  Segment* GetActiveSegmentLocked();
+
+  // Releases the image at |locator|, which is being replaced or removed.
+  void ReleaseLocked(const Locator& locator);
+
+  // A sealed segment is compacted once at most half of it is live, and the
+  // journal once most of its records are stale.
+  bool SegmentNeedsCompactionLocked(uint32_t segment_index) const;
+  bool JournalNeedsCompactionLocked() const;
+
+  // Compacts one sealed segment, or the journal, if either is due. Returns
+  // false once there is nothing left to compact. A segment is copied without
+  // holding |lock_|, which is taken to move each of its entries.
+  bool CompactOnce();
+  bool CompactSegment(uint32_t segment_index);
+  bool RewriteJournalLocked();
+  void MaybeScheduleCompactionLocked();
+
+  const net::CacheType cache_type_;
+  const base::FilePath path_;
+  const int max_packed_entry_size_;
+  const scoped_refptr<base::TaskRunner> compaction_runner_;
+
+  mutable base::Lock lock_;
+
+  bool loaded_;
+  bool load_failed_;
+  LocatorMap locators_;
+  std::map<uint32_t, scoped_refptr<Segment>> segments_;
+  uint32_t active_segment_;
+  base::File journal_;
+  int64_t journal_size_;
+  size_t journal_record_count_;
+  bool compaction_pending_;
+
+  DISALLOW_COPY_AND_ASSIGN(SimpleSegmentStore);
+};
+
+}  // namespace disk_cache
+
+#endif  // NET_DISK_CACHE_SIMPLE_SIMPLE_SEGMENT_STORE_H_
@@ -0,0 +1,206 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/disk_cache/simple/simple_segment_store.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/memory/ref_counted.h"
+#include "base/location.h"
+#include "base/task_runner.h"
+#include "base/threading/thread.h"
+#include "base/time/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace disk_cache {
+
+namespace {
+
+const int kMaxPackedEntrySize = 16 * 1024;
+
+SimpleSegmentStore::PackedEntry MakeEntry(char fill, size_t size) {
+  SimpleSegmentStore::PackedEntry entry;
+  entry.last_modified = base::Time::FromInternalValue(1000 + fill);
+  entry.files[0] = std::string(size, fill);
+  entry.files[1] = std::string(size / 2, fill + 1);
+  return entry;
+}
+
+// Replaces the entries in [first, last) and removes every other one of them.
+void ReplaceEntries(SimpleSegmentStore* store,
+                    int first,
+                    int last,
+                    size_t size) {
+  for (int i = first; i < last; ++i) {
+    EXPECT_TRUE(store->Store(i, MakeEntry('A' + i % 26, size)));
+    if (i % 2)
+      EXPECT_TRUE(store->Remove(i));
+  }
+}
+
+class SimpleSegmentStoreTest : public testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    ResetStore();
+  }
+
+  // Compactions are run explicitly, through Compact().
+  void ResetStore() {
+    store_ = new SimpleSegmentStore(net::DISK_CACHE, temp_dir_.path(),
+                                    kMaxPackedEntrySize, nullptr);
+  }
+
+  void ExpectEntry(uint64_t entry_hash,
+                   const SimpleSegmentStore::PackedEntry& expected) {
+    SimpleSegmentStore::PackedEntry entry;
+    ASSERT_TRUE(store_->Load(entry_hash, &entry));
+    EXPECT_EQ(expected.last_modified, entry.last_modified);
+    for (int i = 0; i < kSimpleEntryFileCount; ++i)
+      EXPECT_EQ(expected.files[i], entry.files[i]);
+  }
+
+  base::ScopedTempDir temp_dir_;
+  scoped_refptr<SimpleSegmentStore> store_;
+};
+
+TEST_F(SimpleSegmentStoreTest, StoreLoadRemove) {
+  const SimpleSegmentStore::PackedEntry entry = MakeEntry('a', 1000);
+  EXPECT_FALSE(store_->Contains(1));
+  ASSERT_TRUE(store_->Store(1, entry));
+  EXPECT_TRUE(store_->Contains(1));
+  ExpectEntry(1, entry);
+
+  const SimpleSegmentStore::PackedEntry replacement = MakeEntry('x', 300);
+  ASSERT_TRUE(store_->Store(1, replacement));
+  ExpectEntry(1, replacement);
+  EXPECT_EQ(1u, store_->GetEntryCountForTesting());
+
+  EXPECT_TRUE(store_->Remove(1));
+  EXPECT_FALSE(store_->Contains(1));
+  SimpleSegmentStore::PackedEntry removed;
+  EXPECT_FALSE(store_->Load(1, &removed));
+  // Removing a missing entry is not an error.
+  EXPECT_TRUE(store_->Remove(1));
+}
+
+TEST_F(SimpleSegmentStoreTest, Reload) {
+  const SimpleSegmentStore::PackedEntry entry1 = MakeEntry('a', 1000);
+  const SimpleSegmentStore::PackedEntry entry2 = MakeEntry('b', 2000);
+  ASSERT_TRUE(store_->Store(1, entry1));
+  ASSERT_TRUE(store_->Store(2, entry2));
+  ASSERT_TRUE(store_->Store(3, MakeEntry('c', 10)));
+  ASSERT_TRUE(store_->Remove(3));
+
+  ResetStore();
+  EXPECT_EQ(2u, store_->GetEntryCountForTesting());
+  ExpectEntry(1, entry1);
+  ExpectEntry(2, entry2);
+  EXPECT_FALSE(store_->Contains(3));
+
+  std::vector<SimpleSegmentStore::EntryInfo> entries;
+  SimpleSegmentStore::GetEntries(temp_dir_.path(), &entries);
+  ASSERT_EQ(2u, entries.size());
+  for (const SimpleSegmentStore::EntryInfo& info : entries) {
+    const SimpleSegmentStore::PackedEntry& expected =
+        info.entry_hash == 1 ? entry1 : entry2;
+    EXPECT_EQ(expected.GetSize(), info.size);
+    EXPECT_EQ(expected.last_modified, info.last_modified);
+  }
+}
+
+TEST_F(SimpleSegmentStoreTest, CorruptJournal) {
+  ASSERT_TRUE(store_->Store(1, MakeEntry('a', 1000)));
+  const base::FilePath journal_path =
+      temp_dir_.path()
+          .AppendASCII(SimpleSegmentStore::kSegmentDirectoryName)
+          .AppendASCII("journal");
+  const char garbage[] = "garbage";
+  ASSERT_EQ(static_cast<int>(sizeof(garbage)),
+            base::WriteFile(journal_path, garbage, sizeof(garbage)));
+
+  // A bad journal empties the store, which remains usable.
+  ResetStore();
+  EXPECT_FALSE(store_->Contains(1));
+  const SimpleSegmentStore::PackedEntry entry = MakeEntry('b', 100);
+  ASSERT_TRUE(store_->Store(2, entry));
+  ExpectEntry(2, entry);
+}
+
+TEST_F(SimpleSegmentStoreTest, Compaction) {
+  // Fills a few segments, then removes most of the entries.
+  const size_t kEntrySize = 8000;
+  const int kEntryCount =
+      3 * SimpleSegmentStore::kSegmentSize / (kEntrySize + kEntrySize / 2);
+  for (int i = 0; i < kEntryCount; ++i)
+    ASSERT_TRUE(store_->Store(i, MakeEntry('a' + i % 26, kEntrySize)));
+  const size_t segment_count = store_->GetSegmentCountForTesting();
+  EXPECT_LE(3u, segment_count);
+  for (int i = 0; i < kEntryCount; ++i) {
+    if (i % 4 != 0)
+      ASSERT_TRUE(store_->Remove(i));
+  }
+
+  store_->Compact();
+  EXPECT_GT(segment_count, store_->GetSegmentCountForTesting());
+
+  ResetStore();
+  EXPECT_EQ(static_cast<size_t>((kEntryCount + 3) / 4),
+            store_->GetEntryCountForTesting());
+  for (int i = 0; i < kEntryCount; i += 4)
+    ExpectEntry(i, MakeEntry('a' + i % 26, kEntrySize));
+}
+
+TEST_F(SimpleSegmentStoreTest, CompactionWithConcurrentStores) {
+  const size_t kEntrySize = 8000;
+  const int kEntryCount =
+      3 * SimpleSegmentStore::kSegmentSize / (kEntrySize + kEntrySize / 2);
+  for (int i = 0; i < kEntryCount; ++i)
+    ASSERT_TRUE(store_->Store(i, MakeEntry('a' + i % 26, kEntrySize)));
+  for (int i = 0; i < kEntryCount; ++i) {
+    if (i % 4 != 0)
+      ASSERT_TRUE(store_->Remove(i));
+  }
+
+  // The entries left are replaced or removed while compaction moves them.
+  base::Thread thread("SimpleSegmentStoreTest");
+  ASSERT_TRUE(thread.Start());
+  thread.task_runner()->PostTask(
+      FROM_HERE, base::Bind(&ReplaceEntries, base::RetainedRef(store_), 0,
+                            kEntryCount, kEntrySize / 2));
+  store_->Compact();
+  thread.Stop();
+  store_->Compact();
+
+  ResetStore();
+  EXPECT_EQ(static_cast<size_t>((kEntryCount + 1) / 2),
+            store_->GetEntryCountForTesting());
+  for (int i = 0; i < kEntryCount; ++i) {
+    if (i % 2)
+      EXPECT_FALSE(store_->Contains(i));
+    else
+      ExpectEntry(i, MakeEntry('A' + i % 26, kEntrySize / 2));
+  }
+}
+
+TEST_F(SimpleSegmentStoreTest, NoPacking) {
+  // A store that does not pack leaves the cache directory alone.
+  store_ = new SimpleSegmentStore(net::DISK_CACHE, temp_dir_.path(), 0,
+                                  nullptr);
+  EXPECT_FALSE(store_->Contains(1));
+  EXPECT_TRUE(store_->Remove(1));
+  EXPECT_FALSE(base::PathExists(temp_dir_.path().AppendASCII(
+      SimpleSegmentStore::kSegmentDirectoryName)));
+}
+
+}  // namespace
+
+}  // namespace disk_cache
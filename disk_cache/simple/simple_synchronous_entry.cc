@@ -23,9 +23,9 @@
 #include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/disk_cache/simple/simple_backend_version.h"
+#include "net/disk_cache/simple/simple_file_batch.h"
 #include "net/disk_cache/simple/simple_histogram_macros.h"
 #include "net/disk_cache/simple/simple_util.h"
-#include "third_party/zlib/zlib.h"
 
 using base::File;
 using base::FilePath;
@@ -33,6 +33,10 @@ using base::Time;
 
 namespace {
 
+// Sparse files are stamped with the backend version. Their ranges are
+// checksummed with zlib CRC-32 up to this version, and with CRC-32C after.
+const uint32_t kLastSparseFileVersionWithCrc32 = 7;
+
 // Used in histograms, please only add entries at the end.
 enum OpenEntryResult {
   OPEN_ENTRY_SUCCESS = 0,
@@ -56,6 +60,7 @@ enum WriteResult {
   WRITE_RESULT_LAZY_STREAM_ENTRY_DOOMED,
   WRITE_RESULT_LAZY_CREATE_FAILURE,
   WRITE_RESULT_LAZY_INITIALIZE_FAILURE,
+  WRITE_RESULT_UNPACK_FAILURE,
   WRITE_RESULT_MAX,
 };
 
@@ -73,6 +78,7 @@ enum CheckEOFResult {
 enum CloseResult {
   CLOSE_RESULT_SUCCESS,
   CLOSE_RESULT_WRITE_FAILURE,
+  CLOSE_RESULT_STORE_FAILURE,
 };
 
 // Used in histograms, please only add entries at the end.
@@ -143,6 +149,24 @@ void CalculateSHA256OfKey(const std::string& key,
   hash->Finish(out_hash_value, sizeof(*out_hash_value));
 }
 
+// Returns how many of the |size| bytes at |offset| in the packed |image| can
+// be read, or -1 on bad arguments.
+int GetPackedReadSize(const std::string& image, int64_t offset, int size) {
+  if (offset < 0 || size < 0)
+    return -1;
+  if (offset >= static_cast<int64_t>(image.size()))
+    return 0;
+  return std::min<int64_t>(size, static_cast<int64_t>(image.size()) - offset);
+}
+
+// When opening an entry, file 0 is read whole if it is at most
+// kPrefetchHeadSize + kPrefetchTrailerSize bytes long. Otherwise, its first
+// kPrefetchHeadSize bytes, holding the header, the key and the start of
+// stream 1, and its last kPrefetchTrailerSize bytes, holding stream 0 and the
+// EOF records, are read.
+const int kPrefetchHeadSize = 32 * 1024;
+const int kPrefetchTrailerSize = 8 * 1024;
+
 }  // namespace
 
 namespace disk_cache {
@@ -211,7 +235,9 @@ SimpleEntryCreationResults::SimpleEntryCreationResults(
     SimpleEntryStat entry_stat)
     : sync_entry(NULL),
       entry_stat(entry_stat),
-      stream_0_crc32(crc32(0, Z_NULL, 0)),
+      checksum_type(SIMPLE_CHECKSUM_CRC32C),
+      stream_0_crc32(0),
+      stream_1_crc32(0),
       result(net::OK) {
 }
 
@@ -251,28 +277,52 @@ SimpleSynchronousEntry::EntryOperationData::EntryOperationData(
     int buf_len_p)
     : sparse_offset(sparse_offset_p), buf_len(buf_len_p) {}
 
+SimpleSynchronousEntry::PrefetchData::PrefetchData() : offset(0) {}
+
+SimpleSynchronousEntry::PrefetchData::~PrefetchData() {}
+
+bool SimpleSynchronousEntry::PrefetchData::Read(int64_t read_offset,
+                                                int size,
+                                                char* dest) const {
+  if (read_offset < offset || size < 0 ||
+      read_offset + size > offset + static_cast<int64_t>(data.size())) {
+    return false;
+  }
+  if (size > 0)
+    memcpy(dest, data.data() + (read_offset - offset), size);
+  return true;
+}
+
 // static
 void SimpleSynchronousEntry::OpenEntry(
     net::CacheType cache_type,
     const FilePath& path,
+    SimpleSegmentStore* segment_store,
     const std::string& key,
     const uint64_t entry_hash,
     const bool had_index,
     SimpleEntryCreationResults* out_results) {
   base::ElapsedTimer open_time;
-  SimpleSynchronousEntry* sync_entry =
-      new SimpleSynchronousEntry(cache_type, path, key, entry_hash, had_index);
+  SimpleSynchronousEntry* sync_entry = new SimpleSynchronousEntry(
+      cache_type, path, segment_store, key, entry_hash, had_index);
   out_results->result = sync_entry->InitializeForOpen(
       &out_results->entry_stat, &out_results->stream_0_data,
-      &out_results->stream_0_crc32);
+      &out_results->stream_0_crc32, &out_results->stream_1_data,
+      &out_results->stream_1_crc32);
   if (out_results->result != net::OK) {
     sync_entry->Doom();
     delete sync_entry;
     out_results->sync_entry = NULL;
     out_results->stream_0_data = NULL;
+    out_results->stream_1_data = NULL;
     return;
   }
+  out_results->checksum_type = sync_entry->checksum_type_;
   UMA_HISTOGRAM_TIMES("SimpleCache.DiskOpenLatency", open_time.Elapsed());
+  if (sync_entry->packed_) {
+    UMA_HISTOGRAM_TIMES("SimpleCache.DiskOpenPackedLatency",
+                        open_time.Elapsed());
+  }
   out_results->sync_entry = sync_entry;
 }
 
@@ -280,13 +330,14 @@ void SimpleSynchronousEntry::OpenEntry(
 void SimpleSynchronousEntry::CreateEntry(
     net::CacheType cache_type,
     const FilePath& path,
+    SimpleSegmentStore* segment_store,
     const std::string& key,
     const uint64_t entry_hash,
     const bool had_index,
     SimpleEntryCreationResults* out_results) {
   DCHECK_EQ(entry_hash, GetEntryHashKey(key));
-  SimpleSynchronousEntry* sync_entry =
-      new SimpleSynchronousEntry(cache_type, path, key, entry_hash, had_index);
+  SimpleSynchronousEntry* sync_entry = new SimpleSynchronousEntry(
+      cache_type, path, segment_store, key, entry_hash, had_index);
   out_results->result =
       sync_entry->InitializeForCreate(&out_results->entry_stat);
   if (out_results->result != net::OK) {
@@ -301,26 +352,36 @@ void SimpleSynchronousEntry::CreateEntry(
 
 // static
 int SimpleSynchronousEntry::DoomEntry(const FilePath& path,
+                                      SimpleSegmentStore* segment_store,
                                       uint64_t entry_hash) {
+  const bool removed_well = segment_store->Remove(entry_hash);
   const bool deleted_well = DeleteFilesForEntryHash(path, entry_hash);
-  return deleted_well ? net::OK : net::ERR_FAILED;
+  return deleted_well && removed_well ? net::OK : net::ERR_FAILED;
 }
 
 // static
-int SimpleSynchronousEntry::TruncateEntryFiles(const base::FilePath& path,
-                                               uint64_t entry_hash) {
+int SimpleSynchronousEntry::TruncateEntryFiles(
+    const base::FilePath& path,
+    SimpleSegmentStore* segment_store,
+    uint64_t entry_hash) {
+  // Packed entries have no files to truncate, and are removed instead.
+  const bool removed_well = segment_store->Remove(entry_hash);
   const bool deleted_well = TruncateFilesForEntryHash(path, entry_hash);
-  return deleted_well ? net::OK : net::ERR_FAILED;
+  return deleted_well && removed_well ? net::OK : net::ERR_FAILED;
 }
 
 // static
 int SimpleSynchronousEntry::DoomEntrySet(
     const std::vector<uint64_t>* key_hashes,
-    const FilePath& path) {
+    const FilePath& path,
+    SimpleSegmentStore* segment_store) {
   const size_t did_delete_count = std::count_if(
       key_hashes->begin(), key_hashes->end(),
-      [&path](const uint64_t& key_hash) {
-        return SimpleSynchronousEntry::DeleteFilesForEntryHash(path, key_hash);
+      [&path, segment_store](const uint64_t& key_hash) {
+        const bool removed_well = segment_store->Remove(key_hash);
+        return SimpleSynchronousEntry::DeleteFilesForEntryHash(path,
+                                                               key_hash) &&
+               removed_well;
       });
   return (did_delete_count == key_hashes->size()) ? net::OK : net::ERR_FAILED;
 }
@@ -333,26 +394,41 @@ void SimpleSynchronousEntry::ReadData(const EntryOperationData& in_entry_op,
   DCHECK(initialized_);
   DCHECK_NE(0, in_entry_op.index);
   int file_index = GetFileIndexFromStreamIndex(in_entry_op.index);
-  if (header_and_key_check_needed_[file_index] &&
-      !CheckHeaderAndKey(file_index)) {
-    *out_result = net::ERR_FAILED;
-    Doom();
-    return;
-  }
   const int64_t file_offset = entry_stat->GetOffsetInFile(
       key_.size(), in_entry_op.offset, in_entry_op.index);
   // Zero-length reads and reads to the empty streams of omitted files should
   // be handled in the SimpleEntryImpl.
   DCHECK_GT(in_entry_op.buf_len, 0);
   DCHECK(!empty_file_omitted_[file_index]);
-  int bytes_read = files_[file_index].Read(file_offset, out_buf->data(),
-                                           in_entry_op.buf_len);
-  if (bytes_read > 0) {
+  int bytes_read;
+  if (header_and_key_check_needed_[file_index] &&
+      !IsInMemory(file_index, 0, GetHeaderSize(key_.size()))) {
+    // The first read of a file that was not prefetched, such as the one of
+    // stream 2, reads the header along with the data.
+    DropPrefetchData();
+    if (!ReadFromFileAndCheckHeaderAndKey(file_index, file_offset,
+                                          out_buf->data(), in_entry_op.buf_len,
+                                          out_crc32, &bytes_read)) {
+      *out_result = net::ERR_FAILED;
+      Doom();
+      return;
+    }
+  } else {
+    if (header_and_key_check_needed_[file_index] &&
+        !CheckHeaderAndKey(file_index)) {
+      *out_result = net::ERR_FAILED;
+      Doom();
+      return;
+    }
+    // Once the reads go past the data read when opening, it is of no more use.
+    if (!IsInMemory(file_index, file_offset, in_entry_op.buf_len))
+      DropPrefetchData();
+    bytes_read = ReadFromFileWithChecksum(file_index, file_offset,
+                                          out_buf->data(), in_entry_op.buf_len,
+                                          out_crc32);
+  }
+  if (bytes_read > 0)
     entry_stat->set_last_used(Time::Now());
-    *out_crc32 = crc32(crc32(0L, Z_NULL, 0),
-                       reinterpret_cast<const Bytef*>(out_buf->data()),
-                       bytes_read);
-  }
   if (bytes_read >= 0) {
     *out_result = bytes_read;
   } else {
@@ -383,6 +459,16 @@ void SimpleSynchronousEntry::WriteData(const EntryOperationData& in_entry_op,
       key_.size(), in_entry_op.offset, in_entry_op.index);
   bool extending_by_write = offset + buf_len > out_entry_stat->data_size(index);
 
+  if (packed_ && packed_entry_.GetSize() + buf_len >
+                     segment_store_->max_packed_entry_size()) {
+    if (!UnpackFiles()) {
+      RecordWriteResult(cache_type_, WRITE_RESULT_UNPACK_FAILURE);
+      Doom();
+      *out_result = net::ERR_CACHE_WRITE_FAILURE;
+      return;
+    }
+  }
+
   if (empty_file_omitted_[file_index]) {
     // Don't create a new file if the entry has been doomed, to avoid it being
     // mixed up with a newly-created entry with the same key.
@@ -414,7 +500,7 @@ void SimpleSynchronousEntry::WriteData(const EntryOperationData& in_entry_op,
     // The EOF record and the eventual stream afterward need to be zeroed out.
     const int64_t file_eof_offset =
         out_entry_stat->GetEOFOffsetInFile(key_.size(), index);
-    if (!files_[file_index].SetLength(file_eof_offset)) {
+    if (!SetFileLength(file_index, file_eof_offset)) {
       RecordWriteResult(cache_type_, WRITE_RESULT_PRETRUNCATE_FAILURE);
       Doom();
       *out_result = net::ERR_CACHE_WRITE_FAILURE;
@@ -422,7 +508,7 @@ void SimpleSynchronousEntry::WriteData(const EntryOperationData& in_entry_op,
     }
   }
   if (buf_len > 0) {
-    if (files_[file_index].Write(file_offset, in_buf->data(), buf_len) !=
+    if (WriteToFile(file_index, file_offset, in_buf->data(), buf_len) !=
         buf_len) {
       RecordWriteResult(cache_type_, WRITE_RESULT_WRITE_FAILURE);
       Doom();
@@ -437,7 +523,7 @@ void SimpleSynchronousEntry::WriteData(const EntryOperationData& in_entry_op,
     out_entry_stat->set_data_size(index, offset + buf_len);
     int file_eof_offset =
         out_entry_stat->GetLastEOFOffsetInFile(key_.size(), index);
-    if (!files_[file_index].SetLength(file_eof_offset)) {
+    if (!SetFileLength(file_index, file_eof_offset)) {
       RecordWriteResult(cache_type_, WRITE_RESULT_TRUNCATE_FAILURE);
       Doom();
       *out_result = net::ERR_CACHE_WRITE_FAILURE;
@@ -527,6 +613,12 @@ void SimpleSynchronousEntry::WriteSparseData(
   int written_so_far = 0;
   int appended_so_far = 0;
 
+  // Sparse data lives in a file of its own, next to the other files.
+  if (packed_ && !UnpackFiles()) {
+    Doom();
+    *out_result = net::ERR_CACHE_WRITE_FAILURE;
+    return;
+  }
   if (!sparse_file_open() && !CreateSparseFile()) {
     *out_result = net::ERR_CACHE_WRITE_FAILURE;
     return;
@@ -665,14 +757,17 @@ void SimpleSynchronousEntry::CheckEOFRecord(int index,
   uint32_t crc32;
   bool has_crc32;
   bool has_key_sha256;
+  SimpleChecksumType checksum_type;
   int stream_size;
   *out_result = GetEOFRecordData(index, entry_stat, &has_crc32, &has_key_sha256,
-                                 &crc32, &stream_size);
+                                 &checksum_type, &crc32, &stream_size);
   if (*out_result != net::OK) {
     Doom();
     return;
   }
-  if (has_crc32 && crc32 != expected_crc32) {
+  // |expected_crc32| is of the checksum type of the entry.
+  if (has_crc32 &&
+      (checksum_type != checksum_type_ || crc32 != expected_crc32)) {
     DVLOG(1) << "EOF record had bad crc.";
     *out_result = net::ERR_CACHE_CHECKSUM_MISMATCH;
     RecordCheckEOFResult(cache_type_, CHECK_EOF_RESULT_CRC_MISMATCH);
@@ -685,65 +780,69 @@ void SimpleSynchronousEntry::CheckEOFRecord(int index,
 void SimpleSynchronousEntry::Close(
     const SimpleEntryStat& entry_stat,
     std::unique_ptr<std::vector<CRCRecord>> crc32s_to_write,
-    net::GrowableIOBuffer* stream_0_data) {
+    net::GrowableIOBuffer* stream_0_data,
+    bool doomed) {
   DCHECK(stream_0_data);
 
-  for (std::vector<CRCRecord>::const_iterator it = crc32s_to_write->begin();
-       it != crc32s_to_write->end(); ++it) {
-    const int stream_index = it->index;
+  // The writes of the records are independent of each other, so they are
+  // issued as one batch. |eof_records| and |hash_value| hold their data until
+  // the batch has run.
+  SimpleFileBatch batch;
+  std::vector<SimpleFileEOF> eof_records(crc32s_to_write->size());
+  net::SHA256HashValue hash_value;
+  bool truncate_failed = false;
+  for (size_t i = 0; i < crc32s_to_write->size(); ++i) {
+    const CRCRecord& crc_record = (*crc32s_to_write)[i];
+    const int stream_index = crc_record.index;
     const int file_index = GetFileIndexFromStreamIndex(stream_index);
     if (empty_file_omitted_[file_index])
       continue;
 
+    int eof_offset = entry_stat.GetEOFOffsetInFile(key_.size(), stream_index);
     if (stream_index == 0) {
-      // Write stream 0 data.
-      int stream_0_offset = entry_stat.GetOffsetInFile(key_.size(), 0, 0);
-      if (files_[0].Write(stream_0_offset, stream_0_data->data(),
-                          entry_stat.data_size(0)) != entry_stat.data_size(0)) {
+      // If stream 0 changed size, the file needs to be resized, otherwise the
+      // next open will yield wrong stream sizes. On stream 1 and stream 2
+      // proper resizing of the file is handled in
+      // SimpleSynchronousEntry::WriteData(). The new length covers the stream
+      // 0 data and key hash, so they can be written afterwards.
+      if (!SetFileLength(file_index, eof_offset)) {
         RecordCloseResult(cache_type_, CLOSE_RESULT_WRITE_FAILURE);
-        DVLOG(1) << "Could not write stream 0 data.";
+        DVLOG(1) << "Could not truncate stream 0 file.";
         Doom();
+        truncate_failed = true;
+        break;
       }
-      net::SHA256HashValue hash_value;
+      // Write stream 0 data.
+      int stream_0_offset = entry_stat.GetOffsetInFile(key_.size(), 0, 0);
+      AddWriteToBatch(&batch, 0, stream_0_offset, stream_0_data->data(),
+                      entry_stat.data_size(0));
       CalculateSHA256OfKey(key_, &hash_value);
-      if (files_[0].Write(stream_0_offset + entry_stat.data_size(0),
-                          reinterpret_cast<char*>(hash_value.data),
-                          sizeof(hash_value)) != sizeof(hash_value)) {
-        RecordCloseResult(cache_type_, CLOSE_RESULT_WRITE_FAILURE);
-        DVLOG(1) << "Could not write stream 0 data.";
-        Doom();
-      }
+      AddWriteToBatch(&batch, 0, stream_0_offset + entry_stat.data_size(0),
+                      reinterpret_cast<char*>(hash_value.data),
+                      sizeof(hash_value));
     }
 
-    SimpleFileEOF eof_record;
+    SimpleFileEOF& eof_record = eof_records[i];
     eof_record.stream_size = entry_stat.data_size(stream_index);
     eof_record.final_magic_number = kSimpleFinalMagicNumber;
     eof_record.flags = 0;
-    if (it->has_crc32)
+    if (crc_record.has_crc32)
       eof_record.flags |= SimpleFileEOF::FLAG_HAS_CRC32;
+    if (checksum_type_ == SIMPLE_CHECKSUM_CRC32C)
+      eof_record.flags |= SimpleFileEOF::FLAG_CRC32C;
     if (stream_index == 0)
       eof_record.flags |= SimpleFileEOF::FLAG_HAS_KEY_SHA256;
-    eof_record.data_crc32 = it->data_crc32;
-    int eof_offset = entry_stat.GetEOFOffsetInFile(key_.size(), stream_index);
-    // If stream 0 changed size, the file needs to be resized, otherwise the
-    // next open will yield wrong stream sizes. On stream 1 and stream 2 proper
-    // resizing of the file is handled in SimpleSynchronousEntry::WriteData().
-    if (stream_index == 0 &&
-        !files_[file_index].SetLength(eof_offset)) {
-      RecordCloseResult(cache_type_, CLOSE_RESULT_WRITE_FAILURE);
-      DVLOG(1) << "Could not truncate stream 0 file.";
-      Doom();
-      break;
-    }
-    if (files_[file_index].Write(eof_offset,
-                                 reinterpret_cast<const char*>(&eof_record),
-                                 sizeof(eof_record)) !=
-        sizeof(eof_record)) {
-      RecordCloseResult(cache_type_, CLOSE_RESULT_WRITE_FAILURE);
-      DVLOG(1) << "Could not write eof record.";
-      Doom();
-      break;
-    }
+    eof_record.data_crc32 = crc_record.data_crc32;
+    AddWriteToBatch(&batch, file_index, eof_offset,
+                    reinterpret_cast<const char*>(&eof_record),
+                    sizeof(eof_record));
+  }
+  // The entry is already doomed if the truncation failed, so the records
+  // batched before it are not worth writing.
+  if (!truncate_failed && !batch.Run()) {
+    RecordCloseResult(cache_type_, CLOSE_RESULT_WRITE_FAILURE);
+    DVLOG(1) << "Could not write stream 0 data or eof record.";
+    Doom();
   }
   for (int i = 0; i < kSimpleEntryFileCount; ++i) {
     if (empty_file_omitted_[i])
@@ -752,6 +851,8 @@ void SimpleSynchronousEntry::Close(
     if (header_and_key_check_needed_[i] && !CheckHeaderAndKey(i)) {
       Doom();
     }
+    if (packed_)
+      continue;
     files_[i].Close();
     const int64_t file_size = entry_stat.GetFileSize(key_.size(), i);
     SIMPLE_CACHE_UMA(CUSTOM_COUNTS,
@@ -764,6 +865,23 @@ void SimpleSynchronousEntry::Close(
                          cluster_loss * 100 / (cluster_loss + file_size)));
   }
 
+  if (packed_ && packed_entry_modified_ && !doomed && !doomed_) {
+    if (packed_entry_.GetSize() > segment_store_->max_packed_entry_size()) {
+      // Stream 0 is only written on close, and may have outgrown the store.
+      if (!UnpackFiles()) {
+        RecordCloseResult(cache_type_, CLOSE_RESULT_WRITE_FAILURE);
+        Doom();
+      }
+    } else {
+      packed_entry_.last_modified = entry_stat.last_modified();
+      if (!segment_store_->Store(entry_hash_, packed_entry_)) {
+        RecordCloseResult(cache_type_, CLOSE_RESULT_STORE_FAILURE);
+        DVLOG(1) << "Could not store packed entry.";
+        Doom();
+      }
+    }
+  }
+
   if (sparse_file_open())
     sparse_file_.Close();
 
@@ -771,24 +889,33 @@ void SimpleSynchronousEntry::Close(
     const int stream2_file_index = GetFileIndexFromStreamIndex(2);
     SIMPLE_CACHE_UMA(BOOLEAN, "EntryCreatedAndStream2Omitted", cache_type_,
                      empty_file_omitted_[stream2_file_index]);
+    SIMPLE_CACHE_UMA(BOOLEAN, "EntryCreatedAndPacked", cache_type_, packed_);
   }
   RecordCloseResult(cache_type_, CLOSE_RESULT_SUCCESS);
   have_open_files_ = false;
   delete this;
 }
 
-SimpleSynchronousEntry::SimpleSynchronousEntry(net::CacheType cache_type,
-                                               const FilePath& path,
-                                               const std::string& key,
-                                               const uint64_t entry_hash,
-                                               const bool had_index)
+SimpleSynchronousEntry::SimpleSynchronousEntry(
+    net::CacheType cache_type,
+    const FilePath& path,
+    SimpleSegmentStore* segment_store,
+    const std::string& key,
+    const uint64_t entry_hash,
+    const bool had_index)
     : cache_type_(cache_type),
       path_(path),
+      segment_store_(segment_store),
       entry_hash_(entry_hash),
       had_index_(had_index),
       key_(key),
       have_open_files_(false),
-      initialized_(false) {
+      initialized_(false),
+      checksum_type_(SIMPLE_CHECKSUM_CRC32C),
+      sparse_checksum_type_(SIMPLE_CHECKSUM_CRC32C),
+      packed_(false),
+      packed_entry_modified_(false),
+      doomed_(false) {
   for (int i = 0; i < kSimpleEntryFileCount; ++i)
     empty_file_omitted_[i] = false;
 }
@@ -830,6 +957,12 @@ bool SimpleSynchronousEntry::MaybeCreateFile(
     return true;
   }
 
+  if (packed_) {
+    DCHECK(packed_entry_.files[file_index].empty());
+    empty_file_omitted_[file_index] = false;
+    return true;
+  }
+
   FilePath filename = GetFilenameFromFileIndex(file_index);
   int flags = File::FLAG_CREATE | File::FLAG_READ | File::FLAG_WRITE |
               File::FLAG_SHARE_DELETE;
@@ -963,7 +1096,7 @@ bool SimpleSynchronousEntry::CreateFiles(SimpleEntryStat* out_entry_stat) {
 void SimpleSynchronousEntry::CloseFile(int index) {
   if (empty_file_omitted_[index]) {
     empty_file_omitted_[index] = false;
-  } else {
+  } else if (!packed_) {
     DCHECK(files_[index].IsValid());
     files_[index].Close();
   }
@@ -977,19 +1110,250 @@ void SimpleSynchronousEntry::CloseFiles() {
     CloseFile(i);
 }
 
+bool SimpleSynchronousEntry::OpenPackedFiles(SimpleEntryStat* out_entry_stat) {
+  if (!segment_store_->Load(entry_hash_, &packed_entry_))
+    return false;
+  packed_ = true;
+  have_open_files_ = true;
+  for (int i = 0; i < kSimpleEntryFileCount; ++i) {
+    empty_file_omitted_[i] = packed_entry_.files[i].empty();
+    // As in OpenFiles(), the file sizes stand in for the stream sizes.
+    out_entry_stat->set_data_size(i + 1, packed_entry_.files[i].size());
+  }
+  out_entry_stat->set_last_used(packed_entry_.last_modified);
+  out_entry_stat->set_last_modified(packed_entry_.last_modified);
+  files_created_ = false;
+  return true;
+}
+
+bool SimpleSynchronousEntry::CreatePackedFiles(
+    SimpleEntryStat* out_entry_stat) {
+  if (segment_store_->Contains(entry_hash_) ||
+      base::PathExists(GetFilenameFromFileIndex(0))) {
+    return false;
+  }
+  packed_ = true;
+  packed_entry_modified_ = true;
+  have_open_files_ = true;
+  for (int i = 0; i < kSimpleEntryFileCount; ++i)
+    empty_file_omitted_[i] = CanOmitEmptyFile(i);
+
+  base::Time creation_time = Time::Now();
+  out_entry_stat->set_last_modified(creation_time);
+  out_entry_stat->set_last_used(creation_time);
+  for (int i = 0; i < kSimpleEntryStreamCount; ++i)
+    out_entry_stat->set_data_size(i, 0);
+  files_created_ = true;
+  return true;
+}
+
+int SimpleSynchronousEntry::ReadFromFile(int file_index,
+                                         int64_t offset,
+                                         char* data,
+                                         int size) const {
+  if (!packed_) {
+    if (file_index == 0) {
+      for (const PrefetchData& prefetch_data : prefetch_data_) {
+        if (prefetch_data.Read(offset, size, data))
+          return size;
+      }
+    }
+    File* file = const_cast<File*>(&files_[file_index]);
+    return file->Read(offset, data, size);
+  }
+  const std::string& image = packed_entry_.files[file_index];
+  const int bytes_read = GetPackedReadSize(image, offset, size);
+  if (bytes_read > 0)
+    memcpy(data, image.data() + offset, bytes_read);
+  return bytes_read;
+}
+
+bool SimpleSynchronousEntry::IsInMemory(int file_index,
+                                        int64_t offset,
+                                        int size) const {
+  if (packed_)
+    return true;
+  if (file_index != 0 || size < 0)
+    return false;
+  for (const PrefetchData& prefetch_data : prefetch_data_) {
+    if (offset >= prefetch_data.offset &&
+        offset + size <=
+            prefetch_data.offset +
+                static_cast<int64_t>(prefetch_data.data.size())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void SimpleSynchronousEntry::PrefetchFile0(int64_t file_size) {
+  DCHECK(!packed_);
+  if (file_size <= 0)
+    return;
+  prefetch_data_[0].offset = 0;
+  if (file_size <= kPrefetchHeadSize + kPrefetchTrailerSize) {
+    prefetch_data_[0].data.resize(file_size);
+  } else {
+    prefetch_data_[0].data.resize(kPrefetchHeadSize);
+    prefetch_data_[1].offset = file_size - kPrefetchTrailerSize;
+    prefetch_data_[1].data.resize(kPrefetchTrailerSize);
+  }
+  // The head and the trailer are read at once.
+  SimpleFileBatch batch;
+  for (PrefetchData& prefetch_data : prefetch_data_) {
+    if (!prefetch_data.data.empty()) {
+      batch.AddRead(&files_[0], prefetch_data.offset, prefetch_data.data.data(),
+                    prefetch_data.data.size());
+    }
+  }
+  // The reads of the entry report the error, if any.
+  if (!batch.Run())
+    DropPrefetchData();
+}
+
+void SimpleSynchronousEntry::DropPrefetchData() {
+  for (PrefetchData& prefetch_data : prefetch_data_) {
+    prefetch_data.offset = 0;
+    std::vector<char>().swap(prefetch_data.data);
+  }
+}
+
+int SimpleSynchronousEntry::ReadFromFileWithChecksum(
+    int file_index,
+    int64_t offset,
+    char* data,
+    int size,
+    uint32_t* out_crc32) const {
+  if (!packed_) {
+    const int bytes_read = ReadFromFile(file_index, offset, data, size);
+    if (bytes_read > 0)
+      *out_crc32 = SimpleChecksum(checksum_type_, 0, data, bytes_read);
+    return bytes_read;
+  }
+  const std::string& image = packed_entry_.files[file_index];
+  const int bytes_read = GetPackedReadSize(image, offset, size);
+  if (bytes_read > 0) {
+    *out_crc32 = SimpleChecksumCopy(checksum_type_, 0, data,
+                                    image.data() + offset, bytes_read);
+  }
+  return bytes_read;
+}
+
+int SimpleSynchronousEntry::WriteToFile(int file_index,
+                                        int64_t offset,
+                                        const char* data,
+                                        int size) {
+  if (!packed_) {
+    if (file_index == 0)
+      DropPrefetchData();
+    return files_[file_index].Write(offset, data, size);
+  }
+  if (offset < 0 || size < 0)
+    return -1;
+  std::string& image = packed_entry_.files[file_index];
+  // Like a file, the image grows with zeroes up to |offset|.
+  if (static_cast<int64_t>(image.size()) < offset + size)
+    image.resize(offset + size);
+  image.replace(offset, size, data, size);
+  packed_entry_modified_ = true;
+  return size;
+}
+
+bool SimpleSynchronousEntry::SetFileLength(int file_index, int64_t length) {
+  if (!packed_) {
+    if (file_index == 0)
+      DropPrefetchData();
+    return files_[file_index].SetLength(length);
+  }
+  if (length < 0)
+    return false;
+  packed_entry_.files[file_index].resize(length);
+  packed_entry_modified_ = true;
+  return true;
+}
+
+void SimpleSynchronousEntry::AddWriteToBatch(SimpleFileBatch* batch,
+                                             int file_index,
+                                             int64_t offset,
+                                             const char* data,
+                                             int size) {
+  if (packed_) {
+    WriteToFile(file_index, offset, data, size);
+    return;
+  }
+  if (file_index == 0)
+    DropPrefetchData();
+  batch->AddWrite(&files_[file_index], offset, data, size);
+}
+
+bool SimpleSynchronousEntry::UnpackFiles() {
+  DCHECK(packed_);
+  // The packed image goes first, so that the entry never exists in both
+  // forms.
+  if (!segment_store_->Remove(entry_hash_))
+    return false;
+  for (int i = 0; i < kSimpleEntryFileCount; ++i) {
+    if (empty_file_omitted_[i])
+      continue;
+    const std::string& image = packed_entry_.files[i];
+    files_[i].Initialize(GetFilenameFromFileIndex(i),
+                         File::FLAG_CREATE_ALWAYS | File::FLAG_READ |
+                             File::FLAG_WRITE | File::FLAG_SHARE_DELETE);
+    if (!files_[i].IsValid() ||
+        files_[i].Write(0, image.data(), image.size()) !=
+            static_cast<int>(image.size())) {
+      return false;
+    }
+  }
+  packed_ = false;
+  packed_entry_ = SimpleSegmentStore::PackedEntry();
+  SIMPLE_CACHE_UMA(BOOLEAN, "PackedEntryUnpacked", cache_type_, true);
+  return true;
+}
+
+bool SimpleSynchronousEntry::ReadFromFileAndCheckHeaderAndKey(
+    int file_index,
+    int64_t offset,
+    char* data,
+    int size,
+    uint32_t* out_crc32,
+    int* out_bytes_read) {
+  DCHECK(!packed_);
+  DCHECK(!key_.empty());
+  std::vector<char> header_data(GetHeaderSize(key_.size()));
+  SimpleFileBatch batch;
+  const size_t header_read = batch.AddRead(
+      &files_[file_index], 0, header_data.data(), header_data.size());
+  const size_t data_read =
+      batch.AddRead(&files_[file_index], offset, data, size);
+  batch.Run();
+  if (!CheckHeaderAndKeyData(file_index, batch.result(header_read),
+                             &header_data)) {
+    return false;
+  }
+  *out_bytes_read = batch.result(data_read);
+  if (*out_bytes_read > 0)
+    *out_crc32 = SimpleChecksum(checksum_type_, 0, data, *out_bytes_read);
+  return true;
+}
+
 bool SimpleSynchronousEntry::CheckHeaderAndKey(int file_index) {
-  // TODO(gavinp): Frequently we are doing this at the same time as we read from
-  // the beginning of an entry. It might improve performance to make a single
-  // read(2) call rather than two separate reads. On the other hand, it would
-  // mean an extra memory to memory copy. In the case where we are opening an
-  // entry without a key, the kInitialHeaderRead setting means that we are
-  // actually already reading stream 1 data here, and tossing it out.
+  // In the case where we are opening an entry without a key, the
+  // kInitialHeaderRead setting means that we are actually already reading
+  // stream 1 data here, and tossing it out.
   std::vector<char> header_data(key_.empty() ? kInitialHeaderRead
                                              : GetHeaderSize(key_.size()));
   int bytes_read =
-      files_[file_index].Read(0, header_data.data(), header_data.size());
+      ReadFromFile(file_index, 0, header_data.data(), header_data.size());
+  return CheckHeaderAndKeyData(file_index, bytes_read, &header_data);
+}
+
+bool SimpleSynchronousEntry::CheckHeaderAndKeyData(
+    int file_index,
+    int bytes_read,
+    std::vector<char>* header_data) {
   const SimpleFileHeader* header =
-      reinterpret_cast<const SimpleFileHeader*>(header_data.data());
+      reinterpret_cast<const SimpleFileHeader*>(header_data->data());
 
   if (bytes_read == -1 || static_cast<size_t>(bytes_read) < sizeof(*header)) {
     RecordSyncOpenResult(cache_type_, OPEN_ENTRY_CANT_READ_HEADER, had_index_);
@@ -997,35 +1361,36 @@ bool SimpleSynchronousEntry::CheckHeaderAndKey(int file_index) {
   }
   // This resize will not invalidate iterators since it does not enlarge the
   // header_data.
-  DCHECK_LE(static_cast<size_t>(bytes_read), header_data.size());
-  header_data.resize(bytes_read);
+  DCHECK_LE(static_cast<size_t>(bytes_read), header_data->size());
+  header_data->resize(bytes_read);
 
   if (header->initial_magic_number != kSimpleInitialMagicNumber) {
     RecordSyncOpenResult(cache_type_, OPEN_ENTRY_BAD_MAGIC_NUMBER, had_index_);
     return false;
   }
 
-  if (header->version != kSimpleEntryVersionOnDisk) {
+  if (header->version < kSimpleEntryMinVersionOnDisk ||
+      header->version > kSimpleEntryVersionOnDisk) {
     RecordSyncOpenResult(cache_type_, OPEN_ENTRY_BAD_VERSION, had_index_);
     return false;
   }
 
   size_t expected_header_size = GetHeaderSize(header->key_length);
-  if (header_data.size() < expected_header_size) {
-    size_t old_size = header_data.size();
+  if (header_data->size() < expected_header_size) {
+    size_t old_size = header_data->size();
     int bytes_to_read = expected_header_size - old_size;
     // This resize will invalidate iterators, since it is enlarging header_data.
-    header_data.resize(expected_header_size);
-    int bytes_read = files_[file_index].Read(
-        old_size, header_data.data() + old_size, bytes_to_read);
+    header_data->resize(expected_header_size);
+    int bytes_read = ReadFromFile(
+        file_index, old_size, header_data->data() + old_size, bytes_to_read);
     if (bytes_read != bytes_to_read) {
       RecordSyncOpenResult(cache_type_, OPEN_ENTRY_CANT_READ_KEY, had_index_);
       return false;
     }
-    header = reinterpret_cast<const SimpleFileHeader*>(header_data.data());
+    header = reinterpret_cast<const SimpleFileHeader*>(header_data->data());
   }
 
-  char* key_data = header_data.data() + sizeof(*header);
+  char* key_data = header_data->data() + sizeof(*header);
   if (base::Hash(key_data, header->key_length) != header->key_hash) {
     RecordSyncOpenResult(cache_type_, OPEN_ENTRY_KEY_HASH_MISMATCH, had_index_);
     return false;
@@ -1048,12 +1413,17 @@ bool SimpleSynchronousEntry::CheckHeaderAndKey(int file_index) {
 int SimpleSynchronousEntry::InitializeForOpen(
     SimpleEntryStat* out_entry_stat,
     scoped_refptr<net::GrowableIOBuffer>* stream_0_data,
-    uint32_t* out_stream_0_crc32) {
+    uint32_t* out_stream_0_crc32,
+    scoped_refptr<net::GrowableIOBuffer>* stream_1_data,
+    uint32_t* out_stream_1_crc32) {
   DCHECK(!initialized_);
-  if (!OpenFiles(out_entry_stat)) {
+  if (!OpenPackedFiles(out_entry_stat) && !OpenFiles(out_entry_stat)) {
     DLOG(WARNING) << "Could not open platform files for entry.";
     return net::ERR_FAILED;
   }
+  // Until the streams are read, data_size(1) holds the size of file 0.
+  if (!packed_)
+    PrefetchFile0(out_entry_stat->data_size(1));
   for (int i = 0; i < kSimpleEntryFileCount; ++i) {
     if (empty_file_omitted_[i])
       continue;
@@ -1083,8 +1453,9 @@ int SimpleSynchronousEntry::InitializeForOpen(
     }
   }
 
+  // Packed entries have no sparse data.
   int32_t sparse_data_size = 0;
-  if (!OpenSparseFileIfExists(&sparse_data_size)) {
+  if (!packed_ && !OpenSparseFileIfExists(&sparse_data_size)) {
     RecordSyncOpenResult(cache_type_, OPEN_ENTRY_SPARSE_OPEN_FAILED,
                          had_index_);
     return net::ERR_FAILED;
@@ -1098,7 +1469,12 @@ int SimpleSynchronousEntry::InitializeForOpen(
       out_entry_stat->data_size(2) == 0) {
     DVLOG(1) << "Removing empty stream 2 file.";
     CloseFile(stream2_file_index);
-    DeleteFileForEntryHash(path_, entry_hash_, stream2_file_index);
+    if (packed_) {
+      packed_entry_.files[stream2_file_index].clear();
+      packed_entry_modified_ = true;
+    } else {
+      DeleteFileForEntryHash(path_, entry_hash_, stream2_file_index);
+    }
     empty_file_omitted_[stream2_file_index] = true;
     removed_stream2 = true;
   }
@@ -1106,6 +1482,13 @@ int SimpleSynchronousEntry::InitializeForOpen(
   SIMPLE_CACHE_UMA(BOOLEAN, "EntryOpenedAndStream2Removed", cache_type_,
                    removed_stream2);
 
+  ReadStream1IfInMemory(*out_entry_stat, stream_1_data, out_stream_1_crc32);
+  SIMPLE_CACHE_UMA(BOOLEAN, "SyncOpenReadStream1", cache_type_,
+                   stream_1_data->get() != nullptr);
+  // All reads of stream 1 are then served from |stream_1_data|.
+  if (stream_1_data->get())
+    DropPrefetchData();
+
   RecordSyncOpenResult(cache_type_, OPEN_ENTRY_SUCCESS, had_index_);
   initialized_ = true;
   return net::OK;
@@ -1121,15 +1504,15 @@ bool SimpleSynchronousEntry::InitializeCreatedFile(
   header.key_length = key_.size();
   header.key_hash = base::Hash(key_);
 
-  int bytes_written = files_[file_index].Write(
-      0, reinterpret_cast<char*>(&header), sizeof(header));
+  int bytes_written = WriteToFile(
+      file_index, 0, reinterpret_cast<char*>(&header), sizeof(header));
   if (bytes_written != sizeof(header)) {
     *out_result = CREATE_ENTRY_CANT_WRITE_HEADER;
     return false;
   }
 
-  bytes_written = files_[file_index].Write(sizeof(header), key_.data(),
-                                           key_.size());
+  bytes_written = WriteToFile(file_index, sizeof(header), key_.data(),
+                              key_.size());
   if (bytes_written != base::checked_cast<int>(key_.size())) {
     *out_result = CREATE_ENTRY_CANT_WRITE_KEY;
     return false;
@@ -1141,7 +1524,12 @@ bool SimpleSynchronousEntry::InitializeCreatedFile(
 int SimpleSynchronousEntry::InitializeForCreate(
     SimpleEntryStat* out_entry_stat) {
   DCHECK(!initialized_);
-  if (!CreateFiles(out_entry_stat)) {
+  if (segment_store_->max_packed_entry_size() > 0) {
+    if (!CreatePackedFiles(out_entry_stat)) {
+      DLOG(WARNING) << "Entry to pack already exists.";
+      return net::ERR_FILE_EXISTS;
+    }
+  } else if (!CreateFiles(out_entry_stat)) {
     DLOG(WARNING) << "Could not create platform files.";
     return net::ERR_FILE_EXISTS;
   }
@@ -1180,7 +1568,7 @@ int SimpleSynchronousEntry::ReadAndValidateStream0(
   int stream_0_size;
   int ret_value_crc32 =
       GetEOFRecordData(0, *out_entry_stat, &has_crc32, &has_key_sha256,
-                       &read_crc32, &stream_0_size);
+                       &checksum_type_, &read_crc32, &stream_0_size);
   if (ret_value_crc32 != net::OK)
     return ret_value_crc32;
   // Calculate and set the real values for data size.
@@ -1199,17 +1587,13 @@ int SimpleSynchronousEntry::ReadAndValidateStream0(
   int read_size = stream_0_size;
   if (has_key_sha256)
     read_size += sizeof(net::SHA256HashValue);
-  if (files_[0].Read(file_offset, (*stream_0_data)->data(), read_size) !=
+  if (ReadFromFile(0, file_offset, (*stream_0_data)->data(), read_size) !=
       read_size)
     return net::ERR_FAILED;
 
   // Check the CRC32.
-  uint32_t expected_crc32 =
-      stream_0_size == 0
-          ? crc32(0, Z_NULL, 0)
-          : crc32(crc32(0, Z_NULL, 0),
-                  reinterpret_cast<const Bytef*>((*stream_0_data)->data()),
-                  stream_0_size);
+  uint32_t expected_crc32 = SimpleChecksum(
+      checksum_type_, 0, (*stream_0_data)->data(), stream_0_size);
   if (has_crc32 && read_crc32 != expected_crc32) {
     DVLOG(1) << "EOF record had bad crc.";
     RecordCheckEOFResult(cache_type_, CHECK_EOF_RESULT_CRC_MISMATCH);
@@ -1241,19 +1625,57 @@ int SimpleSynchronousEntry::ReadAndValidateStream0(
   return net::OK;
 }
 
-int SimpleSynchronousEntry::GetEOFRecordData(int index,
-                                             const SimpleEntryStat& entry_stat,
-                                             bool* out_has_crc32,
-                                             bool* out_has_key_sha256,
-                                             uint32_t* out_crc32,
-                                             int* out_data_size) const {
+void SimpleSynchronousEntry::ReadStream1IfInMemory(
+    const SimpleEntryStat& entry_stat,
+    scoped_refptr<net::GrowableIOBuffer>* stream_1_data,
+    uint32_t* out_stream_1_crc32) {
+  const int stream_1_size = entry_stat.data_size(1);
+  const int file_offset = entry_stat.GetOffsetInFile(key_.size(), 0, 1);
+  if (stream_1_size == 0 || stream_1_size > kPrefetchHeadSize ||
+      !IsInMemory(0, file_offset,
+                  stream_1_size + static_cast<int>(sizeof(SimpleFileEOF)))) {
+    return;
+  }
+  // The key is checked before any data is handed out.
+  if (header_and_key_check_needed_[0] && !CheckHeaderAndKey(0))
+    return;
+
+  bool has_crc32;
+  bool has_key_sha256;
+  SimpleChecksumType checksum_type;
+  uint32_t read_crc32;
+  int stream_size;
+  if (GetEOFRecordData(1, entry_stat, &has_crc32, &has_key_sha256,
+                       &checksum_type, &read_crc32, &stream_size) != net::OK) {
+    return;
+  }
+  scoped_refptr<net::GrowableIOBuffer> data(new net::GrowableIOBuffer());
+  data->SetCapacity(stream_1_size);
+  uint32_t crc32;
+  if (ReadFromFileWithChecksum(0, file_offset, data->data(), stream_1_size,
+                               &crc32) != stream_1_size) {
+    return;
+  }
+  if (has_crc32 && (checksum_type != checksum_type_ || crc32 != read_crc32))
+    return;
+  *stream_1_data = data;
+  *out_stream_1_crc32 = crc32;
+}
+
+int SimpleSynchronousEntry::GetEOFRecordData(
+    int index,
+    const SimpleEntryStat& entry_stat,
+    bool* out_has_crc32,
+    bool* out_has_key_sha256,
+    SimpleChecksumType* out_checksum_type,
+    uint32_t* out_crc32,
+    int* out_data_size) const {
   SimpleFileEOF eof_record;
   int file_offset = entry_stat.GetEOFOffsetInFile(key_.size(), index);
   int file_index = GetFileIndexFromStreamIndex(index);
-  File* file = const_cast<File*>(&files_[file_index]);
-  if (file->Read(file_offset, reinterpret_cast<char*>(&eof_record),
-                 sizeof(eof_record)) !=
-      sizeof(eof_record)) {
+  if (ReadFromFile(file_index, file_offset,
+                   reinterpret_cast<char*>(&eof_record),
+                   sizeof(eof_record)) != sizeof(eof_record)) {
     RecordCheckEOFResult(cache_type_, CHECK_EOF_RESULT_READ_FAILURE);
     return net::ERR_CACHE_CHECKSUM_READ_FAILURE;
   }
@@ -1269,6 +1691,9 @@ int SimpleSynchronousEntry::GetEOFRecordData(int index,
   *out_has_key_sha256 =
       (eof_record.flags & SimpleFileEOF::FLAG_HAS_KEY_SHA256) ==
       SimpleFileEOF::FLAG_HAS_KEY_SHA256;
+  *out_checksum_type = (eof_record.flags & SimpleFileEOF::FLAG_CRC32C)
+                           ? SIMPLE_CHECKSUM_CRC32C
+                           : SIMPLE_CHECKSUM_CRC32;
   *out_crc32 = eof_record.data_crc32;
   *out_data_size = eof_record.stream_size;
   SIMPLE_CACHE_UMA(BOOLEAN, "SyncCheckEOFHasCrc", cache_type_, *out_has_crc32);
@@ -1276,6 +1701,8 @@ int SimpleSynchronousEntry::GetEOFRecordData(int index,
 }
 
 void SimpleSynchronousEntry::Doom() const {
+  doomed_ = true;
+  segment_store_->Remove(entry_hash_);
   DeleteFilesForEntryHash(path_, entry_hash_);
 }
 
@@ -1415,6 +1842,7 @@ bool SimpleSynchronousEntry::InitializeSparseFile() {
 
   sparse_ranges_.clear();
   sparse_tail_offset_ = sizeof(header) + key_.size();
+  sparse_checksum_type_ = SIMPLE_CHECKSUM_CRC32C;
 
   return true;
 }
@@ -1437,10 +1865,14 @@ bool SimpleSynchronousEntry::ScanSparseFile(int32_t* out_sparse_data_size) {
     return false;
   }
 
-  if (header.version != kSimpleVersion) {
+  if (header.version != kSimpleVersion &&
+      header.version != kLastSparseFileVersionWithCrc32) {
     DLOG(WARNING) << "Sparse file unreadable version.";
     return false;
   }
+  sparse_checksum_type_ = header.version == kLastSparseFileVersionWithCrc32
+                              ? SIMPLE_CHECKSUM_CRC32
+                              : SIMPLE_CHECKSUM_CRC32C;
 
   sparse_ranges_.clear();
 
@@ -1498,8 +1930,7 @@ bool SimpleSynchronousEntry::ReadSparseRange(const SparseRange* range,
 
   // If we read the whole range and we have a crc32, check it.
   if (offset == 0 && len == range->length && range->data_crc32 != 0) {
-    uint32_t actual_crc32 =
-        crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(buf), len);
+    uint32_t actual_crc32 = SimpleChecksum(sparse_checksum_type_, 0, buf, len);
     if (actual_crc32 != range->data_crc32) {
       DLOG(WARNING) << "Sparse range crc32 mismatch.";
       return false;
@@ -1520,9 +1951,7 @@ bool SimpleSynchronousEntry::WriteSparseRange(SparseRange* range,
 
   uint32_t new_crc32 = 0;
   if (offset == 0 && len == range->length) {
-    new_crc32 = crc32(crc32(0L, Z_NULL, 0),
-                      reinterpret_cast<const Bytef*>(buf),
-                      len);
+    new_crc32 = SimpleChecksum(sparse_checksum_type_, 0, buf, len);
   }
 
   if (new_crc32 != range->data_crc32) {
@@ -1559,8 +1988,7 @@ bool SimpleSynchronousEntry::AppendSparseRange(int64_t offset,
   DCHECK_GT(len, 0);
   DCHECK(buf);
 
-  uint32_t data_crc32 =
-      crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(buf), len);
+  uint32_t data_crc32 = SimpleChecksum(sparse_checksum_type_, 0, buf, len);
 
   SimpleFileSparseRangeHeader header;
   header.sparse_range_magic_number = kSimpleSparseRangeMagicNumber;
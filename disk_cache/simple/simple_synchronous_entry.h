@@ -21,7 +21,9 @@
 #include "base/time/time.h"
 #include "net/base/cache_type.h"
 #include "net/base/net_export.h"
+#include "net/disk_cache/simple/simple_checksum.h"
 #include "net/disk_cache/simple/simple_entry_format.h"
+#include "net/disk_cache/simple/simple_segment_store.h"
 
 namespace net {
 class GrowableIOBuffer;
@@ -32,6 +34,7 @@ FORWARD_DECLARE_TEST(DiskCacheBackendTest, SimpleCacheEnumerationLongKeys);
 
 namespace disk_cache {
 
+class SimpleFileBatch;
 class SimpleSynchronousEntry;
 
 // This class handles the passing of data about the entry between
@@ -80,7 +83,12 @@ struct SimpleEntryCreationResults {
   SimpleSynchronousEntry* sync_entry;
   scoped_refptr<net::GrowableIOBuffer> stream_0_data;
   SimpleEntryStat entry_stat;
+  SimpleChecksumType checksum_type;
   uint32_t stream_0_crc32;
+  // Set when opening an entry whose stream 1 was read along with stream 0; its
+  // checksum is then already checked.
+  scoped_refptr<net::GrowableIOBuffer> stream_1_data;
+  uint32_t stream_1_crc32;
   int result;
 };
 
@@ -117,16 +125,21 @@ class SimpleSynchronousEntry {
 
   // Opens a disk cache entry on disk. The |key| parameter is optional, if empty
   // the operation may be slower. The |entry_hash| parameter is required.
-  // |had_index| is provided only for histograms.
+  // |had_index| is provided only for histograms. Entries packed in
+  // |segment_store| are opened from there.
   static void OpenEntry(net::CacheType cache_type,
                         const base::FilePath& path,
+                        SimpleSegmentStore* segment_store,
                         const std::string& key,
                         uint64_t entry_hash,
                         bool had_index,
                         SimpleEntryCreationResults* out_results);
 
+  // Entries are created in memory if |segment_store| packs new entries, and
+  // only get files of their own if they outgrow its packing threshold.
   static void CreateEntry(net::CacheType cache_type,
                           const base::FilePath& path,
+                          SimpleSegmentStore* segment_store,
                           const std::string& key,
                           uint64_t entry_hash,
                           bool had_index,
@@ -135,20 +148,24 @@ class SimpleSynchronousEntry {
   // Deletes an entry from the file system without affecting the state of the
   // corresponding instance, if any (allowing operations to continue to be
   // executed through that instance). Returns a net error code.
-  static int DoomEntry(const base::FilePath& path, uint64_t entry_hash);
+  static int DoomEntry(const base::FilePath& path,
+                       SimpleSegmentStore* segment_store,
+                       uint64_t entry_hash);
 
   // Like |DoomEntry()| above, except that it truncates the entry files rather
   // than deleting them. Used when dooming entries after the backend has
   // shutdown. See implementation of |SimpleEntryImpl::DoomEntryInternal()| for
   // more.
   static int TruncateEntryFiles(const base::FilePath& path,
+                                SimpleSegmentStore* segment_store,
                                 uint64_t entry_hash);
 
   // Like |DoomEntry()| above. Deletes all entries corresponding to the
   // |key_hashes|. Succeeds only when all entries are deleted. Returns a net
   // error code.
   static int DoomEntrySet(const std::vector<uint64_t>* key_hashes,
-                          const base::FilePath& path);
+                          const base::FilePath& path,
+                          SimpleSegmentStore* segment_store);
 
   // N.B. ReadData(), WriteData(), CheckEOFRecord() and Close() may block on IO.
   void ReadData(const EntryOperationData& in_entry_op,
@@ -179,10 +196,12 @@ class SimpleSynchronousEntry {
                          int* out_result);
 
   // Close all streams, and add write EOF records to streams indicated by the
-  // CRCRecord entries in |crc32s_to_write|.
+  // CRCRecord entries in |crc32s_to_write|. A packed entry is stored back
+  // into the segment store if it was modified, unless |doomed|.
   void Close(const SimpleEntryStat& entry_stat,
              std::unique_ptr<std::vector<CRCRecord>> crc32s_to_write,
-             net::GrowableIOBuffer* stream_0_data);
+             net::GrowableIOBuffer* stream_0_data,
+             bool doomed);
 
   const base::FilePath& path() const { return path_; }
   std::string key() const { return key_; }
@@ -215,6 +234,19 @@ class SimpleSynchronousEntry {
     }
   };
 
+  // A range of file 0 read when opening the entry.
+  struct PrefetchData {
+    PrefetchData();
+    ~PrefetchData();
+
+    // Copies the |size| bytes at |offset| in the file to |dest|, if they are
+    // all in the range.
+    bool Read(int64_t offset, int size, char* dest) const;
+
+    int64_t offset;
+    std::vector<char> data;
+  };
+
   // When opening an entry without knowing the key, the header must be read
   // without knowing the size of the key. This is how much to read initially, to
   // make it likely the entire key is read.
@@ -222,6 +254,7 @@ class SimpleSynchronousEntry {
 
   SimpleSynchronousEntry(net::CacheType cache_type,
                          const base::FilePath& path,
+                         SimpleSegmentStore* segment_store,
                          const std::string& key,
                          uint64_t entry_hash,
                          bool had_index);
@@ -246,16 +279,79 @@ class SimpleSynchronousEntry {
   void CloseFile(int index);
   void CloseFiles();
 
+  // Loads the images of a packed entry. Returns false if the entry is not
+  // packed.
+  bool OpenPackedFiles(SimpleEntryStat* out_entry_stat);
+
+  // Starts the images of a new packed entry. Returns false if the entry
+  // already exists.
+  bool CreatePackedFiles(SimpleEntryStat* out_entry_stat);
+
+  // The files of a packed entry are images in |packed_entry_| rather than
+  // |files_|. These read, write and resize the file |file_index| either way.
+  int ReadFromFile(int file_index, int64_t offset, char* data, int size) const;
+
+  // Returns true if reading the range needs no I/O.
+  bool IsInMemory(int file_index, int64_t offset, int size) const;
+
+  // Reads the head and the trailer of file 0, of |file_size| bytes, or all of
+  // it if it is small. The header, the key, stream 0 and the start of stream 1
+  // are then read with a single SimpleFileBatch.
+  void PrefetchFile0(int64_t file_size);
+  void DropPrefetchData();
+
+  // Like ReadFromFile(), also setting |out_crc32| to the checksum of the data
+  // read. The image of a packed file is checksummed as it is copied out.
+  int ReadFromFileWithChecksum(int file_index,
+                               int64_t offset,
+                               char* data,
+                               int size,
+                               uint32_t* out_crc32) const;
+  int WriteToFile(int file_index, int64_t offset, const char* data, int size);
+  bool SetFileLength(int file_index, int64_t length);
+
+  // Like WriteToFile(), except that a write to a file on disk is added to
+  // |batch|.
+  void AddWriteToBatch(SimpleFileBatch* batch,
+                       int file_index,
+                       int64_t offset,
+                       const char* data,
+                       int size);
+
+  // Moves the images of a packed entry to files of their own, once it
+  // outgrows the packing threshold or gets sparse data.
+  bool UnpackFiles();
+
   // Read the header and key at the beginning of the file, and validate that
   // they are correct. If this entry was opened with a key, the key is checked
   // for a match. If not, then the |key_| member is set based on the value in
   // this header. Records histograms if any check is failed.
   bool CheckHeaderAndKey(int file_index);
 
+  // Checks the |bytes_read| bytes of |header_data| read from the start of file
+  // |file_index| like CheckHeaderAndKey(), reading the rest of the key if it
+  // is longer than expected.
+  bool CheckHeaderAndKeyData(int file_index,
+                             int bytes_read,
+                             std::vector<char>* header_data);
+
+  // Reads the header of file |file_index|, which must be on disk, along with
+  // |size| bytes at |offset| into |data| in a single SimpleFileBatch. Returns
+  // false if the header and key check fails. Otherwise, sets |out_bytes_read|
+  // like ReadFromFileWithChecksum() does its result, and |out_crc32|.
+  bool ReadFromFileAndCheckHeaderAndKey(int file_index,
+                                        int64_t offset,
+                                        char* data,
+                                        int size,
+                                        uint32_t* out_crc32,
+                                        int* out_bytes_read);
+
   // Returns a net error, i.e. net::OK on success.
   int InitializeForOpen(SimpleEntryStat* out_entry_stat,
                         scoped_refptr<net::GrowableIOBuffer>* stream_0_data,
-                        uint32_t* out_stream_0_crc32);
+                        uint32_t* out_stream_0_crc32,
+                        scoped_refptr<net::GrowableIOBuffer>* stream_1_data,
+                        uint32_t* out_stream_1_crc32);
 
   // Writes the header and key to a newly-created stream file. |index| is the
   // index of the stream. Returns true on success; returns false and sets
@@ -274,10 +370,19 @@ class SimpleSynchronousEntry {
       scoped_refptr<net::GrowableIOBuffer>* stream_0_data,
       uint32_t* out_stream_0_crc32);
 
+  // Fills |stream_1_data| with stream 1 if it is small and its checksum
+  // matches, and if it is in memory already. Otherwise, leaves it for the
+  // reads of the entry to report any corruption.
+  void ReadStream1IfInMemory(
+      const SimpleEntryStat& entry_stat,
+      scoped_refptr<net::GrowableIOBuffer>* stream_1_data,
+      uint32_t* out_stream_1_crc32);
+
   int GetEOFRecordData(int index,
                        const SimpleEntryStat& entry_stat,
                        bool* out_has_crc32,
                        bool* out_has_key_sha256,
+                       SimpleChecksumType* out_checksum_type,
                        uint32_t* out_crc32,
                        int* out_data_size) const;
   void Doom() const;
@@ -333,6 +438,7 @@ class SimpleSynchronousEntry {
 
   const net::CacheType cache_type_;
   const base::FilePath path_;
+  const scoped_refptr<SimpleSegmentStore> segment_store_;
   const uint64_t entry_hash_;
   const bool had_index_;
   std::string key_;
@@ -340,6 +446,11 @@ class SimpleSynchronousEntry {
   bool have_open_files_;
   bool initialized_;
 
+  // The checksums of the streams, as recorded in the EOF record of stream 0,
+  // and of the sparse ranges, as implied by the version of the sparse file.
+  SimpleChecksumType checksum_type_;
+  SimpleChecksumType sparse_checksum_type_;
+
   // Normally false. This is set to true when an entry is opened without
   // checking the file headers. Any subsequent read will perform the check
   // before completing.
@@ -349,6 +460,10 @@ class SimpleSynchronousEntry {
 
   base::File files_[kSimpleEntryFileCount];
 
+  // The head and the trailer of file 0, read by PrefetchFile0() and kept
+  // until the reads of the entry go past them or file 0 is written.
+  PrefetchData prefetch_data_[2];
+
   // True if the corresponding stream is empty and therefore no on-disk file
   // was created to store it.
   bool empty_file_omitted_[kSimpleEntryFileCount];
@@ -364,6 +479,15 @@ class SimpleSynchronousEntry {
   // True if the entry was created, or false if it was opened. Used to log
   // SimpleCache.*.EntryCreatedWithStream2Omitted only for created entries.
   bool files_created_;
+
+  // True if the files of the entry are held in |packed_entry_|, which is then
+  // stored back into |segment_store_| on close if |packed_entry_modified_|.
+  bool packed_;
+  bool packed_entry_modified_;
+  SimpleSegmentStore::PackedEntry packed_entry_;
+
+  // Set by Doom(), so that a doomed packed entry is not stored back on close.
+  mutable bool doomed_;
 };
 
 }  // namespace disk_cache
@@ -181,6 +181,12 @@ bool UpgradeSimpleCacheOnDisk(const base::FilePath& path) {
     // the V7 index reader is backwards compatible.
     version_from++;
   }
+  DCHECK_LE(7U, version_from);
+  if (version_from == 7) {
+    // No upgrade from V7 -> V8: entries written with CRC-32C are flagged in
+    // their EOF records, and older entries and sparse files remain readable.
+    version_from++;
+  }
   DCHECK_EQ(kSimpleVersion, version_from);
 
   if (!new_fake_index_needed)
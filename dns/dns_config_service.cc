@@ -18,6 +18,7 @@ DnsConfig::DnsConfig()
     : unhandled_options(false),
       append_to_multi_label_name(true),
       randomize_ports(false),
+      pipeline_queries(false),
       ndots(1),
       timeout(base::TimeDelta::FromMilliseconds(kDnsDefaultTimeoutMs)),
       attempts(2),
@@ -30,7 +31,11 @@ DnsConfig::DnsConfig(const DnsConfig& other) = default;
 DnsConfig::~DnsConfig() {}
 
 bool DnsConfig::Equals(const DnsConfig& d) const {
-  return EqualsIgnoreHosts(d) && (hosts == d.hosts);
+  if (!EqualsIgnoreHosts(d) || hosts != d.hosts)
+    return false;
+  if (!hosts_index || !d.hosts_index)
+    return hosts_index == d.hosts_index;
+  return hosts_index->Equals(*d.hosts_index);
 }
 
 bool DnsConfig::EqualsIgnoreHosts(const DnsConfig& d) const {
@@ -80,7 +85,8 @@ std::unique_ptr<base::Value> DnsConfig::ToValue() const {
   dict->SetBoolean("rotate", rotate);
   dict->SetBoolean("edns0", edns0);
   dict->SetBoolean("use_local_ipv6", use_local_ipv6);
-  dict->SetInteger("num_hosts", hosts.size());
+  dict->SetInteger("num_hosts",
+                   hosts.size() + (hosts_index ? hosts_index->size() : 0));
 
   return std::move(dict);
 }
@@ -165,11 +171,32 @@ void DnsConfigService::OnHostsRead(const DnsHosts& hosts) {
   DCHECK(CalledOnValidThread());
 
   bool changed = false;
-  if (hosts != dns_config_.hosts) {
+  if (hosts != dns_config_.hosts || dns_config_.hosts_index) {
     dns_config_.hosts = hosts;
+    dns_config_.hosts_index = nullptr;
     need_update_ = true;
     changed = true;
   }
+  OnHostsUpdated(changed);
+}
+
+void DnsConfigService::OnHostsRead(
+    const scoped_refptr<const DnsHostsIndex>& hosts_index) {
+  DCHECK(CalledOnValidThread());
+  DCHECK(hosts_index);
+
+  bool changed = false;
+  if (!dns_config_.hosts.empty() || !dns_config_.hosts_index ||
+      !dns_config_.hosts_index->Equals(*hosts_index)) {
+    dns_config_.hosts.clear();
+    dns_config_.hosts_index = hosts_index;
+    need_update_ = true;
+    changed = true;
+  }
+  OnHostsUpdated(changed);
+}
+
+void DnsConfigService::OnHostsUpdated(bool changed) {
   if (!changed && !last_sent_empty_time_.is_null()) {
     UMA_HISTOGRAM_LONG_TIMES("AsyncDNS.UnchangedHostsInterval",
                              base::TimeTicks::Now() - last_sent_empty_time_);
@@ -60,6 +60,9 @@ struct NET_EXPORT_PRIVATE DnsConfig {
   std::vector<std::string> search;
 
   DnsHosts hosts;
+  // If set, HOSTS lookups are answered from this index instead, and |hosts| is
+  // empty. Used for large HOSTS files.
+  scoped_refptr<const DnsHostsIndex> hosts_index;
 
   // True if there are options set in the system configuration that are not yet
   // supported by DnsClient.
@@ -73,6 +76,12 @@ struct NET_EXPORT_PRIVATE DnsConfig {
   // resources on some platforms.
   bool randomize_ports;
 
+  // Send the queries to each nameserver over a few long-lived UDP sockets and
+  // TCP connections shared by all transactions, rather than over sockets of
+  // their own. This saves sockets at high query rates, at the cost of source
+  // port entropy.
+  bool pipeline_queries;
+
   // Resolver options; see man resolv.conf.
 
   // Minimum number of dots before global resolution precedes |search|.
@@ -141,6 +150,8 @@ class NET_EXPORT_PRIVATE DnsConfigService
   void OnConfigRead(const DnsConfig& config);
   // Called with new hosts. Rest of the config is assumed unchanged.
   void OnHostsRead(const DnsHosts& hosts);
+  // Same as above, for hosts indexed in |hosts_index|.
+  void OnHostsRead(const scoped_refptr<const DnsHostsIndex>& hosts_index);
 
   void set_watch_failed(bool value) { watch_failed_ = value; }
 
@@ -150,6 +161,8 @@ class NET_EXPORT_PRIVATE DnsConfigService
   void OnTimeout();
   // Called when the config becomes complete. Stops the timer.
   void OnCompleteConfig();
+  // Called by both OnHostsRead once |dns_config_| has the new hosts.
+  void OnHostsUpdated(bool changed);
 
   CallbackType callback_;
 
@@ -4,6 +4,8 @@
 
 #include "net/dns/dns_config_service_posix.h"
 
+#include <stdint.h>
+
 #include <memory>
 #include <string>
 
@@ -11,6 +13,7 @@
 #include "base/files/file.h"
 #include "base/files/file_path.h"
 #include "base/files/file_path_watcher.h"
+#include "base/files/file_util.h"
 #include "base/lazy_instance.h"
 #include "base/location.h"
 #include "base/macros.h"
@@ -48,6 +51,10 @@ const base::FilePath::CharType kFilePathHosts[] =
     FILE_PATH_LITERAL("/etc/hosts");
 #endif
 
+// HOSTS files at least this large are indexed rather than parsed into a
+// DnsHosts map. These are typically ad-blocking lists.
+const int64_t kMinIndexedHostsSize = 1 << 18;  // 256KB
+
 #if defined(OS_IOS)
 // There is no public API to watch the DNS configuration on iOS.
 class DnsConfigWatcher {
@@ -346,14 +353,27 @@ class DnsConfigServicePosix::HostsReader : public SerialWorker {
 
   void DoWork() override {
     base::TimeTicks start_time = base::TimeTicks::Now();
-    success_ = ParseHostsFile(file_path_hosts_, &hosts_);
+    int64_t size;
+    if (base::GetFileSize(file_path_hosts_, &size) &&
+        size >= kMinIndexedHostsSize) {
+      hosts_.clear();
+      hosts_index_ = DnsHostsIndex::CreateFromFile(file_path_hosts_);
+      success_ = !!hosts_index_;
+    } else {
+      hosts_index_ = nullptr;
+      success_ = ParseHostsFile(file_path_hosts_, &hosts_);
+    }
     UMA_HISTOGRAM_BOOLEAN("AsyncDNS.HostParseResult", success_);
     UMA_HISTOGRAM_TIMES("AsyncDNS.HostsParseDuration",
                         base::TimeTicks::Now() - start_time);
   }
 
   void OnWorkFinished() override {
-    if (success_) {
+    if (success_ && hosts_index_) {
+      service_->OnHostsRead(hosts_index_);
+      // The service holds the index from now on.
+      hosts_index_ = nullptr;
+    } else if (success_) {
       service_->OnHostsRead(hosts_);
     } else {
       LOG(WARNING) << "Failed to read DnsHosts.";
@@ -368,6 +388,7 @@ class DnsConfigServicePosix::HostsReader : public SerialWorker {
   const base::FilePath file_path_hosts_;
   // Written in DoWork, read in OnWorkFinished, no locking necessary.
   DnsHosts hosts_;
+  scoped_refptr<const DnsHostsIndex> hosts_index_;
   bool success_;
 
   DISALLOW_COPY_AND_ASSIGN(HostsReader);
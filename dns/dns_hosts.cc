@@ -4,6 +4,10 @@
 
 #include "net/dns/dns_hosts.h"
 
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
 #include "base/files/file_util.h"
 #include "base/logging.h"
 #include "base/macros.h"
@@ -16,6 +20,9 @@ namespace net {
 
 namespace {
 
+// Reject HOSTS files larger than |kMaxHostsSize| bytes.
+const int64_t kMaxHostsSize = 1 << 25;  // 32MB
+
 // Parses the contents of a hosts file.  Returns one token (IP or hostname) at
 // a time.  Doesn't copy anything; accepts the file as a StringPiece and
 // returns tokens as StringPieces.
@@ -164,6 +171,38 @@ void ParseHostsWithCommaMode(const std::string& contents,
   }
 }
 
+ParseHostsCommaMode GetDefaultCommaMode() {
+#if defined(OS_MACOSX)
+  // Mac OS X allows commas to separate hostnames.
+  return PARSE_HOSTS_COMMA_IS_WHITESPACE;
+#else
+  // Linux allows commas in hostnames.
+  return PARSE_HOSTS_COMMA_IS_TOKEN;
+#endif
+}
+
+// Returns the FNV-1a hash of |name| in lower case.
+uint32_t HashHostname(const StringPiece& name) {
+  uint32_t hash = 2166136261u;
+  for (char c : name) {
+    hash ^= static_cast<uint8_t>(base::ToLowerASCII(c));
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+// Gets the size of the HOSTS file at |path| into |size|. Returns false if it
+// cannot be read or is too large.
+bool GetHostsFileSize(const base::FilePath& path, int64_t* size) {
+  if (!base::GetFileSize(path, size))
+    return false;
+
+  UMA_HISTOGRAM_COUNTS("AsyncDNS.HostsSize",
+                       static_cast<base::HistogramBase::Sample>(*size));
+
+  return *size <= kMaxHostsSize;
+}
+
 }  // namespace
 
 void ParseHostsWithCommaModeForTesting(const std::string& contents,
@@ -173,16 +212,7 @@ void ParseHostsWithCommaModeForTesting(const std::string& contents,
 }
 
 void ParseHosts(const std::string& contents, DnsHosts* dns_hosts) {
-  ParseHostsCommaMode comma_mode;
-#if defined(OS_MACOSX)
-  // Mac OS X allows commas to separate hostnames.
-  comma_mode = PARSE_HOSTS_COMMA_IS_WHITESPACE;
-#else
-  // Linux allows commas in hostnames.
-  comma_mode = PARSE_HOSTS_COMMA_IS_TOKEN;
-#endif
-
-  ParseHostsWithCommaMode(contents, dns_hosts, comma_mode);
+  ParseHostsWithCommaMode(contents, dns_hosts, GetDefaultCommaMode());
 }
 
 bool ParseHostsFile(const base::FilePath& path, DnsHosts* dns_hosts) {
@@ -192,15 +222,7 @@ bool ParseHostsFile(const base::FilePath& path, DnsHosts* dns_hosts) {
     return true;
 
   int64_t size;
-  if (!base::GetFileSize(path, &size))
-    return false;
-
-  UMA_HISTOGRAM_COUNTS("AsyncDNS.HostsSize",
-                       static_cast<base::HistogramBase::Sample>(size));
-
-  // Reject HOSTS files larger than |kMaxHostsSize| bytes.
-  const int64_t kMaxHostsSize = 1 << 25;  // 32MB
-  if (size > kMaxHostsSize)
+  if (!GetHostsFileSize(path, &size))
     return false;
 
   std::string contents;
@@ -211,5 +233,136 @@ bool ParseHostsFile(const base::FilePath& path, DnsHosts* dns_hosts) {
   return true;
 }
 
-}  // namespace net
+// static
+scoped_refptr<DnsHostsIndex> DnsHostsIndex::CreateFromFile(
+    const base::FilePath& path) {
+  scoped_refptr<DnsHostsIndex> index(new DnsHostsIndex());
+  // Missing file indicates empty HOSTS.
+  if (!base::PathExists(path))
+    return index;
+
+  int64_t size;
+  if (!GetHostsFileSize(path, &size))
+    return nullptr;
+
+  // A mapping would fault if the file were truncated while in use, so the
+  // index keeps its own copy.
+  if (!base::ReadFileToString(path, &index->contents_))
+    return nullptr;
+  index->text_ = index->contents_;
+  index->Build(GetDefaultCommaMode());
+  return index;
+}
+
+// static
+scoped_refptr<DnsHostsIndex>
+DnsHostsIndex::CreateFromStringWithCommaModeForTesting(
+    const std::string& contents,
+    ParseHostsCommaMode comma_mode) {
+  scoped_refptr<DnsHostsIndex> index(new DnsHostsIndex());
+  index->contents_ = contents;
+  index->text_ = index->contents_;
+  index->Build(comma_mode);
+  return index;
+}
+
+bool DnsHostsIndex::Lookup(const StringPiece& hostname,
+                           AddressFamily family,
+                           IPAddress* address) const {
+  Entry key;
+  key.hash = HashHostname(hostname);
+  key.family = static_cast<uint8_t>(family);
+  std::vector<Entry>::const_iterator it = std::lower_bound(
+      entries_.begin(), entries_.end(), key,
+      [](const Entry& a, const Entry& b) {
+        return std::tie(a.hash, a.family) < std::tie(b.hash, b.family);
+      });
+  for (; it != entries_.end() && it->hash == key.hash &&
+         it->family == key.family;
+       ++it) {
+    if (base::EqualsCaseInsensitiveASCII(GetName(*it), hostname)) {
+      *address = addresses_[it->address_index];
+      return true;
+    }
+  }
+  return false;
+}
+
+bool DnsHostsIndex::Equals(const DnsHostsIndex& other) const {
+  return this == &other || text_ == other.text_;
+}
+
+DnsHostsIndex::DnsHostsIndex() {}
+
+DnsHostsIndex::~DnsHostsIndex() {}
+
+void DnsHostsIndex::Build(ParseHostsCommaMode comma_mode) {
+  // Same walk as ParseHostsWithCommaMode(), but records where each hostname
+  // is instead of copying it.
+  StringPiece ip_text;
+  HostsParser parser(text_, comma_mode);
+  while (parser.Advance()) {
+    if (parser.token_is_ip()) {
+      StringPiece new_ip_text = parser.token();
+      if (new_ip_text != ip_text) {
+        IPAddress new_ip;
+        if (new_ip.AssignFromIPLiteral(new_ip_text)) {
+          ip_text = new_ip_text;
+          addresses_.push_back(new_ip);
+        } else {
+          parser.SkipRestOfLine();
+        }
+      }
+    } else {
+      const StringPiece& name = parser.token();
+      // Too long to be a hostname, and to fit in an Entry.
+      if (name.size() > std::numeric_limits<uint16_t>::max())
+        continue;
+      DCHECK(!addresses_.empty());
+      Entry entry;
+      entry.hash = HashHostname(name);
+      entry.name_offset = static_cast<uint32_t>(name.data() - text_.data());
+      entry.address_index = static_cast<uint32_t>(addresses_.size() - 1);
+      entry.name_length = static_cast<uint16_t>(name.size());
+      entry.family = static_cast<uint8_t>(addresses_.back().IsIPv4()
+                                              ? ADDRESS_FAMILY_IPV4
+                                              : ADDRESS_FAMILY_IPV6);
+      entries_.push_back(entry);
+    }
+  }
 
+  std::sort(entries_.begin(), entries_.end(),
+            [](const Entry& a, const Entry& b) {
+              return std::tie(a.hash, a.family, a.name_offset) <
+                     std::tie(b.hash, b.family, b.name_offset);
+            });
+
+  // Drop all but the first hit for each name. Entries with the same hash and
+  // family are adjacent and in file order, and such groups are small.
+  size_t kept = 0;
+  // First kept entry with the hash and family of the current one.
+  size_t group_begin = 0;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    const Entry& entry = entries_[i];
+    if (kept == 0 || entry.hash != entries_[kept - 1].hash ||
+        entry.family != entries_[kept - 1].family) {
+      group_begin = kept;
+    }
+    bool duplicate = false;
+    for (size_t j = group_begin; j < kept && !duplicate; ++j) {
+      duplicate = base::EqualsCaseInsensitiveASCII(GetName(entries_[j]),
+                                                   GetName(entry));
+    }
+    if (!duplicate)
+      entries_[kept++] = entry;
+  }
+  entries_.resize(kept);
+  entries_.shrink_to_fit();
+  addresses_.shrink_to_fit();
+}
+
+StringPiece DnsHostsIndex::GetName(const Entry& entry) const {
+  return text_.substr(entry.name_offset, entry.name_length);
+}
+
+}  // namespace net
@@ -4,6 +4,8 @@
 
 #include "net/dns/dns_hosts.h"
 
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
 #include "net/base/ip_address.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -176,6 +178,87 @@ TEST(DnsHostsTest, HostsParser_EndsWithNewlineAndToken) {
   EXPECT_EQ(1u, hosts.size());
 }
 
+// The index answers the same lookups as the map built by ParseHosts.
+TEST(DnsHostsTest, IndexMatchesParseHosts) {
+  const std::string kContents =
+      "127.0.0.1       localhost\tlocalhost.localdomain # standard\n"
+      "1.0.0.1 localhost # ignored, first hit above\n"
+      "1.0.0.300 company # ignored, malformed IPv4\n"
+      "1.0.0.1\t CoMpANy # normalized to 'company' \n"
+      "::1\tlocalhost ip6-localhost # comment\n"
+      "2048::1 company COMPANY # both ignored for IPv6 after the first\n"
+      "2048::2 company\n"
+      "0.0.0.0 ads1 ads2 ads3\n"
+      "0.0.0.0 ads4 # should reuse parsed IP\n"
+      "0.0.0.0 ADS1 # ignored, first hit above\n"
+      "gibberish";
+
+  DnsHosts hosts;
+  ParseHostsWithCommaModeForTesting(kContents, &hosts,
+                                    PARSE_HOSTS_COMMA_IS_TOKEN);
+  scoped_refptr<DnsHostsIndex> index =
+      DnsHostsIndex::CreateFromStringWithCommaModeForTesting(
+          kContents, PARSE_HOSTS_COMMA_IS_TOKEN);
+  EXPECT_EQ(hosts.size(), index->size());
+
+  for (const auto& entry : hosts) {
+    IPAddress address;
+    EXPECT_TRUE(index->Lookup(entry.first.first, entry.first.second, &address))
+        << entry.first.first;
+    EXPECT_EQ(entry.second, address) << entry.first.first;
+  }
+
+  IPAddress address;
+  EXPECT_TRUE(index->Lookup("LocalHost", ADDRESS_FAMILY_IPV4, &address));
+  EXPECT_EQ(IPAddress::IPv4Localhost(), address);
+  EXPECT_TRUE(index->Lookup("company", ADDRESS_FAMILY_IPV6, &address));
+  EXPECT_EQ("2048::1", address.ToString());
+  EXPECT_FALSE(index->Lookup("ip6-localhost", ADDRESS_FAMILY_IPV4, &address));
+  EXPECT_FALSE(index->Lookup("gibberish", ADDRESS_FAMILY_IPV4, &address));
+  EXPECT_FALSE(index->Lookup("ads", ADDRESS_FAMILY_IPV4, &address));
+}
+
+TEST(DnsHostsTest, IndexFromFile) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath path = temp_dir.path().AppendASCII("hosts");
+
+  // Missing file indicates empty HOSTS.
+  scoped_refptr<DnsHostsIndex> missing = DnsHostsIndex::CreateFromFile(path);
+  ASSERT_TRUE(missing);
+  EXPECT_EQ(0u, missing->size());
+
+  const std::string kContents = "127.0.0.1 localhost\n::1 localhost\n";
+  ASSERT_EQ(static_cast<int>(kContents.size()),
+            base::WriteFile(path, kContents.data(), kContents.size()));
+  scoped_refptr<DnsHostsIndex> index = DnsHostsIndex::CreateFromFile(path);
+  ASSERT_TRUE(index);
+  EXPECT_EQ(2u, index->size());
+  IPAddress address;
+  EXPECT_TRUE(index->Lookup("localhost", ADDRESS_FAMILY_IPV6, &address));
+  EXPECT_EQ(IPAddress::IPv6Localhost(), address);
+
+  EXPECT_FALSE(index->Equals(*missing));
+  EXPECT_TRUE(index->Equals(*DnsHostsIndex::CreateFromFile(path)));
+
+  // Rewriting the file in place leaves the index as it was, and is detected.
+  const std::string kNewContents = "127.0.0.2 localhost
+::2 localhost
+";
+  ASSERT_EQ(kContents.size(), kNewContents.size());
+  ASSERT_EQ(static_cast<int>(kNewContents.size()),
+            base::WriteFile(path, kNewContents.data(), kNewContents.size()));
+  EXPECT_TRUE(index->Lookup("localhost", ADDRESS_FAMILY_IPV6, &address));
+  EXPECT_EQ(IPAddress::IPv6Localhost(), address);
+  EXPECT_FALSE(index->Equals(*DnsHostsIndex::CreateFromFile(path)));
+
+  // So is truncating it.
+  ASSERT_EQ(0, base::WriteFile(path, "", 0));
+  EXPECT_TRUE(index->Lookup("localhost", ADDRESS_FAMILY_IPV4, &address));
+  EXPECT_EQ(IPAddress::IPv4Localhost(), address);
+  EXPECT_FALSE(index->Equals(*DnsHostsIndex::CreateFromFile(path)));
+}
+
 }  // namespace
 
 }  // namespace net
@@ -0,0 +1,388 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/dns/dns_pipelined_socket.h"
+
+#include <string.h>
+
+#include <deque>
+#include <utility>
+
+#include "base/big_endian.h"
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/single_thread_task_runner.h"
+#include "base/threading/thread_task_runner_handle.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/dns/dns_protocol.h"
+#include "net/dns/dns_query.h"
+#include "net/dns/dns_response.h"
+#include "net/socket/stream_socket.h"
+#include "net/udp/datagram_client_socket.h"
+
+namespace net {
+
+namespace {
+
+class DnsPipelinedUDPSocket : public DnsPipelinedSocket {
+ public:
+  explicit DnsPipelinedUDPSocket(std::unique_ptr<DatagramClientSocket> socket)
+      : socket_(std::move(socket)),
+        write_pending_(false),
+        read_pending_(false) {}
+
+  ~DnsPipelinedUDPSocket() override {}
+
+  const BoundNetLog& NetLog() const override { return socket_->NetLog(); }
+
+ private:
+  void WriteQuery(const DnsQuery* query) override {
+    write_queue_.push_back(query->io_buffer());
+    if (!write_pending_)
+      DoWriteLoop();
+  }
+
+  void DoWriteLoop() {
+    while (!write_queue_.empty() && !is_broken()) {
+      int rv = socket_->Write(
+          write_queue_.front().get(), write_queue_.front()->size(),
+          base::Bind(&DnsPipelinedUDPSocket::OnWriteComplete,
+                     base::Unretained(this)));
+      if (rv == ERR_IO_PENDING) {
+        write_pending_ = true;
+        return;
+      }
+      HandleWriteResult(rv);
+    }
+  }
+
+  void OnWriteComplete(int rv) {
+    write_pending_ = false;
+    HandleWriteResult(rv);
+    DoWriteLoop();
+  }
+
+  void HandleWriteResult(int rv) {
+    // Writing to UDP should not result in a partial datagram.
+    if (rv >= 0 && rv != write_queue_.front()->size())
+      rv = ERR_MSG_TOO_BIG;
+    write_queue_.pop_front();
+    if (rv < 0)
+      Fail(rv);
+  }
+
+  void DoReadLoop() override {
+    while (!read_pending_ && !is_broken()) {
+      response_.reset(new DnsResponse());
+      int rv = socket_->Read(
+          response_->io_buffer(), response_->io_buffer()->size(),
+          base::Bind(&DnsPipelinedUDPSocket::OnReadComplete,
+                     base::Unretained(this)));
+      if (rv == ERR_IO_PENDING) {
+        read_pending_ = true;
+        return;
+      }
+      if (!HandleReadResult(rv))
+        return;
+    }
+  }
+
+  void OnReadComplete(int rv) {
+    read_pending_ = false;
+    if (HandleReadResult(rv))
+      DoReadLoop();
+  }
+
+  // Returns false if reading should stop.
+  bool HandleReadResult(int rv) {
+    if (rv < 0) {
+      Fail(rv);
+      return false;
+    }
+    return DispatchResponse(std::move(response_), rv);
+  }
+
+  std::unique_ptr<DatagramClientSocket> socket_;
+
+  std::deque<scoped_refptr<IOBufferWithSize>> write_queue_;
+  bool write_pending_;
+
+  std::unique_ptr<DnsResponse> response_;
+  bool read_pending_;
+
+  DISALLOW_COPY_AND_ASSIGN(DnsPipelinedUDPSocket);
+};
+
+class DnsPipelinedTCPSocket : public DnsPipelinedSocket {
+ public:
+  explicit DnsPipelinedTCPSocket(std::unique_ptr<StreamSocket> socket)
+      : socket_(std::move(socket)),
+        connect_state_(NOT_CONNECTED),
+        write_pending_(false),
+        read_pending_(false),
+        length_buffer_(new IOBufferWithSize(sizeof(uint16_t))),
+        response_length_(0) {}
+
+  ~DnsPipelinedTCPSocket() override {}
+
+  const BoundNetLog& NetLog() const override { return socket_->NetLog(); }
+
+ private:
+  enum ConnectState {
+    NOT_CONNECTED,
+    CONNECTING,
+    CONNECTED,
+  };
+
+  void WriteQuery(const DnsQuery* query) override {
+    // Each query is prefixed with its length, and written in one piece.
+    int query_size = query->io_buffer()->size();
+    scoped_refptr<IOBufferWithSize> buffer(
+        new IOBufferWithSize(sizeof(uint16_t) + query_size));
+    base::WriteBigEndian<uint16_t>(buffer->data(),
+                                   static_cast<uint16_t>(query_size));
+    memcpy(buffer->data() + sizeof(uint16_t), query->io_buffer()->data(),
+           query_size);
+    write_queue_.push_back(
+        new DrainableIOBuffer(buffer.get(), buffer->size()));
+
+    if (connect_state_ == NOT_CONNECTED) {
+      connect_state_ = CONNECTING;
+      int rv = socket_->Connect(base::Bind(
+          &DnsPipelinedTCPSocket::OnConnectComplete, base::Unretained(this)));
+      if (rv != ERR_IO_PENDING)
+        HandleConnectResult(rv);
+    } else if (connect_state_ == CONNECTED && !write_pending_) {
+      DoWriteLoop();
+    }
+  }
+
+  void OnConnectComplete(int rv) {
+    HandleConnectResult(rv);
+    DoReadLoop();
+  }
+
+  void HandleConnectResult(int rv) {
+    if (rv < 0) {
+      Fail(rv);
+      return;
+    }
+    connect_state_ = CONNECTED;
+    DoWriteLoop();
+  }
+
+  void DoWriteLoop() {
+    while (!write_queue_.empty() && !is_broken()) {
+      DrainableIOBuffer* buffer = write_queue_.front().get();
+      int rv = socket_->Write(
+          buffer, buffer->BytesRemaining(),
+          base::Bind(&DnsPipelinedTCPSocket::OnWriteComplete,
+                     base::Unretained(this)));
+      if (rv == ERR_IO_PENDING) {
+        write_pending_ = true;
+        return;
+      }
+      HandleWriteResult(rv);
+    }
+  }
+
+  void OnWriteComplete(int rv) {
+    write_pending_ = false;
+    HandleWriteResult(rv);
+    DoWriteLoop();
+  }
+
+  void HandleWriteResult(int rv) {
+    if (rv < 0) {
+      Fail(rv);
+      return;
+    }
+    write_queue_.front()->DidConsume(rv);
+    if (write_queue_.front()->BytesRemaining() == 0)
+      write_queue_.pop_front();
+  }
+
+  // Reads a length, then a response of that length, and repeats.
+  void DoReadLoop() override {
+    // Reading starts once connected.
+    if (connect_state_ != CONNECTED)
+      return;
+    while (!read_pending_ && !is_broken()) {
+      if (!read_buffer_) {
+        read_buffer_ =
+            new DrainableIOBuffer(length_buffer_.get(), length_buffer_->size());
+      }
+      int rv = socket_->Read(
+          read_buffer_.get(), read_buffer_->BytesRemaining(),
+          base::Bind(&DnsPipelinedTCPSocket::OnReadComplete,
+                     base::Unretained(this)));
+      if (rv == ERR_IO_PENDING) {
+        read_pending_ = true;
+        return;
+      }
+      if (!HandleReadResult(rv))
+        return;
+    }
+  }
+
+  void OnReadComplete(int rv) {
+    read_pending_ = false;
+    if (HandleReadResult(rv))
+      DoReadLoop();
+  }
+
+  // Returns false if reading should stop.
+  bool HandleReadResult(int rv) {
+    if (rv < 0) {
+      Fail(rv);
+      return false;
+    }
+    // Servers close idle connections, which is only an error if queries are
+    // still waiting on it.
+    if (rv == 0) {
+      Fail(ERR_CONNECTION_CLOSED);
+      return false;
+    }
+
+    read_buffer_->DidConsume(rv);
+    if (read_buffer_->BytesRemaining() > 0)
+      return true;
+
+    if (!response_) {
+      base::ReadBigEndian<uint16_t>(length_buffer_->data(), &response_length_);
+      if (response_length_ < sizeof(dns_protocol::Header)) {
+        Fail(ERR_DNS_MALFORMED_RESPONSE);
+        return false;
+      }
+      // Allocate more space so that DnsResponse::InitParse sanity check
+      // passes.
+      response_.reset(new DnsResponse(response_length_ + 1));
+      read_buffer_ =
+          new DrainableIOBuffer(response_->io_buffer(), response_length_);
+      return true;
+    }
+
+    read_buffer_ = nullptr;
+    return DispatchResponse(std::move(response_), response_length_);
+  }
+
+  std::unique_ptr<StreamSocket> socket_;
+  ConnectState connect_state_;
+
+  std::deque<scoped_refptr<DrainableIOBuffer>> write_queue_;
+  bool write_pending_;
+
+  bool read_pending_;
+  scoped_refptr<IOBufferWithSize> length_buffer_;
+  // Points into |length_buffer_| while reading a length, and into |response_|
+  // while reading a response.
+  scoped_refptr<DrainableIOBuffer> read_buffer_;
+  uint16_t response_length_;
+  std::unique_ptr<DnsResponse> response_;
+
+  DISALLOW_COPY_AND_ASSIGN(DnsPipelinedTCPSocket);
+};
+
+}  // namespace
+
+DnsPipelinedSocket::DnsPipelinedSocket()
+    : error_(OK), reading_(false), weak_factory_(this) {}
+
+DnsPipelinedSocket::~DnsPipelinedSocket() {}
+
+// static
+std::unique_ptr<DnsPipelinedSocket> DnsPipelinedSocket::CreateUDP(
+    std::unique_ptr<DatagramClientSocket> socket) {
+  return std::unique_ptr<DnsPipelinedSocket>(
+      new DnsPipelinedUDPSocket(std::move(socket)));
+}
+
+// static
+std::unique_ptr<DnsPipelinedSocket> DnsPipelinedSocket::CreateTCP(
+    std::unique_ptr<StreamSocket> socket) {
+  return std::unique_ptr<DnsPipelinedSocket>(
+      new DnsPipelinedTCPSocket(std::move(socket)));
+}
+
+int DnsPipelinedSocket::SendQuery(const DnsQuery* query,
+                                  const ResponseCallback& callback) {
+  DCHECK(query);
+  DCHECK(!callback.is_null());
+  DCHECK(!IsQueryIdInUse(query->id()));
+  if (is_broken())
+    return error_;
+
+  PendingQuery& pending = pending_queries_[query->id()];
+  pending.query = query;
+  pending.callback = callback;
+  WriteQuery(query);
+
+  // Reading starts from a posted task, so that a synchronous read cannot run
+  // |callback| from within this call.
+  if (!reading_) {
+    reading_ = true;
+    base::ThreadTaskRunnerHandle::Get()->PostTask(
+        FROM_HERE,
+        base::Bind(&DnsPipelinedSocket::DoReadLoop, AsWeakPtr()));
+  }
+  return ERR_IO_PENDING;
+}
+
+void DnsPipelinedSocket::CancelQuery(uint16_t id) {
+  pending_queries_.erase(id);
+}
+
+bool DnsPipelinedSocket::IsQueryIdInUse(uint16_t id) const {
+  return pending_queries_.find(id) != pending_queries_.end();
+}
+
+bool DnsPipelinedSocket::DispatchResponse(
+    std::unique_ptr<DnsResponse> response,
+    int size) {
+  if (size < static_cast<int>(sizeof(dns_protocol::Header)))
+    return true;
+
+  uint16_t id;
+  base::ReadBigEndian<uint16_t>(response->io_buffer()->data(), &id);
+  auto it = pending_queries_.find(id);
+  // Either a late response to a cancelled query, or a spoofing attempt.
+  if (it == pending_queries_.end())
+    return true;
+  if (!response->InitParse(size, *it->second.query))
+    return true;
+
+  ResponseCallback callback = it->second.callback;
+  pending_queries_.erase(it);
+
+  base::WeakPtr<DnsPipelinedSocket> self = AsWeakPtr();
+  callback.Run(OK, std::move(response));
+  return !!self;
+}
+
+void DnsPipelinedSocket::Fail(int error) {
+  DCHECK_NE(OK, error);
+  if (is_broken())
+    return;
+  error_ = error;
+  // Even when the socket fails from within SendQuery(), callbacks must run
+  // asynchronously.
+  base::ThreadTaskRunnerHandle::Get()->PostTask(
+      FROM_HERE,
+      base::Bind(&DnsPipelinedSocket::FailPendingQueries, AsWeakPtr()));
+}
+
+void DnsPipelinedSocket::FailPendingQueries() {
+  base::WeakPtr<DnsPipelinedSocket> self = AsWeakPtr();
+  while (!pending_queries_.empty()) {
+    ResponseCallback callback = pending_queries_.begin()->second.callback;
+    pending_queries_.erase(pending_queries_.begin());
+    callback.Run(error_, std::unique_ptr<DnsResponse>());
+    if (!self)
+      return;
+  }
+}
+
+}  // namespace net
@@ -0,0 +1,120 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_DNS_DNS_PIPELINED_SOCKET_H_
+#define NET_DNS_DNS_PIPELINED_SOCKET_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+
+#include "base/callback.h"
+#include "base/macros.h"
+#include "base/memory/weak_ptr.h"
+#include "net/base/net_export.h"
+#include "net/log/net_log.h"
+
+namespace net {
+
+class DatagramClientSocket;
+class DnsQuery;
+class DnsResponse;
+class StreamSocket;
+
+// Carries many outstanding queries to a single nameserver over one long-lived
+// socket, and routes each response to its query by ID. Over UDP the queries
+// share one source port; over TCP they are pipelined on one connection and the
+// server may answer them out of order, as RFC 7766 allows.
+//
+// Once the socket fails, every outstanding query is failed with the error and
+// no new queries are accepted. Owners are expected to replace it.
+class NET_EXPORT_PRIVATE DnsPipelinedSocket {
+ public:
+  // Runs with OK and a response that matches the query, or with a network
+  // error and a null response. Only the header and question are checked; the
+  // RCODE and flags are left to the caller.
+  typedef base::Callback<void(int, std::unique_ptr<DnsResponse>)>
+      ResponseCallback;
+
+  virtual ~DnsPipelinedSocket();
+
+  // Creates a pipelined socket over |socket|, which must already be connected
+  // to the nameserver.
+  static std::unique_ptr<DnsPipelinedSocket> CreateUDP(
+      std::unique_ptr<DatagramClientSocket> socket);
+
+  // Creates a pipelined socket over |socket|, which must not be connected yet.
+  // It is connected when the first query is sent.
+  static std::unique_ptr<DnsPipelinedSocket> CreateTCP(
+      std::unique_ptr<StreamSocket> socket);
+
+  // Sends |query| and returns ERR_IO_PENDING, then runs |callback| when the
+  // matching response arrives or the socket fails. |callback| never runs from
+  // within SendQuery(). Returns the error instead if the socket has already
+  // failed. |query| must stay alive until |callback| runs or CancelQuery() is
+  // called, and its ID must not be in use.
+  int SendQuery(const DnsQuery* query, const ResponseCallback& callback);
+
+  // Forgets the query with |id| without running its callback. A response that
+  // arrives for it later is dropped.
+  void CancelQuery(uint16_t id);
+
+  bool IsQueryIdInUse(uint16_t id) const;
+
+  size_t num_pending_queries() const { return pending_queries_.size(); }
+
+  // True once the socket has failed.
+  bool is_broken() const { return error_ != OK; }
+
+  virtual const BoundNetLog& NetLog() const = 0;
+
+  base::WeakPtr<DnsPipelinedSocket> AsWeakPtr() {
+    return weak_factory_.GetWeakPtr();
+  }
+
+ protected:
+  DnsPipelinedSocket();
+
+  // Writes |query| to the socket, after any queries still being written.
+  virtual void WriteQuery(const DnsQuery* query) = 0;
+
+  // Reads and dispatches responses until a read is pending or the socket
+  // fails. Called once, after the first query has been written, and is then
+  // expected to keep a read pending for as long as the socket lives.
+  virtual void DoReadLoop() = 0;
+
+  // Matches |response|, into which |size| bytes have been read, to its query
+  // and runs the query's callback. Unexpected and mismatched responses are
+  // dropped. Returns false if the callback destroyed this socket.
+  bool DispatchResponse(std::unique_ptr<DnsResponse> response, int size);
+
+  // Breaks the socket with |error|. The outstanding queries are failed from a
+  // posted task.
+  void Fail(int error);
+
+ private:
+  struct PendingQuery {
+    const DnsQuery* query;
+    ResponseCallback callback;
+  };
+
+  void FailPendingQueries();
+
+  std::map<uint16_t, PendingQuery> pending_queries_;
+
+  // OK until the socket fails.
+  int error_;
+
+  bool reading_;
+
+  base::WeakPtrFactory<DnsPipelinedSocket> weak_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(DnsPipelinedSocket);
+};
+
+}  // namespace net
+
+#endif  // NET_DNS_DNS_PIPELINED_SOCKET_H_
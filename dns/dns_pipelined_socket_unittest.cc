@@ -0,0 +1,252 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/dns/dns_pipelined_socket.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/macros.h"
+#include "base/run_loop.h"
+#include "base/sys_byteorder.h"
+#include "net/base/address_list.h"
+#include "net/base/net_errors.h"
+#include "net/dns/dns_protocol.h"
+#include "net/dns/dns_query.h"
+#include "net/dns/dns_response.h"
+#include "net/dns/dns_util.h"
+#include "net/socket/socket_test_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+std::unique_ptr<DnsQuery> MakeQuery(uint16_t id, const char* dotted_name) {
+  std::string qname;
+  EXPECT_TRUE(DNSDomainFromDot(dotted_name, &qname));
+  return std::unique_ptr<DnsQuery>(
+      new DnsQuery(id, qname, dns_protocol::kTypeA));
+}
+
+// Returns a response to |query| with no answers.
+std::string MakeResponse(const DnsQuery& query) {
+  std::string response(query.io_buffer()->data(), query.io_buffer()->size());
+  dns_protocol::Header* header =
+      reinterpret_cast<dns_protocol::Header*>(&response[0]);
+  header->flags |= base::HostToNet16(dns_protocol::kFlagResponse);
+  return response;
+}
+
+// Returns |message| prefixed with its length, as sent over TCP.
+std::string WithLength(const std::string& message) {
+  uint16_t length = base::HostToNet16(static_cast<uint16_t>(message.size()));
+  return std::string(reinterpret_cast<const char*>(&length), sizeof(length)) +
+         message;
+}
+
+std::string QueryData(const DnsQuery& query) {
+  return std::string(query.io_buffer()->data(), query.io_buffer()->size());
+}
+
+class DnsPipelinedSocketTest : public testing::Test {
+ protected:
+  DnsPipelinedSocketTest()
+      : query1_(MakeQuery(1, "one.test")),
+        query2_(MakeQuery(2, "two.test")),
+        response1_(MakeResponse(*query1_)),
+        response2_(MakeResponse(*query2_)) {}
+
+  void CreateUDPSocket(MockRead* reads,
+                       size_t reads_count,
+                       MockWrite* writes,
+                       size_t writes_count) {
+    data_.reset(
+        new SequencedSocketData(reads, reads_count, writes, writes_count));
+    std::unique_ptr<DatagramClientSocket> udp_socket(
+        new MockUDPClientSocket(data_.get(), nullptr));
+    EXPECT_EQ(OK, udp_socket->Connect(IPEndPoint()));
+    socket_ = DnsPipelinedSocket::CreateUDP(std::move(udp_socket));
+  }
+
+  void CreateTCPSocket(MockRead* reads,
+                       size_t reads_count,
+                       MockWrite* writes,
+                       size_t writes_count) {
+    data_.reset(
+        new SequencedSocketData(reads, reads_count, writes, writes_count));
+    data_->set_connect_data(MockConnect(SYNCHRONOUS, OK));
+    socket_ = DnsPipelinedSocket::CreateTCP(std::unique_ptr<StreamSocket>(
+        new MockTCPClientSocket(AddressList(), nullptr, data_.get())));
+  }
+
+  int SendQuery(const DnsQuery* query) {
+    return socket_->SendQuery(
+        query, base::Bind(&DnsPipelinedSocketTest::OnResponse,
+                          base::Unretained(this), query->id()));
+  }
+
+  void OnResponse(uint16_t id, int rv, std::unique_ptr<DnsResponse> response) {
+    EXPECT_EQ(rv == OK, !!response);
+    if (response)
+      EXPECT_EQ(id, response->id());
+    completed_ids_.push_back(id);
+    results_.push_back(rv);
+  }
+
+  std::unique_ptr<DnsQuery> query1_;
+  std::unique_ptr<DnsQuery> query2_;
+  std::string response1_;
+  std::string response2_;
+
+  std::unique_ptr<SequencedSocketData> data_;
+  std::unique_ptr<DnsPipelinedSocket> socket_;
+
+  // The ID of each query whose callback ran, and its result, in order.
+  std::vector<uint16_t> completed_ids_;
+  std::vector<int> results_;
+};
+
+TEST_F(DnsPipelinedSocketTest, UDPResponsesOutOfOrder) {
+  const std::string query1 = QueryData(*query1_);
+  const std::string query2 = QueryData(*query2_);
+  MockWrite writes[] = {
+      MockWrite(ASYNC, query1.data(), query1.size(), 0),
+      MockWrite(ASYNC, query2.data(), query2.size(), 1),
+  };
+  MockRead reads[] = {
+      MockRead(ASYNC, response2_.data(), response2_.size(), 2),
+      MockRead(ASYNC, response1_.data(), response1_.size(), 3),
+      MockRead(SYNCHRONOUS, ERR_IO_PENDING, 4),
+  };
+  CreateUDPSocket(reads, arraysize(reads), writes, arraysize(writes));
+
+  EXPECT_EQ(ERR_IO_PENDING, SendQuery(query1_.get()));
+  EXPECT_EQ(ERR_IO_PENDING, SendQuery(query2_.get()));
+  EXPECT_EQ(2u, socket_->num_pending_queries());
+  EXPECT_TRUE(socket_->IsQueryIdInUse(1));
+  // Callbacks never run synchronously.
+  EXPECT_TRUE(completed_ids_.empty());
+
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(std::vector<uint16_t>({2, 1}), completed_ids_);
+  EXPECT_EQ(std::vector<int>({OK, OK}), results_);
+  EXPECT_EQ(0u, socket_->num_pending_queries());
+  EXPECT_FALSE(socket_->is_broken());
+  EXPECT_TRUE(data_->AllWriteDataConsumed());
+  EXPECT_TRUE(data_->AllReadDataConsumed());
+}
+
+// Responses to unknown or cancelled queries are dropped, and the socket keeps
+// waiting for the others.
+TEST_F(DnsPipelinedSocketTest, UDPDropsUnexpectedResponses) {
+  const std::string query1 = QueryData(*query1_);
+  const std::string query2 = QueryData(*query2_);
+  std::unique_ptr<DnsQuery> unknown_query = MakeQuery(3, "three.test");
+  const std::string unknown_response = MakeResponse(*unknown_query);
+  MockWrite writes[] = {
+      MockWrite(SYNCHRONOUS, query1.data(), query1.size(), 0),
+      MockWrite(SYNCHRONOUS, query2.data(), query2.size(), 1),
+  };
+  MockRead reads[] = {
+      MockRead(ASYNC, unknown_response.data(), unknown_response.size(), 2),
+      MockRead(ASYNC, response1_.data(), response1_.size(), 3),
+      MockRead(ASYNC, response2_.data(), response2_.size(), 4),
+      MockRead(SYNCHRONOUS, ERR_IO_PENDING, 5),
+  };
+  CreateUDPSocket(reads, arraysize(reads), writes, arraysize(writes));
+
+  EXPECT_EQ(ERR_IO_PENDING, SendQuery(query1_.get()));
+  EXPECT_EQ(ERR_IO_PENDING, SendQuery(query2_.get()));
+  socket_->CancelQuery(1);
+  EXPECT_FALSE(socket_->IsQueryIdInUse(1));
+
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(std::vector<uint16_t>({2}), completed_ids_);
+  EXPECT_FALSE(socket_->is_broken());
+  EXPECT_TRUE(data_->AllReadDataConsumed());
+}
+
+TEST_F(DnsPipelinedSocketTest, UDPReadErrorFailsAllQueries) {
+  const std::string query1 = QueryData(*query1_);
+  const std::string query2 = QueryData(*query2_);
+  MockWrite writes[] = {
+      MockWrite(SYNCHRONOUS, query1.data(), query1.size(), 0),
+      MockWrite(SYNCHRONOUS, query2.data(), query2.size(), 1),
+  };
+  MockRead reads[] = {
+      MockRead(ASYNC, ERR_CONNECTION_REFUSED, 2),
+  };
+  CreateUDPSocket(reads, arraysize(reads), writes, arraysize(writes));
+
+  EXPECT_EQ(ERR_IO_PENDING, SendQuery(query1_.get()));
+  EXPECT_EQ(ERR_IO_PENDING, SendQuery(query2_.get()));
+
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(2u, completed_ids_.size());
+  EXPECT_EQ(std::vector<int>({ERR_CONNECTION_REFUSED, ERR_CONNECTION_REFUSED}),
+            results_);
+  EXPECT_TRUE(socket_->is_broken());
+
+  std::unique_ptr<DnsQuery> query3 = MakeQuery(3, "three.test");
+  EXPECT_EQ(ERR_CONNECTION_REFUSED, SendQuery(query3.get()));
+}
+
+// Queries are pipelined on one TCP connection, and answered out of order.
+TEST_F(DnsPipelinedSocketTest, TCPPipelined) {
+  const std::string query1 = WithLength(QueryData(*query1_));
+  const std::string query2 = WithLength(QueryData(*query2_));
+  uint16_t length1 = base::HostToNet16(response1_.size());
+  uint16_t length2 = base::HostToNet16(response2_.size());
+  MockWrite writes[] = {
+      MockWrite(ASYNC, query1.data(), query1.size(), 0),
+      MockWrite(ASYNC, query2.data(), query2.size(), 1),
+  };
+  MockRead reads[] = {
+      MockRead(ASYNC, reinterpret_cast<const char*>(&length2), sizeof(length2),
+               2),
+      MockRead(ASYNC, response2_.data(), response2_.size(), 3),
+      MockRead(ASYNC, reinterpret_cast<const char*>(&length1), sizeof(length1),
+               4),
+      MockRead(ASYNC, response1_.data(), response1_.size(), 5),
+      MockRead(SYNCHRONOUS, ERR_IO_PENDING, 6),
+  };
+  CreateTCPSocket(reads, arraysize(reads), writes, arraysize(writes));
+
+  EXPECT_EQ(ERR_IO_PENDING, SendQuery(query1_.get()));
+  EXPECT_EQ(ERR_IO_PENDING, SendQuery(query2_.get()));
+
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(std::vector<uint16_t>({2, 1}), completed_ids_);
+  EXPECT_EQ(std::vector<int>({OK, OK}), results_);
+  EXPECT_FALSE(socket_->is_broken());
+  EXPECT_TRUE(data_->AllWriteDataConsumed());
+  EXPECT_TRUE(data_->AllReadDataConsumed());
+}
+
+TEST_F(DnsPipelinedSocketTest, TCPConnectionClosed) {
+  const std::string query1 = WithLength(QueryData(*query1_));
+  MockWrite writes[] = {
+      MockWrite(SYNCHRONOUS, query1.data(), query1.size(), 0),
+  };
+  MockRead reads[] = {
+      MockRead(ASYNC, OK, 1),
+  };
+  CreateTCPSocket(reads, arraysize(reads), writes, arraysize(writes));
+
+  EXPECT_EQ(ERR_IO_PENDING, SendQuery(query1_.get()));
+
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(std::vector<int>({ERR_CONNECTION_CLOSED}), results_);
+  EXPECT_TRUE(socket_->is_broken());
+}
+
+}  // namespace
+
+}  // namespace net
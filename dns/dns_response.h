@@ -38,6 +38,17 @@ struct NET_EXPORT_PRIVATE DnsResourceRecord {
   base::StringPiece rdata;  // points to the original response buffer
 };
 
+// Resource record that borrows its owner name from the response buffer rather
+// than copying it, so that reading one does not allocate. Valid only for as
+// long as the buffer.
+struct NET_EXPORT_PRIVATE DnsResourceRecordView {
+  const char* name;  // in wire format, possibly compressed
+  uint16_t type;
+  uint16_t klass;
+  uint32_t ttl;
+  base::StringPiece rdata;  // points to the original response buffer
+};
+
 // Iterator to walk over resource records of the DNS response packet.
 class NET_EXPORT_PRIVATE DnsRecordParser {
  public:
@@ -66,13 +77,47 @@ class NET_EXPORT_PRIVATE DnsRecordParser {
   // See RFC 1035 section 4.1.4.
   unsigned ReadName(const void* pos, std::string* out) const;
 
+  // Like ReadName, but only checks that the whole name is well-formed, without
+  // copying it.
+  unsigned SkipName(const void* pos) const;
+
+  // Returns true if the (possibly compressed) DNS names starting at |pos1| and
+  // |pos2| are both well-formed and equal, ignoring ASCII case. The names are
+  // compared in place, following compression pointers, without copying them.
+  bool NameEquals(const void* pos1, const void* pos2) const;
+
   // Parses the next resource record into |record|. Returns true if succeeded.
   bool ReadRecord(DnsResourceRecord* record);
 
+  // Like ReadRecord, but leaves the owner name in the packet.
+  bool ReadRecordView(DnsResourceRecordView* record);
+
   // Skip a question section, returns true if succeeded.
   bool SkipQuestion();
 
  private:
+  // Same as ReadName, except that the name is validated past the first
+  // compression pointer if |read_whole_name| is true, even if |out| is NULL.
+  unsigned ReadNameInternal(const char* pos,
+                            std::string* out,
+                            bool read_whole_name) const;
+
+  // Reads the label at |*pos|, following any compression pointers, and
+  // advances |*pos| past it. |*seen| counts the bytes visited so far, to
+  // detect loops. An empty |label| marks the end of the name. Returns false
+  // if the name is malformed.
+  bool ReadLabel(const char** pos,
+                 unsigned* seen,
+                 base::StringPiece* label) const;
+
+  // Reads the fixed-size fields and RDATA of the record whose owner name ends
+  // at |pos|.
+  bool ReadRecordFields(const char* pos,
+                        uint16_t* type,
+                        uint16_t* klass,
+                        uint32_t* ttl,
+                        base::StringPiece* rdata);
+
   const char* packet_;
   size_t length_;
   // Current offset within the packet.
@@ -149,7 +194,10 @@ class NET_EXPORT_PRIVATE DnsResponse {
   DnsRecordParser Parser() const;
 
   // Extracts an AddressList from this response. Returns SUCCESS if succeeded.
-  // Otherwise returns a detailed error number.
+  // Otherwise returns a detailed error number, and leaves |addr_list| in an
+  // unspecified state. Owner names are compared in the response buffer, and
+  // the addresses are appended to |addr_list| as they are read, so the only
+  // name copied is the canonical name.
   Result ParseToAddressList(AddressList* addr_list, base::TimeDelta* ttl) const;
 
  private:
@@ -0,0 +1,92 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+
+#include "base/macros.h"
+#include "base/test/perf_log.h"
+#include "base/time/time.h"
+#include "net/base/address_list.h"
+#include "net/dns/dns_response.h"
+#include "net/dns/dns_test_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const int kNumIterations = 1000000;
+
+// The responses from dns_test_util.h, which are also used by
+// dns_response_unittest.cc and tools/dns_fuzz_stub.
+struct TestResponse {
+  size_t query_size;
+  const uint8_t* data;
+  size_t size;
+  unsigned num_records;
+} const kResponses[] = {
+    {kT0QuerySize, kT0ResponseDatagram, arraysize(kT0ResponseDatagram),
+     kT0RecordCount},
+    {kT1QuerySize, kT1ResponseDatagram, arraysize(kT1ResponseDatagram),
+     kT1RecordCount},
+    {kT2QuerySize, kT2ResponseDatagram, arraysize(kT2ResponseDatagram),
+     kT2RecordCount},
+    {kT3QuerySize, kT3ResponseDatagram, arraysize(kT3ResponseDatagram),
+     kT3RecordCount},
+};
+
+void LogNanosecondsPerResponse(const char* name, base::TimeDelta elapsed) {
+  const double num_responses = kNumIterations * arraysize(kResponses);
+  base::LogPerfResult(name, elapsed.InMicrosecondsF() * 1000 / num_responses,
+                      "ns");
+}
+
+}  // namespace
+
+TEST(DnsResponsePerfTest, ParseToAddressList) {
+  AddressList addr_list;
+  base::TimeDelta ttl;
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (int i = 0; i < kNumIterations; ++i) {
+    for (const TestResponse& t : kResponses) {
+      DnsResponse response(t.data, t.size, t.query_size);
+      ASSERT_EQ(DnsResponse::DNS_PARSE_OK,
+                response.ParseToAddressList(&addr_list, &ttl));
+    }
+  }
+  LogNanosecondsPerResponse("DNS response to address list",
+                            base::TimeTicks::Now() - start);
+}
+
+// Compares walking the answers with copied and with borrowed owner names.
+TEST(DnsResponsePerfTest, ReadRecords) {
+  base::TimeTicks start = base::TimeTicks::Now();
+  DnsResourceRecord record;
+  for (int i = 0; i < kNumIterations; ++i) {
+    for (const TestResponse& t : kResponses) {
+      DnsRecordParser parser(t.data, t.size, t.query_size);
+      for (unsigned j = 0; j < t.num_records; ++j)
+        ASSERT_TRUE(parser.ReadRecord(&record));
+    }
+  }
+  LogNanosecondsPerResponse("DNS records with copied names",
+                            base::TimeTicks::Now() - start);
+
+  start = base::TimeTicks::Now();
+  DnsResourceRecordView view;
+  for (int i = 0; i < kNumIterations; ++i) {
+    for (const TestResponse& t : kResponses) {
+      DnsRecordParser parser(t.data, t.size, t.query_size);
+      for (unsigned j = 0; j < t.num_records; ++j)
+        ASSERT_TRUE(parser.ReadRecordView(&view));
+    }
+  }
+  LogNanosecondsPerResponse("DNS records with borrowed names",
+                            base::TimeTicks::Now() - start);
+}
+
+}  // namespace net
@@ -97,6 +97,63 @@ TEST(DnsRecordParserTest, ReadNameFail) {
   EXPECT_EQ(0u, parser.ReadName(data + 0x0e, &out));
 }
 
+TEST(DnsRecordParserTest, SkipName) {
+  const uint8_t data[] = {
+      // "foo.example.com"
+      0x03, 'f', 'o', 'o', 0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c',
+      'o', 'm', 0x00,
+      // byte 0x11
+      // "bar" then pointer to a truncated name
+      0x03, 'b', 'a', 'r', 0xc0, 0x1a,
+      // byte 0x17
+      // pointer to "foo.example.com"
+      0xc0, 0x00, 0x00,
+      // byte 0x1a
+      // truncated name (missing root label)
+      0x02, 'x', 'x',
+  };
+
+  DnsRecordParser parser(data, sizeof(data), 0);
+  EXPECT_EQ(0x11u, parser.SkipName(data + 0x00));
+  EXPECT_EQ(0x2u, parser.SkipName(data + 0x17));
+  // Unlike ReadName() without output, the name is checked past the pointer.
+  EXPECT_EQ(0x6u, parser.ReadName(data + 0x11, NULL));
+  EXPECT_EQ(0u, parser.SkipName(data + 0x11));
+}
+
+TEST(DnsRecordParserTest, NameEquals) {
+  const uint8_t data[] = {
+      // "foo.example.com"
+      0x03, 'f', 'o', 'o', 0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c',
+      'o', 'm', 0x00,
+      // byte 0x11
+      // "FOO.Example.COM", compressed
+      0x03, 'F', 'O', 'O', 0x07, 'E', 'x', 'a', 'm', 'p', 'l', 'e', 0xc0, 0x0c,
+      // byte 0x1f
+      // pointer to "foo.example.com"
+      0xc0, 0x00,
+      // byte 0x21
+      // "example.com", compressed
+      0xc0, 0x04,
+      // byte 0x23
+      // "foo.example" (no "com")
+      0x03, 'f', 'o', 'o', 0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x00,
+      // byte 0x30
+      // pointer loop
+      0xc0, 0x30,
+  };
+
+  DnsRecordParser parser(data, sizeof(data), 0);
+  EXPECT_TRUE(parser.NameEquals(data + 0x00, data + 0x00));
+  EXPECT_TRUE(parser.NameEquals(data + 0x00, data + 0x11));
+  EXPECT_TRUE(parser.NameEquals(data + 0x11, data + 0x1f));
+  EXPECT_TRUE(parser.NameEquals(data + 0x21, data + 0x04));
+  EXPECT_FALSE(parser.NameEquals(data + 0x00, data + 0x21));
+  EXPECT_FALSE(parser.NameEquals(data + 0x00, data + 0x23));
+  EXPECT_FALSE(parser.NameEquals(data + 0x23, data + 0x00));
+  EXPECT_FALSE(parser.NameEquals(data + 0x30, data + 0x30));
+}
+
 TEST(DnsRecordParserTest, ReadRecord) {
   const uint8_t data[] = {
       // Type CNAME record.
@@ -146,6 +203,50 @@ TEST(DnsRecordParserTest, ReadRecord) {
   EXPECT_FALSE(parser.ReadRecord(&record));
 }
 
+TEST(DnsRecordParserTest, ReadRecordView) {
+  const uint8_t data[] = {
+      // Type CNAME record.
+      0x07, 'e', 'x', 'a', 'm', 'p', 'l', 'e', 0x03, 'c', 'o', 'm', 0x00, 0x00,
+      0x05,                    // TYPE is CNAME.
+      0x00, 0x01,              // CLASS is IN.
+      0x00, 0x01, 0x24, 0x74,  // TTL is 0x00012474.
+      0x00, 0x06,              // RDLENGTH is 6 bytes.
+      0x03, 'f', 'o', 'o',     // compressed name in record
+      0xc0, 0x00,
+      // Type A record.
+      0x03, 'f', 'o', 'o',     // compressed owner name
+      0xc0, 0x00, 0x00, 0x01,  // TYPE is A.
+      0x00, 0x01,              // CLASS is IN.
+      0x00, 0x20, 0x13, 0x55,  // TTL is 0x00201355.
+      0x00, 0x04,              // RDLENGTH is 4 bytes.
+      0x7f, 0x02, 0x04, 0x01,  // IP is 127.2.4.1
+  };
+
+  DnsRecordParser parser(data, sizeof(data), 0);
+
+  DnsResourceRecordView cname;
+  EXPECT_TRUE(parser.ReadRecordView(&cname));
+  EXPECT_EQ(reinterpret_cast<const char*>(data), cname.name);
+  EXPECT_EQ(dns_protocol::kTypeCNAME, cname.type);
+  EXPECT_EQ(dns_protocol::kClassIN, cname.klass);
+  EXPECT_EQ(0x00012474u, cname.ttl);
+  EXPECT_EQ(reinterpret_cast<const char*>(data + 0x17), cname.rdata.data());
+  EXPECT_EQ(6u, cname.rdata.length());
+
+  DnsResourceRecordView address;
+  EXPECT_TRUE(parser.ReadRecordView(&address));
+  EXPECT_TRUE(parser.NameEquals(cname.rdata.data(), address.name));
+  EXPECT_EQ(dns_protocol::kTypeA, address.type);
+  EXPECT_EQ(0x00201355u, address.ttl);
+  EXPECT_EQ(base::StringPiece("\x7f\x02\x04\x01"), address.rdata);
+  EXPECT_TRUE(parser.AtEnd());
+
+  // Test truncated record.
+  parser = DnsRecordParser(data, sizeof(data) - 2, 0);
+  EXPECT_TRUE(parser.ReadRecordView(&cname));
+  EXPECT_FALSE(parser.ReadRecordView(&address));
+}
+
 TEST(DnsResponseTest, InitParse) {
   // This includes \0 at the end.
   const char qname_data[] = "\x0A""codereview""\x08""chromium""\x03""org";
@@ -6,6 +6,7 @@
 
 #include <stdint.h>
 
+#include <algorithm>
 #include <limits>
 #include <utility>
 
@@ -22,6 +23,7 @@
 #include "net/base/ip_endpoint.h"
 #include "net/base/net_errors.h"
 #include "net/dns/dns_config_service.h"
+#include "net/dns/dns_pipelined_socket.h"
 #include "net/dns/dns_socket_pool.h"
 #include "net/dns/dns_util.h"
 #include "net/socket/stream_socket.h"
@@ -45,12 +47,25 @@ const size_t kRTTBucketCount = 350;
 // Target percentile in the RTT histogram used for retransmission timeout.
 const unsigned kRTOPercentile = 99;
 
+// With |pipeline_queries|, up to this many queries are outstanding on one
+// UDP socket before another is opened to the same server, up to a limit.
+// Spreading the queries over a few sockets keeps some source port entropy.
+const size_t kMaxQueriesPerPipelinedUDPSocket = 64;
+const size_t kMaxPipelinedUDPSocketsPerServer = 4;
+
+// Servers may limit the number of queries they process at once on a single
+// TCP connection, so a second one is opened under heavy load.
+const size_t kMaxQueriesPerPipelinedTCPSocket = 100;
+const size_t kMaxPipelinedTCPSocketsPerServer = 2;
+
 }  // namespace
 
 // Runtime statistics of DNS server.
 struct DnsSession::ServerStats {
   ServerStats(base::TimeDelta rtt_estimate_param, RttBuckets* buckets)
-    : last_failure_count(0), rtt_estimate(rtt_estimate_param) {
+    : last_failure_count(0),
+      rtt_estimate(rtt_estimate_param),
+      num_responses(0) {
     rtt_histogram.reset(new base::SampleVector(buckets));
     // Seed histogram with 2 samples at |rtt_estimate| timeout.
     rtt_histogram->Accumulate(
@@ -73,6 +88,8 @@ struct DnsSession::ServerStats {
 
   // A histogram of observed RTT .
   std::unique_ptr<base::SampleVector> rtt_histogram;
+  // Number of RTTs recorded, not counting the seeded samples.
+  int num_responses;
 
   DISALLOW_COPY_AND_ASSIGN(ServerStats);
 };
@@ -85,6 +102,9 @@ DnsSession::RttBuckets::RttBuckets() : base::BucketRanges(kRTTBucketCount + 1) {
   base::Histogram::InitializeBucketRanges(1, kRTTMaxMs, this);
 }
 
+DnsSession::ServerLatency::ServerLatency()
+    : num_responses(0), last_failure_count(0) {}
+
 DnsSession::SocketLease::SocketLease(
     scoped_refptr<DnsSession> session,
     unsigned server_index,
@@ -113,6 +133,8 @@ DnsSession::DnsSession(const DnsConfig& config,
       "AsyncDNS.ServerCount", config_.nameservers.size(), 0, 10, 11);
   UpdateTimeouts(NetworkChangeNotifier::GetConnectionType());
   InitializeServerStats();
+  pipelined_udp_sockets_.resize(config_.nameservers.size());
+  pipelined_tcp_sockets_.resize(config_.nameservers.size());
   NetworkChangeNotifier::AddConnectionTypeObserver(this);
 }
 
@@ -233,6 +255,7 @@ void DnsSession::RecordRTT(unsigned server_index, base::TimeDelta rtt) {
   // Histogram-based method.
   server_stats_[server_index]->rtt_histogram->Accumulate(
       static_cast<base::HistogramBase::Sample>(rtt.InMilliseconds()), 1);
+  ++server_stats_[server_index]->num_responses;
 }
 
 void DnsSession::RecordLostPacket(unsigned server_index, int attempt) {
@@ -258,6 +281,20 @@ void DnsSession::RecordServerStats() {
   }
 }
 
+DnsSession::ServerLatency DnsSession::GetServerLatency(
+    unsigned server_index) const {
+  DCHECK_LT(server_index, server_stats_.size());
+  const ServerStats& stats = *server_stats_[server_index];
+
+  ServerLatency latency;
+  latency.rtt_estimate = stats.rtt_estimate;
+  latency.rtt_deviation = stats.rtt_deviation;
+  latency.rtt_median = RttPercentile(server_index, 50);
+  latency.rtt_99th_percentile = RttPercentile(server_index, 99);
+  latency.num_responses = stats.num_responses;
+  latency.last_failure_count = stats.last_failure_count;
+  return latency;
+}
 
 base::TimeDelta DnsSession::NextTimeout(unsigned server_index, int attempt) {
   // Respect initial timeout (from config or field trial) if it exceeds max.
@@ -289,6 +326,50 @@ std::unique_ptr<StreamSocket> DnsSession::CreateTCPSocket(
   return socket_pool_->CreateTCPSocket(server_index, source);
 }
 
+DnsSession::PipelinedSocketResult DnsSession::GetPipelinedUDPSocket(
+    unsigned server_index,
+    uint16_t query_id,
+    DnsPipelinedSocket** socket) {
+  DCHECK(config_.pipeline_queries);
+  DCHECK_LT(server_index, pipelined_udp_sockets_.size());
+  PipelinedSockets* sockets = &pipelined_udp_sockets_[server_index];
+
+  PipelinedSocketResult result = SelectPipelinedSocket(
+      sockets, kMaxPipelinedUDPSocketsPerServer,
+      kMaxQueriesPerPipelinedUDPSocket, query_id, socket);
+  if (result != PIPELINED_SOCKET_OK || *socket)
+    return result;
+
+  std::unique_ptr<DatagramClientSocket> udp_socket =
+      socket_pool_->AllocateSocket(server_index);
+  if (!udp_socket)
+    return PIPELINED_SOCKET_FAILED;
+  sockets->push_back(DnsPipelinedSocket::CreateUDP(std::move(udp_socket)));
+  *socket = sockets->back().get();
+  return PIPELINED_SOCKET_OK;
+}
+
+DnsSession::PipelinedSocketResult DnsSession::GetPipelinedTCPSocket(
+    unsigned server_index,
+    uint16_t query_id,
+    DnsPipelinedSocket** socket) {
+  DCHECK(config_.pipeline_queries);
+  DCHECK_LT(server_index, pipelined_tcp_sockets_.size());
+  PipelinedSockets* sockets = &pipelined_tcp_sockets_[server_index];
+
+  PipelinedSocketResult result = SelectPipelinedSocket(
+      sockets, kMaxPipelinedTCPSocketsPerServer,
+      kMaxQueriesPerPipelinedTCPSocket, query_id, socket);
+  if (result != PIPELINED_SOCKET_OK || *socket)
+    return result;
+
+  // The connection outlives any one transaction, so it has no source.
+  sockets->push_back(DnsPipelinedSocket::CreateTCP(
+      socket_pool_->CreateTCPSocket(server_index, NetLog::Source())));
+  *socket = sockets->back().get();
+  return PIPELINED_SOCKET_OK;
+}
+
 // Release a socket.
 void DnsSession::FreeSocket(unsigned server_index,
                             std::unique_ptr<DatagramClientSocket> socket) {
@@ -299,6 +380,50 @@ void DnsSession::FreeSocket(unsigned server_index,
   socket_pool_->FreeSocket(server_index, std::move(socket));
 }
 
+// static
+DnsSession::PipelinedSocketResult DnsSession::SelectPipelinedSocket(
+    PipelinedSockets* sockets,
+    size_t max_sockets,
+    size_t max_queries,
+    uint16_t query_id,
+    DnsPipelinedSocket** socket) {
+  // Failed sockets with queries still waiting on them are kept until those
+  // queries have been told, which happens from a posted task.
+  sockets->erase(
+      std::remove_if(sockets->begin(), sockets->end(),
+                     [](const std::unique_ptr<DnsPipelinedSocket>& socket) {
+                       return socket->is_broken() &&
+                              socket->num_pending_queries() == 0;
+                     }),
+      sockets->end());
+
+  DnsPipelinedSocket* least_loaded = nullptr;
+  size_t num_usable = 0;
+  for (const auto& socket : *sockets) {
+    if (socket->is_broken())
+      continue;
+    ++num_usable;
+    if (socket->IsQueryIdInUse(query_id))
+      continue;
+    if (!least_loaded ||
+        socket->num_pending_queries() < least_loaded->num_pending_queries()) {
+      least_loaded = socket.get();
+    }
+  }
+
+  *socket = nullptr;
+  if (num_usable >= max_sockets) {
+    // No more sockets may be opened, however loaded the existing ones are.
+    if (!least_loaded)
+      return PIPELINED_SOCKET_QUERY_ID_IN_USE;
+    *socket = least_loaded;
+  } else if (least_loaded &&
+             least_loaded->num_pending_queries() < max_queries) {
+    *socket = least_loaded;
+  }
+  return PIPELINED_SOCKET_OK;
+}
+
 base::TimeDelta DnsSession::NextTimeoutFromJacobson(unsigned server_index,
                                                     int attempt) {
   DCHECK_LT(server_index, server_stats_.size());
@@ -314,27 +439,31 @@ base::TimeDelta DnsSession::NextTimeoutFromJacobson(unsigned server_index,
   return std::min(timeout * (1 << num_backoffs), max_timeout_);
 }
 
-base::TimeDelta DnsSession::NextTimeoutFromHistogram(unsigned server_index,
-                                                     int attempt) {
+base::TimeDelta DnsSession::RttPercentile(unsigned server_index,
+                                          unsigned percentile) const {
   DCHECK_LT(server_index, server_stats_.size());
 
   static_assert(std::numeric_limits<base::HistogramBase::Count>::is_signed,
                 "histogram base count assumed to be signed");
 
-  // Use fixed percentile of observed samples.
   const base::SampleVector& samples =
       *server_stats_[server_index]->rtt_histogram;
 
   base::HistogramBase::Count total = samples.TotalCount();
-  base::HistogramBase::Count remaining_count = kRTOPercentile * total / 100;
+  base::HistogramBase::Count remaining_count = percentile * total / 100;
   size_t index = 0;
   while (remaining_count > 0 && index < rtt_buckets_.Get().size()) {
     remaining_count -= samples.GetCountAtIndex(index);
     ++index;
   }
 
-  base::TimeDelta timeout =
-      base::TimeDelta::FromMilliseconds(rtt_buckets_.Get().range(index));
+  return base::TimeDelta::FromMilliseconds(rtt_buckets_.Get().range(index));
+}
+
+base::TimeDelta DnsSession::NextTimeoutFromHistogram(unsigned server_index,
+                                                     int attempt) {
+  // Use fixed percentile of observed samples.
+  base::TimeDelta timeout = RttPercentile(server_index, kRTOPercentile);
 
   timeout = std::max(timeout, base::TimeDelta::FromMilliseconds(kMinTimeoutMs));
 
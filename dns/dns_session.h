@@ -30,6 +30,7 @@ namespace net {
 
 class ClientSocketFactory;
 class DatagramClientSocket;
+class DnsPipelinedSocket;
 class NetLog;
 class StreamSocket;
 
@@ -61,6 +62,24 @@ class NET_EXPORT_PRIVATE DnsSession
     DISALLOW_COPY_AND_ASSIGN(SocketLease);
   };
 
+  // Latency of one nameserver, as observed by this session.
+  struct NET_EXPORT_PRIVATE ServerLatency {
+    ServerLatency();
+
+    // Smoothed RTT and its mean deviation, as used by the Jacobson timeout.
+    base::TimeDelta rtt_estimate;
+    base::TimeDelta rtt_deviation;
+    // Percentiles of the RTT histogram, at bucket granularity. The histogram
+    // is seeded with the initial timeout, so these lean towards it until a
+    // few responses have been recorded.
+    base::TimeDelta rtt_median;
+    base::TimeDelta rtt_99th_percentile;
+    // Number of RTTs recorded.
+    int num_responses;
+    // Number of failures since the last success.
+    int last_failure_count;
+  };
+
   DnsSession(const DnsConfig& config,
              std::unique_ptr<DnsSocketPool> socket_pool,
              const RandIntCallback& rand_int_callback,
@@ -96,6 +115,9 @@ class NET_EXPORT_PRIVATE DnsSession
   // Record server stats before it is destroyed.
   void RecordServerStats();
 
+  // Returns the latency statistics of the server at |server_index|.
+  ServerLatency GetServerLatency(unsigned server_index) const;
+
   // Return the timeout for the next query. |attempt| counts from 0 and is used
   // for exponential backoff.
   base::TimeDelta NextTimeout(unsigned server_index, int attempt);
@@ -110,6 +132,29 @@ class NET_EXPORT_PRIVATE DnsSession
   std::unique_ptr<StreamSocket> CreateTCPSocket(unsigned server_index,
                                                 const NetLog::Source& source);
 
+  enum PipelinedSocketResult {
+    PIPELINED_SOCKET_OK,
+    // No socket could be created.
+    PIPELINED_SOCKET_FAILED,
+    // The server already has the most sockets allowed, and |query_id| is in
+    // use on each of them. The query should be retried with another ID.
+    PIPELINED_SOCKET_QUERY_ID_IN_USE,
+  };
+
+  // Sets |*socket| to a UDP socket connected to the server, shared with other
+  // transactions, on which |query_id| is not in use. Used when
+  // |config_.pipeline_queries| is set.
+  PipelinedSocketResult GetPipelinedUDPSocket(unsigned server_index,
+                                              uint16_t query_id,
+                                              DnsPipelinedSocket** socket);
+
+  // Sets |*socket| to a TCP connection to the server, shared with other
+  // transactions, on which |query_id| is not in use. Used when
+  // |config_.pipeline_queries| is set.
+  PipelinedSocketResult GetPipelinedTCPSocket(unsigned server_index,
+                                              uint16_t query_id,
+                                              DnsPipelinedSocket** socket);
+
  private:
   friend class base::RefCounted<DnsSession>;
   ~DnsSession() override;
@@ -121,6 +166,24 @@ class NET_EXPORT_PRIVATE DnsSession
   void FreeSocket(unsigned server_index,
                   std::unique_ptr<DatagramClientSocket> socket);
 
+  typedef std::vector<std::unique_ptr<DnsPipelinedSocket>> PipelinedSockets;
+
+  // Drops the failed sockets in |sockets| that no query is waiting on, and
+  // sets |*socket| to the least loaded of the others on which |query_id| is
+  // free. Sets it to null, and returns PIPELINED_SOCKET_OK, if a new socket
+  // should be added instead.
+  static PipelinedSocketResult SelectPipelinedSocket(
+      PipelinedSockets* sockets,
+      size_t max_sockets,
+      size_t max_queries,
+      uint16_t query_id,
+      DnsPipelinedSocket** socket);
+
+  // Returns the RTT below which |percentile| percent of the observed RTTs of
+  // the server fall.
+  base::TimeDelta RttPercentile(unsigned server_index,
+                                unsigned percentile) const;
+
   // Return the timeout using the TCP timeout method.
   base::TimeDelta NextTimeoutFromJacobson(unsigned server_index, int attempt);
 
@@ -147,6 +210,10 @@ class NET_EXPORT_PRIVATE DnsSession
   // Track runtime statistics of each DNS server.
   std::vector<std::unique_ptr<ServerStats>> server_stats_;
 
+  // Shared sockets to each DNS server, if |config_.pipeline_queries| is set.
+  std::vector<PipelinedSockets> pipelined_udp_sockets_;
+  std::vector<PipelinedSockets> pipelined_tcp_sockets_;
+
   // Buckets shared for all |ServerStats::rtt_histogram|.
   struct RttBuckets : public base::BucketRanges {
     RttBuckets();
@@ -32,6 +32,7 @@
 #include "net/base/ip_address.h"
 #include "net/base/ip_endpoint.h"
 #include "net/base/net_errors.h"
+#include "net/dns/dns_pipelined_socket.h"
 #include "net/dns/dns_protocol.h"
 #include "net/dns/dns_query.h"
 #include "net/dns/dns_response.h"
@@ -546,6 +547,84 @@ class DnsTCPAttempt : public DnsAttempt {
   DISALLOW_COPY_AND_ASSIGN(DnsTCPAttempt);
 };
 
+// An exchange over a DnsPipelinedSocket that is shared with other attempts.
+// Used in place of DnsUDPAttempt and DnsTCPAttempt when
+// DnsConfig::pipeline_queries is set.
+class DnsPipelinedAttempt : public DnsAttempt {
+ public:
+  // |socket| may be null, in which case the attempt fails to start.
+  DnsPipelinedAttempt(unsigned server_index,
+                      DnsPipelinedSocket* socket,
+                      std::unique_ptr<DnsQuery> query,
+                      bool use_tcp)
+      : DnsAttempt(server_index),
+        socket_(socket ? socket->AsWeakPtr()
+                       : base::WeakPtr<DnsPipelinedSocket>()),
+        socket_net_log_(socket ? socket->NetLog() : BoundNetLog()),
+        query_(std::move(query)),
+        use_tcp_(use_tcp) {}
+
+  ~DnsPipelinedAttempt() override {
+    // Once the query completed, its ID may belong to another attempt.
+    if (is_pending() && socket_)
+      socket_->CancelQuery(query_->id());
+  }
+
+  // DnsAttempt:
+  int Start(const CompletionCallback& callback) override {
+    if (!socket_)
+      return ERR_CONNECTION_REFUSED;
+    callback_ = callback;
+    int rv = socket_->SendQuery(
+        query_.get(), base::Bind(&DnsPipelinedAttempt::OnResponse,
+                                 base::Unretained(this)));
+    set_result(rv);
+    return rv;
+  }
+
+  const DnsQuery* GetQuery() const override { return query_.get(); }
+
+  const DnsResponse* GetResponse() const override {
+    const DnsResponse* resp = response_.get();
+    return (resp != NULL && resp->IsValid()) ? resp : NULL;
+  }
+
+  const BoundNetLog& GetSocketNetLog() const override {
+    return socket_net_log_;
+  }
+
+ private:
+  void OnResponse(int rv, std::unique_ptr<DnsResponse> response) {
+    response_ = std::move(response);
+    if (rv == OK)
+      rv = CheckResponse();
+    set_result(rv);
+    callback_.Run(rv);
+  }
+
+  int CheckResponse() const {
+    if (response_->flags() & dns_protocol::kFlagTC)
+      return use_tcp_ ? ERR_UNEXPECTED : ERR_DNS_SERVER_REQUIRES_TCP;
+    // TODO(szym): Extract TTL for NXDOMAIN results. http://crbug.com/115051
+    if (response_->rcode() == dns_protocol::kRcodeNXDOMAIN)
+      return ERR_NAME_NOT_RESOLVED;
+    if (response_->rcode() != dns_protocol::kRcodeNOERROR)
+      return ERR_DNS_SERVER_FAILED;
+    return OK;
+  }
+
+  base::WeakPtr<DnsPipelinedSocket> socket_;
+  BoundNetLog socket_net_log_;
+  std::unique_ptr<DnsQuery> query_;
+  const bool use_tcp_;
+
+  std::unique_ptr<DnsResponse> response_;
+
+  CompletionCallback callback_;
+
+  DISALLOW_COPY_AND_ASSIGN(DnsPipelinedAttempt);
+};
+
 // ----------------------------------------------------------------------------
 
 // Implements DnsTransaction. Configuration is supplied by DnsSession.
@@ -721,6 +800,9 @@ class DnsTransactionImpl : public DnsTransaction,
     // Skip over known failed servers.
     server_index = session_->NextGoodServerIndex(server_index);
 
+    if (config.pipeline_queries)
+      return MakePipelinedAttempt(server_index, std::move(query), false);
+
     std::unique_ptr<DnsSession::SocketLease> lease =
         session_->AllocateSocket(server_index, net_log_.source());
 
@@ -757,9 +839,6 @@ class DnsTransactionImpl : public DnsTransaction,
 
     unsigned server_index = previous_attempt->server_index();
 
-    std::unique_ptr<StreamSocket> socket(
-        session_->CreateTCPSocket(server_index, net_log_.source()));
-
     // TODO(szym): Reuse the same id to help the server?
     uint16_t id = session_->NextQueryId();
     std::unique_ptr<DnsQuery> query =
@@ -768,6 +847,13 @@ class DnsTransactionImpl : public DnsTransaction,
     RecordLostPacketsIfAny();
     // Cancel all other attempts, no point waiting on them.
     attempts_.clear();
+    had_tcp_attempt_ = true;
+
+    if (session_->config().pipeline_queries)
+      return MakePipelinedAttempt(server_index, std::move(query), true);
+
+    std::unique_ptr<StreamSocket> socket(
+        session_->CreateTCPSocket(server_index, net_log_.source()));
 
     unsigned attempt_number = attempts_.size();
 
@@ -776,7 +862,6 @@ class DnsTransactionImpl : public DnsTransaction,
 
     attempts_.push_back(base::WrapUnique(attempt));
     ++attempts_count_;
-    had_tcp_attempt_ = true;
 
     net_log_.AddEvent(
         NetLog::TYPE_DNS_TRANSACTION_TCP_ATTEMPT,
@@ -793,6 +878,72 @@ class DnsTransactionImpl : public DnsTransaction,
     return AttemptResult(rv, attempt);
   }
 
+  DnsSession::PipelinedSocketResult GetPipelinedSocket(
+      unsigned server_index,
+      uint16_t query_id,
+      bool use_tcp,
+      DnsPipelinedSocket** socket) {
+    return use_tcp
+               ? session_->GetPipelinedTCPSocket(server_index, query_id, socket)
+               : session_->GetPipelinedUDPSocket(server_index, query_id,
+                                                 socket);
+  }
+
+  // Makes an attempt over a socket shared with other transactions, rather
+  // than over a socket of its own.
+  AttemptResult MakePipelinedAttempt(unsigned server_index,
+                                     std::unique_ptr<DnsQuery> query,
+                                     bool use_tcp) {
+    // A random ID is rarely in use on every socket, so a few retries are
+    // enough.
+    static const int kMaxQueryIdRetries = 8;
+    unsigned attempt_number = attempts_.size();
+
+    DnsPipelinedSocket* socket = nullptr;
+    DnsSession::PipelinedSocketResult result =
+        GetPipelinedSocket(server_index, query->id(), use_tcp, &socket);
+    for (int i = 0;
+         result == DnsSession::PIPELINED_SOCKET_QUERY_ID_IN_USE &&
+         i < kMaxQueryIdRetries;
+         ++i) {
+      query = query->CloneWithNewId(session_->NextQueryId());
+      result = GetPipelinedSocket(server_index, query->id(), use_tcp, &socket);
+    }
+    if (result != DnsSession::PIPELINED_SOCKET_OK)
+      socket = nullptr;
+
+    DnsPipelinedAttempt* attempt = new DnsPipelinedAttempt(
+        server_index, socket, std::move(query), use_tcp);
+
+    attempts_.push_back(base::WrapUnique(attempt));
+    ++attempts_count_;
+
+    if (!socket)
+      return AttemptResult(ERR_CONNECTION_REFUSED, NULL);
+
+    net_log_.AddEvent(
+        use_tcp ? NetLog::TYPE_DNS_TRANSACTION_TCP_ATTEMPT
+                : NetLog::TYPE_DNS_TRANSACTION_ATTEMPT,
+        attempt->GetSocketNetLog().source().ToEventParametersCallback());
+
+    int rv;
+    base::TimeDelta timeout;
+    if (use_tcp) {
+      rv = attempt->Start(base::Bind(&DnsTransactionImpl::OnAttemptComplete,
+                                     base::Unretained(this), attempt_number));
+      // Custom timeout for TCP attempt.
+      timeout = timer_.GetCurrentDelay() * 2;
+    } else {
+      rv = attempt->Start(base::Bind(
+          &DnsTransactionImpl::OnUdpAttemptComplete, base::Unretained(this),
+          attempt_number, base::TimeTicks::Now()));
+      timeout = session_->NextTimeout(server_index, attempt_number);
+    }
+    if (rv == ERR_IO_PENDING)
+      timer_.Start(FROM_HERE, timeout, this, &DnsTransactionImpl::OnTimeout);
+    return AttemptResult(rv, attempt);
+  }
+
   // Begins query for the current name. Makes the first attempt.
   AttemptResult StartQuery() {
     std::string dotted_qname = DNSDomainToString(qnames_.front());
@@ -0,0 +1,243 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "base/bind.h"
+#include "base/macros.h"
+#include "base/message_loop/message_loop.h"
+#include "base/rand_util.h"
+#include "base/run_loop.h"
+#include "base/strings/stringprintf.h"
+#include "base/sys_byteorder.h"
+#include "base/test/perf_log.h"
+#include "base/test/perf_time_logger.h"
+#include "net/base/io_buffer.h"
+#include "net/base/ip_address.h"
+#include "net/base/ip_endpoint.h"
+#include "net/base/net_errors.h"
+#include "net/dns/dns_protocol.h"
+#include "net/dns/dns_session.h"
+#include "net/dns/dns_socket_pool.h"
+#include "net/dns/dns_transaction.h"
+#include "net/log/net_log.h"
+#include "net/socket/client_socket_factory.h"
+#include "net/socket/ssl_client_socket.h"
+#include "net/socket/stream_socket.h"
+#include "net/udp/datagram_client_socket.h"
+#include "net/udp/udp_server_socket.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const int kNumTransactions = 20000;
+const int kMaxConcurrentTransactions = 100;
+
+// Answers every query it receives with an empty NOERROR response.
+class StubDnsServer {
+ public:
+  StubDnsServer()
+      : socket_(nullptr, NetLog::Source()),
+        buffer_(new IOBufferWithSize(dns_protocol::kMaxUDPSize)) {}
+
+  // Returns the address the server listens on.
+  IPEndPoint Start() {
+    EXPECT_EQ(OK, socket_.Listen(IPEndPoint(IPAddress::IPv4Localhost(), 0)));
+    IPEndPoint address;
+    EXPECT_EQ(OK, socket_.GetLocalAddress(&address));
+    DoReadLoop();
+    return address;
+  }
+
+ private:
+  void DoReadLoop() {
+    while (true) {
+      int rv = socket_.RecvFrom(
+          buffer_.get(), buffer_->size(), &client_address_,
+          base::Bind(&StubDnsServer::OnRecvComplete, base::Unretained(this)));
+      if (rv == ERR_IO_PENDING)
+        return;
+      if (!Respond(rv))
+        return;
+    }
+  }
+
+  void OnRecvComplete(int rv) {
+    if (Respond(rv))
+      DoReadLoop();
+  }
+
+  // Returns false if the reply is still being sent.
+  bool Respond(int rv) {
+    if (rv < static_cast<int>(sizeof(dns_protocol::Header)))
+      return true;
+    dns_protocol::Header* header =
+        reinterpret_cast<dns_protocol::Header*>(buffer_->data());
+    header->flags |= base::HostToNet16(dns_protocol::kFlagResponse);
+    rv = socket_.SendTo(
+        buffer_.get(), rv, client_address_,
+        base::Bind(&StubDnsServer::OnSendComplete, base::Unretained(this)));
+    return rv != ERR_IO_PENDING;
+  }
+
+  void OnSendComplete(int rv) { DoReadLoop(); }
+
+  UDPServerSocket socket_;
+  scoped_refptr<IOBufferWithSize> buffer_;
+  IPEndPoint client_address_;
+
+  DISALLOW_COPY_AND_ASSIGN(StubDnsServer);
+};
+
+// Creates real sockets, and counts them.
+class CountingSocketFactory : public ClientSocketFactory {
+ public:
+  CountingSocketFactory()
+      : factory_(ClientSocketFactory::GetDefaultFactory()),
+        num_sockets_(0) {}
+
+  std::unique_ptr<DatagramClientSocket> CreateDatagramClientSocket(
+      DatagramSocket::BindType bind_type,
+      const RandIntCallback& rand_int_cb,
+      NetLog* net_log,
+      const NetLog::Source& source) override {
+    ++num_sockets_;
+    return factory_->CreateDatagramClientSocket(bind_type, rand_int_cb,
+                                                net_log, source);
+  }
+
+  std::unique_ptr<StreamSocket> CreateTransportClientSocket(
+      const AddressList& addresses,
+      std::unique_ptr<SocketPerformanceWatcher> socket_performance_watcher,
+      NetLog* net_log,
+      const NetLog::Source& source) override {
+    ++num_sockets_;
+    return factory_->CreateTransportClientSocket(
+        addresses, std::move(socket_performance_watcher), net_log, source);
+  }
+
+  std::unique_ptr<SSLClientSocket> CreateSSLClientSocket(
+      std::unique_ptr<ClientSocketHandle> transport_socket,
+      const HostPortPair& host_and_port,
+      const SSLConfig& ssl_config,
+      const SSLClientSocketContext& context) override {
+    NOTREACHED();
+    return nullptr;
+  }
+
+  void ClearSSLSessionCache() override {}
+
+  int num_sockets() const { return num_sockets_; }
+
+ private:
+  ClientSocketFactory* factory_;
+  int num_sockets_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingSocketFactory);
+};
+
+// Keeps |kMaxConcurrentTransactions| transactions in flight until
+// |kNumTransactions| have completed.
+class TransactionRunner {
+ public:
+  explicit TransactionRunner(DnsTransactionFactory* factory)
+      : factory_(factory), num_started_(0), num_succeeded_(0) {}
+
+  void Run() {
+    base::RunLoop run_loop;
+    quit_closure_ = run_loop.QuitClosure();
+    for (int i = 0; i < kMaxConcurrentTransactions; ++i)
+      StartTransaction();
+    run_loop.Run();
+  }
+
+  int num_succeeded() const { return num_succeeded_; }
+
+ private:
+  void StartTransaction() {
+    std::unique_ptr<DnsTransaction> transaction = factory_->CreateTransaction(
+        base::StringPrintf("host%d.test.", num_started_++),
+        dns_protocol::kTypeA,
+        base::Bind(&TransactionRunner::OnTransactionComplete,
+                   base::Unretained(this)),
+        BoundNetLog());
+    DnsTransaction* raw_transaction = transaction.get();
+    transactions_[raw_transaction] = std::move(transaction);
+    raw_transaction->Start();
+  }
+
+  void OnTransactionComplete(DnsTransaction* transaction,
+                             int rv,
+                             const DnsResponse* response) {
+    if (rv == OK)
+      ++num_succeeded_;
+    transactions_.erase(transaction);
+    if (num_started_ < kNumTransactions)
+      StartTransaction();
+    else if (transactions_.empty())
+      quit_closure_.Run();
+  }
+
+  DnsTransactionFactory* factory_;
+  std::map<DnsTransaction*, std::unique_ptr<DnsTransaction>> transactions_;
+  int num_started_;
+  int num_succeeded_;
+  base::Closure quit_closure_;
+
+  DISALLOW_COPY_AND_ASSIGN(TransactionRunner);
+};
+
+void RunTransactionBenchmark(bool pipeline_queries) {
+  base::MessageLoopForIO message_loop;
+  StubDnsServer server;
+
+  DnsConfig config;
+  config.nameservers.push_back(server.Start());
+  config.attempts = 1;
+  config.timeout = base::TimeDelta::FromSeconds(5);
+  config.pipeline_queries = pipeline_queries;
+
+  CountingSocketFactory socket_factory;
+  scoped_refptr<DnsSession> session(new DnsSession(
+      config, DnsSocketPool::CreateNull(&socket_factory,
+                                        base::Bind(&base::RandInt)),
+      base::Bind(&base::RandInt), nullptr /* NetLog */));
+  std::unique_ptr<DnsTransactionFactory> transaction_factory =
+      DnsTransactionFactory::CreateFactory(session.get());
+
+  const std::string name =
+      pipeline_queries ? "DNS pipelined transactions" : "DNS transactions";
+  TransactionRunner runner(transaction_factory.get());
+  base::TimeTicks start = base::TimeTicks::Now();
+  runner.Run();
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+
+  EXPECT_EQ(kNumTransactions, runner.num_succeeded());
+  base::LogPerfResult((name + " per second").c_str(),
+                      kNumTransactions / elapsed.InSecondsF(), "queries/s");
+  base::LogPerfResult((name + " sockets").c_str(),
+                      socket_factory.num_sockets(), "sockets");
+  DnsSession::ServerLatency latency = session->GetServerLatency(0);
+  base::LogPerfResult((name + " median RTT").c_str(),
+                      latency.rtt_median.InMillisecondsF(), "ms");
+}
+
+TEST(DnsTransactionPerfTest, Transactions) {
+  RunTransactionBenchmark(false);
+}
+
+TEST(DnsTransactionPerfTest, PipelinedTransactions) {
+  RunTransactionBenchmark(true);
+}
+
+}  // namespace
+
+}  // namespace net
@@ -9,6 +9,7 @@
 #include <limits>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "base/bind.h"
 #include "base/macros.h"
@@ -508,6 +509,111 @@ TEST_F(DnsTransactionTest, ConcurrentLookup) {
   EXPECT_TRUE(helper1.has_completed());
 }
 
+// With pipelining, concurrent transactions share one socket, and are matched
+// to their responses by ID.
+TEST_F(DnsTransactionTest, PipelinedConcurrentLookup) {
+  config_.pipeline_queries = true;
+  ConfigureFactory();
+
+  DnsQuery query0(0 /* id */, DomainFromDot(kT0HostName), kT0Qtype);
+  DnsQuery query1(1 /* id */, DomainFromDot(kT1HostName), kT1Qtype);
+  transaction_ids_.push_back(0);
+  transaction_ids_.push_back(1);
+  MockWrite writes[] = {
+      MockWrite(ASYNC, query0.io_buffer()->data(), query0.io_buffer()->size(),
+                0),
+      MockWrite(ASYNC, query1.io_buffer()->data(), query1.io_buffer()->size(),
+                1),
+  };
+  MockRead reads[] = {
+      MockRead(ASYNC, reinterpret_cast<const char*>(kT1ResponseDatagram),
+               arraysize(kT1ResponseDatagram), 2),
+      MockRead(ASYNC, reinterpret_cast<const char*>(kT0ResponseDatagram),
+               arraysize(kT0ResponseDatagram), 3),
+      MockRead(SYNCHRONOUS, ERR_IO_PENDING, 4),
+  };
+  SequencedSocketData data(reads, arraysize(reads), writes, arraysize(writes));
+  socket_factory_->AddSocketDataProvider(&data);
+
+  TransactionHelper helper0(kT0HostName, kT0Qtype, kT0RecordCount);
+  helper0.StartTransaction(transaction_factory_.get());
+  TransactionHelper helper1(kT1HostName, kT1Qtype, kT1RecordCount);
+  helper1.StartTransaction(transaction_factory_.get());
+
+  base::RunLoop().RunUntilIdle();
+
+  EXPECT_TRUE(helper0.has_completed());
+  EXPECT_TRUE(helper1.has_completed());
+  EXPECT_EQ(1u, socket_factory_->remote_endpoints_.size());
+  EXPECT_TRUE(data.AllWriteDataConsumed());
+
+  // Both responses were timed against the server.
+  EXPECT_EQ(2, session_->GetServerLatency(0).num_responses);
+
+  // The session owns the shared socket, and must go before |data|.
+  helper0.Cancel();
+  helper1.Cancel();
+  transaction_factory_.reset();
+  session_ = nullptr;
+}
+
+// Once the server has the most pipelined sockets allowed, a query whose ID is
+// in use on all of them is sent with a new ID rather than on another socket.
+TEST_F(DnsTransactionTest, PipelinedQueryIdInUseOnAllSockets) {
+  config_.pipeline_queries = true;
+  ConfigureFactory();
+
+  const size_t kNumSockets = 4;
+  DnsQuery query0(0 /* id */, DomainFromDot(kT0HostName), kT0Qtype);
+  DnsQuery query1(1 /* id */, DomainFromDot(kT0HostName), kT0Qtype);
+  for (size_t i = 0; i <= kNumSockets; ++i)
+    transaction_ids_.push_back(0);
+  transaction_ids_.push_back(1);
+
+  MockWrite first_writes[] = {
+      MockWrite(ASYNC, query0.io_buffer()->data(), query0.io_buffer()->size(),
+                0),
+      MockWrite(ASYNC, query1.io_buffer()->data(), query1.io_buffer()->size(),
+                1),
+  };
+  MockRead first_reads[] = {MockRead(SYNCHRONOUS, ERR_IO_PENDING, 2)};
+  SequencedSocketData first_data(first_reads, arraysize(first_reads),
+                                 first_writes, arraysize(first_writes));
+  socket_factory_->AddSocketDataProvider(&first_data);
+
+  MockWrite writes[] = {
+      MockWrite(ASYNC, query0.io_buffer()->data(), query0.io_buffer()->size(),
+                0),
+  };
+  MockRead reads[] = {MockRead(SYNCHRONOUS, ERR_IO_PENDING, 1)};
+  std::vector<std::unique_ptr<SequencedSocketData>> data;
+  for (size_t i = 1; i < kNumSockets; ++i) {
+    data.push_back(base::WrapUnique(new SequencedSocketData(
+        reads, arraysize(reads), writes, arraysize(writes))));
+    socket_factory_->AddSocketDataProvider(data.back().get());
+  }
+
+  std::vector<std::unique_ptr<TransactionHelper>> helpers;
+  for (size_t i = 0; i <= kNumSockets; ++i) {
+    helpers.push_back(base::WrapUnique(
+        new TransactionHelper(kT0HostName, kT0Qtype, kT0RecordCount)));
+    helpers.back()->StartTransaction(transaction_factory_.get());
+  }
+
+  base::RunLoop().RunUntilIdle();
+
+  EXPECT_EQ(kNumSockets, socket_factory_->remote_endpoints_.size());
+  EXPECT_TRUE(first_data.AllWriteDataConsumed());
+  for (const auto& socket_data : data)
+    EXPECT_TRUE(socket_data->AllWriteDataConsumed());
+
+  // The session owns the shared sockets, and must go before their data.
+  for (const auto& helper : helpers)
+    helper->Cancel();
+  transaction_factory_.reset();
+  session_ = nullptr;
+}
+
 TEST_F(DnsTransactionTest, CancelLookup) {
   AddAsyncQueryAndResponse(0 /* id */, kT0HostName, kT0Qtype,
                            kT0ResponseDatagram, arraysize(kT0ResponseDatagram));
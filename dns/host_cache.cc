@@ -26,6 +26,12 @@ namespace {
 #define CACHE_HISTOGRAM_ENUM(name, value, max) \
   UMA_HISTOGRAM_ENUMERATION("DNS.HostCache." name, value, max)
 
+// Caches of at least kMinEntriesPerShard * kMaxShards entries are split into
+// kMaxShards shards. Smaller ones keep a single shard, and so an exact least
+// recently used order.
+const size_t kMaxShards = 16;
+const size_t kMinEntriesPerShard = 32;
+
 }  // namespace
 
 // Used in histograms; do not modify existing values.
@@ -53,6 +59,13 @@ enum HostCache::EraseReason : int {
   MAX_ERASE_REASON
 };
 
+size_t HostCache::KeyHash::operator()(const Key& key) const {
+  size_t hash = std::hash<std::string>()(key.hostname);
+  hash = hash * 31 + key.address_family;
+  hash = hash * 31 + key.host_resolver_flags;
+  return hash;
+}
+
 HostCache::Entry::Entry(int error,
                         const AddressList& addresses,
                         base::TimeDelta ttl)
@@ -102,25 +115,46 @@ void HostCache::Entry::GetStaleness(base::TimeTicks now,
   out->stale_hits = stale_hits_;
 }
 
+HostCache::Shard::Shard(size_t max_entries)
+    : entries(EntryMap::NO_AUTO_EVICT), max_entries(max_entries) {}
+
+HostCache::Shard::~Shard() {}
+
 HostCache::HostCache(size_t max_entries)
-    : max_entries_(max_entries), network_changes_(0) {}
+    : max_entries_(max_entries), network_changes_(0) {
+  const size_t num_shards =
+      max_entries >= kMinEntriesPerShard * kMaxShards ? kMaxShards : 1;
+  // Spread the remainder so that the shards add up to |max_entries|.
+  for (size_t i = 0; i < num_shards; ++i) {
+    shards_.push_back(base::WrapUnique(new Shard(
+        max_entries / num_shards + (i < max_entries % num_shards ? 1 : 0))));
+  }
+}
 
 HostCache::~HostCache() {
-  RecordEraseAll(ERASE_DESTRUCT, base::TimeTicks::Now());
+  const base::TimeTicks now = base::TimeTicks::Now();
+  for (const auto& shard : shards_) {
+    base::AutoLock auto_lock(shard->lock);
+    RecordEraseAll(ERASE_DESTRUCT, now, shard->entries);
+  }
 }
 
 const HostCache::Entry* HostCache::Lookup(const Key& key,
                                           base::TimeTicks now) {
-  DCHECK(CalledOnValidThread());
+  DCHECK(thread_checker_.CalledOnValidThread());
   if (caching_is_disabled())
     return nullptr;
 
-  HostCache::Entry* entry = LookupInternal(key);
+  // Other threads only reorder the entries and count hits, so the entry
+  // outlives the lock until this thread modifies the cache.
+  Shard* shard = GetShard(key);
+  base::AutoLock auto_lock(shard->lock);
+  HostCache::Entry* entry = LookupInternal(shard, key);
   if (!entry) {
     RecordLookup(LOOKUP_MISS_ABSENT, now, nullptr);
     return nullptr;
   }
-  if (entry->IsStale(now, network_changes_)) {
+  if (entry->IsStale(now, network_changes())) {
     RecordLookup(LOOKUP_MISS_STALE, now, entry);
     return nullptr;
   }
@@ -134,28 +168,64 @@ const HostCache::Entry* HostCache::LookupStale(
     const Key& key,
     base::TimeTicks now,
     HostCache::EntryStaleness* stale_out) {
-  DCHECK(CalledOnValidThread());
+  DCHECK(thread_checker_.CalledOnValidThread());
   if (caching_is_disabled())
     return nullptr;
 
-  HostCache::Entry* entry = LookupInternal(key);
+  Shard* shard = GetShard(key);
+  base::AutoLock auto_lock(shard->lock);
+  HostCache::Entry* entry = LookupInternal(shard, key);
   if (!entry) {
     RecordLookup(LOOKUP_MISS_ABSENT, now, nullptr);
     return nullptr;
   }
 
-  bool is_stale = entry->IsStale(now, network_changes_);
+  const int network_changes = this->network_changes();
+  bool is_stale = entry->IsStale(now, network_changes);
   entry->CountHit(/* hit_is_stale= */ is_stale);
   RecordLookup(is_stale ? LOOKUP_HIT_STALE : LOOKUP_HIT_VALID, now, entry);
 
   if (stale_out)
-    entry->GetStaleness(now, network_changes_, stale_out);
+    entry->GetStaleness(now, network_changes, stale_out);
   return entry;
 }
 
-HostCache::Entry* HostCache::LookupInternal(const Key& key) {
-  auto it = entries_.find(key);
-  return (it != entries_.end()) ? &it->second : nullptr;
+bool HostCache::LookupStaleOnAnyThread(const Key& key,
+                                       base::TimeTicks now,
+                                       Entry* entry_out,
+                                       EntryStaleness* stale_out) {
+  DCHECK(entry_out);
+  if (caching_is_disabled())
+    return false;
+
+  Shard* shard = GetShard(key);
+  base::AutoLock auto_lock(shard->lock);
+  HostCache::Entry* entry = LookupInternal(shard, key);
+  if (!entry) {
+    RecordLookup(LOOKUP_MISS_ABSENT, now, nullptr);
+    return false;
+  }
+
+  const int network_changes = this->network_changes();
+  bool is_stale = entry->IsStale(now, network_changes);
+  entry->CountHit(/* hit_is_stale= */ is_stale);
+  RecordLookup(is_stale ? LOOKUP_HIT_STALE : LOOKUP_HIT_VALID, now, entry);
+
+  if (stale_out)
+    entry->GetStaleness(now, network_changes, stale_out);
+  *entry_out = *entry;
+  return true;
+}
+
+HostCache::Shard* HostCache::GetShard(const Key& key) const {
+  return shards_[KeyHash()(key) % shards_.size()].get();
+}
+
+HostCache::Entry* HostCache::LookupInternal(Shard* shard, const Key& key) {
+  shard->lock.AssertAcquired();
+  // Get() marks the entry as the most recently used.
+  auto it = shard->entries.Get(key);
+  return (it != shard->entries.end()) ? &it->second : nullptr;
 }
 
 void HostCache::Set(const Key& key,
@@ -163,51 +233,73 @@ void HostCache::Set(const Key& key,
                     base::TimeTicks now,
                     base::TimeDelta ttl) {
   TRACE_EVENT0("net", "HostCache::Set");
-  DCHECK(CalledOnValidThread());
+  DCHECK(thread_checker_.CalledOnValidThread());
   if (caching_is_disabled())
     return;
 
-  auto it = entries_.find(key);
-  if (it != entries_.end()) {
-    bool is_stale = it->second.IsStale(now, network_changes_);
+  Shard* shard = GetShard(key);
+  base::AutoLock auto_lock(shard->lock);
+  auto it = shard->entries.Peek(key);
+  if (it != shard->entries.end()) {
+    bool is_stale = it->second.IsStale(now, network_changes());
     RecordSet(is_stale ? SET_UPDATE_STALE : SET_UPDATE_VALID, now, &it->second,
               entry);
     // TODO(juliatuttle): Remember some old metadata (hit count or frequency or
     // something like that) if it's useful for better eviction algorithms?
-    entries_.erase(it);
+    shard->entries.Erase(it);
   } else {
-    if (size() == max_entries_)
-      EvictOneEntry(now);
+    if (shard->entries.size() == shard->max_entries)
+      EvictOneEntry(shard, now);
     RecordSet(SET_INSERT, now, nullptr, entry);
   }
 
-  DCHECK_GT(max_entries_, size());
-  DCHECK_EQ(0u, entries_.count(key));
-  entries_.insert(
-      std::make_pair(Key(key), Entry(entry, now, ttl, network_changes_)));
-  DCHECK_GE(max_entries_, size());
+  DCHECK_GT(shard->max_entries, shard->entries.size());
+  DCHECK(shard->entries.Peek(key) == shard->entries.end());
+  shard->entries.Put(key, Entry(entry, now, ttl, network_changes()));
+  DCHECK_GE(shard->max_entries, shard->entries.size());
 }
 
 void HostCache::OnNetworkChange() {
-  ++network_changes_;
+  DCHECK(thread_checker_.CalledOnValidThread());
+  base::subtle::NoBarrier_Store(&network_changes_, network_changes() + 1);
 }
 
 void HostCache::clear() {
-  DCHECK(CalledOnValidThread());
-  RecordEraseAll(ERASE_CLEAR, base::TimeTicks::Now());
-  entries_.clear();
+  DCHECK(thread_checker_.CalledOnValidThread());
+  const base::TimeTicks now = base::TimeTicks::Now();
+  for (const auto& shard : shards_) {
+    base::AutoLock auto_lock(shard->lock);
+    RecordEraseAll(ERASE_CLEAR, now, shard->entries);
+    shard->entries.Clear();
+  }
 }
 
 size_t HostCache::size() const {
-  DCHECK(CalledOnValidThread());
-  return entries_.size();
+  DCHECK(thread_checker_.CalledOnValidThread());
+  size_t size = 0;
+  for (const auto& shard : shards_) {
+    base::AutoLock auto_lock(shard->lock);
+    size += shard->entries.size();
+  }
+  return size;
 }
 
 size_t HostCache::max_entries() const {
-  DCHECK(CalledOnValidThread());
+  DCHECK(thread_checker_.CalledOnValidThread());
   return max_entries_;
 }
 
+HostCache::EntryList HostCache::GetEntries() const {
+  DCHECK(thread_checker_.CalledOnValidThread());
+  EntryList entries;
+  for (const auto& shard : shards_) {
+    base::AutoLock auto_lock(shard->lock);
+    entries.insert(entries.end(), shard->entries.begin(),
+                   shard->entries.end());
+  }
+  return entries;
+}
+
 // static
 std::unique_ptr<HostCache> HostCache::CreateDefaultCache() {
 // Cache capacity is determined by the field trial.
@@ -225,17 +317,13 @@ std::unique_ptr<HostCache> HostCache::CreateDefaultCache() {
   return base::WrapUnique(new HostCache(max_entries));
 }
 
-void HostCache::EvictOneEntry(base::TimeTicks now) {
-  DCHECK_LT(0u, entries_.size());
-
-  auto oldest_it = entries_.begin();
-  for (auto it = entries_.begin(); it != entries_.end(); ++it) {
-    if (it->second.expires() < oldest_it->second.expires())
-      oldest_it = it;
-  }
+void HostCache::EvictOneEntry(Shard* shard, base::TimeTicks now) {
+  shard->lock.AssertAcquired();
+  DCHECK_LT(0u, shard->entries.size());
 
-  RecordErase(ERASE_EVICT, now, oldest_it->second);
-  entries_.erase(oldest_it);
+  auto least_recent_it = shard->entries.rbegin();
+  RecordErase(ERASE_EVICT, now, least_recent_it->second);
+  shard->entries.Erase(least_recent_it);
 }
 
 void HostCache::RecordSet(SetOutcome outcome,
@@ -250,7 +338,7 @@ void HostCache::RecordSet(SetOutcome outcome,
       break;
     case SET_UPDATE_STALE: {
       EntryStaleness stale;
-      old_entry->GetStaleness(now, network_changes_, &stale);
+      old_entry->GetStaleness(now, network_changes(), &stale);
       CACHE_HISTOGRAM_TIME("UpdateStale.ExpiredBy", stale.expired_by);
       CACHE_HISTOGRAM_COUNT("UpdateStale.NetworkChanges",
                             stale.network_changes);
@@ -311,7 +399,7 @@ void HostCache::RecordLookup(LookupOutcome outcome,
     case LOOKUP_HIT_STALE:
       CACHE_HISTOGRAM_TIME("LookupStale.ExpiredBy", now - entry->expires());
       CACHE_HISTOGRAM_COUNT("LookupStale.NetworkChanges",
-                            network_changes_ - entry->network_changes());
+                            network_changes() - entry->network_changes());
       break;
     case MAX_LOOKUP_OUTCOME:
       NOTREACHED();
@@ -323,7 +411,7 @@ void HostCache::RecordErase(EraseReason reason,
                             base::TimeTicks now,
                             const Entry& entry) {
   HostCache::EntryStaleness stale;
-  entry.GetStaleness(now, network_changes_, &stale);
+  entry.GetStaleness(now, network_changes(), &stale);
   CACHE_HISTOGRAM_ENUM("Erase", reason, MAX_ERASE_REASON);
   if (stale.is_stale()) {
     CACHE_HISTOGRAM_TIME("EraseStale.ExpiredBy", stale.expired_by);
@@ -334,8 +422,10 @@ void HostCache::RecordErase(EraseReason reason,
   }
 }
 
-void HostCache::RecordEraseAll(EraseReason reason, base::TimeTicks now) {
-  for (const auto& it : entries_)
+void HostCache::RecordEraseAll(EraseReason reason,
+                               base::TimeTicks now,
+                               const EntryMap& entries) {
+  for (const auto& it : entries)
     RecordErase(reason, now, it.second);
 }
 
@@ -11,10 +11,15 @@
 #include <memory>
 #include <string>
 #include <tuple>
+#include <utility>
+#include <vector>
 
+#include "base/atomicops.h"
+#include "base/containers/mru_cache.h"
 #include "base/gtest_prod_util.h"
 #include "base/macros.h"
-#include "base/threading/non_thread_safe.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/thread_checker.h"
 #include "base/time/time.h"
 #include "net/base/address_family.h"
 #include "net/base/address_list.h"
@@ -25,7 +30,15 @@
 namespace net {
 
 // Cache used by HostResolver to map hostnames to their resolved result.
-class NET_EXPORT HostCache : NON_EXPORTED_BASE(public base::NonThreadSafe) {
+// Entries are hashed by Key, and when the cache is full the least recently
+// used entry is evicted, so that lookups, insertions and evictions all take
+// constant time regardless of the number of entries.
+//
+// A large cache is split into shards by the hash of the Key, each with its own
+// lock and least recently used order, so that LookupStaleOnAnyThread() calls
+// from several threads rarely contend. Everything else must be called on the
+// thread that created the cache, which is the only one that modifies it.
+class NET_EXPORT HostCache {
  public:
   struct Key {
     Key(const std::string& hostname, AddressFamily address_family,
@@ -44,11 +57,21 @@ class NET_EXPORT HostCache : NON_EXPORTED_BASE(public base::NonThreadSafe) {
                       other.hostname);
     }
 
+    bool operator==(const Key& other) const {
+      return address_family == other.address_family &&
+             host_resolver_flags == other.host_resolver_flags &&
+             hostname == other.hostname;
+    }
+
     std::string hostname;
     AddressFamily address_family;
     HostResolverFlags host_resolver_flags;
   };
 
+  struct NET_EXPORT KeyHash {
+    size_t operator()(const Key& key) const;
+  };
+
   struct NET_EXPORT EntryStaleness {
     // Time since the entry's TTL has expired. Negative if not expired.
     base::TimeDelta expired_by;
@@ -112,7 +135,8 @@ class NET_EXPORT HostCache : NON_EXPORTED_BASE(public base::NonThreadSafe) {
     int stale_hits_;
   };
 
-  using EntryMap = std::map<Key, Entry>;
+  // A copy of the entries of the cache. See GetEntries().
+  using EntryList = std::vector<std::pair<Key, Entry>>;
 
   // Constructs a HostCache that stores up to |max_entries|.
   explicit HostCache(size_t max_entries);
@@ -120,7 +144,8 @@ class NET_EXPORT HostCache : NON_EXPORTED_BASE(public base::NonThreadSafe) {
   ~HostCache();
 
   // Returns a pointer to the entry for |key|, which is valid at time
-  // |now|. If there is no such entry, returns NULL.
+  // |now|. If there is no such entry, returns NULL. The pointer stays valid
+  // until the cache is next modified.
   const Entry* Lookup(const Key& key, base::TimeTicks now);
 
   // Returns a pointer to the entry for |key|, whether it is valid or stale at
@@ -130,6 +155,13 @@ class NET_EXPORT HostCache : NON_EXPORTED_BASE(public base::NonThreadSafe) {
                            base::TimeTicks now,
                            EntryStaleness* stale_out);
 
+  // Like LookupStale(), but may be called on any thread, and copies the entry
+  // to |entry_out|. Returns false if there is no entry for |key|.
+  bool LookupStaleOnAnyThread(const Key& key,
+                              base::TimeTicks now,
+                              Entry* entry_out,
+                              EntryStaleness* stale_out);
+
   // Overwrites or creates an entry for |key|.
   // |entry| is the value to set, |now| is the current time
   // |ttl| is the "time to live".
@@ -150,7 +182,9 @@ class NET_EXPORT HostCache : NON_EXPORTED_BASE(public base::NonThreadSafe) {
   // Following are used by net_internals UI.
   size_t max_entries() const;
 
-  const EntryMap& entries() const { return entries_; }
+  // Returns a copy of all the entries. Within each shard they are ordered from
+  // the most to the least recently used.
+  EntryList GetEntries() const;
 
   // Creates a default cache.
   static std::unique_ptr<HostCache> CreateDefaultCache();
@@ -162,7 +196,27 @@ class NET_EXPORT HostCache : NON_EXPORTED_BASE(public base::NonThreadSafe) {
   enum LookupOutcome : int;
   enum EraseReason : int;
 
-  Entry* LookupInternal(const Key& key);
+  // Iterates from the most to the least recently used entry.
+  using EntryMap = base::HashingMRUCache<Key, Entry, KeyHash>;
+
+  // Part of the entries, and the lock for all accesses to them.
+  struct Shard {
+    explicit Shard(size_t max_entries);
+    ~Shard();
+
+    base::Lock lock;
+    EntryMap entries;
+    const size_t max_entries;
+  };
+
+  Shard* GetShard(const Key& key) const;
+
+  // Looks up |key| in |shard|, which must be locked.
+  Entry* LookupInternal(Shard* shard, const Key& key);
+
+  int network_changes() const {
+    return base::subtle::NoBarrier_Load(&network_changes_);
+  }
 
   void RecordSet(SetOutcome outcome,
                  base::TimeTicks now,
@@ -174,18 +228,25 @@ class NET_EXPORT HostCache : NON_EXPORTED_BASE(public base::NonThreadSafe) {
                     base::TimeTicks now,
                     const Entry* entry);
   void RecordErase(EraseReason reason, base::TimeTicks now, const Entry& entry);
-  void RecordEraseAll(EraseReason reason, base::TimeTicks now);
+  void RecordEraseAll(EraseReason reason,
+                      base::TimeTicks now,
+                      const EntryMap& entries);
 
   // Returns true if this HostCache can contain no entries.
   bool caching_is_disabled() const { return max_entries_ == 0; }
 
-  void EvictOneEntry(base::TimeTicks now);
+  // Evicts the least recently used entry of |shard|, which must be locked.
+  void EvictOneEntry(Shard* shard, base::TimeTicks now);
+
+  const size_t max_entries_;
+  // Maps the hostnames (presumably in lowercase canonicalized format) to
+  // their resolved result entries, split by hash of the Key. Set at
+  // construction and never resized.
+  std::vector<std::unique_ptr<Shard>> shards_;
+  // Only modified on the owning thread, but read by the lookups of any thread.
+  base::subtle::Atomic32 network_changes_;
 
-  // Map from hostname (presumably in lowercase canonicalized format) to
-  // a resolved result entry.
-  EntryMap entries_;
-  size_t max_entries_;
-  int network_changes_;
+  base::ThreadChecker thread_checker_;
 
   DISALLOW_COPY_AND_ASSIGN(HostCache);
 };
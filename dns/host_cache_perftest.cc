@@ -0,0 +1,153 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/memory/ptr_util.h"
+#include "base/rand_util.h"
+#include "base/single_thread_task_runner.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/perf_log.h"
+#include "base/test/perf_time_logger.h"
+#include "base/threading/thread.h"
+#include "base/time/time.h"
+#include "net/base/net_errors.h"
+#include "net/dns/host_cache.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const size_t kMaxEntries = 1000000;
+const int kNumOperations = 1000000;
+// One in this many operations is a miss that resolves and inserts a new
+// hostname, evicting the least recently used one.
+const int kChurnInterval = 10;
+// Threads reading the cache concurrently with the churn, and the lookups each
+// of them makes.
+const int kNumReaderThreads = 4;
+const int kNumReads = 250000;
+
+HostCache::Key MakeKey(int i) {
+  return HostCache::Key(base::StringPrintf("host%d.example.com", i),
+                        ADDRESS_FAMILY_UNSPECIFIED, 0);
+}
+
+void LogPercentile(const char* name,
+                   std::vector<base::TimeDelta>* latencies,
+                   double percentile) {
+  size_t index = static_cast<size_t>(latencies->size() * percentile);
+  index = std::min(index, latencies->size() - 1);
+  std::nth_element(latencies->begin(), latencies->begin() + index,
+                   latencies->end());
+  base::LogPerfResult(name, (*latencies)[index].InMicrosecondsF(), "us");
+}
+
+// Looks up random keys among the first |num_hosts|, recording the latency of
+// each lookup.
+void ReadFromOtherThread(HostCache* cache,
+                         int num_hosts,
+                         base::TimeTicks now,
+                         std::vector<base::TimeDelta>* latencies) {
+  latencies->reserve(kNumReads);
+  HostCache::Entry entry(OK, AddressList());
+  for (int i = 0; i < kNumReads; ++i) {
+    const HostCache::Key key = MakeKey(base::RandInt(0, num_hosts - 1));
+    base::TimeTicks start = base::TimeTicks::Now();
+    cache->LookupStaleOnAnyThread(key, now, &entry, nullptr);
+    latencies->push_back(base::TimeTicks::Now() - start);
+  }
+}
+
+}  // namespace
+
+// Fills a cache to capacity, then replays a mix of lookups and insertions of
+// new hostnames against it, recording the latency of each operation.
+TEST(HostCachePerfTest, LookupUnderChurn) {
+  HostCache cache(kMaxEntries);
+  const HostCache::Entry entry(OK, AddressList());
+  const base::TimeDelta ttl = base::TimeDelta::FromHours(1);
+  base::TimeTicks now = base::TimeTicks::Now();
+
+  {
+    base::PerfTimeLogger timer("Fill host cache");
+    for (size_t i = 0; i < kMaxEntries; ++i)
+      cache.Set(MakeKey(i), entry, now, ttl);
+    timer.Done();
+  }
+  ASSERT_EQ(kMaxEntries, cache.size());
+
+  // Build the keys up front, so that only cache operations are timed.
+  int next_host = kMaxEntries;
+  std::vector<HostCache::Key> keys;
+  keys.reserve(kNumOperations);
+  for (int i = 0; i < kNumOperations; ++i) {
+    if (i % kChurnInterval == 0)
+      keys.push_back(MakeKey(next_host++));
+    else
+      keys.push_back(MakeKey(base::RandInt(next_host - kMaxEntries,
+                                           next_host - 1)));
+  }
+
+  std::vector<base::TimeDelta> latencies;
+  latencies.reserve(kNumOperations);
+  base::PerfTimeLogger timer("Host cache lookups under churn");
+  for (const HostCache::Key& key : keys) {
+    base::TimeTicks start = base::TimeTicks::Now();
+    if (!cache.Lookup(key, now))
+      cache.Set(key, entry, now, ttl);
+    latencies.push_back(base::TimeTicks::Now() - start);
+  }
+  timer.Done();
+  EXPECT_EQ(kMaxEntries, cache.size());
+
+  LogPercentile("Host cache operation p50", &latencies, 0.50);
+  LogPercentile("Host cache operation p99", &latencies, 0.99);
+}
+
+// Reads a full cache from several threads while the owning thread keeps
+// inserting new hostnames into it.
+TEST(HostCachePerfTest, LookupOnAnyThreadUnderChurn) {
+  HostCache cache(kMaxEntries);
+  const HostCache::Entry entry(OK, AddressList());
+  const base::TimeDelta ttl = base::TimeDelta::FromHours(1);
+  base::TimeTicks now = base::TimeTicks::Now();
+  for (size_t i = 0; i < kMaxEntries; ++i)
+    cache.Set(MakeKey(i), entry, now, ttl);
+
+  std::vector<std::unique_ptr<base::Thread>> threads;
+  std::vector<std::vector<base::TimeDelta>> reader_latencies(kNumReaderThreads);
+  base::PerfTimeLogger timer("Host cache lookups on other threads");
+  for (int i = 0; i < kNumReaderThreads; ++i) {
+    threads.push_back(base::WrapUnique(new base::Thread("HostCacheReader")));
+    ASSERT_TRUE(threads.back()->Start());
+    threads.back()->task_runner()->PostTask(
+        FROM_HERE, base::Bind(&ReadFromOtherThread, &cache,
+                              static_cast<int>(kMaxEntries), now,
+                              &reader_latencies[i]));
+  }
+  for (int i = 0; i < kNumOperations / kChurnInterval; ++i)
+    cache.Set(MakeKey(kMaxEntries + i), entry, now, ttl);
+  for (const auto& thread : threads)
+    thread->Stop();
+  timer.Done();
+
+  std::vector<base::TimeDelta> latencies;
+  for (const auto& thread_latencies : reader_latencies) {
+    latencies.insert(latencies.end(), thread_latencies.begin(),
+                     thread_latencies.end());
+  }
+  LogPercentile("Host cache concurrent lookup p50", &latencies, 0.50);
+  LogPercentile("Host cache concurrent lookup p99", &latencies, 0.99);
+}
+
+}  // namespace net
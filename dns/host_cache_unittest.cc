@@ -4,10 +4,14 @@
 
 #include "net/dns/host_cache.h"
 
+#include "base/bind.h"
 #include "base/format_macros.h"
+#include "base/location.h"
+#include "base/single_thread_task_runner.h"
 #include "base/stl_util.h"
 #include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
+#include "base/threading/thread.h"
 #include "net/base/net_errors.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -22,6 +26,15 @@ HostCache::Key Key(const std::string& hostname) {
   return HostCache::Key(hostname, ADDRESS_FAMILY_UNSPECIFIED, 0);
 }
 
+void LookupStaleOnAnyThread(HostCache* cache,
+                            const HostCache::Key& key,
+                            base::TimeTicks now,
+                            bool* found,
+                            HostCache::Entry* entry,
+                            HostCache::EntryStaleness* stale) {
+  *found = cache->LookupStaleOnAnyThread(key, now, entry, stale);
+}
+
 }  // namespace
 
 TEST(HostCacheTest, Basic) {
@@ -296,8 +309,8 @@ TEST(HostCacheTest, Clear) {
   EXPECT_EQ(0u, cache.size());
 }
 
-// Try to add too many entries to cache; it should evict the one with the oldest
-// expiration time.
+// Try to add too many entries to cache; it should evict the least recently
+// used one.
 TEST(HostCacheTest, Evict) {
   HostCache cache(2);
 
@@ -313,7 +326,7 @@ TEST(HostCacheTest, Evict) {
   EXPECT_FALSE(cache.Lookup(key2, now));
   EXPECT_FALSE(cache.Lookup(key3, now));
 
-  // |key1| expires in 10 seconds, but |key2| in just 5.
+  // |key2| expires sooner, but |key1| is the least recently used.
   cache.Set(key1, entry, now, base::TimeDelta::FromSeconds(10));
   cache.Set(key2, entry, now, base::TimeDelta::FromSeconds(5));
   EXPECT_EQ(2u, cache.size());
@@ -321,12 +334,20 @@ TEST(HostCacheTest, Evict) {
   EXPECT_TRUE(cache.Lookup(key2, now));
   EXPECT_FALSE(cache.Lookup(key3, now));
 
-  // |key2| should be chosen for eviction, since it expires sooner.
+  // |key1| should be chosen for eviction.
   cache.Set(key3, entry, now, base::TimeDelta::FromSeconds(10));
   EXPECT_EQ(2u, cache.size());
-  EXPECT_TRUE(cache.Lookup(key1, now));
-  EXPECT_FALSE(cache.Lookup(key2, now));
+  EXPECT_FALSE(cache.Lookup(key1, now));
+  EXPECT_TRUE(cache.Lookup(key2, now));
   EXPECT_TRUE(cache.Lookup(key3, now));
+
+  // Looking up |key2| makes |key3| the next to be evicted.
+  EXPECT_TRUE(cache.Lookup(key2, now));
+  cache.Set(key1, entry, now, base::TimeDelta::FromSeconds(10));
+  EXPECT_EQ(2u, cache.size());
+  EXPECT_TRUE(cache.Lookup(key1, now));
+  EXPECT_TRUE(cache.Lookup(key2, now));
+  EXPECT_FALSE(cache.Lookup(key3, now));
 }
 
 // Try to retrieve stale entries from the cache. They should be returned by
@@ -395,6 +416,47 @@ TEST(HostCacheTest, Stale) {
   EXPECT_EQ(3, stale.stale_hits);
 }
 
+// A large cache is split into shards, which together hold no more than the
+// cache's capacity, and can be read from other threads.
+TEST(HostCacheTest, LookupStaleOnAnyThread) {
+  const base::TimeDelta kTTL = base::TimeDelta::FromSeconds(10);
+  const size_t kLargeCacheEntries = 1000;
+
+  HostCache cache(kLargeCacheEntries);
+  base::TimeTicks now;
+  HostCache::Entry entry = HostCache::Entry(OK, AddressList());
+
+  for (size_t i = 0; i < 2 * kLargeCacheEntries; ++i) {
+    cache.Set(Key(base::StringPrintf("foobar%" PRIuS ".com", i)), entry, now,
+              kTTL);
+  }
+  EXPECT_LE(cache.size(), kLargeCacheEntries);
+  EXPECT_EQ(cache.size(), cache.GetEntries().size());
+
+  const HostCache::Key key = Key("foobar.com");
+  cache.Set(key, entry, now, kTTL);
+
+  bool found = false;
+  HostCache::Entry found_entry(ERR_FAILED, AddressList());
+  HostCache::EntryStaleness stale;
+  base::Thread thread("HostCacheTest");
+  ASSERT_TRUE(thread.Start());
+  now += base::TimeDelta::FromSeconds(15);
+  thread.task_runner()->PostTask(
+      FROM_HERE,
+      base::Bind(&LookupStaleOnAnyThread, &cache, key, now, &found,
+                 &found_entry, &stale));
+  thread.Stop();
+
+  EXPECT_TRUE(found);
+  EXPECT_EQ(OK, found_entry.error());
+  EXPECT_TRUE(stale.is_stale());
+  EXPECT_EQ(base::TimeDelta::FromSeconds(5), stale.expired_by);
+  EXPECT_EQ(1, stale.stale_hits);
+  EXPECT_FALSE(cache.LookupStaleOnAnyThread(Key("missing.com"), now,
+                                            &found_entry, &stale));
+}
+
 // Tests the less than and equal operators for HostCache::Key work.
 TEST(HostCacheTest, KeyComparators) {
   struct {
@@ -12,6 +12,7 @@
 #include <string>
 
 #include "base/macros.h"
+#include "base/time/time.h"
 #include "net/base/address_family.h"
 #include "net/base/completion_callback.h"
 #include "net/base/host_port_pair.h"
@@ -49,6 +50,9 @@ class NET_EXPORT HostResolver {
   // resolution. Pass HostResolver::kDefaultRetryAttempts to choose a default
   // value.
   // |enable_caching| controls whether a HostCache is used.
+  // |stale_while_revalidate| is how long past its TTL a successful cached
+  // result may still be returned by Resolve(), while the name is resolved
+  // again in the background. Zero disables serving stale results.
   struct NET_EXPORT Options {
     Options();
 
@@ -57,6 +61,7 @@ class NET_EXPORT HostResolver {
     size_t max_concurrent_resolves;
     size_t max_retry_attempts;
     bool enable_caching;
+    base::TimeDelta stale_while_revalidate;
   };
 
   // The parameters for doing a Resolve(). A hostname and port are
@@ -323,6 +323,20 @@ bool IsAllIPv4Loopback(const AddressList& addresses) {
   return true;
 }
 
+// Looks up the lower case |hostname| in the HOSTS entries of |config|.
+bool LookupHosts(const DnsConfig& config,
+                 const std::string& hostname,
+                 AddressFamily family,
+                 IPAddress* address) {
+  if (config.hosts_index)
+    return config.hosts_index->Lookup(hostname, family, address);
+  DnsHosts::const_iterator it = config.hosts.find(DnsHostsKey(hostname, family));
+  if (it == config.hosts.end())
+    return false;
+  *address = it->second;
+  return true;
+}
+
 // Creates NetLog parameters when the resolve failed.
 std::unique_ptr<base::Value> NetLogProcTaskFailedCallback(
     uint32_t attempt_number,
@@ -1288,6 +1302,7 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
         priority_tracker_(priority),
         worker_task_runner_(std::move(worker_task_runner)),
         had_non_speculative_request_(false),
+        is_cache_refresh_(false),
         had_dns_config_(false),
         num_occupied_job_slots_(0),
         dns_task_error_(OK),
@@ -1380,6 +1395,8 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
     UpdatePriority();
   }
 
+  void set_is_cache_refresh() { is_cache_refresh_ = true; }
+
   void ChangeRequestPriority(Request* req, RequestPriority priority) {
     DCHECK_EQ(key_.hostname, req->info().hostname());
     DCHECK(!req->was_canceled());
@@ -1391,7 +1408,8 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
   }
 
   // Marks |req| as cancelled. If it was the last active Request, also finishes
-  // this Job, marking it as cancelled, and deletes it.
+  // this Job, marking it as cancelled, and deletes it, unless the Job is a
+  // cache refresh.
   void CancelRequest(Request* req) {
     DCHECK_EQ(key_.hostname, req->info().hostname());
     DCHECK(!req->was_canceled());
@@ -1406,7 +1424,7 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
                                  req->source_net_log().source(),
                                  priority()));
 
-    if (num_active_requests() > 0) {
+    if (num_active_requests() > 0 || is_cache_refresh_) {
       UpdatePriority();
     } else {
       // If we were called from a Request's callback within CompleteRequests,
@@ -1449,7 +1467,11 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
   // Attempts to serve the job from HOSTS. Returns true if succeeded and
   // this Job was destroyed.
   bool ServeFromHosts() {
-    DCHECK_GT(num_active_requests(), 0u);
+    DCHECK(num_active_requests() > 0 || is_cache_refresh_);
+    // A cache refresh that no Request has joined has no RequestInfo to serve
+    // from HOSTS with, and is left to resolve.
+    if (requests_.empty())
+      return false;
     AddressList addr_list;
     if (resolver_->ServeFromHosts(key(),
                                   requests_.front()->info(),
@@ -1752,7 +1774,19 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
       handle_.Reset();
     }
 
+    bool did_complete = (entry.error() != ERR_NETWORK_CHANGED) &&
+                        (entry.error() != ERR_HOST_RESOLVER_QUEUE_TOO_LARGE);
+
     if (num_active_requests() == 0) {
+      // A cache refresh is never cancelled, so only an actual result or an
+      // abort can get here.
+      if (is_cache_refresh_) {
+        net_log_.EndEventWithNetErrorCode(NetLog::TYPE_HOST_RESOLVER_IMPL_JOB,
+                                          entry.error());
+        if (did_complete)
+          resolver_->CacheResult(key_, entry, ttl);
+        return;
+      }
       net_log_.AddEvent(NetLog::TYPE_CANCELLED);
       net_log_.EndEventWithNetErrorCode(NetLog::TYPE_HOST_RESOLVER_IMPL_JOB,
                                         OK);
@@ -1771,8 +1805,6 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
                             resolver_->received_dns_config_);
     }
 
-    bool did_complete = (entry.error() != ERR_NETWORK_CHANGED) &&
-                        (entry.error() != ERR_HOST_RESOLVER_QUEUE_TOO_LARGE);
     if (did_complete)
       resolver_->CacheResult(key_, entry, ttl);
 
@@ -1829,6 +1861,11 @@ class HostResolverImpl::Job : public PrioritizedDispatcher::Job,
 
   bool had_non_speculative_request_;
 
+  // True if this Job was started to refresh a stale cache entry that was
+  // served in its place. It then runs to completion and caches its result
+  // even when no Request is waiting for it.
+  bool is_cache_refresh_;
+
   // Distinguishes measurements taken while DnsClient was fully configured.
   bool had_dns_config_;
 
@@ -1927,14 +1964,28 @@ int HostResolverImpl::Resolve(const RequestInfo& info,
   // outstanding jobs map.
   Key key = GetEffectiveKeyForRequest(info, ip_address_ptr, source_net_log);
 
-  int rv = ResolveHelper(key, info, ip_address_ptr, addresses, false, nullptr,
-                         source_net_log);
+  // Only look for a stale entry to serve if it could be served, so that the
+  // cache records a plain miss otherwise.
+  HostCache::EntryStaleness stale;
+  const HostCache::Entry* stale_entry = nullptr;
+  const bool serve_stale = !stale_while_revalidate_.is_zero();
+  int rv = ResolveHelper(key, info, ip_address_ptr, addresses, false,
+                         serve_stale ? &stale : nullptr,
+                         serve_stale ? &stale_entry : nullptr, source_net_log);
   if (rv != ERR_DNS_CACHE_MISS) {
     LogFinishRequest(source_net_log, info, rv);
     RecordTotalTime(HaveDnsConfig(), info.is_speculative(), base::TimeDelta());
     return rv;
   }
 
+  if (stale_entry && ServeStaleAndRefresh(key, info, stale_entry, stale,
+                                          addresses, source_net_log)) {
+    source_net_log.AddEvent(NetLog::TYPE_HOST_RESOLVER_IMPL_CACHE_HIT);
+    LogFinishRequest(source_net_log, info, OK);
+    RecordTotalTime(HaveDnsConfig(), info.is_speculative(), base::TimeDelta());
+    return OK;
+  }
+
   // Next we need to attach our request to a "job". This job is responsible for
   // calling "getaddrinfo(hostname)" on a worker thread.
 
@@ -1976,7 +2027,8 @@ HostResolverImpl::HostResolverImpl(
     const Options& options,
     NetLog* net_log,
     scoped_refptr<base::TaskRunner> worker_task_runner)
-    : max_queued_jobs_(0),
+    : stale_while_revalidate_(options.stale_while_revalidate),
+      max_queued_jobs_(0),
       proc_params_(NULL, options.max_retry_attempts),
       net_log_(net_log),
       received_dns_config_(false),
@@ -2039,8 +2091,10 @@ int HostResolverImpl::ResolveHelper(const Key& key,
                                     AddressList* addresses,
                                     bool allow_stale,
                                     HostCache::EntryStaleness* stale_info,
+                                    const HostCache::Entry** stale_entry,
                                     const BoundNetLog& source_net_log) {
-  DCHECK(allow_stale == !!stale_info);
+  DCHECK(allow_stale || (!!stale_info == !!stale_entry));
+  DCHECK(!allow_stale || (stale_info && !stale_entry));
   // The result of |getaddrinfo| for empty hosts is inconsistent across systems.
   // On Windows it gives the default interface's address, whereas on Linux it
   // gives an error. We will make it fail on all platforms for consistency.
@@ -2054,8 +2108,8 @@ int HostResolverImpl::ResolveHelper(const Key& key,
     MakeNotStale(stale_info);
     return net_error;
   }
-  if (ServeFromCache(key, info, &net_error, addresses, allow_stale,
-                     stale_info)) {
+  if (ServeFromCache(key, info, &net_error, addresses, allow_stale, stale_info,
+                     stale_entry)) {
     source_net_log.AddEvent(NetLog::TYPE_HOST_RESOLVER_IMPL_CACHE_HIT);
     // |ServeFromCache()| will set |*stale_info| as needed.
     return net_error;
@@ -2093,7 +2147,7 @@ int HostResolverImpl::ResolveFromCache(const RequestInfo& info,
   Key key = GetEffectiveKeyForRequest(info, ip_address_ptr, source_net_log);
 
   int rv = ResolveHelper(key, info, ip_address_ptr, addresses, false, nullptr,
-                         source_net_log);
+                         nullptr, source_net_log);
   LogFinishRequest(source_net_log, info, rv);
   return rv;
 }
@@ -2166,7 +2220,7 @@ int HostResolverImpl::ResolveStaleFromCache(
   Key key = GetEffectiveKeyForRequest(info, ip_address_ptr, source_net_log);
 
   int rv = ResolveHelper(key, info, ip_address_ptr, addresses, true, stale_info,
-                         source_net_log);
+                         nullptr, source_net_log);
   LogFinishRequest(source_net_log, info, rv);
   return rv;
 }
@@ -2200,21 +2254,26 @@ bool HostResolverImpl::ServeFromCache(const Key& key,
                                       int* net_error,
                                       AddressList* addresses,
                                       bool allow_stale,
-                                      HostCache::EntryStaleness* stale_info) {
+                                      HostCache::EntryStaleness* stale_info,
+                                      const HostCache::Entry** stale_entry) {
   DCHECK(addresses);
   DCHECK(net_error);
-  DCHECK(allow_stale == !!stale_info);
   if (!info.allow_cached_response() || !cache_.get())
     return false;
 
   const HostCache::Entry* cache_entry;
-  if (allow_stale)
+  if (allow_stale || stale_entry)
     cache_entry = cache_->LookupStale(key, base::TimeTicks::Now(), stale_info);
   else
     cache_entry = cache_->Lookup(key, base::TimeTicks::Now());
   if (!cache_entry)
     return false;
 
+  if (!allow_stale && stale_entry && stale_info->is_stale()) {
+    *stale_entry = cache_entry;
+    return false;
+  }
+
   *net_error = cache_entry->error();
   if (*net_error == OK) {
     if (cache_entry->has_ttl())
@@ -2224,6 +2283,43 @@ bool HostResolverImpl::ServeFromCache(const Key& key,
   return true;
 }
 
+bool HostResolverImpl::ServeStaleAndRefresh(
+    const Key& key,
+    const RequestInfo& info,
+    const HostCache::Entry* stale_entry,
+    const HostCache::EntryStaleness& stale,
+    AddressList* addresses,
+    const BoundNetLog& source_net_log) {
+  DCHECK(stale_entry);
+  DCHECK(addresses);
+  // Results from before a network change may be wrong rather than just old,
+  // and failures are cheap enough to retry that they are not served stale.
+  if (stale_entry->error() != OK || stale.network_changes > 0 ||
+      stale.expired_by >= stale_while_revalidate_) {
+    return false;
+  }
+  *addresses = EnsurePortOnAddressList(stale_entry->addresses(), info.port());
+
+  if (jobs_.find(key) != jobs_.end())
+    return true;
+
+  Job* job = new Job(weak_ptr_factory_.GetWeakPtr(), key, IDLE,
+                     worker_task_runner_, source_net_log);
+  job->set_is_cache_refresh();
+  job->Schedule(false);
+
+  // Check for queue overflow.
+  if (dispatcher_->num_queued_jobs() > max_queued_jobs_) {
+    Job* evicted = static_cast<Job*>(dispatcher_->EvictOldestLowest());
+    DCHECK(evicted);
+    evicted->OnEvicted();  // Deletes |evicted|.
+    if (evicted == job)
+      return true;
+  }
+  jobs_.insert(std::make_pair(key, job));
+  return true;
+}
+
 bool HostResolverImpl::ServeFromHosts(const Key& key,
                                       const RequestInfo& info,
                                       AddressList* addresses) {
@@ -2235,7 +2331,8 @@ bool HostResolverImpl::ServeFromHosts(const Key& key,
   // HOSTS lookups are case-insensitive.
   std::string hostname = base::ToLowerASCII(key.hostname);
 
-  const DnsHosts& hosts = dns_client_->GetConfig()->hosts;
+  const DnsConfig& config = *dns_client_->GetConfig();
+  IPAddress address;
 
   // If |address_family| is ADDRESS_FAMILY_UNSPECIFIED other implementations
   // (glibc and c-ares) return the first matching line. We have more
@@ -2244,18 +2341,14 @@ bool HostResolverImpl::ServeFromHosts(const Key& key,
   // necessary.
   if (key.address_family == ADDRESS_FAMILY_IPV6 ||
       key.address_family == ADDRESS_FAMILY_UNSPECIFIED) {
-    DnsHosts::const_iterator it = hosts.find(
-        DnsHostsKey(hostname, ADDRESS_FAMILY_IPV6));
-    if (it != hosts.end())
-      addresses->push_back(IPEndPoint(it->second, info.port()));
+    if (LookupHosts(config, hostname, ADDRESS_FAMILY_IPV6, &address))
+      addresses->push_back(IPEndPoint(address, info.port()));
   }
 
   if (key.address_family == ADDRESS_FAMILY_IPV4 ||
       key.address_family == ADDRESS_FAMILY_UNSPECIFIED) {
-    DnsHosts::const_iterator it = hosts.find(
-        DnsHostsKey(hostname, ADDRESS_FAMILY_IPV4));
-    if (it != hosts.end())
-      addresses->push_back(IPEndPoint(it->second, info.port()));
+    if (LookupHosts(config, hostname, ADDRESS_FAMILY_IPV4, &address))
+      addresses->push_back(IPEndPoint(address, info.port()));
   }
 
   // If got only loopback addresses and the family was restricted, resolve
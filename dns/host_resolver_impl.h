@@ -194,14 +194,18 @@ class NET_EXPORT HostResolverImpl
   // |stale_info| must be non-null, and will be filled in with details of the
   // entry's staleness (if an entry is returned).
   //
-  // If |allow_stale| is false, then stale cache entries will not be returned,
-  // and |stale_info| must be null.
+  // If |allow_stale| is false, then stale cache entries will not be returned.
+  // |stale_info| must then be null unless |stale_entry| is non-null, in which
+  // case a stale entry for |key| is returned through |*stale_entry| and
+  // |stale_info| instead of being served, so that the caller can still choose
+  // to serve it without looking it up again.
   int ResolveHelper(const Key& key,
                     const RequestInfo& info,
                     const IPAddress* ip_address,
                     AddressList* addresses,
                     bool allow_stale,
                     HostCache::EntryStaleness* stale_info,
+                    const HostCache::Entry** stale_entry,
                     const BoundNetLog& request_net_log);
 
   // Tries to resolve |key| as an IP, returns true and sets |net_error| if
@@ -220,14 +224,27 @@ class NET_EXPORT HostResolverImpl
   // |stale_info| must be non-null, and will be filled in with details of the
   // entry's staleness (if an entry is returned).
   //
-  // If |allow_stale| is false, then stale cache entries will not be returned,
-  // and |stale_info| must be null.
+  // If |allow_stale| is false, then stale cache entries will not be returned.
+  // |stale_info| and |stale_entry| are then used as in ResolveHelper().
   bool ServeFromCache(const Key& key,
                       const RequestInfo& info,
                       int* net_error,
                       AddressList* addresses,
                       bool allow_stale,
-                      HostCache::EntryStaleness* stale_info);
+                      HostCache::EntryStaleness* stale_info,
+                      const HostCache::Entry** stale_entry);
+
+  // If |stale_entry|, the stale cache entry for |key| returned by
+  // ResolveHelper(), is successful and expired less than
+  // |stale_while_revalidate_| ago on the current network, returns true, fills
+  // |addresses| from it, and starts a Job to refresh the entry unless one is
+  // already running for |key|. Otherwise returns false.
+  bool ServeStaleAndRefresh(const Key& key,
+                            const RequestInfo& info,
+                            const HostCache::Entry* stale_entry,
+                            const HostCache::EntryStaleness& stale,
+                            AddressList* addresses,
+                            const BoundNetLog& source_net_log);
 
   // If we have a DnsClient with a valid DnsConfig, and |key| is found in the
   // HOSTS file, returns true and fills |addresses|. Otherwise returns false.
@@ -307,6 +324,10 @@ class NET_EXPORT HostResolverImpl
   // Cache of host resolution results.
   std::unique_ptr<HostCache> cache_;
 
+  // How long past their TTL cached results may be served while they are
+  // refreshed. Zero if stale results are never served by Resolve().
+  base::TimeDelta stale_while_revalidate_;
+
   // Map from HostCache::Key to a Job.
   JobMap jobs_;
 
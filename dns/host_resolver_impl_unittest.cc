@@ -1448,6 +1448,61 @@ TEST_F(HostResolverImplTest, ResolveStaleFromCache) {
   EXPECT_TRUE(requests_[5]->staleness().is_stale());
 }
 
+// Test that Resolve() returns a recently expired result and refreshes it in
+// the background when |stale_while_revalidate| is set.
+TEST_F(HostResolverImplTest, StaleWhileRevalidate) {
+  HostResolver::Options options = DefaultOptions();
+  options.stale_while_revalidate = base::TimeDelta::FromMinutes(1);
+  resolver_.reset(new TestHostResolverImpl(options, NULL));
+  resolver_->set_proc_params_for_test(DefaultParams(proc_.get()));
+
+  proc_->AddRuleForAllFamilies("just.testing", "192.168.1.42");
+  proc_->SignalMultiple(1u);
+
+  HostResolver::RequestInfo info(HostPortPair("just.testing", 80));
+  EXPECT_THAT(CreateRequest(info, DEFAULT_PRIORITY)->Resolve(),
+              IsError(ERR_IO_PENDING));
+  EXPECT_THAT(requests_[0]->WaitForResult(), IsOk());
+
+  // Back-date the cached result so that it expired ten seconds ago.
+  HostCache* cache = resolver_->GetHostCache();
+  ASSERT_EQ(1u, cache->size());
+  const HostCache::EntryList entries = cache->GetEntries();
+  const HostCache::Key key = entries.begin()->first;
+  const HostCache::Entry entry = entries.begin()->second;
+  cache->Set(key, entry,
+             base::TimeTicks::Now() - base::TimeDelta::FromSeconds(20),
+             base::TimeDelta::FromSeconds(10));
+  EXPECT_EQ(ERR_DNS_CACHE_MISS,
+            CreateRequest(info, DEFAULT_PRIORITY)->ResolveFromCache());
+
+  // The stale result is served synchronously, and a refresh is started.
+  EXPECT_THAT(CreateRequest(info, DEFAULT_PRIORITY)->Resolve(), IsOk());
+  EXPECT_TRUE(requests_[2]->HasOneAddress("192.168.1.42", 80));
+
+  // A request that bypasses the cache joins the refresh.
+  HostResolver::RequestInfo uncached_info(info);
+  uncached_info.set_allow_cached_response(false);
+  EXPECT_THAT(CreateRequest(uncached_info, DEFAULT_PRIORITY)->Resolve(),
+              IsError(ERR_IO_PENDING));
+  proc_->SignalMultiple(1u);
+  EXPECT_THAT(requests_[3]->WaitForResult(), IsOk());
+  EXPECT_EQ(2u, proc_->GetCaptureList().size());
+
+  EXPECT_THAT(CreateRequest(info, DEFAULT_PRIORITY)->ResolveFromCache(),
+              IsOk());
+
+  // Results that expired longer ago than the window are not served.
+  cache->Set(key, entry,
+             base::TimeTicks::Now() - base::TimeDelta::FromMinutes(3),
+             base::TimeDelta::FromMinutes(1));
+  EXPECT_THAT(CreateRequest(info, DEFAULT_PRIORITY)->Resolve(),
+              IsError(ERR_IO_PENDING));
+  proc_->SignalMultiple(1u);
+  EXPECT_THAT(requests_[5]->WaitForResult(), IsOk());
+  EXPECT_EQ(3u, proc_->GetCaptureList().size());
+}
+
 // Test the retry attempts simulating host resolver proc that takes too long.
 TEST_F(HostResolverImplTest, MultipleAttempts) {
   // Total number of attempts would be 3 and we want the 3rd attempt to resolve
@@ -1847,6 +1902,32 @@ TEST_F(HostResolverImplDnsTest, ServeFromHosts) {
   EXPECT_TRUE(req6->HasOneAddress("127.0.0.1", 80));
 }
 
+TEST_F(HostResolverImplDnsTest, ServeFromHostsIndex) {
+  DnsConfig config = CreateValidDnsConfig();
+  config.hosts_index = DnsHostsIndex::CreateFromStringWithCommaModeForTesting(
+      "127.0.0.1 nx_ipv4 nx_both\n"
+      "::1 nx_ipv6 nx_both\n",
+      PARSE_HOSTS_COMMA_IS_TOKEN);
+  ChangeDnsConfig(config);
+
+  Request* req1 = CreateRequest("nx_ipv4", 80);
+  EXPECT_THAT(req1->Resolve(), IsOk());
+  EXPECT_TRUE(req1->HasOneAddress("127.0.0.1", 80));
+
+  Request* req2 = CreateRequest("nx_IPV6", 80);
+  EXPECT_THAT(req2->Resolve(), IsOk());
+  EXPECT_TRUE(req2->HasOneAddress("::1", 80));
+
+  Request* req3 = CreateRequest("nx_both", 80);
+  EXPECT_THAT(req3->Resolve(), IsOk());
+  EXPECT_TRUE(req3->HasAddress("127.0.0.1", 80) &&
+              req3->HasAddress("::1", 80));
+
+  Request* req4 = CreateRequest("nx_both", 80, MEDIUM, ADDRESS_FAMILY_IPV4);
+  EXPECT_THAT(req4->Resolve(), IsOk());
+  EXPECT_TRUE(req4->HasOneAddress("127.0.0.1", 80));
+}
+
 TEST_F(HostResolverImplDnsTest, BypassDnsTask) {
   ChangeDnsConfig(CreateValidDnsConfig());
 
@@ -0,0 +1,170 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/extras/sqlite/cookie_load_snapshot.h"
+
+#include <limits>
+
+#include "base/files/file_path.h"
+#include "base/files/important_file_writer.h"
+#include "base/logging.h"
+
+namespace net {
+
+namespace {
+
+const uint32_t kSnapshotMagic = 0x636b736e;  // "ckns"
+const uint32_t kSnapshotVersion = 1;
+
+// Keys and data blobs start on this boundary, so that readers may overlay
+// aligned structures on a blob.
+const size_t kAlignment = 8;
+
+size_t AlignedSize(size_t size) {
+  return (size + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+bool InBounds(uint64_t offset, uint64_t length, size_t file_length) {
+  return offset <= file_length && length <= file_length - offset;
+}
+
+}  // namespace
+
+// The file starts with a Header, followed by |num_keys| IndexEntries sorted by
+// key, followed by the keys and blobs they point to.
+struct CookieLoadSnapshot::Header {
+  uint32_t magic;
+  uint32_t version;
+  int64_t stamp;
+  uint64_t num_keys;
+};
+
+struct CookieLoadSnapshot::IndexEntry {
+  uint64_t key_offset;
+  uint64_t data_offset;
+  uint32_t key_length;
+  uint32_t data_length;
+};
+
+CookieLoadSnapshot::CookieLoadSnapshot() : index_(nullptr), num_keys_(0) {}
+
+CookieLoadSnapshot::~CookieLoadSnapshot() {}
+
+// static
+bool CookieLoadSnapshot::Write(const base::FilePath& path,
+                               int64_t stamp,
+                               const DataByKey& data) {
+  size_t size = sizeof(Header) + data.size() * sizeof(IndexEntry);
+  for (const auto& key_and_data : data) {
+    if (key_and_data.first.size() > std::numeric_limits<uint32_t>::max() ||
+        key_and_data.second.size() > std::numeric_limits<uint32_t>::max()) {
+      return false;
+    }
+    size += AlignedSize(key_and_data.first.size()) +
+            AlignedSize(key_and_data.second.size());
+  }
+
+  std::string contents(size, '\0');
+  Header* header = reinterpret_cast<Header*>(&contents[0]);
+  header->magic = kSnapshotMagic;
+  header->version = kSnapshotVersion;
+  header->stamp = stamp;
+  header->num_keys = data.size();
+
+  IndexEntry* entry = reinterpret_cast<IndexEntry*>(header + 1);
+  size_t offset = sizeof(Header) + data.size() * sizeof(IndexEntry);
+  // std::map iterates in key order, which is the order Find() relies on.
+  for (const auto& key_and_data : data) {
+    entry->key_offset = offset;
+    entry->key_length = key_and_data.first.size();
+    key_and_data.first.copy(&contents[offset], key_and_data.first.size());
+    offset += AlignedSize(key_and_data.first.size());
+
+    entry->data_offset = offset;
+    entry->data_length = key_and_data.second.size();
+    key_and_data.second.copy(&contents[offset], key_and_data.second.size());
+    offset += AlignedSize(key_and_data.second.size());
+    ++entry;
+  }
+  DCHECK_EQ(size, offset);
+
+  return base::ImportantFileWriter::WriteFileAtomically(path, contents);
+}
+
+// static
+std::unique_ptr<CookieLoadSnapshot> CookieLoadSnapshot::Open(
+    const base::FilePath& path,
+    int64_t stamp) {
+  std::unique_ptr<CookieLoadSnapshot> snapshot(new CookieLoadSnapshot());
+  if (!snapshot->file_.Initialize(path))
+    return nullptr;
+
+  const size_t length = snapshot->file_.length();
+  if (length < sizeof(Header))
+    return nullptr;
+
+  const Header* header =
+      reinterpret_cast<const Header*>(snapshot->file_.data());
+  if (header->magic != kSnapshotMagic ||
+      header->version != kSnapshotVersion || header->stamp != stamp) {
+    return nullptr;
+  }
+  if (header->num_keys > (length - sizeof(Header)) / sizeof(IndexEntry)) {
+    LOG(WARNING) << "Truncated cookie load snapshot.";
+    return nullptr;
+  }
+
+  snapshot->index_ = reinterpret_cast<const IndexEntry*>(header + 1);
+  snapshot->num_keys_ = header->num_keys;
+
+  // Validating the index costs one pass over it, but lets KeyAt() and Find()
+  // trust every entry afterwards. The blobs themselves are not touched.
+  for (size_t i = 0; i < snapshot->num_keys_; ++i) {
+    const IndexEntry& entry = snapshot->index_[i];
+    if (!InBounds(entry.key_offset, entry.key_length, length) ||
+        !InBounds(entry.data_offset, entry.data_length, length) ||
+        (i > 0 && snapshot->KeyAt(i - 1) >= snapshot->KeyAt(i))) {
+      LOG(WARNING) << "Corrupt cookie load snapshot.";
+      return nullptr;
+    }
+  }
+
+  return snapshot;
+}
+
+base::StringPiece CookieLoadSnapshot::KeyAt(size_t index) const {
+  DCHECK_LT(index, num_keys_);
+  const IndexEntry& entry = index_[index];
+  return base::StringPiece(
+      reinterpret_cast<const char*>(file_.data()) + entry.key_offset,
+      entry.key_length);
+}
+
+bool CookieLoadSnapshot::Find(const base::StringPiece& key,
+                              base::StringPiece* data) const {
+  size_t low = 0;
+  size_t high = num_keys_;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    if (KeyAt(mid) < key)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  if (low == num_keys_ || KeyAt(low) != key)
+    return false;
+
+  *data = DataAt(low);
+  return true;
+}
+
+base::StringPiece CookieLoadSnapshot::DataAt(size_t index) const {
+  DCHECK_LT(index, num_keys_);
+  const IndexEntry& entry = index_[index];
+  return base::StringPiece(
+      reinterpret_cast<const char*>(file_.data()) + entry.data_offset,
+      entry.data_length);
+}
+
+}  // namespace net
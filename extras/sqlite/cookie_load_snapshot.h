@@ -0,0 +1,78 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_EXTRAS_SQLITE_COOKIE_LOAD_SNAPSHOT_H_
+#define NET_EXTRAS_SQLITE_COOKIE_LOAD_SNAPSHOT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "base/files/memory_mapped_file.h"
+#include "base/macros.h"
+#include "base/strings/string_piece.h"
+
+namespace base {
+class FilePath;
+}  // namespace base
+
+namespace net {
+
+// A read-only, memory-mapped file holding an opaque blob of data per domain
+// key (eTLD+1). Keys are kept in a sorted index at the start of the file, so
+// that listing the keys or finding the data for one key touches only the pages
+// it needs, rather than reading and parsing the whole file up front.
+//
+// Every snapshot carries a caller-chosen |stamp|. The caller is expected to
+// record the stamp alongside the data the snapshot was built from, and to
+// forget it as soon as that data changes, so that a snapshot that is no longer
+// current is refused by Open().
+class CookieLoadSnapshot {
+ public:
+  typedef std::map<std::string, std::string> DataByKey;
+
+  ~CookieLoadSnapshot();
+
+  // Atomically replaces the file at |path| with a snapshot of |data|. Returns
+  // false if the file could not be written.
+  static bool Write(const base::FilePath& path,
+                    int64_t stamp,
+                    const DataByKey& data);
+
+  // Maps the snapshot at |path|. Returns null if the file does not exist, is
+  // malformed, or was not written with |stamp|.
+  static std::unique_ptr<CookieLoadSnapshot> Open(const base::FilePath& path,
+                                                  int64_t stamp);
+
+  size_t num_keys() const { return num_keys_; }
+
+  // Returns the |index|th key in sorted order. |index| must be less than
+  // num_keys().
+  base::StringPiece KeyAt(size_t index) const;
+
+  // Looks up |key| and, if present, points |data| at its blob. The blob stays
+  // valid for the lifetime of the snapshot.
+  bool Find(const base::StringPiece& key, base::StringPiece* data) const;
+
+ private:
+  struct Header;
+  struct IndexEntry;
+
+  CookieLoadSnapshot();
+
+  base::StringPiece DataAt(size_t index) const;
+
+  base::MemoryMappedFile file_;
+  const IndexEntry* index_;
+  size_t num_keys_;
+
+  DISALLOW_COPY_AND_ASSIGN(CookieLoadSnapshot);
+};
+
+}  // namespace net
+
+#endif  // NET_EXTRAS_SQLITE_COOKIE_LOAD_SNAPSHOT_H_
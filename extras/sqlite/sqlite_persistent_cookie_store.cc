@@ -7,6 +7,7 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <utility>
 
 #include "base/bind.h"
 #include "base/callback.h"
@@ -17,8 +18,11 @@
 #include "base/macros.h"
 #include "base/memory/ref_counted.h"
 #include "base/metrics/histogram_macros.h"
+#include "base/pickle.h"
 #include "base/profiler/scoped_tracker.h"
 #include "base/sequenced_task_runner.h"
+#include "base/stl_util.h"
+#include "base/strings/string_piece.h"
 #include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
 #include "base/synchronization/lock.h"
@@ -29,6 +33,7 @@
 #include "net/cookies/cookie_constants.h"
 #include "net/cookies/cookie_util.h"
 #include "net/extras/sqlite/cookie_crypto_delegate.h"
+#include "net/extras/sqlite/cookie_load_snapshot.h"
 #include "sql/error_delegate_util.h"
 #include "sql/meta_table.h"
 #include "sql/statement.h"
@@ -52,6 +57,23 @@ const int kLoadDelayMilliseconds = 0;
 const int kLoadDelayMilliseconds = 0;
 #endif
 
+// The columns of one row of the cookies table, as read by the load queries.
+struct CookieRow {
+  int64_t creation_utc;
+  std::string host_key;
+  std::string name;
+  std::string value;
+  std::string encrypted_value;
+  std::string path;
+  int64_t expires_utc;
+  bool secure;
+  bool httponly;
+  int firstpartyonly;
+  int64_t last_access_utc;
+  bool persistent;
+  int priority;
+};
+
 }  // namespace
 
 namespace net {
@@ -77,7 +99,24 @@ namespace net {
 // Subsequent to loading, mutations may be queued by any thread using
 // AddCookie, UpdateCookieAccessTime, and DeleteCookie. These are flushed to
 // disk on the BG runner every 30 seconds, 512 operations, or call to Flush(),
-// whichever occurs first.
+// whichever occurs first. Repeated access time updates to a cookie that are
+// still queued are merged into a single operation.
+//
+// If EnableWriteAheadLog() was called, the database uses SQLite's WAL journal
+// and mutations are instead flushed every second or every 64 operations, so
+// that each commit is a short append to the log. Once enough operations have
+// been appended, a separate BG runner task checkpoints the log back into the
+// database.
+//
+// If EnableLoadSnapshot() was called, closing the store also writes every
+// cookie to a CookieLoadSnapshot next to the database, grouped by domain key,
+// and records the snapshot's stamp in the meta table. The next session takes
+// its list of domain keys from the snapshot instead of scanning the whole
+// cookies table, and loads each key by decoding its blob from the mapped file.
+// The stamp is deleted from the meta table as soon as the database is opened,
+// so a snapshot is never trusted once the database may have changed after it
+// was written. Deleting cookies through DeleteAllInList() while keys are still
+// pending drops the snapshot and falls back to the database.
 class SQLitePersistentCookieStore::Backend
     : public base::RefCountedThreadSafe<SQLitePersistentCookieStore::Backend> {
  public:
@@ -89,6 +128,11 @@ class SQLitePersistentCookieStore::Backend
       CookieCryptoDelegate* crypto_delegate)
       : path_(path),
         num_pending_(0),
+        write_ahead_log_requested_(false),
+        write_ahead_log_(false),
+        num_ops_since_checkpoint_(0),
+        checkpoint_pending_(false),
+        load_snapshot_requested_(false),
         initialized_(false),
         corruption_detected_(false),
         restore_old_session_cookies_(restore_old_session_cookies),
@@ -106,6 +150,14 @@ class SQLitePersistentCookieStore::Backend
   void LoadCookiesForKey(const std::string& domain,
                          const LoadedCallback& loaded_callback);
 
+  // Requests WAL journaling; see SQLitePersistentCookieStore. Must be called
+  // before any load is started.
+  void EnableWriteAheadLog();
+
+  // Requests a load snapshot; see SQLitePersistentCookieStore. Must be called
+  // before any load is started.
+  void EnableLoadSnapshot();
+
   // Steps through all results of |smt|, makes a cookie from each, and adds the
   // cookie to |cookies|. This method also updates |num_cookies_read_|.
   void MakeCookiesFromSQLStatement(std::vector<CanonicalCookie*>* cookies,
@@ -161,6 +213,12 @@ class SQLitePersistentCookieStore::Backend
     OperationType op() const { return op_; }
     const CanonicalCookie& cc() const { return cc_; }
 
+    // Folds a later access time update for the same cookie into this
+    // operation.
+    void UpdateLastAccessDate(const base::Time& last_access_date) {
+      cc_.SetLastAccessDate(last_access_date);
+    }
+
    private:
     OperationType op_;
     CanonicalCookie cc_;
@@ -213,14 +271,46 @@ class SQLitePersistentCookieStore::Backend
   // all domains are loaded).
   void ChainLoadCookies(const LoadedCallback& loaded_callback);
 
+  // Reads the host key of every row in the cookies table into |host_keys|.
+  bool ReadHostKeys(std::vector<std::string>* host_keys);
+
+  // Loads the cookies of the pending domain key |key|, whose hosts are
+  // |domains|, from the load snapshot if there is one, or else from the DB.
+  bool LoadCookiesForPendingKey(const std::string& key,
+                                const std::set<std::string>& domains);
+
   // Load all cookies for a set of domains/hosts
   bool LoadCookiesForDomains(const std::set<std::string>& key);
 
+  // Decodes the cookies of |key| from |load_snapshot_|. Returns false, having
+  // added no cookies, if its blob is missing or corrupt.
+  bool LoadCookiesFromSnapshot(const std::string& key);
+
+  // Makes a cookie from |row|, decrypting its value if needed. Returns null if
+  // the value cannot be decrypted.
+  std::unique_ptr<CanonicalCookie> MakeCookieFromRow(const CookieRow& row);
+
+  // Maps the load snapshot if one was requested and the meta table vouches
+  // for it, and forgets the stamp either way.
+  void OpenLoadSnapshot();
+
+  // Stops using the load snapshot, and looks up the hosts of the domain keys
+  // that were still to be loaded from it.
+  void DropLoadSnapshot();
+
+  // Writes a load snapshot of the whole cookies table and records its stamp.
+  void WriteLoadSnapshot();
+
+  base::FilePath GetLoadSnapshotPath() const;
+
   // Batch a cookie operation (add or delete)
   void BatchOperation(PendingOperation::OperationType op,
                       const CanonicalCookie& cc);
   // Commit our pending operations to the database.
   void Commit();
+  // Copies the write-ahead log back into the database, if WAL journaling is
+  // in use.
+  void Checkpoint();
   // Close() executed on the background runner.
   void InternalBackgroundClose(const base::Closure& callback);
 
@@ -248,9 +338,33 @@ class SQLitePersistentCookieStore::Backend
   typedef std::list<PendingOperation*> PendingOperationsList;
   PendingOperationsList pending_;
   PendingOperationsList::size_type num_pending_;
-  // Guard |cookies_|, |pending_|, |num_pending_|.
+  // The last add or access time update in |pending_| for each cookie, keyed by
+  // creation time, unless a deletion of that cookie was queued after it.
+  // Further access time updates for the cookie are merged into it.
+  std::map<int64_t, PendingOperation*> pending_access_updates_;
+  // Guard |cookies_|, |pending_|, |num_pending_|, |pending_access_updates_|.
   base::Lock lock_;
 
+  // Set by EnableWriteAheadLog() before any load is posted, and read-only
+  // afterwards. Selects the commit batching in BatchOperation().
+  bool write_ahead_log_requested_;
+  // Whether the database is actually using a write-ahead log. Background
+  // runner only.
+  bool write_ahead_log_;
+  // Operations committed to the write-ahead log since it was last
+  // checkpointed, and whether a Checkpoint() task is already queued.
+  // Background runner only.
+  size_t num_ops_since_checkpoint_;
+  bool checkpoint_pending_;
+
+  // Set by EnableLoadSnapshot() before any load is posted, and read-only
+  // afterwards.
+  bool load_snapshot_requested_;
+  // The snapshot the pending domain keys are loaded from, if it was current
+  // when the database was opened. Released once every key is loaded.
+  // Background runner only.
+  std::unique_ptr<CookieLoadSnapshot> load_snapshot_;
+
   // Temporary buffer for cookies loaded from DB. Accumulates cookies to reduce
   // the number of messages sent to the client runner. Sent back in response to
   // individual load requests for domain keys or when all loading completes.
@@ -338,6 +452,16 @@ namespace {
 const int kCurrentVersionNumber = 9;
 const int kCompatibleVersionNumber = 5;
 
+// Meta table key holding the stamp of the current load snapshot.
+const char kLoadSnapshotStampKey[] = "cookie_load_snapshot_stamp";
+
+// Columns read by the load queries, in the order CookieRowFromStatement()
+// expects them.
+#define COOKIE_ROW_COLUMNS                                         \
+  "creation_utc, host_key, name, value, encrypted_value, path, "   \
+  "expires_utc, secure, httponly, firstpartyonly, last_access_utc, " \
+  "has_expires, persistent, priority"
+
 // Possible values for the 'priority' column.
 enum DBCookiePriority {
   kCookiePriorityLow = 0,
@@ -429,6 +553,50 @@ class IncrementTimeDelta {
   DISALLOW_COPY_AND_ASSIGN(IncrementTimeDelta);
 };
 
+void CookieRowFromStatement(const sql::Statement& smt, CookieRow* row) {
+  row->creation_utc = smt.ColumnInt64(0);
+  row->host_key = smt.ColumnString(1);
+  row->name = smt.ColumnString(2);
+  row->value = smt.ColumnString(3);
+  row->encrypted_value = smt.ColumnString(4);
+  row->path = smt.ColumnString(5);
+  row->expires_utc = smt.ColumnInt64(6);
+  row->secure = smt.ColumnInt(7) != 0;
+  row->httponly = smt.ColumnInt(8) != 0;
+  row->firstpartyonly = smt.ColumnInt(9);
+  row->last_access_utc = smt.ColumnInt64(10);
+  row->persistent = smt.ColumnInt(12) != 0;
+  row->priority = smt.ColumnInt(13);
+}
+
+void CookieRowToPickle(const CookieRow& row, base::Pickle* pickle) {
+  pickle->WriteInt64(row.creation_utc);
+  pickle->WriteString(row.host_key);
+  pickle->WriteString(row.name);
+  pickle->WriteString(row.value);
+  pickle->WriteString(row.encrypted_value);
+  pickle->WriteString(row.path);
+  pickle->WriteInt64(row.expires_utc);
+  pickle->WriteBool(row.secure);
+  pickle->WriteBool(row.httponly);
+  pickle->WriteInt(row.firstpartyonly);
+  pickle->WriteInt64(row.last_access_utc);
+  pickle->WriteBool(row.persistent);
+  pickle->WriteInt(row.priority);
+}
+
+bool CookieRowFromPickle(base::PickleIterator* iter, CookieRow* row) {
+  return iter->ReadInt64(&row->creation_utc) &&
+         iter->ReadString(&row->host_key) && iter->ReadString(&row->name) &&
+         iter->ReadString(&row->value) &&
+         iter->ReadString(&row->encrypted_value) &&
+         iter->ReadString(&row->path) && iter->ReadInt64(&row->expires_utc) &&
+         iter->ReadBool(&row->secure) && iter->ReadBool(&row->httponly) &&
+         iter->ReadInt(&row->firstpartyonly) &&
+         iter->ReadInt64(&row->last_access_utc) &&
+         iter->ReadBool(&row->persistent) && iter->ReadInt(&row->priority);
+}
+
 // Initializes the cookies table, returning true on success.
 bool InitTable(sql::Connection* db) {
   if (db->DoesTableExist("cookies"))
@@ -498,6 +666,16 @@ void SQLitePersistentCookieStore::Backend::LoadCookiesForKey(
                             loaded_callback, base::Time::Now()));
 }
 
+void SQLitePersistentCookieStore::Backend::EnableWriteAheadLog() {
+  DCHECK(!background_task_runner_->RunsTasksOnCurrentThread());
+  write_ahead_log_requested_ = true;
+}
+
+void SQLitePersistentCookieStore::Backend::EnableLoadSnapshot() {
+  DCHECK(!background_task_runner_->RunsTasksOnCurrentThread());
+  load_snapshot_requested_ = true;
+}
+
 void SQLitePersistentCookieStore::Backend::LoadAndNotifyInBackground(
     const LoadedCallback& loaded_callback,
     const base::Time& posted_at) {
@@ -534,8 +712,10 @@ void SQLitePersistentCookieStore::Backend::LoadKeyAndNotifyInBackground(
     std::map<std::string, std::set<std::string>>::iterator it =
         keys_to_load_.find(key);
     if (it != keys_to_load_.end()) {
-      success = LoadCookiesForDomains(it->second);
+      success = LoadCookiesForPendingKey(it->first, it->second);
       keys_to_load_.erase(it);
+      if (keys_to_load_.empty())
+        load_snapshot_.reset();
     } else {
       success = true;
     }
@@ -666,6 +846,29 @@ bool SQLitePersistentCookieStore::Backend::InitializeDatabase() {
     return false;
   }
 
+  if (write_ahead_log_requested_) {
+    // SQLite reports the journal mode actually in effect, which stays the
+    // previous one if the VFS cannot provide a write-ahead log.
+    sql::Statement journal_mode(
+        db_->GetUniqueStatement("PRAGMA journal_mode=WAL"));
+    write_ahead_log_ = journal_mode.Step() &&
+                       base::LowerCaseEqualsASCII(journal_mode.ColumnString(0),
+                                                  "wal");
+    // In WAL mode a commit at NORMAL synchronization can only be lost, never
+    // corrupted, on power failure, and it avoids an fsync per commit. The log
+    // is checkpointed by Checkpoint() instead of inside whichever commit
+    // crosses SQLite's automatic threshold.
+    if (write_ahead_log_ &&
+        (!db_->Execute("PRAGMA synchronous=NORMAL") ||
+         !db_->Execute("PRAGMA wal_autocheckpoint=0"))) {
+      write_ahead_log_ = false;
+    }
+  }
+  // WAL mode is persistent, so a database left in it by an earlier session
+  // has to be switched back explicitly.
+  if (!write_ahead_log_)
+    ignore_result(db_->Execute("PRAGMA journal_mode=DELETE"));
+
   if (!EnsureDatabaseVersion() || !InitTable(db_.get())) {
     NOTREACHED() << "Unable to open cookie DB.";
     if (corruption_detected_)
@@ -680,45 +883,48 @@ bool SQLitePersistentCookieStore::Backend::InitializeDatabase() {
                              base::TimeDelta::FromMilliseconds(1),
                              base::TimeDelta::FromMinutes(1), 50);
 
-  start = base::Time::Now();
+  OpenLoadSnapshot();
 
-  // Retrieve all the domains
-  sql::Statement smt(
-      db_->GetUniqueStatement("SELECT DISTINCT host_key FROM cookies"));
+  start = base::Time::Now();
 
-  if (!smt.is_valid()) {
-    if (corruption_detected_)
-      db_->Raze();
-    meta_table_.Reset();
-    db_.reset();
-    return false;
-  }
+  if (load_snapshot_) {
+    // The hosts of each key are only needed if the snapshot is dropped before
+    // the key is loaded, and are looked up then.
+    for (size_t i = 0; i < load_snapshot_->num_keys(); ++i)
+      keys_to_load_[load_snapshot_->KeyAt(i).as_string()];
+  } else {
+    // Retrieve all the domains
+    std::vector<std::string> host_keys;
+    if (!ReadHostKeys(&host_keys)) {
+      if (corruption_detected_)
+        db_->Raze();
+      meta_table_.Reset();
+      db_.reset();
+      return false;
+    }
 
-  std::vector<std::string> host_keys;
-  while (smt.Step())
-    host_keys.push_back(smt.ColumnString(0));
+    UMA_HISTOGRAM_CUSTOM_TIMES("Cookie.TimeLoadDomains",
+                               base::Time::Now() - start,
+                               base::TimeDelta::FromMilliseconds(1),
+                               base::TimeDelta::FromMinutes(1), 50);
 
-  UMA_HISTOGRAM_CUSTOM_TIMES("Cookie.TimeLoadDomains",
-                             base::Time::Now() - start,
-                             base::TimeDelta::FromMilliseconds(1),
-                             base::TimeDelta::FromMinutes(1), 50);
+    base::Time start_parse = base::Time::Now();
 
-  base::Time start_parse = base::Time::Now();
+    // Build a map of domain keys (always eTLD+1) to domains.
+    for (size_t idx = 0; idx < host_keys.size(); ++idx) {
+      const std::string& domain = host_keys[idx];
+      std::string key = registry_controlled_domains::GetDomainAndRegistry(
+          domain, registry_controlled_domains::INCLUDE_PRIVATE_REGISTRIES);
 
-  // Build a map of domain keys (always eTLD+1) to domains.
-  for (size_t idx = 0; idx < host_keys.size(); ++idx) {
-    const std::string& domain = host_keys[idx];
-    std::string key = registry_controlled_domains::GetDomainAndRegistry(
-        domain, registry_controlled_domains::INCLUDE_PRIVATE_REGISTRIES);
+      keys_to_load_[key].insert(domain);
+    }
 
-    keys_to_load_[key].insert(domain);
+    UMA_HISTOGRAM_CUSTOM_TIMES("Cookie.TimeParseDomains",
+                               base::Time::Now() - start_parse,
+                               base::TimeDelta::FromMilliseconds(1),
+                               base::TimeDelta::FromMinutes(1), 50);
   }
 
-  UMA_HISTOGRAM_CUSTOM_TIMES("Cookie.TimeParseDomains",
-                             base::Time::Now() - start_parse,
-                             base::TimeDelta::FromMilliseconds(1),
-                             base::TimeDelta::FromMinutes(1), 50);
-
   UMA_HISTOGRAM_CUSTOM_TIMES("Cookie.TimeInitializeDomainMap",
                              base::Time::Now() - start,
                              base::TimeDelta::FromMilliseconds(1),
@@ -731,6 +937,20 @@ bool SQLitePersistentCookieStore::Backend::InitializeDatabase() {
   return true;
 }
 
+bool SQLitePersistentCookieStore::Backend::ReadHostKeys(
+    std::vector<std::string>* host_keys) {
+  DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
+
+  sql::Statement smt(
+      db_->GetUniqueStatement("SELECT DISTINCT host_key FROM cookies"));
+  if (!smt.is_valid())
+    return false;
+
+  while (smt.Step())
+    host_keys->push_back(smt.ColumnString(0));
+  return true;
+}
+
 void SQLitePersistentCookieStore::Backend::ChainLoadCookies(
     const LoadedCallback& loaded_callback) {
   DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
@@ -745,10 +965,13 @@ void SQLitePersistentCookieStore::Backend::ChainLoadCookies(
     // Load cookies for the first domain key.
     std::map<std::string, std::set<std::string>>::iterator it =
         keys_to_load_.begin();
-    load_success = LoadCookiesForDomains(it->second);
+    load_success = LoadCookiesForPendingKey(it->first, it->second);
     keys_to_load_.erase(it);
   }
 
+  if (keys_to_load_.empty())
+    load_snapshot_.reset();
+
   // If load is successful and there are more domain keys to be loaded,
   // then post a background task to continue chain-load;
   // Otherwise notify on client runner.
@@ -766,6 +989,20 @@ void SQLitePersistentCookieStore::Backend::ChainLoadCookies(
   }
 }
 
+bool SQLitePersistentCookieStore::Backend::LoadCookiesForPendingKey(
+    const std::string& key,
+    const std::set<std::string>& domains) {
+  DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
+
+  if (load_snapshot_) {
+    if (LoadCookiesFromSnapshot(key))
+      return true;
+    // Fills in |domains|, which is the entry for |key| in |keys_to_load_|.
+    DropLoadSnapshot();
+  }
+  return LoadCookiesForDomains(domains);
+}
+
 bool SQLitePersistentCookieStore::Backend::LoadCookiesForDomains(
     const std::set<std::string>& domains) {
   DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
@@ -774,16 +1011,11 @@ bool SQLitePersistentCookieStore::Backend::LoadCookiesForDomains(
   if (restore_old_session_cookies_) {
     smt.Assign(db_->GetCachedStatement(
         SQL_FROM_HERE,
-        "SELECT creation_utc, host_key, name, value, encrypted_value, path, "
-        "expires_utc, secure, httponly, firstpartyonly, last_access_utc, "
-        "has_expires, persistent, priority FROM cookies WHERE host_key = ?"));
+        "SELECT " COOKIE_ROW_COLUMNS " FROM cookies WHERE host_key = ?"));
   } else {
     smt.Assign(db_->GetCachedStatement(
-        SQL_FROM_HERE,
-        "SELECT creation_utc, host_key, name, value, encrypted_value, path, "
-        "expires_utc, secure, httponly, firstpartyonly, last_access_utc, "
-        "has_expires, persistent, priority FROM cookies WHERE host_key = ? "
-        "AND persistent = 1"));
+        SQL_FROM_HERE, "SELECT " COOKIE_ROW_COLUMNS
+                       " FROM cookies WHERE host_key = ? AND persistent = 1"));
   }
   if (!smt.is_valid()) {
     smt.Clear();  // Disconnect smt_ref from db_.
@@ -806,40 +1038,169 @@ bool SQLitePersistentCookieStore::Backend::LoadCookiesForDomains(
   return true;
 }
 
+bool SQLitePersistentCookieStore::Backend::LoadCookiesFromSnapshot(
+    const std::string& key) {
+  DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
+
+  base::StringPiece data;
+  if (!load_snapshot_->Find(key, &data))
+    return false;
+
+  base::Pickle pickle(data.data(), data.size());
+  base::PickleIterator iter(pickle);
+  int num_rows = 0;
+  if (!pickle.data() || !iter.ReadInt(&num_rows))
+    return false;
+
+  std::vector<CanonicalCookie*> cookies;
+  for (int i = 0; i < num_rows; ++i) {
+    CookieRow row;
+    if (!CookieRowFromPickle(&iter, &row)) {
+      LOG(WARNING) << "Corrupt cookie load snapshot entry.";
+      STLDeleteElements(&cookies);
+      return false;
+    }
+    // The snapshot still holds the session cookies that
+    // DeleteSessionCookiesOnStartup() has since removed from the database.
+    if (!restore_old_session_cookies_ && !row.persistent)
+      continue;
+    std::unique_ptr<CanonicalCookie> cc = MakeCookieFromRow(row);
+    if (cc)
+      cookies.push_back(cc.release());
+  }
+
+  num_cookies_read_ += cookies.size();
+  {
+    base::AutoLock locked(lock_);
+    cookies_.insert(cookies_.end(), cookies.begin(), cookies.end());
+  }
+  return true;
+}
+
 void SQLitePersistentCookieStore::Backend::MakeCookiesFromSQLStatement(
     std::vector<CanonicalCookie*>* cookies,
     sql::Statement* statement) {
   sql::Statement& smt = *statement;
+  CookieRow row;
   while (smt.Step()) {
-    std::string value;
-    std::string encrypted_value = smt.ColumnString(4);
-    if (!encrypted_value.empty() && crypto_) {
-      if (!crypto_->DecryptString(encrypted_value, &value))
-        continue;
-    } else {
-      value = smt.ColumnString(3);
-    }
-    std::unique_ptr<CanonicalCookie> cc(CanonicalCookie::Create(
-        smt.ColumnString(2),                           // name
-        value,                                         // value
-        smt.ColumnString(1),                           // domain
-        smt.ColumnString(5),                           // path
-        Time::FromInternalValue(smt.ColumnInt64(0)),   // creation_utc
-        Time::FromInternalValue(smt.ColumnInt64(6)),   // expires_utc
-        Time::FromInternalValue(smt.ColumnInt64(10)),  // last_access_utc
-        smt.ColumnInt(7) != 0,                         // secure
-        smt.ColumnInt(8) != 0,                         // http_only
-        DBCookieSameSiteToCookieSameSite(
-            static_cast<DBCookieSameSite>(smt.ColumnInt(9))),  // samesite
-        DBCookiePriorityToCookiePriority(
-            static_cast<DBCookiePriority>(smt.ColumnInt(13)))));  // priority
-    DLOG_IF(WARNING, cc->CreationDate() > Time::Now())
-        << L"CreationDate too recent";
+    CookieRowFromStatement(smt, &row);
+    std::unique_ptr<CanonicalCookie> cc = MakeCookieFromRow(row);
+    if (!cc)
+      continue;
     cookies->push_back(cc.release());
     ++num_cookies_read_;
   }
 }
 
+std::unique_ptr<CanonicalCookie>
+SQLitePersistentCookieStore::Backend::MakeCookieFromRow(const CookieRow& row) {
+  std::string value;
+  if (!row.encrypted_value.empty() && crypto_) {
+    if (!crypto_->DecryptString(row.encrypted_value, &value))
+      return nullptr;
+  } else {
+    value = row.value;
+  }
+  std::unique_ptr<CanonicalCookie> cc(CanonicalCookie::Create(
+      row.name, value, row.host_key, row.path,
+      Time::FromInternalValue(row.creation_utc),
+      Time::FromInternalValue(row.expires_utc),
+      Time::FromInternalValue(row.last_access_utc), row.secure, row.httponly,
+      DBCookieSameSiteToCookieSameSite(
+          static_cast<DBCookieSameSite>(row.firstpartyonly)),
+      DBCookiePriorityToCookiePriority(
+          static_cast<DBCookiePriority>(row.priority))));
+  DLOG_IF(WARNING, cc->CreationDate() > Time::Now())
+      << L"CreationDate too recent";
+  return cc;
+}
+
+void SQLitePersistentCookieStore::Backend::OpenLoadSnapshot() {
+  DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
+
+  // The stamp must be gone before anything else is written to the database,
+  // so that a session which ends without replacing the snapshot, including
+  // one that never asked for it, leaves it untrusted.
+  int64_t stamp = 0;
+  if (meta_table_.GetValue(kLoadSnapshotStampKey, &stamp) &&
+      meta_table_.DeleteKey(kLoadSnapshotStampKey) &&
+      load_snapshot_requested_) {
+    load_snapshot_ = CookieLoadSnapshot::Open(GetLoadSnapshotPath(), stamp);
+  }
+  if (!load_snapshot_)
+    base::DeleteFile(GetLoadSnapshotPath(), false);
+}
+
+void SQLitePersistentCookieStore::Backend::DropLoadSnapshot() {
+  DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
+
+  load_snapshot_.reset();
+  base::DeleteFile(GetLoadSnapshotPath(), false);
+
+  std::vector<std::string> host_keys;
+  if (keys_to_load_.empty() || !db_ || !ReadHostKeys(&host_keys))
+    return;
+
+  for (const std::string& domain : host_keys) {
+    std::string key = registry_controlled_domains::GetDomainAndRegistry(
+        domain, registry_controlled_domains::INCLUDE_PRIVATE_REGISTRIES);
+    std::map<std::string, std::set<std::string>>::iterator it =
+        keys_to_load_.find(key);
+    if (it != keys_to_load_.end())
+      it->second.insert(domain);
+  }
+}
+
+void SQLitePersistentCookieStore::Backend::WriteLoadSnapshot() {
+  DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
+
+  // The file is about to be replaced, so it must not stay mapped.
+  load_snapshot_.reset();
+
+  sql::Statement smt(
+      db_->GetUniqueStatement("SELECT " COOKIE_ROW_COLUMNS " FROM cookies"));
+  if (!smt.is_valid())
+    return;
+
+  // The key of a host can legitimately be empty, e.g. for an IP address, so
+  // whether it was computed is told by its presence in the map.
+  std::map<std::string, std::string> key_for_host;
+  std::map<std::string, std::vector<CookieRow>> rows_for_key;
+  while (smt.Step()) {
+    CookieRow row;
+    CookieRowFromStatement(smt, &row);
+    std::map<std::string, std::string>::iterator it =
+        key_for_host.find(row.host_key);
+    if (it == key_for_host.end()) {
+      const std::string key = registry_controlled_domains::GetDomainAndRegistry(
+          row.host_key, registry_controlled_domains::INCLUDE_PRIVATE_REGISTRIES);
+      it = key_for_host.insert(std::make_pair(row.host_key, key)).first;
+    }
+    rows_for_key[it->second].push_back(row);
+  }
+  if (!smt.Succeeded())
+    return;
+
+  CookieLoadSnapshot::DataByKey data;
+  for (const auto& key_and_rows : rows_for_key) {
+    base::Pickle pickle;
+    pickle.WriteInt(static_cast<int>(key_and_rows.second.size()));
+    for (const CookieRow& row : key_and_rows.second)
+      CookieRowToPickle(row, &pickle);
+    data[key_and_rows.first].assign(static_cast<const char*>(pickle.data()),
+                                    pickle.size());
+  }
+
+  const int64_t stamp = Time::Now().ToInternalValue();
+  if (CookieLoadSnapshot::Write(GetLoadSnapshotPath(), stamp, data))
+    meta_table_.SetValue(kLoadSnapshotStampKey, stamp);
+}
+
+base::FilePath SQLitePersistentCookieStore::Backend::GetLoadSnapshotPath()
+    const {
+  return base::FilePath(path_.value() + FILE_PATH_LITERAL("-snapshot"));
+}
+
 bool SQLitePersistentCookieStore::Backend::EnsureDatabaseVersion() {
   // Version check.
   if (!meta_table_.Init(db_.get(), kCurrentVersionNumber,
@@ -1076,26 +1437,54 @@ void SQLitePersistentCookieStore::Backend::BatchOperation(
   static const int kCommitIntervalMs = 30 * 1000;
   // Commit right away if we have more than 512 outstanding operations.
   static const size_t kCommitAfterBatchSize = 512;
+  // With a write-ahead log a commit is an append, so commit small groups
+  // often. This bounds both the time a commit takes and the window of
+  // mutations lost on a crash.
+  static const int kWriteAheadLogCommitIntervalMs = 1000;
+  static const size_t kWriteAheadLogCommitAfterBatchSize = 64;
   DCHECK(!background_task_runner_->RunsTasksOnCurrentThread());
 
-  // We do a full copy of the cookie here, and hopefully just here.
-  std::unique_ptr<PendingOperation> po(new PendingOperation(op, cc));
-
+  const int64_t creation_time = cc.CreationDate().ToInternalValue();
   PendingOperationsList::size_type num_pending;
   {
     base::AutoLock locked(lock_);
-    pending_.push_back(po.release());
+    std::map<int64_t, PendingOperation*>::iterator it =
+        pending_access_updates_.find(creation_time);
+    if (op == PendingOperation::COOKIE_UPDATEACCESS &&
+        it != pending_access_updates_.end()) {
+      it->second->UpdateLastAccessDate(cc.LastAccessDate());
+      return;
+    }
+
+    // We do a full copy of the cookie here, and hopefully just here.
+    PendingOperation* po = new PendingOperation(op, cc);
+    pending_.push_back(po);
     num_pending = ++num_pending_;
+    if (op == PendingOperation::COOKIE_DELETE) {
+      if (it != pending_access_updates_.end())
+        pending_access_updates_.erase(it);
+    } else {
+      pending_access_updates_[creation_time] = po;
+    }
   }
 
+  // If the database turns out not to support a write-ahead log, committing
+  // more often than necessary is harmless.
+  const int commit_interval_ms = write_ahead_log_requested_
+                                     ? kWriteAheadLogCommitIntervalMs
+                                     : kCommitIntervalMs;
+  const size_t commit_after_batch_size =
+      write_ahead_log_requested_ ? kWriteAheadLogCommitAfterBatchSize
+                                 : kCommitAfterBatchSize;
+
   if (num_pending == 1) {
     // We've gotten our first entry for this batch, fire off the timer.
     if (!background_task_runner_->PostDelayedTask(
             FROM_HERE, base::Bind(&Backend::Commit, this),
-            base::TimeDelta::FromMilliseconds(kCommitIntervalMs))) {
+            base::TimeDelta::FromMilliseconds(commit_interval_ms))) {
       NOTREACHED() << "background_task_runner_ is not running.";
     }
-  } else if (num_pending == kCommitAfterBatchSize) {
+  } else if (num_pending == commit_after_batch_size) {
     // We've reached a big enough batch, fire off a commit now.
     PostBackgroundTask(FROM_HERE, base::Bind(&Backend::Commit, this));
   }
@@ -1109,6 +1498,7 @@ void SQLitePersistentCookieStore::Backend::Commit() {
     base::AutoLock locked(lock_);
     pending_.swap(ops);
     num_pending_ = 0;
+    pending_access_updates_.clear();
   }
 
   // Maybe an old timer fired or we are already Close()'ed.
@@ -1201,6 +1591,34 @@ void SQLitePersistentCookieStore::Backend::Commit() {
   bool succeeded = transaction.Commit();
   UMA_HISTOGRAM_ENUMERATION("Cookie.BackingStoreUpdateResults",
                             succeeded ? 0 : 1, 2);
+
+  // Checkpoint once the log holds roughly as much as one default-mode batch,
+  // in its own task so that commits queued behind it are not held up by it.
+  static const size_t kCheckpointAfterOperations = 512;
+  if (!write_ahead_log_ || !succeeded)
+    return;
+  num_ops_since_checkpoint_ += ops.size();
+  if (num_ops_since_checkpoint_ >= kCheckpointAfterOperations &&
+      !checkpoint_pending_) {
+    checkpoint_pending_ = true;
+    PostBackgroundTask(FROM_HERE, base::Bind(&Backend::Checkpoint, this));
+  }
+}
+
+void SQLitePersistentCookieStore::Backend::Checkpoint() {
+  DCHECK(background_task_runner_->RunsTasksOnCurrentThread());
+
+  checkpoint_pending_ = false;
+  if (!db_.get() || !write_ahead_log_)
+    return;
+
+  // PASSIVE never waits on other connections, and so never reports busy;
+  // whatever it cannot copy now is picked up by the next checkpoint. The
+  // result row holds the frames in the log and the frames copied back.
+  sql::Statement checkpoint(
+      db_->GetUniqueStatement("PRAGMA wal_checkpoint(PASSIVE)"));
+  if (checkpoint.Step() && checkpoint.ColumnInt(1) == checkpoint.ColumnInt(2))
+    num_ops_since_checkpoint_ = 0;
 }
 
 void SQLitePersistentCookieStore::Backend::Flush(
@@ -1230,6 +1648,13 @@ void SQLitePersistentCookieStore::Backend::InternalBackgroundClose(
   // Commit any pending operations
   Commit();
 
+  if (db_.get() && load_snapshot_requested_)
+    WriteLoadSnapshot();
+
+  // Leave a self-contained database file behind.
+  if (db_.get() && write_ahead_log_)
+    ignore_result(db_->Execute("PRAGMA wal_checkpoint(TRUNCATE)"));
+
   meta_table_.Reset();
   db_.reset();
 
@@ -1313,6 +1738,10 @@ void SQLitePersistentCookieStore::Backend::BackgroundDeleteAllInList(
   // list of pending operations. https://crbug.com/486742.
   Commit();
 
+  // Keys still pending would otherwise be loaded with the deleted cookies.
+  if (load_snapshot_)
+    DropLoadSnapshot();
+
   sql::Statement del_smt(db_->GetCachedStatement(
       SQL_FROM_HERE, "DELETE FROM cookies WHERE host_key=? AND secure=?"));
   if (!del_smt.is_valid()) {
@@ -1380,6 +1809,16 @@ SQLitePersistentCookieStore::SQLitePersistentCookieStore(
                            crypto_delegate)) {
 }
 
+void SQLitePersistentCookieStore::EnableWriteAheadLog() {
+  if (backend_)
+    backend_->EnableWriteAheadLog();
+}
+
+void SQLitePersistentCookieStore::EnableLoadSnapshot() {
+  if (backend_)
+    backend_->EnableLoadSnapshot();
+}
+
 void SQLitePersistentCookieStore::DeleteAllInList(
     const std::list<CookieOrigin>& cookies) {
   if (backend_)
@@ -46,6 +46,22 @@ class SQLitePersistentCookieStore
       bool restore_old_session_cookies,
       CookieCryptoDelegate* crypto_delegate);
 
+  // Switches the database to SQLite's write-ahead log journal. Mutations are
+  // then committed in small groups about once a second instead of every 30
+  // seconds, and the log is checkpointed into the main database by a separate
+  // background task rather than as part of a commit. Must be called before
+  // Load() or LoadCookiesForKey(). If the database cannot use a write-ahead log
+  // the store keeps its default journal and batching.
+  void EnableWriteAheadLog();
+
+  // Keeps a snapshot of the cookies, indexed by domain key (eTLD+1), in a
+  // memory-mapped file next to the database. The snapshot is rewritten when
+  // the store is closed, and the next Load() takes its domain keys from it and
+  // serves each LoadCookiesForKey() from the mapped file instead of reading the
+  // cookies table, provided the database was not modified in between. Must be
+  // called before Load() or LoadCookiesForKey().
+  void EnableLoadSnapshot();
+
   // Deletes the cookies whose origins match those given in |cookies|.
   void DeleteAllInList(const std::list<CookieOrigin>& cookies);
 
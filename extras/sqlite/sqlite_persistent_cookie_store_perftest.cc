@@ -4,6 +4,7 @@
 
 #include "net/extras/sqlite/sqlite_persistent_cookie_store.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "base/bind.h"
@@ -13,6 +14,7 @@
 #include "base/sequenced_task_runner.h"
 #include "base/strings/stringprintf.h"
 #include "base/synchronization/waitable_event.h"
+#include "base/test/perf_log.h"
 #include "base/test/perf_time_logger.h"
 #include "base/test/sequenced_worker_pool_owner.h"
 #include "base/threading/sequenced_worker_pool.h"
@@ -55,6 +57,25 @@ class SQLitePersistentCookieStorePerfTest : public testing::Test {
     loaded_event_.Wait();
   }
 
+  void Flush() {
+    base::WaitableEvent event(base::WaitableEvent::ResetPolicy::AUTOMATIC,
+                              base::WaitableEvent::InitialState::NOT_SIGNALED);
+    store_->Flush(
+        base::Bind(&base::WaitableEvent::Signal, base::Unretained(&event)));
+    event.Wait();
+  }
+
+  // Writes 100k cookies to a fresh database in groups of 100, timing the
+  // commit of each group, then times loading them all back.
+  void RunCommitBenchmark(bool write_ahead_log, const std::string& name);
+
+  // Writes 200k cookies across 4000 domain keys to a fresh database, reopens
+  // it, and times the first priority load of one key, then the full load.
+  void RunFirstKeyLoadBenchmark(bool load_snapshot, const std::string& name);
+
+  // Closes |store_| and waits for the background runner to finish with it.
+  void DestroyStore();
+
   scoped_refptr<base::SequencedTaskRunner> background_task_runner() {
     return pool_owner_->pool()->GetSequencedTaskRunner(
         pool_owner_->pool()->GetNamedSequenceToken("background"));
@@ -114,6 +135,126 @@ class SQLitePersistentCookieStorePerfTest : public testing::Test {
   scoped_refptr<SQLitePersistentCookieStore> store_;
 };
 
+void SQLitePersistentCookieStorePerfTest::RunCommitBenchmark(
+    bool write_ahead_log,
+    const std::string& name) {
+  const int kNumCommits = 1000;
+  const int kCookiesPerCommit = 100;
+  const base::FilePath path =
+      temp_dir_.path().AppendASCII(name).Append(cookie_filename);
+
+  store_ = new SQLitePersistentCookieStore(path, client_task_runner(),
+                                           background_task_runner(), false,
+                                           NULL);
+  if (write_ahead_log)
+    store_->EnableWriteAheadLog();
+  Load();
+  ASSERT_EQ(0u, cookies_.size());
+
+  std::vector<base::TimeDelta> commit_times;
+  base::Time t = base::Time::Now();
+  for (int commit = 0; commit < kNumCommits; ++commit) {
+    std::string domain_name(base::StringPrintf(".commit_%d.com", commit));
+    GURL gurl("http://www" + domain_name);
+    for (int cookie_num = 0; cookie_num < kCookiesPerCommit; ++cookie_num) {
+      t += base::TimeDelta::FromInternalValue(10);
+      store_->AddCookie(*CanonicalCookie::Create(
+          gurl, base::StringPrintf("Cookie_%d", cookie_num), "1", domain_name,
+          "/", t, t + base::TimeDelta::FromDays(365), false, false,
+          CookieSameSite::DEFAULT_MODE, false, COOKIE_PRIORITY_DEFAULT));
+    }
+    base::TimeTicks start = base::TimeTicks::Now();
+    Flush();
+    commit_times.push_back(base::TimeTicks::Now() - start);
+  }
+  std::sort(commit_times.begin(), commit_times.end());
+  base::LogPerfResult(("Commit p50 " + name).c_str(),
+                      commit_times[commit_times.size() / 2].InMillisecondsF(),
+                      "ms");
+  base::LogPerfResult(
+      ("Commit p99 " + name).c_str(),
+      commit_times[commit_times.size() * 99 / 100].InMillisecondsF(), "ms");
+
+  DestroyStore();
+
+  store_ = new SQLitePersistentCookieStore(path, client_task_runner(),
+                                           background_task_runner(), false,
+                                           NULL);
+  if (write_ahead_log)
+    store_->EnableWriteAheadLog();
+  base::PerfTimeLogger timer(("Load 100k cookies " + name).c_str());
+  Load();
+  timer.Done();
+  ASSERT_EQ(static_cast<size_t>(kNumCommits * kCookiesPerCommit),
+            cookies_.size());
+  for (CanonicalCookie* cookie : cookies_)
+    delete cookie;
+  cookies_.clear();
+}
+
+void SQLitePersistentCookieStorePerfTest::RunFirstKeyLoadBenchmark(
+    bool load_snapshot,
+    const std::string& name) {
+  const int kNumKeys = 4000;
+  const int kCookiesPerKey = 50;
+  const base::FilePath path =
+      temp_dir_.path().AppendASCII(name).Append(cookie_filename);
+
+  store_ = new SQLitePersistentCookieStore(path, client_task_runner(),
+                                           background_task_runner(), false,
+                                           NULL);
+  if (load_snapshot)
+    store_->EnableLoadSnapshot();
+  Load();
+  ASSERT_EQ(0u, cookies_.size());
+  base::Time t = base::Time::Now();
+  for (int key_num = 0; key_num < kNumKeys; ++key_num) {
+    std::string domain_name(base::StringPrintf(".key_%d.com", key_num));
+    GURL gurl("http://www" + domain_name);
+    for (int cookie_num = 0; cookie_num < kCookiesPerKey; ++cookie_num) {
+      t += base::TimeDelta::FromInternalValue(10);
+      store_->AddCookie(*CanonicalCookie::Create(
+          gurl, base::StringPrintf("Cookie_%d", cookie_num), "1", domain_name,
+          "/", t, t + base::TimeDelta::FromDays(365), false, false,
+          CookieSameSite::DEFAULT_MODE, false, COOKIE_PRIORITY_DEFAULT));
+    }
+  }
+  DestroyStore();
+
+  store_ = new SQLitePersistentCookieStore(path, client_task_runner(),
+                                           background_task_runner(), false,
+                                           NULL);
+  if (load_snapshot)
+    store_->EnableLoadSnapshot();
+  base::PerfTimeLogger key_timer(
+      ("First key load 200k cookies " + name).c_str());
+  store_->LoadCookiesForKey(
+      "key_2000.com",
+      base::Bind(&SQLitePersistentCookieStorePerfTest::OnKeyLoaded,
+                 base::Unretained(this)));
+  key_loaded_event_.Wait();
+  key_timer.Done();
+  ASSERT_EQ(static_cast<size_t>(kCookiesPerKey), cookies_.size());
+  for (CanonicalCookie* cookie : cookies_)
+    delete cookie;
+  cookies_.clear();
+
+  base::PerfTimeLogger load_timer(("Load 200k cookies " + name).c_str());
+  Load();
+  load_timer.Done();
+  ASSERT_EQ(static_cast<size_t>((kNumKeys - 1) * kCookiesPerKey),
+            cookies_.size());
+  for (CanonicalCookie* cookie : cookies_)
+    delete cookie;
+  cookies_.clear();
+}
+
+void SQLitePersistentCookieStorePerfTest::DestroyStore() {
+  store_ = NULL;
+  pool_owner_->pool()->Shutdown();
+  pool_owner_.reset(new base::SequencedWorkerPoolOwner(1, "pool"));
+}
+
 // Test the performance of priority load of cookies for a specfic domain key
 TEST_F(SQLitePersistentCookieStorePerfTest, TestLoadForKeyPerformance) {
   for (int domain_num = 0; domain_num < 3; ++domain_num) {
@@ -140,4 +281,26 @@ TEST_F(SQLitePersistentCookieStorePerfTest, TestLoadPerformance) {
   ASSERT_EQ(15000U, cookies_.size());
 }
 
+// Test commit latency and load time with the default rollback journal.
+TEST_F(SQLitePersistentCookieStorePerfTest, TestCommitLatency) {
+  RunCommitBenchmark(false, "rollback_journal");
+}
+
+// Test commit latency and load time with a write-ahead log.
+TEST_F(SQLitePersistentCookieStorePerfTest, TestCommitLatencyWriteAheadLog) {
+  RunCommitBenchmark(true, "write_ahead_log");
+}
+
+// Test time to the first priority load when the domain keys come from a full
+// scan of the database.
+TEST_F(SQLitePersistentCookieStorePerfTest, TestFirstKeyLoad) {
+  RunFirstKeyLoadBenchmark(false, "database");
+}
+
+// Test time to the first priority load when the domain keys come from the
+// load snapshot.
+TEST_F(SQLitePersistentCookieStorePerfTest, TestFirstKeyLoadSnapshot) {
+  RunFirstKeyLoadBenchmark(true, "load_snapshot");
+}
+
 }  // namespace net
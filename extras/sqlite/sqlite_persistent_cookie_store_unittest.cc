@@ -5,6 +5,7 @@
 #include "net/extras/sqlite/sqlite_persistent_cookie_store.h"
 
 #include <map>
+#include <memory>
 #include <set>
 
 #include "base/bind.h"
@@ -16,6 +17,7 @@
 #include "base/sequenced_task_runner.h"
 #include "base/stl_util.h"
 #include "base/synchronization/waitable_event.h"
+#include "base/test/histogram_tester.h"
 #include "base/test/sequenced_worker_pool_owner.h"
 #include "base/threading/sequenced_worker_pool.h"
 #include "base/time/time.h"
@@ -284,6 +286,109 @@ TEST_F(SQLitePersistentCookieStoreTest, TestPersistance) {
   ASSERT_EQ(0U, cookies.size());
 }
 
+// Test that a store using a write-ahead log persists mutations, merges queued
+// access time updates, and leaves a database readable without the log.
+TEST_F(SQLitePersistentCookieStoreTest, TestWriteAheadLog) {
+  Create(false, false);
+  store_->EnableWriteAheadLog();
+  CanonicalCookieVector cookies;
+  Load(&cookies);
+  ASSERT_EQ(0U, cookies.size());
+
+  base::Time t = base::Time::Now();
+  std::unique_ptr<CanonicalCookie> cookie(CanonicalCookie::Create(
+      GURL("http://foo.bar"), "A", "B", std::string(), "/", t,
+      t + base::TimeDelta::FromDays(1), false, false,
+      CookieSameSite::DEFAULT_MODE, false, COOKIE_PRIORITY_DEFAULT));
+  base::HistogramTester histograms;
+  store_->AddCookie(*cookie);
+  base::Time last_access = t;
+  for (int i = 0; i < 10; ++i) {
+    last_access += base::TimeDelta::FromMinutes(1);
+    cookie->SetLastAccessDate(last_access);
+    store_->UpdateCookieAccessTime(*cookie);
+  }
+  Flush();
+  // The access time updates were merged into the queued add, and all of it
+  // went to the log in one commit.
+  histograms.ExpectUniqueSample("Cookie.BackingStoreUpdateResults", 0, 1);
+  DestroyStore();
+
+  // Reopen without a write-ahead log; the log was checkpointed on close.
+  CreateAndLoad(false, false, &cookies);
+  ASSERT_EQ(1U, cookies.size());
+  EXPECT_EQ("A", cookies[0]->Name());
+  EXPECT_EQ(last_access, cookies[0]->LastAccessDate());
+  STLDeleteElements(&cookies);
+}
+
+TEST_F(SQLitePersistentCookieStoreTest, TestLoadSnapshot) {
+  const base::FilePath snapshot_path(
+      temp_dir_.path().Append(kCookieFilename).value() +
+      FILE_PATH_LITERAL("-snapshot"));
+  Create(false, false);
+  store_->EnableLoadSnapshot();
+  CanonicalCookieVector cookies;
+  Load(&cookies);
+  ASSERT_EQ(0U, cookies.size());
+
+  base::Time t = base::Time::Now();
+  AddCookie(GURL("http://foo.bar"), "A", "B", std::string(), "/", t);
+  t += base::TimeDelta::FromInternalValue(10);
+  AddCookie(GURL("http://www.aaa.com"), "A", "B", std::string(), "/", t);
+  t += base::TimeDelta::FromInternalValue(10);
+  AddCookie(GURL("http://travel.aaa.com"), "A", "B", std::string(), "/", t);
+  DestroyStore();
+  EXPECT_TRUE(base::PathExists(snapshot_path));
+
+  // The second session loads from the snapshot written on close, starting
+  // with a priority load of one key.
+  Create(false, false);
+  store_->EnableLoadSnapshot();
+  store_->LoadCookiesForKey(
+      "aaa.com", base::Bind(&SQLitePersistentCookieStoreTest::OnKeyLoaded,
+                            base::Unretained(this)));
+  key_loaded_event_.Wait();
+  std::set<std::string> domains_loaded;
+  for (CanonicalCookie* cookie : cookies_)
+    domains_loaded.insert(cookie->Domain());
+  STLDeleteElements(&cookies_);
+  EXPECT_EQ(2U, domains_loaded.size());
+  EXPECT_EQ(1U, domains_loaded.count("www.aaa.com"));
+  EXPECT_EQ(1U, domains_loaded.count("travel.aaa.com"));
+
+  Load(&cookies);
+  ASSERT_EQ(1U, cookies.size());
+  EXPECT_EQ("foo.bar", cookies[0]->Domain());
+  STLDeleteElements(&cookies);
+
+  t += base::TimeDelta::FromInternalValue(10);
+  AddCookie(GURL("http://www.bbb.com"), "A", "B", std::string(), "/", t);
+  DestroyStore();
+
+  // A session without the snapshot must invalidate it, so the cookie it adds
+  // is not missed by the next session that uses the snapshot.
+  Create(false, false);
+  Load(&cookies);
+  ASSERT_EQ(4U, cookies.size());
+  STLDeleteElements(&cookies);
+  t += base::TimeDelta::FromInternalValue(10);
+  AddCookie(GURL("http://www.ccc.com"), "A", "B", std::string(), "/", t);
+  DestroyStore();
+  EXPECT_FALSE(base::PathExists(snapshot_path));
+
+  Create(false, false);
+  store_->EnableLoadSnapshot();
+  Load(&cookies);
+  domains_loaded.clear();
+  for (CanonicalCookie* cookie : cookies)
+    domains_loaded.insert(cookie->Domain());
+  STLDeleteElements(&cookies);
+  EXPECT_EQ(5U, domains_loaded.size());
+  EXPECT_EQ(1U, domains_loaded.count("www.bbb.com"));
+  EXPECT_EQ(1U, domains_loaded.count("www.ccc.com"));
+}
+
 TEST_F(SQLitePersistentCookieStoreTest, TestSessionCookiesDeletedOnStartup) {
   // Initialize the cookie store with 3 persistent cookies, 5 transient
   // cookies.
@@ -1158,11 +1158,12 @@ int HttpCache::Transaction::DoCacheReadResponse() {
   next_state_ = STATE_CACHE_READ_RESPONSE_COMPLETE;
 
   io_buf_len_ = entry_->disk_entry->GetDataSize(kResponseInfoIndex);
-  read_buf_ = new IOBuffer(io_buf_len_);
 
+  // The headers are only parsed, so let the entry hand out its own copy of
+  // them when it can; the memory cache does that without copying.
   net_log_.BeginEvent(NetLog::TYPE_HTTP_CACHE_READ_INFO);
-  return entry_->disk_entry->ReadData(kResponseInfoIndex, 0, read_buf_.get(),
-                                      io_buf_len_, io_callback_);
+  return entry_->disk_entry->ReadSharedData(kResponseInfoIndex, 0, io_buf_len_,
+                                            &read_buf_, io_callback_);
 }
 
 int HttpCache::Transaction::DoCacheReadResponseComplete(int result) {
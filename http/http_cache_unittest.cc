@@ -905,6 +905,22 @@ TEST(HttpCache, SimpleGET_LoadOnlyFromCache_Hit) {
   TestLoadTimingCachedResponse(load_timing_info);
 }
 
+// Tests that a hit in the memory cache, which hands out the stored headers
+// without copying them, serves the response that was written.
+TEST(HttpCache, SimpleGET_LoadOnlyFromCache_MemoryCacheHit) {
+  MockHttpCache cache(HttpCache::DefaultBackend::InMemory(1024 * 1024));
+
+  // Write to the cache.
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+
+  // Force this transaction to read from the cache.
+  MockTransaction transaction(kSimpleGET_Transaction);
+  transaction.load_flags |= LOAD_ONLY_FROM_CACHE;
+  RunTransactionTest(cache.http_cache(), transaction);
+
+  EXPECT_EQ(1, cache.network_layer()->transaction_count());
+}
+
 TEST(HttpCache, SimpleGET_LoadOnlyFromCache_Miss) {
   MockHttpCache cache;
 
@@ -488,8 +488,13 @@
         'base/mime_sniffer_perftest.cc',
         'cookies/cookie_monster_perftest.cc',
         'disk_cache/disk_cache_perftest.cc',
+        'dns/dns_response_perftest.cc',
+        'dns/dns_transaction_perftest.cc',
+        'dns/host_cache_perftest.cc',
         'extras/sqlite/sqlite_persistent_cookie_store_perftest.cc',
         'proxy/proxy_resolver_perftest.cc',
+        'quic/crypto/aead_perftest.cc',
+        'quic/quic_buffer_pool_perftest.cc',
         'udp/udp_socket_perftest.cc',
         'websockets/websocket_frame_perftest.cc',
       ],
@@ -830,6 +835,7 @@
         'tools/quic/quic_client_base.h',
         'tools/quic/quic_client_session.cc',
         'tools/quic/quic_client_session.h',
+        'tools/quic/quic_connection_id_map.h',
         'tools/quic/quic_dispatcher.cc',
         'tools/quic/quic_dispatcher.h',
         'tools/quic/quic_in_memory_cache.cc',
@@ -1740,6 +1746,17 @@
             'tools/disk_cache_memory_test/disk_cache_memory_test.cc',
           ],
         },
+        {
+          'target_name': 'disk_cache_trace_replay',
+          'type': 'executable',
+          'dependencies': [
+            '../base/base.gyp:base',
+            'net',
+          ],
+          'sources': [
+            'tools/disk_cache_trace_replay/disk_cache_trace_replay.cc',
+          ],
+        },
       ],
     }],
     ['OS == "linux" or OS == "mac"', {
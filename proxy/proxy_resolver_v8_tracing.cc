@@ -23,6 +23,7 @@
 #include "net/base/address_list.h"
 #include "net/base/net_errors.h"
 #include "net/base/network_interfaces.h"
+#include "net/dns/host_cache.h"
 #include "net/dns/host_resolver.h"
 #include "net/proxy/proxy_info.h"
 #include "net/proxy/proxy_resolver_error_observer.h"
@@ -181,6 +182,11 @@ class Job : public base::RefCountedThreadSafe<Job>,
   bool GetDnsFromLocalCache(const std::string& host, ResolveDnsOperation op,
                             std::string* output, bool* return_value);
 
+  // Looks up |host, op| in |host_cache_| and saves a valid entry to the local
+  // cache. Returns false if there is none, in which case the operation has to
+  // be posted to the origin thread.
+  bool GetDnsFromHostCache(const std::string& host, ResolveDnsOperation op);
+
   void SaveDnsToLocalCache(const std::string& host,
                            ResolveDnsOperation op,
                            int net_error,
@@ -233,9 +239,15 @@ class Job : public base::RefCountedThreadSafe<Job>,
   base::WaitableEvent event_;
 
   // Map of DNS operations completed so far. Written into on the origin thread
-  // and read on the worker thread.
+  // and read on the worker thread. The worker thread also writes into it when
+  // it finds a result in |host_cache_|, at which point no DNS operation is
+  // pending on the origin thread.
   DnsCache dns_cache_;
 
+  // The cache of the host resolver, if it can be read on the worker thread.
+  // Initialized on origin thread and then read on the worker thread.
+  HostCache* host_cache_;
+
   // The job holds a reference to itself to ensure that it remains alive until
   // either completion or cancellation.
   scoped_refptr<Job> owned_self_reference_;
@@ -338,6 +350,7 @@ Job::Job(const Job::Params* params,
       bindings_(std::move(bindings)),
       event_(base::WaitableEvent::ResetPolicy::MANUAL,
              base::WaitableEvent::InitialState::NOT_SIGNALED),
+      host_cache_(nullptr),
       last_num_dns_(0),
       pending_dns_(NULL) {
   CheckIsOnOriginThread();
@@ -501,6 +514,7 @@ void Job::Start(Operation op,
 
   operation_ = op;
   blocking_dns_ = blocking_dns;
+  host_cache_ = bindings_->GetHostCache();
   SetCallback(callback);
 
   owned_self_reference_ = this;
@@ -622,8 +636,10 @@ bool Job::ResolveDnsBlocking(const std::string& host,
     return false;
   }
 
-  if (!PostDnsOperationAndWait(host, op, NULL))
+  if (!GetDnsFromHostCache(host, op) &&
+      !PostDnsOperationAndWait(host, op, NULL)) {
     return false;  // Was cancelled.
+  }
 
   CHECK(GetDnsFromLocalCache(host, op, output, &rv));
   return rv;
@@ -664,6 +680,11 @@ bool Job::ResolveDnsNonBlocking(const std::string& host,
 
   DCHECK(!should_restart_with_blocking_dns_);
 
+  if (GetDnsFromHostCache(host, op)) {
+    CHECK(GetDnsFromLocalCache(host, op, output, &rv));
+    return rv;
+  }
+
   bool completed_synchronously;
   if (!PostDnsOperationAndWait(host, op, &completed_synchronously))
     return false;  // Was cancelled.
@@ -790,11 +811,37 @@ bool Job::GetDnsFromLocalCache(const std::string& host,
   return true;
 }
 
+bool Job::GetDnsFromHostCache(const std::string& host,
+                              ResolveDnsOperation op) {
+  CheckIsOnWorkerThread();
+
+  // myIpAddress() is not resolved through the host resolver's cache.
+  if (!host_cache_ || (op != DNS_RESOLVE && op != DNS_RESOLVE_EX))
+    return false;
+
+  HostResolver::RequestInfo info = MakeDnsRequestInfo(host, op);
+  HostCache::Key key(info.hostname(), info.address_family(),
+                     info.host_resolver_flags());
+  HostCache::Entry entry(ERR_UNEXPECTED, AddressList());
+  HostCache::EntryStaleness stale;
+  if (!host_cache_->LookupStaleOnAnyThread(key, base::TimeTicks::Now(), &entry,
+                                           &stale) ||
+      stale.is_stale()) {
+    return false;
+  }
+  if (entry.error() == OK && entry.addresses().empty())
+    return false;
+
+  SaveDnsToLocalCache(host, op, entry.error(), entry.addresses());
+  return true;
+}
+
 void Job::SaveDnsToLocalCache(const std::string& host,
                               ResolveDnsOperation op,
                               int net_error,
                               const AddressList& addresses) {
-  CheckIsOnOriginThread();
+  // Called on the origin thread, or on the worker thread by
+  // GetDnsFromHostCache().
 
   // Serialize the result into a string to save to the cache.
   std::string cache_value;
@@ -1097,6 +1144,10 @@ void ProxyResolverV8TracingFactoryImpl::RemoveJob(
 
 }  // namespace
 
+HostCache* ProxyResolverV8Tracing::Bindings::GetHostCache() {
+  return nullptr;
+}
+
 // static
 std::unique_ptr<ProxyResolverV8TracingFactory>
 ProxyResolverV8TracingFactory::Create() {
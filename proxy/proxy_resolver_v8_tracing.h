@@ -15,6 +15,7 @@
 
 namespace net {
 
+class HostCache;
 class HostResolver;
 
 // ProxyResolverV8Tracing is a non-blocking proxy resolver.
@@ -42,6 +43,13 @@ class NET_EXPORT ProxyResolverV8Tracing {
     // GetHostResolver().
     virtual BoundNetLog GetBoundNetLog() = 0;
 
+    // Returns the cache of the HostResolver returned by GetHostResolver() if
+    // it outlives the ProxyResolverV8Tracing, or null. The cache is read from
+    // the worker thread through HostCache::LookupStaleOnAnyThread(), so that
+    // cached hosts are resolved without a round trip to the origin thread.
+    // The default implementation returns null.
+    virtual HostCache* GetHostCache();
+
    private:
     DISALLOW_COPY_AND_ASSIGN(Bindings);
   };
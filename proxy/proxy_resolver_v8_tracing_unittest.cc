@@ -67,7 +67,7 @@ scoped_refptr<ProxyResolverScriptData> LoadScriptData(const char* filename) {
 class MockBindings {
  public:
   explicit MockBindings(HostResolver* host_resolver)
-      : host_resolver_(host_resolver) {}
+      : host_resolver_(host_resolver), share_host_cache_(false) {}
 
   void Alert(const base::string16& message) {
     alerts_.push_back(base::UTF16ToASCII(message));
@@ -81,6 +81,12 @@ class MockBindings {
 
   HostResolver* host_resolver() { return host_resolver_; }
 
+  // Whether the bindings hand out the cache of |host_resolver_|.
+  void set_share_host_cache(bool share_host_cache) {
+    share_host_cache_ = share_host_cache;
+  }
+  bool share_host_cache() const { return share_host_cache_; }
+
   std::vector<std::string> GetAlerts() {
     return alerts_;
   }
@@ -124,6 +130,13 @@ class MockBindings {
       return bindings_->host_resolver();
     }
 
+    HostCache* GetHostCache() override {
+      DCHECK(thread_checker_.CalledOnValidThread());
+      if (!bindings_->share_host_cache())
+        return nullptr;
+      return bindings_->host_resolver()->GetHostCache();
+    }
+
    private:
     MockBindings* bindings_;
     base::ThreadChecker thread_checker_;
@@ -136,6 +149,7 @@ class MockBindings {
   std::vector<std::string> alerts_;
   std::vector<std::pair<int, std::string>> errors_;
   HostResolver* const host_resolver_;
+  bool share_host_cache_;
   base::Closure error_callback_;
   EventWaiter<Event> waiter_;
 };
@@ -380,6 +394,46 @@ TEST_F(ProxyResolverV8TracingTest, DnsChecksCache) {
   EXPECT_TRUE(mock_bindings.GetErrors().empty());
 }
 
+// Same as DnsChecksCache, but the bindings share the HostResolver's cache, so
+// the second request resolves "foopy" on the worker thread without posting
+// to the origin thread.
+TEST_F(ProxyResolverV8TracingTest, DnsReadsHostCacheOnWorkerThread) {
+  MockCachingHostResolver host_resolver;
+  MockBindings mock_bindings(&host_resolver);
+  mock_bindings.set_share_host_cache(true);
+
+  host_resolver.rules()->AddRule("foopy", "166.155.144.11");
+  host_resolver.rules()->AddRule("*", "122.133.144.155");
+
+  std::unique_ptr<ProxyResolverV8Tracing> resolver =
+      CreateResolver(mock_bindings.CreateBindings(), "simple_dns.js");
+
+  TestCompletionCallback callback1;
+  TestCompletionCallback callback2;
+  ProxyInfo proxy_info;
+
+  resolver->GetProxyForURL(GURL("http://foopy/req1"), &proxy_info,
+                           callback1.callback(), NULL,
+                           mock_bindings.CreateBindings());
+
+  EXPECT_THAT(callback1.WaitForResult(), IsOk());
+  EXPECT_EQ(2u, host_resolver.num_resolve());
+  EXPECT_EQ("166.155.144.11:3", proxy_info.proxy_server().ToURI());
+
+  resolver->GetProxyForURL(GURL("http://foopy/req2"), &proxy_info,
+                           callback2.callback(), NULL,
+                           mock_bindings.CreateBindings());
+
+  EXPECT_THAT(callback2.WaitForResult(), IsOk());
+
+  // Only myIpAddress() went to the HostResolver.
+  EXPECT_EQ(3u, host_resolver.num_resolve());
+  EXPECT_EQ("166.155.144.11:4", proxy_info.proxy_server().ToURI());
+
+  EXPECT_TRUE(mock_bindings.GetAlerts().empty());
+  EXPECT_TRUE(mock_bindings.GetErrors().empty());
+}
+
 // This test runs a weird PAC script that was designed to defeat the DNS tracing
 // optimization. The proxy resolver should detect the inconsistency and
 // fall-back to synchronous mode execution.
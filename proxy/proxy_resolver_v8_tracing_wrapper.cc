@@ -12,6 +12,7 @@
 #include "base/memory/ptr_util.h"
 #include "base/values.h"
 #include "net/base/net_errors.h"
+#include "net/dns/host_resolver.h"
 #include "net/log/net_log.h"
 #include "net/proxy/proxy_resolver_error_observer.h"
 
@@ -59,6 +60,9 @@ class BindingsImpl : public ProxyResolverV8Tracing::Bindings {
 
   HostResolver* GetHostResolver() override { return host_resolver_; }
 
+  // |host_resolver_| outlives the ProxyResolvers created by the factory.
+  HostCache* GetHostCache() override { return host_resolver_->GetHostCache(); }
+
   BoundNetLog GetBoundNetLog() override { return bound_net_log_; }
 
  private:
@@ -17,6 +17,7 @@ PacingSender::PacingSender(SendAlgorithmInterface* sender,
       alarm_granularity_(alarm_granularity),
       initial_packet_burst_(initial_packet_burst),
       max_pacing_rate_(QuicBandwidth::Zero()),
+      release_time_horizon_(QuicTime::Delta::Zero()),
       burst_tokens_(initial_packet_burst),
       last_delayed_packet_sent_time_(QuicTime::Zero()),
       ideal_next_packet_send_time_(QuicTime::Zero()),
@@ -48,6 +49,11 @@ void PacingSender::SetMaxPacingRate(QuicBandwidth max_pacing_rate) {
   max_pacing_rate_ = max_pacing_rate;
 }
 
+void PacingSender::SetReleaseTimeHorizon(QuicTime::Delta horizon) {
+  DCHECK(horizon.IsZero() || alarm_granularity_ < horizon);
+  release_time_horizon_ = horizon;
+}
+
 void PacingSender::OnCongestionEvent(bool rtt_updated,
                                      QuicByteCount bytes_in_flight,
                                      const CongestionVector& acked_packets,
@@ -143,6 +149,19 @@ QuicTime::Delta PacingSender::TimeUntilSend(
     return time_until_send;
   }
 
+  if (!release_time_horizon_.IsZero()) {
+    // The writer holds packets until their release times, so keep writing
+    // until the horizon is full, and then wait until it has nearly drained
+    // rather than waking up for every packet.
+    if (ideal_next_packet_send_time_ > now.Add(release_time_horizon_)) {
+      DVLOG(1) << "Delaying offloaded burst: "
+               << ideal_next_packet_send_time_.Subtract(now).ToMicroseconds();
+      return ideal_next_packet_send_time_.Subtract(alarm_granularity_)
+          .Subtract(now);
+    }
+    return QuicTime::Delta::Zero();
+  }
+
   // If the next send time is within the alarm granularity, send immediately.
   if (ideal_next_packet_send_time_ > now.Add(alarm_granularity_)) {
     DVLOG(1) << "Delaying packet: "
@@ -155,6 +174,14 @@ QuicTime::Delta PacingSender::TimeUntilSend(
   return QuicTime::Delta::Zero();
 }
 
+QuicTime::Delta PacingSender::GetReleaseTimeDelay(QuicTime now) const {
+  if (release_time_horizon_.IsZero() || burst_tokens_ > 0 ||
+      ideal_next_packet_send_time_ <= now) {
+    return QuicTime::Delta::Zero();
+  }
+  return ideal_next_packet_send_time_.Subtract(now);
+}
+
 QuicBandwidth PacingSender::PacingRate(QuicByteCount bytes_in_flight) const {
   if (!max_pacing_rate_.IsZero()) {
     return QuicBandwidth::FromBitsPerSecond(
@@ -38,6 +38,16 @@ class NET_EXPORT_PRIVATE PacingSender : public SendAlgorithmInterface {
 
   void SetMaxPacingRate(QuicBandwidth max_pacing_rate);
 
+  // Enables pacing offload when |horizon| is not zero. Packets may then be
+  // sent up to |horizon| before their ideal send time, and the writer holds
+  // each back by GetReleaseTimeDelay(), so a single alarm releases a burst.
+  // |horizon| must exceed the alarm granularity.
+  void SetReleaseTimeHorizon(QuicTime::Delta horizon);
+
+  // Returns how long after |now| the next packet should leave the host, or
+  // zero if it should be sent at once.  Always zero without pacing offload.
+  QuicTime::Delta GetReleaseTimeDelay(QuicTime now) const;
+
   // SendAlgorithmInterface methods.
   void SetFromConfig(const QuicConfig& config,
                      Perspective perspective) override;
@@ -78,6 +88,9 @@ class NET_EXPORT_PRIVATE PacingSender : public SendAlgorithmInterface {
   const uint32_t initial_packet_burst_;
   // If not QuicBandidth::Zero, the maximum rate the PacingSender will use.
   QuicBandwidth max_pacing_rate_;
+  // How far ahead of their ideal send times packets may be written when
+  // pacing is offloaded to the writer, or zero if it is not.
+  QuicTime::Delta release_time_horizon_;
 
   // Number of unpaced packets to be sent before packets are delayed.
   uint32_t burst_tokens_;
@@ -337,6 +337,44 @@ TEST_F(PacingSenderTest, NoBurstInRecovery) {
   CheckPacketIsDelayed(QuicTime::Delta::FromMilliseconds(2));
 }
 
+TEST_F(PacingSenderTest, ReleaseTimeOffload) {
+  // Configure pacing rate of 1 packet per 1 ms with no burst tokens, and let
+  // packets be written up to 4ms ahead of their send times.
+  InitPacingRate(0, QuicBandwidth::FromBytesAndTimeDelta(
+                        kMaxPacketSize, QuicTime::Delta::FromMilliseconds(1)));
+  pacing_sender_->SetReleaseTimeHorizon(QuicTime::Delta::FromMilliseconds(4));
+  UpdateRtt();
+  EXPECT_CALL(*mock_sender_, TimeUntilSend(_, kBytesInFlight))
+      .WillRepeatedly(Return(zero_time_));
+  EXPECT_CALL(*mock_sender_, OnPacketSent(_, kBytesInFlight, _, kMaxPacketSize,
+                                          HAS_RETRANSMITTABLE_DATA))
+      .WillRepeatedly(Return(true));
+
+  // Five packets are written at once, each released 1ms after the previous
+  // one, and are sent at their release times.
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(zero_time_,
+              pacing_sender_->TimeUntilSend(clock_.Now(), kBytesInFlight));
+    QuicTime::Delta release_time_delay =
+        pacing_sender_->GetReleaseTimeDelay(clock_.Now());
+    EXPECT_EQ(QuicTime::Delta::FromMilliseconds(i), release_time_delay);
+    pacing_sender_->OnPacketSent(clock_.Now().Add(release_time_delay),
+                                 kBytesInFlight, packet_number_++,
+                                 kMaxPacketSize, HAS_RETRANSMITTABLE_DATA);
+  }
+
+  // The next release is beyond the horizon, so wait until one alarm
+  // granularity is left before it.
+  EXPECT_EQ(QuicTime::Delta::FromMilliseconds(4),
+            pacing_sender_->TimeUntilSend(clock_.Now(), kBytesInFlight));
+
+  clock_.AdvanceTime(QuicTime::Delta::FromMilliseconds(4));
+  EXPECT_EQ(zero_time_,
+            pacing_sender_->TimeUntilSend(clock_.Now(), kBytesInFlight));
+  EXPECT_EQ(QuicTime::Delta::FromMilliseconds(1),
+            pacing_sender_->GetReleaseTimeDelay(clock_.Now()));
+}
+
 TEST_F(PacingSenderTest, VerifyInnerSenderCalled) {
   QuicBandwidth kBandwidth = QuicBandwidth::FromBitsPerSecond(1000);
   QuicTime kTime = QuicTime::Infinite();
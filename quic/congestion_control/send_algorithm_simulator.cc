@@ -69,7 +69,8 @@ SendAlgorithmSimulator::SendAlgorithmSimulator(MockClock* clock,
       bandwidth_(bandwidth),
       rtt_(rtt),
       buffer_size_(1000000),
-      delayed_ack_timer_(QuicTime::Delta::FromMilliseconds(100)) {
+      delayed_ack_timer_(QuicTime::Delta::FromMilliseconds(100)),
+      packets_per_ack_(2) {
   uint32_t seed = base::RandInt(0, std::numeric_limits<int32_t>::max());
   DVLOG(1) << "Seeding SendAlgorithmSimulator with " << seed;
   simple_random_.set_seed(seed);
@@ -231,7 +232,7 @@ QuicTime::Delta SendAlgorithmSimulator::FindNextAck(
     *next_acked = it->packet_number;
     ack_delay = it->ack_time.Subtract(clock_->Now());
     if (HasRecentLostPackets(transfer, *next_acked) ||
-        (*next_acked - last_acked) >= 2) {
+        (*next_acked - last_acked) >= packets_per_ack_) {
       break;
     }
     ack_delay = ack_delay.Add(delayed_ack_timer_);
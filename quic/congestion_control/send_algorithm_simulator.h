@@ -150,6 +150,13 @@ class SendAlgorithmSimulator {
     delayed_ack_timer_ = delayed_ack_timer;
   }
 
+  // Sets the number of packets the receiver waits for before acking, as with
+  // ack decimation. Defaults to 2.
+  void set_packets_per_ack(QuicPacketCount packets_per_ack) {
+    DCHECK_LE(1u, packets_per_ack);
+    packets_per_ack_ = packets_per_ack;
+  }
+
   // Advance the time by |delta| without sending anything.
   // For local ad-hoc testing.
   void AdvanceTime(QuicTime::Delta delta);
@@ -229,6 +236,7 @@ class SendAlgorithmSimulator {
   QuicTime::Delta rtt_;
   size_t buffer_size_;  // In bytes.
   QuicTime::Delta delayed_ack_timer_;
+  QuicPacketCount packets_per_ack_;
 
   DISALLOW_COPY_AND_ASSIGN(SendAlgorithmSimulator);
 };
@@ -152,6 +152,53 @@ bool AeadBaseDecrypter::DecryptPacket(QuicPathId path_id,
   return true;
 }
 
+size_t AeadBaseDecrypter::DecryptPackets(BatchEntry* packets,
+                                         size_t num_packets) {
+  if (have_preliminary_key_) {
+    QUIC_BUG << "Unable to decrypt while key diversification is pending";
+    for (size_t i = 0; i < num_packets; ++i) {
+      packets[i].output_length = 0;
+      packets[i].decrypted = false;
+    }
+    return 0;
+  }
+
+  // The nonce prefix is copied once for the whole batch, and only the packet
+  // number part of the nonce changes between packets.
+  uint8_t nonce[sizeof(nonce_prefix_) + sizeof(QuicPacketNumber)];
+  const size_t nonce_size = nonce_prefix_size_ + sizeof(QuicPacketNumber);
+  memcpy(nonce, nonce_prefix_, nonce_prefix_size_);
+  size_t num_decrypted = 0;
+  for (size_t i = 0; i < num_packets; ++i) {
+    BatchEntry& packet = packets[i];
+    packet.output_length = 0;
+    packet.decrypted = false;
+    if (packet.ciphertext.length() < auth_tag_size_) {
+      continue;
+    }
+    uint64_t path_id_packet_number = QuicUtils::PackPathIdAndPacketNumber(
+        packet.path_id, packet.packet_number);
+    memcpy(nonce + nonce_prefix_size_, &path_id_packet_number,
+           sizeof(path_id_packet_number));
+    if (!EVP_AEAD_CTX_open(
+            ctx_.get(), reinterpret_cast<uint8_t*>(packet.output),
+            &packet.output_length, packet.max_output_length, nonce,
+            nonce_size,
+            reinterpret_cast<const uint8_t*>(packet.ciphertext.data()),
+            packet.ciphertext.size(),
+            reinterpret_cast<const uint8_t*>(packet.associated_data.data()),
+            packet.associated_data.size())) {
+      packet.output_length = 0;
+      continue;
+    }
+    packet.decrypted = true;
+    ++num_decrypted;
+  }
+  // As in DecryptPacket(), failures are expected with trial decryption.
+  ClearOpenSslErrors();
+  return num_decrypted;
+}
+
 StringPiece AeadBaseDecrypter::GetKey() const {
   return StringPiece(reinterpret_cast<const char*>(key_), key_size_);
 }
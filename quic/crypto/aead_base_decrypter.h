@@ -35,6 +35,7 @@ class NET_EXPORT_PRIVATE AeadBaseDecrypter : public QuicDecrypter {
                      char* output,
                      size_t* output_length,
                      size_t max_output_length) override;
+  size_t DecryptPackets(BatchEntry* packets, size_t num_packets) override;
   base::StringPiece GetKey() const override;
   base::StringPiece GetNoncePrefix() const override;
 
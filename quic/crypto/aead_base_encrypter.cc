@@ -133,6 +133,43 @@ bool AeadBaseEncrypter::EncryptPacket(QuicPathId path_id,
   return true;
 }
 
+size_t AeadBaseEncrypter::EncryptPackets(BatchEntry* packets,
+                                         size_t num_packets) {
+  // The nonce prefix is copied once for the whole batch, and only the packet
+  // number part of the nonce changes between packets. All packets are sealed
+  // with the same AEAD context.
+  const size_t nonce_size = nonce_prefix_size_ + sizeof(QuicPacketNumber);
+  ALIGNAS(4) uint8_t nonce[kMaxNonceSize];
+  memcpy(nonce, nonce_prefix_, nonce_prefix_size_);
+  size_t num_encrypted = 0;
+  for (size_t i = 0; i < num_packets; ++i) {
+    BatchEntry& packet = packets[i];
+    packet.output_length = 0;
+    const size_t ciphertext_size = GetCiphertextSize(packet.plaintext.size());
+    if (packet.max_output_length < ciphertext_size) {
+      continue;
+    }
+    uint64_t path_id_packet_number = QuicUtils::PackPathIdAndPacketNumber(
+        packet.path_id, packet.packet_number);
+    memcpy(nonce + nonce_prefix_size_, &path_id_packet_number,
+           sizeof(path_id_packet_number));
+    size_t ciphertext_len;
+    if (!EVP_AEAD_CTX_seal(
+            ctx_.get(), reinterpret_cast<uint8_t*>(packet.output),
+            &ciphertext_len, ciphertext_size, nonce, nonce_size,
+            reinterpret_cast<const uint8_t*>(packet.plaintext.data()),
+            packet.plaintext.size(),
+            reinterpret_cast<const uint8_t*>(packet.associated_data.data()),
+            packet.associated_data.size())) {
+      DLogOpenSslErrors();
+      continue;
+    }
+    packet.output_length = ciphertext_size;
+    ++num_encrypted;
+  }
+  return num_encrypted;
+}
+
 size_t AeadBaseEncrypter::GetKeySize() const {
   return key_size_;
 }
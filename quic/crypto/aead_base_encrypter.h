@@ -33,6 +33,7 @@ class NET_EXPORT_PRIVATE AeadBaseEncrypter : public QuicEncrypter {
                      char* output,
                      size_t* output_length,
                      size_t max_output_length) override;
+  size_t EncryptPackets(BatchEntry* packets, size_t num_packets) override;
   size_t GetKeySize() const override;
   size_t GetNoncePrefixSize() const override;
   size_t GetMaxPlaintextSize(size_t ciphertext_size) const override;
@@ -0,0 +1,141 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/test/perf_log.h"
+#include "base/time/time.h"
+#include "net/quic/crypto/crypto_protocol.h"
+#include "net/quic/crypto/quic_decrypter.h"
+#include "net/quic/crypto/quic_encrypter.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using base::StringPiece;
+using std::string;
+
+namespace net {
+
+namespace {
+
+const int kNumIterations = 20000;
+// The number of packets of one recvmmsg() batch.
+const size_t kBatchSize = 16;
+const size_t kPlaintextSize = 1350;
+const size_t kMaxCiphertextSize = kPlaintextSize + 32;
+
+void LogThroughput(const string& name, base::TimeDelta elapsed) {
+  const double bytes =
+      static_cast<double>(kNumIterations) * kBatchSize * kPlaintextSize;
+  base::LogPerfResult(name.c_str(), bytes / elapsed.InSecondsF() / 1e6,
+                      "MB/s");
+}
+
+// Logs how many times faster the batch call was than the per-packet calls.
+void LogSpeedup(const string& name,
+                base::TimeDelta single_elapsed,
+                base::TimeDelta batch_elapsed) {
+  base::LogPerfResult(name.c_str(),
+                      single_elapsed.InSecondsF() / batch_elapsed.InSecondsF(),
+                      "x");
+}
+
+// Encrypts and decrypts kBatchSize packets per iteration, one at a time and
+// then as a batch.
+void RunAeadBenchmark(QuicTag algorithm, const string& name) {
+  std::unique_ptr<QuicEncrypter> encrypter(QuicEncrypter::Create(algorithm));
+  std::unique_ptr<QuicDecrypter> decrypter(QuicDecrypter::Create(algorithm));
+  const string key(encrypter->GetKeySize(), 'k');
+  const string nonce_prefix(encrypter->GetNoncePrefixSize(), 'n');
+  ASSERT_TRUE(encrypter->SetKey(key));
+  ASSERT_TRUE(encrypter->SetNoncePrefix(nonce_prefix));
+  ASSERT_TRUE(decrypter->SetKey(key));
+  ASSERT_TRUE(decrypter->SetNoncePrefix(nonce_prefix));
+
+  const string associated_data(20, 'a');
+  const string plaintext(kPlaintextSize, 'p');
+  std::vector<char> ciphertexts(kBatchSize * kMaxCiphertextSize);
+  std::vector<char> plaintexts(kBatchSize * kMaxCiphertextSize);
+  size_t ciphertext_lengths[kBatchSize];
+
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (int i = 0; i < kNumIterations; ++i) {
+    for (size_t j = 0; j < kBatchSize; ++j) {
+      ASSERT_TRUE(encrypter->EncryptPacket(
+          kDefaultPathId, i * kBatchSize + j + 1, associated_data, plaintext,
+          &ciphertexts[j * kMaxCiphertextSize], &ciphertext_lengths[j],
+          kMaxCiphertextSize));
+    }
+  }
+  const base::TimeDelta encrypt_elapsed = base::TimeTicks::Now() - start;
+  LogThroughput(name + " encrypt", encrypt_elapsed);
+
+  start = base::TimeTicks::Now();
+  for (int i = 0; i < kNumIterations; ++i) {
+    for (size_t j = 0; j < kBatchSize; ++j) {
+      size_t length;
+      ASSERT_TRUE(decrypter->DecryptPacket(
+          kDefaultPathId, (kNumIterations - 1) * kBatchSize + j + 1,
+          associated_data,
+          StringPiece(&ciphertexts[j * kMaxCiphertextSize],
+                      ciphertext_lengths[j]),
+          &plaintexts[j * kMaxCiphertextSize], &length, kMaxCiphertextSize));
+    }
+  }
+  const base::TimeDelta decrypt_elapsed = base::TimeTicks::Now() - start;
+  LogThroughput(name + " decrypt", decrypt_elapsed);
+
+  QuicEncrypter::BatchEntry encrypt_batch[kBatchSize];
+  for (size_t j = 0; j < kBatchSize; ++j) {
+    encrypt_batch[j].path_id = kDefaultPathId;
+    encrypt_batch[j].associated_data = associated_data;
+    encrypt_batch[j].plaintext = plaintext;
+    encrypt_batch[j].output = &ciphertexts[j * kMaxCiphertextSize];
+    encrypt_batch[j].max_output_length = kMaxCiphertextSize;
+  }
+  start = base::TimeTicks::Now();
+  for (int i = 0; i < kNumIterations; ++i) {
+    for (size_t j = 0; j < kBatchSize; ++j)
+      encrypt_batch[j].packet_number = i * kBatchSize + j + 1;
+    ASSERT_EQ(kBatchSize, encrypter->EncryptPackets(encrypt_batch, kBatchSize));
+  }
+  const base::TimeDelta batch_encrypt_elapsed = base::TimeTicks::Now() - start;
+  LogThroughput(name + " batch encrypt", batch_encrypt_elapsed);
+  LogSpeedup(name + " batch encrypt speedup", encrypt_elapsed,
+             batch_encrypt_elapsed);
+
+  QuicDecrypter::BatchEntry decrypt_batch[kBatchSize];
+  for (size_t j = 0; j < kBatchSize; ++j) {
+    decrypt_batch[j].path_id = kDefaultPathId;
+    decrypt_batch[j].packet_number = encrypt_batch[j].packet_number;
+    decrypt_batch[j].associated_data = associated_data;
+    decrypt_batch[j].ciphertext = StringPiece(encrypt_batch[j].output,
+                                              encrypt_batch[j].output_length);
+    decrypt_batch[j].output = &plaintexts[j * kMaxCiphertextSize];
+    decrypt_batch[j].max_output_length = kMaxCiphertextSize;
+  }
+  start = base::TimeTicks::Now();
+  for (int i = 0; i < kNumIterations; ++i) {
+    ASSERT_EQ(kBatchSize, decrypter->DecryptPackets(decrypt_batch, kBatchSize));
+  }
+  const base::TimeDelta batch_decrypt_elapsed = base::TimeTicks::Now() - start;
+  LogThroughput(name + " batch decrypt", batch_decrypt_elapsed);
+  LogSpeedup(name + " batch decrypt speedup", decrypt_elapsed,
+             batch_decrypt_elapsed);
+}
+
+}  // namespace
+
+TEST(QuicAeadPerfTest, Aes128Gcm12) {
+  RunAeadBenchmark(kAESG, "QUIC AES-128-GCM-12");
+}
+
+TEST(QuicAeadPerfTest, ChaCha20Poly1305) {
+  RunAeadBenchmark(kCC20, "QUIC ChaCha20-Poly1305");
+}
+
+}  // namespace net
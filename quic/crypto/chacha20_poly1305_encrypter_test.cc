@@ -109,6 +109,65 @@ TEST(ChaCha20Poly1305EncrypterTest, EncryptThenDecrypt) {
                                       arraysize(decrypted)));
 }
 
+// Batches match single packets, and a corrupted packet only fails itself.
+TEST(ChaCha20Poly1305EncrypterTest, EncryptPacketsThenDecryptPackets) {
+  ChaCha20Poly1305Encrypter encrypter;
+  ChaCha20Poly1305Decrypter decrypter;
+
+  string key = QuicUtils::HexDecode(test_vectors[0].key);
+  ASSERT_TRUE(encrypter.SetKey(key));
+  ASSERT_TRUE(decrypter.SetKey(key));
+  ASSERT_TRUE(encrypter.SetNoncePrefix("abcd"));
+  ASSERT_TRUE(decrypter.SetNoncePrefix("abcd"));
+
+  const size_t kNumPackets = 3;
+  string associated_data = "associated_data";
+  string plaintexts[kNumPackets] = {"plaintext", "", string(1200, 'x')};
+  char encrypted[kNumPackets][1400];
+  QuicEncrypter::BatchEntry encrypt_batch[kNumPackets];
+  for (size_t i = 0; i < kNumPackets; ++i) {
+    encrypt_batch[i].path_id = 0x42;
+    encrypt_batch[i].packet_number = UINT64_C(0x123456789ABC) + i;
+    encrypt_batch[i].associated_data = associated_data;
+    encrypt_batch[i].plaintext = plaintexts[i];
+    encrypt_batch[i].output = encrypted[i];
+    encrypt_batch[i].max_output_length = arraysize(encrypted[i]);
+  }
+  ASSERT_EQ(kNumPackets, encrypter.EncryptPackets(encrypt_batch, kNumPackets));
+  for (size_t i = 0; i < kNumPackets; ++i) {
+    char expected[1400];
+    size_t expected_len;
+    ASSERT_TRUE(encrypter.EncryptPacket(
+        0x42, UINT64_C(0x123456789ABC) + i, associated_data, plaintexts[i],
+        expected, &expected_len, arraysize(expected)));
+    EXPECT_EQ(StringPiece(expected, expected_len),
+              StringPiece(encrypted[i], encrypt_batch[i].output_length));
+  }
+
+  // Corrupt the tag of the first packet.
+  encrypted[0][encrypt_batch[0].output_length - 1] ^= 0x80;
+  char decrypted[kNumPackets][1400];
+  QuicDecrypter::BatchEntry decrypt_batch[kNumPackets];
+  for (size_t i = 0; i < kNumPackets; ++i) {
+    decrypt_batch[i].path_id = 0x42;
+    decrypt_batch[i].packet_number = UINT64_C(0x123456789ABC) + i;
+    decrypt_batch[i].associated_data = associated_data;
+    decrypt_batch[i].ciphertext =
+        StringPiece(encrypted[i], encrypt_batch[i].output_length);
+    decrypt_batch[i].output = decrypted[i];
+    decrypt_batch[i].max_output_length = arraysize(decrypted[i]);
+  }
+  EXPECT_EQ(kNumPackets - 1,
+            decrypter.DecryptPackets(decrypt_batch, kNumPackets));
+  EXPECT_FALSE(decrypt_batch[0].decrypted);
+  EXPECT_EQ(0u, decrypt_batch[0].output_length);
+  for (size_t i = 1; i < kNumPackets; ++i) {
+    EXPECT_TRUE(decrypt_batch[i].decrypted);
+    EXPECT_EQ(plaintexts[i],
+              StringPiece(decrypted[i], decrypt_batch[i].output_length));
+  }
+}
+
 TEST(ChaCha20Poly1305EncrypterTest, Encrypt) {
   for (size_t i = 0; test_vectors[i].key != nullptr; i++) {
     // Decode the test vector.
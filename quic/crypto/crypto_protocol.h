@@ -52,6 +52,10 @@ const QuicTag kCC20 = TAG('C', 'C', '2', '0');   // ChaCha20 + Poly1305 RFC7539
 // Socket receive buffer
 const QuicTag kSRBF = TAG('S', 'R', 'B', 'F');   // Socket receive buffer
 
+// Ack decimation
+const QuicTag kAKDN = TAG('A', 'K', 'D', 'N');   // Packets per ack with ack
+                                                 // decimation.
+
 // Congestion control feedback types
 const QuicTag kQBIC = TAG('Q', 'B', 'I', 'C');   // TCP cubic
 
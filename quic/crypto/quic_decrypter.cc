@@ -30,6 +30,23 @@ QuicDecrypter* QuicDecrypter::Create(QuicTag algorithm) {
   }
 }
 
+size_t QuicDecrypter::DecryptPackets(BatchEntry* packets, size_t num_packets) {
+  size_t num_decrypted = 0;
+  for (size_t i = 0; i < num_packets; ++i) {
+    BatchEntry& packet = packets[i];
+    packet.decrypted = DecryptPacket(
+        packet.path_id, packet.packet_number, packet.associated_data,
+        packet.ciphertext, packet.output, &packet.output_length,
+        packet.max_output_length);
+    if (packet.decrypted) {
+      ++num_decrypted;
+    } else {
+      packet.output_length = 0;
+    }
+  }
+  return num_decrypted;
+}
+
 // static
 void QuicDecrypter::DiversifyPreliminaryKey(StringPiece preliminary_key,
                                             StringPiece nonce_prefix,
@@ -15,6 +15,19 @@ namespace net {
 
 class NET_EXPORT_PRIVATE QuicDecrypter {
  public:
+  // A packet to decrypt with DecryptPackets().
+  struct BatchEntry {
+    QuicPathId path_id;
+    QuicPacketNumber packet_number;
+    base::StringPiece associated_data;
+    base::StringPiece ciphertext;
+    char* output;
+    size_t max_output_length;
+    // Set to the length of the plaintext, or to 0 if decryption failed.
+    size_t output_length;
+    bool decrypted;
+  };
+
   virtual ~QuicDecrypter() {}
 
   static QuicDecrypter* Create(QuicTag algorithm);
@@ -74,6 +87,12 @@ class NET_EXPORT_PRIVATE QuicDecrypter {
                              size_t* output_length,
                              size_t max_output_length) = 0;
 
+  // Decrypts each of the |num_packets| packets of |packets| as DecryptPacket()
+  // would, for instance all the packets of one recvmmsg() batch, and sets
+  // their |decrypted|. Returns the number of packets that were decrypted. The
+  // default implementation calls DecryptPacket() for each packet.
+  virtual size_t DecryptPackets(BatchEntry* packets, size_t num_packets);
+
   // The name of the cipher.
   virtual const char* cipher_name() const = 0;
   // The ID of the cipher. Return 0x03000000 ORed with the 'cryptographic suite
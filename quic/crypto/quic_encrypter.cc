@@ -26,4 +26,19 @@ QuicEncrypter* QuicEncrypter::Create(QuicTag algorithm) {
   }
 }
 
+size_t QuicEncrypter::EncryptPackets(BatchEntry* packets, size_t num_packets) {
+  size_t num_encrypted = 0;
+  for (size_t i = 0; i < num_packets; ++i) {
+    BatchEntry& packet = packets[i];
+    if (EncryptPacket(packet.path_id, packet.packet_number,
+                      packet.associated_data, packet.plaintext, packet.output,
+                      &packet.output_length, packet.max_output_length)) {
+      ++num_encrypted;
+    } else {
+      packet.output_length = 0;
+    }
+  }
+  return num_encrypted;
+}
+
 }  // namespace net
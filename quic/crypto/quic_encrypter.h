@@ -14,6 +14,18 @@ namespace net {
 
 class NET_EXPORT_PRIVATE QuicEncrypter {
  public:
+  // A packet to encrypt with EncryptPackets().
+  struct BatchEntry {
+    QuicPathId path_id;
+    QuicPacketNumber packet_number;
+    base::StringPiece associated_data;
+    base::StringPiece plaintext;
+    char* output;
+    size_t max_output_length;
+    // Set to the length of the ciphertext, or to 0 if encryption failed.
+    size_t output_length;
+  };
+
   virtual ~QuicEncrypter() {}
 
   static QuicEncrypter* Create(QuicTag algorithm);
@@ -56,6 +68,12 @@ class NET_EXPORT_PRIVATE QuicEncrypter {
                              size_t* output_length,
                              size_t max_output_length) = 0;
 
+  // Encrypts each of the |num_packets| packets of |packets| as EncryptPacket()
+  // would, for instance all the packets of one write pass. Returns the number
+  // of packets that were encrypted. The default implementation calls
+  // EncryptPacket() for each packet.
+  virtual size_t EncryptPackets(BatchEntry* packets, size_t num_packets);
+
   // GetKeySize() and GetNoncePrefixSize() tell the HKDF class how many bytes
   // of key material needs to be derived from the master secret.
   // NOTE: the sizes returned by GetKeySize() and GetNoncePrefixSize() are
@@ -112,6 +112,11 @@ class IntervalSet {
   // has no effect.
   void Add(const T& min, const T& max) { Add(Interval<T>(min, max)); }
 
+  // Same as Add(min, max), but extends the last interval in place if [min,
+  // max) overlaps or adjoins it, so that adding values in increasing order
+  // does not allocate.
+  void AddOptimizedForAppend(const T& min, const T& max);
+
   // DEPRECATED(kosak). Use Union() instead. This method merges all of the
   // values contained in "other" into this IntervalSet.
   void Add(const IntervalSet& other);
@@ -192,6 +197,10 @@ class IntervalSet {
   // currently present both in *this and in the IntervalSet "other".
   void Intersection(const IntervalSet& other);
 
+  // Removes all values less than |value| from this IntervalSet. Unlike
+  // Difference(), an interval containing |value| is trimmed in place.
+  void TrimLessThan(const T& value);
+
   // Mutates this IntervalSet so that it contains only those values that are
   // currently in *this but not in "interval".
   void Difference(const Interval<T>& interval);
@@ -375,6 +384,31 @@ void IntervalSet<T>::Add(const Interval<T>& interval) {
   Compact(begin, end);
 }
 
+template <typename T>
+void IntervalSet<T>::AddOptimizedForAppend(const T& min, const T& max) {
+  if (Empty() || min > intervals_.rbegin()->max() ||
+      min < intervals_.rbegin()->min()) {
+    Add(min, max);
+    return;
+  }
+  // The set is ordered by min(), which is unchanged, so the last interval can
+  // be modified without reinserting it.
+  Interval<T>& last = const_cast<Interval<T>&>(*intervals_.rbegin());
+  if (max > last.max())
+    last.SetMax(max);
+}
+
+template <typename T>
+void IntervalSet<T>::TrimLessThan(const T& value) {
+  typename Set::iterator it = intervals_.begin();
+  while (it != intervals_.end() && it->max() <= value)
+    it = intervals_.erase(it);
+  if (it != intervals_.end() && it->min() < value) {
+    // Raising min() keeps the interval before its successor.
+    const_cast<Interval<T>&>(*it).SetMin(value);
+  }
+}
+
 template <typename T>
 void IntervalSet<T>::Add(const IntervalSet& other) {
   for (const_iterator it = other.begin(); it != other.end(); ++it) {
@@ -669,6 +669,40 @@ TEST_F(IntervalSetTest, IntervalSetDifferenceIdentical) {
   EXPECT_TRUE(mine.Empty());
 }
 
+TEST_F(IntervalSetTest, AddOptimizedForAppend) {
+  IntervalSet<int> iset;
+  iset.AddOptimizedForAppend(10, 20);
+  // Adjoining and overlapping the last interval extend it.
+  iset.AddOptimizedForAppend(20, 25);
+  iset.AddOptimizedForAppend(22, 30);
+  iset.AddOptimizedForAppend(24, 28);
+  EXPECT_TRUE(Check(iset, 1, 10, 30));
+  iset.AddOptimizedForAppend(40, 50);
+  EXPECT_TRUE(Check(iset, 2, 10, 30, 40, 50));
+  // Values before the last interval fall back to Add().
+  iset.AddOptimizedForAppend(5, 45);
+  EXPECT_TRUE(Check(iset, 1, 5, 50));
+  iset.AddOptimizedForAppend(0, 1);
+  EXPECT_TRUE(Check(iset, 2, 0, 1, 5, 50));
+}
+
+TEST_F(IntervalSetTest, TrimLessThan) {
+  IntervalSet<int> iset;
+  iset.Add(10, 20);
+  iset.Add(30, 40);
+  iset.Add(50, 60);
+  iset.TrimLessThan(5);
+  EXPECT_TRUE(Check(iset, 3, 10, 20, 30, 40, 50, 60));
+  iset.TrimLessThan(15);
+  EXPECT_TRUE(Check(iset, 3, 15, 20, 30, 40, 50, 60));
+  iset.TrimLessThan(30);
+  EXPECT_TRUE(Check(iset, 2, 30, 40, 50, 60));
+  iset.TrimLessThan(55);
+  EXPECT_TRUE(Check(iset, 1, 55, 60));
+  iset.TrimLessThan(60);
+  EXPECT_TRUE(iset.Empty());
+}
+
 TEST_F(IntervalSetTest, EmptyComplement) {
   // The complement of an empty set is the input interval:
   IntervalSet<int> iset;
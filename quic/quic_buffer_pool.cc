@@ -0,0 +1,125 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/quic/quic_buffer_pool.h"
+
+#include "base/logging.h"
+#include "net/quic/quic_stream_sequencer_buffer.h"
+
+namespace net {
+
+namespace {
+
+// Each buffer is preceded by a header recording its size class and size.
+struct BufferHeader {
+  size_t size_class;
+  size_t size;
+};
+// Keeps buffers as aligned as operator new would.
+const size_t kHeaderSize = 16;
+static_assert(sizeof(BufferHeader) <= kHeaderSize, "header too large");
+
+BufferHeader* GetHeader(char* buffer) {
+  return reinterpret_cast<BufferHeader*>(buffer - kHeaderSize);
+}
+
+// Streams stop growing their receive windows once 3/4 of the memory limit is
+// in use.
+const size_t kConstrainedNumerator = 3;
+const size_t kConstrainedDenominator = 4;
+
+}  // namespace
+
+QuicBufferPool::SizeClass::SizeClass(size_t buffer_size)
+    : buffer_size(buffer_size) {}
+
+QuicBufferPool::SizeClass::SizeClass(const SizeClass& other) = default;
+
+QuicBufferPool::SizeClass::~SizeClass() {}
+
+QuicBufferPool::QuicBufferPool(size_t max_bytes, size_t max_pooled_bytes)
+    : max_bytes_(max_bytes),
+      max_pooled_bytes_(max_pooled_bytes),
+      bytes_in_use_(0),
+      bytes_pooled_(0) {
+  size_classes_.push_back(SizeClass(kMaxPacketSize));
+  size_classes_.push_back(
+      SizeClass(QuicStreamSequencerBuffer::kBlockSizeBytes));
+}
+
+QuicBufferPool::~QuicBufferPool() {
+  ReleaseFreeBuffers();
+}
+
+char* QuicBufferPool::New(size_t size) {
+  const size_t size_class = GetSizeClass(size);
+  char* buffer;
+  size_t buffer_size;
+  if (size_class < size_classes_.size()) {
+    SizeClass& pool = size_classes_[size_class];
+    buffer_size = pool.buffer_size;
+    if (!pool.free_buffers.empty()) {
+      buffer = pool.free_buffers.back();
+      pool.free_buffers.pop_back();
+      bytes_pooled_ -= buffer_size;
+      bytes_in_use_ += buffer_size;
+      return buffer;
+    }
+  } else {
+    buffer_size = size;
+  }
+  buffer = new char[kHeaderSize + buffer_size] + kHeaderSize;
+  BufferHeader* header = GetHeader(buffer);
+  header->size_class = size_class;
+  header->size = buffer_size;
+  bytes_in_use_ += buffer_size;
+  return buffer;
+}
+
+char* QuicBufferPool::New(size_t size, bool /* flag_enable */) {
+  return New(size);
+}
+
+void QuicBufferPool::Delete(char* buffer) {
+  BufferHeader* header = GetHeader(buffer);
+  DCHECK_GE(bytes_in_use_, header->size);
+  bytes_in_use_ -= header->size;
+  if (header->size_class < size_classes_.size() &&
+      bytes_pooled_ + header->size <= max_pooled_bytes_ &&
+      bytes_in_use_ + bytes_pooled_ + header->size <= max_bytes_) {
+    size_classes_[header->size_class].free_buffers.push_back(buffer);
+    bytes_pooled_ += header->size;
+    return;
+  }
+  delete[] reinterpret_cast<char*>(header);
+}
+
+void QuicBufferPool::MarkAllocatorIdle() {
+  ReleaseFreeBuffers();
+}
+
+bool QuicBufferPool::IsMemoryConstrained() const {
+  return bytes_in_use_ >=
+         max_bytes_ / kConstrainedDenominator * kConstrainedNumerator;
+}
+
+size_t QuicBufferPool::GetSizeClass(size_t size) const {
+  size_t size_class = 0;
+  while (size_class < size_classes_.size() &&
+         size_classes_[size_class].buffer_size < size) {
+    ++size_class;
+  }
+  return size_class;
+}
+
+void QuicBufferPool::ReleaseFreeBuffers() {
+  for (SizeClass& pool : size_classes_) {
+    for (char* buffer : pool.free_buffers)
+      delete[] reinterpret_cast<char*>(GetHeader(buffer));
+    pool.free_buffers.clear();
+  }
+  bytes_pooled_ = 0;
+}
+
+}  // namespace net
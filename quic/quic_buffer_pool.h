@@ -0,0 +1,73 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_QUIC_QUIC_BUFFER_POOL_H_
+#define NET_QUIC_QUIC_BUFFER_POOL_H_
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "base/macros.h"
+#include "net/quic/quic_protocol.h"
+
+namespace net {
+
+// A QuicBufferAllocator which keeps freed buffers for reuse, so that the
+// stream buffers of many connections are recycled instead of going through
+// the heap for every packet. Buffers are pooled in two size classes: one for
+// stream frame data, up to a packet in size, and one for the blocks of
+// QuicStreamSequencerBuffer. Larger buffers are not pooled.
+//
+// The pool is meant to be shared by all the connections of one thread, and is
+// not thread-safe. Freed buffers are kept while the pooled bytes stay under
+// |max_pooled_bytes| and the bytes handed out and pooled stay under
+// |max_bytes|. IsMemoryConstrained() tells streams to stop growing their
+// receive windows once the bytes handed out get close to |max_bytes|.
+// MarkAllocatorIdle() releases all the pooled buffers.
+class NET_EXPORT_PRIVATE QuicBufferPool : public QuicBufferAllocator {
+ public:
+  QuicBufferPool(size_t max_bytes, size_t max_pooled_bytes);
+  ~QuicBufferPool() override;
+
+  // QuicBufferAllocator implementation.
+  char* New(size_t size) override;
+  char* New(size_t size, bool flag_enable) override;
+  void Delete(char* buffer) override;
+  void MarkAllocatorIdle() override;
+  bool IsMemoryConstrained() const override;
+
+  // The bytes of the buffers currently handed out.
+  size_t bytes_in_use() const { return bytes_in_use_; }
+  // The bytes of the free buffers kept for reuse.
+  size_t bytes_pooled() const { return bytes_pooled_; }
+
+ private:
+  struct SizeClass {
+    explicit SizeClass(size_t buffer_size);
+    SizeClass(const SizeClass& other);
+    ~SizeClass();
+
+    size_t buffer_size;
+    std::vector<char*> free_buffers;
+  };
+
+  // Returns the index in |size_classes_| of the smallest class holding |size|
+  // bytes, or size_classes_.size() if the buffer is not pooled.
+  size_t GetSizeClass(size_t size) const;
+
+  void ReleaseFreeBuffers();
+
+  const size_t max_bytes_;
+  const size_t max_pooled_bytes_;
+  std::vector<SizeClass> size_classes_;
+  size_t bytes_in_use_;
+  size_t bytes_pooled_;
+
+  DISALLOW_COPY_AND_ASSIGN(QuicBufferPool);
+};
+
+}  // namespace net
+
+#endif  // NET_QUIC_QUIC_BUFFER_POOL_H_
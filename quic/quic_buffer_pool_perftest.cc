@@ -0,0 +1,76 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/test/perf_log.h"
+#include "base/time/time.h"
+#include "net/quic/quic_buffer_pool.h"
+#include "net/quic/quic_flags.h"
+#include "net/quic/quic_simple_buffer_allocator.h"
+#include "net/quic/quic_stream_sequencer_buffer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using std::string;
+
+namespace net {
+
+namespace {
+
+// Simulates the receive side of a server downloading from many connections at
+// once: each stream receives a packet in turn, and reads its data once
+// kFramesPerRead packets have arrived.
+const size_t kNumStreams = 10000;
+const size_t kFramesPerStream = 200;
+const size_t kFramesPerRead = 8;
+const size_t kFrameSize = 1350;
+
+void RunDownload(QuicBufferAllocator* allocator, const string& name) {
+  std::vector<std::unique_ptr<QuicStreamSequencerBuffer>> buffers;
+  for (size_t i = 0; i < kNumStreams; ++i) {
+    buffers.push_back(std::unique_ptr<QuicStreamSequencerBuffer>(
+        new QuicStreamSequencerBuffer(64 * 1024, allocator)));
+  }
+  const string frame(kFrameSize, 'a');
+  char dest[kFramesPerRead * kFrameSize];
+  const iovec iov = {dest, sizeof(dest)};
+  string error_details;
+
+  base::TimeTicks start = base::TimeTicks::Now();
+  for (size_t j = 0; j < kFramesPerStream; ++j) {
+    for (size_t i = 0; i < kNumStreams; ++i) {
+      size_t written;
+      ASSERT_EQ(QUIC_NO_ERROR,
+                buffers[i]->OnStreamData(j * kFrameSize, frame,
+                                         QuicTime::Zero(), &written,
+                                         &error_details));
+      if ((j + 1) % kFramesPerRead == 0)
+        ASSERT_EQ(sizeof(dest), buffers[i]->Readv(&iov, 1));
+    }
+  }
+  base::TimeDelta elapsed = base::TimeTicks::Now() - start;
+  base::LogPerfResult(
+      (name + " per frame").c_str(),
+      elapsed.InMicrosecondsF() * 1000 / (kNumStreams * kFramesPerStream),
+      "ns");
+}
+
+}  // namespace
+
+TEST(QuicBufferPoolPerfTest, Download) {
+  SimpleBufferAllocator simple_allocator;
+  RunDownload(&simple_allocator, "QUIC sequencer simple allocator");
+
+  QuicBufferPool pool(FLAGS_quic_buffer_pool_max_bytes,
+                      FLAGS_quic_buffer_pool_max_pooled_bytes);
+  RunDownload(&pool, "QUIC sequencer buffer pool");
+  base::LogPerfResult("QUIC sequencer buffer pool pooled",
+                      pool.bytes_pooled() / 1024, "KB");
+}
+
+}  // namespace net
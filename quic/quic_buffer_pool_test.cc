@@ -0,0 +1,94 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/quic/quic_buffer_pool.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "net/quic/quic_stream_sequencer_buffer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+namespace test {
+namespace {
+
+const size_t kBlockSize = QuicStreamSequencerBuffer::kBlockSizeBytes;
+
+TEST(QuicBufferPoolTest, ReusesBuffers) {
+  QuicBufferPool pool(1024 * 1024, 1024 * 1024);
+  char* packet_buffer = pool.New(100);
+  char* block = pool.New(kBlockSize);
+  memset(packet_buffer, 'a', kMaxPacketSize);
+  memset(block, 'b', kBlockSize);
+  EXPECT_EQ(kMaxPacketSize + kBlockSize, pool.bytes_in_use());
+
+  pool.Delete(packet_buffer);
+  pool.Delete(block);
+  EXPECT_EQ(0u, pool.bytes_in_use());
+  EXPECT_EQ(kMaxPacketSize + kBlockSize, pool.bytes_pooled());
+
+  // Buffers are reused within their size class.
+  EXPECT_EQ(block, pool.New(kMaxPacketSize + 1));
+  EXPECT_EQ(packet_buffer, pool.New(kMaxPacketSize));
+  EXPECT_EQ(0u, pool.bytes_pooled());
+  pool.Delete(block);
+  pool.Delete(packet_buffer);
+
+  pool.MarkAllocatorIdle();
+  EXPECT_EQ(0u, pool.bytes_pooled());
+}
+
+TEST(QuicBufferPoolTest, LargeBuffersAreNotPooled) {
+  QuicBufferPool pool(1024 * 1024, 1024 * 1024);
+  char* buffer = pool.New(kBlockSize + 1);
+  memset(buffer, 'a', kBlockSize + 1);
+  EXPECT_EQ(kBlockSize + 1, pool.bytes_in_use());
+  pool.Delete(buffer);
+  EXPECT_EQ(0u, pool.bytes_in_use());
+  EXPECT_EQ(0u, pool.bytes_pooled());
+}
+
+TEST(QuicBufferPoolTest, MemoryLimit) {
+  const size_t kNumBlocks = 8;
+  QuicBufferPool pool(kNumBlocks * kBlockSize, kNumBlocks * kBlockSize);
+  std::vector<char*> blocks;
+  // Allocations never fail, but the pool is constrained once 3/4 of its limit
+  // is in use.
+  for (size_t i = 0; i < 2 * kNumBlocks; ++i) {
+    EXPECT_EQ(i >= kNumBlocks * 3 / 4, pool.IsMemoryConstrained());
+    blocks.push_back(pool.New(kBlockSize));
+  }
+  EXPECT_EQ(2 * kNumBlocks * kBlockSize, pool.bytes_in_use());
+
+  // Only as many buffers as fit in the limit are kept.
+  for (char* block : blocks)
+    pool.Delete(block);
+  EXPECT_EQ(0u, pool.bytes_in_use());
+  EXPECT_EQ(kNumBlocks * kBlockSize, pool.bytes_pooled());
+  EXPECT_FALSE(pool.IsMemoryConstrained());
+}
+
+TEST(QuicBufferPoolTest, PooledBytesLimit) {
+  const size_t kNumBlocks = 8;
+  QuicBufferPool pool(4 * kNumBlocks * kBlockSize, kNumBlocks * kBlockSize);
+  std::vector<char*> blocks;
+  for (size_t i = 0; i < 2 * kNumBlocks; ++i)
+    blocks.push_back(pool.New(kBlockSize));
+  EXPECT_FALSE(pool.IsMemoryConstrained());
+
+  // The free buffers are capped separately from the bytes handed out.
+  for (char* block : blocks)
+    pool.Delete(block);
+  EXPECT_EQ(0u, pool.bytes_in_use());
+  EXPECT_EQ(kNumBlocks * kBlockSize, pool.bytes_pooled());
+
+  pool.MarkAllocatorIdle();
+  EXPECT_EQ(0u, pool.bytes_pooled());
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace net
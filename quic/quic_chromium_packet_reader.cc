@@ -4,12 +4,16 @@
 
 #include "net/quic/quic_chromium_packet_reader.h"
 
+#include <algorithm>
+
 #include "base/location.h"
 #include "base/metrics/histogram_macros.h"
 #include "base/single_thread_task_runner.h"
 #include "base/threading/thread_task_runner_handle.h"
+#include "base/time/time.h"
 #include "net/base/net_errors.h"
 #include "net/quic/quic_clock.h"
+#include "net/quic/quic_flags.h"
 
 namespace net {
 
@@ -28,9 +32,20 @@ QuicChromiumPacketReader::QuicChromiumPacketReader(
       yield_after_packets_(yield_after_packets),
       yield_after_duration_(yield_after_duration),
       yield_after_(QuicTime::Infinite()),
-      read_buffer_(new IOBufferWithSize(static_cast<size_t>(kMaxPacketSize))),
+      read_multiple_(true),
+      datagram_len_(static_cast<int>(kMaxPacketSize)),
+      max_datagrams_(kQuicMaxPacketsPerRead),
       net_log_(net_log),
-      weak_factory_(this) {}
+      weak_factory_(this) {
+  if (FLAGS_quic_receive_gro &&
+      socket_->EnableGenericReceiveOffload() == OK) {
+    datagram_len_ = DatagramClientSocket::kMaxCoalescedDatagramSize;
+    max_datagrams_ = kQuicMaxCoalescedDatagramsPerRead;
+  }
+  read_buffer_ = new IOBufferWithSize(
+      static_cast<size_t>(datagram_len_ * max_datagrams_));
+  datagrams_.resize(max_datagrams_);
+}
 
 QuicChromiumPacketReader::~QuicChromiumPacketReader() {}
 
@@ -43,26 +58,43 @@ void QuicChromiumPacketReader::StartReading() {
 
   DCHECK(socket_);
   read_pending_ = true;
-  int rv = socket_->Read(read_buffer_.get(), read_buffer_->size(),
-                         base::Bind(&QuicChromiumPacketReader::OnReadComplete,
-                                    weak_factory_.GetWeakPtr()));
+  int rv = ERR_NOT_IMPLEMENTED;
+  if (read_multiple_) {
+    rv = socket_->ReadMultiple(
+        read_buffer_.get(), datagram_len_, max_datagrams_, datagrams_.data(),
+        base::Bind(&QuicChromiumPacketReader::OnReadMultipleComplete,
+                   weak_factory_.GetWeakPtr()));
+    if (rv == ERR_NOT_IMPLEMENTED)
+      read_multiple_ = false;
+  }
+  if (!read_multiple_) {
+    rv = socket_->Read(read_buffer_.get(), kMaxPacketSize,
+                       base::Bind(&QuicChromiumPacketReader::OnReadComplete,
+                                  weak_factory_.GetWeakPtr()));
+  }
   UMA_HISTOGRAM_BOOLEAN("Net.QuicSession.AsyncRead", rv == ERR_IO_PENDING);
   if (rv == ERR_IO_PENDING) {
     num_packets_read_ = 0;
     return;
   }
 
-  if (++num_packets_read_ > yield_after_packets_ ||
+  num_packets_read_ += (read_multiple_ && rv > 0) ? rv : 1;
+  base::Callback<void(int)> on_read_complete =
+      read_multiple_
+          ? base::Bind(&QuicChromiumPacketReader::OnReadMultipleComplete,
+                       weak_factory_.GetWeakPtr())
+          : base::Bind(&QuicChromiumPacketReader::OnReadComplete,
+                       weak_factory_.GetWeakPtr());
+  if (num_packets_read_ > yield_after_packets_ ||
       clock_->Now() > yield_after_) {
     num_packets_read_ = 0;
     // Data was read, process it.
     // Schedule the work through the message loop to 1) prevent infinite
     // recursion and 2) avoid blocking the thread for too long.
     base::ThreadTaskRunnerHandle::Get()->PostTask(
-        FROM_HERE, base::Bind(&QuicChromiumPacketReader::OnReadComplete,
-                              weak_factory_.GetWeakPtr(), rv));
+        FROM_HERE, base::Bind(on_read_complete, rv));
   } else {
-    OnReadComplete(rv);
+    on_read_complete.Run(rv);
   }
 }
 
@@ -87,4 +119,48 @@ void QuicChromiumPacketReader::OnReadComplete(int result) {
   StartReading();
 }
 
+void QuicChromiumPacketReader::OnReadMultipleComplete(int result) {
+  read_pending_ = false;
+  if (result < 0) {
+    visitor_->OnReadError(result, socket_);
+    return;
+  }
+
+  IPEndPoint local_address;
+  IPEndPoint peer_address;
+  socket_->GetLocalAddress(&local_address);
+  socket_->GetPeerAddress(&peer_address);
+  // Packets without a kernel timestamp are stamped with the time the batch
+  // is processed. Kernel timestamps are wall times, and are converted with
+  // one clock reading per batch.
+  const QuicTime now = clock_->Now();
+  const base::Time wall_now = base::Time::Now();
+  for (int i = 0; i < result; ++i) {
+    const DatagramClientSocket::ReceivedDatagram& datagram = datagrams_[i];
+    // Same as an empty Read() in OnReadComplete().
+    if (datagram.length == 0) {
+      visitor_->OnReadError(ERR_CONNECTION_CLOSED, socket_);
+      return;
+    }
+    QuicTime receipt_time = now;
+    if (!datagram.receive_time.is_null() && datagram.receive_time < wall_now) {
+      receipt_time = now.Subtract(QuicTime::Delta::FromMicroseconds(
+          (wall_now - datagram.receive_time).InMicroseconds()));
+    }
+    // Split coalesced datagrams back into packets, in place.
+    const char* data = read_buffer_->data() + i * datagram_len_;
+    const int segment_size =
+        datagram.segment_size > 0 ? datagram.segment_size : datagram.length;
+    for (int offset = 0; offset < datagram.length; offset += segment_size) {
+      QuicReceivedPacket packet(
+          data + offset, std::min(segment_size, datagram.length - offset),
+          receipt_time);
+      if (!visitor_->OnPacket(packet, local_address, peer_address))
+        return;
+    }
+  }
+
+  StartReading();
+}
+
 }  // namespace net
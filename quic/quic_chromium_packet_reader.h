@@ -6,6 +6,8 @@
 #ifndef NET_QUIC_QUIC_CHROMIUM_PACKET_READER_H_
 #define NET_QUIC_QUIC_CHROMIUM_PACKET_READER_H_
 
+#include <vector>
+
 #include "base/macros.h"
 #include "base/memory/weak_ptr.h"
 #include "net/base/io_buffer.h"
@@ -25,6 +27,14 @@ class QuicClock;
 const int kQuicYieldAfterPacketsRead = 32;
 const int kQuicYieldAfterDurationMilliseconds = 20;
 
+// Maximum number of packets read from the socket at once, when it supports
+// DatagramClientSocket::ReadMultiple().
+const int kQuicMaxPacketsPerRead = 16;
+
+// Same as above, when the socket coalesces packets with generic receive
+// offload. Each datagram read may then hold many packets.
+const int kQuicMaxCoalescedDatagramsPerRead = 4;
+
 class NET_EXPORT_PRIVATE QuicChromiumPacketReader {
  public:
   class NET_EXPORT_PRIVATE Visitor {
@@ -52,6 +62,8 @@ class NET_EXPORT_PRIVATE QuicChromiumPacketReader {
  private:
   // A completion callback invoked when a read completes.
   void OnReadComplete(int result);
+  // Same as above, for ReadMultiple(). |result| is the number of packets.
+  void OnReadMultipleComplete(int result);
 
   DatagramClientSocket* socket_;
   Visitor* visitor_;
@@ -61,7 +73,17 @@ class NET_EXPORT_PRIVATE QuicChromiumPacketReader {
   int yield_after_packets_;
   QuicTime::Delta yield_after_duration_;
   QuicTime yield_after_;
+  // Whether to read with ReadMultiple(). Cleared if the socket does not
+  // support it.
+  bool read_multiple_;
+  // The room for each datagram read by ReadMultiple(), and the number of
+  // datagrams. Larger with generic receive offload, which
+  // FLAGS_quic_receive_gro turns on when the socket supports it.
+  int datagram_len_;
+  int max_datagrams_;
+  // Holds up to |max_datagrams_| datagrams, |datagram_len_| bytes apart.
   scoped_refptr<IOBufferWithSize> read_buffer_;
+  std::vector<DatagramClientSocket::ReceivedDatagram> datagrams_;
   BoundNetLog net_log_;
 
   base::WeakPtrFactory<QuicChromiumPacketReader> weak_factory_;
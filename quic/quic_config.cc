@@ -418,7 +418,8 @@ QuicConfig::QuicConfig()
       multipath_enabled_(kMPTH, PRESENCE_OPTIONAL),
       connection_migration_disabled_(kNCMR, PRESENCE_OPTIONAL),
       alternate_server_address_(kASAD, PRESENCE_OPTIONAL),
-      force_hol_blocking_(kFHOL, PRESENCE_OPTIONAL) {
+      force_hol_blocking_(kFHOL, PRESENCE_OPTIONAL),
+      ack_decimation_packets_(kAKDN, PRESENCE_OPTIONAL) {
   SetDefaults();
 }
 
@@ -656,6 +657,26 @@ bool QuicConfig::ForceHolBlocking(Perspective perspective) const {
   }
 }
 
+void QuicConfig::SetAckDecimationPacketsToSend(uint32_t packets) {
+  ack_decimation_packets_.SetSendValue(packets);
+}
+
+bool QuicConfig::HasAckDecimationPackets(Perspective perspective) const {
+  if (perspective == Perspective::IS_SERVER) {
+    return ack_decimation_packets_.HasReceivedValue();
+  } else {
+    return ack_decimation_packets_.HasSendValue();
+  }
+}
+
+uint32_t QuicConfig::AckDecimationPackets(Perspective perspective) const {
+  if (perspective == Perspective::IS_SERVER) {
+    return ack_decimation_packets_.GetReceivedValue();
+  } else {
+    return ack_decimation_packets_.GetSendValue();
+  }
+}
+
 bool QuicConfig::negotiated() const {
   // TODO(ianswett): Add the negotiated parameters once and iterate over all
   // of them in negotiated, ToHandshakeMessage, ProcessClientHello, and
@@ -694,6 +715,7 @@ void QuicConfig::ToHandshakeMessage(CryptoHandshakeMessage* out) const {
   connection_migration_disabled_.ToHandshakeMessage(out);
   connection_options_.ToHandshakeMessage(out);
   alternate_server_address_.ToHandshakeMessage(out);
+  ack_decimation_packets_.ToHandshakeMessage(out);
 }
 
 QuicErrorCode QuicConfig::ProcessPeerHello(
@@ -751,6 +773,10 @@ QuicErrorCode QuicConfig::ProcessPeerHello(
     error = alternate_server_address_.ProcessPeerHello(peer_hello, hello_type,
                                                        error_details);
   }
+  if (error == QUIC_NO_ERROR) {
+    error = ack_decimation_packets_.ProcessPeerHello(peer_hello, hello_type,
+                                                     error_details);
+  }
   return error;
 }
 
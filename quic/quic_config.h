@@ -390,6 +390,14 @@ class NET_EXPORT_PRIVATE QuicConfig {
 
   bool ForceHolBlocking(Perspective perspective) const;
 
+  // Sets the number of retransmittable packets the receiver should wait for
+  // before sending an ack, and enables ack decimation on both endpoints.
+  void SetAckDecimationPacketsToSend(uint32_t packets);
+
+  bool HasAckDecimationPackets(Perspective perspective) const;
+
+  uint32_t AckDecimationPackets(Perspective perspective) const;
+
   bool negotiated() const;
 
   // ToHandshakeMessage serialises the settings in this object as a series of
@@ -452,6 +460,10 @@ class NET_EXPORT_PRIVATE QuicConfig {
 
   // Force HOL blocking for measurement purposes.
   QuicFixedUint32 force_hol_blocking_;
+
+  // Retransmittable packets received before sending an ack with ack
+  // decimation, set by the client.
+  QuicFixedUint32 ack_decimation_packets_;
 };
 
 }  // namespace net
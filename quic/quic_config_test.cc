@@ -247,6 +247,25 @@ TEST_F(QuicConfigTest, HasClientSentConnectionOption) {
       config_.HasClientSentConnectionOption(kTBBR, Perspective::IS_SERVER));
 }
 
+TEST_F(QuicConfigTest, AckDecimationPackets) {
+  QuicConfig client_config;
+  EXPECT_FALSE(client_config.HasAckDecimationPackets(Perspective::IS_CLIENT));
+  client_config.SetAckDecimationPacketsToSend(32);
+  EXPECT_TRUE(client_config.HasAckDecimationPackets(Perspective::IS_CLIENT));
+  EXPECT_EQ(32u, client_config.AckDecimationPackets(Perspective::IS_CLIENT));
+
+  CryptoHandshakeMessage msg;
+  client_config.ToHandshakeMessage(&msg);
+
+  string error_details;
+  const QuicErrorCode error =
+      config_.ProcessPeerHello(msg, CLIENT, &error_details);
+  EXPECT_EQ(QUIC_NO_ERROR, error);
+  EXPECT_TRUE(config_.HasAckDecimationPackets(Perspective::IS_SERVER));
+  EXPECT_EQ(32u, config_.AckDecimationPackets(Perspective::IS_SERVER));
+  EXPECT_FALSE(config_.HasAckDecimationPackets(Perspective::IS_CLIENT));
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace net
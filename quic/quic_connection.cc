@@ -70,11 +70,19 @@ const QuicPacketCount kDefaultRetransmittablePacketsBeforeAck = 2;
 const QuicPacketCount kMinReceivedBeforeAckDecimation = 100;
 // Wait for up to 10 retransmittable packets before sending an ack.
 const QuicPacketCount kMaxRetransmittablePacketsBeforeAck = 10;
+// Bounds on the number of retransmittable packets per ack the peer can
+// negotiate for ack decimation.
+const QuicPacketCount kMinAckDecimationPackets = 2;
+const QuicPacketCount kMaxAckDecimationPackets = 64;
 // One quarter RTT delay when doing ack decimation.
 const float kAckDecimationDelay = 0.25;
 // One eighth RTT delay when doing ack decimation.
 const float kShortAckDecimationDelay = 0.125;
 
+// How far ahead of their send times packets are written when pacing is
+// offloaded to the packet writer.
+const int64_t kPacingOffloadHorizonMs = 10;
+
 bool Near(QuicPacketNumber a, QuicPacketNumber b) {
   QuicPacketNumber delta = (a > b) ? a - b : b - a;
   return delta <= kMaxPacketGap;
@@ -126,7 +134,7 @@ class SendAlarmDelegate : public QuicAlarm::Delegate {
   explicit SendAlarmDelegate(QuicConnection* connection)
       : connection_(connection) {}
 
-  void OnAlarm() override { connection_->WriteAndBundleAcksIfNotBlocked(); }
+  void OnAlarm() override { connection_->OnSendAlarm(); }
 
  private:
   QuicConnection* connection_;
@@ -205,6 +213,21 @@ class MtuDiscoveryAckListener : public QuicAckListenerInterface {
   DISALLOW_COPY_AND_ASSIGN(MtuDiscoveryAckListener);
 };
 
+// Carries release times to writers when the session sets no other options.
+class ReleaseTimeOptions : public PerPacketOptions {
+ public:
+  ReleaseTimeOptions() {}
+
+  PerPacketOptions* Clone() const override {
+    ReleaseTimeOptions* options = new ReleaseTimeOptions;
+    options->set_release_time_delay(release_time_delay());
+    return options;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ReleaseTimeOptions);
+};
+
 }  // namespace
 
 #define ENDPOINT \
@@ -256,6 +279,7 @@ QuicConnection::QuicConnection(QuicConnectionId connection_id,
       stop_waiting_count_(0),
       ack_mode_(TCP_ACKING),
       ack_decimation_delay_(kAckDecimationDelay),
+      ack_decimation_packets_(kMaxRetransmittablePacketsBeforeAck),
       delay_setting_retransmission_alarm_(false),
       pending_retransmission_alarm_(false),
       defer_send_in_response_to_packets_(false),
@@ -365,6 +389,13 @@ void QuicConnection::SetFromConfig(const QuicConfig& config) {
                        config.max_idle_time_before_crypto_handshake());
   }
 
+  if (FLAGS_quic_pacing_offload && writer_->SupportsReleaseTime() &&
+      release_time_options_ == nullptr) {
+    // Must precede SetFromConfig, which creates the pacer.
+    sent_packet_manager_->EnablePacingOffload(
+        QuicTime::Delta::FromMilliseconds(kPacingOffloadHorizonMs));
+    release_time_options_.reset(new ReleaseTimeOptions);
+  }
   sent_packet_manager_->SetFromConfig(config);
   if (config.HasReceivedBytesForConnectionId() &&
       can_truncate_connection_ids_) {
@@ -396,6 +427,18 @@ void QuicConnection::SetFromConfig(const QuicConfig& config) {
     ack_mode_ = ACK_DECIMATION_WITH_REORDERING;
     ack_decimation_delay_ = kShortAckDecimationDelay;
   }
+  if (config.HasAckDecimationPackets(perspective_)) {
+    // A negotiated ack frequency acks every N packets or every 1/8 RTT,
+    // whichever comes first.
+    if (ack_mode_ == TCP_ACKING) {
+      ack_mode_ = ACK_DECIMATION;
+    }
+    ack_decimation_delay_ = kShortAckDecimationDelay;
+    ack_decimation_packets_ = std::max(
+        kMinAckDecimationPackets,
+        std::min<QuicPacketCount>(kMaxAckDecimationPackets,
+                                  config.AckDecimationPackets(perspective_)));
+  }
   if (config.HasClientSentConnectionOption(k5RTO, perspective_)) {
     close_connection_after_five_rtos_ = true;
   }
@@ -1038,10 +1081,11 @@ void QuicConnection::OnPacketComplete() {
 
 void QuicConnection::MaybeQueueAck(bool was_missing) {
   ++num_packets_received_since_last_ack_sent_;
-  // Always send an ack every 20 packets in order to allow the peer to discard
-  // information from the SentPacketManager and provide an RTT measurement.
+  // Always send an ack every 20 packets, or every ack decimation interval if
+  // that is longer, in order to allow the peer to discard information from
+  // the SentPacketManager and provide an RTT measurement.
   if (num_packets_received_since_last_ack_sent_ >=
-      kMaxPacketsReceivedBeforeAckSend) {
+      std::max(kMaxPacketsReceivedBeforeAckSend, ack_decimation_packets_)) {
     ack_queued_ = true;
   }
 
@@ -1058,9 +1102,9 @@ void QuicConnection::MaybeQueueAck(bool was_missing) {
     ++num_retransmittable_packets_received_since_last_ack_sent_;
     if (ack_mode_ != TCP_ACKING &&
         last_header_.packet_number > kMinReceivedBeforeAckDecimation) {
-      // Ack up to 10 packets at once.
+      // Ack up to 10 packets at once, unless the peer negotiated otherwise.
       if (num_retransmittable_packets_received_since_last_ack_sent_ >=
-          kMaxRetransmittablePacketsBeforeAck) {
+          ack_decimation_packets_) {
         ack_queued_ = true;
       } else if (!ack_alarm_->IsSet()) {
         // Wait the minimum of a quarter min_rtt and the delayed ack time.
@@ -1397,6 +1441,11 @@ void QuicConnection::WriteIfNotBlocked() {
   }
 }
 
+void QuicConnection::OnSendAlarm() {
+  ++stats_.send_alarm_count;
+  WriteAndBundleAcksIfNotBlocked();
+}
+
 void QuicConnection::WriteAndBundleAcksIfNotBlocked() {
   if (!writer_->IsWriteBlocked()) {
     ScopedPacketBundler bundler(this, SEND_ACK_IF_QUEUED);
@@ -1646,9 +1695,24 @@ bool QuicConnection::WritePacket(SerializedPacket* packet) {
   // min_rtt_, especially in cases where the thread blocks or gets swapped out
   // during the WritePacket below.
   QuicTime packet_send_time = clock_->Now();
+  PerPacketOptions* options = per_packet_options_;
+  if (release_time_options_ != nullptr) {
+    // The writer holds the packet back until its release time, which is
+    // therefore the time it is sent.
+    QuicTime::Delta release_time_delay = QuicTime::Delta::Zero();
+    if (IsRetransmittable(*packet) == HAS_RETRANSMITTABLE_DATA) {
+      release_time_delay =
+          sent_packet_manager_->GetReleaseTimeDelay(packet_send_time);
+    }
+    if (options == nullptr) {
+      options = release_time_options_.get();
+    }
+    options->set_release_time_delay(release_time_delay);
+    packet_send_time = packet_send_time.Add(release_time_delay);
+  }
   WriteResult result = writer_->WritePacket(
       packet->encrypted_buffer, encrypted_length, self_address().address(),
-      peer_address(), per_packet_options_);
+      peer_address(), options);
   if (result.error_code == ERR_IO_PENDING) {
     DCHECK_EQ(WRITE_STATUS_BLOCKED, result.status);
   }
@@ -401,6 +401,9 @@ class NET_EXPORT_PRIVATE QuicConnection
   // ACKs.
   void WriteAndBundleAcksIfNotBlocked();
 
+  // Called when the send alarm fires.
+  void OnSendAlarm();
+
   // Set the packet writer.
   void SetQuicPacketWriter(QuicPacketWriter* writer, bool owns_writer) {
     DCHECK(writer != nullptr);
@@ -953,6 +956,9 @@ class NET_EXPORT_PRIVATE QuicConnection
   AckMode ack_mode_;
   // The max delay in fraction of min_rtt to use when sending decimated acks.
   float ack_decimation_delay_;
+  // The number of retransmittable packets received before sending an ack
+  // when doing ack decimation.
+  QuicPacketCount ack_decimation_packets_;
 
   // Indicates the retransmit alarm is going to be set by the
   // ScopedRetransmitAlarmDelayer
@@ -1070,6 +1076,10 @@ class NET_EXPORT_PRIVATE QuicConnection
   // If true, multipath is enabled for this connection.
   bool multipath_enabled_;
 
+  // Set when pacing is offloaded to |writer_|. Carries the release time of
+  // each packet if |per_packet_options_| is null.
+  std::unique_ptr<PerPacketOptions> release_time_options_;
+
   DISALLOW_COPY_AND_ASSIGN(QuicConnection);
 };
 
@@ -30,6 +30,7 @@ QuicConnectionStats::QuicConnectionStats()
       loss_timeout_count(0),
       tlp_count(0),
       rto_count(0),
+      send_alarm_count(0),
       min_rtt_us(0),
       srtt_us(0),
       max_packet_size(0),
@@ -286,7 +286,9 @@ class TestPacketWriter : public QuicPacketWriter {
         packets_write_attempts_(0),
         clock_(clock),
         write_pause_time_delta_(QuicTime::Delta::Zero()),
-        max_packet_size_(kMaxPacketSize) {}
+        max_packet_size_(kMaxPacketSize),
+        supports_release_time_(false),
+        last_release_time_delay_(QuicTime::Delta::Zero()) {}
 
   // QuicPacketWriter interface
   WriteResult WritePacket(const char* buffer,
@@ -296,6 +298,9 @@ class TestPacketWriter : public QuicPacketWriter {
                           PerPacketOptions* options) override {
     QuicEncryptedPacket packet(buffer, buf_len);
     ++packets_write_attempts_;
+    last_release_time_delay_ = options == nullptr
+                                   ? QuicTime::Delta::Zero()
+                                   : options->release_time_delay();
 
     if (packet.length() >= sizeof(final_bytes_of_last_packet_)) {
       final_bytes_of_previous_packet_ = final_bytes_of_last_packet_;
@@ -344,6 +349,8 @@ class TestPacketWriter : public QuicPacketWriter {
     return max_packet_size_;
   }
 
+  bool SupportsReleaseTime() const override { return supports_release_time_; }
+
   void BlockOnNextWrite() { block_on_next_write_ = true; }
 
   // Sets the amount of time that the writer should before the actual write.
@@ -421,6 +428,14 @@ class TestPacketWriter : public QuicPacketWriter {
     max_packet_size_ = max_packet_size;
   }
 
+  void set_supports_release_time(bool supports_release_time) {
+    supports_release_time_ = supports_release_time;
+  }
+
+  QuicTime::Delta last_release_time_delay() const {
+    return last_release_time_delay_;
+  }
+
  private:
   QuicVersion version_;
   SimpleQuicFramer framer_;
@@ -438,6 +453,8 @@ class TestPacketWriter : public QuicPacketWriter {
   // time.
   QuicTime::Delta write_pause_time_delta_;
   QuicByteCount max_packet_size_;
+  bool supports_release_time_;
+  QuicTime::Delta last_release_time_delay_;
 
   DISALLOW_COPY_AND_ASSIGN(TestPacketWriter);
 };
@@ -3660,6 +3677,62 @@ TEST_P(QuicConnectionTest, SendDelayedAckDecimationEighthRtt) {
   EXPECT_FALSE(connection_.GetAckAlarm()->IsSet());
 }
 
+TEST_P(QuicConnectionTest, SendDelayedAckDecimationNegotiatedPackets) {
+  // SetFromConfig is always called after construction from InitializeSession.
+  EXPECT_CALL(*send_algorithm_, SetFromConfig(_, _));
+  QuicConfig config;
+  // More than the 20 packets after which an ack is always sent.
+  const QuicPacketCount kPacketsPerAck = 32;
+  config.SetAckDecimationPacketsToSend(kPacketsPerAck);
+  connection_.SetFromConfig(config);
+
+  const size_t kMinRttMs = 40;
+  RttStats* rtt_stats = const_cast<RttStats*>(manager_->GetRttStats());
+  rtt_stats->UpdateRtt(QuicTime::Delta::FromMilliseconds(kMinRttMs),
+                       QuicTime::Delta::Zero(), QuicTime::Zero());
+  // The ack time should be based on min_rtt/8, since it's less than the
+  // default delayed ack time.
+  QuicTime ack_time = clock_.ApproximateNow().Add(
+      QuicTime::Delta::FromMilliseconds(kMinRttMs / 8));
+  EXPECT_CALL(visitor_, OnSuccessfulVersionNegotiation(_));
+  EXPECT_FALSE(connection_.GetAckAlarm()->IsSet());
+  const uint8_t tag = 0x07;
+  connection_.SetDecrypter(ENCRYPTION_INITIAL, new StrictTaggingDecrypter(tag));
+  framer_.SetEncrypter(ENCRYPTION_INITIAL, new TaggingEncrypter(tag));
+  // Process a packet from the non-crypto stream.
+  frame1_.stream_id = 3;
+
+  // Process all the initial packets in order so there aren't missing packets.
+  QuicPacketNumber kFirstDecimatedPacket = 101;
+  for (unsigned int i = 0; i < kFirstDecimatedPacket - 1; ++i) {
+    EXPECT_CALL(visitor_, OnStreamFrame(_)).Times(1);
+    ProcessDataPacketAtLevel(kDefaultPathId, 1 + i, !kEntropyFlag,
+                             !kHasStopWaiting, ENCRYPTION_INITIAL);
+  }
+  EXPECT_FALSE(connection_.GetAckAlarm()->IsSet());
+  EXPECT_CALL(visitor_, OnStreamFrame(_)).Times(1);
+  ProcessDataPacketAtLevel(kDefaultPathId, kFirstDecimatedPacket, !kEntropyFlag,
+                           !kHasStopWaiting, ENCRYPTION_INITIAL);
+
+  // Check if delayed ack timer is running for the expected interval.
+  EXPECT_TRUE(connection_.GetAckAlarm()->IsSet());
+  EXPECT_EQ(ack_time, connection_.GetAckAlarm()->deadline());
+
+  // The 32nd received packet causes an ack to be sent.
+  for (QuicPacketCount i = 1; i < kPacketsPerAck; ++i) {
+    EXPECT_TRUE(connection_.GetAckAlarm()->IsSet());
+    EXPECT_CALL(visitor_, OnStreamFrame(_)).Times(1);
+    ProcessDataPacketAtLevel(kDefaultPathId, kFirstDecimatedPacket + i,
+                             !kEntropyFlag, !kHasStopWaiting,
+                             ENCRYPTION_INITIAL);
+  }
+  // Check that ack is sent and that delayed ack alarm is reset.
+  EXPECT_EQ(2u, writer_->frame_count());
+  EXPECT_FALSE(writer_->stop_waiting_frames().empty());
+  EXPECT_FALSE(writer_->ack_frames().empty());
+  EXPECT_FALSE(connection_.GetAckAlarm()->IsSet());
+}
+
 TEST_P(QuicConnectionTest, SendDelayedAckDecimationWithReordering) {
   QuicConnectionPeer::SetAckMode(
       &connection_, QuicConnection::ACK_DECIMATION_WITH_REORDERING);
@@ -4759,6 +4832,32 @@ TEST_P(QuicConnectionTest, Pacing) {
           &server.sent_packet_manager())));
 }
 
+TEST_P(QuicConnectionTest, PacingOffload) {
+  ValueRestore<bool> old_flag(&FLAGS_quic_pacing_offload, true);
+  writer_->set_supports_release_time(true);
+  QuicConfig config;
+  EXPECT_CALL(*send_algorithm_, SetFromConfig(_, _));
+  connection_.SetFromConfig(config);
+  EXPECT_CALL(*send_algorithm_, PacingRate(_))
+      .WillRepeatedly(Return(QuicBandwidth::FromKBytesPerSecond(100)));
+
+  // The first packet uses the burst token, and the second is sent at once.
+  connection_.SendStreamDataWithString(3, "foo", 0, !kFin, nullptr);
+  connection_.SendStreamDataWithString(3, "bar", 3, !kFin, nullptr);
+  EXPECT_EQ(QuicTime::Delta::Zero(), writer_->last_release_time_delay());
+
+  // The third is written at once as well, but released after the second has
+  // been paced out, which is when it is recorded as sent.
+  QuicTime sent_time = QuicTime::Zero();
+  EXPECT_CALL(*send_algorithm_, OnPacketSent(_, _, _, _, _))
+      .WillOnce(DoAll(SaveArg<0>(&sent_time), Return(true)));
+  connection_.SendStreamDataWithString(3, "baz", 6, !kFin, nullptr);
+  EXPECT_LT(QuicTime::Delta::Zero(), writer_->last_release_time_delay());
+  EXPECT_EQ(clock_.Now().Add(writer_->last_release_time_delay()), sent_time);
+  EXPECT_FALSE(connection_.GetSendAlarm()->IsSet());
+  EXPECT_EQ(3u, writer_->packets_write_attempts());
+}
+
 TEST_P(QuicConnectionTest, WindowUpdateInstigateAcks) {
   EXPECT_CALL(visitor_, OnSuccessfulVersionNegotiation(_));
 
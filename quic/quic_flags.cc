@@ -27,6 +27,15 @@ int64_t FLAGS_quic_time_wait_list_seconds = 200;
 // no configured limit.
 int64_t FLAGS_quic_time_wait_list_max_connections = 600000;
 
+// Maximum number of bytes of stream buffers held by the buffer pool of a QUIC
+// server thread. Streams stop growing their receive windows once most of it
+// is in use.
+int64_t FLAGS_quic_buffer_pool_max_bytes = 512 * 1024 * 1024;
+
+// Maximum number of bytes of freed stream buffers kept for reuse by the buffer
+// pool of a QUIC server thread.
+int64_t FLAGS_quic_buffer_pool_max_pooled_bytes = 4 * 1024 * 1024;
+
 // Enables server-side support for QUIC stateless rejects.
 bool FLAGS_enable_quic_stateless_reject_support = true;
 
@@ -167,3 +176,12 @@ bool FLAGS_quic_enable_version_35 = false;
 
 // If true, enables QUIC_VERSION_36.
 bool FLAGS_quic_enable_version_36 = false;
+
+// If true, QUIC sockets ask the kernel to coalesce received packets with
+// UDP_GRO where it is supported, and split them again after reading.
+bool FLAGS_quic_receive_gro = false;
+
+// If true, QUIC connections whose writer supports it hand the pacer's release
+// times to the kernel with SO_TXTIME, and write packets ahead of them instead
+// of arming the send alarm for every packet.
+bool FLAGS_quic_pacing_offload = false;
@@ -13,6 +13,8 @@ NET_EXPORT_PRIVATE extern bool FLAGS_use_early_return_when_verifying_chlo;
 NET_EXPORT_PRIVATE extern bool FLAGS_quic_allow_bbr;
 NET_EXPORT_PRIVATE extern int64_t FLAGS_quic_time_wait_list_seconds;
 NET_EXPORT_PRIVATE extern int64_t FLAGS_quic_time_wait_list_max_connections;
+NET_EXPORT_PRIVATE extern int64_t FLAGS_quic_buffer_pool_max_bytes;
+NET_EXPORT_PRIVATE extern int64_t FLAGS_quic_buffer_pool_max_pooled_bytes;
 NET_EXPORT_PRIVATE extern bool FLAGS_enable_quic_stateless_reject_support;
 NET_EXPORT_PRIVATE extern bool FLAGS_quic_always_log_bugs_for_tests;
 NET_EXPORT_PRIVATE extern bool FLAGS_quic_disable_hpack_dynamic_table;
@@ -53,5 +55,7 @@ NET_EXPORT_PRIVATE extern bool FLAGS_quic_no_mtu_discovery_ack_listener;
 NET_EXPORT_PRIVATE extern bool FLAGS_quic_simple_packet_number_length;
 NET_EXPORT_PRIVATE extern bool FLAGS_quic_enable_version_35;
 NET_EXPORT_PRIVATE extern bool FLAGS_quic_enable_version_36;
+NET_EXPORT_PRIVATE extern bool FLAGS_quic_receive_gro;
+NET_EXPORT_PRIVATE extern bool FLAGS_quic_pacing_offload;
 
 #endif  // NET_QUIC_QUIC_FLAGS_H_
@@ -126,6 +126,13 @@ void QuicFlowController::MaybeIncreaseMaxWindowSize() {
     return;
   }
 
+  // Don't buffer more data per stream while the stream buffers of the
+  // connection's thread are close to their memory limit.
+  if (connection_->helper()->GetBufferAllocator()->IsMemoryConstrained()) {
+    DVLOG(1) << ENDPOINT << "memory constrained for stream " << id_;
+    return;
+  }
+
   // Get outbound RTT.
   QuicTime::Delta rtt =
       connection_->sent_packet_manager().GetRttStats()->smoothed_rtt();
@@ -9,6 +9,7 @@
 
 #include "net/base/ip_endpoint.h"
 #include "net/quic/quic_protocol.h"
+#include "net/quic/quic_time.h"
 
 namespace net {
 
@@ -17,13 +18,22 @@ struct WriteResult;
 
 class NET_EXPORT_PRIVATE PerPacketOptions {
  public:
-  PerPacketOptions() = default;
+  PerPacketOptions() : release_time_delay_(QuicTime::Delta::Zero()) {}
   virtual ~PerPacketOptions() {}
 
   // Returns a heap-allocated copy of |this|.
   virtual PerPacketOptions* Clone() const = 0;
 
+  // How long after the write the packet should leave the host. Only writers
+  // for which SupportsReleaseTime() is true act on it; others send at once.
+  QuicTime::Delta release_time_delay() const { return release_time_delay_; }
+  void set_release_time_delay(QuicTime::Delta delay) {
+    release_time_delay_ = delay;
+  }
+
  private:
+  QuicTime::Delta release_time_delay_;
+
   PerPacketOptions(PerPacketOptions&& other) = delete;
   PerPacketOptions& operator=(PerPacketOptions&& other) = delete;
 
@@ -66,6 +76,10 @@ class NET_EXPORT_PRIVATE QuicPacketWriter {
   // size of a valid QUIC packet.
   virtual QuicByteCount GetMaxPacketSize(
       const IPEndPoint& peer_address) const = 0;
+
+  // Returns true if the writer can hold packets back until the release time
+  // in their PerPacketOptions, for example by passing it to the kernel.
+  virtual bool SupportsReleaseTime() const { return false; }
 };
 
 }  // namespace net
@@ -479,11 +479,12 @@ PacketNumberQueue& PacketNumberQueue::operator=(
 //    default;
 
 void PacketNumberQueue::Add(QuicPacketNumber packet_number) {
-  packet_number_intervals_.Add(packet_number, packet_number + 1);
+  packet_number_intervals_.AddOptimizedForAppend(packet_number,
+                                                 packet_number + 1);
 }
 
 void PacketNumberQueue::Add(QuicPacketNumber lower, QuicPacketNumber higher) {
-  packet_number_intervals_.Add(lower, higher);
+  packet_number_intervals_.AddOptimizedForAppend(lower, higher);
 }
 
 void PacketNumberQueue::Remove(QuicPacketNumber packet_number) {
@@ -500,7 +501,7 @@ bool PacketNumberQueue::RemoveUpTo(QuicPacketNumber higher) {
     return false;
   }
   const QuicPacketNumber old_min = Min();
-  packet_number_intervals_.Difference(0, higher);
+  packet_number_intervals_.TrimLessThan(higher);
   return Empty() || old_min != Min();
 }
 
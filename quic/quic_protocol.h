@@ -810,6 +810,10 @@ class NET_EXPORT_PRIVATE QuicBufferAllocator {
   // Marks the allocator as being idle. Serves as a hint to notify the allocator
   // that it should release any resources it's still holding on to.
   virtual void MarkAllocatorIdle() {}
+
+  // Returns true if the allocator is close to its memory limit, in which case
+  // streams should stop growing their receive windows.
+  virtual bool IsMemoryConstrained() const { return false; }
 };
 
 // Deleter for stream buffers. Copyable to support platforms where the deleter
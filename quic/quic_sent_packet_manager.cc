@@ -90,6 +90,7 @@ QuicSentPacketManager::QuicSentPacketManager(
       max_tail_loss_probes_(kDefaultMaxTailLossProbes),
       enable_half_rtt_tail_loss_probe_(false),
       using_pacing_(false),
+      pacing_offload_horizon_(QuicTime::Delta::Zero()),
       use_new_rto_(false),
       undo_pending_retransmits_(false),
       largest_newly_acked_(0),
@@ -207,6 +208,14 @@ void QuicSentPacketManager::SetMaxPacingRate(QuicBandwidth max_pacing_rate) {
   }
 }
 
+void QuicSentPacketManager::EnablePacingOffload(QuicTime::Delta horizon) {
+  pacing_offload_horizon_ = horizon;
+  if (using_pacing_) {
+    static_cast<PacingSender*>(send_algorithm_.get())
+        ->SetReleaseTimeHorizon(horizon);
+  }
+}
+
 void QuicSentPacketManager::SetHandshakeConfirmed() {
   handshake_confirmed_ = true;
 }
@@ -806,6 +815,15 @@ QuicTime::Delta QuicSentPacketManager::TimeUntilSend(
   return delay;
 }
 
+QuicTime::Delta QuicSentPacketManager::GetReleaseTimeDelay(QuicTime now) const {
+  // Tail loss probes and RTO retransmissions are not paced.
+  if (!using_pacing_ || pending_timer_transmission_count_ > 0) {
+    return QuicTime::Delta::Zero();
+  }
+  return static_cast<const PacingSender*>(send_algorithm_.get())
+      ->GetReleaseTimeDelay(now);
+}
+
 const QuicTime QuicSentPacketManager::GetRetransmissionTime() const {
   // Don't set the timer if there are no packets in flight or we've already
   // queued a tlp transmission and it hasn't been sent yet.
@@ -958,6 +976,10 @@ void QuicSentPacketManager::EnablePacing() {
   send_algorithm_.reset(new PacingSender(send_algorithm_.release(),
                                          QuicTime::Delta::FromMilliseconds(1),
                                          kInitialUnpacedBurst));
+  if (!pacing_offload_horizon_.IsZero()) {
+    static_cast<PacingSender*>(send_algorithm_.get())
+        ->SetReleaseTimeHorizon(pacing_offload_horizon_);
+  }
 }
 
 void QuicSentPacketManager::OnConnectionMigration(QuicPathId,
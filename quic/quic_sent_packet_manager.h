@@ -87,6 +87,8 @@ class NET_EXPORT_PRIVATE QuicSentPacketManager
 
   void SetMaxPacingRate(QuicBandwidth max_pacing_rate) override;
 
+  void EnablePacingOffload(QuicTime::Delta horizon) override;
+
   void SetHandshakeConfirmed() override;
 
   // Processes the incoming ack.
@@ -157,6 +159,8 @@ class NET_EXPORT_PRIVATE QuicSentPacketManager
                                 HasRetransmittableData retransmittable,
                                 QuicPathId* path_id) override;
 
+  QuicTime::Delta GetReleaseTimeDelay(QuicTime now) const override;
+
   // Returns the current delay for the retransmission timer, which may send
   // either a tail loss probe or do a full RTO.  Returns QuicTime::Zero() if
   // there are no retransmittable packets.
@@ -379,6 +383,8 @@ class NET_EXPORT_PRIVATE QuicSentPacketManager
   // If true, send the TLP at 0.5 RTT.
   bool enable_half_rtt_tail_loss_probe_;
   bool using_pacing_;
+  // The horizon passed to the pacing sender, or zero without pacing offload.
+  QuicTime::Delta pacing_offload_horizon_;
   // If true, use the new RTO with loss based CWND reduction instead of the send
   // algorithms's OnRetransmissionTimeout to reduce the congestion window.
   bool use_new_rto_;
@@ -74,6 +74,11 @@ class NET_EXPORT_PRIVATE QuicSentPacketManagerInterface {
   // Sets max pacing rate of the default path.
   virtual void SetMaxPacingRate(QuicBandwidth max_pacing_rate) = 0;
 
+  // Lets the pacer of the default path write packets up to |horizon| before
+  // their send times, to be held back by the writer until the release time
+  // returned by GetReleaseTimeDelay.
+  virtual void EnablePacingOffload(QuicTime::Delta horizon) = 0;
+
   // Indicates the handshake has completed, so no handshake packets need to be
   // retransmitted.
   virtual void SetHandshakeConfirmed() = 0;
@@ -127,6 +132,10 @@ class NET_EXPORT_PRIVATE QuicSentPacketManagerInterface {
                                         HasRetransmittableData retransmittable,
                                         QuicPathId* path_id) = 0;
 
+  // Returns how long after |now| the next retransmittable packet should
+  // leave the host, when pacing is offloaded.
+  virtual QuicTime::Delta GetReleaseTimeDelay(QuicTime now) const = 0;
+
   // Returns the earliest retransmission time of all paths.
   // TODO(fayang): This method should not be const becasue the return value
   // depends upon the time it is invoked.
@@ -1596,6 +1596,10 @@ int QuicStreamFactory::ConfigureSocket(DatagramClientSocket* socket,
     return rv;
   }
 
+  // Kernel receive timestamps make RTT samples independent of how long the
+  // packets waited for the message loop. Not all sockets support them.
+  socket->EnableReceiveTimestamps();
+
   socket->GetLocalAddress(&local_address_);
   if (check_persisted_supports_quic_) {
     check_persisted_supports_quic_ = false;
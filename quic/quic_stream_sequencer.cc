@@ -28,8 +28,13 @@ namespace net {
 
 QuicStreamSequencer::QuicStreamSequencer(ReliableQuicStream* quic_stream,
                                          const QuicClock* clock)
+    : QuicStreamSequencer(quic_stream, clock, nullptr) {}
+
+QuicStreamSequencer::QuicStreamSequencer(ReliableQuicStream* quic_stream,
+                                         const QuicClock* clock,
+                                         QuicBufferAllocator* allocator)
     : stream_(quic_stream),
-      buffered_frames_(kStreamReceiveWindowLimit),
+      buffered_frames_(kStreamReceiveWindowLimit, allocator),
       close_offset_(numeric_limits<QuicStreamOffset>::max()),
       blocked_(false),
       num_frames_received_(0),
@@ -28,6 +28,10 @@ class ReliableQuicStream;
 class NET_EXPORT_PRIVATE QuicStreamSequencer {
  public:
   QuicStreamSequencer(ReliableQuicStream* quic_stream, const QuicClock* clock);
+  // Buffers data in blocks from |allocator|, which must outlive the sequencer.
+  QuicStreamSequencer(ReliableQuicStream* quic_stream,
+                      const QuicClock* clock,
+                      QuicBufferAllocator* allocator);
   virtual ~QuicStreamSequencer();
 
   // If the frame is the next one we need in order to process in-order data,
@@ -34,11 +34,17 @@ QuicStreamSequencerBuffer::FrameInfo::FrameInfo(size_t length,
     : length(length), timestamp(timestamp) {}
 
 QuicStreamSequencerBuffer::QuicStreamSequencerBuffer(size_t max_capacity_bytes)
+    : QuicStreamSequencerBuffer(max_capacity_bytes, nullptr) {}
+
+QuicStreamSequencerBuffer::QuicStreamSequencerBuffer(
+    size_t max_capacity_bytes,
+    QuicBufferAllocator* allocator)
     : max_buffer_capacity_bytes_(max_capacity_bytes),
       blocks_count_(
           ceil(static_cast<double>(max_capacity_bytes) / kBlockSizeBytes)),
       total_bytes_read_(0),
-      blocks_(blocks_count_) {
+      blocks_(blocks_count_),
+      allocator_(allocator) {
   Clear();
 }
 
@@ -63,11 +69,22 @@ void QuicStreamSequencerBuffer::Clear() {
 
 void QuicStreamSequencerBuffer::RetireBlock(size_t idx) {
   DCHECK(blocks_[idx] != nullptr);
-  delete blocks_[idx];
+  if (allocator_ != nullptr) {
+    allocator_->Delete(blocks_[idx]->buffer);
+  } else {
+    delete blocks_[idx];
+  }
   blocks_[idx] = nullptr;
   DVLOG(1) << "Retired block with index: " << idx;
 }
 
+QuicStreamSequencerBuffer::BufferBlock* QuicStreamSequencerBuffer::NewBlock() {
+  if (allocator_ == nullptr) {
+    return new BufferBlock();
+  }
+  return reinterpret_cast<BufferBlock*>(allocator_->New(sizeof(BufferBlock)));
+}
+
 QuicErrorCode QuicStreamSequencerBuffer::OnStreamData(
     QuicStreamOffset starting_offset,
     base::StringPiece data,
@@ -151,9 +168,8 @@ QuicErrorCode QuicStreamSequencerBuffer::OnStreamData(
     }
 
     if (blocks_[write_block_num] == nullptr) {
-      // TODO(danzh): Investigate if using a freelist would improve performance.
       // Same as RetireBlock().
-      blocks_[write_block_num] = new BufferBlock();
+      blocks_[write_block_num] = NewBlock();
     }
 
     const size_t bytes_to_copy = min<size_t>(bytes_avail, source_remaining);
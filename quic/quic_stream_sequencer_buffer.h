@@ -105,6 +105,10 @@ class NET_EXPORT_PRIVATE QuicStreamSequencerBuffer {
   };
 
   explicit QuicStreamSequencerBuffer(size_t max_capacity_bytes);
+  // Allocates blocks from |allocator|, which must outlive this buffer, instead
+  // of with operator new.
+  QuicStreamSequencerBuffer(size_t max_capacity_bytes,
+                            QuicBufferAllocator* allocator);
   ~QuicStreamSequencerBuffer();
 
   // Free the space used to buffer data.
@@ -169,6 +173,9 @@ class NET_EXPORT_PRIVATE QuicStreamSequencerBuffer {
   // in order to indicate that no memory set is allocated for that block.
   void RetireBlock(size_t index);
 
+  // Allocates a block from |allocator_|, or with operator new if it is null.
+  BufferBlock* NewBlock();
+
   // Should only be called after the indexed block is read till the end of the
   // block or a gap has been reached.
   // If the block at |block_index| contains no buffered data, then the block is
@@ -236,6 +243,9 @@ class NET_EXPORT_PRIVATE QuicStreamSequencerBuffer {
   // Number of bytes in buffer.
   size_t num_bytes_buffered_;
 
+  // Not owned. May be null.
+  QuicBufferAllocator* const allocator_;
+
   // Stores all the buffered frames' start offset, length and arrival time.
   std::map<QuicStreamOffset, FrameInfo> frame_arrival_time_map_;
 
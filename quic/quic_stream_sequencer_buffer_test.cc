@@ -12,6 +12,7 @@
 #include "base/logging.h"
 #include "base/macros.h"
 #include "base/rand_util.h"
+#include "net/quic/quic_buffer_pool.h"
 #include "net/quic/test_tools/mock_clock.h"
 #include "net/quic/test_tools/quic_test_utils.h"
 #include "net/test/gtest_util.h"
@@ -444,6 +445,32 @@ TEST_F(QuicStreamSequencerBufferTest, ClearAfterRead) {
   EXPECT_TRUE(helper_->CheckBufferInvariants());
 }
 
+TEST_F(QuicStreamSequencerBufferTest, BlocksFromAllocator) {
+  QuicBufferPool pool(1024 * 1024, 1024 * 1024);
+  QuicStreamSequencerBuffer buffer(max_capacity_bytes_, &pool);
+  string source(kBlockSizeBytes + 50, 'a');
+  size_t written;
+  EXPECT_EQ(QUIC_NO_ERROR,
+            buffer.OnStreamData(0, source, clock_.ApproximateNow(), &written,
+                                &error_details_));
+  EXPECT_EQ(2 * kBlockSizeBytes, pool.bytes_in_use());
+
+  // Reading the data retires both blocks into the pool.
+  char dest[kBlockSizeBytes + 50];
+  const iovec iov{dest, sizeof(dest)};
+  EXPECT_EQ(source.size(), buffer.Readv(&iov, 1));
+  EXPECT_EQ(source, string(dest, sizeof(dest)));
+  EXPECT_EQ(0u, pool.bytes_in_use());
+  EXPECT_EQ(2 * kBlockSizeBytes, pool.bytes_pooled());
+
+  // New blocks are taken from the pool.
+  EXPECT_EQ(QUIC_NO_ERROR,
+            buffer.OnStreamData(source.size(), "b", clock_.ApproximateNow(),
+                                &written, &error_details_));
+  EXPECT_EQ(kBlockSizeBytes, pool.bytes_in_use());
+  EXPECT_EQ(kBlockSizeBytes, pool.bytes_pooled());
+}
+
 TEST_F(QuicStreamSequencerBufferTest,
        OnStreamDataAcrossLastBlockAndFillCapacity) {
   string source(kBlockSizeBytes + 50, 'a');
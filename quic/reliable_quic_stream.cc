@@ -52,7 +52,9 @@ ReliableQuicStream::PendingData::~PendingData() {}
 
 ReliableQuicStream::ReliableQuicStream(QuicStreamId id, QuicSession* session)
     : queued_data_bytes_(0),
-      sequencer_(this, session->connection()->clock()),
+      sequencer_(this,
+                 session->connection()->clock(),
+                 session->connection()->helper()->GetBufferAllocator()),
       id_(id),
       session_(session),
       stream_bytes_read_(0),
@@ -2,9 +2,13 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <string.h>
+
+#include <algorithm>
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <string>
 #include <vector>
@@ -23,8 +27,11 @@
 #include "base/strings/stringprintf.h"
 #include "base/threading/thread_task_runner_handle.h"
 #include "net/base/cache_type.h"
+#include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/disk_cache/disk_cache.h"
+#include "net/disk_cache/memory/mem_backend_impl.h"
+#include "net/disk_cache/memory/mem_stream.h"
 #include "net/disk_cache/simple/simple_backend_impl.h"
 #include "net/disk_cache/simple/simple_index.h"
 
@@ -223,7 +230,95 @@ uint64_t GetMemoryConsumption() {
   return total_size;
 }
 
-bool CacheMemTest(const std::vector<std::unique_ptr<CacheSpec>>& specs) {
+// Parses the value of --memory-cache, e.g. "1000x16384": the number of entries
+// of a memory cache and the size of their data.
+bool ParseMemoryCacheSpec(const std::string& spec_string,
+                          int* entry_count,
+                          int* entry_size) {
+  std::vector<std::string> tokens = base::SplitString(
+      spec_string, "x", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL);
+  return tokens.size() == 2 && base::StringToInt(tokens[0], entry_count) &&
+         base::StringToInt(tokens[1], entry_size) && *entry_count > 0 &&
+         *entry_size >= 0;
+}
+
+// Fills a memory cache with |entry_count| entries of |entry_size| bytes of
+// data, written in network sized pieces.
+std::unique_ptr<Backend> CreateAndFillMemoryBackend(int entry_count,
+                                                    int entry_size) {
+  const int kWriteSize = 1460;
+  // Leave room for the keys, and for whole chunks of data, so that no entry is
+  // evicted.
+  const int64_t chunks_per_entry =
+      (static_cast<int64_t>(entry_size) + kMemChunkSize - 1) / kMemChunkSize;
+  const int64_t max_size =
+      entry_count * (chunks_per_entry * kMemChunkSize + 64) + 64 * 1024 * 1024;
+  if (max_size > std::numeric_limits<int32_t>::max()) {
+    LOG(ERROR) << "Memory cache too big";
+    return nullptr;
+  }
+  std::unique_ptr<Backend> backend =
+      MemBackendImpl::CreateBackend(static_cast<int>(max_size), nullptr);
+  if (!backend)
+    return nullptr;
+
+  scoped_refptr<net::IOBuffer> buffer(new net::IOBuffer(kWriteSize));
+  memset(buffer->data(), 'x', kWriteSize);
+  // The memory cache completes all the operations synchronously.
+  for (int i = 0; i < entry_count; ++i) {
+    Entry* entry;
+    if (backend->CreateEntry(base::StringPrintf("key%d", i), &entry,
+                             net::CompletionCallback()) != net::OK) {
+      return nullptr;
+    }
+    for (int offset = 0; offset < entry_size; offset += kWriteSize) {
+      const int len = std::min(kWriteSize, entry_size - offset);
+      if (entry->WriteData(1, offset, buffer.get(), len,
+                           net::CompletionCallback(), false) != len) {
+        entry->Close();
+        return nullptr;
+      }
+    }
+    entry->Close();
+  }
+  return backend;
+}
+
+// Prints how many entries like the |entry_count| ones of |backend| a memory
+// cache of the default size holds, as stored, and as stored in whole chunks
+// only, before small streams got chunks of their own size.
+void PrintMemoryCacheCapacity(Backend* backend,
+                              int entry_count,
+                              int entry_size) {
+  const int64_t kDefaultMemoryCacheSize = 10 * 1024 * 1024;
+  int64_t storage_size = 0;
+  int64_t content_size = 0;
+  base::StringPairs stats;
+  backend->GetStats(&stats);
+  for (const auto& stat : stats) {
+    if (stat.first == "Storage size")
+      base::StringToInt64(stat.second, &storage_size);
+    else if (stat.first == "Content size")
+      base::StringToInt64(stat.second, &content_size);
+  }
+  const int64_t key_size =
+      content_size - static_cast<int64_t>(entry_count) * entry_size;
+  const int64_t whole_chunks_size =
+      key_size + entry_count * ((static_cast<int64_t>(entry_size) +
+                                 kMemChunkSize - 1) /
+                                kMemChunkSize * kMemChunkSize);
+  if (!storage_size || !whole_chunks_size)
+    return;
+  std::cout << "Memory cache capacity at 10 MB, in entries : "
+            << kDefaultMemoryCacheSize * entry_count / storage_size
+            << " (whole chunks only: "
+            << kDefaultMemoryCacheSize * entry_count / whole_chunks_size << ")"
+            << std::endl;
+}
+
+bool CacheMemTest(const std::vector<std::unique_ptr<CacheSpec>>& specs,
+                  int memory_entry_count,
+                  int memory_entry_size) {
   std::vector<std::unique_ptr<Backend>> backends;
   for (const auto& it : specs) {
     std::unique_ptr<Backend> backend = CreateAndInitBackend(*it);
@@ -233,6 +328,28 @@ bool CacheMemTest(const std::vector<std::unique_ptr<CacheSpec>>& specs) {
               << backend->GetEntryCount() << std::endl;
     backends.push_back(std::move(backend));
   }
+  if (memory_entry_count) {
+    const uint64_t initial_memory_consumption = GetMemoryConsumption();
+    std::unique_ptr<Backend> backend =
+        CreateAndFillMemoryBackend(memory_entry_count, memory_entry_size);
+    if (!backend) {
+      LOG(ERROR) << "Could not fill the memory cache";
+      return false;
+    }
+    std::cout << "Number of entries in the memory cache : "
+              << backend->GetEntryCount() << std::endl;
+    base::StringPairs stats;
+    backend->GetStats(&stats);
+    for (const auto& stat : stats)
+      std::cout << "Memory cache " << stat.first << " : " << stat.second
+                << std::endl;
+    PrintMemoryCacheCapacity(backend.get(), memory_entry_count,
+                             memory_entry_size);
+    std::cout << "Private dirty memory of the memory cache: "
+              << GetMemoryConsumption() - initial_memory_consumption << " kB"
+              << std::endl;
+    backends.push_back(std::move(backend));
+  }
   const uint64_t memory_consumption = GetMemoryConsumption();
   std::cout << "Private dirty memory: " << memory_consumption << " kB"
             << std::endl;
@@ -242,13 +359,16 @@ bool CacheMemTest(const std::vector<std::unique_ptr<CacheSpec>>& specs) {
 void PrintUsage(std::ostream* stream) {
   *stream << "Usage: disk_cache_mem_test "
           << "--spec-1=<spec> "
-          << "[--spec-2=<spec>]"
+          << "[--spec-2=<spec>] "
+          << "[--memory-cache=<entry_count>x<entry_size>]"
           << std::endl
           << "  with <cache_spec>=<backend_type>:<cache_type>:<cache_path>"
           << std::endl
           << "       <backend_type>='block_file'|'simple'" << std::endl
           << "       <cache_type>='disk_cache'|'app_cache'" << std::endl
-          << "       <cache_path>=file system path" << std::endl;
+          << "       <cache_path>=file system path" << std::endl
+          << "  --memory-cache also fills a memory cache, and reports its"
+          << " footprint" << std::endl;
 }
 
 bool ParseAndStoreSpec(const std::string& spec_str,
@@ -272,11 +392,21 @@ bool Main(int argc, char** argv) {
     PrintUsage(&std::cout);
     return true;
   }
-  if ((command_line.GetSwitches().size() != 1 &&
-       command_line.GetSwitches().size() != 2) ||
+  const size_t memory_switch_count =
+      command_line.HasSwitch("memory-cache") ? 1 : 0;
+  const size_t spec_switch_count =
+      command_line.GetSwitches().size() - memory_switch_count;
+  if ((spec_switch_count != 1 && spec_switch_count != 2) ||
       !command_line.HasSwitch("spec-1") ||
-      (command_line.GetSwitches().size() == 2 &&
-       !command_line.HasSwitch("spec-2"))) {
+      (spec_switch_count == 2 && !command_line.HasSwitch("spec-2"))) {
+    PrintUsage(&std::cerr);
+    return false;
+  }
+  int memory_entry_count = 0;
+  int memory_entry_size = 0;
+  if (memory_switch_count &&
+      !ParseMemoryCacheSpec(command_line.GetSwitchValueASCII("memory-cache"),
+                            &memory_entry_count, &memory_entry_size)) {
     PrintUsage(&std::cerr);
     return false;
   }
@@ -289,7 +419,7 @@ bool Main(int argc, char** argv) {
     if (!ParseAndStoreSpec(spec_str_2, &specs))
       return false;
   }
-  return CacheMemTest(specs);
+  return CacheMemTest(specs, memory_entry_count, memory_entry_size);
 }
 
 }  // namespace
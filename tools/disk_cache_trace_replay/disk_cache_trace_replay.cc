@@ -0,0 +1,774 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// Replays a trace of cache accesses against a disk cache backend, and reports
+// the hit ratios, the latency of each kind of operation, the throughput and the
+// memory used by the process.
+//
+// The trace is a text file with one operation per line:
+//   <timestamp_us> <op> <key> <stream_0_size> <stream_1_size> <stream_2_size>
+// where <op> is one of:
+//   get:  opens the entry and reads all of its streams. The sizes are those of
+//         the response that was asked for; the byte hit ratio is the part of
+//         them that the gets read from the cache.
+//   put:  replaces the entry with one that has streams of the given sizes.
+//   doom: removes the entry. The sizes may be omitted.
+// Empty lines, and lines that start with '#', are ignored.
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "base/at_exit.h"
+#include "base/bind.h"
+#include "base/command_line.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/logging.h"
+#include "base/macros.h"
+#include "base/message_loop/message_loop.h"
+#include "base/process/process_metrics.h"
+#include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_piece.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "base/threading/thread.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "net/base/cache_type.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "net/disk_cache/disk_cache.h"
+
+namespace disk_cache {
+namespace {
+
+const char kTraceSwitch[] = "trace";
+const char kBackendSwitch[] = "backend";
+const char kCachePathSwitch[] = "cache-path";
+const char kMaxSizeSwitch[] = "max-size";
+const char kConcurrencySwitch[] = "concurrency";
+const char kSpeedSwitch[] = "speed";
+const char kFillOnMissSwitch[] = "fill-on-miss";
+
+const int kStreamCount = 3;
+
+// The size of each read or write issued to the cache.
+const int kIOSize = 64 * 1024;
+
+// The memory use of the process is sampled every this many operations.
+const int kMemorySampleInterval = 1000;
+
+enum OperationType {
+  OPERATION_GET,
+  OPERATION_PUT,
+  OPERATION_DOOM,
+  OPERATION_MAX,
+};
+
+const char* const kOperationNames[OPERATION_MAX] = {"get", "put", "doom"};
+
+struct TraceRecord {
+  int64_t timestamp_us;
+  OperationType type;
+  std::string key;
+  int stream_sizes[kStreamCount];
+
+  int64_t GetTotalSize() const {
+    int64_t total_size = 0;
+    for (int size : stream_sizes)
+      total_size += size;
+    return total_size;
+  }
+};
+
+bool ParseTraceLine(base::StringPiece line, TraceRecord* record) {
+  std::vector<base::StringPiece> tokens = base::SplitStringPiece(
+      line, base::kWhitespaceASCII, base::KEEP_WHITESPACE,
+      base::SPLIT_WANT_NONEMPTY);
+  if (tokens.size() != 3 && tokens.size() != 3 + kStreamCount)
+    return false;
+  if (!base::StringToInt64(tokens[0], &record->timestamp_us))
+    return false;
+
+  int type = 0;
+  while (type < OPERATION_MAX && tokens[1] != kOperationNames[type])
+    type++;
+  if (type == OPERATION_MAX)
+    return false;
+  record->type = static_cast<OperationType>(type);
+  record->key = tokens[2].as_string();
+
+  if (tokens.size() == 3)
+    return record->type == OPERATION_DOOM;
+  for (int i = 0; i < kStreamCount; ++i) {
+    if (!base::StringToInt(tokens[3 + i], &record->stream_sizes[i]) ||
+        record->stream_sizes[i] < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ReadTrace(const base::FilePath& path, std::vector<TraceRecord>* records) {
+  std::string contents;
+  if (!base::ReadFileToString(path, &contents)) {
+    LOG(ERROR) << "Could not read " << path.LossyDisplayName();
+    return false;
+  }
+  int line_number = 0;
+  for (base::StringPiece line : base::SplitStringPiece(
+           contents, "\n", base::TRIM_WHITESPACE, base::SPLIT_WANT_ALL)) {
+    line_number++;
+    if (line.empty() || line.starts_with("#"))
+      continue;
+    TraceRecord record = {};
+    if (!ParseTraceLine(line, &record)) {
+      LOG(ERROR) << "Invalid trace line " << line_number << ": " << line;
+      return false;
+    }
+    records->push_back(record);
+  }
+  return true;
+}
+
+// Returns the value at |percentile| of |values|, which get sorted.
+int64_t GetPercentile(std::vector<int64_t>* values, int percentile) {
+  if (values->empty())
+    return 0;
+  std::sort(values->begin(), values->end());
+  size_t index = values->size() * percentile / 100;
+  return (*values)[std::min(index, values->size() - 1)];
+}
+
+// Issues the operations of a trace to a backend, at most |concurrency| of them
+// at a time, and only one at a time for a given key: the operations of a busy
+// key wait in a queue of their own, in the order of the trace, while those of
+// the other keys go on. With a |speed| other than
+// zero, operations are not issued before their timestamp, accelerated by that
+// factor, so that the idle time of the trace is replayed too.
+class TraceReplayer {
+ public:
+  TraceReplayer(Backend* backend,
+                const std::vector<TraceRecord>* records,
+                int concurrency,
+                double speed,
+                bool fill_on_miss);
+  ~TraceReplayer();
+
+  // Replays the whole trace.
+  void Run();
+
+  void PrintReport(std::ostream* stream);
+
+ private:
+  class Operation;
+
+  void IssueOperations();
+  void StartOperation(const TraceRecord& record);
+  void OnOperationDone(Operation* operation);
+  void FinishOperation(Operation* operation);
+
+  // Called by the operations.
+  void RecordOperation(OperationType type,
+                       base::TimeDelta latency,
+                       bool succeeded);
+  void RecordGet(const TraceRecord& record, bool hit, int64_t bytes_read);
+
+  void SampleMemory();
+
+  Backend* const backend_;
+  const std::vector<TraceRecord>* const records_;
+  const int concurrency_;
+  const double speed_;
+  const bool fill_on_miss_;
+
+  scoped_refptr<net::IOBuffer> write_buffer_;
+
+  size_t next_record_;
+  std::unordered_map<Operation*, std::unique_ptr<Operation>> operations_;
+  // The keys with an operation in flight, and the records of each waiting for
+  // it to finish.
+  std::unordered_map<std::string, std::deque<const TraceRecord*>> busy_keys_;
+  // Records whose key is already marked busy, to be issued first.
+  std::deque<const TraceRecord*> ready_records_;
+  base::OneShotTimer timer_;
+  std::unique_ptr<base::RunLoop> run_loop_;
+
+  base::TimeTicks start_time_;
+  base::TimeTicks end_time_;
+  int64_t completed_operations_;
+  std::vector<int64_t> latencies_us_[OPERATION_MAX];
+  int errors_[OPERATION_MAX];
+  int64_t gets_;
+  int64_t hits_;
+  int64_t requested_bytes_;
+  int64_t hit_bytes_;
+
+  std::unique_ptr<base::ProcessMetrics> process_metrics_;
+  size_t max_working_set_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceReplayer);
+};
+
+// The operation of a trace record, from the open or create of the entry to its
+// close.
+class TraceReplayer::Operation {
+ public:
+  Operation(TraceReplayer* replayer, const TraceRecord& record)
+      : replayer_(replayer),
+        record_(record),
+        type_(record.type),
+        next_state_(STATE_NONE),
+        entry_(nullptr),
+        stream_(0),
+        offset_(0),
+        write_len_(0),
+        hit_(false),
+        bytes_read_(0),
+        recreated_(false) {}
+
+  ~Operation() {
+    if (entry_)
+      entry_->Close();
+  }
+
+  const std::string& key() const { return record_.key; }
+
+  // Returns true if the operation completed synchronously. Otherwise the
+  // replayer is told about its completion later.
+  bool Start() {
+    start_time_ = base::TimeTicks::Now();
+    switch (type_) {
+      case OPERATION_GET:
+        next_state_ = STATE_OPEN;
+        break;
+      case OPERATION_PUT:
+        next_state_ = STATE_CREATE;
+        break;
+      case OPERATION_DOOM:
+        next_state_ = STATE_DOOM;
+        break;
+      case OPERATION_MAX:
+        NOTREACHED();
+        break;
+    }
+    return DoLoop(net::OK) != net::ERR_IO_PENDING;
+  }
+
+ private:
+  enum State {
+    STATE_NONE,
+    STATE_OPEN,
+    STATE_OPEN_COMPLETE,
+    STATE_READ,
+    STATE_READ_COMPLETE,
+    STATE_CREATE,
+    STATE_CREATE_COMPLETE,
+    STATE_DOOM,
+    STATE_DOOM_COMPLETE,
+    STATE_WRITE,
+    STATE_WRITE_COMPLETE,
+  };
+
+  void OnIOComplete(int result) {
+    if (DoLoop(result) != net::ERR_IO_PENDING)
+      replayer_->OnOperationDone(this);
+  }
+
+  net::CompletionCallback GetCallback() {
+    return base::Bind(&Operation::OnIOComplete, base::Unretained(this));
+  }
+
+  int DoLoop(int result) {
+    DCHECK_NE(STATE_NONE, next_state_);
+    int rv = result;
+    do {
+      State state = next_state_;
+      next_state_ = STATE_NONE;
+      switch (state) {
+        case STATE_OPEN:
+          rv = DoOpen();
+          break;
+        case STATE_OPEN_COMPLETE:
+          rv = DoOpenComplete(rv);
+          break;
+        case STATE_READ:
+          rv = DoRead();
+          break;
+        case STATE_READ_COMPLETE:
+          rv = DoReadComplete(rv);
+          break;
+        case STATE_CREATE:
+          rv = DoCreate();
+          break;
+        case STATE_CREATE_COMPLETE:
+          rv = DoCreateComplete(rv);
+          break;
+        case STATE_DOOM:
+          rv = DoDoom();
+          break;
+        case STATE_DOOM_COMPLETE:
+          rv = DoDoomComplete(rv);
+          break;
+        case STATE_WRITE:
+          rv = DoWrite();
+          break;
+        case STATE_WRITE_COMPLETE:
+          rv = DoWriteComplete(rv);
+          break;
+        case STATE_NONE:
+          NOTREACHED();
+          break;
+      }
+    } while (rv != net::ERR_IO_PENDING && next_state_ != STATE_NONE);
+    return rv;
+  }
+
+  int DoOpen() {
+    next_state_ = STATE_OPEN_COMPLETE;
+    return replayer_->backend_->OpenEntry(record_.key, &entry_, GetCallback());
+  }
+
+  int DoOpenComplete(int result) {
+    if (result == net::OK) {
+      // The get is recorded once its data is read.
+      hit_ = true;
+      read_buffer_ = new net::IOBuffer(kIOSize);
+      next_state_ = STATE_READ;
+      return net::OK;
+    }
+
+    entry_ = nullptr;
+    replayer_->RecordGet(record_, false, 0);
+    if (!replayer_->fill_on_miss_)
+      return Finish(true);
+
+    // The miss is followed by the put of the response, timed on its own.
+    replayer_->RecordOperation(type_, base::TimeTicks::Now() - start_time_,
+                               true);
+    type_ = OPERATION_PUT;
+    start_time_ = base::TimeTicks::Now();
+    next_state_ = STATE_CREATE;
+    return net::OK;
+  }
+
+  int DoRead() {
+    if (stream_ == kStreamCount)
+      return Finish(true);
+    next_state_ = STATE_READ_COMPLETE;
+    return entry_->ReadData(stream_, offset_, read_buffer_.get(), kIOSize,
+                            GetCallback());
+  }
+
+  int DoReadComplete(int result) {
+    if (result < 0)
+      return Finish(false);
+    if (result == 0) {
+      stream_++;
+      offset_ = 0;
+    } else {
+      offset_ += result;
+      bytes_read_ += result;
+    }
+    next_state_ = STATE_READ;
+    return net::OK;
+  }
+
+  int DoCreate() {
+    next_state_ = STATE_CREATE_COMPLETE;
+    return replayer_->backend_->CreateEntry(record_.key, &entry_,
+                                            GetCallback());
+  }
+
+  int DoCreateComplete(int result) {
+    if (result == net::OK) {
+      next_state_ = STATE_WRITE;
+      return net::OK;
+    }
+    entry_ = nullptr;
+    if (recreated_)
+      return Finish(false);
+
+    // The entry exists already: it is replaced.
+    recreated_ = true;
+    next_state_ = STATE_DOOM;
+    return net::OK;
+  }
+
+  int DoDoom() {
+    next_state_ = STATE_DOOM_COMPLETE;
+    return replayer_->backend_->DoomEntry(record_.key, GetCallback());
+  }
+
+  int DoDoomComplete(int result) {
+    if (type_ == OPERATION_PUT) {
+      next_state_ = STATE_CREATE;
+      return net::OK;
+    }
+    // Dooming an entry that is not in the cache is not an error of the cache.
+    return Finish(true);
+  }
+
+  int DoWrite() {
+    while (stream_ < kStreamCount &&
+           offset_ >= record_.stream_sizes[stream_]) {
+      stream_++;
+      offset_ = 0;
+    }
+    if (stream_ == kStreamCount)
+      return Finish(true);
+    write_len_ = std::min(kIOSize, record_.stream_sizes[stream_] - offset_);
+    next_state_ = STATE_WRITE_COMPLETE;
+    return entry_->WriteData(stream_, offset_,
+                             replayer_->write_buffer_.get(), write_len_,
+                             GetCallback(), false);
+  }
+
+  int DoWriteComplete(int result) {
+    if (result != write_len_)
+      return Finish(false);
+    offset_ += result;
+    next_state_ = STATE_WRITE;
+    return net::OK;
+  }
+
+  int Finish(bool succeeded) {
+    if (entry_) {
+      entry_->Close();
+      entry_ = nullptr;
+    }
+    if (hit_)
+      replayer_->RecordGet(record_, true, bytes_read_);
+    replayer_->RecordOperation(type_, base::TimeTicks::Now() - start_time_,
+                               succeeded);
+    return net::OK;
+  }
+
+  TraceReplayer* const replayer_;
+  const TraceRecord& record_;
+  OperationType type_;
+  State next_state_;
+  base::TimeTicks start_time_;
+
+  Entry* entry_;
+  int stream_;
+  int offset_;
+  int write_len_;
+  scoped_refptr<net::IOBuffer> read_buffer_;
+
+  // Whether a get found its entry, and how much of it it read.
+  bool hit_;
+  int64_t bytes_read_;
+
+  // Whether the entry was doomed to be created again.
+  bool recreated_;
+
+  DISALLOW_COPY_AND_ASSIGN(Operation);
+};
+
+TraceReplayer::TraceReplayer(Backend* backend,
+                             const std::vector<TraceRecord>* records,
+                             int concurrency,
+                             double speed,
+                             bool fill_on_miss)
+    : backend_(backend),
+      records_(records),
+      concurrency_(concurrency),
+      speed_(speed),
+      fill_on_miss_(fill_on_miss),
+      write_buffer_(new net::IOBuffer(kIOSize)),
+      next_record_(0),
+      completed_operations_(0),
+      errors_(),
+      gets_(0),
+      hits_(0),
+      requested_bytes_(0),
+      hit_bytes_(0),
+      process_metrics_(base::ProcessMetrics::CreateCurrentProcessMetrics()),
+      max_working_set_size_(0) {
+  DCHECK_GT(concurrency_, 0);
+  memset(write_buffer_->data(), 'x', kIOSize);
+}
+
+TraceReplayer::~TraceReplayer() {
+  DCHECK(operations_.empty());
+}
+
+void TraceReplayer::Run() {
+  start_time_ = base::TimeTicks::Now();
+  run_loop_.reset(new base::RunLoop());
+  IssueOperations();
+  run_loop_->Run();
+  end_time_ = base::TimeTicks::Now();
+  SampleMemory();
+}
+
+void TraceReplayer::IssueOperations() {
+  while (operations_.size() < static_cast<size_t>(concurrency_)) {
+    // The records that waited for their key come first, as they are earlier
+    // in the trace than the next record.
+    if (!ready_records_.empty()) {
+      const TraceRecord* record = ready_records_.front();
+      ready_records_.pop_front();
+      StartOperation(*record);
+      continue;
+    }
+    if (next_record_ == records_->size())
+      break;
+
+    const TraceRecord& record = (*records_)[next_record_];
+    if (speed_ > 0) {
+      const base::TimeDelta offset =
+          base::TimeDelta::FromMicroseconds(static_cast<int64_t>(
+              (record.timestamp_us - records_->front().timestamp_us) /
+              speed_));
+      const base::TimeDelta delay =
+          start_time_ + offset - base::TimeTicks::Now();
+      if (delay > base::TimeDelta()) {
+        if (!timer_.IsRunning()) {
+          timer_.Start(FROM_HERE, delay,
+                       base::Bind(&TraceReplayer::IssueOperations,
+                                  base::Unretained(this)));
+        }
+        break;
+      }
+    }
+
+    next_record_++;
+    // The operations of a key are issued in order, one at a time.
+    auto busy_key = busy_keys_.find(record.key);
+    if (busy_key != busy_keys_.end()) {
+      busy_key->second.push_back(&record);
+      continue;
+    }
+    // Marks the key busy, with no record waiting yet.
+    busy_keys_[record.key];
+    StartOperation(record);
+  }
+
+  // Run() returns right away if this happens before it waits. A key with
+  // records waiting has an operation in flight, or a record ready.
+  if (next_record_ == records_->size() && operations_.empty() &&
+      ready_records_.empty()) {
+    DCHECK(busy_keys_.empty());
+    run_loop_->Quit();
+  }
+}
+
+void TraceReplayer::StartOperation(const TraceRecord& record) {
+  std::unique_ptr<Operation> operation(new Operation(this, record));
+  Operation* raw_operation = operation.get();
+  operations_[raw_operation] = std::move(operation);
+  if (raw_operation->Start())
+    FinishOperation(raw_operation);
+}
+
+void TraceReplayer::OnOperationDone(Operation* operation) {
+  FinishOperation(operation);
+  IssueOperations();
+}
+
+void TraceReplayer::FinishOperation(Operation* operation) {
+  auto busy_key = busy_keys_.find(operation->key());
+  DCHECK(busy_key != busy_keys_.end());
+  if (busy_key->second.empty()) {
+    busy_keys_.erase(busy_key);
+  } else {
+    // The key stays busy until its next record is issued and done.
+    ready_records_.push_back(busy_key->second.front());
+    busy_key->second.pop_front();
+  }
+  operations_.erase(operation);
+  if (++completed_operations_ % kMemorySampleInterval == 0)
+    SampleMemory();
+}
+
+void TraceReplayer::RecordOperation(OperationType type,
+                                    base::TimeDelta latency,
+                                    bool succeeded) {
+  latencies_us_[type].push_back(latency.InMicroseconds());
+  if (!succeeded)
+    errors_[type]++;
+}
+
+void TraceReplayer::RecordGet(const TraceRecord& record,
+                              bool hit,
+                              int64_t bytes_read) {
+  gets_++;
+  requested_bytes_ += record.GetTotalSize();
+  if (hit) {
+    hits_++;
+    // An entry bigger than the response asked for counts for no more than it.
+    hit_bytes_ += std::min(bytes_read, record.GetTotalSize());
+  }
+}
+
+void TraceReplayer::SampleMemory() {
+  max_working_set_size_ =
+      std::max(max_working_set_size_, process_metrics_->GetWorkingSetSize());
+}
+
+void TraceReplayer::PrintReport(std::ostream* stream) {
+  const double seconds = (end_time_ - start_time_).InSecondsF();
+  *stream << "Operations: " << completed_operations_ << " in " << seconds
+          << " s, " << (seconds > 0 ? completed_operations_ / seconds : 0)
+          << " IOPS" << std::endl;
+  *stream << "Hit ratio: " << (gets_ ? 100.0 * hits_ / gets_ : 0) << "% ("
+          << hits_ << " of " << gets_ << " gets)" << std::endl;
+  *stream << "Byte hit ratio: "
+          << (requested_bytes_ ? 100.0 * hit_bytes_ / requested_bytes_ : 0)
+          << "%" << std::endl;
+  for (int type = 0; type < OPERATION_MAX; ++type) {
+    std::vector<int64_t>* latencies = &latencies_us_[type];
+    if (latencies->empty())
+      continue;
+    *stream << kOperationNames[type] << ": " << latencies->size()
+            << " operations, " << errors_[type] << " errors, p50 "
+            << GetPercentile(latencies, 50) << " us, p99 "
+            << GetPercentile(latencies, 99) << " us" << std::endl;
+  }
+  *stream << "RSS: " << process_metrics_->GetWorkingSetSize() / 1024
+          << " kB, max sampled " << max_working_set_size_ / 1024 << " kB"
+          << std::endl;
+}
+
+void SetResultOnCompletion(base::RunLoop* run_loop, int* result, int rv) {
+  *result = rv;
+  run_loop->Quit();
+}
+
+std::unique_ptr<Backend> CreateBackend(
+    net::CacheType cache_type,
+    net::BackendType backend_type,
+    const base::FilePath& path,
+    int max_size,
+    const scoped_refptr<base::SingleThreadTaskRunner>& cache_thread) {
+  std::unique_ptr<Backend> backend;
+  base::RunLoop run_loop;
+  int result = net::ERR_IO_PENDING;
+  const net::CompletionCallback callback =
+      base::Bind(&SetResultOnCompletion, base::Unretained(&run_loop),
+                 base::Unretained(&result));
+  int rv = CreateCacheBackend(cache_type, backend_type, path, max_size, false,
+                              cache_thread, nullptr, &backend, callback);
+  if (rv == net::ERR_IO_PENDING)
+    run_loop.Run();
+  else
+    result = rv;
+  if (result != net::OK) {
+    LOG(ERROR) << "Could not create the cache in " << path.LossyDisplayName();
+    return nullptr;
+  }
+  return backend;
+}
+
+void PrintUsage(std::ostream* stream) {
+  *stream << "Usage: disk_cache_trace_replay --trace=<path> "
+          << "[--backend=blockfile|simple|memory] [--cache-path=<path>] "
+          << "[--max-size=<bytes>] [--concurrency=<operations>] "
+          << "[--speed=<factor>] [--fill-on-miss]" << std::endl
+          << "  --cache-path defaults to a temporary directory." << std::endl
+          << "  --speed replays the trace at its own pace, accelerated by "
+          << "<factor>; by default the operations are issued as fast as "
+          << "possible." << std::endl
+          << "  --fill-on-miss puts the entry of a get that misses."
+          << std::endl;
+}
+
+bool Main(int argc, char** argv) {
+  base::AtExitManager at_exit_manager;
+  base::MessageLoopForIO message_loop;
+  base::CommandLine::Init(argc, argv);
+  const base::CommandLine& command_line =
+      *base::CommandLine::ForCurrentProcess();
+  if (command_line.HasSwitch("help")) {
+    PrintUsage(&std::cout);
+    return true;
+  }
+  if (!command_line.HasSwitch(kTraceSwitch)) {
+    PrintUsage(&std::cerr);
+    return false;
+  }
+
+  net::CacheType cache_type = net::DISK_CACHE;
+  net::BackendType backend_type = net::CACHE_BACKEND_BLOCKFILE;
+  const std::string backend = command_line.GetSwitchValueASCII(kBackendSwitch);
+  if (backend == "simple") {
+    backend_type = net::CACHE_BACKEND_SIMPLE;
+  } else if (backend == "memory") {
+    cache_type = net::MEMORY_CACHE;
+  } else if (!backend.empty() && backend != "blockfile") {
+    PrintUsage(&std::cerr);
+    return false;
+  }
+
+  int max_size = 0;
+  int concurrency = 1;
+  double speed = 0;
+  if ((command_line.HasSwitch(kMaxSizeSwitch) &&
+       !base::StringToInt(command_line.GetSwitchValueASCII(kMaxSizeSwitch),
+                          &max_size)) ||
+      (command_line.HasSwitch(kConcurrencySwitch) &&
+       !base::StringToInt(command_line.GetSwitchValueASCII(kConcurrencySwitch),
+                          &concurrency)) ||
+      (command_line.HasSwitch(kSpeedSwitch) &&
+       !base::StringToDouble(command_line.GetSwitchValueASCII(kSpeedSwitch),
+                             &speed)) ||
+      max_size < 0 || concurrency < 1 || speed < 0) {
+    PrintUsage(&std::cerr);
+    return false;
+  }
+
+  std::vector<TraceRecord> records;
+  if (!ReadTrace(command_line.GetSwitchValuePath(kTraceSwitch), &records))
+    return false;
+  std::cout << "Replaying " << records.size() << " operations" << std::endl;
+
+  base::ScopedTempDir temp_dir;
+  base::FilePath cache_path = command_line.GetSwitchValuePath(kCachePathSwitch);
+  if (cache_path.empty() && cache_type != net::MEMORY_CACHE) {
+    if (!temp_dir.CreateUniqueTempDir())
+      return false;
+    cache_path = temp_dir.path();
+  }
+
+  base::Thread cache_thread("CacheThread");
+  if (!cache_thread.StartWithOptions(
+          base::Thread::Options(base::MessageLoop::TYPE_IO, 0))) {
+    return false;
+  }
+  std::unique_ptr<Backend> cache =
+      CreateBackend(cache_type, backend_type, cache_path, max_size,
+                    cache_thread.task_runner());
+  if (!cache)
+    return false;
+
+  {
+    TraceReplayer replayer(cache.get(), &records, concurrency, speed,
+                           command_line.HasSwitch(kFillOnMissSwitch));
+    replayer.Run();
+    replayer.PrintReport(&std::cout);
+  }
+
+  cache.reset();
+  base::RunLoop().RunUntilIdle();
+  return true;
+}
+
+}  // namespace
+}  // namespace disk_cache
+
+int main(int argc, char** argv) {
+  return !disk_cache::Main(argc, argv);
+}
@@ -0,0 +1,246 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// A flat hash map keyed by connection ID, for the per-connection tables of a
+// server.
+
+#ifndef NET_TOOLS_QUIC_QUIC_CONNECTION_ID_MAP_H_
+#define NET_TOOLS_QUIC_QUIC_CONNECTION_ID_MAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <utility>
+#include <vector>
+
+#include "base/logging.h"
+#include "base/macros.h"
+#include "net/quic/crypto/quic_random.h"
+#include "net/quic/quic_protocol.h"
+
+namespace net {
+
+// An open-addressing hash map from QuicConnectionId to |Value|. Entries are
+// stored inline in one array and probed linearly, so a lookup usually touches
+// a single cache line, and erased entries are filled by shifting later ones
+// back rather than by leaving tombstones. The hash is seeded per map, since
+// clients choose the connection IDs of new connections.
+//
+// Unlike std::unordered_map, insert() and erase() invalidate all iterators and
+// references, and the key of an entry must not be changed through an
+// iterator. |Value| must be default-constructible and movable.
+template <typename Value>
+class QuicConnectionIdMap {
+ private:
+  struct Slot {
+    Slot() : occupied(false) {}
+
+    std::pair<QuicConnectionId, Value> entry;
+    bool occupied;
+  };
+
+  template <typename SlotType, typename EntryType>
+  class Iterator {
+   public:
+    Iterator() : slot_(nullptr), end_(nullptr) {}
+    Iterator(SlotType* slot, SlotType* end) : slot_(slot), end_(end) {
+      SkipEmptySlots();
+    }
+    // Allows conversion from iterator to const_iterator.
+    template <typename OtherSlotType, typename OtherEntryType>
+    Iterator(const Iterator<OtherSlotType, OtherEntryType>& other)
+        : slot_(other.slot_), end_(other.end_) {}
+
+    EntryType& operator*() const { return slot_->entry; }
+    EntryType* operator->() const { return &slot_->entry; }
+
+    Iterator& operator++() {
+      ++slot_;
+      SkipEmptySlots();
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator old = *this;
+      ++*this;
+      return old;
+    }
+
+    bool operator==(const Iterator& other) const {
+      return slot_ == other.slot_;
+    }
+    bool operator!=(const Iterator& other) const {
+      return slot_ != other.slot_;
+    }
+
+   private:
+    friend class QuicConnectionIdMap;
+    template <typename, typename>
+    friend class Iterator;
+
+    void SkipEmptySlots() {
+      while (slot_ != end_ && !slot_->occupied)
+        ++slot_;
+    }
+
+    SlotType* slot_;
+    SlotType* end_;
+  };
+
+ public:
+  typedef std::pair<QuicConnectionId, Value> value_type;
+  typedef Iterator<Slot, value_type> iterator;
+  typedef Iterator<const Slot, const value_type> const_iterator;
+
+  QuicConnectionIdMap()
+      : slots_(kMinCapacity),
+        size_(0),
+        shift_(64 - kMinCapacityLog2),
+        seed_(QuicRandom::GetInstance()->RandUint64()) {}
+
+  size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  // The number of entries the map can hold without growing, and the bytes it
+  // uses for them.
+  size_t capacity() const { return slots_.size() * kMaxLoadNumerator / 4; }
+  size_t memory_usage() const { return slots_.size() * sizeof(Slot); }
+
+  iterator begin() { return iterator(slots_.data(), SlotsEnd()); }
+  iterator end() { return iterator(SlotsEnd(), SlotsEnd()); }
+  const_iterator begin() const {
+    return const_iterator(slots_.data(), SlotsEnd());
+  }
+  const_iterator end() const { return const_iterator(SlotsEnd(), SlotsEnd()); }
+
+  iterator find(QuicConnectionId connection_id) {
+    size_t index = FindSlot(connection_id);
+    if (!slots_[index].occupied)
+      return end();
+    return iterator(&slots_[index], SlotsEnd());
+  }
+
+  const_iterator find(QuicConnectionId connection_id) const {
+    size_t index = FindSlot(connection_id);
+    if (!slots_[index].occupied)
+      return end();
+    return const_iterator(&slots_[index], SlotsEnd());
+  }
+
+  // Inserts |value| unless its key is already present. Returns the entry with
+  // the key, and whether it was inserted.
+  std::pair<iterator, bool> insert(value_type value) {
+    size_t index = FindSlot(value.first);
+    if (slots_[index].occupied)
+      return std::make_pair(iterator(&slots_[index], SlotsEnd()), false);
+    if (size_ + 1 > capacity()) {
+      Grow();
+      index = FindSlot(value.first);
+    }
+    slots_[index].entry = std::move(value);
+    slots_[index].occupied = true;
+    ++size_;
+    return std::make_pair(iterator(&slots_[index], SlotsEnd()), true);
+  }
+
+  void erase(iterator it) {
+    DCHECK(it.slot_ != SlotsEnd() && it.slot_->occupied);
+    EraseSlot(it.slot_ - slots_.data());
+  }
+
+  size_t erase(QuicConnectionId connection_id) {
+    size_t index = FindSlot(connection_id);
+    if (!slots_[index].occupied)
+      return 0;
+    EraseSlot(index);
+    return 1;
+  }
+
+  // Removes all entries, and releases the memory of a grown map.
+  void clear() {
+    std::vector<Slot>(kMinCapacity).swap(slots_);
+    size_ = 0;
+    shift_ = 64 - kMinCapacityLog2;
+  }
+
+ private:
+  static const int kMinCapacityLog2 = 4;
+  static const size_t kMinCapacity = 1 << kMinCapacityLog2;
+  // The map grows once it is more than 3/4 full, which bounds the length of
+  // probe sequences and guarantees an empty slot to end them.
+  static const size_t kMaxLoadNumerator = 3;
+
+  Slot* SlotsEnd() { return slots_.data() + slots_.size(); }
+  const Slot* SlotsEnd() const { return slots_.data() + slots_.size(); }
+
+  // Fibonacci hashing of the seeded ID. The high bits of the product are the
+  // best mixed, so they select the home slot.
+  size_t HomeSlot(QuicConnectionId connection_id) const {
+    return static_cast<size_t>(((connection_id ^ seed_) *
+                                UINT64_C(0x9E3779B97F4A7C15)) >>
+                               shift_);
+  }
+
+  // Returns the slot holding |connection_id|, or the empty slot where it
+  // would be inserted.
+  size_t FindSlot(QuicConnectionId connection_id) const {
+    const size_t mask = slots_.size() - 1;
+    size_t index = HomeSlot(connection_id);
+    while (slots_[index].occupied &&
+           slots_[index].entry.first != connection_id) {
+      index = (index + 1) & mask;
+    }
+    return index;
+  }
+
+  // Empties slot |index|, and moves back each later entry of the probe
+  // sequence whose home slot is not between |index| and the entry, so that
+  // every entry stays reachable from its home slot.
+  void EraseSlot(size_t index) {
+    const size_t mask = slots_.size() - 1;
+    size_t hole = index;
+    for (size_t next = (hole + 1) & mask; slots_[next].occupied;
+         next = (next + 1) & mask) {
+      // Distances from the hole and from |next| to its home slot, going
+      // backwards. The entry may fill the hole if the hole is no further
+      // from it than its home slot.
+      size_t home = HomeSlot(slots_[next].entry.first);
+      if (((next - home) & mask) >= ((next - hole) & mask)) {
+        slots_[hole].entry = std::move(slots_[next].entry);
+        hole = next;
+      }
+    }
+    slots_[hole].entry = value_type();
+    slots_[hole].occupied = false;
+    --size_;
+  }
+
+  void Grow() {
+    std::vector<Slot> old_slots(slots_.size() * 2);
+    old_slots.swap(slots_);
+    --shift_;
+    const size_t mask = slots_.size() - 1;
+    for (Slot& slot : old_slots) {
+      if (!slot.occupied)
+        continue;
+      size_t index = HomeSlot(slot.entry.first);
+      while (slots_[index].occupied)
+        index = (index + 1) & mask;
+      slots_[index].entry = std::move(slot.entry);
+      slots_[index].occupied = true;
+    }
+  }
+
+  // Always a power of two.
+  std::vector<Slot> slots_;
+  size_t size_;
+  // 64 - log2(slots_.size()).
+  int shift_;
+  const uint64_t seed_;
+
+  DISALLOW_COPY_AND_ASSIGN(QuicConnectionIdMap);
+};
+
+}  // namespace net
+
+#endif  // NET_TOOLS_QUIC_QUIC_CONNECTION_ID_MAP_H_
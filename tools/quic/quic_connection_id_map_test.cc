@@ -0,0 +1,102 @@
+// Copyright 2016 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/tools/quic/quic_connection_id_map.h"
+
+#include <stdint.h>
+
+#include <map>
+
+#include "net/quic/test_tools/quic_test_utils.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+namespace test {
+namespace {
+
+TEST(QuicConnectionIdMapTest, InsertFindErase) {
+  QuicConnectionIdMap<int> map;
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.find(1) == map.end());
+
+  EXPECT_TRUE(map.insert(std::make_pair(1, 10)).second);
+  EXPECT_TRUE(map.insert(std::make_pair(0, 20)).second);
+  std::pair<QuicConnectionIdMap<int>::iterator, bool> result =
+      map.insert(std::make_pair(1, 30));
+  EXPECT_FALSE(result.second);
+  EXPECT_EQ(10, result.first->second);
+  EXPECT_EQ(2u, map.size());
+
+  QuicConnectionIdMap<int>::iterator it = map.find(0);
+  ASSERT_TRUE(it != map.end());
+  EXPECT_EQ(0u, it->first);
+  EXPECT_EQ(20, it->second);
+  it->second = 21;
+  EXPECT_EQ(21, map.find(0)->second);
+
+  map.erase(it);
+  EXPECT_TRUE(map.find(0) == map.end());
+  EXPECT_EQ(1u, map.erase(1));
+  EXPECT_EQ(0u, map.erase(1));
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.begin() == map.end());
+}
+
+// Checks the map against std::map through enough random inserts and erases to
+// grow it several times and to exercise erasing from long probe sequences.
+TEST(QuicConnectionIdMapTest, MatchesStdMap) {
+  QuicConnectionIdMap<uint64_t> map;
+  std::map<QuicConnectionId, uint64_t> expected;
+  SimpleRandom random;
+  for (int i = 0; i < 20000; ++i) {
+    // A small key space, so that erases and repeated inserts hit.
+    QuicConnectionId connection_id = random.RandUint64() % 4096;
+    if (random.RandUint64() % 3 == 0) {
+      EXPECT_EQ(expected.erase(connection_id), map.erase(connection_id));
+    } else {
+      EXPECT_EQ(expected.insert(std::make_pair(connection_id, i)).second,
+                map.insert(std::make_pair(connection_id, i)).second);
+    }
+    ASSERT_EQ(expected.size(), map.size());
+  }
+  EXPECT_LE(map.size(), map.capacity());
+
+  for (const auto& entry : expected) {
+    QuicConnectionIdMap<uint64_t>::const_iterator it = map.find(entry.first);
+    ASSERT_TRUE(it != map.end());
+    EXPECT_EQ(entry.second, it->second);
+  }
+  std::map<QuicConnectionId, uint64_t> iterated;
+  for (const auto& entry : map)
+    iterated.insert(entry);
+  EXPECT_EQ(expected, iterated);
+
+  map.clear();
+  EXPECT_TRUE(map.empty());
+  EXPECT_TRUE(map.find(expected.begin()->first) == map.end());
+}
+
+// Sequential connection IDs, as a client might pick, are spread out.
+TEST(QuicConnectionIdMapTest, SequentialIds) {
+  QuicConnectionIdMap<QuicConnectionId> map;
+  const QuicConnectionId kNumIds = 100000;
+  for (QuicConnectionId connection_id = 0; connection_id < kNumIds;
+       ++connection_id) {
+    map.insert(std::make_pair(connection_id << 32, connection_id));
+  }
+  for (QuicConnectionId connection_id = 0; connection_id < kNumIds;
+       connection_id += 2) {
+    EXPECT_EQ(1u, map.erase(connection_id << 32));
+  }
+  EXPECT_EQ(kNumIds / 2, map.size());
+  for (QuicConnectionId connection_id = 1; connection_id < kNumIds;
+       connection_id += 2) {
+    ASSERT_TRUE(map.find(connection_id << 32) != map.end());
+    EXPECT_EQ(connection_id, map.find(connection_id << 32)->second);
+  }
+}
+
+}  // namespace
+}  // namespace test
+}  // namespace net
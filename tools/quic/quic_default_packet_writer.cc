@@ -4,12 +4,15 @@
 
 #include "net/tools/quic/quic_default_packet_writer.h"
 
+#include "net/quic/quic_flags.h"
 #include "net/tools/quic/quic_socket_utils.h"
 
 namespace net {
 
 QuicDefaultPacketWriter::QuicDefaultPacketWriter(int fd)
-    : fd_(fd), write_blocked_(false) {}
+    : fd_(fd), write_blocked_(false), supports_release_time_(false) {
+  set_fd(fd);
+}
 
 QuicDefaultPacketWriter::~QuicDefaultPacketWriter() {}
 
@@ -19,10 +22,13 @@ WriteResult QuicDefaultPacketWriter::WritePacket(const char* buffer,
                                                  const IPEndPoint& peer_address,
                                                  PerPacketOptions* options) {
   DCHECK(!IsWriteBlocked());
-  DCHECK(nullptr == options)
-      << "QuicDefaultPacketWriter does not accept any options.";
-  WriteResult result = QuicSocketUtils::WritePacket(fd_, buffer, buf_len,
-                                                    self_address, peer_address);
+  // Only the release time of |options| is used.
+  QuicTime::Delta release_time_delay = QuicTime::Delta::Zero();
+  if (options != nullptr && supports_release_time_) {
+    release_time_delay = options->release_time_delay();
+  }
+  WriteResult result = QuicSocketUtils::WritePacket(
+      fd_, buffer, buf_len, self_address, peer_address, release_time_delay);
   if (result.status == WRITE_STATUS_BLOCKED) {
     write_blocked_ = true;
   }
@@ -46,4 +52,14 @@ QuicByteCount QuicDefaultPacketWriter::GetMaxPacketSize(
   return kMaxPacketSize;
 }
 
+bool QuicDefaultPacketWriter::SupportsReleaseTime() const {
+  return supports_release_time_;
+}
+
+void QuicDefaultPacketWriter::set_fd(int fd) {
+  fd_ = fd;
+  supports_release_time_ = FLAGS_quic_pacing_offload && fd >= 0 &&
+                           QuicSocketUtils::IsTransmitTimeSet(fd);
+}
+
 }  // namespace net
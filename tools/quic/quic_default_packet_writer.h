@@ -32,8 +32,10 @@ class QuicDefaultPacketWriter : public QuicPacketWriter {
   bool IsWriteBlocked() const override;
   void SetWritable() override;
   QuicByteCount GetMaxPacketSize(const IPEndPoint& peer_address) const override;
+  // True if FLAGS_quic_pacing_offload is set and the socket has SO_TXTIME.
+  bool SupportsReleaseTime() const override;
 
-  void set_fd(int fd) { fd_ = fd; }
+  void set_fd(int fd);
 
  protected:
   void set_write_blocked(bool is_blocked) { write_blocked_ = is_blocked; }
@@ -42,6 +44,7 @@ class QuicDefaultPacketWriter : public QuicPacketWriter {
  private:
   int fd_;
   bool write_blocked_;
+  bool supports_release_time_;
 
   DISALLOW_COPY_AND_ASSIGN(QuicDefaultPacketWriter);
 };
@@ -413,6 +413,10 @@ void QuicDispatcher::CleanUpSession(SessionMap::iterator it,
 
 void QuicDispatcher::DeleteSessions() {
   STLDeleteElements(&closed_session_list_);
+  // With no connections left, nothing will reuse the buffers the closed ones
+  // freed.
+  if (session_map_.empty())
+    helper()->GetBufferAllocator()->MarkAllocatorIdle();
 }
 
 void QuicDispatcher::OnCanWrite() {
@@ -434,14 +438,21 @@ bool QuicDispatcher::HasPendingWrites() const {
 }
 
 void QuicDispatcher::Shutdown() {
-  while (!session_map_.empty()) {
-    QuicServerSessionBase* session = session_map_.begin()->second;
+  // Closing a session erases it from the session map, which invalidates
+  // iterators, so collect the sessions first.
+  std::vector<QuicServerSessionBase*> sessions;
+  sessions.reserve(session_map_.size());
+  for (const auto& entry : session_map_) {
+    sessions.push_back(entry.second);
+  }
+  for (QuicServerSessionBase* session : sessions) {
     session->connection()->CloseConnection(
         QUIC_PEER_GOING_AWAY, "Server shutdown imminent",
         ConnectionCloseBehavior::SEND_CONNECTION_CLOSE_PACKET);
-    // Validate that the session removes itself from the session map on close.
-    DCHECK(session_map_.empty() || session_map_.begin()->second != session);
   }
+  // Validate that the sessions removed themselves from the session map on
+  // close.
+  DCHECK(session_map_.empty());
   DeleteSessions();
 }
 
@@ -9,7 +9,6 @@
 #define NET_TOOLS_QUIC_QUIC_DISPATCHER_H_
 
 #include <memory>
-#include <unordered_map>
 #include <vector>
 
 #include "base/macros.h"
@@ -21,6 +20,7 @@
 #include "net/quic/quic_connection.h"
 #include "net/quic/quic_protocol.h"
 #include "net/quic/quic_server_session_base.h"
+#include "net/tools/quic/quic_connection_id_map.h"
 #include "net/tools/quic/quic_process_packet_interface.h"
 #include "net/tools/quic/quic_time_wait_list_manager.h"
 
@@ -85,8 +85,9 @@ class QuicDispatcher : public QuicServerSessionBase::Visitor,
   // time-wait list.
   void OnConnectionAddedToTimeWaitList(QuicConnectionId connection_id) override;
 
-  typedef std::unordered_map<QuicConnectionId, QuicServerSessionBase*>
-      SessionMap;
+  // Looked up for every packet, so kept flat. Note that inserting or erasing a
+  // session invalidates all iterators.
+  typedef QuicConnectionIdMap<QuicServerSessionBase*> SessionMap;
 
   const SessionMap& session_map() const { return session_map_; }
 
@@ -11,6 +11,7 @@
 #include "base/stl_util.h"
 #include "net/base/ip_endpoint.h"
 #include "net/quic/crypto/quic_random.h"
+#include "net/quic/quic_flags.h"
 #include "net/tools/epoll_server/epoll_server.h"
 #include "net/tools/quic/quic_socket_utils.h"
 
@@ -20,6 +21,8 @@ QuicEpollConnectionHelper::QuicEpollConnectionHelper(EpollServer* epoll_server,
                                                      QuicAllocator type)
     : clock_(epoll_server),
       random_generator_(QuicRandom::GetInstance()),
+      buffer_allocator_(FLAGS_quic_buffer_pool_max_bytes,
+                        FLAGS_quic_buffer_pool_max_pooled_bytes),
       allocator_type_(type) {}
 
 QuicEpollConnectionHelper::~QuicEpollConnectionHelper() {}
@@ -12,6 +12,7 @@
 #include <set>
 
 #include "base/macros.h"
+#include "net/quic/quic_buffer_pool.h"
 #include "net/quic/quic_connection.h"
 #include "net/quic/quic_packet_writer.h"
 #include "net/quic/quic_protocol.h"
@@ -25,8 +26,6 @@ namespace net {
 class EpollServer;
 class QuicRandom;
 
-using QuicStreamBufferAllocator = SimpleBufferAllocator;
-
 enum class QuicAllocator { SIMPLE, BUFFER_POOL };
 
 class QuicEpollConnectionHelper : public QuicConnectionHelperInterface {
@@ -46,7 +45,7 @@ class QuicEpollConnectionHelper : public QuicConnectionHelperInterface {
   const QuicEpollClock clock_;
   QuicRandom* random_generator_;
   // Set up both allocators.  They take up minimal memory before use.
-  QuicStreamBufferAllocator buffer_allocator_;
+  QuicBufferPool buffer_allocator_;
   SimpleBufferAllocator simple_buffer_allocator_;
   QuicAllocator allocator_type_;
 
@@ -12,6 +12,8 @@
 #include <string.h>
 #include <sys/epoll.h>
 
+#include <algorithm>
+
 #include "base/logging.h"
 #include "net/base/ip_address.h"
 #include "net/base/ip_endpoint.h"
@@ -67,12 +69,14 @@ bool QuicPacketReader::ReadAndDispatchPackets(
     ProcessPacketInterface* processor,
     QuicPacketCount* packets_dropped) {
 #if MMSG_MORE
-  return ReadAndDispatchManyPackets(fd, port, clock, processor,
-                                    packets_dropped);
-#else
+  // recvmmsg reads into buffers too small for coalesced packets.
+  if (!FLAGS_quic_receive_gro) {
+    return ReadAndDispatchManyPackets(fd, port, clock, processor,
+                                      packets_dropped);
+  }
+#endif
   return ReadAndDispatchSinglePacket(fd, port, clock, processor,
                                      packets_dropped);
-#endif
 }
 
 bool QuicPacketReader::ReadAndDispatchManyPackets(
@@ -162,7 +166,6 @@ bool QuicPacketReader::ReadAndDispatchManyPackets(
 #endif
 }
 
-/* static */
 bool QuicPacketReader::ReadAndDispatchSinglePacket(
     int fd,
     int port,
@@ -170,15 +173,28 @@ bool QuicPacketReader::ReadAndDispatchSinglePacket(
     ProcessPacketInterface* processor,
     QuicPacketCount* packets_dropped) {
   bool latched_walltimestamps = FLAGS_quic_socket_walltimestamps;
-  char buf[kMaxPacketSize];
+  char stack_buf[kMaxPacketSize];
+  char* buf = stack_buf;
+  size_t buf_len = arraysize(stack_buf);
+  // With UDP_GRO, one read may hold many packets from the same peer.
+  bool receive_gro = FLAGS_quic_receive_gro;
+  size_t gro_segment_size = 0;
+  if (receive_gro) {
+    if (gro_buf_ == nullptr) {
+      gro_buf_.reset(new char[QuicSocketUtils::kMaxGroPacketSize]);
+    }
+    buf = gro_buf_.get();
+    buf_len = QuicSocketUtils::kMaxGroPacketSize;
+  }
 
   IPEndPoint client_address;
   IPAddress server_ip;
   QuicTime timestamp = QuicTime::Zero();
   QuicWallTime walltimestamp = QuicWallTime::Zero();
   int bytes_read = QuicSocketUtils::ReadPacket(
-      fd, buf, arraysize(buf), packets_dropped, &server_ip, &timestamp,
-      &walltimestamp, latched_walltimestamps, &client_address);
+      fd, buf, buf_len, packets_dropped, &server_ip, &timestamp,
+      &walltimestamp, latched_walltimestamps,
+      receive_gro ? &gro_segment_size : nullptr, &client_address);
 
   if (bytes_read < 0) {
     return false;  // ReadPacket failed.
@@ -201,9 +217,16 @@ bool QuicPacketReader::ReadAndDispatchSinglePacket(
     }
   }
 
-  QuicReceivedPacket packet(buf, bytes_read, timestamp, false);
   IPEndPoint server_address(server_ip, port);
-  processor->ProcessPacket(server_address, client_address, packet);
+  // Split coalesced packets without copying them.
+  size_t packet_size = gro_segment_size > 0 ? gro_segment_size : bytes_read;
+  for (size_t offset = 0; offset < static_cast<size_t>(bytes_read);
+       offset += packet_size) {
+    QuicReceivedPacket packet(buf + offset,
+                              std::min(packet_size, bytes_read - offset),
+                              timestamp, false);
+    processor->ProcessPacket(server_address, client_address, packet);
+  }
 
   // The socket read was successful, so return true even if packet dispatch
   // failed.
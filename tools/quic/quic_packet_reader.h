@@ -10,6 +10,8 @@
 #include <netinet/in.h>
 #include <sys/socket.h>
 
+#include <memory>
+
 #include "base/macros.h"
 #include "net/quic/quic_clock.h"
 #include "net/quic/quic_protocol.h"
@@ -61,12 +63,17 @@ class QuicPacketReader {
                                   ProcessPacketInterface* processor,
                                   QuicPacketCount* packets_dropped);
 
-  // Reads and dispatches a single packet using recvmsg.
-  static bool ReadAndDispatchSinglePacket(int fd,
-                                          int port,
-                                          const QuicClock& clock,
-                                          ProcessPacketInterface* processor,
-                                          QuicPacketCount* packets_dropped);
+  // Reads and dispatches a single packet using recvmsg, or all the packets
+  // that UDP_GRO coalesced into the read if FLAGS_quic_receive_gro is true.
+  bool ReadAndDispatchSinglePacket(int fd,
+                                   int port,
+                                   const QuicClock& clock,
+                                   ProcessPacketInterface* processor,
+                                   QuicPacketCount* packets_dropped);
+
+  // Buffer for reads that UDP_GRO may have coalesced. Too large for the
+  // stack, so it is allocated on the first such read.
+  std::unique_ptr<char[]> gro_buf_;
 
   // Storage only used when recvmmsg is available.
 
@@ -34,6 +34,7 @@ class QuicPacketWriterWrapper : public QuicPacketWriter {
   bool IsWriteBlocked() const override;
   void SetWritable() override;
   QuicByteCount GetMaxPacketSize(const IPEndPoint& peer_address) const override;
+  bool SupportsReleaseTime() const override;
 
   // Takes ownership of |writer|.
   void set_writer(QuicPacketWriter* writer);
@@ -10,6 +10,7 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/uio.h>
+#include <time.h>
 #include <string>
 
 #include "base/logging.h"
@@ -21,8 +22,24 @@
 #define SO_RXQ_OVFL 40
 #endif
 
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+#ifndef SO_TXTIME
+#define SO_TXTIME 61
+#define SCM_TXTIME SO_TXTIME
+#endif
+
 namespace net {
 
+// static
+const size_t QuicSocketUtils::kMaxGroPacketSize;
+
 // static
 void QuicSocketUtils::GetAddressAndTimestampFromMsghdr(
     struct msghdr* hdr,
@@ -79,6 +96,19 @@ bool QuicSocketUtils::GetOverflowFromMsghdr(struct msghdr* hdr,
   return false;
 }
 
+// static
+size_t QuicSocketUtils::GetGroSegmentSizeFromMsghdr(struct msghdr* hdr) {
+  if (hdr->msg_controllen > 0) {
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(hdr); cmsg != nullptr;
+         cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+      if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+        return *(reinterpret_cast<int*> CMSG_DATA(cmsg));
+      }
+    }
+  }
+  return 0;
+}
+
 // static
 int QuicSocketUtils::SetGetAddressInfo(int fd, int address_family) {
   int get_local_ip = 1;
@@ -98,6 +128,29 @@ int QuicSocketUtils::SetGetSoftwareReceiveTimestamp(int fd) {
                     sizeof(timestamping));
 }
 
+// static
+int QuicSocketUtils::SetGenericReceiveOffload(int fd) {
+  int gro = 1;
+  return setsockopt(fd, SOL_UDP, UDP_GRO, &gro, sizeof(gro));
+}
+
+// static
+int QuicSocketUtils::SetTransmitTime(int fd) {
+  // Release times are computed from CLOCK_MONOTONIC, the clock of fq.
+  LinuxSockTxtime txtime = {CLOCK_MONOTONIC, 0};
+  return setsockopt(fd, SOL_SOCKET, SO_TXTIME, &txtime, sizeof(txtime));
+}
+
+// static
+bool QuicSocketUtils::IsTransmitTimeSet(int fd) {
+  LinuxSockTxtime txtime = {CLOCK_REALTIME, 0};
+  socklen_t len = sizeof(txtime);
+  // The kernel reports the clock even if SO_TXTIME was never set, but then it
+  // is CLOCK_REALTIME.
+  return getsockopt(fd, SOL_SOCKET, SO_TXTIME, &txtime, &len) == 0 &&
+         txtime.clockid == CLOCK_MONOTONIC;
+}
+
 // static
 bool QuicSocketUtils::SetSendBufferSize(int fd, size_t size) {
   if (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) != 0) {
@@ -125,6 +178,7 @@ int QuicSocketUtils::ReadPacket(int fd,
                                 QuicTime* timestamp,
                                 QuicWallTime* walltimestamp,
                                 bool latched_walltimestamps,
+                                size_t* gro_segment_size,
                                 IPEndPoint* peer_address) {
   DCHECK(peer_address != nullptr);
   char cbuf[kSpaceForCmsg];
@@ -184,6 +238,14 @@ int QuicSocketUtils::ReadPacket(int fd,
   GetAddressAndTimestampFromMsghdr(&hdr, self_address, timestamp, walltimestamp,
                                    latched_walltimestamps);
 
+  if (gro_segment_size != nullptr) {
+    DCHECK_GE(buf_len, kMaxGroPacketSize);
+    *gro_segment_size = GetGroSegmentSizeFromMsghdr(&hdr);
+    if (*gro_segment_size >= static_cast<size_t>(bytes_read)) {
+      *gro_segment_size = 0;
+    }
+  }
+
   if (raw_address.ss_family == AF_INET) {
     CHECK(peer_address->FromSockAddr(
         reinterpret_cast<const sockaddr*>(&raw_address),
@@ -229,7 +291,8 @@ WriteResult QuicSocketUtils::WritePacket(int fd,
                                          const char* buffer,
                                          size_t buf_len,
                                          const IPAddress& self_address,
-                                         const IPEndPoint& peer_address) {
+                                         const IPEndPoint& peer_address,
+                                         QuicTime::Delta release_time_delay) {
   sockaddr_storage raw_address;
   socklen_t address_len = sizeof(raw_address);
   CHECK(peer_address.ToSockAddr(
@@ -248,17 +311,34 @@ WriteResult QuicSocketUtils::WritePacket(int fd,
   // kSpaceForIp should be big enough to hold both IPv4 and IPv6 packet info.
   const int kSpaceForIp =
       (kSpaceForIpv4 < kSpaceForIpv6) ? kSpaceForIpv6 : kSpaceForIpv4;
-  char cbuf[kSpaceForIp];
-  if (self_address.empty()) {
+  const int kSpaceForTxtime = CMSG_SPACE(sizeof(uint64_t));
+  char cbuf[kSpaceForIp + kSpaceForTxtime];
+  // Zeroed, since CMSG_NXTHDR reads the length of the following header.
+  memset(cbuf, 0, sizeof(cbuf));
+  hdr.msg_control = cbuf;
+  hdr.msg_controllen = sizeof(cbuf);
+  cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+  size_t control_len = 0;
+  if (!self_address.empty()) {
+    control_len += CMSG_SPACE(SetIpInfoInCmsg(self_address, cmsg));
+    cmsg = CMSG_NXTHDR(&hdr, cmsg);
+  }
+  if (!release_time_delay.IsZero()) {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    uint64_t release_time_ns =
+        static_cast<uint64_t>(now.tv_sec) * 1000 * 1000 * 1000 + now.tv_nsec +
+        release_time_delay.ToMicroseconds() * 1000;
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_TXTIME;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(release_time_ns));
+    memcpy(CMSG_DATA(cmsg), &release_time_ns, sizeof(release_time_ns));
+    control_len += kSpaceForTxtime;
+  }
+  if (control_len == 0) {
     hdr.msg_control = 0;
-    hdr.msg_controllen = 0;
-  } else {
-    hdr.msg_control = cbuf;
-    hdr.msg_controllen = kSpaceForIp;
-    cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
-    SetIpInfoInCmsg(self_address, cmsg);
-    hdr.msg_controllen = cmsg->cmsg_len;
   }
+  hdr.msg_controllen = control_len;
 
   int rc;
   do {
@@ -312,6 +392,22 @@ int QuicSocketUtils::CreateUDPSocket(const IPEndPoint& address,
                  << strerror(errno);
   }
 
+  if (FLAGS_quic_receive_gro) {
+    rc = SetGenericReceiveOffload(fd);
+    if (rc < 0) {
+      LOG(WARNING) << "UDP_GRO not supported; reading packets one at a time: "
+                   << strerror(errno);
+    }
+  }
+
+  if (FLAGS_quic_pacing_offload) {
+    rc = SetTransmitTime(fd);
+    if (rc < 0) {
+      LOG(WARNING) << "SO_TXTIME not supported; pacing with alarms: "
+                   << strerror(errno);
+    }
+  }
+
   return fd;
 }
 
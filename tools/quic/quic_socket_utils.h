@@ -9,7 +9,9 @@
 
 #include <netinet/in.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <sys/socket.h>
+#include <time.h>
 
 #include <string>
 
@@ -17,6 +19,7 @@
 #include "net/base/ip_address.h"
 #include "net/base/ip_endpoint.h"
 #include "net/quic/quic_bandwidth.h"
+#include "net/quic/quic_time.h"
 #include "net/quic/quic_types.h"
 
 namespace net {
@@ -34,18 +37,29 @@ struct LinuxTimestamping {
   struct timespec hwtimeraw;
 };
 
+// This is the argument of SO_TXTIME, which also lacks a definition in the
+// headers of older systems. See
+// https://man7.org/linux/man-pages/man8/tc-etf.8.html for more information.
+struct LinuxSockTxtime {
+  clockid_t clockid;
+  uint32_t flags;
+};
+
 class QuicSocketUtils {
  public:
   // The first integer is for overflow. The in6_pktinfo is the larger of the
   // address structures present. LinuxTimestamping is present for socket
-  // timestamping.
+  // timestamping. The second integer is the UDP_GRO segment size.
   // The final int is a sentinel so the msg_controllen feedback
   // can be used to detect larger control messages than there is space for.
   static const int kSpaceForCmsg =
       CMSG_SPACE(CMSG_LEN(sizeof(int)) + CMSG_LEN(sizeof(in6_pktinfo)) +
-                 CMSG_LEN(sizeof(LinuxTimestamping)) +
+                 CMSG_LEN(sizeof(LinuxTimestamping)) + CMSG_LEN(sizeof(int)) +
                  CMSG_LEN(sizeof(int)));
 
+  // The largest read that UDP_GRO can produce from coalesced packets.
+  static const size_t kMaxGroPacketSize = 64 * 1024;
+
   // Fills in |address| if |hdr| contains IP_PKTINFO or IPV6_PKTINFO. Fills in
   // |timestamp| if |hdr| contains |SO_TIMESTAMPING|. |address| and |timestamp|
   // must not be null.
@@ -62,6 +76,10 @@ class QuicSocketUtils {
   static bool GetOverflowFromMsghdr(struct msghdr* hdr,
                                     QuicPacketCount* dropped_packets);
 
+  // Returns the size of the packets that UDP_GRO coalesced into the read
+  // described by |hdr|, or 0 if they were not coalesced.
+  static size_t GetGroSegmentSizeFromMsghdr(struct msghdr* hdr);
+
   // Sets either IP_PKTINFO or IPV6_PKTINFO on the socket, based on
   // address_family.  Returns the return code from setsockopt.
   static int SetGetAddressInfo(int fd, int address_family);
@@ -70,6 +88,19 @@ class QuicSocketUtils {
   // Returns the return code from setsockopt.
   static int SetGetSoftwareReceiveTimestamp(int fd);
 
+  // Sets UDP_GRO on the socket, so that the kernel may coalesce consecutive
+  // packets from a peer into one read of up to |kMaxGroPacketSize| bytes.
+  // Returns the return code from setsockopt.
+  static int SetGenericReceiveOffload(int fd);
+
+  // Sets SO_TXTIME on the socket, so that the release times that WritePacket
+  // attaches to packets are enforced by the qdisc (fq or etf).
+  // Returns the return code from setsockopt.
+  static int SetTransmitTime(int fd);
+
+  // Returns true if SO_TXTIME has been set on the socket by SetTransmitTime.
+  static bool IsTransmitTimeSet(int fd);
+
   // Sets the send buffer size to |size| and returns false if it fails.
   static bool SetSendBufferSize(int fd, size_t size);
 
@@ -90,6 +121,10 @@ class QuicSocketUtils {
   // received packet, assuming a packet was read and the platform supports
   // packet receipt timestamping. If the platform does not support packet
   // receipt timestamping, timestamp will not be changed.
+  //
+  // If gro_segment_size is non-null, it will be set to the size of the packets
+  // that UDP_GRO coalesced into |buffer|, or to 0 if it did not. |buf_len|
+  // must then be at least kMaxGroPacketSize, so no packet is truncated.
   // TODO(rjshade): Delete the |timestamp| argument when removing
   // FLAGS_quic_socket_timestamps_walltime
   static int ReadPacket(int fd,
@@ -100,17 +135,23 @@ class QuicSocketUtils {
                         QuicTime* timestamp,
                         QuicWallTime* walltimestamp,
                         bool latched_walltimestamps,
+                        size_t* gro_segment_size,
                         IPEndPoint* peer_address);
 
   // Writes buf_len to the socket. If writing is successful, sets the result's
   // status to WRITE_STATUS_OK and sets bytes_written.  Otherwise sets the
   // result's status to WRITE_STATUS_BLOCKED or WRITE_STATUS_ERROR and sets
   // error_code to errno.
+  //
+  // If |release_time_delay| is not zero, the packet is sent with SCM_TXTIME,
+  // so that it leaves the host that long from now. The socket must have
+  // SO_TXTIME set.
   static WriteResult WritePacket(int fd,
                                  const char* buffer,
                                  size_t buf_len,
                                  const IPAddress& self_address,
-                                 const IPEndPoint& peer_address);
+                                 const IPEndPoint& peer_address,
+                                 QuicTime::Delta release_time_delay);
 
   // A helper for WritePacket which fills in the cmsg with the supplied self
   // address.
@@ -120,6 +161,8 @@ class QuicSocketUtils {
   // Creates a UDP socket and sets appropriate socket options for QUIC.
   // Returns the created FD if successful, -1 otherwise.
   // |overflow_supported| is set to true if the socket supports it.
+  // UDP_GRO is set if FLAGS_quic_receive_gro is true and the kernel supports
+  // it, and SO_TXTIME likewise if FLAGS_quic_pacing_offload is true.
   static int CreateUDPSocket(const IPEndPoint& address,
                              bool* overflow_supported);
 
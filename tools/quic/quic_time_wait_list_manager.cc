@@ -79,7 +79,9 @@ QuicTimeWaitListManager::QuicTimeWaitListManager(
     QuicServerSessionBase::Visitor* visitor,
     QuicConnectionHelperInterface* helper,
     QuicAlarmFactory* alarm_factory)
-    : time_wait_period_(
+    : first_sequence_number_(0),
+      termination_packet_bytes_(0),
+      time_wait_period_(
           QuicTime::Delta::FromSeconds(FLAGS_quic_time_wait_list_seconds)),
       connection_id_clean_up_alarm_(
           alarm_factory->CreateAlarm(new ConnectionIdCleanUpAlarm(this))),
@@ -105,21 +107,36 @@ void QuicTimeWaitListManager::AddConnectionIdToTimeWait(
         << "have a close packet.  connection_id = " << connection_id;
   }
   int num_packets = 0;
-  ConnectionIdMap::iterator it = connection_id_map_.find(connection_id);
-  const bool new_connection_id = it == connection_id_map_.end();
+  ConnectionIdData* old_data = FindConnectionIdData(connection_id);
+  const bool new_connection_id = old_data == nullptr;
   if (!new_connection_id) {  // Replace record if it is reinserted.
-    num_packets = it->second.num_packets;
-    connection_id_map_.erase(it);
+    num_packets = old_data->num_packets;
+    // The old entry stays queued until it reaches the front.
+    if (old_data->termination_packets) {
+      for (const auto& packet : *old_data->termination_packets) {
+        termination_packet_bytes_ -= packet->length();
+      }
+      old_data->termination_packets.reset();
+    }
+    connection_id_map_.erase(connection_id);
   }
   TrimTimeWaitListIfNeeded();
   DCHECK_LT(num_connections(),
             static_cast<size_t>(FLAGS_quic_time_wait_list_max_connections));
-  ConnectionIdData data(num_packets, version, clock_->ApproximateNow(),
+  ConnectionIdData data(connection_id, num_packets, version,
+                        clock_->ApproximateNow(),
                         connection_rejected_statelessly);
-  if (termination_packets != nullptr) {
-    data.termination_packets.swap(*termination_packets);
+  if (termination_packets != nullptr && !termination_packets->empty()) {
+    for (const auto& packet : *termination_packets) {
+      termination_packet_bytes_ += packet->length();
+    }
+    data.termination_packets.reset(
+        new std::vector<std::unique_ptr<QuicEncryptedPacket>>);
+    data.termination_packets->swap(*termination_packets);
   }
-  connection_id_map_.emplace(std::make_pair(connection_id, std::move(data)));
+  connection_id_map_.insert(std::make_pair(
+      connection_id, first_sequence_number_ + connection_id_data_.size()));
+  connection_id_data_.push_back(std::move(data));
   if (new_connection_id) {
     visitor_->OnConnectionAddedToTimeWaitList(connection_id);
   }
@@ -127,14 +144,32 @@ void QuicTimeWaitListManager::AddConnectionIdToTimeWait(
 
 bool QuicTimeWaitListManager::IsConnectionIdInTimeWait(
     QuicConnectionId connection_id) const {
-  return ContainsKey(connection_id_map_, connection_id);
+  return connection_id_map_.find(connection_id) != connection_id_map_.end();
+}
+
+size_t QuicTimeWaitListManager::EstimateMemoryUsage() const {
+  // A deque allocates its elements in blocks, so its per-element overhead is
+  // negligible.
+  return connection_id_map_.memory_usage() +
+         connection_id_data_.size() * sizeof(ConnectionIdData) +
+         termination_packet_bytes_;
 }
 
 QuicVersion QuicTimeWaitListManager::GetQuicVersionFromConnectionId(
     QuicConnectionId connection_id) {
-  ConnectionIdMap::iterator it = connection_id_map_.find(connection_id);
-  DCHECK(it != connection_id_map_.end());
-  return (it->second).version;
+  ConnectionIdData* connection_data = FindConnectionIdData(connection_id);
+  DCHECK(connection_data != nullptr);
+  return connection_data->version;
+}
+
+QuicTimeWaitListManager::ConnectionIdData*
+QuicTimeWaitListManager::FindConnectionIdData(QuicConnectionId connection_id) {
+  QuicConnectionIdMap<uint64_t>::iterator it =
+      connection_id_map_.find(connection_id);
+  if (it == connection_id_map_.end()) {
+    return nullptr;
+  }
+  return &connection_id_data_[it->second - first_sequence_number_];
 }
 
 void QuicTimeWaitListManager::OnCanWrite() {
@@ -158,22 +193,21 @@ void QuicTimeWaitListManager::ProcessPacket(
   DVLOG(1) << "Processing " << connection_id << " in time wait state.";
   // TODO(satyamshekhar): Think about handling packets from different client
   // addresses.
-  ConnectionIdMap::iterator it = connection_id_map_.find(connection_id);
-  DCHECK(it != connection_id_map_.end());
+  ConnectionIdData* connection_data = FindConnectionIdData(connection_id);
+  DCHECK(connection_data != nullptr);
   // Increment the received packet count.
-  ConnectionIdData* connection_data = &it->second;
   ++(connection_data->num_packets);
 
   if (!ShouldSendResponse(connection_data->num_packets)) {
     return;
   }
 
-  if (!connection_data->termination_packets.empty()) {
+  if (connection_data->termination_packets) {
     if (connection_data->connection_rejected_statelessly) {
       DVLOG(3) << "Time wait list sending previous stateless reject response "
                << "for connection " << connection_id;
     }
-    for (const auto& packet : connection_data->termination_packets) {
+    for (const auto& packet : *connection_data->termination_packets) {
       QueuedPacket* queued_packet =
           new QueuedPacket(server_address, client_address, packet->Clone());
       // Takes ownership of the packet.
@@ -262,10 +296,10 @@ bool QuicTimeWaitListManager::WriteToWire(QueuedPacket* queued_packet) {
 
 void QuicTimeWaitListManager::SetConnectionIdCleanUpAlarm() {
   connection_id_clean_up_alarm_->Cancel();
+  PopReplacedConnectionIds();
   QuicTime::Delta next_alarm_interval = QuicTime::Delta::Zero();
-  if (!connection_id_map_.empty()) {
-    QuicTime oldest_connection_id =
-        connection_id_map_.begin()->second.time_added;
+  if (!connection_id_data_.empty()) {
+    QuicTime oldest_connection_id = connection_id_data_.front().time_added;
     QuicTime now = clock_->ApproximateNow();
     if (now.Subtract(oldest_connection_id) < time_wait_period_) {
       next_alarm_interval =
@@ -282,19 +316,39 @@ void QuicTimeWaitListManager::SetConnectionIdCleanUpAlarm() {
       clock_->ApproximateNow().Add(next_alarm_interval));
 }
 
+void QuicTimeWaitListManager::PopReplacedConnectionIds() {
+  while (!connection_id_data_.empty()) {
+    QuicConnectionIdMap<uint64_t>::const_iterator it =
+        connection_id_map_.find(connection_id_data_.front().connection_id);
+    if (it != connection_id_map_.end() &&
+        it->second == first_sequence_number_) {
+      return;
+    }
+    connection_id_data_.pop_front();
+    ++first_sequence_number_;
+  }
+}
+
 bool QuicTimeWaitListManager::MaybeExpireOldestConnection(
     QuicTime expiration_time) {
-  if (connection_id_map_.empty()) {
+  PopReplacedConnectionIds();
+  if (connection_id_data_.empty()) {
     return false;
   }
-  ConnectionIdMap::iterator it = connection_id_map_.begin();
-  QuicTime oldest_connection_id_time = it->second.time_added;
-  if (oldest_connection_id_time > expiration_time) {
+  ConnectionIdData* oldest = &connection_id_data_.front();
+  if (oldest->time_added > expiration_time) {
     // Too recent, don't retire.
     return false;
   }
   // This connection_id has lived its age, retire it now.
-  connection_id_map_.erase(it);
+  if (oldest->termination_packets) {
+    for (const auto& packet : *oldest->termination_packets) {
+      termination_packet_bytes_ -= packet->length();
+    }
+  }
+  connection_id_map_.erase(oldest->connection_id);
+  connection_id_data_.pop_front();
+  ++first_sequence_number_;
   return true;
 }
 
@@ -319,18 +373,24 @@ void QuicTimeWaitListManager::TrimTimeWaitListIfNeeded() {
 }
 
 QuicTimeWaitListManager::ConnectionIdData::ConnectionIdData(
+    QuicConnectionId connection_id_,
     int num_packets_,
     QuicVersion version_,
     QuicTime time_added_,
     bool connection_rejected_statelessly)
-    : num_packets(num_packets_),
-      version(version_),
+    : connection_id(connection_id_),
       time_added(time_added_),
+      num_packets(num_packets_),
+      version(version_),
       connection_rejected_statelessly(connection_rejected_statelessly) {}
 
 QuicTimeWaitListManager::ConnectionIdData::ConnectionIdData(
     ConnectionIdData&& other) = default;
 
+QuicTimeWaitListManager::ConnectionIdData&
+QuicTimeWaitListManager::ConnectionIdData::operator=(
+    ConnectionIdData&& other) = default;
+
 QuicTimeWaitListManager::ConnectionIdData::~ConnectionIdData() {}
 
 }  // namespace net
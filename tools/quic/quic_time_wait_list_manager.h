@@ -10,18 +10,20 @@
 #define NET_TOOLS_QUIC_QUIC_TIME_WAIT_LIST_MANAGER_H_
 
 #include <stddef.h>
+#include <stdint.h>
 
 #include <deque>
 #include <memory>
+#include <vector>
 
 #include "base/macros.h"
-#include "net/base/linked_hash_map.h"
 #include "net/quic/quic_blocked_writer_interface.h"
 #include "net/quic/quic_connection.h"
 #include "net/quic/quic_framer.h"
 #include "net/quic/quic_packet_writer.h"
 #include "net/quic/quic_protocol.h"
 #include "net/quic/quic_server_session_base.h"
+#include "net/tools/quic/quic_connection_id_map.h"
 
 namespace net {
 
@@ -100,6 +102,10 @@ class QuicTimeWaitListManager : public QuicBlockedWriterInterface {
   // The number of connections on the time-wait list.
   size_t num_connections() const { return connection_id_map_.size(); }
 
+  // Returns the approximate number of bytes used by the time-wait list,
+  // including termination packets.
+  size_t EstimateMemoryUsage() const;
+
   // Sends a version negotiation packet for |connection_id| announcing support
   // for |supported_versions| to |client_address| from |server_address|.
   virtual void SendVersionNegotiationPacket(
@@ -143,38 +149,63 @@ class QuicTimeWaitListManager : public QuicBlockedWriterInterface {
 
   // Removes the oldest connection from the time-wait list if it was added prior
   // to "expiration_time".  To unconditionally remove the oldest connection, use
-  // a QuicTime::Delta:Infinity().  This function modifies the
-  // connection_id_map_.  If you plan to call this function in a loop, any
-  // iterators that you hold before the call to this function may be invalid
-  // afterward.  Returns true if the oldest connection was expired.  Returns
-  // false if the map is empty or the oldest connection has not expired.
+  // a QuicTime::Delta:Infinity().  Returns true if the oldest connection was
+  // expired.  Returns false if the list is empty or the oldest connection has
+  // not expired.
   bool MaybeExpireOldestConnection(QuicTime expiration_time);
 
-  // A map from a recently closed connection_id to the number of packets
-  // received after the termination of the connection bound to the
-  // connection_id.
+  // The state of a recently closed connection_id, including the number of
+  // packets received after the termination of the connection bound to the
+  // connection_id. Kept small, since a busy server holds many of them.
   struct ConnectionIdData {
-    ConnectionIdData(int num_packets_,
+    ConnectionIdData(QuicConnectionId connection_id_,
+                     int num_packets_,
                      QuicVersion version_,
                      QuicTime time_added_,
                      bool connection_rejected_statelessly);
 
     ConnectionIdData(const ConnectionIdData& other) = delete;
     ConnectionIdData(ConnectionIdData&& other);
+    ConnectionIdData& operator=(ConnectionIdData&& other);
 
     ~ConnectionIdData();
 
+    QuicConnectionId connection_id;
+    QuicTime time_added;
     int num_packets;
     QuicVersion version;
-    QuicTime time_added;
-    // These packets may contain CONNECTION_CLOSE frames, or SREJ messages.
-    std::vector<std::unique_ptr<QuicEncryptedPacket>> termination_packets;
     bool connection_rejected_statelessly;
+    // These packets may contain CONNECTION_CLOSE frames, or SREJ messages.
+    // They embed the connection ID and are encrypted for the connection, so
+    // they cannot be shared. Null if there are none, which is the usual case
+    // for connections added by the dispatcher.
+    std::unique_ptr<std::vector<std::unique_ptr<QuicEncryptedPacket>>>
+        termination_packets;
   };
 
-  // linked_hash_map allows lookup by ConnectionId and traversal in add order.
-  typedef linked_hash_map<QuicConnectionId, ConnectionIdData> ConnectionIdMap;
-  ConnectionIdMap connection_id_map_;
+  // Returns the data for |connection_id|, or null if it is not in time wait.
+  ConnectionIdData* FindConnectionIdData(QuicConnectionId connection_id);
+
+  // Pops the entries at the front of |connection_id_data_| that were replaced
+  // by a later AddConnectionIdToTimeWait() for the same connection_id.
+  void PopReplacedConnectionIds();
+
+  // Connection_ids in time wait state, in the order they were added. The
+  // entries are only ever appended and popped, so expiring the oldest is O(1)
+  // and needs no per-entry allocation. An entry whose connection_id is added
+  // again is left in place, and skipped once it reaches the front.
+  std::deque<ConnectionIdData> connection_id_data_;
+
+  // The sequence number of the front of |connection_id_data_|. The entry with
+  // sequence number n is at index n - |first_sequence_number_|.
+  uint64_t first_sequence_number_;
+
+  // Maps each connection_id in time wait state to the sequence number of its
+  // current entry in |connection_id_data_|.
+  QuicConnectionIdMap<uint64_t> connection_id_map_;
+
+  // The total size of all termination packets.
+  size_t termination_packet_bytes_;
 
   // Pending public reset packets that need to be sent out to the client
   // when we are given a chance to write by the dispatcher.
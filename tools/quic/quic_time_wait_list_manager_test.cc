@@ -556,6 +556,65 @@ TEST_F(QuicTimeWaitListManagerTest, MaxConnectionsTest) {
   }
 }
 
+// A connection ID that is added again expires with its new add time, even
+// though its old entry is still queued ahead of others.
+TEST_F(QuicTimeWaitListManagerTest, ReAddedConnectionIdExpiresLater) {
+  const QuicTime::Delta time_wait_period =
+      QuicTimeWaitListManagerPeer::time_wait_period(&time_wait_list_manager_);
+  epoll_server_.set_now_in_usec(0);
+  EXPECT_CALL(visitor_, OnConnectionAddedToTimeWaitList(1));
+  AddConnectionId(1);
+  EXPECT_CALL(visitor_, OnConnectionAddedToTimeWaitList(2));
+  AddConnectionId(2);
+  epoll_server_.set_now_in_usec(10);
+  AddConnectionId(1);
+  EXPECT_EQ(2u, time_wait_list_manager_.num_connections());
+
+  // Only 2 has expired. The alarm is set for when 1 expires.
+  epoll_server_.set_now_in_usec(time_wait_period.ToMicroseconds() + 1);
+  EXPECT_CALL(epoll_server_,
+              RegisterAlarm(time_wait_period.ToMicroseconds() + 10, _));
+  time_wait_list_manager_.CleanUpOldConnectionIds();
+  EXPECT_TRUE(IsConnectionIdInTimeWait(1));
+  EXPECT_FALSE(IsConnectionIdInTimeWait(2));
+  EXPECT_EQ(1u, time_wait_list_manager_.num_connections());
+
+  epoll_server_.set_now_in_usec(time_wait_period.ToMicroseconds() + 10);
+  EXPECT_CALL(epoll_server_, RegisterAlarm(_, _));
+  time_wait_list_manager_.CleanUpOldConnectionIds();
+  EXPECT_FALSE(IsConnectionIdInTimeWait(1));
+  EXPECT_EQ(0u, time_wait_list_manager_.num_connections());
+}
+
+TEST_F(QuicTimeWaitListManagerTest, MemoryUsage) {
+  const size_t kNumConnections = 10000;
+  EXPECT_CALL(visitor_, OnConnectionAddedToTimeWaitList(_))
+      .Times(kNumConnections);
+  const size_t empty_usage = time_wait_list_manager_.EstimateMemoryUsage();
+  for (size_t connection_id = 1; connection_id <= kNumConnections;
+       ++connection_id) {
+    AddConnectionId(connection_id);
+  }
+  const size_t bytes_per_connection =
+      (time_wait_list_manager_.EstimateMemoryUsage() - empty_usage) /
+      kNumConnections;
+  VLOG(1) << "Time-wait list bytes per connection: " << bytes_per_connection;
+  EXPECT_LT(bytes_per_connection, 128u);
+
+  // Termination packets are accounted for until they expire.
+  const size_t kConnectionCloseLength = 100;
+  std::vector<std::unique_ptr<QuicEncryptedPacket>> termination_packets;
+  termination_packets.push_back(
+      std::unique_ptr<QuicEncryptedPacket>(new QuicEncryptedPacket(
+          new char[kConnectionCloseLength], kConnectionCloseLength, true)));
+  size_t usage = time_wait_list_manager_.EstimateMemoryUsage();
+  AddConnectionId(1, QuicVersionMax(),
+                  /*connection_rejected_statelessly=*/false,
+                  &termination_packets);
+  EXPECT_LE(usage + kConnectionCloseLength,
+            time_wait_list_manager_.EstimateMemoryUsage());
+}
+
 }  // namespace
 }  // namespace test
 }  // namespace net
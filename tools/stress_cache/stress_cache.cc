@@ -10,6 +10,9 @@
 // The child application has two threads: one to exercise the cache in an
 // infinite loop, and another one to asynchronously kill the process.
 
+// With --shards=N, the cache is split in N shards, each one served by a thread
+// of its own.
+
 // A regular build should never crash.
 // To test that the disk cache doesn't generate critical errors with regular
 // application level crashes, edit stress_support.h.
@@ -37,10 +40,12 @@
 #include "base/threading/platform_thread.h"
 #include "base/threading/thread.h"
 #include "base/threading/thread_task_runner_handle.h"
+#include "base/time/time.h"
 #include "net/base/io_buffer.h"
 #include "net/base/net_errors.h"
 #include "net/base/test_completion_callback.h"
 #include "net/disk_cache/blockfile/backend_impl.h"
+#include "net/disk_cache/blockfile/sharded_backend_impl.h"
 #include "net/disk_cache/blockfile/stress_support.h"
 #include "net/disk_cache/blockfile/trace.h"
 #include "net/disk_cache/disk_cache.h"
@@ -55,13 +60,17 @@ using base::Time;
 const int kError = -1;
 const int kExpectedCrash = 100;
 
+const char kShardsSwitch[] = "shards";
+
 // Starts a new process.
-int RunSlave(int iteration) {
+int RunSlave(int iteration, int shard_count) {
   base::FilePath exe;
   PathService::Get(base::FILE_EXE, &exe);
 
   base::CommandLine cmdline(exe);
   cmdline.AppendArg(base::IntToString(iteration));
+  if (shard_count > 1)
+    cmdline.AppendSwitchASCII(kShardsSwitch, base::IntToString(shard_count));
 
   base::Process process = base::LaunchProcess(cmdline, base::LaunchOptions());
   if (!process.IsValid()) {
@@ -78,9 +87,9 @@ int RunSlave(int iteration) {
 }
 
 // Main loop for the master process.
-int MasterCode() {
+int MasterCode(int shard_count) {
   for (int i = 0; i < 100000; i++) {
-    int ret = RunSlave(i);
+    int ret = RunSlave(i, shard_count);
     if (kExpectedCrash != ret)
       return ret;
   }
@@ -153,7 +162,8 @@ struct Data {
   int pendig_operations;  // Counter of simultaneous operations.
   int writes;             // How many writes since this iteration started.
   int iteration;          // The iteration (number of crashes).
-  disk_cache::BackendImpl* cache;
+  base::TimeTicks start;  // When this iteration started.
+  disk_cache::Backend* cache;
   std::string keys[kNumKeys];
   EntryWrapper entries[kNumEntries];
 };
@@ -225,8 +235,11 @@ void EntryWrapper::DoWrite() {
 void EntryWrapper::OnWriteDone(int size, int result) {
   DCHECK_EQ(state_, WRITE);
   CHECK_EQ(size, result);
-  if (!(g_data->writes++ % 100))
-    printf("Entries: %d    \r", g_data->writes);
+  if (!(g_data->writes++ % 100)) {
+    double seconds = (base::TimeTicks::Now() - g_data->start).InSecondsF();
+    printf("Entries: %d (%.0f writes/s)    \r", g_data->writes,
+           seconds > 0 ? g_data->writes / seconds : 0);
+  }
 
   int random = rand() % 100;
   std::string key = entry_->GetKey();
@@ -295,7 +308,7 @@ void LoopTask() {
 // This thread will loop forever, adding and removing entries from the cache.
 // iteration is the current crash cycle, so the entries on the cache are marked
 // to know which instance of the application wrote them.
-void StressTheCache(int iteration) {
+void StressTheCache(int iteration, int shard_count) {
   int cache_size = 0x2000000;  // 32MB.
   uint32_t mask = 0xfff;       // 4096 entries.
 
@@ -310,13 +323,24 @@ void StressTheCache(int iteration) {
 
   g_data = new Data();
   g_data->iteration = iteration;
-  g_data->cache = new disk_cache::BackendImpl(
-      path, mask, cache_thread.task_runner().get(), NULL);
-  g_data->cache->SetMaxSize(cache_size);
-  g_data->cache->SetFlags(disk_cache::kNoLoadProtection);
-
   net::TestCompletionCallback cb;
-  int rv = g_data->cache->Init(cb.callback());
+  int rv;
+  if (shard_count > 1) {
+    // Each shard has a thread of its own, and sizes its own table.
+    disk_cache::ShardedBackendImpl* cache = new disk_cache::ShardedBackendImpl(
+        path.AppendASCII("sharded"), shard_count, NULL);
+    cache->SetMaxSize(cache_size);
+    cache->SetFlags(disk_cache::kNoLoadProtection);
+    rv = cache->Init(cb.callback());
+    g_data->cache = cache;
+  } else {
+    disk_cache::BackendImpl* cache = new disk_cache::BackendImpl(
+        path, mask, cache_thread.task_runner().get(), NULL);
+    cache->SetMaxSize(cache_size);
+    cache->SetFlags(disk_cache::kNoLoadProtection);
+    rv = cache->Init(cb.callback());
+    g_data->cache = cache;
+  }
 
   if (cb.GetResult(rv) != net::OK) {
     printf("Unable to initialize cache.\n");
@@ -331,6 +355,8 @@ void StressTheCache(int iteration) {
   for (int i = 0; i < kNumKeys; i++)
     g_data->keys[i] = GenerateStressKey();
 
+  g_data->start = base::TimeTicks::Now();
+
   base::ThreadTaskRunnerHandle::Get()->PostTask(FROM_HERE,
                                                 base::Bind(&LoopTask));
   base::RunLoop().Run();
@@ -411,8 +437,21 @@ int main(int argc, const char* argv[]) {
   // Setup an AtExitManager so Singleton objects will be destructed.
   base::AtExitManager at_exit_manager;
 
-  if (argc < 2)
-    return MasterCode();
+  base::CommandLine::Init(argc, argv);
+  const base::CommandLine& command_line =
+      *base::CommandLine::ForCurrentProcess();
+  int shard_count = 1;
+  if (command_line.HasSwitch(kShardsSwitch) &&
+      (!base::StringToInt(command_line.GetSwitchValueASCII(kShardsSwitch),
+                          &shard_count) ||
+       shard_count < 1)) {
+    printf("Invalid number of shards\n");
+    return kError;
+  }
+
+  const base::CommandLine::StringVector& args = command_line.GetArgs();
+  if (args.empty())
+    return MasterCode(shard_count);
 
   logging::SetLogAssertHandler(CrashHandler);
   logging::SetLogMessageHandler(MessageHandler);
@@ -420,7 +459,6 @@ int main(int argc, const char* argv[]) {
 #if defined(OS_WIN)
   logging::LogEventProvider::Initialize(kStressCacheTraceProviderName);
 #else
-  base::CommandLine::Init(argc, argv);
   logging::LoggingSettings settings;
   settings.logging_dest = logging::LOG_TO_SYSTEM_DEBUG_LOG;
   logging::InitLogging(settings);
@@ -430,14 +468,14 @@ int main(int argc, const char* argv[]) {
   base::PlatformThread::Sleep(base::TimeDelta::FromSeconds(3));
   base::MessageLoopForIO message_loop;
 
-  char* end;
-  long int iteration = strtol(argv[1], &end, 0);
+  int iteration = 0;
+  base::StringToInt(args[0], &iteration);
 
   if (!StartCrashThread()) {
     printf("failed to start thread\n");
     return kError;
   }
 
-  StressTheCache(iteration);
+  StressTheCache(iteration, shard_count);
   return 0;
 }
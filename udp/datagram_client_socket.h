@@ -5,17 +5,35 @@
 #ifndef NET_UDP_DATAGRAM_CLIENT_SOCKET_H_
 #define NET_UDP_DATAGRAM_CLIENT_SOCKET_H_
 
+#include "base/time/time.h"
+#include "net/base/net_errors.h"
 #include "net/base/network_change_notifier.h"
 #include "net/socket/socket.h"
 #include "net/udp/datagram_socket.h"
 
 namespace net {
 
+class IOBuffer;
 class IPEndPoint;
 
 class NET_EXPORT_PRIVATE DatagramClientSocket : public DatagramSocket,
                                                 public Socket {
  public:
+  // One datagram read by ReadMultiple().
+  struct ReceivedDatagram {
+    int length;
+    // When the kernel received the datagram, if receive timestamps are
+    // enabled and supported. Null otherwise.
+    base::Time receive_time;
+    // If generic receive offload coalesced several datagrams from the peer
+    // into this one, the length of each of them; the last may be shorter.
+    // 0 otherwise.
+    int segment_size;
+  };
+
+  // The largest datagram that generic receive offload can produce.
+  static const int kMaxCoalescedDatagramSize = 64 * 1024;
+
   ~DatagramClientSocket() override {}
 
   // Initialize this socket as a client socket to server at |address|.
@@ -40,6 +58,33 @@ class NET_EXPORT_PRIVATE DatagramClientSocket : public DatagramSocket,
   // ConnectUsingNetwork() or ConnectUsingDefaultNetwork().
   virtual NetworkChangeNotifier::NetworkHandle GetBoundNetwork() const = 0;
 
+  // Reads up to |max_datagrams| datagrams with as few system calls as the
+  // platform allows. Datagram i is read into |buf| at offset i * |datagram_len|
+  // and described by |datagrams|[i]. Returns the number of datagrams read, a
+  // net error code, or ERR_IO_PENDING, in which case |callback| runs with one
+  // of the former and |buf| and |datagrams| must be kept alive until then.
+  // Like Read(), at most one read may be outstanding.
+  // Returns ERR_NOT_IMPLEMENTED if the socket does not support it; callers
+  // should fall back to Read().
+  virtual int ReadMultiple(IOBuffer* buf,
+                           int datagram_len,
+                           int max_datagrams,
+                           ReceivedDatagram* datagrams,
+                           const CompletionCallback& callback) {
+    return ERR_NOT_IMPLEMENTED;
+  }
+
+  // Asks the kernel to timestamp received datagrams, for ReadMultiple().
+  // Returns a net error code.
+  virtual int EnableReceiveTimestamps() { return ERR_NOT_IMPLEMENTED; }
+
+  // Asks the kernel to coalesce consecutive equal-sized datagrams from the
+  // peer into one, which saves per-datagram work on bulk transfers.
+  // ReadMultiple() then reports the size of the original datagrams in
+  // ReceivedDatagram::segment_size, and must be passed a |datagram_len| of at
+  // least kMaxCoalescedDatagramSize. Read() must not be used afterwards.
+  // Returns a net error code, in which case the socket is unchanged.
+  virtual int EnableGenericReceiveOffload() { return ERR_NOT_IMPLEMENTED; }
 };
 
 }  // namespace net
@@ -83,6 +83,20 @@ int UDPClientSocket::Read(IOBuffer* buf,
   return socket_.Read(buf, buf_len, callback);
 }
 
+int UDPClientSocket::ReadMultiple(IOBuffer* buf,
+                                  int datagram_len,
+                                  int max_datagrams,
+                                  ReceivedDatagram* datagrams,
+                                  const CompletionCallback& callback) {
+#if defined(OS_POSIX)
+  return socket_.ReadMultiple(buf, datagram_len, max_datagrams, datagrams,
+                              callback);
+#else
+  return DatagramClientSocket::ReadMultiple(buf, datagram_len, max_datagrams,
+                                            datagrams, callback);
+#endif
+}
+
 int UDPClientSocket::Write(IOBuffer* buf,
                           int buf_len,
                           const CompletionCallback& callback) {
@@ -109,6 +123,22 @@ int UDPClientSocket::SetSendBufferSize(int32_t size) {
   return socket_.SetSendBufferSize(size);
 }
 
+int UDPClientSocket::EnableReceiveTimestamps() {
+#if defined(OS_POSIX)
+  return socket_.EnableReceiveTimestamps();
+#else
+  return DatagramClientSocket::EnableReceiveTimestamps();
+#endif
+}
+
+int UDPClientSocket::EnableGenericReceiveOffload() {
+#if defined(OS_POSIX)
+  return socket_.EnableGenericReceiveOffload();
+#else
+  return DatagramClientSocket::EnableGenericReceiveOffload();
+#endif
+}
+
 const BoundNetLog& UDPClientSocket::NetLog() const {
   return socket_.NetLog();
 }
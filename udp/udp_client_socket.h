@@ -35,6 +35,11 @@ class NET_EXPORT_PRIVATE UDPClientSocket : public DatagramClientSocket {
   int Read(IOBuffer* buf,
            int buf_len,
            const CompletionCallback& callback) override;
+  int ReadMultiple(IOBuffer* buf,
+                   int datagram_len,
+                   int max_datagrams,
+                   ReceivedDatagram* datagrams,
+                   const CompletionCallback& callback) override;
   int Write(IOBuffer* buf,
             int buf_len,
             const CompletionCallback& callback) override;
@@ -43,6 +48,8 @@ class NET_EXPORT_PRIVATE UDPClientSocket : public DatagramClientSocket {
   int GetLocalAddress(IPEndPoint* address) const override;
   int SetReceiveBufferSize(int32_t size) override;
   int SetSendBufferSize(int32_t size) override;
+  int EnableReceiveTimestamps() override;
+  int EnableGenericReceiveOffload() override;
   const BoundNetLog& NetLog() const override;
 
 #if defined(OS_WIN)
@@ -2,14 +2,23 @@
 // Use of this source code is governed by a BSD-style license that can be
 // found in the LICENSE file.
 
+#include <vector>
+
+#if defined(OS_LINUX)
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
 #include "base/bind.h"
 #include "base/memory/weak_ptr.h"
 #include "base/message_loop/message_loop.h"
 #include "base/run_loop.h"
+#include "base/test/perf_log.h"
 #include "base/test/perf_time_logger.h"
 #include "net/base/io_buffer.h"
 #include "net/base/ip_endpoint.h"
 #include "net/base/net_errors.h"
+#include "net/base/sockaddr_storage.h"
 #include "net/base/test_completion_callback.h"
 #include "net/test/gtest_util.h"
 #include "net/test/net_test_suite.h"
@@ -26,6 +35,15 @@ namespace net {
 
 namespace {
 
+#if defined(OS_LINUX)
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#endif  // defined(OS_LINUX)
+
 class UDPSocketPerfTest : public PlatformTest {
  public:
   UDPSocketPerfTest()
@@ -47,8 +65,21 @@ class UDPSocketPerfTest : public PlatformTest {
   // has effect on Windows.
   void WriteBenchmark(bool use_nonblocking_io);
 
+  // Sends bursts of packets to a connected client over loopback, and reads
+  // them with ReadMultiple() if |read_multiple| is true, or Read() otherwise.
+  void ReadBenchmark(bool read_multiple);
+
+#if defined(OS_LINUX)
+  // Sends each burst as one UDP_SEGMENT write, and reads it with
+  // ReadMultiple(), with generic receive offload if |coalesce| is true.
+  void ReadSegmentedBenchmark(bool coalesce);
+#endif
+
  protected:
   static const int kPacketSize = 1024;
+  // Small enough for the default receive buffer to hold a whole burst.
+  static const int kBurstSize = 32;
+  static const int kNumBursts = 20000;
   scoped_refptr<IOBufferWithSize> buffer_;
   base::WeakPtrFactory<UDPSocketPerfTest> weak_factory_;
 };
@@ -125,11 +156,162 @@ void UDPSocketPerfTest::WriteBenchmark(bool use_nonblocking_io) {
   LOG(INFO) << "Write speed: " << packets / 1024 / elapsed << " MB/s";
 }
 
+void UDPSocketPerfTest::ReadBenchmark(bool read_multiple) {
+  base::MessageLoopForIO message_loop;
+
+  IPEndPoint bind_address;
+  CreateUDPAddress("127.0.0.1", 0, &bind_address);
+  UDPServerSocket server(nullptr, NetLog::Source());
+  ASSERT_THAT(server.Listen(bind_address), IsOk());
+  IPEndPoint server_address;
+  ASSERT_THAT(server.GetLocalAddress(&server_address), IsOk());
+
+  UDPClientSocket client(DatagramSocket::DEFAULT_BIND, RandIntCallback(),
+                         nullptr, NetLog::Source());
+  ASSERT_THAT(client.Connect(server_address), IsOk());
+  IPEndPoint client_address;
+  ASSERT_THAT(client.GetLocalAddress(&client_address), IsOk());
+
+  scoped_refptr<IOBufferWithSize> packet(new IOBufferWithSize(kPacketSize));
+  memset(packet->data(), 'G', kPacketSize);
+  scoped_refptr<IOBuffer> read_buffer(new IOBuffer(kPacketSize * kBurstSize));
+  std::vector<DatagramClientSocket::ReceivedDatagram> datagrams(kBurstSize);
+  TestCompletionCallback callback;
+
+  // Only the reads are timed. The loop runs on one thread, so this is also the
+  // rate per core.
+  base::TimeDelta read_time;
+  for (int burst = 0; burst < kNumBursts; ++burst) {
+    for (int i = 0; i < kBurstSize; ++i) {
+      ASSERT_EQ(kPacketSize, server.SendTo(packet.get(), kPacketSize,
+                                           client_address,
+                                           callback.callback()));
+    }
+    base::TimeTicks start = base::TimeTicks::Now();
+    int packets_read = 0;
+    while (packets_read < kBurstSize) {
+      int rv;
+      if (read_multiple) {
+        rv = client.ReadMultiple(read_buffer.get(), kPacketSize,
+                                 kBurstSize - packets_read, datagrams.data(),
+                                 callback.callback());
+      } else {
+        rv = client.Read(read_buffer.get(), kPacketSize, callback.callback());
+      }
+      if (rv == ERR_IO_PENDING)
+        rv = callback.WaitForResult();
+      ASSERT_GT(rv, 0);
+      packets_read += read_multiple ? rv : 1;
+    }
+    read_time += base::TimeTicks::Now() - start;
+  }
+
+  base::LogPerfResult(
+      read_multiple ? "UDP_socket_read_multiple" : "UDP_socket_read",
+      kNumBursts * kBurstSize / read_time.InSecondsF(), "packets/s");
+}
+
+#if defined(OS_LINUX)
+void UDPSocketPerfTest::ReadSegmentedBenchmark(bool coalesce) {
+  base::MessageLoopForIO message_loop;
+
+  // UDPServerSocket cannot send with UDP_SEGMENT, so use a raw socket.
+  int sender = socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_GE(sender, 0);
+  int segment_size = kPacketSize;
+  if (setsockopt(sender, SOL_UDP, UDP_SEGMENT, &segment_size,
+                 sizeof(segment_size)) != 0) {
+    LOG(WARNING) << "UDP_SEGMENT not supported; skipping benchmark.";
+    close(sender);
+    return;
+  }
+  IPEndPoint sender_address;
+  CreateUDPAddress("127.0.0.1", 0, &sender_address);
+  SockaddrStorage storage;
+  ASSERT_TRUE(sender_address.ToSockAddr(storage.addr, &storage.addr_len));
+  ASSERT_EQ(0, bind(sender, storage.addr, storage.addr_len));
+  storage = SockaddrStorage();
+  ASSERT_EQ(0, getsockname(sender, storage.addr, &storage.addr_len));
+  ASSERT_TRUE(sender_address.FromSockAddr(storage.addr, storage.addr_len));
+
+  UDPClientSocket client(DatagramSocket::DEFAULT_BIND, RandIntCallback(),
+                         nullptr, NetLog::Source());
+  ASSERT_THAT(client.Connect(sender_address), IsOk());
+  int datagram_len = kPacketSize;
+  int max_datagrams = kBurstSize;
+  if (coalesce) {
+    if (client.EnableGenericReceiveOffload() != OK) {
+      LOG(WARNING) << "UDP_GRO not supported; skipping benchmark.";
+      close(sender);
+      return;
+    }
+    datagram_len = DatagramClientSocket::kMaxCoalescedDatagramSize;
+    max_datagrams = 1;
+  }
+  IPEndPoint client_address;
+  ASSERT_THAT(client.GetLocalAddress(&client_address), IsOk());
+  storage = SockaddrStorage();
+  ASSERT_TRUE(client_address.ToSockAddr(storage.addr, &storage.addr_len));
+
+  const std::vector<char> burst(kPacketSize * kBurstSize, 'G');
+  scoped_refptr<IOBuffer> read_buffer(
+      new IOBuffer(datagram_len * max_datagrams));
+  std::vector<DatagramClientSocket::ReceivedDatagram> datagrams(
+      max_datagrams);
+  TestCompletionCallback callback;
+
+  base::TimeDelta read_time;
+  for (int i = 0; i < kNumBursts; ++i) {
+    ASSERT_EQ(static_cast<ssize_t>(burst.size()),
+              sendto(sender, burst.data(), burst.size(), 0, storage.addr,
+                     storage.addr_len));
+    base::TimeTicks start = base::TimeTicks::Now();
+    int bytes_read = 0;
+    while (bytes_read < static_cast<int>(burst.size())) {
+      int rv = client.ReadMultiple(read_buffer.get(), datagram_len,
+                                   max_datagrams, datagrams.data(),
+                                   callback.callback());
+      rv = callback.GetResult(rv);
+      ASSERT_GT(rv, 0);
+      for (int j = 0; j < rv; ++j)
+        bytes_read += datagrams[j].length;
+    }
+    read_time += base::TimeTicks::Now() - start;
+  }
+  close(sender);
+
+  base::LogPerfResult(
+      coalesce ? "UDP_socket_read_coalesced" : "UDP_socket_read_segmented",
+      kNumBursts * burst.size() / 1024.0 / 1024.0 / read_time.InSecondsF(),
+      "MB/s");
+}
+#endif  // defined(OS_LINUX)
+
 TEST_F(UDPSocketPerfTest, Write) {
   base::PerfTimeLogger timer("UDP_socket_write");
   WriteBenchmark(false);
 }
 
+TEST_F(UDPSocketPerfTest, Read) {
+  ReadBenchmark(false);
+}
+
+#if defined(OS_POSIX)
+TEST_F(UDPSocketPerfTest, ReadMultiple) {
+  ReadBenchmark(true);
+}
+#endif
+
+#if defined(OS_LINUX)
+TEST_F(UDPSocketPerfTest, ReadSegmented) {
+  ReadSegmentedBenchmark(false);
+}
+
+TEST_F(UDPSocketPerfTest, ReadCoalesced) {
+  ReadSegmentedBenchmark(true);
+}
+#endif
+
 #if defined(OS_WIN)
 TEST_F(UDPSocketPerfTest, WriteNonBlocking) {
   base::PerfTimeLogger timer("UDP_socket_write_nonblocking");
@@ -9,8 +9,12 @@
 #include <net/if.h>
 #include <netdb.h>
 #include <netinet/in.h>
+#include <string.h>
 #include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/time.h>
+
+#include <algorithm>
 
 #include "base/callback.h"
 #include "base/debug/alias.h"
@@ -69,6 +73,51 @@ int GetIPv4AddressFromIndex(int socket, uint32_t index, uint32_t* address) {
 
 #endif  // OS_MACOSX
 
+#if defined(OS_LINUX)
+
+// These are missing from older C library headers.
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+// Maximum number of datagrams read by one recvmmsg() call.
+const int kMaxDatagramsPerRead = 32;
+
+// Room for an SO_TIMESTAMP and a UDP_GRO control message.
+const size_t kReadControlSize =
+    CMSG_SPACE(sizeof(timeval)) + CMSG_SPACE(sizeof(int));
+
+// Returns the SO_TIMESTAMP receive time in |header|, or a null Time.
+base::Time GetReceiveTime(msghdr* header) {
+  for (cmsghdr* cmsg = CMSG_FIRSTHDR(header); cmsg;
+       cmsg = CMSG_NXTHDR(header, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMP) {
+      timeval tv;
+      memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+      return base::Time::FromTimeVal(tv);
+    }
+  }
+  return base::Time();
+}
+
+// Returns the UDP_GRO segment size in |header|, or 0.
+int GetSegmentSize(msghdr* header) {
+  for (cmsghdr* cmsg = CMSG_FIRSTHDR(header); cmsg;
+       cmsg = CMSG_NXTHDR(header, cmsg)) {
+    if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+      int segment_size;
+      memcpy(&segment_size, CMSG_DATA(cmsg), sizeof(segment_size));
+      return segment_size;
+    }
+  }
+  return 0;
+}
+
+#endif  // OS_LINUX
+
 }  // namespace
 
 UDPSocketPosix::UDPSocketPosix(DatagramSocket::BindType bind_type,
@@ -87,6 +136,10 @@ UDPSocketPosix::UDPSocketPosix(DatagramSocket::BindType bind_type,
       write_watcher_(this),
       read_buf_len_(0),
       recv_from_address_(NULL),
+      read_max_datagrams_(0),
+      read_datagrams_(NULL),
+      receive_timestamps_(false),
+      generic_receive_offload_(false),
       write_buf_len_(0),
       net_log_(BoundNetLog::Make(net_log, NetLog::SOURCE_UDP_SOCKET)),
       bound_network_(NetworkChangeNotifier::kInvalidNetworkHandle) {
@@ -128,6 +181,10 @@ void UDPSocketPosix::Close() {
   read_buf_len_ = 0;
   read_callback_.Reset();
   recv_from_address_ = NULL;
+  read_max_datagrams_ = 0;
+  read_datagrams_ = NULL;
+  receive_timestamps_ = false;
+  generic_receive_offload_ = false;
   write_buf_ = NULL;
   write_buf_len_ = 0;
   write_callback_.Reset();
@@ -225,6 +282,43 @@ int UDPSocketPosix::RecvFrom(IOBuffer* buf,
   return ERR_IO_PENDING;
 }
 
+int UDPSocketPosix::ReadMultiple(
+    IOBuffer* buf,
+    int datagram_len,
+    int max_datagrams,
+    DatagramClientSocket::ReceivedDatagram* datagrams,
+    const CompletionCallback& callback) {
+  DCHECK(CalledOnValidThread());
+  DCHECK_NE(kInvalidSocket, socket_);
+  CHECK(read_callback_.is_null());
+  DCHECK(!read_datagrams_);
+  DCHECK(!callback.is_null());  // Synchronous operation not supported
+  DCHECK_GT(datagram_len, 0);
+  DCHECK_GT(max_datagrams, 0);
+  DCHECK(!generic_receive_offload_ ||
+         datagram_len >= DatagramClientSocket::kMaxCoalescedDatagramSize);
+
+  int rv = InternalReadMultiple(buf, datagram_len, max_datagrams, datagrams);
+  if (rv != ERR_IO_PENDING)
+    return rv;
+
+  if (!base::MessageLoopForIO::current()->WatchFileDescriptor(
+          socket_, true, base::MessageLoopForIO::WATCH_READ,
+          &read_socket_watcher_, &read_watcher_)) {
+    PLOG(ERROR) << "WatchFileDescriptor failed on read";
+    int result = MapSystemError(errno);
+    LogRead(result, NULL, 0, NULL);
+    return result;
+  }
+
+  read_buf_ = buf;
+  read_buf_len_ = datagram_len;
+  read_max_datagrams_ = max_datagrams;
+  read_datagrams_ = datagrams;
+  read_callback_ = callback;
+  return ERR_IO_PENDING;
+}
+
 int UDPSocketPosix::Write(IOBuffer* buf,
                           int buf_len,
                           const CompletionCallback& callback) {
@@ -397,6 +491,38 @@ int UDPSocketPosix::SetSendBufferSize(int32_t size) {
   return rv == 0 ? OK : MapSystemError(errno);
 }
 
+int UDPSocketPosix::EnableReceiveTimestamps() {
+  DCHECK_NE(socket_, kInvalidSocket);
+  DCHECK(CalledOnValidThread());
+#if defined(OS_LINUX)
+  int true_value = 1;
+  int rv = setsockopt(socket_, SOL_SOCKET, SO_TIMESTAMP, &true_value,
+                      sizeof(true_value));
+  if (rv != 0)
+    return MapSystemError(errno);
+  receive_timestamps_ = true;
+  return OK;
+#else
+  return ERR_NOT_IMPLEMENTED;
+#endif  // defined(OS_LINUX)
+}
+
+int UDPSocketPosix::EnableGenericReceiveOffload() {
+  DCHECK_NE(socket_, kInvalidSocket);
+  DCHECK(CalledOnValidThread());
+#if defined(OS_LINUX)
+  int true_value = 1;
+  int rv =
+      setsockopt(socket_, SOL_UDP, UDP_GRO, &true_value, sizeof(true_value));
+  if (rv != 0)
+    return MapSystemError(errno);
+  generic_receive_offload_ = true;
+  return OK;
+#else
+  return ERR_NOT_IMPLEMENTED;
+#endif  // defined(OS_LINUX)
+}
+
 int UDPSocketPosix::AllowAddressReuse() {
   DCHECK_NE(socket_, kInvalidSocket);
   DCHECK(CalledOnValidThread());
@@ -456,12 +582,20 @@ void UDPSocketPosix::DoWriteCallback(int rv) {
 }
 
 void UDPSocketPosix::DidCompleteRead() {
-  int result =
-      InternalRecvFrom(read_buf_.get(), read_buf_len_, recv_from_address_);
+  int result;
+  if (read_datagrams_) {
+    result = InternalReadMultiple(read_buf_.get(), read_buf_len_,
+                                  read_max_datagrams_, read_datagrams_);
+  } else {
+    result =
+        InternalRecvFrom(read_buf_.get(), read_buf_len_, recv_from_address_);
+  }
   if (result != ERR_IO_PENDING) {
     read_buf_ = NULL;
     read_buf_len_ = 0;
     recv_from_address_ = NULL;
+    read_max_datagrams_ = 0;
+    read_datagrams_ = NULL;
     bool ok = read_socket_watcher_.StopWatchingFileDescriptor();
     DCHECK(ok);
     DoReadCallback(result);
@@ -551,6 +685,63 @@ int UDPSocketPosix::InternalRecvFrom(IOBuffer* buf,
   return result;
 }
 
+int UDPSocketPosix::InternalReadMultiple(
+    IOBuffer* buf,
+    int datagram_len,
+    int max_datagrams,
+    DatagramClientSocket::ReceivedDatagram* datagrams) {
+#if defined(OS_LINUX)
+  const int count = std::min(max_datagrams, kMaxDatagramsPerRead);
+  mmsghdr headers[kMaxDatagramsPerRead];
+  iovec iovs[kMaxDatagramsPerRead];
+  SockaddrStorage addresses[kMaxDatagramsPerRead];
+  char control[kMaxDatagramsPerRead][kReadControlSize];
+  memset(headers, 0, sizeof(headers));
+  for (int i = 0; i < count; ++i) {
+    iovs[i].iov_base = buf->data() + i * datagram_len;
+    iovs[i].iov_len = datagram_len;
+    msghdr* header = &headers[i].msg_hdr;
+    header->msg_name = addresses[i].addr;
+    header->msg_namelen = addresses[i].addr_len;
+    header->msg_iov = &iovs[i];
+    header->msg_iovlen = 1;
+    if (receive_timestamps_ || generic_receive_offload_) {
+      header->msg_control = control[i];
+      header->msg_controllen = sizeof(control[i]);
+    }
+  }
+
+  int num_read = HANDLE_EINTR(recvmmsg(socket_, headers, count, 0, NULL));
+  if (num_read < 0) {
+    int result = MapSystemError(errno);
+    if (result != ERR_IO_PENDING)
+      LogRead(result, NULL, 0, NULL);
+    return result;
+  }
+  for (int i = 0; i < num_read; ++i) {
+    msghdr* header = &headers[i].msg_hdr;
+    datagrams[i].length = headers[i].msg_len;
+    datagrams[i].receive_time = GetReceiveTime(header);
+    // A lone datagram may still carry its GRO segment size.
+    int segment_size = GetSegmentSize(header);
+    datagrams[i].segment_size =
+        segment_size < datagrams[i].length ? segment_size : 0;
+    LogRead(datagrams[i].length, buf->data() + i * datagram_len,
+            header->msg_namelen, addresses[i].addr);
+  }
+  return num_read;
+#else
+  // Without recvmmsg(), read one datagram per call.
+  int result = InternalRecvFrom(buf, datagram_len, NULL);
+  if (result < 0)
+    return result;
+  datagrams[0].length = result;
+  datagrams[0].receive_time = base::Time();
+  datagrams[0].segment_size = 0;
+  return 1;
+#endif  // defined(OS_LINUX)
+}
+
 int UDPSocketPosix::InternalSendTo(IOBuffer* buf,
                                    int buf_len,
                                    const IPEndPoint* address) {
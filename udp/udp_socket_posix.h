@@ -22,6 +22,7 @@
 #include "net/base/rand_callback.h"
 #include "net/log/net_log.h"
 #include "net/socket/socket_descriptor.h"
+#include "net/udp/datagram_client_socket.h"
 #include "net/udp/datagram_socket.h"
 #include "net/udp/diff_serv_code_point.h"
 
@@ -98,6 +99,15 @@ class NET_EXPORT UDPSocketPosix : public base::NonThreadSafe {
                IPEndPoint* address,
                const CompletionCallback& callback);
 
+  // Reads up to |max_datagrams| datagrams from a connected socket, with a
+  // single recvmmsg() call on Linux and one datagram per call elsewhere. See
+  // DatagramClientSocket::ReadMultiple().
+  int ReadMultiple(IOBuffer* buf,
+                   int datagram_len,
+                   int max_datagrams,
+                   DatagramClientSocket::ReceivedDatagram* datagrams,
+                   const CompletionCallback& callback);
+
   // Sends to a socket with a particular destination.
   // |buf| is the buffer to send.
   // |buf_len| is the number of bytes to send.
@@ -119,6 +129,17 @@ class NET_EXPORT UDPSocketPosix : public base::NonThreadSafe {
   // Returns a net error code.
   int SetSendBufferSize(int32_t size);
 
+  // Sets SO_TIMESTAMP, so that ReadMultiple() reports when the kernel received
+  // each datagram. Only supported on Linux.
+  // Returns a net error code.
+  int EnableReceiveTimestamps();
+
+  // Sets UDP_GRO, so that the kernel may coalesce datagrams from the peer.
+  // See DatagramClientSocket::EnableGenericReceiveOffload(). Only supported on
+  // Linux 5.0 and later; fails with the kernel's error otherwise.
+  // Returns a net error code.
+  int EnableGenericReceiveOffload();
+
   // Returns true if the socket is already connected or bound.
   bool is_connected() const { return is_connected_; }
 
@@ -247,6 +268,10 @@ class NET_EXPORT UDPSocketPosix : public base::NonThreadSafe {
 
   int InternalConnect(const IPEndPoint& address);
   int InternalRecvFrom(IOBuffer* buf, int buf_len, IPEndPoint* address);
+  int InternalReadMultiple(IOBuffer* buf,
+                           int datagram_len,
+                           int max_datagrams,
+                           DatagramClientSocket::ReceivedDatagram* datagrams);
   int InternalSendTo(IOBuffer* buf, int buf_len, const IPEndPoint* address);
 
   // Applies |socket_options_| to |socket_|. Should be called before
@@ -296,6 +321,15 @@ class NET_EXPORT UDPSocketPosix : public base::NonThreadSafe {
   scoped_refptr<IOBuffer> read_buf_;
   int read_buf_len_;
   IPEndPoint* recv_from_address_;
+  // Set while a ReadMultiple() is pending, in which case |read_buf_len_| is
+  // the length of each datagram.
+  int read_max_datagrams_;
+  DatagramClientSocket::ReceivedDatagram* read_datagrams_;
+
+  // True if SO_TIMESTAMP is set.
+  bool receive_timestamps_;
+  // True if UDP_GRO is set.
+  bool generic_receive_offload_;
 
   // The buffer used by InternalWrite() to retry Write requests
   scoped_refptr<IOBuffer> write_buf_;
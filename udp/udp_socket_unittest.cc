@@ -33,6 +33,21 @@
 #include <TargetConditionals.h>
 #endif
 
+#if defined(OS_LINUX)
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "net/base/sockaddr_storage.h"
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#endif  // defined(OS_LINUX)
+
 using net::test::IsError;
 using net::test::IsOk;
 
@@ -549,6 +564,125 @@ TEST_F(UDPSocketTest, ClientGetLocalPeerAddresses) {
   }
 }
 
+#if defined(OS_POSIX)
+TEST_F(UDPSocketTest, ReadMultiple) {
+  IPEndPoint bind_address;
+  CreateUDPAddress("127.0.0.1", 0, &bind_address);
+  UDPServerSocket server(NULL, NetLog::Source());
+  ASSERT_THAT(server.Listen(bind_address), IsOk());
+  IPEndPoint server_address;
+  ASSERT_THAT(server.GetLocalAddress(&server_address), IsOk());
+
+  UDPClientSocket client(DatagramSocket::DEFAULT_BIND, RandIntCallback(), NULL,
+                         NetLog::Source());
+  ASSERT_THAT(client.Connect(server_address), IsOk());
+#if defined(OS_LINUX)
+  EXPECT_THAT(client.EnableReceiveTimestamps(), IsOk());
+#endif
+
+  // Let the server learn the client's address.
+  const std::string kHello = "hello";
+  EXPECT_EQ(static_cast<int>(kHello.size()), WriteSocket(&client, kHello));
+  EXPECT_EQ(kHello, RecvFromSocket(&server));
+
+  // A read with nothing to read is pending until the first datagram arrives.
+  const int kDatagramLen = 64;
+  const int kMaxDatagrams = 8;
+  scoped_refptr<IOBuffer> buffer(new IOBuffer(kDatagramLen * kMaxDatagrams));
+  DatagramClientSocket::ReceivedDatagram datagrams[kMaxDatagrams];
+  TestCompletionCallback callback;
+  int rv = client.ReadMultiple(buffer.get(), kDatagramLen, kMaxDatagrams,
+                               datagrams, callback.callback());
+  EXPECT_THAT(rv, IsError(ERR_IO_PENDING));
+
+  const char* const kMessages[] = {"one", "two", "three"};
+  for (const std::string message : kMessages) {
+    EXPECT_EQ(static_cast<int>(message.size()),
+              SendToSocket(&server, message));
+  }
+
+  std::vector<std::string> received;
+  rv = callback.WaitForResult();
+  while (true) {
+    ASSERT_GT(rv, 0);
+    for (int i = 0; i < rv; ++i) {
+      received.push_back(std::string(buffer->data() + i * kDatagramLen,
+                                     datagrams[i].length));
+#if defined(OS_LINUX)
+      EXPECT_FALSE(datagrams[i].receive_time.is_null());
+#endif
+    }
+    if (received.size() == arraysize(kMessages))
+      break;
+    rv = client.ReadMultiple(buffer.get(), kDatagramLen, kMaxDatagrams,
+                             datagrams, callback.callback());
+    if (rv == ERR_IO_PENDING)
+      rv = callback.WaitForResult();
+  }
+  EXPECT_EQ(
+      std::vector<std::string>(kMessages, kMessages + arraysize(kMessages)),
+      received);
+}
+#endif  // defined(OS_POSIX)
+
+#if defined(OS_LINUX)
+// Datagrams sent with UDP_SEGMENT are read as one with generic receive
+// offload, and split back up by their segment size.
+TEST_F(UDPSocketTest, ReadMultipleCoalesced) {
+  // Nothing in net/ sends with UDP_SEGMENT, so use a raw socket.
+  int sender = socket(AF_INET, SOCK_DGRAM, 0);
+  ASSERT_GE(sender, 0);
+  const int kSegmentSize = 100;
+  if (setsockopt(sender, SOL_UDP, UDP_SEGMENT, &kSegmentSize,
+                 sizeof(kSegmentSize)) != 0) {
+    LOG(WARNING) << "UDP_SEGMENT not supported; skipping test.";
+    close(sender);
+    return;
+  }
+  IPEndPoint sender_address;
+  CreateUDPAddress("127.0.0.1", 0, &sender_address);
+  SockaddrStorage storage;
+  ASSERT_TRUE(sender_address.ToSockAddr(storage.addr, &storage.addr_len));
+  ASSERT_EQ(0, bind(sender, storage.addr, storage.addr_len));
+  storage = SockaddrStorage();
+  ASSERT_EQ(0, getsockname(sender, storage.addr, &storage.addr_len));
+  ASSERT_TRUE(sender_address.FromSockAddr(storage.addr, storage.addr_len));
+
+  UDPClientSocket client(DatagramSocket::DEFAULT_BIND, RandIntCallback(), NULL,
+                         NetLog::Source());
+  ASSERT_THAT(client.Connect(sender_address), IsOk());
+  if (client.EnableGenericReceiveOffload() != OK) {
+    LOG(WARNING) << "UDP_GRO not supported; skipping test.";
+    close(sender);
+    return;
+  }
+  IPEndPoint client_address;
+  ASSERT_THAT(client.GetLocalAddress(&client_address), IsOk());
+
+  // Three full segments and a short one.
+  const std::string kData = std::string(3 * kSegmentSize, 'a') + "bcd";
+  storage = SockaddrStorage();
+  ASSERT_TRUE(client_address.ToSockAddr(storage.addr, &storage.addr_len));
+  ASSERT_EQ(static_cast<ssize_t>(kData.size()),
+            sendto(sender, kData.data(), kData.size(), 0, storage.addr,
+                   storage.addr_len));
+  close(sender);
+
+  const int kMaxDatagrams = 2;
+  scoped_refptr<IOBuffer> buffer(new IOBuffer(
+      DatagramClientSocket::kMaxCoalescedDatagramSize * kMaxDatagrams));
+  DatagramClientSocket::ReceivedDatagram datagrams[kMaxDatagrams];
+  TestCompletionCallback callback;
+  int rv = client.ReadMultiple(
+      buffer.get(), DatagramClientSocket::kMaxCoalescedDatagramSize,
+      kMaxDatagrams, datagrams, callback.callback());
+  EXPECT_EQ(1, callback.GetResult(rv));
+  EXPECT_EQ(static_cast<int>(kData.size()), datagrams[0].length);
+  EXPECT_EQ(kSegmentSize, datagrams[0].segment_size);
+  EXPECT_EQ(kData, std::string(buffer->data(), datagrams[0].length));
+}
+#endif  // defined(OS_LINUX)
+
 TEST_F(UDPSocketTest, ServerGetLocalAddress) {
   IPEndPoint bind_address;
   CreateUDPAddress("127.0.0.1", 0, &bind_address);
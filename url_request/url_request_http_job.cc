@@ -811,6 +811,12 @@ void URLRequestHttpJob::AddCookieHeaderAndStart() {
       }
     }
 
+    CookieList cookie_list;
+    if (cookie_store->GetCookieListWithOptionsIfAvailable(
+            request_->url(), options, &cookie_list)) {
+      SetCookieHeaderAndStart(cookie_list);
+      return;
+    }
     cookie_store->GetCookieListWithOptionsAsync(
         request_->url(), options,
         base::Bind(&URLRequestHttpJob::SetCookieHeaderAndStart,